@@ -23,6 +23,9 @@
 #include "core.hh"
 #include "core2.hh"
 #include "core2_info.hh"
+#include "core2_checkpoint.hh"
+#include "core2_copy.hh"
+#include "core2_verify.hh"
 #include "infrarecorder.hh"
 #include "burn_image_dlg.hh"
 #include "copy_disc_dlg.hh"
@@ -70,24 +73,22 @@ DWORD WINAPI CActionManager::BurnCompilationThread(LPVOID lpThreadParameter)
     struct CLocalData
     {
         // The destructor frees these variables automatically.
-        ckcore::File ImageFile;
+        ckcore::tstring ImagePath;    // Not used when burning on the fly.
+        bool bKeepImage;              // Keep a partial image so that it can be resumed.
         ckfilesystem::FileSet Files;  // Files to burn.
         std::vector<TCHAR *> TempTracks;
         const TCHAR *pAudioText;
 
         CLocalData(void)
-            : ImageFile(g_BurnImageSettings.m_bOnFly
-                            ? ckcore::Path() // 'ImageFile' variable not used.
-                            : ckcore::File::temp(g_GlobalSettings.m_szTempPath,
-                                                 ckT("InfraRecorder"))),
+            : bKeepImage(false),
               Files(g_ProjectSettings.m_iFileSystem == FILESYSTEM_DVDVIDEO),
               pAudioText(NULL)
         {}
 
         ~CLocalData(void)
         {
-            if (!g_BurnImageSettings.m_bOnFly)
-                ImageFile.remove();
+            if (!ImagePath.empty() && !bKeepImage)
+                CCore2Checkpoint::Remove(ImagePath.c_str());
 
             ckfilesystem::destroy_file_set(Files);
 
@@ -110,6 +111,10 @@ DWORD WINAPI CActionManager::BurnCompilationThread(LPVOID lpThreadParameter)
     // Used for locating the files on the disc when verifying.
     std::map<tstring,tstring> FilePathMap;
 
+    // Data discs recorded from an image are verified against the image.
+    CCore2Verify ImageVerify;
+    bool bImageVerify = false;
+
     switch (iProjectType)
     {
         case PROJECTTYPE_DATA:
@@ -149,8 +154,18 @@ DWORD WINAPI CActionManager::BurnCompilationThread(LPVOID lpThreadParameter)
 
             g_pProgressDlg->notify(ckcore::Progress::ckINFORMATION,lngGetString(PROGRESS_BEGINDISCIMAGE));
 
-            const int iCreateImageResult = g_Core2.CreateImage(LocalData.ImageFile.name().c_str(),LocalData.Files,*g_pProgressDlg,
-                                                               true,g_BurnImageSettings.m_bVerify ? &FilePathMap : NULL);
+            // The image is named after the files so that a failed image is
+            // resumed when the same files are recorded again.
+            LocalData.ImagePath = CCore2Checkpoint::GetTempImagePath(g_GlobalSettings.m_szTempPath,
+                                                                     LocalData.Files);
+
+            // The image is hashed for the verification while it's written.
+            std::vector<ckcore::tuint32> BlockHashes;
+            bool bHashImage = g_BurnImageSettings.m_bVerify && iProjectType == PROJECTTYPE_DATA;
+
+            const int iCreateImageResult = g_Core2.CreateImage(LocalData.ImagePath.c_str(),LocalData.Files,*g_pProgressDlg,
+                                                               true,g_BurnImageSettings.m_bVerify ? &FilePathMap : NULL,true,
+                                                               bHashImage ? &BlockHashes : NULL);
             g_pProgressDlg->set_progress(100);
 
             switch (iCreateImageResult)
@@ -158,6 +173,16 @@ DWORD WINAPI CActionManager::BurnCompilationThread(LPVOID lpThreadParameter)
                 case RESULT_OK:
                     g_pProgressDlg->notify(ckcore::Progress::ckINFORMATION,lngGetString(SUCCESS_CREATEIMAGE));
                     result = BURNRESULT_OK;
+
+                    if (bHashImage)
+                    {
+                        unsigned long ulSessionStart = 0;
+                        if (g_ProjectSettings.m_bMultiSession)
+                            ulSessionStart = (unsigned long)g_ProjectSettings.m_uiNextWritableAddr;
+
+                        bImageVerify = ImageVerify.SetImageHashes(LocalData.ImagePath.c_str(),BlockHashes,
+                                                                  ulSessionStart);
+                    }
                     break;
 
                 case RESULT_CANCEL:
@@ -165,8 +190,10 @@ DWORD WINAPI CActionManager::BurnCompilationThread(LPVOID lpThreadParameter)
                     return 0;
 
                 case RESULT_FAIL:
+                    LocalData.bKeepImage = true;
                     g_pProgressDlg->set_status(lngGetString(PROGRESS_FAILED));
                     g_pProgressDlg->notify(ckcore::Progress::ckERROR,lngGetString(FAILURE_CREATEIMAGE));
+                    g_pProgressDlg->notify(ckcore::Progress::ckINFORMATION,lngGetString(INFO_IMAGEKEPT));
                     g_pProgressDlg->NotifyCompleted();
                     return 0;
 
@@ -261,12 +288,12 @@ DWORD WINAPI CActionManager::BurnCompilationThread(LPVOID lpThreadParameter)
                 {
                     if (g_BurnImageSettings.m_bVerify || !bLast)
                     {
-                        result = g_Core.BurnTracksEx(Device,g_pProgressDlg,LocalData.ImageFile.name().c_str(),
+                        result = g_Core.BurnTracksEx(Device,g_pProgressDlg,LocalData.ImagePath.c_str(),
                             AudioTracks,NULL,g_ProjectSettings.m_iIsoFormat);
                     }
                     else
                     {
-                        bool bBurnTracksRes = g_Core.BurnTracks(Device,g_pProgressDlg,LocalData.ImageFile.name().c_str(),
+                        bool bBurnTracksRes = g_Core.BurnTracks(Device,g_pProgressDlg,LocalData.ImagePath.c_str(),
                             AudioTracks,NULL,g_ProjectSettings.m_iIsoFormat);
                         result = bBurnTracksRes ? BURNRESULT_OK : BURNRESULT_INTERNALERROR;
                     }
@@ -333,12 +360,12 @@ DWORD WINAPI CActionManager::BurnCompilationThread(LPVOID lpThreadParameter)
                 {
                     if (g_BurnImageSettings.m_bVerify || !bLast)
                     {
-                        result = g_Core.BurnTracksEx(Device,g_pProgressDlg,LocalData.ImageFile.name().c_str(),
+                        result = g_Core.BurnTracksEx(Device,g_pProgressDlg,LocalData.ImagePath.c_str(),
                             AudioTracks,LocalData.pAudioText,g_ProjectSettings.m_iIsoFormat);
                     }
                     else
                     {
-                        bool bBurnTracksRes = g_Core.BurnTracks(Device,g_pProgressDlg,LocalData.ImageFile.name().c_str(),
+                        bool bBurnTracksRes = g_Core.BurnTracks(Device,g_pProgressDlg,LocalData.ImagePath.c_str(),
                             AudioTracks,LocalData.pAudioText,g_ProjectSettings.m_iIsoFormat);
                         result = bBurnTracksRes ? BURNRESULT_OK : BURNRESULT_INTERNALERROR;
                     }
@@ -414,14 +441,20 @@ DWORD WINAPI CActionManager::BurnCompilationThread(LPVOID lpThreadParameter)
             g_pProgressDlg->set_status(lngGetString(PROGRESS_INIT));
             g_pProgressDlg->SetWindowText(lngGetString(STITLE_VERIFYDISC));
 
-            // Get the device drive letter.
-            TCHAR szDriveLetter[3];
-            szDriveLetter[0] = Device.address().device_[0];
-            szDriveLetter[1] = ':';
-            szDriveLetter[2] = '\0';
-
-            // Validate the project files.
-            g_ProjectManager.VerifyCompilation(g_pProgressDlg,szDriveLetter,FilePathMap);
+            // Compare the disc with the image, and fall back on comparing
+            // the files if the disc can't be read directly.
+            if (!bImageVerify ||
+                (!ImageVerify.VerifyDisc(Device,g_pProgressDlg,FilePathMap) && !g_pProgressDlg->cancelled()))
+            {
+                // Get the device drive letter.
+                TCHAR szDriveLetter[3];
+                szDriveLetter[0] = Device.address().device_[0];
+                szDriveLetter[1] = ':';
+                szDriveLetter[2] = '\0';
+
+                // Validate the project files.
+                g_ProjectManager.VerifyCompilation(g_pProgressDlg,szDriveLetter,FilePathMap);
+            }
 
             // We're done.
             g_pProgressDlg->set_progress(100);
@@ -487,10 +520,12 @@ DWORD WINAPI CActionManager::CreateImageThread(LPVOID lpThreadParameter)
 
         g_pProgressDlg->notify(ckcore::Progress::ckINFORMATION,lngGetString(PROGRESS_BEGINDISCIMAGE));
 
-        int iResult = g_Core2.CreateImage(szFileName,Files,*g_pProgressDlg,true);
+        int iResult = g_Core2.CreateImage(szFileName,Files,*g_pProgressDlg,true,NULL,true);
         g_pProgressDlg->set_progress(100);
         g_pProgressDlg->NotifyCompleted();
 
+        // Failed images are kept so that they can be resumed, cancelled images
+        // have been abandoned by the user.
         switch (iResult)
         {
             case RESULT_OK:
@@ -501,12 +536,11 @@ DWORD WINAPI CActionManager::CreateImageThread(LPVOID lpThreadParameter)
             case RESULT_FAIL:
                 g_pProgressDlg->set_status(lngGetString(PROGRESS_FAILED));
                 g_pProgressDlg->notify(ckcore::Progress::ckERROR,lngGetString(FAILURE_CREATEIMAGE));
-
-                ckcore::File::remove(szFileName);
+                g_pProgressDlg->notify(ckcore::Progress::ckINFORMATION,lngGetString(INFO_IMAGEKEPT));
                 break;
 
             case RESULT_CANCEL:
-                ckcore::File::remove(szFileName);
+                CCore2Checkpoint::Remove(szFileName);
                 break;
 
             default:
@@ -610,7 +644,7 @@ bool CActionManager::QuickEraseQuery(ckmmc::Device &Device,HWND hWndParent)
 {
     if (!g_ProjectSettings.m_bMultiSession)
     {
-        CCore2Info Info;
+        CCore2Info Info(g_pLogDlg);
         CCore2DiscInfo DiscInfo;
         if (Info.ReadDiscInformation(Device,&DiscInfo))
         {
@@ -736,6 +770,78 @@ INT_PTR CActionManager::CreateImage(HWND hWndParent,bool bAppMode)
     return iResult;
 }
 
+DWORD WINAPI CActionManager::BurnImageVerifyThread(LPVOID lpThreadParameter)
+{
+    std::auto_ptr<CBurnImageParam> Param((CBurnImageParam *)lpThreadParameter);
+
+    ckmmc::Device &Device = *g_BurnImageSettings.m_pRecorder;
+
+    // Calculate the checksums of the image before it's recorded.
+    CCore2Verify ImageVerify;
+    bool bImageVerify = ImageVerify.HashImage(Param->m_FilePath.c_str(),g_pProgressDlg);
+
+    if (g_pProgressDlg->cancelled())
+    {
+        g_pProgressDlg->set_status(lngGetString(PROGRESS_CANCELED));
+        g_pProgressDlg->notify(ckcore::Progress::ckWARNING,lngGetString(PROGRESS_CANCELED));
+        g_pProgressDlg->NotifyCompleted();
+        return 0;
+    }
+
+    if (!bImageVerify)
+        g_pProgressDlg->notify(ckcore::Progress::ckWARNING,lngGetString(WARNING_HASHIMAGE));
+
+    g_pProgressDlg->set_progress(0);
+    g_pProgressDlg->set_status(lngGetString(PROGRESS_INIT));
+
+    // Make sure that the disc will not be ejected before beeing verified.
+    bool bEject = g_BurnImageSettings.m_bEject;
+    g_BurnImageSettings.m_bEject = false;
+
+    bool bResult = g_Core.BurnImageEx(Device,g_pProgressDlg,Param->m_FilePath.c_str(),false);
+    g_BurnImageSettings.m_bEject = bEject;
+
+    if (!bResult)
+    {
+        g_pProgressDlg->set_status(lngGetString(PROGRESS_CANCELED));
+        g_pProgressDlg->notify(ckcore::Progress::ckWARNING,lngGetString(PROGRESS_CANCELED));
+        g_pProgressDlg->NotifyCompleted();
+
+        lngMessageBox(HWND_DESKTOP,FAILURE_CDRTOOLS,GENERAL_ERROR,MB_OK | MB_ICONERROR);
+        return 0;
+    }
+
+    if (bImageVerify)
+    {
+        // We need to reload the drive media.
+        g_pProgressDlg->set_status(lngGetString(PROGRESS_RELOADMEDIA));
+
+        g_Core2.StartStopUnit(Device,CCore2::LOADMEDIA_EJECT,false);
+        if (!g_Core2.StartStopUnit(Device,CCore2::LOADMEDIA_LOAD,false))
+            lngMessageBox(*g_pProgressDlg,INFO_RELOAD,GENERAL_INFORMATION,MB_OK | MB_ICONINFORMATION);
+
+        // Set the device information.
+        g_pProgressDlg->SetDevice(Device);
+        g_pProgressDlg->set_status(lngGetString(PROGRESS_INIT));
+        g_pProgressDlg->SetWindowText(lngGetString(STITLE_VERIFYDISC));
+
+        // There is no project to map the files on the disc to.
+        std::map<tstring,tstring> FilePathMap;
+        ImageVerify.VerifyDisc(Device,g_pProgressDlg,FilePathMap);
+    }
+
+    // We're done.
+    g_pProgressDlg->set_progress(100);
+    g_pProgressDlg->set_status(lngGetString(PROGRESS_DONE));
+    g_pProgressDlg->NotifyCompleted();
+
+    // Eject the disc if requested.
+    if (bEject)
+        g_Core.EjectDisc(Device,false);
+
+    return 0;
+}
+
 INT_PTR CActionManager::BurnImage(HWND hWndParent,bool bAppMode)
 {
     WTL::CFileDialog FileDialog(true,0,0,OFN_FILEMUSTEXIST | OFN_EXPLORER,
@@ -769,7 +875,7 @@ INT_PTR CActionManager::BurnImageEx(HWND hWndParent,bool bAppMode,const TCHAR *s
         bImageHasTOC = true;
 
     // Display the burn image dialog.
-    CBurnImageDlg BurnImageDlg(szTitle,bImageHasTOC,false,false,bAppMode);
+    CBurnImageDlg BurnImageDlg(szTitle,bImageHasTOC,false,!bImageHasTOC,bAppMode);
     INT_PTR iResult = BurnImageDlg.DoModal();
 
     if (iResult == IDOK)
@@ -812,8 +918,16 @@ INT_PTR CActionManager::BurnImageEx(HWND hWndParent,bool bAppMode,const TCHAR *s
         g_pProgressDlg->SetDevice(Device);
         g_pProgressDlg->set_status(lngGetString(PROGRESS_INIT));
 
-        // Begin burning the image.
-        if (!g_Core.BurnImage(Device,g_pProgressDlg,szFilePath,bImageHasTOC))
+        // Begin burning the image. Verifying requires the recording to be
+        // finished, so it's done in a separate thread.
+        if (g_BurnImageSettings.m_bVerify && !bImageHasTOC)
+        {
+            unsigned long ulThreadID = 0;
+            HANDLE hThread = ::CreateThread(NULL,0,BurnImageVerifyThread,
+                                            new CBurnImageParam(szFilePath),0,&ulThreadID);
+            ::CloseHandle(hThread);
+        }
+        else if (!g_Core.BurnImage(Device,g_pProgressDlg,szFilePath,bImageHasTOC))
         {
             g_pProgressDlg->set_status(lngGetString(PROGRESS_CANCELED));
             g_pProgressDlg->notify(ckcore::Progress::ckWARNING,lngGetString(PROGRESS_CANCELED));
@@ -834,12 +948,71 @@ INT_PTR CActionManager::BurnImageEx(HWND hWndParent,bool bAppMode,const TCHAR *s
     return iResult;
 }
 
+/*
+    CActionManager::CopyDiscNative
+    ------------------------------
+    Copies the disc from the source to the target drive without cdrtools and
+    without an intermediate image. Returns false if the discs are not
+    supported, in which case nothing has been written.
+*/
+bool CActionManager::CopyDiscNative(ckmmc::Device &SrcDevice,ckmmc::Device &DstDevice)
+{
+    if (g_CopyDiscSettings.m_bClone)
+        return false;
+
+    // These settings are only implemented by cdrtools.
+    if (!g_BurnImageSettings.m_bFixate || g_BurnAdvancedSettings.m_bOverburn ||
+        g_ReadSettings.m_bIgnoreErr)
+    {
+        g_pLogDlg->print_line(_T("  The disc can't be copied natively with the current settings, using cdrtools."));
+        return false;
+    }
+
+    // Set the status information.
+    g_pProgressDlg->SetWindowText(lngGetString(STITLE_COPYDISC));
+    g_pProgressDlg->SetDevice(DstDevice);
+    g_pProgressDlg->set_status(lngGetString(PROGRESS_INIT));
+
+    CCore2Copy Copy;
+    switch (Copy.CopyDisc(SrcDevice,DstDevice,g_pProgressDlg,g_BurnImageSettings.m_bSimulate,
+        (int)g_ReadSettings.m_iReadSpeed,g_BurnImageSettings.m_iWriteSpeed))
+    {
+        case CCore2Copy::RESULT_OK:
+            if (g_BurnImageSettings.m_bEject)
+                g_Core2.StartStopUnit(DstDevice,CCore2::LOADMEDIA_EJECT,true);
+
+            g_pProgressDlg->set_status(lngGetString(PROGRESS_DONE));
+            g_pProgressDlg->NotifyCompleted();
+            return true;
+
+        case CCore2Copy::RESULT_FAIL:
+            if (g_pProgressDlg->cancelled())
+            {
+                g_pProgressDlg->set_status(lngGetString(PROGRESS_CANCELED));
+                g_pProgressDlg->notify(ckcore::Progress::ckWARNING,lngGetString(PROGRESS_CANCELED));
+            }
+            else
+            {
+                g_pProgressDlg->set_status(lngGetString(PROGRESS_FAILED));
+            }
+
+            g_pProgressDlg->NotifyCompleted();
+            return true;
+    }
+
+    g_pLogDlg->print_line(_T("  The disc can't be copied natively, using cdrtools."));
+    return false;
+}
+
 DWORD WINAPI CActionManager::CopyDiscOnFlyThread(LPVOID lpThreadParameter)
 {
     // Get device information.
     ckmmc::Device &SrcDevice = *g_CopyDiscSettings.m_pSource;
     ckmmc::Device &DstDevice = *g_CopyDiscSettings.m_pTarget;
 
+    if (CopyDiscNative(SrcDevice,DstDevice))
+        return 0;
+
     // Set the status information.
     g_pProgressDlg->SetWindowText(lngGetString(STITLE_COPYDISC));
     g_pProgressDlg->SetDevice(DstDevice);
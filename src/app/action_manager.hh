@@ -17,6 +17,7 @@
  */
 
 #pragma once
+#include <ckcore/types.hh>
 
 class CActionManager
 {
@@ -29,8 +30,18 @@ private:
         CEraseParam(bool bNotifyCompleted) : m_bNotifyCompleted(bNotifyCompleted) {}
     };
 
+    class CBurnImageParam
+    {
+    public:
+        ckcore::tstring m_FilePath;
+
+        CBurnImageParam(const TCHAR *szFilePath) : m_FilePath(szFilePath) {}
+    };
+
     static DWORD WINAPI BurnCompilationThread(LPVOID lpThreadParameter);
     static DWORD WINAPI CreateImageThread(LPVOID lpThreadParameter);
+    static DWORD WINAPI BurnImageVerifyThread(LPVOID lpThreadParameter);
+    static bool CopyDiscNative(ckmmc::Device &SrcDevice,ckmmc::Device &DstDevice);
     static DWORD WINAPI CopyDiscOnFlyThread(LPVOID lpThreadParameter);
     static DWORD WINAPI CopyDiscThread(LPVOID lpThreadParameter);
     static DWORD WINAPI EraseThread(LPVOID lpThreadParameter);
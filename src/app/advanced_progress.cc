@@ -23,3 +23,8 @@ void CAdvancedProgress::SetBuffer(int iPercent)
 {
     // Do nothing.
 }
+
+void CAdvancedProgress::SetSourceBuffer(int iPercent)
+{
+    // Do nothing.
+}
@@ -37,6 +37,7 @@ public:
 
     // Not forced to be implemented by inheritor.
     virtual void SetBuffer(int iPercent);
+    virtual void SetSourceBuffer(int iPercent);
 
     virtual void AllowReload() = 0;
     virtual void AllowCancel(bool bAllow) = 0;
@@ -0,0 +1,802 @@
+/*
+ * InfraRecorder - CD/DVD burning software
+ * Copyright (C) 2006-2012 Christian Kindahl
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "stdafx.hh"
+#include <ckcore/file.hh>
+#include <base/string_util.hh>
+#include <base/checksum_util.hh>
+#include <base/xml_processor.hh>
+#include "core2.hh"
+#include "core2_info.hh"
+#include "string_table.hh"
+#include "lang_util.hh"
+#include "log_dlg.hh"
+#include "device_util.hh"
+#include "audio_util.hh"
+#include "batch_rip.hh"
+
+CBatchRip::CDisc::CDisc(const TCHAR *szId,const TCHAR *szFolderPath) :
+    m_Id(szId),m_FolderPath(szFolderPath),m_bActive(false)
+{
+}
+
+ckcore::tstring CBatchRip::CDisc::GetTrackPath(unsigned int uiIndex,const TCHAR *szFileExt) const
+{
+    TCHAR szFileName[32];
+    lsnprintf_s(szFileName,32,_T("\\Track %02d"),m_Tracks[uiIndex].m_ucNumber);
+
+    ckcore::tstring FilePath = m_FolderPath;
+    FilePath += szFileName;
+    FilePath += szFileExt;
+
+    return FilePath;
+}
+
+unsigned int CBatchRip::CDisc::GetTrackCount(eTrackState State) const
+{
+    unsigned int uiCount = 0;
+    for (unsigned int i = 0; i < m_Tracks.size(); i++)
+    {
+        if (m_Tracks[i].m_State == State)
+            uiCount++;
+    }
+
+    return uiCount;
+}
+
+bool CBatchRip::CDisc::Load()
+{
+    ckcore::tstring StatePath = m_FolderPath + _T("\\") + BATCHRIP_STATE_FILENAME;
+
+    CXmlProcessor Xml;
+    if (Xml.Load(StatePath.c_str()) != XMLRES_OK)
+        return false;
+
+    if (!Xml.EnterElement(_T("InfraRecorder")))
+        return false;
+
+    if (!Xml.EnterElement(_T("RipState")))
+        return false;
+
+    int iVersion = 0;
+    Xml.GetSafeElementAttrValue(_T("version"),&iVersion);
+
+    TCHAR szId[32];
+    Xml.GetSafeElementAttrValue(_T("id"),szId,31);
+
+    // The folder belongs to another disc.
+    if (iVersion > BATCHRIP_STATE_VERSION || m_Id != szId)
+        return false;
+
+    m_Tracks.clear();
+    for (unsigned int i = 0; i < Xml.GetElementChildCount(); i++)
+    {
+        if (!Xml.EnterElement(i))
+            return false;
+
+        int iNumber = 0,iState = TS_PENDING;
+        Xml.GetSafeElementAttrValue(_T("number"),&iNumber);
+        Xml.GetSafeElementAttrValue(_T("state"),&iState);
+
+        if (iState < TS_PENDING || iState > TS_DONE)
+            iState = TS_PENDING;
+
+        m_Tracks.push_back(CTrack(static_cast<unsigned char>(iNumber),(eTrackState)iState));
+
+        Xml.LeaveElement();
+    }
+
+    return true;
+}
+
+/*
+    CBatchRip::CDisc::Save
+    ----------------------
+    Saves the state of the disc. The state is written to a temporary file
+    which then replaces the old state file, so a crash while saving never
+    leaves a damaged state file behind.
+*/
+bool CBatchRip::CDisc::Save() const
+{
+    CXmlProcessor Xml;
+
+    Xml.AddElement(_T("InfraRecorder"),_T(""),true);
+        Xml.AddElement(_T("RipState"),_T(""),true);
+            Xml.AddElementAttr(_T("version"),BATCHRIP_STATE_VERSION);
+            Xml.AddElementAttr(_T("id"),m_Id.c_str());
+
+            TCHAR szName[32];
+            for (unsigned int i = 0; i < m_Tracks.size(); i++)
+            {
+                lsnprintf_s(szName,32,_T("Track%d"),i);
+
+                Xml.AddElement(szName,_T(""),true);
+                    Xml.AddElementAttr(_T("number"),(int)m_Tracks[i].m_ucNumber);
+                    Xml.AddElementAttr(_T("state"),(int)m_Tracks[i].m_State);
+                Xml.LeaveElement();
+            }
+        Xml.LeaveElement();
+    Xml.LeaveElement();
+
+    ckcore::tstring StatePath = m_FolderPath + _T("\\") + BATCHRIP_STATE_FILENAME;
+    ckcore::tstring TempPath = StatePath + _T(".tmp");
+
+    if (Xml.Save(TempPath.c_str()) != XMLRES_OK)
+        return false;
+
+    return ::MoveFileEx(TempPath.c_str(),StatePath.c_str(),
+                        MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != FALSE;
+}
+
+CBatchRip::CReader::CReader(CBatchRip &Owner,ckmmc::Device &Device) :
+    m_Owner(Owner),m_Device(Device),m_DeviceName(NDeviceUtil::GetDeviceName(Device)),
+    m_ucPercent(0)
+{
+}
+
+void CBatchRip::CReader::set_progress(unsigned char ucPercent)
+{
+    m_ucPercent = ucPercent > 100 ? 100 : ucPercent;
+    m_Owner.UpdateProgress();
+}
+
+void CBatchRip::CReader::set_marquee(bool bMarquee)
+{
+}
+
+void CBatchRip::CReader::set_status(const TCHAR *szStatus,...)
+{
+    TCHAR szStringBuffer[PROGRESS_STRINGBUFFER_SIZE];
+
+    va_list args;
+    va_start(args,szStatus);
+
+    _vsnwprintf(szStringBuffer,PROGRESS_STRINGBUFFER_SIZE - 1,szStatus,args);
+    szStringBuffer[PROGRESS_STRINGBUFFER_SIZE - 1] = '\0';
+
+    va_end(args);
+
+    m_Owner.m_Progress.set_status(_T("%s: %s"),m_DeviceName.c_str(),szStringBuffer);
+}
+
+void CBatchRip::CReader::notify(ckcore::Progress::MessageType Type,const TCHAR *szMessage,...)
+{
+    TCHAR szStringBuffer[PROGRESS_STRINGBUFFER_SIZE];
+
+    va_list args;
+    va_start(args,szMessage);
+
+    _vsnwprintf(szStringBuffer,PROGRESS_STRINGBUFFER_SIZE - 1,szMessage,args);
+    szStringBuffer[PROGRESS_STRINGBUFFER_SIZE - 1] = '\0';
+
+    va_end(args);
+
+    m_Owner.m_Progress.notify(Type,_T("%s: %s"),m_DeviceName.c_str(),szStringBuffer);
+}
+
+bool CBatchRip::CReader::cancelled()
+{
+    return m_Owner.m_Progress.cancelled();
+}
+
+/*
+    CBatchRip::CReader::NotifyCompleted
+    -----------------------------------
+    Each track is ripped by its own process, the batch is completed when all
+    readers are out of discs. This is reported by the owner.
+*/
+void CBatchRip::CReader::NotifyCompleted()
+{
+}
+
+void CBatchRip::CReader::SetRealMode(bool bRealMode)
+{
+}
+
+void CBatchRip::CReader::SetBuffer(int iPercent)
+{
+}
+
+void CBatchRip::CReader::AllowReload()
+{
+}
+
+void CBatchRip::CReader::AllowCancel(bool bAllow)
+{
+}
+
+bool CBatchRip::CReader::RequestNextDisc()
+{
+    return false;
+}
+
+void CBatchRip::CReader::StartSmoke()
+{
+}
+
+CBatchRip::CEncoderProgress::CEncoderProgress(CBatchRip &Owner) :
+    m_Owner(Owner)
+{
+}
+
+void CBatchRip::CEncoderProgress::set_progress(unsigned char ucPercent)
+{
+}
+
+void CBatchRip::CEncoderProgress::set_marquee(bool bMarquee)
+{
+}
+
+void CBatchRip::CEncoderProgress::set_status(const TCHAR *szStatus,...)
+{
+}
+
+void CBatchRip::CEncoderProgress::notify(ckcore::Progress::MessageType Type,const TCHAR *szMessage,...)
+{
+    TCHAR szStringBuffer[PROGRESS_STRINGBUFFER_SIZE];
+
+    va_list args;
+    va_start(args,szMessage);
+
+    _vsnwprintf(szStringBuffer,PROGRESS_STRINGBUFFER_SIZE - 1,szMessage,args);
+    szStringBuffer[PROGRESS_STRINGBUFFER_SIZE - 1] = '\0';
+
+    va_end(args);
+
+    m_Owner.m_Progress.notify(Type,_T("%s: %s"),
+        m_Owner.m_pEncoder->irc_string(IRC_STR_ENCODER),szStringBuffer);
+}
+
+bool CBatchRip::CEncoderProgress::cancelled()
+{
+    return m_Owner.m_Progress.cancelled();
+}
+
+/**
+    @param Devices the readers to rip from.
+    @param szTargetPath the library folder, each disc is stored in a sub
+    folder named after the disc.
+    @param pEncoder encoder used for the ripped tracks, if NULL the tracks are
+    kept as wave files.
+    @param Progress progress object receiving the status of all readers.
+*/
+CBatchRip::CBatchRip(const std::vector<ckmmc::Device *> &Devices,const TCHAR *szTargetPath,
+                     CCodec *pEncoder,CAdvancedProgress &Progress) :
+    m_Progress(Progress),m_TargetPath(szTargetPath),m_pEncoder(pEncoder),
+    m_bReadersDone(false),m_uiDiscCount(0),m_lFailedCount(0)
+{
+    ::InitializeCriticalSection(&m_csState);
+    ::InitializeCriticalSection(&m_csProgress);
+
+    m_hEncodeEvent = ::CreateEvent(NULL,FALSE,FALSE,NULL);
+
+    // Strip any trailing path delimiter.
+    if (!m_TargetPath.empty() && m_TargetPath[m_TargetPath.size() - 1] == '\\')
+        m_TargetPath.resize(m_TargetPath.size() - 1);
+
+    std::vector<ckmmc::Device *>::const_iterator it;
+    for (it = Devices.begin(); it != Devices.end(); it++)
+        m_Readers.push_back(new CReader(*this,**it));
+}
+
+CBatchRip::~CBatchRip()
+{
+    std::vector<CReader *>::iterator itReader;
+    for (itReader = m_Readers.begin(); itReader != m_Readers.end(); itReader++)
+        delete *itReader;
+
+    m_Readers.clear();
+
+    std::vector<CDisc *>::iterator itDisc;
+    for (itDisc = m_Discs.begin(); itDisc != m_Discs.end(); itDisc++)
+        delete *itDisc;
+
+    m_Discs.clear();
+
+    ::CloseHandle(m_hEncodeEvent);
+
+    ::DeleteCriticalSection(&m_csProgress);
+    ::DeleteCriticalSection(&m_csState);
+}
+
+/*
+    CBatchRip::UpdateProgress
+    -------------------------
+    Reports the average progress of the tracks being ripped.
+*/
+void CBatchRip::UpdateProgress()
+{
+    ::EnterCriticalSection(&m_csProgress);
+
+    unsigned int uiTotal = 0;
+
+    std::vector<CReader *>::const_iterator it;
+    for (it = m_Readers.begin(); it != m_Readers.end(); it++)
+        uiTotal += (*it)->m_ucPercent;
+
+    if (m_Readers.size() > 0)
+        m_Progress.set_progress((unsigned char)(uiTotal / m_Readers.size()));
+
+    ::LeaveCriticalSection(&m_csProgress);
+}
+
+void CBatchRip::Cancel()
+{
+    std::vector<CReader *>::iterator it;
+    for (it = m_Readers.begin(); it != m_Readers.end(); it++)
+    {
+        if ((*it)->m_Core.running())
+            (*it)->m_Core.kill();
+    }
+}
+
+/*
+    CBatchRip::LoadDiscs
+    --------------------
+    Loads the state of all discs in the library folder. Tracks that were
+    ripped but not encoded by a previous batch are queued for encoding.
+*/
+void CBatchRip::LoadDiscs()
+{
+    ckcore::tstring SearchPath = m_TargetPath + _T("\\*");
+
+    WIN32_FIND_DATA FileData;
+    HANDLE hFind = ::FindFirstFile(SearchPath.c_str(),&FileData);
+    if (hFind == INVALID_HANDLE_VALUE)
+        return;
+
+    unsigned int uiResumeCount = 0;
+
+    do
+    {
+        if (!(FileData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) ||
+            lstrncmp(FileData.cFileName,_T("Disc "),5))
+        {
+            continue;
+        }
+
+        ckcore::tstring FolderPath = m_TargetPath + _T("\\") + FileData.cFileName;
+
+        CDisc *pDisc = new CDisc(FileData.cFileName + 5,FolderPath.c_str());
+        if (!pDisc->Load())
+        {
+            delete pDisc;
+            continue;
+        }
+
+        m_Discs.push_back(pDisc);
+
+        for (unsigned int i = 0; i < pDisc->m_Tracks.size(); i++)
+        {
+            if (pDisc->m_Tracks[i].m_State != TS_RIPPED)
+                continue;
+
+            // Without the wave file the track has to be ripped again.
+            if (!ckcore::File::exist(pDisc->GetTrackPath(i,_T(".wav")).c_str()))
+            {
+                SetTrackState(pDisc,i,TS_PENDING);
+            }
+            else if (m_pEncoder != NULL)
+            {
+                Enqueue(pDisc,i);
+                uiResumeCount++;
+            }
+        }
+    }
+    while (::FindNextFile(hFind,&FileData));
+
+    ::FindClose(hFind);
+
+    if (uiResumeCount > 0)
+        m_Progress.notify(ckcore::Progress::ckINFORMATION,lngGetString(INFO_RIPRESUME),uiResumeCount);
+}
+
+/*
+    CBatchRip::AcquireDisc
+    ----------------------
+    Returns the library entry of a disc, the entry is created if the disc has
+    not been seen before. Returns NULL if the disc is being ripped by another
+    reader.
+*/
+CBatchRip::CDisc *CBatchRip::AcquireDisc(const TCHAR *szId,
+                                         const std::vector<unsigned char> &AudioTracks)
+{
+    ::EnterCriticalSection(&m_csState);
+
+    CDisc *pDisc = NULL;
+
+    std::vector<CDisc *>::iterator it;
+    for (it = m_Discs.begin(); it != m_Discs.end(); it++)
+    {
+        if ((*it)->m_Id == szId)
+        {
+            pDisc = *it;
+            break;
+        }
+    }
+
+    if (pDisc == NULL)
+    {
+        ckcore::tstring FolderPath = m_TargetPath + _T("\\Disc ") + szId;
+        ::CreateDirectory(FolderPath.c_str(),NULL);
+
+        pDisc = new CDisc(szId,FolderPath.c_str());
+        for (unsigned int i = 0; i < AudioTracks.size(); i++)
+            pDisc->m_Tracks.push_back(CTrack(AudioTracks[i],TS_PENDING));
+
+        m_Discs.push_back(pDisc);
+    }
+    else if (pDisc->m_bActive)
+    {
+        pDisc = NULL;
+    }
+
+    if (pDisc != NULL)
+        pDisc->m_bActive = true;
+
+    ::LeaveCriticalSection(&m_csState);
+    return pDisc;
+}
+
+void CBatchRip::ReleaseDisc(CDisc *pDisc)
+{
+    ::EnterCriticalSection(&m_csState);
+
+    pDisc->m_bActive = false;
+    if (pDisc->GetTrackCount(TS_PENDING) == 0)
+        m_uiDiscCount++;
+
+    ::LeaveCriticalSection(&m_csState);
+}
+
+void CBatchRip::SetTrackState(CDisc *pDisc,unsigned int uiTrack,eTrackState State)
+{
+    ::EnterCriticalSection(&m_csState);
+
+    pDisc->m_Tracks[uiTrack].m_State = State;
+    bool bSaved = pDisc->Save();
+
+    ::LeaveCriticalSection(&m_csState);
+
+    if (!bSaved)
+    {
+        m_Progress.notify(ckcore::Progress::ckERROR,lngGetString(ERROR_RIPSTATE),
+            pDisc->m_Id.c_str());
+    }
+}
+
+void CBatchRip::Enqueue(CDisc *pDisc,unsigned int uiTrack)
+{
+    ::EnterCriticalSection(&m_csState);
+    m_EncodeQueue.push_back(CEncodeJob(pDisc,uiTrack,pDisc->GetTrackPath(uiTrack,_T(".wav"))));
+    ::LeaveCriticalSection(&m_csState);
+
+    ::SetEvent(m_hEncodeEvent);
+}
+
+/*
+    CBatchRip::WaitForDisc
+    ----------------------
+    Waits until a disc has been inserted into, or removed from, the reader.
+    The reader is polled for media events, the table of contents is read
+    when an event is reported. Drives that don't report events are covered
+    by also reading the table of contents at an interval that grows up to
+    BATCHRIP_MAX_TOC_INTERVAL. Returns false if nothing happened within
+    BATCHRIP_DISC_TIMEOUT or if the batch was cancelled.
+*/
+bool CBatchRip::WaitForDisc(CReader *pReader,bool bInserted)
+{
+    unsigned long ulStartTime = ::GetTickCount();
+    unsigned long ulNextRead = 0,ulReadInterval = BATCHRIP_POLL_INTERVAL;
+
+    while (!m_Progress.cancelled())
+    {
+        unsigned long ulWaited = ::GetTickCount() - ulStartTime;
+        if (ulWaited >= BATCHRIP_DISC_TIMEOUT)
+            return false;
+
+        // The drive may not be ready right after an event, start over with a
+        // short interval.
+        if (g_Core2.CheckMediaChange(pReader->m_Device) != CCore2::MEDIACHANGE_NOCHANGE)
+        {
+            ulNextRead = ulWaited;
+            ulReadInterval = BATCHRIP_POLL_INTERVAL;
+        }
+
+        if (ulWaited >= ulNextRead)
+        {
+            unsigned char ucFirstTrackNumber = 0,ucLastTrackNumber = 0;
+            std::vector<CCore2TOCTrackDesc> Tracks;
+
+            CCore2Info Info(g_pLogDlg);
+            bool bPresent = Info.ReadTOC(pReader->m_Device,ucFirstTrackNumber,
+                                         ucLastTrackNumber,Tracks) && !Tracks.empty();
+            if (bPresent == bInserted)
+                return true;
+
+            ulNextRead = ulWaited + ulReadInterval;
+            ulReadInterval = min(ulReadInterval * 2,(unsigned long)BATCHRIP_MAX_TOC_INTERVAL);
+        }
+
+        ::Sleep(BATCHRIP_POLL_INTERVAL);
+    }
+
+    return false;
+}
+
+/*
+    CBatchRip::ReadDisc
+    -------------------
+    Reads the track layout of the disc in the reader. The disc is identified
+    by a checksum of the number, address, size and type of all its tracks.
+*/
+bool CBatchRip::ReadDisc(ckmmc::Device &Device,ckcore::tstring &Id,
+                         std::vector<unsigned char> &AudioTracks)
+{
+    unsigned char ucFirstTrackNumber = 0,ucLastTrackNumber = 0;
+    std::vector<CCore2TOCTrackDesc> Tracks;
+
+    CCore2Info Info(g_pLogDlg);
+    if (!Info.ReadTOC(Device,ucFirstTrackNumber,ucLastTrackNumber,Tracks) || Tracks.empty())
+        return false;
+
+    ckcore::tuint32 uiCrc = 0;
+
+    std::vector<CCore2TOCTrackDesc>::const_iterator it;
+    for (it = Tracks.begin(); it != Tracks.end(); it++)
+    {
+        CCore2TrackInfo TrackInfo;
+        if (!Info.ReadTrackInformation(Device,CCore2Info::TIT_TRACK,it->m_ucTrackNumber,&TrackInfo))
+            return false;
+
+        bool bAudio = !(TrackInfo.m_ucTrackMode & 0x04);
+        if (bAudio)
+            AudioTracks.push_back(it->m_ucTrackNumber);
+
+        unsigned char ucTrack[10];
+        ucTrack[0] = it->m_ucTrackNumber;
+        ucTrack[1] = bAudio ? 1 : 0;
+        ucTrack[2] = static_cast<unsigned char>(TrackInfo.m_ulTrackAddr >> 24);
+        ucTrack[3] = static_cast<unsigned char>(TrackInfo.m_ulTrackAddr >> 16);
+        ucTrack[4] = static_cast<unsigned char>(TrackInfo.m_ulTrackAddr >> 8);
+        ucTrack[5] = static_cast<unsigned char>(TrackInfo.m_ulTrackAddr);
+        ucTrack[6] = static_cast<unsigned char>(TrackInfo.m_ulTrackSize >> 24);
+        ucTrack[7] = static_cast<unsigned char>(TrackInfo.m_ulTrackSize >> 16);
+        ucTrack[8] = static_cast<unsigned char>(TrackInfo.m_ulTrackSize >> 8);
+        ucTrack[9] = static_cast<unsigned char>(TrackInfo.m_ulTrackSize);
+
+        uiCrc = ChecksumCrc32(ucTrack,sizeof(ucTrack),uiCrc);
+    }
+
+    TCHAR szId[16];
+    lsnprintf_s(szId,16,_T("%08X"),uiCrc);
+    Id = szId;
+
+    return true;
+}
+
+/*
+    CBatchRip::RipDisc
+    ------------------
+    Rips all tracks of the disc that have not been ripped before. A track that
+    can't be ripped stays pending and is retried the next time the disc is
+    inserted.
+*/
+void CBatchRip::RipDisc(CReader *pReader,const TCHAR *szId,
+                        const std::vector<unsigned char> &AudioTracks)
+{
+    CDisc *pDisc = AcquireDisc(szId,AudioTracks);
+    if (pDisc == NULL)
+    {
+        pReader->notify(ckcore::Progress::ckWARNING,lngGetString(WARNING_RIPDISCBUSY),szId);
+        return;
+    }
+
+    pReader->notify(ckcore::Progress::ckINFORMATION,lngGetString(INFO_RIPDISC),szId,
+        pDisc->GetTrackCount(TS_PENDING),(unsigned int)pDisc->m_Tracks.size());
+
+    for (unsigned int i = 0; i < pDisc->m_Tracks.size(); i++)
+    {
+        if (pDisc->m_Tracks[i].m_State != TS_PENDING)
+            continue;
+
+        if (m_Progress.cancelled())
+            break;
+
+        ckcore::tstring FilePath = pDisc->GetTrackPath(i,_T(".wav"));
+
+        pReader->set_progress(0);
+        eBurnResult Result = pReader->m_Core.ReadAudioTrackEx(pReader->m_Device,pReader,
+            FilePath.c_str(),pDisc->m_Tracks[i].m_ucNumber);
+
+        if (Result != BURNRESULT_OK || m_Progress.cancelled())
+        {
+            ckcore::File::remove(FilePath.c_str());
+            if (m_Progress.cancelled())
+                break;
+
+            pReader->notify(ckcore::Progress::ckERROR,lngGetString(FAILURE_RIPTRACK),
+                pDisc->m_Tracks[i].m_ucNumber,szId);
+
+            ::InterlockedIncrement(&m_lFailedCount);
+            continue;
+        }
+
+        if (m_pEncoder != NULL)
+        {
+            SetTrackState(pDisc,i,TS_RIPPED);
+            Enqueue(pDisc,i);
+        }
+        else
+        {
+            SetTrackState(pDisc,i,TS_DONE);
+        }
+    }
+
+    pReader->set_progress(100);
+
+    if (pDisc->GetTrackCount(TS_PENDING) == 0)
+        pReader->notify(ckcore::Progress::ckINFORMATION,lngGetString(INFO_RIPDISCDONE),szId);
+
+    ReleaseDisc(pDisc);
+}
+
+DWORD WINAPI CBatchRip::ReaderThread(LPVOID lpThreadParameter)
+{
+    CReader *pReader = (CReader *)lpThreadParameter;
+    CBatchRip &Owner = pReader->m_Owner;
+
+    pReader->set_status(lngGetString(STATUS_WAITDISC));
+
+    while (Owner.WaitForDisc(pReader,true))
+    {
+        ckcore::tstring Id;
+        std::vector<unsigned char> AudioTracks;
+
+        if (Owner.ReadDisc(pReader->m_Device,Id,AudioTracks) && !AudioTracks.empty())
+            Owner.RipDisc(pReader,Id.c_str(),AudioTracks);
+        else
+            pReader->notify(ckcore::Progress::ckWARNING,lngGetString(WARNING_RIPNOAUDIO));
+
+        if (Owner.m_Progress.cancelled())
+            break;
+
+        // Wait for the disc to be replaced.
+        g_Core2.StartStopUnit(pReader->m_Device,CCore2::LOADMEDIA_EJECT,false);
+        pReader->set_status(lngGetString(STATUS_WAITDISC));
+
+        if (!Owner.WaitForDisc(pReader,false))
+            break;
+    }
+
+    return 0;
+}
+
+/*
+    CBatchRip::EncoderThread
+    ------------------------
+    Encodes the tracks queued by the readers until all readers are done and
+    the queue is empty. Codec plug-ins keep their encoder state in the plug-in
+    itself, so all tracks are encoded by this single thread.
+*/
+DWORD WINAPI CBatchRip::EncoderThread(LPVOID lpThreadParameter)
+{
+    CBatchRip *pBatchRip = (CBatchRip *)lpThreadParameter;
+    CEncoderProgress Progress(*pBatchRip);
+
+    while (!pBatchRip->m_Progress.cancelled())
+    {
+        ::EnterCriticalSection(&pBatchRip->m_csState);
+
+        bool bEmpty = pBatchRip->m_EncodeQueue.empty();
+        CEncodeJob Job(NULL,0,ckcore::tstring());
+        if (!bEmpty)
+        {
+            Job = pBatchRip->m_EncodeQueue.front();
+            pBatchRip->m_EncodeQueue.pop_front();
+        }
+
+        ::LeaveCriticalSection(&pBatchRip->m_csState);
+
+        if (bEmpty)
+        {
+            if (pBatchRip->m_bReadersDone)
+                break;
+
+            ::WaitForSingleObject(pBatchRip->m_hEncodeEvent,BATCHRIP_POLL_INTERVAL);
+            continue;
+        }
+
+        if (EncodeAudioFile(Job.m_FilePath.c_str(),pBatchRip->m_pEncoder,Progress))
+        {
+            ckcore::File::remove(Job.m_FilePath.c_str());
+            pBatchRip->SetTrackState(Job.m_pDisc,Job.m_uiTrack,TS_DONE);
+        }
+        else if (!pBatchRip->m_Progress.cancelled())
+        {
+            ::InterlockedIncrement(&pBatchRip->m_lFailedCount);
+        }
+    }
+
+    return 0;
+}
+
+/**
+    Rips discs until no reader has been given a new disc within
+    BATCHRIP_DISC_TIMEOUT, or until the batch is cancelled. The encoder keeps
+    running until all ripped tracks have been encoded.
+    @return BURNRESULT_OK if all tracks were ripped and encoded.
+*/
+eBurnResult CBatchRip::Run()
+{
+    if (!::CreateDirectory(m_TargetPath.c_str(),NULL) &&
+        ::GetLastError() != ERROR_ALREADY_EXISTS)
+    {
+        m_Progress.notify(ckcore::Progress::ckERROR,lngGetString(ERROR_TARGETFOLDER));
+        return BURNRESULT_INTERNALERROR;
+    }
+
+    LoadDiscs();
+
+    unsigned long ulThreadID = 0;
+    HANDLE hEncoderThread = NULL;
+    if (m_pEncoder != NULL)
+        hEncoderThread = ::CreateThread(NULL,0,EncoderThread,this,0,&ulThreadID);
+
+    std::vector<HANDLE> ReaderThreads;
+
+    std::vector<CReader *>::iterator it;
+    for (it = m_Readers.begin(); it != m_Readers.end(); it++)
+    {
+        HANDLE hThread = ::CreateThread(NULL,0,ReaderThread,*it,0,&ulThreadID);
+        if (hThread != NULL)
+            ReaderThreads.push_back(hThread);
+    }
+
+    // Wait for the readers, running processes are killed if the batch is
+    // cancelled.
+    if (!ReaderThreads.empty())
+    {
+        while (::WaitForMultipleObjects((DWORD)ReaderThreads.size(),&ReaderThreads[0],
+               TRUE,BATCHRIP_POLL_INTERVAL) == WAIT_TIMEOUT)
+        {
+            if (m_Progress.cancelled())
+                Cancel();
+        }
+    }
+
+    for (unsigned int i = 0; i < ReaderThreads.size(); i++)
+        ::CloseHandle(ReaderThreads[i]);
+
+    m_bReadersDone = true;
+    ::SetEvent(m_hEncodeEvent);
+
+    if (hEncoderThread != NULL)
+    {
+        ::WaitForSingleObject(hEncoderThread,INFINITE);
+        ::CloseHandle(hEncoderThread);
+    }
+
+    m_Progress.notify(ckcore::Progress::ckINFORMATION,lngGetString(INFO_RIPPEDDISCS),
+        m_uiDiscCount,m_lFailedCount);
+
+    if (m_Progress.cancelled() || m_lFailedCount > 0)
+        return BURNRESULT_EXTERNALERROR;
+
+    return BURNRESULT_OK;
+}
@@ -0,0 +1,188 @@
+/*
+ * InfraRecorder - CD/DVD burning software
+ * Copyright (C) 2006-2012 Christian Kindahl
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#include <vector>
+#include <deque>
+#include <ckcore/progress.hh>
+#include <ckmmc/device.hh>
+#include <base/codec_manager.hh>
+#include "core.hh"
+#include "advanced_progress.hh"
+
+#define BATCHRIP_POLL_INTERVAL			1000				// Milliseconds.
+#define BATCHRIP_MAX_TOC_INTERVAL		(16 * 1000)			// Milliseconds between reading the TOC of an idle reader.
+#define BATCHRIP_DISC_TIMEOUT			(10 * 60 * 1000)	// Milliseconds to wait for the next disc.
+#define BATCHRIP_STATE_FILENAME			_T("rip_state.xml")
+#define BATCHRIP_STATE_VERSION			1
+
+// Rips audio discs to a library folder using several readers at the same
+// time. Every reader runs its own cdda2wav process and rips one disc after
+// the other, the disc is ejected when done and the reader waits for the next
+// disc. Ripped tracks are queued to a single encoder shared by all readers.
+// The state of every track is stored in the folder of its disc so that a
+// cancelled or crashed batch continues where it stopped: tracks that have
+// been ripped are never read again, and tracks that were ripped but not
+// encoded are encoded when the batch is started again, even if their disc is
+// not inserted.
+class CBatchRip
+{
+private:
+    enum eTrackState
+    {
+        TS_PENDING,
+        TS_RIPPED,			// Waiting to be encoded.
+        TS_DONE
+    };
+
+    class CTrack
+    {
+    public:
+        unsigned char m_ucNumber;
+        eTrackState m_State;
+
+        CTrack(unsigned char ucNumber,eTrackState State) : m_ucNumber(ucNumber),
+            m_State(State)
+        {
+        }
+    };
+
+    // A disc in the library, identified by its table of contents.
+    class CDisc
+    {
+    public:
+        ckcore::tstring m_Id;
+        ckcore::tstring m_FolderPath;
+        std::vector<CTrack> m_Tracks;
+        bool m_bActive;
+
+        CDisc(const TCHAR *szId,const TCHAR *szFolderPath);
+
+        ckcore::tstring GetTrackPath(unsigned int uiIndex,const TCHAR *szFileExt) const;
+        unsigned int GetTrackCount(eTrackState State) const;
+
+        bool Load();
+        bool Save() const;
+    };
+
+    // Collects the progress of one reader and forwards it to the progress
+    // object of the batch, messages are prefixed with the reader name.
+    class CReader : public CAdvancedProgress
+    {
+    public:
+        CBatchRip &m_Owner;
+        ckmmc::Device &m_Device;
+        ckcore::tstring m_DeviceName;
+        CCore m_Core;
+
+        unsigned char m_ucPercent;
+
+        CReader(CBatchRip &Owner,ckmmc::Device &Device);
+
+        // ckcore::Progress.
+        void set_progress(unsigned char ucPercent);
+        void set_marquee(bool bMarquee);
+        void set_status(const TCHAR *szStatus,...);
+        void notify(ckcore::Progress::MessageType Type,const TCHAR *szMessage,...);
+        bool cancelled();
+
+        // CAdvancedProgress.
+        void NotifyCompleted();
+        void SetRealMode(bool bRealMode);
+        void SetBuffer(int iPercent);
+        void AllowReload();
+        void AllowCancel(bool bAllow);
+        bool RequestNextDisc();
+        void StartSmoke();
+    };
+
+    // Used by the encoder. The progress is reported by the readers so only
+    // messages and cancellation are passed on.
+    class CEncoderProgress : public ckcore::Progress
+    {
+    private:
+        CBatchRip &m_Owner;
+
+    public:
+        CEncoderProgress(CBatchRip &Owner);
+
+        void set_progress(unsigned char ucPercent);
+        void set_marquee(bool bMarquee);
+        void set_status(const TCHAR *szStatus,...);
+        void notify(ckcore::Progress::MessageType Type,const TCHAR *szMessage,...);
+        bool cancelled();
+    };
+
+    // The path of the ripped track is copied when the job is queued since
+    // the disc is shared with the readers.
+    class CEncodeJob
+    {
+    public:
+        CDisc *m_pDisc;
+        unsigned int m_uiTrack;
+        ckcore::tstring m_FilePath;
+
+        CEncodeJob(CDisc *pDisc,unsigned int uiTrack,const ckcore::tstring &FilePath) :
+            m_pDisc(pDisc),m_uiTrack(uiTrack),m_FilePath(FilePath)
+        {
+        }
+    };
+
+    CAdvancedProgress &m_Progress;
+    ckcore::tstring m_TargetPath;
+    CCodec *m_pEncoder;
+
+    std::vector<CReader *> m_Readers;
+    std::vector<CDisc *> m_Discs;
+    std::deque<CEncodeJob> m_EncodeQueue;
+    HANDLE m_hEncodeEvent;
+    volatile bool m_bReadersDone;
+
+    unsigned int m_uiDiscCount;
+    volatile LONG m_lFailedCount;
+
+    // Protects the discs, their state files and the encoder queue.
+    CRITICAL_SECTION m_csState;
+
+    // Protects the progress state of the readers.
+    CRITICAL_SECTION m_csProgress;
+
+    void UpdateProgress();
+    void Cancel();
+
+    void LoadDiscs();
+    CDisc *AcquireDisc(const TCHAR *szId,const std::vector<unsigned char> &AudioTracks);
+    void ReleaseDisc(CDisc *pDisc);
+    void SetTrackState(CDisc *pDisc,unsigned int uiTrack,eTrackState State);
+    void Enqueue(CDisc *pDisc,unsigned int uiTrack);
+
+    bool WaitForDisc(CReader *pReader,bool bInserted);
+    bool ReadDisc(ckmmc::Device &Device,ckcore::tstring &Id,
+        std::vector<unsigned char> &AudioTracks);
+    void RipDisc(CReader *pReader,const TCHAR *szId,const std::vector<unsigned char> &AudioTracks);
+
+    static DWORD WINAPI ReaderThread(LPVOID lpThreadParameter);
+    static DWORD WINAPI EncoderThread(LPVOID lpThreadParameter);
+
+public:
+    CBatchRip(const std::vector<ckmmc::Device *> &Devices,const TCHAR *szTargetPath,
+        CCodec *pEncoder,CAdvancedProgress &Progress);
+    ~CBatchRip();
+
+    eBurnResult Run();
+};
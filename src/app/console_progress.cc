@@ -0,0 +1,269 @@
+/*
+ * InfraRecorder - CD/DVD burning software
+ * Copyright (C) 2006-2012 Christian Kindahl
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "stdafx.hh"
+#include "console_progress.hh"
+
+CConsoleProgress *CConsoleProgress::m_pInstance = NULL;
+
+CConsoleProgress::CConsoleProgress() : m_pProcess(NULL),m_ucPercent(0),
+    m_iBuffer(-1),m_bCancelled(false)
+{
+    InitializeCriticalSection(&m_csOutput);
+
+    // GUI applications are not given a console. If the output has not been
+    // redirected we try to attach to the console of the parent process, this
+    // is only possible on Windows XP and newer.
+    m_hOutput = GetStdHandle(STD_OUTPUT_HANDLE);
+    if (m_hOutput == NULL || m_hOutput == INVALID_HANDLE_VALUE)
+    {
+        typedef BOOL (WINAPI *tAttachConsole)(DWORD dwProcessId);
+
+        HMODULE hKernel32 = GetModuleHandle(_T("KERNEL32.DLL"));
+        tAttachConsole pAttachConsole = hKernel32 != NULL ?
+            (tAttachConsole)GetProcAddress(hKernel32,"AttachConsole") : NULL;
+
+        if (pAttachConsole != NULL && pAttachConsole(CONSOLEPROGRESS_ATTACH_PARENT))
+        {
+            m_hOutput = CreateFile(_T("CONOUT$"),GENERIC_WRITE,FILE_SHARE_WRITE,
+                NULL,OPEN_EXISTING,0,NULL);
+        }
+    }
+
+    m_pInstance = this;
+    SetConsoleCtrlHandler(CtrlHandler,TRUE);
+}
+
+CConsoleProgress::~CConsoleProgress()
+{
+    SetConsoleCtrlHandler(CtrlHandler,FALSE);
+    m_pInstance = NULL;
+
+    DeleteCriticalSection(&m_csOutput);
+}
+
+BOOL WINAPI CConsoleProgress::CtrlHandler(DWORD dwCtrlType)
+{
+    switch (dwCtrlType)
+    {
+        case CTRL_C_EVENT:
+        case CTRL_BREAK_EVENT:
+        case CTRL_CLOSE_EVENT:
+            if (m_pInstance != NULL)
+            {
+                m_pInstance->Cancel();
+                return TRUE;
+            }
+            break;
+    }
+
+    return FALSE;
+}
+
+/*
+    CConsoleProgress::MakeField
+    ---------------------------
+    Fields and lines are delimited by tabs and new lines, those characters are
+    replaced by spaces in the text.
+*/
+void CConsoleProgress::MakeField(TCHAR *szText)
+{
+    for (TCHAR *pText = szText; *pText != '\0'; pText++)
+    {
+        if (*pText == '\t' || *pText == '\r' || *pText == '\n')
+            *pText = ' ';
+    }
+}
+
+void CConsoleProgress::WriteLine(const TCHAR *szLine)
+{
+    if (m_hOutput == NULL || m_hOutput == INVALID_HANDLE_VALUE)
+        return;
+
+    ckcore::tstring Line = szLine;
+    Line += _T("\r\n");
+
+    int iSize = WideCharToMultiByte(CP_UTF8,0,Line.c_str(),(int)Line.size(),NULL,0,NULL,NULL);
+    if (iSize <= 0)
+        return;
+
+    char *pBuffer = new char[iSize];
+    WideCharToMultiByte(CP_UTF8,0,Line.c_str(),(int)Line.size(),pBuffer,iSize,NULL,NULL);
+
+    // The progress is reported both by the job thread and the threads reading
+    // the output of the cdrtools processes.
+    EnterCriticalSection(&m_csOutput);
+
+    unsigned long ulWritten = 0;
+    WriteFile(m_hOutput,pBuffer,iSize,&ulWritten,NULL);
+
+    LeaveCriticalSection(&m_csOutput);
+
+    delete [] pBuffer;
+}
+
+void CConsoleProgress::AttachProcess(ckcore::Process *pProcess)
+{
+    m_pProcess = pProcess;
+}
+
+/*
+    CConsoleProgress::Cancel
+    ------------------------
+    Cancels the running operation. Unlike the progress window no confirmation
+    is requested when in real writing mode.
+*/
+void CConsoleProgress::Cancel()
+{
+    m_bCancelled = true;
+
+    if (m_pProcess != NULL)
+        m_pProcess->kill();
+}
+
+void CConsoleProgress::set_progress(unsigned char ucPercent)
+{
+    if (ucPercent > 100)
+        ucPercent = 100;
+
+    // Only report changes.
+    if (ucPercent == m_ucPercent)
+        return;
+
+    m_ucPercent = ucPercent;
+    Print(_T("progress\t%d"),ucPercent);
+}
+
+void CConsoleProgress::set_status(const TCHAR *szStatus,...)
+{
+    TCHAR szStringBuffer[PROGRESS_STRINGBUFFER_SIZE];
+
+    va_list args;
+    va_start(args,szStatus);
+
+    _vsnwprintf(szStringBuffer,PROGRESS_STRINGBUFFER_SIZE - 1,szStatus,args);
+    szStringBuffer[PROGRESS_STRINGBUFFER_SIZE - 1] = '\0';
+
+    va_end(args);
+
+    MakeField(szStringBuffer);
+    Print(_T("status\t%s"),szStringBuffer);
+}
+
+void CConsoleProgress::notify(ckcore::Progress::MessageType Type,const TCHAR *szMessage,...)
+{
+    TCHAR szStringBuffer[PROGRESS_STRINGBUFFER_SIZE];
+
+    va_list args;
+    va_start(args,szMessage);
+
+    _vsnwprintf(szStringBuffer,PROGRESS_STRINGBUFFER_SIZE - 1,szMessage,args);
+    szStringBuffer[PROGRESS_STRINGBUFFER_SIZE - 1] = '\0';
+
+    va_end(args);
+
+    const TCHAR *szType = _T("info");
+    switch (Type)
+    {
+        case ckcore::Progress::ckWARNING:
+            szType = _T("warning");
+            break;
+
+        case ckcore::Progress::ckERROR:
+            szType = _T("error");
+            break;
+
+        case ckcore::Progress::ckEXTERNAL:
+            szType = _T("external");
+            break;
+    }
+
+    MakeField(szStringBuffer);
+    Print(_T("message\t%s\t%s"),szType,szStringBuffer);
+}
+
+bool CConsoleProgress::cancelled()
+{
+    return m_bCancelled;
+}
+
+void CConsoleProgress::NotifyCompleted()
+{
+    WriteLine(_T("completed"));
+}
+
+void CConsoleProgress::SetRealMode(bool bRealMode)
+{
+}
+
+void CConsoleProgress::SetBuffer(int iPercent)
+{
+    if (iPercent == m_iBuffer)
+        return;
+
+    m_iBuffer = iPercent;
+    Print(_T("buffer\t%d"),iPercent);
+}
+
+/*
+    CConsoleProgress::AllowReload
+    -----------------------------
+    There is no one to reload the drive, we let cdrtools continue as if the
+    reload button had been pressed.
+*/
+void CConsoleProgress::AllowReload()
+{
+    WriteLine(_T("reload"));
+
+    if (m_pProcess != NULL)
+        m_pProcess->write("\r\n",2);
+}
+
+void CConsoleProgress::AllowCancel(bool bAllow)
+{
+}
+
+bool CConsoleProgress::RequestNextDisc()
+{
+    // Multiple copies requires user interaction.
+    return false;
+}
+
+void CConsoleProgress::StartSmoke()
+{
+}
+
+/*
+    CConsoleProgress::Print
+    -----------------------
+    Writes a formatted line. Fields must be separated by tab characters.
+*/
+void CConsoleProgress::Print(const TCHAR *szLine,...)
+{
+    TCHAR szStringBuffer[PROGRESS_STRINGBUFFER_SIZE];
+
+    va_list args;
+    va_start(args,szLine);
+
+    _vsnwprintf(szStringBuffer,PROGRESS_STRINGBUFFER_SIZE - 1,szLine,args);
+    szStringBuffer[PROGRESS_STRINGBUFFER_SIZE - 1] = '\0';
+
+    va_end(args);
+
+    WriteLine(szStringBuffer);
+}
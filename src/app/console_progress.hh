@@ -0,0 +1,76 @@
+/*
+ * InfraRecorder - CD/DVD burning software
+ * Copyright (C) 2006-2012 Christian Kindahl
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#include <ckcore/process.hh>
+#include "advanced_progress.hh"
+
+// Not defined when targeting Windows 2000.
+#define CONSOLEPROGRESS_ATTACH_PARENT	((DWORD)-1)
+
+// Reports progress to the standard output instead of a window. Each event is
+// written as one line of tab separated fields (UTF-8) so that the output can
+// be parsed by other programs:
+//   progress <percent>
+//   status <text>
+//   message <info|warning|error|external> <text>
+//   buffer <percent>
+//   reload
+//   completed
+class CConsoleProgress : public CAdvancedProgress
+{
+private:
+    HANDLE m_hOutput;
+    CRITICAL_SECTION m_csOutput;
+
+    ckcore::Process *m_pProcess;
+    unsigned char m_ucPercent;
+    int m_iBuffer;
+    volatile bool m_bCancelled;
+
+    // The console control handler does not take a context parameter.
+    static CConsoleProgress *m_pInstance;
+    static BOOL WINAPI CtrlHandler(DWORD dwCtrlType);
+
+    static void MakeField(TCHAR *szText);
+    void WriteLine(const TCHAR *szLine);
+
+public:
+    CConsoleProgress();
+    ~CConsoleProgress();
+
+    void AttachProcess(ckcore::Process *pProcess);
+    void Cancel();
+
+    // ckcore::Progress.
+    void set_progress(unsigned char ucPercent);
+    void set_status(const TCHAR *szStatus,...);
+    void notify(ckcore::Progress::MessageType Type,const TCHAR *szMessage,...);
+    bool cancelled();
+
+    // CAdvancedProgress.
+    void NotifyCompleted();
+    void SetRealMode(bool bRealMode);
+    void SetBuffer(int iPercent);
+    void AllowReload();
+    void AllowCancel(bool bAllow);
+    bool RequestNextDisc();
+    void StartSmoke();
+
+    void Print(const TCHAR *szLine,...);
+};
@@ -48,9 +48,9 @@ bool CProjectListViewDropTarget::OnDragOver(POINTL ptCursor)
     ScreenToClient(m_pHost->m_hWnd,&lvHit.pt);
 
     // See we're dragging above a folder, in that case highlight it.
-    int iTarget = m_pHost->HitTest(&lvHit);
-    if (iTarget != -1 && (((CItemData *)m_pHost->GetItemData(iTarget))->ucFlags & PROJECTITEM_FLAG_ISFOLDER))
-        m_pHost->SelectDropTarget(iTarget);
+    CItemData *pTargetItemData = g_TreeManager.GetListItem(m_pHost->HitTest(&lvHit));
+    if (pTargetItemData != NULL && (pTargetItemData->ucFlags & PROJECTITEM_FLAG_ISFOLDER))
+        m_pHost->SelectDropTarget(lvHit.iItem);
     else
         m_pHost->SelectDropTarget(-1);
 
@@ -69,13 +69,12 @@ bool CProjectListViewDropTarget::OnDrop(POINTL ptCursor,IDataObject *pDataObject
 
     CProjectNode *pTargetNode = NULL;
 
-    int iTarget = m_pHost->HitTest(&lvHit);
-    if (iTarget != -1 && (((CItemData *)m_pHost->GetItemData(iTarget))->ucFlags & PROJECTITEM_FLAG_ISFOLDER))
+    CItemData *pTargetItemData = g_TreeManager.GetListItem(m_pHost->HitTest(&lvHit));
+    if (pTargetItemData != NULL && (pTargetItemData->ucFlags & PROJECTITEM_FLAG_ISFOLDER))
     {
         m_pHost->SelectDropTarget(-1);
 
-        pTargetNode = g_TreeManager.ResolveNode(g_TreeManager.GetCurrentNode(),
-            (CItemData *)m_pHost->GetItemData(iTarget));
+        pTargetNode = g_TreeManager.ResolveNode(g_TreeManager.GetCurrentNode(),pTargetItemData);
     }
 
     // Handle the data.
@@ -166,14 +165,39 @@ bool CProjectListViewDropTarget::HandleDropData(IDataObject *pDataObject,CProjec
             if (lvHit.iItem == -1)
                 return true;
 
-            // Make sure that we can't drop a file above a folder.
-            CItemData *pDropItemData = (CItemData *)m_pHost->GetItemData(lvHit.iItem);
+            // Make sure that we can't drop a file above a folder, or above one
+            // of the files being moved.
+            CItemData *pDropItemData = g_TreeManager.GetListItem(lvHit.iItem);
 
-            while (pDropItemData->ucFlags & PROJECTITEM_FLAG_ISFOLDER)
-                pDropItemData = (CItemData *)m_pHost->GetItemData(++lvHit.iItem);
+            while (pDropItemData != NULL && ((pDropItemData->ucFlags & PROJECTITEM_FLAG_ISFOLDER) ||
+                   m_pHost->GetItemState(lvHit.iItem,LVIS_SELECTED)))
+            {
+                pDropItemData = g_TreeManager.GetListItem(++lvHit.iItem);
+            }
 
             CProjectNode *pCurrentNode = g_TreeManager.GetCurrentNode();
 
+            // Remove the selected items from the file list.
+            std::vector<CItemData *> MovedItems;
+
+            int iItemIndex = -1;
+            iItemIndex = m_pHost->GetNextItem(iItemIndex,LVNI_SELECTED);
+
+            while (iItemIndex != -1)
+            {
+                CItemData *pItemData = g_TreeManager.GetListItem(iItemIndex);
+                if (pItemData != NULL && !(pItemData->ucFlags & PROJECTITEM_FLAG_ISFOLDER))
+                {
+                    pCurrentNode->m_Files.remove(pItemData);
+                    MovedItems.push_back(pItemData);
+                }
+
+                iItemIndex = m_pHost->GetNextItem(iItemIndex,LVNI_SELECTED);
+            }
+
+            if (MovedItems.size() == 0)
+                return true;
+
             // Locate the dropped item (wee need an iterator so we know where to insert
             // the dropped files.
             std::list <CItemData *>::iterator itFileObject;
@@ -185,40 +209,20 @@ bool CProjectListViewDropTarget::HandleDropData(IDataObject *pDataObject,CProjec
                     break;
             }
 
-            // Move the selected items.
-            int iItemIndex = -1;
-            iItemIndex = m_pHost->GetNextItem(iItemIndex,LVNI_SELECTED);
+            pCurrentNode->m_Files.insert(itFileObject,MovedItems.begin(),MovedItems.end());
 
-            while (iItemIndex != -1)
+            // Update the list view and keep the moved items selected.
+            g_TreeManager.Refresh();
+
+            for (unsigned int i = 0; i < pCurrentNode->m_ListIndex.size(); i++)
             {
-                // Move the internal item data pointer.
-                CItemData *pItemData = (CItemData *)m_pHost->GetItemData(iItemIndex);
-
-                pCurrentNode->m_Files.remove(pItemData);
-                pCurrentNode->m_Files.insert(itFileObject,pItemData);
-
-                // Move the actual list item.
-                LVITEM lvi = { 0 };
-                lvi.iItem = iItemIndex;
-                lvi.iSubItem = 0;
-                lvi.pszText = LPSTR_TEXTCALLBACK;
-                lvi.stateMask = static_cast<unsigned int>(~LVIS_SELECTED);
-                lvi.mask = LVIF_TEXT | LVIF_IMAGE | LVIF_PARAM | LVIF_STATE;
-                m_pHost->GetItem(&lvi);
-
-                lvi.iItem = lvHit.iItem;
-
-                // Re-insert the item.
-                int iResult = m_pHost->InsertItem(&lvi);
-                if (lvi.iItem < iItemIndex)
-                    lvHit.iItem++;
-                if (iResult <= iItemIndex)
-                    iItemIndex++;
-
-                // Delete the old item.
-                m_pHost->DeleteItem(iItemIndex);
-
-                iItemIndex = m_pHost->GetNextItem(-1,LVNI_SELECTED);
+                if (pCurrentNode->m_ListIndex[i] == MovedItems[0])
+                {
+                    for (unsigned int j = 0; j < MovedItems.size(); j++)
+                        m_pHost->SetItemState(i + j,LVIS_SELECTED,LVIS_SELECTED);
+
+                    break;
+                }
             }
             /*
             */
@@ -319,7 +323,9 @@ LRESULT CProjectListViewCtrl::OnCustomDraw(UINT uMsg,WPARAM wParam,LPARAM lParam
             return CDRF_NOTIFYITEMDRAW;
 
         case CDDS_ITEMPREPAINT:
-            CItemData *pItemData = (CItemData *)lpNMCustomDraw->nmcd.lItemlParam;
+            CItemData *pItemData = g_TreeManager.GetListItem((int)lpNMCustomDraw->nmcd.dwItemSpec);
+            if (pItemData == NULL)
+                break;
 
             if (pItemData->ucFlags & PROJECTITEM_FLAG_ISIMPORTED)
             {
@@ -352,8 +358,9 @@ void CProjectListViewCtrl::BeginDrag(LPNMLISTVIEW pNMListView)
 
     while (iItemIndex != -1)
     {
-        CItemData *pItemData = (CItemData *)GetItemData(iItemIndex);
-        pDataObject->AddFile(pItemData);
+        CItemData *pItemData = g_TreeManager.GetListItem(iItemIndex);
+        if (pItemData != NULL)
+            pDataObject->AddFile(pItemData);
 
         iItemIndex = GetNextItem(iItemIndex,LVNI_SELECTED);
     }
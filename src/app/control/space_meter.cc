@@ -22,10 +22,13 @@
 #include "string_table.hh"
 #include "lang_util.hh"
 #include "version.hh"
+#include "settings.hh"
+#include "core2.hh"
 #include "space_meter.hh"
 
 CSpaceMeter::CSpaceMeter()
     : m_bIsUpdatePending( false )
+    , m_bIsAllocatedSizePending( false )
 {
     m_iMeterPosition = 0;
     m_iMeterSegmentSpacing = 0;
@@ -40,6 +43,8 @@ CSpaceMeter::CSpaceMeter()
     m_iDrawState = SPACEMETER_DRAWSTATE_NORMAL;
 
     m_uiAllocatedSize = 1;
+    m_uiExtraSize = 1;
+    m_uiDuplicateSize = 0;
     m_uiDiscSize = 1;
     m_uiMeterSize = 1;
 
@@ -319,6 +324,15 @@ void CSpaceMeter::UpdateToolTip()
         FormatInteger( uiFree, szFormattedInt, _countof( szFormattedInt ) );
         lsnprintf_s(szBuffer,64,_T(" (%s Bytes)"),szFormattedInt);
         m_ToolTipText += szBuffer;
+
+        // Saved by deduplication.
+        if (m_uiDuplicateSize > 0)
+        {
+            m_ToolTipText += _T("\r\n");
+            m_ToolTipText += lngGetString(SPACEMETER_DUPLICATES);
+            FormatBytes(szBuffer,m_uiDuplicateSize);
+            m_ToolTipText += szBuffer;
+        }
     }
     else
     {
@@ -457,21 +471,126 @@ void CSpaceMeter::SetDiscSize(unsigned int uiDiscSize)
 }
 
 
-void CSpaceMeter::SetAllocatedSize(unsigned __int64 uiAllocatedSize)
+/*
+    Schedules a recalculation of the total allocated size. The size is
+    calculated once per delayed update, or when it's requested, so that bulk
+    additions only pay for updating the layout.
+*/
+void CSpaceMeter::UpdateAllocatedSize()
 {
-    m_uiAllocatedSize = uiAllocatedSize;
+    m_bIsAllocatedSizePending = true;
 
     RequestDelayedUpdate();
 }
 
+/*
+    Recalculates the total allocated size if it has changed. The file system
+    layout is only applicable when displaying sizes in bytes.
+*/
+void CSpaceMeter::CalcAllocatedSize()
+{
+    if (!m_bIsAllocatedSizePending)
+        return;
+
+    m_bIsAllocatedSizePending = false;
+    m_uiAllocatedSize = m_uiExtraSize;
+
+    if (m_iDisplayMode == SPACEMETER_DMSIZE)
+    {
+        unsigned __int64 uiImageSize = 0;
+        if (!g_Core2.CalcImageSize(m_Layout,uiImageSize))
+            uiImageSize = m_Layout.GetDataSize();
+
+        m_uiAllocatedSize += uiImageSize;
+
+        if (m_uiDuplicateSize < m_uiAllocatedSize)
+            m_uiAllocatedSize -= m_uiDuplicateSize;
+    }
+}
+
+/**
+    Sets the allocated size and removes all files and folders from the file
+    system layout.
+*/
+void CSpaceMeter::SetAllocatedSize(unsigned __int64 uiAllocatedSize)
+{
+    m_Layout.Reset();
+    m_uiExtraSize = uiAllocatedSize;
+    m_uiDuplicateSize = 0;
+
+    UpdateAllocatedSize();
+}
+
 void CSpaceMeter::IncreaseAllocatedSize(unsigned __int64 uiSize)
 {
-    SetAllocatedSize(m_uiAllocatedSize + uiSize);
+    m_uiExtraSize += uiSize;
+
+    UpdateAllocatedSize();
 }
 
 void CSpaceMeter::DecreaseAllocatedSize(unsigned __int64 uiSize)
 {
-    SetAllocatedSize(m_uiAllocatedSize - uiSize);
+    m_uiExtraSize -= uiSize;
+
+    UpdateAllocatedSize();
+}
+
+/**
+    Adds a data file to the file system layout.
+    @param szFileName the file name in the disc image.
+    @param uiSize the file size in bytes.
+    @param bImported true if the file belongs to an imported session.
+*/
+void CSpaceMeter::AddFile(const TCHAR *szFileName,unsigned __int64 uiSize,bool bImported)
+{
+    m_Layout.AddFile(szFileName,uiSize,bImported);
+    m_uiDuplicateSize = 0;
+
+    UpdateAllocatedSize();
+}
+
+void CSpaceMeter::RemoveFile(const TCHAR *szFileName,unsigned __int64 uiSize,bool bImported)
+{
+    m_Layout.RemoveFile(szFileName,uiSize,bImported);
+    m_uiDuplicateSize = 0;
+
+    UpdateAllocatedSize();
+}
+
+void CSpaceMeter::AddFolder(const TCHAR *szFolderName)
+{
+    m_Layout.AddFolder(szFolderName);
+
+    UpdateAllocatedSize();
+}
+
+void CSpaceMeter::RemoveFolder(const TCHAR *szFolderName)
+{
+    m_Layout.RemoveFolder(szFolderName);
+    m_uiDuplicateSize = 0;
+
+    UpdateAllocatedSize();
+}
+
+/**
+    Should be called when the project file system settings have changed.
+*/
+void CSpaceMeter::UpdateFileSystem()
+{
+    UpdateAllocatedSize();
+}
+
+/**
+    Sets the number of bytes saved by storing identical files only once. The
+    saving is subtracted from the allocated size until the project contents
+    change.
+    @param uiSize the number of bytes saved.
+*/
+void CSpaceMeter::SetDuplicateSize(unsigned __int64 uiSize)
+{
+    m_uiDuplicateSize = g_ProjectSettings.m_bDeduplicate ? uiSize : 0;
+
+    UpdateAllocatedSize();
 }
 
 void CSpaceMeter::RequestDelayedUpdate()
@@ -493,6 +612,8 @@ LRESULT CSpaceMeter::OnDelayedUpdate(UINT uMsg,WPARAM wParam,LPARAM lParam,BOOL
     
     m_bIsUpdatePending = false;
 
+    CalcAllocatedSize();
+
     if (m_uiAllocatedSize > m_uiMeterSize)
         m_iDrawState = SPACEMETER_DRAWSTATE_OUTOFSCOPE;
     else if (m_uiAllocatedSize > m_uiDiscSize)
@@ -530,6 +651,8 @@ LRESULT CSpaceMeter::OnDelayedUpdate(UINT uMsg,WPARAM wParam,LPARAM lParam,BOOL
 
 unsigned __int64 CSpaceMeter::GetAllocatedSize()
 {
+    CalcAllocatedSize();
+
     return m_uiAllocatedSize;
 }
 
@@ -671,7 +794,7 @@ LRESULT CSpaceMeter::OnPopupMenuClick(UINT uNotifyCode,int nID,CWindow wnd)
     else
         SetDiscSize(nID + SPACEMETER_POPUPMENU_COUNT);
     
-    SetAllocatedSize(m_uiAllocatedSize);
+    UpdateAllocatedSize();
 
     return 0;
 }
\ No newline at end of file
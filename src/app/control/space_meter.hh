@@ -20,6 +20,7 @@
 #include <atlcrack.h>	// COMMAND_RANGE_HANDLER_EX
 #include "visual_styles.hh"
 #include "ctrl_messages.hh"
+#include <base/space_layout.hh>
 
 #define SPACEMETER_BAR_HEIGHT				10
 #define SPACEMETER_BARINDENT_NORMAL			2
@@ -115,7 +116,10 @@ private:
     int m_iDrawState;
 
     // The following values can be changed from the outside using public functions.
-    unsigned __int64 m_uiAllocatedSize;
+    unsigned __int64 m_uiAllocatedSize;		// m_uiExtraSize + image size of m_Layout.
+    unsigned __int64 m_uiExtraSize;			// Space not described by m_Layout (audio tracks, imported sessions).
+    unsigned __int64 m_uiDuplicateSize;		// Space saved by storing identical files only once.
+    CSpaceLayout m_Layout;
     unsigned __int64 m_uiDiscSize;
     unsigned __int64 m_uiMeterSize;			// How many bytes does the meter display.
 
@@ -131,10 +135,13 @@ private:
     void DrawFullBar(HDC hDC,RECT *pClientRect);
     void DrawMeter(HDC hDC,RECT *pClientRect,RECT *pBarRect);
 
+    void UpdateAllocatedSize();
+    void CalcAllocatedSize();
     void UpdateMeter(int iClientWidth);
     void UpdateToolTip();
 
     bool m_bIsUpdatePending;
+    bool m_bIsAllocatedSizePending;
 
 public:
     DECLARE_WND_CLASS(_T("ckSpaceMeter"));
@@ -149,6 +156,13 @@ public:
     void DecreaseAllocatedSize(unsigned __int64 uiSize);
     unsigned __int64 GetAllocatedSize();
 
+    void AddFile(const TCHAR *szFileName,unsigned __int64 uiSize,bool bImported);
+    void RemoveFile(const TCHAR *szFileName,unsigned __int64 uiSize,bool bImported);
+    void AddFolder(const TCHAR *szFolderName);
+    void RemoveFolder(const TCHAR *szFolderName);
+    void UpdateFileSystem();
+    void SetDuplicateSize(unsigned __int64 uiSize);
+
     void SetDisplayMode(int iDisplayMode);
     
     void Initialize();
@@ -0,0 +1,128 @@
+/*
+ * InfraRecorder - CD/DVD burning software
+ * Copyright (C) 2006-2012 Christian Kindahl
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#include <base/prefix_matcher.hh>
+#include "cdrtools_parse_strings.hh"
+
+// Identifies cdrtools output lines by their prefix. Replaces the strncmp
+// cascades against the strings in cdrtools_parse_strings.hh.
+class CCdrtoolsParser : public CPrefixMatcher
+{
+public:
+    enum eToken
+    {
+        TOKEN_NONE = PREFIXMATCHER_NOMATCH,
+        TOKEN_COPYRIGHT,
+        TOKEN_ERROR,
+        TOKEN_ERROR3,
+        TOKEN_ERROR4,
+        TOKEN_GRACEBEGIN,
+        TOKEN_NOMEDIA,
+        TOKEN_CYGWINPATH,
+        TOKEN_NOSUPPORT,
+        TOKEN_BLANK,
+        TOKEN_STARTCDWRITE,
+        TOKEN_BLANKTIME,
+        TOKEN_NODISC,
+        TOKEN_BLANKERROR,
+        TOKEN_BLANKUNSUP,
+        TOKEN_BLANKRETRY,
+        TOKEN_UNSUPPORTED,
+        TOKEN_SECTOR,
+        TOKEN_VERSIONINFO,
+        TOKEN_DVDINFO,
+        TOKEN_DVDGETINFO,
+        TOKEN_STARTTRACK,
+        TOKEN_WRITEPREGAP,
+        TOKEN_FILLFIFO,
+        TOKEN_WRITETIME,
+        TOKEN_FIXATE,
+        TOKEN_FIXATETIME,
+        TOKEN_WARNINGCAP,
+        TOKEN_WRITEERROR,
+        TOKEN_BADAUDIOCODING,
+        TOKEN_RELOADDRIVE,
+        TOKEN_TOTALTIME,
+        TOKEN_END,
+        TOKEN_ADDRESS,
+        TOKEN_IOERROR,
+        TOKEN_SECTORERROR,
+        TOKEN_RETRYSECTOR,
+        TOKEN_C2ERRORS,
+        TOKEN_PERCENTDONE,
+        TOKEN_FOUNDDVDMEDIA,
+        TOKEN_OPENSESSION,
+        TOKEN_DISCSPACEWARNING,
+        TOKEN_TURNINGBFON,
+        TOKEN_ERRORLEADIN,
+        TOKEN_ERRORINITDRIVE,
+        TOKEN_DVDRWDUMMY,
+        TOKEN_FIFO
+    };
+
+    CCdrtoolsParser()
+    {
+        Add(CDRTOOLS_COPYRIGHT,TOKEN_COPYRIGHT);
+        Add(CDRTOOLS_ERROR,TOKEN_ERROR);
+        Add(CDRTOOLS_ERROR3,TOKEN_ERROR3);
+        Add(CDRTOOLS_ERROR4,TOKEN_ERROR4);
+        Add(CDRTOOLS_GRACEBEGIN,TOKEN_GRACEBEGIN);
+        Add(CDRTOOLS_NOMEDIA,TOKEN_NOMEDIA);
+        Add(CDRTOOLS_CYGWINPATH,TOKEN_CYGWINPATH);
+        Add(CDRTOOLS_NOSUPPORT,TOKEN_NOSUPPORT);
+        Add(CDRTOOLS_BLANK,TOKEN_BLANK);
+        Add(CDRTOOLS_STARTCDWRITE,TOKEN_STARTCDWRITE);
+        Add(CDRTOOLS_BLANKTIME,TOKEN_BLANKTIME);
+        Add(CDRTOOLS_NODISC,TOKEN_NODISC);
+        Add(CDRTOOLS_BLANKERROR,TOKEN_BLANKERROR);
+        Add(CDRTOOLS_BLANKUNSUP,TOKEN_BLANKUNSUP);
+        Add(CDRTOOLS_BLANKRETRY,TOKEN_BLANKRETRY);
+        Add(CDRTOOLS_UNSUPPORTED,TOKEN_UNSUPPORTED);
+        Add(CDRTOOLS_SECTOR,TOKEN_SECTOR);
+        Add(CDRTOOLS_VERSIONINFO,TOKEN_VERSIONINFO);
+        Add(CDRTOOLS_DVDINFO,TOKEN_DVDINFO);
+        Add(CDRTOOLS_DVDGETINFO,TOKEN_DVDGETINFO);
+        Add(CDRTOOLS_STARTTRACK,TOKEN_STARTTRACK);
+        Add(CDRTOOLS_WRITEPREGAP,TOKEN_WRITEPREGAP);
+        Add(CDRTOOLS_FILLFIFO,TOKEN_FILLFIFO);
+        Add(CDRTOOLS_WRITETIME,TOKEN_WRITETIME);
+        Add(CDRTOOLS_FIXATE,TOKEN_FIXATE);
+        Add(CDRTOOLS_FIXATETIME,TOKEN_FIXATETIME);
+        Add(CDRTOOLS_WARNINGCAP,TOKEN_WARNINGCAP);
+        Add(CDRTOOLS_WRITEERROR,TOKEN_WRITEERROR);
+        Add(CDRTOOLS_BADAUDIOCODING,TOKEN_BADAUDIOCODING);
+        Add(CDRTOOLS_RELOADDRIVE,TOKEN_RELOADDRIVE);
+        Add(CDRTOOLS_TOTALTIME,TOKEN_TOTALTIME);
+        Add(CDRTOOLS_END,TOKEN_END);
+        Add(CDRTOOLS_ADDRESS,TOKEN_ADDRESS);
+        Add(CDRTOOLS_IOERROR,TOKEN_IOERROR);
+        Add(CDRTOOLS_SECTORERROR,TOKEN_SECTORERROR);
+        Add(CDRTOOLS_RETRYSECTOR,TOKEN_RETRYSECTOR);
+        Add(CDRTOOLS_C2ERRORS,TOKEN_C2ERRORS);
+        Add(CDRTOOLS_PERCENTDONE,TOKEN_PERCENTDONE);
+        Add(CDRTOOLS_FOUNDDVDMEDIA,TOKEN_FOUNDDVDMEDIA);
+        Add(CDRTOOLS_OPENSESSION,TOKEN_OPENSESSION);
+        Add(CDRTOOLS_DISCSPACEWARNING,TOKEN_DISCSPACEWARNING);
+        Add(CDRTOOLS_TURNINGBFON,TOKEN_TURNINGBFON);
+        Add(CDRTOOLS_ERRORLEADIN,TOKEN_ERRORLEADIN);
+        Add(CDRTOOLS_ERRORINITDRIVE,TOKEN_ERRORINITDRIVE);
+        Add(CDRTOOLS_DVDRWDUMMY,TOKEN_DVDRWDUMMY);
+        Add(CDRTOOLS_FIFO,TOKEN_FIFO);
+    }
+};
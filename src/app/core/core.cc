@@ -27,7 +27,9 @@
 #include "version.hh"
 #include "temp_manager.hh"
 #include "device_util.hh"
+#include "infrarecorder.hh"
 #include "core2.hh"
+#include "pipe_buffer.hh"
 #include "core.hh"
 
 // FIXME: How come Windows 95 supports larger command lines than Windows 2000?
@@ -115,6 +117,31 @@ void CCore::CreateBatchFile(const char *szChangeDir,const char *szCommandLine,TC
     StringContainer.SaveToFile(szBatchPath);
 }
 
+/*
+    CCore::ReportCommandLineError
+    -----------------------------
+    Tells the user that the command line is too long. Unattended jobs report
+    the error to the progress object since no message box may be displayed.
+*/
+void CCore::ReportCommandLineError(unsigned int uiMaxLength)
+{
+    TCHAR szMessage[256];
+    lsnprintf_s(szMessage,256,lngGetString(ERROR_COMMANDLINE),uiMaxLength);
+
+    if (g_GlobalSettings.m_bLog)
+        g_pLogDlg->print_line(_T("  Error: The command line is longer than %u characters."),uiMaxLength);
+
+    if (g_bJobMode)
+    {
+        if (m_pProgress != NULL)
+            m_pProgress->notify(ckcore::Progress::ckERROR,szMessage);
+    }
+    else
+    {
+        MessageBox(HWND_DESKTOP,szMessage,lngGetString(GENERAL_ERROR),MB_OK | MB_ICONERROR);
+    }
+}
+
 bool CCore::SafeLaunch(tstring &CommandLine,bool bWaitForProcess)
 {
     if (g_GlobalSettings.m_bLog)
@@ -138,9 +165,7 @@ bool CCore::SafeLaunch(tstring &CommandLine,bool bWaitForProcess)
             // sure if Windows 9x do. This needs to be checked.
             if (CommandLine.length() > 2047)
             {
-                TCHAR szMessage[256];
-                lsnprintf_s(szMessage,256,lngGetString(ERROR_COMMANDLINE),2048);
-                MessageBox(HWND_DESKTOP,szMessage,lngGetString(GENERAL_ERROR),MB_OK | MB_ICONERROR);
+                ReportCommandLineError(2048);
                 return false;
             }
 
@@ -186,9 +211,7 @@ bool CCore::SafeLaunch(tstring &CommandLine,bool bWaitForProcess)
         // Windows XP supports maximum 32768 characters.
         else if (CommandLine.length() > 32767)
         {
-            TCHAR szMessage[256];
-            lsnprintf_s(szMessage,256,lngGetString(ERROR_COMMANDLINE),2048);
-            MessageBox(HWND_DESKTOP,szMessage,lngGetString(GENERAL_ERROR),MB_OK | MB_ICONERROR);
+            ReportCommandLineError(2048);
             return false;
         }
     }
@@ -223,12 +246,12 @@ bool CCore::Relaunch()
     return false;
 }
 
-bool CCore::CheckGraceTime(const char *szBuffer)
+bool CCore::CheckGraceTime(const char *szBuffer,int iToken)
 {
     // If the message: Starting to write CD/DVD... is received we know that the 
     // grace count down time is about to start so we change the new line
     // delimiter to '.' since the gracetime is updated using the '\b' character.
-    if (!strncmp(szBuffer,CDRTOOLS_STARTCDWRITE,CDRTOOLS_STARTCDWRITE_LENGTH))
+    if (iToken == CCdrtoolsParser::TOKEN_STARTCDWRITE)
     {
         // Sometimes the "Starting to write CD/DVD..." string will reappear after the
         // grace time countdown. Because of that we only allow this delimiter change once.
@@ -237,7 +260,7 @@ bool CCore::CheckGraceTime(const char *szBuffer)
 
         return true;
     }
-    else if (!strncmp(szBuffer,CDRTOOLS_GRACEBEGIN,CDRTOOLS_GRACEBEGIN_LENGTH))
+    else if (iToken == CCdrtoolsParser::TOKEN_GRACEBEGIN)
     {
         m_iStatusMode = SMODE_GRACETIME;
 
@@ -257,9 +280,9 @@ bool CCore::CheckGraceTime(const char *szBuffer)
     return false;
 }
 
-bool CCore::CheckProgress(const char *szBuffer)
+bool CCore::CheckProgress(int iToken)
 {
-    if (!strncmp(szBuffer,CDRTOOLS_STARTTRACK,CDRTOOLS_STARTTRACK_LENGTH))
+    if (iToken == CCdrtoolsParser::TOKEN_STARTTRACK)
     {
         add_block_delim('.');
 
@@ -271,139 +294,185 @@ bool CCore::CheckProgress(const char *szBuffer)
     return false;
 }
 
+/*
+    CCore::ParseAddress
+    -------------------
+    Parses readcd progress lines on the format "addr: <address> cnt: <count>".
+*/
+bool CCore::ParseAddress(const char *szBuffer,unsigned __int64 &uiAddress,
+                         unsigned __int64 &uiCount)
+{
+    const char *pAddress = szBuffer + CDRTOOLS_ADDRESS_LENGTH;
+    char *pEnd = NULL;
+
+    uiAddress = _strtoui64(pAddress,&pEnd,10);
+    if (pEnd == pAddress)
+        return false;
+
+    while (*pEnd == ' ')
+        pEnd++;
+
+    if (strncmp(pEnd,"cnt:",4))
+        return false;
+
+    const char *pCount = pEnd + 4;
+    uiCount = _strtoui64(pCount,&pEnd,10);
+
+    return pEnd != pCount;
+}
+
 void CCore::ErrorOutputCDRECORD(const char *szBuffer)
 {
-    if (m_pProgress != NULL)
+    if (m_pProgress == NULL)
+        return;
+
+    switch (m_Parser.Match(szBuffer))
     {
-        if (!strncmp(szBuffer,CDRTOOLS_NOMEDIA,CDRTOOLS_NOMEDIA_LENGTH))
+        case CCdrtoolsParser::TOKEN_NOMEDIA:
             m_pProgress->notify(ckcore::Progress::ckERROR,lngGetString(FAILURE_NOMEDIA));
-        else if (!strncmp(szBuffer,CDRTOOLS_BLANKERROR,CDRTOOLS_BLANKERROR_LENGTH))
+            break;
+
+        case CCdrtoolsParser::TOKEN_BLANKERROR:
             m_pProgress->notify(ckcore::Progress::ckERROR,lngGetString(FAILURE_ERASE));
-        else if (!strncmp(szBuffer,CDRTOOLS_BLANKUNSUP,CDRTOOLS_BLANKUNSUP_LENGTH))
+            break;
+
+        case CCdrtoolsParser::TOKEN_BLANKUNSUP:
             m_pProgress->notify(ckcore::Progress::ckINFORMATION,lngGetString(INFO_UNSUPERASEMODE));
-        else if (!strncmp(szBuffer,CDRTOOLS_BLANKRETRY,CDRTOOLS_BLANKRETRY_LENGTH))
+            break;
+
+        case CCdrtoolsParser::TOKEN_BLANKRETRY:
             m_pProgress->notify(ckcore::Progress::ckINFORMATION,lngGetString(INFO_ERASERETRY));
-        else if (!strncmp(szBuffer,CDRTOOLS_NODISC,CDRTOOLS_NODISC_LENGTH))
+            break;
+
+        case CCdrtoolsParser::TOKEN_NODISC:
             m_pProgress->notify(ckcore::Progress::ckERROR,lngGetString(FAILURE_NOMEDIA));
-        else if (!strncmp(szBuffer,CDRTOOLS_BADAUDIOCODING,CDRTOOLS_BADAUDIOCODING_LENGTH))
-        {
-            TCHAR szMessage[MAX_PATH + 128];
-            lstrcpy(szMessage,lngGetString(FAILURE_AUDIOCODING));
+            break;
 
-            TCHAR szFileName[MAX_PATH + 3];
-            AnsiToUnicode(szFileName,szBuffer + CDRTOOLS_BADAUDIOCODING_LENGTH + 10,sizeof(szFileName) / sizeof(wchar_t));
-            lstrcat(szMessage,szFileName);
+        case CCdrtoolsParser::TOKEN_BADAUDIOCODING:
+            {
+                TCHAR szMessage[MAX_PATH + 128];
+                lstrcpy(szMessage,lngGetString(FAILURE_AUDIOCODING));
 
-            m_pProgress->notify(ckcore::Progress::ckERROR,szMessage);
-        }
-        else if (!strncmp(szBuffer,CDRTOOLS_UNSUPPORTED,CDRTOOLS_UNSUPPORTED_LENGTH))
-        {
-            char *pBuffer = (char *)szBuffer + 12;
+                TCHAR szFileName[MAX_PATH + 3];
+                AnsiToUnicode(szFileName,szBuffer + CDRTOOLS_BADAUDIOCODING_LENGTH + 10,sizeof(szFileName) / sizeof(wchar_t));
+                lstrcat(szMessage,szFileName);
+
+                m_pProgress->notify(ckcore::Progress::ckERROR,szMessage);
+            }
+            break;
 
-            if (!strncmp(pBuffer,CDRTOOLS_SECTOR,CDRTOOLS_SECTOR_LENGTH))
+        case CCdrtoolsParser::TOKEN_UNSUPPORTED:
             {
-                int iSectorSize = 0;
-                sscanf(pBuffer,"sector size %ld for %*[^\0]",&iSectorSize);
+                char *pBuffer = (char *)szBuffer + 12;
+
+                if (m_Parser.Match(pBuffer) == CCdrtoolsParser::TOKEN_SECTOR)
+                {
+                    int iSectorSize = 0;
+                    sscanf(pBuffer,"sector size %ld for %*[^\0]",&iSectorSize);
 
-                m_pProgress->notify(ckcore::Progress::ckERROR,lngGetString(FAILURE_BADSECTORSIZE),iSectorSize);
+                    m_pProgress->notify(ckcore::Progress::ckERROR,lngGetString(FAILURE_BADSECTORSIZE),iSectorSize);
+                }
             }
-        }
-        else if (!strncmp(szBuffer,CDRTOOLS_WRITEERROR,CDRTOOLS_WRITEERROR_LENGTH))
-        {
+            break;
+
+        case CCdrtoolsParser::TOKEN_WRITEERROR:
             m_pProgress->notify(ckcore::Progress::ckERROR,lngGetString(FAILURE_WRITE));
-        }
+            break;
+
+        case CCdrtoolsParser::TOKEN_FOUNDDVDMEDIA:
 #ifndef CORE_DVD_SUPPORT
-        else if (!strncmp(szBuffer,CDRTOOLS_FOUNDDVDMEDIA,CDRTOOLS_FOUNDDVDMEDIA_LENGTH))
-        {
             m_pProgress->notify(ckcore::Progress::ckWARNING,lngGetString(FAILURE_DVDSUPPORT));
-        }
 #endif
-        else if (!strncmp(szBuffer,CDRTOOLS_OPENSESSION,CDRTOOLS_OPENSESSION_LENGTH))
-        {
+            break;
+
+        case CCdrtoolsParser::TOKEN_OPENSESSION:
             m_pProgress->notify(ckcore::Progress::ckERROR,lngGetString(FAILURE_OPENSESSION));
-        }
-        else if (!strncmp(szBuffer,CDRTOOLS_WARNINGCAP,CDRTOOLS_WARNINGCAP_LENGTH))	// "WARNING:" Prefix.
-        {
-            char *pBuffer = (char *)szBuffer + CDRTOOLS_WARNINGCAP_LENGTH + 1;
+            break;
 
-            if (!strncmp(pBuffer,CDRTOOLS_DISCSPACEWARNING,CDRTOOLS_DISCSPACEWARNING_LENGTH))
-                m_pProgress->notify(ckcore::Progress::ckWARNING,lngGetString(WARNING_DISCSIZE));
-        }
-        else if (!strncmp(szBuffer,CDRTOOLS_ERRORLEADIN,CDRTOOLS_ERRORLEADIN_LENGTH))
-        {
+        case CCdrtoolsParser::TOKEN_WARNINGCAP:	// "WARNING:" Prefix.
+            {
+                char *pBuffer = (char *)szBuffer + CDRTOOLS_WARNINGCAP_LENGTH + 1;
+
+                if (m_Parser.Match(pBuffer) == CCdrtoolsParser::TOKEN_DISCSPACEWARNING)
+                    m_pProgress->notify(ckcore::Progress::ckWARNING,lngGetString(WARNING_DISCSIZE));
+            }
+            break;
+
+        case CCdrtoolsParser::TOKEN_ERRORLEADIN:
             m_pProgress->notify(ckcore::Progress::ckERROR,lngGetString(FAILURE_WRITELEADIN));
 
             // When called from BurnTracks/BurnCompilation we need to flag the operation as failed.
             m_bOperationRes = false;
-        }
-        else if (!strncmp(szBuffer,CDRTOOLS_ERRORINITDRIVE,CDRTOOLS_ERRORINITDRIVE_LENGTH))
-        {
+            break;
+
+        case CCdrtoolsParser::TOKEN_ERRORINITDRIVE:
             m_pProgress->notify(ckcore::Progress::ckERROR,lngGetString(FAILURE_INITDRIVE));
 
             // When called from BurnTracks/BurnCompilation we need to flag the operation as failed.
             m_bOperationRes = false;
-        }
-        else if (!strncmp(szBuffer,CDRTOOLS_DVDRWDUMMY,CDRTOOLS_DVDRWDUMMY_LENGTH))
-        {
+            break;
+
+        case CCdrtoolsParser::TOKEN_DVDRWDUMMY:
             m_pProgress->notify(ckcore::Progress::ckERROR,lngGetString(FAILURE_DVDRWDUMMY));
 
             // When called from BurnTracks/BurnCompilation we need to flag the operation as failed.
             m_bOperationRes = false;
-        }
+            break;
+
 #ifdef CORE_IGNORE_ERRORINFOMESSAGES		// Ingore error information messages.
-        else if (!strncmp(szBuffer,CDRTOOLS_VERSIONINFO,CDRTOOLS_VERSIONINFO_LENGTH))
-            return;
-        else if (!strncmp(szBuffer,CDRTOOLS_DVDINFO,CDRTOOLS_DVDINFO_LENGTH))
-            return;
-        else if (!strncmp(szBuffer,CDRTOOLS_DVDGETINFO,CDRTOOLS_DVDGETINFO_LENGTH))
-            return;
+        case CCdrtoolsParser::TOKEN_VERSIONINFO:
+        case CCdrtoolsParser::TOKEN_DVDINFO:
+        case CCdrtoolsParser::TOKEN_DVDGETINFO:
+            break;
 #endif
+
+        case CCdrtoolsParser::TOKEN_TURNINGBFON:
+        case CCdrtoolsParser::TOKEN_FIFO:
+            break;
+
+        default:
 #ifdef CORE_PRINT_UNSUPERRORMESSAGES		// Print unhandled messages from cdrecord to the log window.
-    #ifdef CORE_DVD_SUPPORT
-        else if (!strncmp(szBuffer,CDRTOOLS_FOUNDDVDMEDIA,CDRTOOLS_FOUNDDVDMEDIA_LENGTH))
-            return;
-    #endif
-        else if (!strncmp(szBuffer,CDRTOOLS_TURNINGBFON,CDRTOOLS_TURNINGBFON_LENGTH))
-            return;
-        else if (!strncmp(szBuffer,CDRTOOLS_FIFO,CDRTOOLS_FIFO_LENGTH))
-            return;
-        else
-        {
             m_pProgress->notify(ckcore::Progress::ckEXTERNAL,
                                 ckcore::string::ansi_to_auto<1024>(szBuffer).c_str());
-        }
 #endif
+            break;
     }
 }
 
 void CCore::ErrorOutputREADCD(const char *szBuffer)
 {
-    if (m_pProgress != NULL)
+    if (m_pProgress == NULL)
+        return;
+
+    switch (m_Parser.Match(szBuffer))
     {
-        if (!strncmp(szBuffer,CDRTOOLS_IOERROR,CDRTOOLS_IOERROR_LENGTH))
-        {
-            char *pBuffer = (char *)szBuffer + CDRTOOLS_IOERROR_LENGTH;
+        case CCdrtoolsParser::TOKEN_IOERROR:
+            {
+                char *pBuffer = (char *)szBuffer + CDRTOOLS_IOERROR_LENGTH;
+
+                if (m_Parser.Match(pBuffer) == CCdrtoolsParser::TOKEN_SECTORERROR)
+                {
+                    unsigned long ulSector = atoi(pBuffer + CDRTOOLS_SECTORERROR_LENGTH + 1);
+        
+                    m_pProgress->notify(ckcore::Progress::ckWARNING,lngGetString(ERROR_SECTOR),ulSector);
+                }
+            }
+            break;
 
-            if (!strncmp(pBuffer,CDRTOOLS_SECTORERROR,CDRTOOLS_SECTORERROR_LENGTH))
+        case CCdrtoolsParser::TOKEN_RETRYSECTOR:
             {
-                unsigned long ulSector = atoi(pBuffer + CDRTOOLS_SECTORERROR_LENGTH + 1);
-    
-                m_pProgress->notify(ckcore::Progress::ckWARNING,lngGetString(ERROR_SECTOR),ulSector);
+                unsigned long ulSector = atoi(szBuffer + CDRTOOLS_RETRYSECTOR_LENGTH + 1);
+
+                m_pProgress->notify(ckcore::Progress::ckERROR,lngGetString(FAILURE_READSOURCEDISC),ulSector);
             }
-        }
-        else if (!strncmp(szBuffer,CDRTOOLS_RETRYSECTOR,CDRTOOLS_RETRYSECTOR_LENGTH))
-        {
-            unsigned long ulSector = atoi(szBuffer + CDRTOOLS_RETRYSECTOR_LENGTH + 1);
+            break;
 
-            m_pProgress->notify(ckcore::Progress::ckERROR,lngGetString(FAILURE_READSOURCEDISC),ulSector);
-        }
+        default:
 #ifdef CORE_PRINT_UNSUPERRORMESSAGES
-        else
-        {
             m_pProgress->notify(ckcore::Progress::ckEXTERNAL,
                                 ckcore::string::ansi_to_auto<1024>(szBuffer).c_str());
-        }
 #endif
+            break;
     }
 }
 
@@ -411,129 +480,137 @@ void CCore::ErrorOutputCDDA2WAV(const char *szBuffer)
 {
 }
 
-void CCore::EraseOutput(const char *szBuffer)
+void CCore::EraseOutput(const char *szBuffer,int iToken)
 {
-    // Check if the media or command is not supported by the drive.
-    if (!strncmp(szBuffer,CDRTOOLS_NOSUPPORT,CDRTOOLS_NOSUPPORT_LENGTH))
-    {
-        char *pBuffer = (char *)szBuffer + 42;
-
-        if (!strncmp(pBuffer,CDRTOOLS_BLANK,CDRTOOLS_BLANK_LENGTH))
-            m_pProgress->notify(ckcore::Progress::ckERROR,lngGetString(FAILURE_UNSUPRW));
-    }
-    else if (CheckGraceTime(szBuffer))
-    {
+    if (CheckGraceTime(szBuffer,iToken))
         return;
-    }
-    else if (!strncmp(szBuffer,CDRTOOLS_BLANKTIME,CDRTOOLS_BLANKTIME_LENGTH))
-    {
-        m_pProgress->notify(ckcore::Progress::ckINFORMATION,lngGetString(SUCCESS_ERASE));
-    }
-    else if (!strncmp(szBuffer,CDRTOOLS_RELOADDRIVE,CDRTOOLS_RELOADDRIVE_LENGTH))
+
+    switch (iToken)
     {
-        m_pProgress->notify(ckcore::Progress::ckWARNING,lngGetString(FAILURE_LOADDRIVE));
-        m_pProgress->set_status(lngGetString(ERROR_RELOADDRIVE));
+        // Check if the media or command is not supported by the drive.
+        case CCdrtoolsParser::TOKEN_NOSUPPORT:
+            if (m_Parser.Match(szBuffer + 42) == CCdrtoolsParser::TOKEN_BLANK)
+                m_pProgress->notify(ckcore::Progress::ckERROR,lngGetString(FAILURE_UNSUPRW));
+            break;
+
+        case CCdrtoolsParser::TOKEN_BLANKTIME:
+            m_pProgress->notify(ckcore::Progress::ckINFORMATION,lngGetString(SUCCESS_ERASE));
+            break;
+
+        case CCdrtoolsParser::TOKEN_RELOADDRIVE:
+            m_pProgress->notify(ckcore::Progress::ckWARNING,lngGetString(FAILURE_LOADDRIVE));
+            m_pProgress->set_status(lngGetString(ERROR_RELOADDRIVE));
 
-        // Enable the reload button.
-        m_pProgress->AllowReload();
+            // Enable the reload button.
+            m_pProgress->AllowReload();
+            break;
     }
 }
 
-void CCore::FixateOutput(const char *szBuffer)
+void CCore::FixateOutput(const char *szBuffer,int iToken)
 {
-    if (CheckGraceTime(szBuffer))
-    {
+    if (CheckGraceTime(szBuffer,iToken))
         return;
-    }
-    else if (!strncmp(szBuffer,CDRTOOLS_FIXATETIME,CDRTOOLS_FIXATETIME_LENGTH))
-    {
-        m_pProgress->notify(ckcore::Progress::ckINFORMATION,lngGetString(SUCCESS_FIXATE));
-    }
-    else if (!strncmp(szBuffer,CDRTOOLS_RELOADDRIVE,CDRTOOLS_RELOADDRIVE_LENGTH))
+
+    switch (iToken)
     {
-        m_pProgress->notify(ckcore::Progress::ckWARNING,lngGetString(FAILURE_LOADDRIVE));
-        m_pProgress->set_status(lngGetString(ERROR_RELOADDRIVE));
+        case CCdrtoolsParser::TOKEN_FIXATETIME:
+            m_pProgress->notify(ckcore::Progress::ckINFORMATION,lngGetString(SUCCESS_FIXATE));
+            break;
+
+        case CCdrtoolsParser::TOKEN_RELOADDRIVE:
+            m_pProgress->notify(ckcore::Progress::ckWARNING,lngGetString(FAILURE_LOADDRIVE));
+            m_pProgress->set_status(lngGetString(ERROR_RELOADDRIVE));
 
-        // Enable the reload button.
-        m_pProgress->AllowReload();
+            // Enable the reload button.
+            m_pProgress->AllowReload();
+            break;
     }
 }
 
-void CCore::BurnImageOutput(const char *szBuffer)
+void CCore::BurnImageOutput(const char *szBuffer,int iToken)
 {
-    if (CheckGraceTime(szBuffer))
+    if (CheckGraceTime(szBuffer,iToken))
         return;
 
-    if (CheckProgress(szBuffer))
+    if (CheckProgress(iToken))
         return;
 
-    if (!strncmp(szBuffer,CDRTOOLS_WRITEPREGAP,CDRTOOLS_WRITEPREGAP_LENGTH))
+    switch (iToken)
     {
-        int iTrack = 0;
-        long lPos = 0;
-        sscanf(szBuffer,"Writing pregap for track %d at %ld",&iTrack,&lPos);
+        case CCdrtoolsParser::TOKEN_WRITEPREGAP:
+            {
+                int iTrack = 0;
+                long lPos = 0;
+                sscanf(szBuffer,"Writing pregap for track %d at %ld",&iTrack,&lPos);
 
-        TCHAR szStatus[64];
-        lsnprintf_s(szStatus,64,lngGetString(STATUS_WRITEPREGAP),iTrack,lPos);
-        m_pProgress->set_status(szStatus);
-    }
-    else if (!strncmp(szBuffer,CDRTOOLS_FILLFIFO,CDRTOOLS_FILLFIFO_LENGTH))
-    {
-        m_pProgress->set_status(lngGetString(STATUS_FILLBUFFER));
-    }
-    else if (!strncmp(szBuffer,CDRTOOLS_WRITETIME,CDRTOOLS_WRITETIME_LENGTH))
-    {
-        // Only display the error message if no error occured.
-        if (m_bOperationRes)
-            m_pProgress->notify(ckcore::Progress::ckINFORMATION,lngGetString(SUCCESS_WRITE));
-    }
-    else if (!strncmp(szBuffer,CDRTOOLS_FIXATE,CDRTOOLS_FIXATE_LENGTH))
-    {
-        m_pProgress->set_status(lngGetString(STATUS_FIXATE));
-    }
-    else if (!strncmp(szBuffer,CDRTOOLS_FIXATETIME,CDRTOOLS_FIXATETIME_LENGTH))
-    {
-        m_pProgress->notify(ckcore::Progress::ckINFORMATION,lngGetString(SUCCESS_FIXATE));
-    }
-    else if (!strncmp(szBuffer,CDRTOOLS_WARNINGCAP,CDRTOOLS_WARNINGCAP_LENGTH))
-    {
-        m_pProgress->notify(ckcore::Progress::ckWARNING,lngGetString(WARNING_FIXATE));
-    }
-    else if (!strncmp(szBuffer,CDRTOOLS_RELOADDRIVE,CDRTOOLS_RELOADDRIVE_LENGTH))
-    {
-        m_pProgress->notify(ckcore::Progress::ckWARNING,lngGetString(FAILURE_LOADDRIVE));
-        m_pProgress->set_status(lngGetString(ERROR_RELOADDRIVE));
+                TCHAR szStatus[64];
+                lsnprintf_s(szStatus,64,lngGetString(STATUS_WRITEPREGAP),iTrack,lPos);
+                m_pProgress->set_status(szStatus);
+            }
+            break;
+
+        case CCdrtoolsParser::TOKEN_FILLFIFO:
+            m_pProgress->set_status(lngGetString(STATUS_FILLBUFFER));
+            break;
+
+        case CCdrtoolsParser::TOKEN_WRITETIME:
+            // Only display the error message if no error occured.
+            if (m_bOperationRes)
+                m_pProgress->notify(ckcore::Progress::ckINFORMATION,lngGetString(SUCCESS_WRITE));
+            break;
+
+        case CCdrtoolsParser::TOKEN_FIXATE:
+            m_pProgress->set_status(lngGetString(STATUS_FIXATE));
+            break;
+
+        case CCdrtoolsParser::TOKEN_FIXATETIME:
+            m_pProgress->notify(ckcore::Progress::ckINFORMATION,lngGetString(SUCCESS_FIXATE));
+            break;
+
+        case CCdrtoolsParser::TOKEN_WARNINGCAP:
+            m_pProgress->notify(ckcore::Progress::ckWARNING,lngGetString(WARNING_FIXATE));
+            break;
+
+        case CCdrtoolsParser::TOKEN_RELOADDRIVE:
+            m_pProgress->notify(ckcore::Progress::ckWARNING,lngGetString(FAILURE_LOADDRIVE));
+            m_pProgress->set_status(lngGetString(ERROR_RELOADDRIVE));
 
-        // Enable the reload button.
-        m_pProgress->AllowReload();
+            // Enable the reload button.
+            m_pProgress->AllowReload();
+            break;
     }
 }
 
-void CCore::ReadDataTrackOutput(const char *szBuffer)
+void CCore::ReadDataTrackOutput(const char *szBuffer,int iToken)
 {
-    if (!strncmp(szBuffer,CDRTOOLS_END,CDRTOOLS_END_LENGTH))
-    {
-        m_pProgress->notify(ckcore::Progress::ckINFORMATION,lngGetString(PROGRESS_BEGINREADTRACK),m_TrackSize[1]);
-        m_pProgress->set_status(lngGetString(STATUS_READTRACK));
-    }
-    else if (!strncmp(szBuffer,CDRTOOLS_ADDRESS,CDRTOOLS_ADDRESS_LENGTH))
+    switch (iToken)
     {
-        unsigned __int64 uiAddress = 0;
-        unsigned __int64 uiCount = 0;
+        case CCdrtoolsParser::TOKEN_END:
+            m_pProgress->notify(ckcore::Progress::ckINFORMATION,lngGetString(PROGRESS_BEGINREADTRACK),m_TrackSize[1]);
+            m_pProgress->set_status(lngGetString(STATUS_READTRACK));
+            break;
 
-        if (sscanf(szBuffer,"addr: %8ld cnt: %ld",&uiAddress,&uiCount) == 2)
-            m_pProgress->set_progress((unsigned char)(((double)(uiAddress - m_TrackSize[0])/m_uiTotalSize) * 100));
-    }
-    else if (!strncmp(szBuffer,CDRTOOLS_TOTALTIME,CDRTOOLS_TOTALTIME_LENGTH))
-    {
-        m_pProgress->notify(ckcore::Progress::ckINFORMATION,lngGetString(SUCCESS_READTRACK),m_TrackSize[1]);
-        m_bOperationRes = true;			// Success.
+        case CCdrtoolsParser::TOKEN_ADDRESS:
+            {
+                unsigned __int64 uiAddress = 0;
+                unsigned __int64 uiCount = 0;
+
+                if (ParseAddress(szBuffer,uiAddress,uiCount))
+                    m_pProgress->set_progress((unsigned char)(((double)(uiAddress - m_TrackSize[0])/m_uiTotalSize) * 100));
+            }
+            break;
+
+        case CCdrtoolsParser::TOKEN_TOTALTIME:
+            m_pProgress->notify(ckcore::Progress::ckINFORMATION,lngGetString(SUCCESS_READTRACK),m_TrackSize[1]);
+            m_bOperationRes = true;			// Success.
+            break;
     }
 }
 
-void CCore::ReadAudioTrackOutput(const char *szBuffer)
+void CCore::ReadAudioTrackOutput(const char *szBuffer,int iToken)
 {
-    if (!strncmp(szBuffer,CDRTOOLS_PERCENTDONE,CDRTOOLS_PERCENTDONE_LENGTH))
+    if (iToken == CCdrtoolsParser::TOKEN_PERCENTDONE)
     {
         m_pProgress->notify(ckcore::Progress::ckINFORMATION,lngGetString(PROGRESS_BEGINREADTRACK),m_uiTotalSize);
         m_pProgress->set_status(lngGetString(STATUS_READTRACK));
@@ -542,78 +619,88 @@ void CCore::ReadAudioTrackOutput(const char *szBuffer)
     }
 }
 
-void CCore::ScanTrackOutput(const char *szBuffer)
+void CCore::ScanTrackOutput(const char *szBuffer,int iToken)
 {
-    if (!strncmp(szBuffer,CDRTOOLS_END,CDRTOOLS_END_LENGTH))
-    {
-        m_pProgress->notify(ckcore::Progress::ckINFORMATION,lngGetString(PROGRESS_BEGINSCANTRACK),m_TrackSize[1]);
-        m_pProgress->set_status(lngGetString(STATUS_SCANTRACK));
-    }
-    else if (!strncmp(szBuffer,CDRTOOLS_ADDRESS,CDRTOOLS_ADDRESS_LENGTH))
+    switch (iToken)
     {
-        unsigned __int64 uiAddress = 0;
-        unsigned __int64 uiCount = 0;
+        case CCdrtoolsParser::TOKEN_END:
+            m_pProgress->notify(ckcore::Progress::ckINFORMATION,lngGetString(PROGRESS_BEGINSCANTRACK),m_TrackSize[1]);
+            m_pProgress->set_status(lngGetString(STATUS_SCANTRACK));
+            break;
 
-        if (sscanf(szBuffer,"addr: %8ld cnt: %ld",&uiAddress,&uiCount) == 2)
-            m_pProgress->set_progress((unsigned char)(((double)(uiAddress - m_TrackSize[0])/m_uiTotalSize) * 100));
-    }
-    else if (!strncmp(szBuffer,CDRTOOLS_TOTALTIME,CDRTOOLS_TOTALTIME_LENGTH))
-    {
-        m_pProgress->notify(ckcore::Progress::ckINFORMATION,lngGetString(SUCCESS_SCANTRACK),m_TrackSize[1]);
-        m_bOperationRes = true;			// Success.
-    }
-    else if (!strncmp(szBuffer,CDRTOOLS_C2ERRORS,CDRTOOLS_C2ERRORS_LENGTH))
-    {
-        char *pBuffer = (char *)szBuffer + CDRTOOLS_C2ERRORS_LENGTH;
+        case CCdrtoolsParser::TOKEN_ADDRESS:
+            {
+                unsigned __int64 uiAddress = 0;
+                unsigned __int64 uiCount = 0;
 
-        if (!strncmp(pBuffer,"total",5))
-        {
-            unsigned long ulBytes = 0;
-            unsigned long ulSectors = 0;
+                if (ParseAddress(szBuffer,uiAddress,uiCount))
+                    m_pProgress->set_progress((unsigned char)(((double)(uiAddress - m_TrackSize[0])/m_uiTotalSize) * 100));
+            }
+            break;
 
-            if (sscanf(pBuffer + 7,"%ld bytes in %d sectors on disk",&ulBytes,&ulSectors) == 2)
+        case CCdrtoolsParser::TOKEN_TOTALTIME:
+            m_pProgress->notify(ckcore::Progress::ckINFORMATION,lngGetString(SUCCESS_SCANTRACK),m_TrackSize[1]);
+            m_bOperationRes = true;			// Success.
+            break;
+
+        case CCdrtoolsParser::TOKEN_C2ERRORS:
             {
-                m_pProgress->notify(ulSectors > 0 ? ckcore::Progress::ckWARNING : ckcore::Progress::ckINFORMATION,
-                    lngGetString(STATUS_C2TOTAL),ulBytes,ulBytes);
-            }
-        }
-        else if (!strncmp(pBuffer,"rate",4))
-        {
-            float fRate = (float)atof(pBuffer + 6);
+                char *pBuffer = (char *)szBuffer + CDRTOOLS_C2ERRORS_LENGTH;
 
-            m_pProgress->notify(fRate > 0 ? ckcore::Progress::ckWARNING : ckcore::Progress::ckINFORMATION,
-                lngGetString(STATUS_C2RATE),fRate);
-        }
+                if (!strncmp(pBuffer,"total",5))
+                {
+                    unsigned long ulBytes = 0;
+                    unsigned long ulSectors = 0;
+
+                    if (sscanf(pBuffer + 7,"%ld bytes in %d sectors on disk",&ulBytes,&ulSectors) == 2)
+                    {
+                        m_pProgress->notify(ulSectors > 0 ? ckcore::Progress::ckWARNING : ckcore::Progress::ckINFORMATION,
+                            lngGetString(STATUS_C2TOTAL),ulBytes,ulBytes);
+                    }
+                }
+                else if (!strncmp(pBuffer,"rate",4))
+                {
+                    float fRate = (float)atof(pBuffer + 6);
+
+                    m_pProgress->notify(fRate > 0 ? ckcore::Progress::ckWARNING : ckcore::Progress::ckINFORMATION,
+                        lngGetString(STATUS_C2RATE),fRate);
+                }
+            }
+            break;
     }
 }
 
-void CCore::ReadDiscOutput(const char *szBuffer)
+void CCore::ReadDiscOutput(const char *szBuffer,int iToken)
 {
-    if (!strncmp(szBuffer,CDRTOOLS_END,CDRTOOLS_END_LENGTH))
+    switch (iToken)
     {
-        m_pProgress->notify(ckcore::Progress::ckINFORMATION,lngGetString(PROGRESS_BEGINREADDISC));
-        m_pProgress->set_status(lngGetString(STATUS_READDISC));
+        case CCdrtoolsParser::TOKEN_END:
+            m_pProgress->notify(ckcore::Progress::ckINFORMATION,lngGetString(PROGRESS_BEGINREADDISC));
+            m_pProgress->set_status(lngGetString(STATUS_READDISC));
 
-        // Update the total number of sectors to process.
-        m_uiTotalSize = atoi(szBuffer + CDRTOOLS_END_LENGTH);
+            // Update the total number of sectors to process.
+            m_uiTotalSize = atoi(szBuffer + CDRTOOLS_END_LENGTH);
 
-        // Prevent a crash if the above function fails.
-        if (m_uiTotalSize == 0)
-            m_uiTotalSize = 1;
-    }
-    else if (!strncmp(szBuffer,CDRTOOLS_ADDRESS,CDRTOOLS_ADDRESS_LENGTH))
-    {
-        unsigned __int64 uiAddress = 0;
-        unsigned __int64 uiCount = 0;
+            // Prevent a crash if the above function fails.
+            if (m_uiTotalSize == 0)
+                m_uiTotalSize = 1;
+            break;
 
-        if (sscanf(szBuffer,"addr: %8ld cnt: %ld",&uiAddress,&uiCount) == 2)
-            m_pProgress->set_progress((unsigned char)(((double)uiAddress/m_uiTotalSize) * 100));
-    }
-    else if (!strncmp(szBuffer,CDRTOOLS_TOTALTIME,CDRTOOLS_TOTALTIME_LENGTH))
-    {
-        m_pProgress->notify(ckcore::Progress::ckINFORMATION,lngGetString(SUCCESS_READDISC));
+        case CCdrtoolsParser::TOKEN_ADDRESS:
+            {
+                unsigned __int64 uiAddress = 0;
+                unsigned __int64 uiCount = 0;
+
+                if (ParseAddress(szBuffer,uiAddress,uiCount))
+                    m_pProgress->set_progress((unsigned char)(((double)uiAddress/m_uiTotalSize) * 100));
+            }
+            break;
 
-        m_bOperationRes = true;			// Success.
+        case CCdrtoolsParser::TOKEN_TOTALTIME:
+            m_pProgress->notify(ckcore::Progress::ckINFORMATION,lngGetString(SUCCESS_READDISC));
+
+            m_bOperationRes = true;			// Success.
+            break;
     }
 }
 
@@ -626,51 +713,43 @@ void CCore::event_output(const std::string &block)
         g_pLogDlg->print_line(ckcore::string::ansi_to_auto<1024>(block.c_str()).c_str());
     }
 
+    // Classify the line once, the handlers below switch on the token.
+    const char *szBlock = block.c_str();
+    int iToken = m_Parser.Match(szBlock);
+
     // Always skip the copyright line.
-    if (!strncmp(block.c_str(),CDRTOOLS_COPYRIGHT,CDRTOOLS_COPYRIGHT_LENGTH))
+    if (iToken == CCdrtoolsParser::TOKEN_COPYRIGHT)
         return;
 
     // Check for a cygwin path.
+    int iErrorToken = iToken;
+    const char *szError = szBlock;
+
     if (m_bErrorPathMode)
     {
-        if (!strncmp(block.c_str(),CDRTOOLS_CYGWINPATH,CDRTOOLS_CYGWINPATH_LENGTH))
+        iErrorToken = CCdrtoolsParser::TOKEN_NONE;
+
+        if (iToken == CCdrtoolsParser::TOKEN_CYGWINPATH)
         {
-            // An error message has been found.
-            if (!strncmp(block.c_str() + m_uiCDRToolsPathLen,CDRTOOLS_ERROR,CDRTOOLS_ERROR_LENGTH))
-            {
-                ErrorOutputCDRECORD(block.c_str() + m_uiCDRToolsPathLen + CDRTOOLS_ERROR_LENGTH);
-                return;
-            }
-            else if (!strncmp(block.c_str() + m_uiCDRToolsPathLen,CDRTOOLS_ERROR3,CDRTOOLS_ERROR3_LENGTH))
-            {
-                ErrorOutputREADCD(block.c_str() + m_uiCDRToolsPathLen + CDRTOOLS_ERROR3_LENGTH);
-                return;
-            }
-            else if (!strncmp(block.c_str() + m_uiCDRToolsPathLen,CDRTOOLS_ERROR4,CDRTOOLS_ERROR4_LENGTH))
-            {
-                ErrorOutputCDDA2WAV(block.c_str() + m_uiCDRToolsPathLen + CDRTOOLS_ERROR4_LENGTH);
-                return;
-            }
+            szError = szBlock + m_uiCDRToolsPathLen;
+            iErrorToken = m_Parser.Match(szError);
         }
     }
-    else
+
+    // An error message has been found.
+    switch (iErrorToken)
     {
-        // An error message has been found.
-        if (!strncmp(block.c_str(),CDRTOOLS_ERROR,CDRTOOLS_ERROR_LENGTH))
-        {
-            ErrorOutputCDRECORD(block.c_str() + CDRTOOLS_ERROR_LENGTH);
+        case CCdrtoolsParser::TOKEN_ERROR:
+            ErrorOutputCDRECORD(szError + CDRTOOLS_ERROR_LENGTH);
             return;
-        }
-        else if (!strncmp(block.c_str(),CDRTOOLS_ERROR3,CDRTOOLS_ERROR3_LENGTH))
-        {
-            ErrorOutputREADCD(block.c_str() + CDRTOOLS_ERROR3_LENGTH);
+
+        case CCdrtoolsParser::TOKEN_ERROR3:
+            ErrorOutputREADCD(szError + CDRTOOLS_ERROR3_LENGTH);
             return;
-        }
-        else if (!strncmp(block.c_str(),CDRTOOLS_ERROR4,CDRTOOLS_ERROR4_LENGTH))
-        {
-            ErrorOutputCDDA2WAV(block.c_str() + CDRTOOLS_ERROR4_LENGTH);
+
+        case CCdrtoolsParser::TOKEN_ERROR4:
+            ErrorOutputCDDA2WAV(szError + CDRTOOLS_ERROR4_LENGTH);
             return;
-        }
     }
 
     // If we are in grace time mode we only look for timer updates.
@@ -852,36 +931,36 @@ void CCore::event_output(const std::string &block)
             break;
 
         case MODE_ERASE:
-            EraseOutput(block.c_str());
+            EraseOutput(szBlock,iToken);
             break;
 
         case MODE_FIXATE:
-            FixateOutput(block.c_str());
+            FixateOutput(szBlock,iToken);
             break;
 
         case MODE_BURNIMAGE:
         case MODE_BURNIMAGEEX:
-            BurnImageOutput(block.c_str());
+            BurnImageOutput(szBlock,iToken);
             break;
 
         case MODE_READDATATRACK:
         case MODE_READDATATRACKEX:
-            ReadDataTrackOutput(block.c_str());
+            ReadDataTrackOutput(szBlock,iToken);
             break;
 
         case MODE_READAUDIOTRACK:
         case MODE_READAUDIOTRACKEX:
-            ReadAudioTrackOutput(block.c_str());
+            ReadAudioTrackOutput(szBlock,iToken);
             break;
 
         case MODE_SCANTRACK:
         case MODE_SCANTRACKEX:
-            ScanTrackOutput(block.c_str());
+            ScanTrackOutput(szBlock,iToken);
             break;
 
         case MODE_READDISC:
         case MODE_READDISCEX:
-            ReadDiscOutput(block.c_str());
+            ReadDiscOutput(szBlock,iToken);
             break;
     };
 }
@@ -2081,17 +2160,13 @@ bool CCore::CopyDisc(ckmmc::Device &SrcDevice,ckmmc::Device &DstDevice,
         if (g_WinVer.m_ulMajorVersion < MAJOR_WINXP ||
             (g_WinVer.m_ulMajorVersion == MAJOR_WINXP && g_WinVer.m_ulMinorVersion < MINOR_WINXP))
         {
-            TCHAR szMessage[256];
-            lsnprintf_s(szMessage,256,lngGetString(ERROR_COMMANDLINE),2048);
-            MessageBox(HWND_DESKTOP,szMessage,lngGetString(GENERAL_ERROR),MB_OK | MB_ICONERROR);
+            ReportCommandLineError(2048);
             return false;
         }
         // Windows XP supports 8192 character command lines (using the shell).
         else if (CommandLine.length() > 8191)
         {
-            TCHAR szMessage[256];
-            lsnprintf_s(szMessage,256,lngGetString(ERROR_COMMANDLINE),8192);
-            MessageBox(HWND_DESKTOP,szMessage,lngGetString(GENERAL_ERROR),MB_OK | MB_ICONERROR);
+            ReportCommandLineError(8192);
             return false;
         }
     }
@@ -2196,8 +2271,20 @@ DWORD WINAPI CCore::CreateCompImageThread(LPVOID lpThreadParameter)
 {
     CCompImageParams *pParams = (CCompImageParams *)lpThreadParameter;
 
-    g_Core2.CreateImage(pParams->m_Process,pParams->m_Files,
-                        pParams->m_Progress,false);
+    // Pass the file system through the recording buffer if it can be
+    // allocated, otherwise write directly to the process.
+    CPipeBuffer Buffer(pParams->m_Process,pParams->m_pBufferProgress,
+                       (unsigned long)g_GlobalSettings.m_iPipeBufferSize << 20);
+    if (Buffer.Start())
+    {
+        g_Core2.CreateImage(Buffer,pParams->m_Files,pParams->m_Progress,false);
+        Buffer.Close();
+    }
+    else
+    {
+        g_Core2.CreateImage(pParams->m_Process,pParams->m_Files,
+                            pParams->m_Progress,false);
+    }
 
     return 0;
 }
@@ -2224,10 +2311,13 @@ DWORD WINAPI CCore::NextCopyThread(LPVOID lpThreadParameter)
     CCore::BurnCompilation
     ----------------------
     Burns a compilation on the fly to a disc. This function is configured through
-    the g_BurnImageSettings and g_ProjectSettings object.
+    the g_BurnImageSettings and g_ProjectSettings object. If no file set is
+    specified the process is launched without waiting for it, the caller is then
+    responsible for writing the data track to the process. A data size of zero
+    means that there is no data track.
 */
 bool CCore::BurnCompilation(ckmmc::Device &Device,CAdvancedProgress *pProgress,
-                            ckcore::Progress &Progress,const ckfilesystem::FileSet &Files,
+                            ckcore::Progress *pImageProgress,const ckfilesystem::FileSet *pFiles,
                             std::vector<TCHAR *> &AudioTracks,const TCHAR *szAudioText,
                             int iDataMode,unsigned __int64 uiDataBytes,int iMode)
 {
@@ -2268,7 +2358,8 @@ bool CCore::BurnCompilation(ckmmc::Device &Device,CAdvancedProgress *pProgress,
     m_uiProcessedSize = 0;
 
     m_uiTotalSize = uiDataBytes / (1024 * 1024);			// MiB.
-    m_TrackSize.push_back(m_uiTotalSize);
+    if (uiDataBytes > 0)
+        m_TrackSize.push_back(m_uiTotalSize);
 
     for (unsigned int i = 0; i < AudioTracks.size(); i++)
     {
@@ -2431,16 +2522,19 @@ bool CCore::BurnCompilation(ckmmc::Device &Device,CAdvancedProgress *pProgress,
     }
 
     // Mode.
-    switch (iDataMode)
+    if (uiDataBytes > 0)
     {
-        case 0:		// Mode 1
-            CommandLine += _T(" -data -");
-            break;
+        switch (iDataMode)
+        {
+            case 0:		// Mode 1
+                CommandLine += _T(" -data -");
+                break;
 
-        case 1:		// Mode 2 XA (multisession)
-            CommandLine += _T(" -multi -");
-            break;
-    };
+            case 1:		// Mode 2 XA (multisession)
+                CommandLine += _T(" -multi -");
+                break;
+        };
+    }
 
     // Audio tracks.
     if (AudioTracks.size() > 0)
@@ -2471,23 +2565,22 @@ bool CCore::BurnCompilation(ckmmc::Device &Device,CAdvancedProgress *pProgress,
         if (g_WinVer.m_ulMajorVersion < MAJOR_WINXP ||
             (g_WinVer.m_ulMajorVersion == MAJOR_WINXP && g_WinVer.m_ulMinorVersion < MINOR_WINXP))
         {
-            TCHAR szMessage[256];
-            lsnprintf_s(szMessage,256,lngGetString(ERROR_COMMANDLINE),2048);
-            MessageBox(HWND_DESKTOP,szMessage,lngGetString(GENERAL_ERROR),MB_OK | MB_ICONERROR);
+            ReportCommandLineError(2048);
             return false;
         }
         // Windows XP supports 8192 character command lines (using the shell).
         else if (CommandLine.length() > 8191)
         {
-            TCHAR szMessage[256];
-            lsnprintf_s(szMessage,256,lngGetString(ERROR_COMMANDLINE),8192);
-            MessageBox(HWND_DESKTOP,szMessage,lngGetString(GENERAL_ERROR),MB_OK | MB_ICONERROR);
+            ReportCommandLineError(8192);
             return false;
         }
     }
 
+    if (pFiles == NULL)
+        return SafeLaunch(CommandLine,false);
+
     // Create a separate thread for writing the file system to the process.
-    CCompImageParams CompImageParams(*this,Progress,Files);
+    CCompImageParams CompImageParams(*this,*pImageProgress,pProgress,*pFiles);
 
     unsigned long ulThreadID = 0;
     HANDLE hThread = ::CreateThread(NULL,0,CreateCompImageThread,&CompImageParams,0,&ulThreadID);
@@ -2502,7 +2595,7 @@ bool CCore::BurnCompilation(ckmmc::Device &Device,CAdvancedProgress *pProgress,
                             std::vector<TCHAR *> &AudioTracks,const TCHAR *szAudioText,
                             int iMode,unsigned __int64 uiDataBytes)
 {
-    return BurnCompilation(Device,pProgress,Progress,Files,AudioTracks,
+    return BurnCompilation(Device,pProgress,&Progress,&Files,AudioTracks,
                            szAudioText,iMode,uiDataBytes,MODE_BURNIMAGE);
 }
 
@@ -2511,7 +2604,7 @@ eBurnResult CCore::BurnCompilationEx(ckmmc::Device &Device,CAdvancedProgress *pP
                                      std::vector<TCHAR *> &AudioTracks,const TCHAR *szAudioText,
                                      int iMode,unsigned __int64 uiDataBytes)
 {
-    if (!BurnCompilation(Device,pProgress,Progress,Files,AudioTracks,szAudioText,
+    if (!BurnCompilation(Device,pProgress,&Progress,&Files,AudioTracks,szAudioText,
                          iMode,uiDataBytes,MODE_BURNIMAGEEX))
     {
         return BURNRESULT_INTERNALERROR;		
@@ -2522,4 +2615,20 @@ eBurnResult CCore::BurnCompilationEx(ckmmc::Device &Device,CAdvancedProgress *pP
 
     return uiExitCode == 0 ? BURNRESULT_OK : BURNRESULT_EXTERNALERROR;
     //return m_bOperationRes ? BURNRESULT_OK : BURNRESULT_EXTERNALERROR;
+}
+
+/*
+    CCore::BurnCompilationStream
+    ----------------------------
+    Starts burning a compilation where the data track is read from the
+    standard input of the process. The function returns as soon as the
+    process has been launched, the caller should write exactly uiDataBytes
+    bytes to this object and then wait for the process to finish.
+*/
+bool CCore::BurnCompilationStream(ckmmc::Device &Device,CAdvancedProgress *pProgress,
+                                  std::vector<TCHAR *> &AudioTracks,const TCHAR *szAudioText,
+                                  int iMode,unsigned __int64 uiDataBytes)
+{
+    return BurnCompilation(Device,pProgress,NULL,NULL,AudioTracks,szAudioText,
+                           iMode,uiDataBytes,MODE_BURNIMAGEEX);
 }
\ No newline at end of file
@@ -23,6 +23,7 @@
 #include <ckmmc/device.hh>
 #include <base/string_util.hh>
 #include "advanced_progress.hh"
+#include "cdrtools_parser.hh"
 
 #define CORE_IGNORE_ERRORINFOMESSAGES		// Should we ignore error information message (copyright etc.)?
 #define CORE_PRINT_UNSUPERRORMESSAGES		// Should we print unhandled/unsupported messages to the log window?
@@ -80,26 +81,32 @@ private:
     // Used when quering version information.
     ckcore::tstring m_Version;
 
+    // Classifies the lines received from the cdrtools applications.
+    CCdrtoolsParser m_Parser;
+
     void Initialize(int iMode,CAdvancedProgress *pProgress = NULL);
     void Reinitialize();
     void CreateBatchFile(const char *szChangeDir,const char *szCommandLine,TCHAR *szBatchPath);
     bool SafeLaunch(tstring &CommandLine,bool bWaitForProcess);
+    void ReportCommandLineError(unsigned int uiMaxLength);
     bool Relaunch();
 
-    bool CheckGraceTime(const char *szBuffer);
-    bool CheckProgress(const char *szBuffer);
+    bool CheckGraceTime(const char *szBuffer,int iToken);
+    bool CheckProgress(int iToken);
+    static bool ParseAddress(const char *szBuffer,unsigned __int64 &uiAddress,
+                             unsigned __int64 &uiCount);
 
     void ErrorOutputCDRECORD(const char *szBuffer);
     void ErrorOutputREADCD(const char *szBuffer);
     void ErrorOutputCDDA2WAV(const char *szBuffer);
 
-    void EraseOutput(const char *szBuffer);
-    void FixateOutput(const char *szBuffer);
-    void BurnImageOutput(const char *szBuffer);
-    void ReadDataTrackOutput(const char *szBuffer);
-    void ReadAudioTrackOutput(const char *szBuffer);
-    void ScanTrackOutput(const char *szBuffer);
-    void ReadDiscOutput(const char *szBuffer);
+    void EraseOutput(const char *szBuffer,int iToken);
+    void FixateOutput(const char *szBuffer,int iToken);
+    void BurnImageOutput(const char *szBuffer,int iToken);
+    void ReadDataTrackOutput(const char *szBuffer,int iToken);
+    void ReadAudioTrackOutput(const char *szBuffer,int iToken);
+    void ScanTrackOutput(const char *szBuffer,int iToken);
+    void ReadDiscOutput(const char *szBuffer,int iToken);
     void VersionOutput(const char *szBuffer);
 
     // Inherited events.
@@ -112,11 +119,13 @@ private:
     public:
         ckcore::Process &m_Process;
         ckcore::Progress &m_Progress;
+        CAdvancedProgress *m_pBufferProgress;
         const ckfilesystem::FileSet &m_Files;
 
         CCompImageParams(ckcore::Process &Process,ckcore::Progress &Progress,
-            const ckfilesystem::FileSet &Files) : m_Process(Process),
-            m_Progress(Progress),m_Files(Files)
+            CAdvancedProgress *pBufferProgress,const ckfilesystem::FileSet &Files) :
+            m_Process(Process),m_Progress(Progress),m_pBufferProgress(pBufferProgress),
+            m_Files(Files)
         {
         }
     };
@@ -139,7 +148,7 @@ private:
     bool ReadDisc(ckmmc::Device &Device,CAdvancedProgress *pProgress,const TCHAR *szFileName,
         int iMode,bool bWaitForProcess);
     bool BurnCompilation(ckmmc::Device &Device,CAdvancedProgress *pProgress,
-        ckcore::Progress &Progress,const ckfilesystem::FileSet &Files,
+        ckcore::Progress *pImageProgress,const ckfilesystem::FileSet *pFiles,
         std::vector<TCHAR *> &AudioTracks,const TCHAR *szAudioText,int iDataMode,
         unsigned __int64 uiDataBytes,int iMode);
 
@@ -211,6 +220,9 @@ public:
     eBurnResult BurnCompilationEx(ckmmc::Device &Device,CAdvancedProgress *pProgress,ckcore::Progress &Progress,
         const ckfilesystem::FileSet &Files,std::vector<TCHAR *> &AudioTracks,
         const TCHAR *szAudioText,int iMode,unsigned __int64 uiDataBytes);
+    bool BurnCompilationStream(ckmmc::Device &Device,CAdvancedProgress *pProgress,
+        std::vector<TCHAR *> &AudioTracks,const TCHAR *szAudioText,int iMode,
+        unsigned __int64 uiDataBytes);
     ckcore::tstring CdrtoolsVersion();
 };
 
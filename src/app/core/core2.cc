@@ -22,12 +22,18 @@
 #include <ckcore/nullstream.hh>
 #include <ckcore/exception.hh>
 #include <ckfilesystem/filesystemwriter.hh>
+#include <base/image_size_estimator.hh>
+#include <base/space_layout.hh>
 #include "core2.hh"
 #include "core2_Format.hh"
 #include "core2_blank.hh"
 #include "core2_util.hh"
 #include "core2_info.hh"
 #include "core2_read.hh"
+#include "core2_prefetch.hh"
+#include "core2_checkpoint.hh"
+#include "core2_dedup.hh"
+#include "device_util.hh"
 #include "log_dlg.hh"
 #include "settings.hh"
 #include "string_table.hh"
@@ -37,10 +43,12 @@ CCore2 g_Core2;
 
 CCore2::CCore2()
 {
+    InitializeCriticalSection(&m_csWaitStatistics);
 }
 
 CCore2::~CCore2()
 {
+    DeleteCriticalSection(&m_csWaitStatistics);
 }
 
 bool CCore2::HandleEvents(ckmmc::Device &Device,CAdvancedProgress *pProgress,
@@ -138,6 +146,51 @@ bool CCore2::HandleEvents(ckmmc::Device &Device,CAdvancedProgress *pProgress,
     return true;
 }
 
+/*
+    CCore2::GetBusyEvent
+    --------------------
+    Polls the device busy event class using the GET EVENT STATUS NOTIFICATION
+    command. Returns false if the device does not report device busy events.
+    Otherwise bBusy is set if the device is busy and ulBusyTime is set to the
+    estimated time in milliseconds until the device is ready, zero if unknown.
+*/
+bool CCore2::GetBusyEvent(ckmmc::Device &Device,bool &bBusy,unsigned long &ulBusyTime)
+{
+    unsigned char ucCdb[16];
+    memset(ucCdb,0,sizeof(ucCdb));
+
+    unsigned char ucEvent[8];
+    memset(ucEvent,0,sizeof(ucEvent));
+
+    ucCdb[0] = SCSI_GET_EVENT_STATUS_NOTIFICATION;
+    ucCdb[1] = 0x01;			// Polled.
+    ucCdb[4] = 0x40;			// Device busy.
+    ucCdb[8] = sizeof(ucEvent);
+    ucCdb[9] = 0x00;
+
+    if (!Device.transport(ucCdb,10,ucEvent,sizeof(ucEvent),
+                          ckmmc::Device::ckTM_READ))
+    {
+        return false;
+    }
+
+    // Make sure that the device busy class is supported and was returned.
+    if ((ucEvent[2] & 0x80) || (ucEvent[2] & 0x07) != 6 || !(ucEvent[3] & 0x40))
+        return false;
+
+    bBusy = ucEvent[5] != 0;
+    ulBusyTime = (((unsigned long)ucEvent[6] << 8) | ucEvent[7]) * 100;
+    return true;
+}
+
+/*
+    CCore2::WaitForUnit
+    -------------------
+    Waits until the unit reports that it's ready. The unit is polled with a
+    short interval at first which is doubled for every poll. Devices that
+    report device busy events are asked for an estimate of how long they will
+    be busy instead. The time spent waiting is added to the wait statistics.
+*/
 bool CCore2::WaitForUnit(ckmmc::Device &Device,CAdvancedProgress *pProgress)
 {
     // Initialize buffers.
@@ -150,20 +203,31 @@ bool CCore2::WaitForUnit(ckmmc::Device &Device,CAdvancedProgress *pProgress)
     // Prepare command.
     ucCdb[0] = SCSI_TEST_UNIT_READY;
 
+    unsigned long ulStartTime = ::GetTickCount();
+    unsigned long ulInterval = CORE2_WAITFORUNIT_MININTERVAL;
+    unsigned long ulMaxInterval = CORE2_WAITFORUNIT_MAXINTERVAL;
+    unsigned long ulPollCount = 0;
+    bool bUseEvents = true;
+    bool bResult = false;
+
     while (true)
     {
-        Sleep(1000);
+        Sleep(ulInterval);
+        ulPollCount++;
 
         unsigned char ucResult;
         if (!Device.transport_with_sense(ucCdb,6,NULL,0,ckmmc::Device::ckTM_READ,
                                          ucSense,ucResult))
         {
-            return false;
+            break;
         }
 
         // Check if we're done.
         if (ucResult == SCSISTAT_GOOD)
-            return true;
+        {
+            bResult = true;
+            break;
+        }
 
         // Check for errors.
         /*switch (ucSense[2] & 0x0F)
@@ -187,7 +251,7 @@ bool CCore2::WaitForUnit(ckmmc::Device &Device,CAdvancedProgress *pProgress)
                 // Stop the unit and unlock the media.
                 CloseTrackSession(Device,0,0,true);
                 LockMedia(Device,false);
-                return false;
+                break;
             }
 
             // Update the progress.
@@ -202,13 +266,41 @@ bool CCore2::WaitForUnit(ckmmc::Device &Device,CAdvancedProgress *pProgress)
                 else
                 {
                     pProgress->set_progress(100);
-                    return true;
+                    bResult = true;
+                    break;
                 }
             }
+
+            // Formatting and blanking may take an hour, no need to poll as often.
+            ulMaxInterval = CORE2_WAITFORUNIT_MAXLONGINTERVAL;
+        }
+
+        ulInterval = min(ulInterval * 2,ulMaxInterval);
+
+        // Use the estimate of the device if it has one.
+        if (bUseEvents)
+        {
+            bool bBusy = false;
+            unsigned long ulBusyTime = 0;
+
+            ulPollCount++;
+            if (!GetBusyEvent(Device,bBusy,ulBusyTime))
+                bUseEvents = false;
+            else if (bBusy && ulBusyTime > 0)
+                ulInterval = max(min(ulBusyTime,ulMaxInterval),CORE2_WAITFORUNIT_MININTERVAL);
         }
     }
 
-    return true;
+    EnterCriticalSection(&m_csWaitStatistics);
+
+    CWaitStatistics &Statistics = m_WaitStatistics[&Device];
+    Statistics.m_ulWaitCount++;
+    Statistics.m_ulPollCount += ulPollCount;
+    Statistics.m_ulWaitTime += ::GetTickCount() - ulStartTime;
+
+    LeaveCriticalSection(&m_csWaitStatistics);
+
+    return bResult;
 }
 
 CCore2::eMediaChange CCore2::CheckMediaChange(ckmmc::Device &Device)
@@ -257,6 +349,34 @@ CCore2::eMediaChange CCore2::CheckMediaChange(ckmmc::Device &Device)
     return MEDIACHANGE_NOCHANGE;
 }
 
+CCore2::CWaitStatistics CCore2::GetWaitStatistics(ckmmc::Device &Device)
+{
+    EnterCriticalSection(&m_csWaitStatistics);
+    CWaitStatistics Statistics = m_WaitStatistics[&Device];
+    LeaveCriticalSection(&m_csWaitStatistics);
+
+    return Statistics;
+}
+
+/*
+    CCore2::LogWaitStatistics
+    -------------------------
+    Prints the time spent waiting for the specified device since the Start
+    statistics were obtained from it.
+*/
+void CCore2::LogWaitStatistics(ckmmc::Device &Device,const CWaitStatistics &Start)
+{
+    CWaitStatistics Current = GetWaitStatistics(Device);
+
+    unsigned long ulWaitCount = Current.m_ulWaitCount - Start.m_ulWaitCount;
+    if (ulWaitCount == 0)
+        return;
+
+    g_pLogDlg->print_line(_T("  Waited %u ms for %s to become ready (%u waits, %u commands)."),
+        Current.m_ulWaitTime - Start.m_ulWaitTime,NDeviceUtil::GetDeviceName(Device).c_str(),
+        ulWaitCount,Current.m_ulPollCount - Start.m_ulPollCount);
+}
+
 bool CCore2::LockMedia(ckmmc::Device &Device,bool bLock)
 {
     // Initialize buffers.
@@ -486,6 +606,8 @@ bool CCore2::EraseDisc(ckmmc::Device &Device,CAdvancedProgress *pProgress,
         g_pLogDlg->print_line(szParameters);
     }
 
+    CWaitStatistics WaitStatistics = GetWaitStatistics(Device);
+
     // Setup the progress dialog.
     pProgress->AllowCancel(false);
     pProgress->SetRealMode(!bSimulate);
@@ -527,6 +649,8 @@ bool CCore2::EraseDisc(ckmmc::Device &Device,CAdvancedProgress *pProgress,
             break;
     }
 
+    LogWaitStatistics(Device,WaitStatistics);
+
     // Unlock the media.
     if (!LockMedia(Device,false))
         g_pLogDlg->print_line(_T("  Warning: Unable to unlock device media."));
@@ -554,7 +678,7 @@ bool CCore2::ReadDataTrack(ckmmc::Device &Device,CAdvancedProgress *pProgress,
         g_pLogDlg->print_line(szParameters);
     }
 
-    CCore2Info Info;
+    CCore2Info Info(g_pLogDlg);
     CCore2Read Read;
 
     // Print the maximum read speed (for diagnostics purposes).
@@ -635,9 +759,13 @@ bool CCore2::ReadDataTrack(ckmmc::Device &Device,CAdvancedProgress *pProgress,
     Core2ReadFunction::CReadUserData ReadFunc(Device,&OutStream);
 
     // Start reading the selected sectors from the disc.
+    CWaitStatistics WaitStatistics = GetWaitStatistics(Device);
+
     bool bResult = Read.ReadData(Device,pProgress,&ReadFunc,ulTrackAddr,ulTrackSize,bIgnoreErr);
     OutStream.close();
 
+    LogWaitStatistics(Device,WaitStatistics);
+
     if (bResult)
         pProgress->notify(ckcore::Progress::ckINFORMATION,lngGetString(SUCCESS_READTRACK),ucTrackNumber);
 
@@ -692,11 +820,12 @@ bool CCore2::ReadFullTOC(ckmmc::Device &Device,const TCHAR *szFileName)
     return true;
 }
 
-int CCore2::CreateImage(ckcore::OutStream &OutStream,const ckfilesystem::FileSet &Files,
-                        ckcore::Progress &Progress,bool bFailOnError,
-                        std::map<tstring,tstring> *pFilePathMap)
+/*
+    Returns the file system type selected in the project settings.
+*/
+static ckfilesystem::FileSystem::Type GetProjectFileSystemType()
 {
-    ckfilesystem::FileSystem::Type FileSysType;
+    ckfilesystem::FileSystem::Type FileSysType = ckfilesystem::FileSystem::TYPE_ISO;
     switch (g_ProjectSettings.m_iFileSystem)
     {
         case FILESYSTEM_ISO:
@@ -720,7 +849,15 @@ int CCore2::CreateImage(ckcore::OutStream &OutStream,const ckfilesystem::FileSet
             ckcore::throw_internal_error(_T(__FILE__),__LINE__);
     }
 
-    ckfilesystem::Iso::InterchangeLevel InterchangeLevel;
+    return FileSysType;
+}
+
+/*
+    Returns the ISO9660 interchange level selected in the project settings.
+*/
+static ckfilesystem::Iso::InterchangeLevel GetProjectInterchangeLevel()
+{
+    ckfilesystem::Iso::InterchangeLevel InterchangeLevel = ckfilesystem::Iso::LEVEL_1;
     switch (g_ProjectSettings.m_iIsoLevel)
     {
         case 0:
@@ -740,6 +877,14 @@ int CCore2::CreateImage(ckcore::OutStream &OutStream,const ckfilesystem::FileSet
             ckcore::throw_internal_error(_T(__FILE__),__LINE__);
     }
 
+    return InterchangeLevel;
+}
+
+/*
+    Returns the ISO9660 character set selected in the project settings.
+*/
+static ckfilesystem::CharacterSet GetProjectCharacterSet()
+{
     ckfilesystem::CharacterSet CharacterSet = ckfilesystem::CHARSET_ISO;
     switch (g_ProjectSettings.m_IsoCharSet)
     {
@@ -757,6 +902,17 @@ int CCore2::CreateImage(ckcore::OutStream &OutStream,const ckfilesystem::FileSet
             break;
     }
 
+    return CharacterSet;
+}
+
+int CCore2::CreateImage(ckcore::OutStream &OutStream,const ckfilesystem::FileSet &Files,
+                        ckcore::Progress &Progress,bool bFailOnError,
+                        std::map<tstring,tstring> *pFilePathMap,bool bPrefetch)
+{
+    ckfilesystem::FileSystem::Type FileSysType = GetProjectFileSystemType();
+    ckfilesystem::Iso::InterchangeLevel InterchangeLevel = GetProjectInterchangeLevel();
+    ckfilesystem::CharacterSet CharacterSet = GetProjectCharacterSet();
+
     ckfilesystem::FileSystem FileSys(FileSysType,Files);
 
     FileSys.set_long_joliet_names(g_ProjectSettings.m_bJolietLongNames);
@@ -800,7 +956,38 @@ int CCore2::CreateImage(ckcore::OutStream &OutStream,const ckfilesystem::FileSet
         ulSectorOffset = (unsigned long)g_ProjectSettings.m_uiNextWritableAddr;
 
     ckfilesystem::FileSystemWriter FileSysWriter(*g_pLogDlg,FileSys,bFailOnError);
-    int iResult = FileSysWriter.write(OutStream,Progress,ulSectorOffset);
+    int iResult = RESULT_OK;
+
+    if (bPrefetch)
+    {
+        // Read the files ahead of the writer so that it's kept busy when the
+        // files are located on slow media. The layout is needed to tell where
+        // the file data starts.
+        unsigned __int64 uiImageSize = 0,uiDataOffset = 0;
+        if (!CalcImageSize(Files,uiImageSize,&uiDataOffset))
+            uiDataOffset = 0;
+
+        CCore2Prefetcher Prefetcher(Files,uiDataOffset);
+        CCore2Prefetcher::CStream PrefetchStream(Prefetcher,OutStream);
+        Prefetcher.Start();
+
+        iResult = FileSysWriter.write(PrefetchStream,Progress,ulSectorOffset);
+
+        Prefetcher.Stop();
+
+        int iUnderrunRisk = Prefetcher.GetUnderrunRisk();
+        g_pLogDlg->print_line(_T("  Prefetched %I64u bytes, buffer underrun risk %d%%."),
+                              Prefetcher.GetPrefetched(),iUnderrunRisk);
+
+        // Only recordings on the fly, which don't fail on errors, are sensitive
+        // to buffer underruns.
+        if (!bFailOnError && iUnderrunRisk >= CORE2_PREFETCH_RISKWARNING)
+            Progress.notify(ckcore::Progress::ckWARNING,lngGetString(WARNING_UNDERRUNRISK),iUnderrunRisk);
+    }
+    else
+    {
+        iResult = FileSysWriter.write(OutStream,Progress,ulSectorOffset);
+    }
 
     if (pFilePathMap != NULL)
         FileSysWriter.file_path_map(*pFilePathMap);
@@ -809,27 +996,148 @@ int CCore2::CreateImage(ckcore::OutStream &OutStream,const ckfilesystem::FileSet
 }
 
 /*
-    A wrapper method for the function above.
+    A wrapper method for the function above. If bResumable is true the image
+    is checkpointed, a failed or cancelled image is kept and resumed the next
+    time the same file set is written to the same path. pBlockChecksums
+    receives the checksums of the CORE2_CHECKPOINT_BLOCKSIZE blocks of a
+    resumable image, calculated while the image is written.
 */
 int CCore2::CreateImage(const TCHAR *szFullPath,const ckfilesystem::FileSet &Files,
                         ckcore::Progress &Progress,bool bFailOnError,
-                        std::map<tstring,tstring> *pFilePathMap)
+                        std::map<tstring,tstring> *pFilePathMap,bool bResumable,
+                        std::vector<ckcore::tuint32> *pBlockChecksums)
 {
-    ckcore::FileOutStream FileStream(szFullPath);
-    if (!FileStream.open())
+    // Let identical files share a single extent. This is only possible in
+    // ISO9660 images since the directory records are updated afterwards.
+    CCore2Dedup Dedup;
+    ckfilesystem::FileSet DedupFiles;
+    bool bDedup = false;
+
+    if (g_ProjectSettings.m_bDeduplicate && g_ProjectSettings.m_iFileSystem == FILESYSTEM_ISO)
     {
-        g_pLogDlg->print_line(_T("  Error: Unable to obtain file handle to \"%s\"."),szFullPath);
-        return RESULT_FAIL;
+        bDedup = Dedup.Prepare(Files,DedupFiles);
+
+        g_pLogDlg->print_line(_T("  Found %u duplicate files, %I64u bytes."),
+            Dedup.GetDuplicateCount(),Dedup.GetDuplicateBytes());
     }
 
-    return CreateImage(FileStream,Files,Progress,bFailOnError,pFilePathMap);
+    const ckfilesystem::FileSet &ImageFiles = bDedup ? DedupFiles : Files;
+
+    int iResult = RESULT_OK;
+    if (bResumable)
+    {
+        CCore2Checkpoint Checkpoint(szFullPath,ImageFiles,pBlockChecksums);
+        if (Checkpoint.Open())
+        {
+            iResult = CreateImage(Checkpoint,ImageFiles,Progress,bFailOnError,pFilePathMap);
+            if (iResult == RESULT_OK && !Checkpoint.Finish())
+            {
+                g_pLogDlg->print_line(_T("  Error: Unable to complete \"%s\"."),szFullPath);
+                iResult = RESULT_FAIL;
+            }
+        }
+        else
+        {
+            iResult = RESULT_FAIL;
+        }
+    }
+    else
+    {
+        ckcore::FileOutStream FileStream(szFullPath);
+        if (FileStream.open())
+        {
+            iResult = CreateImage(FileStream,ImageFiles,Progress,bFailOnError,pFilePathMap);
+            FileStream.close();
+        }
+        else
+        {
+            g_pLogDlg->print_line(_T("  Error: Unable to obtain file handle to \"%s\"."),szFullPath);
+            iResult = RESULT_FAIL;
+        }
+    }
+
+    if (bDedup)
+    {
+        unsigned long ulSectorOffset = 0;
+        if (g_ProjectSettings.m_bMultiSession)
+            ulSectorOffset = (unsigned long)g_ProjectSettings.m_uiNextWritableAddr;
+
+        if (iResult == RESULT_OK && !Dedup.Link(szFullPath,ulSectorOffset,
+                                                bResumable ? pBlockChecksums : NULL))
+            iResult = RESULT_FAIL;
+
+        ckfilesystem::destroy_file_set(DedupFiles);
+    }
+
+    return iResult;
+}
+
+/*
+    Configures an image size estimator with the file system settings of the
+    project. Returns false if the size of a boot image can't be determined.
+*/
+static bool InitImageSizeEstimator(CImageSizeEstimator &Estimator)
+{
+    Estimator.SetCharSet(GetProjectCharacterSet());
+    Estimator.SetLongJolietNames(g_ProjectSettings.m_bJolietLongNames);
+    Estimator.SetIncludeFileVerInfo(!g_ProjectSettings.m_bOmitVerNum);
+    Estimator.SetRelaxMaxDirLevel(g_ProjectSettings.m_bDeepDirs);
+
+    bool bResult = true;
+    std::list<CProjectBootImage *>::const_iterator itBootImage;
+    for (itBootImage = g_ProjectSettings.m_BootImages.begin(); itBootImage !=
+        g_ProjectSettings.m_BootImages.end(); itBootImage++)
+    {
+        if (!Estimator.AddBootImage((*itBootImage)->m_FullPath.c_str()))
+            bResult = false;
+    }
+
+    return bResult;
+}
+
+/*
+    CCore2::CalcImageSize
+    ---------------------
+    Calculates the size of the image from the file system layout without
+    writing it. If pDataOffset isn't NULL it receives the position of the
+    file data in the image. Returns false if the size can't be calculated.
+*/
+bool CCore2::CalcImageSize(const ckfilesystem::FileSet &Files,unsigned __int64 &uiImageSize,
+                           unsigned __int64 *pDataOffset)
+{
+    CImageSizeEstimator Estimator(GetProjectFileSystemType(),GetProjectInterchangeLevel());
+
+    return InitImageSizeEstimator(Estimator) && Estimator.Estimate(Files,uiImageSize,pDataOffset);
 }
 
+/*
+    CCore2::CalcImageSize
+    ---------------------
+    Calculates the size of the image from the running totals of the space
+    meter, using the same file system model as when the image is created.
+    Returns false if the size can't be calculated.
+*/
+bool CCore2::CalcImageSize(const CSpaceLayout &Layout,unsigned __int64 &uiImageSize)
+{
+    CImageSizeEstimator Estimator(GetProjectFileSystemType(),GetProjectInterchangeLevel());
+
+    return InitImageSizeEstimator(Estimator) && Layout.GetImageSize(Estimator,uiImageSize);
+}
+
+/*
+    Calculates the size of the image that CreateImage would produce. The size
+    is calculated from the file meta data when possible, otherwise the image
+    is created into a null stream.
+*/
 int CCore2::EstimateImageSize(const ckfilesystem::FileSet &Files,ckcore::Progress &Progress,
                               unsigned __int64 &uiImageSize)
 {
+    if (CalcImageSize(Files,uiImageSize))
+        return RESULT_OK;
+
+    // Nothing is recorded so there is nothing to read ahead for.
     ckcore::NullStream OutStream;
-    int iResult = CreateImage(OutStream,Files,Progress,true);
+    int iResult = CreateImage(OutStream,Files,Progress,true,NULL,false);
 
     uiImageSize = OutStream.written();
     return iResult;
@@ -27,12 +27,44 @@
 #include "scsi.hh"
 #include "advanced_progress.hh"
 
+class CSpaceLayout;
+
+#define CORE2_WAITFORUNIT_MININTERVAL		5					// Milliseconds.
+#define CORE2_WAITFORUNIT_MAXINTERVAL		1000				// Milliseconds.
+#define CORE2_WAITFORUNIT_MAXLONGINTERVAL	4000				// Milliseconds, during format and long write operations.
+
 class CCore2
 {
+public:
+    // Time lost waiting for a unit to become ready.
+    class CWaitStatistics
+    {
+    public:
+        unsigned long m_ulWaitCount;
+        unsigned long m_ulPollCount;
+        unsigned long m_ulWaitTime;		// Milliseconds.
+
+        CWaitStatistics() : m_ulWaitCount(0),m_ulPollCount(0),m_ulWaitTime(0)
+        {
+        }
+    };
+
+private:
+    // Kept for each device so that operations running on different devices
+    // at the same time only log their own waits.
+    CRITICAL_SECTION m_csWaitStatistics;
+    std::map<ckmmc::Device *,CWaitStatistics> m_WaitStatistics;
+
+    bool GetBusyEvent(ckmmc::Device &Device,bool &bBusy,unsigned long &ulBusyTime);
+    bool CalcImageSize(const ckfilesystem::FileSet &Files,unsigned __int64 &uiImageSize,
+                       unsigned __int64 *pDataOffset = NULL);
+
 public:
     CCore2();
     ~CCore2();
 
+    bool CalcImageSize(const CSpaceLayout &Layout,unsigned __int64 &uiImageSize);
+
     enum eLoadMedia
     {
         LOADMEDIA_STOP = 0x00,
@@ -66,6 +98,8 @@ public:
         unsigned char &ucHandledEvents);
     bool WaitForUnit(ckmmc::Device &Device,CAdvancedProgress *pProgress);
     eMediaChange CheckMediaChange(ckmmc::Device &Device);
+    CWaitStatistics GetWaitStatistics(ckmmc::Device &Device);
+    void LogWaitStatistics(ckmmc::Device &Device,const CWaitStatistics &Start);
 
     bool LockMedia(ckmmc::Device &Device,bool bLock);
     bool StartStopUnit(ckmmc::Device &Device,eLoadMedia Action,bool bImmed);
@@ -85,10 +119,11 @@ public:
     bool ReadFullTOC(ckmmc::Device &Device,const TCHAR *szFileName);
     int CreateImage(ckcore::OutStream &OutStream,const ckfilesystem::FileSet &Files,
         ckcore::Progress &Progress,bool bFailOnError,
-        std::map<tstring,tstring> *pFilePathMap = NULL);
+        std::map<tstring,tstring> *pFilePathMap = NULL,bool bPrefetch = true);
     int CreateImage(const TCHAR *szFullPath,const ckfilesystem::FileSet &Files,		// Wrapper.
         ckcore::Progress &Progress,bool bFailOnError,
-        std::map<tstring,tstring> *pFilePathMap = NULL);
+        std::map<tstring,tstring> *pFilePathMap = NULL,bool bResumable = false,
+        std::vector<ckcore::tuint32> *pBlockChecksums = NULL);
     int EstimateImageSize(const ckfilesystem::FileSet &Files,ckcore::Progress &Progress,	// Wrapper.
         unsigned __int64 &uiImageSize);
 };
@@ -0,0 +1,587 @@
+/*
+ * InfraRecorder - CD/DVD burning software
+ * Copyright (C) 2006-2012 Christian Kindahl
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "stdafx.hh"
+#include <base/checksum_util.hh>
+#include <base/string_util.hh>
+#include "log_dlg.hh"
+#include "temp_manager.hh"
+#include "core2_checkpoint.hh"
+
+CCore2Checkpoint::CCore2Checkpoint(const TCHAR *szImagePath,const ckfilesystem::FileSet &Files,
+                                   std::vector<ckcore::tuint32> *pBlockChecksums) :
+    m_ImagePath(szImagePath),m_JournalPath(szImagePath),m_uiFingerprint(GetFingerprint(Files)),
+    m_hImageFile(INVALID_HANDLE_VALUE),m_hJournalFile(INVALID_HANDLE_VALUE),
+    m_pBlockChecksums(pBlockChecksums),m_pBuffer(NULL),
+    m_ulBuffered(0),m_uiExtent(0),m_uiResumable(0),m_uiReused(0),m_uiWritten(0),
+    m_bFailed(false)
+{
+    m_JournalPath.append(_T(".resume"));
+}
+
+CCore2Checkpoint::~CCore2Checkpoint()
+{
+    Suspend();
+
+    if (m_pBuffer != NULL)
+        delete [] m_pBuffer;
+}
+
+/*
+    CCore2Checkpoint::ChecksumExtent
+    --------------------------------
+    Calculates the checksum of the ulSize buffered bytes of an extent from
+    the checksums of its blocks. The block checksums are stored in
+    pBlockChecksums, which must have room for the blocks of a complete
+    extent.
+*/
+ckcore::tuint32 CCore2Checkpoint::ChecksumExtent(unsigned long ulSize,ckcore::tuint32 *pBlockChecksums)
+{
+    unsigned long ulBlocks = 0;
+    for (unsigned long ulOffset = 0; ulOffset < ulSize; ulOffset += CORE2_CHECKPOINT_BLOCKSIZE)
+    {
+        pBlockChecksums[ulBlocks++] = ChecksumCrc32c(m_pBuffer + ulOffset,
+            min(ulSize - ulOffset,CORE2_CHECKPOINT_BLOCKSIZE));
+    }
+
+    return ChecksumCrc32c(pBlockChecksums,ulBlocks * sizeof(ckcore::tuint32));
+}
+
+/*
+    CCore2Checkpoint::ReadJournal
+    -----------------------------
+    Reads the extents from an existing journal. Returns false if the journal
+    doesn't belong to the file set being written.
+*/
+bool CCore2Checkpoint::ReadJournal()
+{
+    ckcore::tuint32 uiHeader[4];
+    unsigned long ulRead = 0;
+    if (!::ReadFile(m_hJournalFile,uiHeader,sizeof(uiHeader),&ulRead,NULL) ||
+        ulRead != sizeof(uiHeader))
+    {
+        return false;
+    }
+
+    if (uiHeader[0] != CORE2_CHECKPOINT_MAGIC || uiHeader[1] != CORE2_CHECKPOINT_VERSION ||
+        uiHeader[2] != CORE2_CHECKPOINT_EXTENTSIZE || uiHeader[3] != m_uiFingerprint)
+    {
+        return false;
+    }
+
+    LARGE_INTEGER liImageSize;
+    if (!::GetFileSizeEx(m_hImageFile,&liImageSize))
+        return false;
+
+    // Extents beyond the end of the image were never completely written.
+    unsigned __int64 uiMaxExtents = liImageSize.QuadPart / CORE2_CHECKPOINT_EXTENTSIZE;
+
+    ckcore::tuint32 uiEntry[2];
+    while (m_Extents.size() < uiMaxExtents &&
+           ::ReadFile(m_hJournalFile,uiEntry,sizeof(uiEntry),&ulRead,NULL) &&
+           ulRead == sizeof(uiEntry))
+    {
+        m_Extents.push_back(CExtent(uiEntry[0],uiEntry[1] != 0));
+
+        if (uiEntry[1] != 0)
+            m_uiResumable++;
+    }
+
+    // Drop any records of extents that are not in the image.
+    LARGE_INTEGER liOffset;
+    liOffset.QuadPart = sizeof(uiHeader) + (unsigned __int64)m_Extents.size() * sizeof(uiEntry);
+
+    return ::SetFilePointerEx(m_hJournalFile,liOffset,NULL,FILE_BEGIN) &&
+           ::SetEndOfFile(m_hJournalFile);
+}
+
+/*
+    CCore2Checkpoint::CheckExtents
+    ------------------------------
+    Reads a sample of the extents recorded in the journal back from the image
+    and compares their checksums. Returns false if the image has been changed
+    since the journal was written.
+*/
+bool CCore2Checkpoint::CheckExtents()
+{
+    if (m_uiResumable == 0)
+        return true;
+
+    // Check extents spread over the image, including the first and the last.
+    unsigned int uiStep = 1;
+    if (m_uiResumable > CORE2_CHECKPOINT_SAMPLES)
+        uiStep = (m_uiResumable + CORE2_CHECKPOINT_SAMPLES - 2) / (CORE2_CHECKPOINT_SAMPLES - 1);
+
+    unsigned int uiValid = 0;
+    for (unsigned int i = 0; i < m_Extents.size(); i++)
+    {
+        if (!m_Extents[i].m_bValid)
+            continue;
+
+        if (uiValid++ % uiStep != 0 && uiValid != m_uiResumable)
+            continue;
+
+        LARGE_INTEGER liOffset;
+        liOffset.QuadPart = (unsigned __int64)i * CORE2_CHECKPOINT_EXTENTSIZE;
+
+        unsigned long ulRead = 0;
+        if (!::SetFilePointerEx(m_hImageFile,liOffset,NULL,FILE_BEGIN) ||
+            !::ReadFile(m_hImageFile,m_pBuffer,CORE2_CHECKPOINT_EXTENTSIZE,&ulRead,NULL) ||
+            ulRead != CORE2_CHECKPOINT_EXTENTSIZE)
+        {
+            return false;
+        }
+
+        ckcore::tuint32 uiBlockChecksums[CORE2_CHECKPOINT_EXTENTSIZE / CORE2_CHECKPOINT_BLOCKSIZE];
+        if (ChecksumExtent(CORE2_CHECKPOINT_EXTENTSIZE,uiBlockChecksums) != m_Extents[i].m_uiChecksum)
+        {
+            g_pLogDlg->print_line(_T("  Extent %u of \"%s\" doesn't match the journal."),
+                                  i,m_ImagePath.c_str());
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool CCore2Checkpoint::WriteJournalEntry(unsigned int uiExtent,ckcore::tuint32 uiChecksum,
+                                         bool bValid)
+{
+    ckcore::tuint32 uiEntry[2] = { uiChecksum,bValid ? 1 : 0 };
+
+    LARGE_INTEGER liOffset;
+    liOffset.QuadPart = 4 * sizeof(ckcore::tuint32) + (unsigned __int64)uiExtent * sizeof(uiEntry);
+
+    unsigned long ulWritten = 0;
+    return ::SetFilePointerEx(m_hJournalFile,liOffset,NULL,FILE_BEGIN) &&
+           ::WriteFile(m_hJournalFile,uiEntry,sizeof(uiEntry),&ulWritten,NULL) &&
+           ulWritten == sizeof(uiEntry);
+}
+
+/*
+    CCore2Checkpoint::WriteExtent
+    -----------------------------
+    Writes the buffered extent to the image unless the journal shows that the
+    same data is already on disk. The block checksums of the extent are
+    recorded whether it's written or not.
+*/
+bool CCore2Checkpoint::WriteExtent()
+{
+    const unsigned long ulExtentBlocks = CORE2_CHECKPOINT_EXTENTSIZE / CORE2_CHECKPOINT_BLOCKSIZE;
+
+    unsigned int uiExtent = m_uiExtent++;
+    unsigned long ulSize = m_ulBuffered;
+    bool bComplete = ulSize == CORE2_CHECKPOINT_EXTENTSIZE;
+
+    ckcore::tuint32 uiBlockChecksums[ulExtentBlocks];
+    ckcore::tuint32 uiChecksum = ChecksumExtent(ulSize,uiBlockChecksums);
+
+    if (m_pBlockChecksums != NULL)
+    {
+        unsigned long ulBlocks = (ulSize + CORE2_CHECKPOINT_BLOCKSIZE - 1) / CORE2_CHECKPOINT_BLOCKSIZE;
+        m_pBlockChecksums->insert(m_pBlockChecksums->end(),uiBlockChecksums,uiBlockChecksums + ulBlocks);
+    }
+
+    m_ulBuffered = 0;
+    m_uiWritten += ulSize;
+
+    if (uiExtent < m_Extents.size() && m_Extents[uiExtent].m_bValid)
+    {
+        if (bComplete && m_Extents[uiExtent].m_uiChecksum == uiChecksum)
+        {
+            m_uiReused++;
+            return true;
+        }
+
+        // The extent differs from the one on disk, invalidate the journal
+        // record before the extent is overwritten.
+        m_Extents[uiExtent].m_bValid = false;
+        if (!WriteJournalEntry(uiExtent,0,false) || !::FlushFileBuffers(m_hJournalFile))
+            return false;
+    }
+
+    LARGE_INTEGER liOffset;
+    liOffset.QuadPart = (unsigned __int64)uiExtent * CORE2_CHECKPOINT_EXTENTSIZE;
+
+    unsigned long ulWritten = 0;
+    if (!::SetFilePointerEx(m_hImageFile,liOffset,NULL,FILE_BEGIN) ||
+        !::WriteFile(m_hImageFile,m_pBuffer,ulSize,&ulWritten,NULL) ||
+        ulWritten != ulSize)
+    {
+        return false;
+    }
+
+    // Only complete extents are recorded.
+    if (bComplete)
+    {
+        if (uiExtent < m_Extents.size())
+            m_Extents[uiExtent] = CExtent(uiChecksum,false);
+        else
+            m_Extents.push_back(CExtent(uiChecksum,false));
+
+        m_Pending.push_back(uiExtent);
+        if (m_Pending.size() >= CORE2_CHECKPOINT_INTERVAL)
+            return Checkpoint();
+    }
+
+    return true;
+}
+
+/*
+    CCore2Checkpoint::Checkpoint
+    ----------------------------
+    Flushes the image to disk and records the extents written since the last
+    checkpoint in the journal.
+*/
+bool CCore2Checkpoint::Checkpoint()
+{
+    if (m_Pending.empty())
+        return true;
+
+    if (!::FlushFileBuffers(m_hImageFile))
+        return false;
+
+    std::vector<unsigned int>::const_iterator itExtent;
+    for (itExtent = m_Pending.begin(); itExtent != m_Pending.end(); itExtent++)
+    {
+        if (!WriteJournalEntry(*itExtent,m_Extents[*itExtent].m_uiChecksum,true))
+            return false;
+
+        m_Extents[*itExtent].m_bValid = true;
+    }
+
+    m_Pending.clear();
+    return true;
+}
+
+void CCore2Checkpoint::CloseFiles()
+{
+    if (m_hImageFile != INVALID_HANDLE_VALUE)
+    {
+        ::CloseHandle(m_hImageFile);
+        m_hImageFile = INVALID_HANDLE_VALUE;
+    }
+
+    if (m_hJournalFile != INVALID_HANDLE_VALUE)
+    {
+        ::CloseHandle(m_hJournalFile);
+        m_hJournalFile = INVALID_HANDLE_VALUE;
+    }
+}
+
+/**
+    Opens the image for writing. If there is a journal from an earlier attempt
+    to write the same file set the image is resumed, otherwise a new image and
+    journal are created.
+    @return true if the image was opened, false otherwise.
+*/
+bool CCore2Checkpoint::Open()
+{
+    if (m_pBuffer == NULL)
+        m_pBuffer = new unsigned char[CORE2_CHECKPOINT_EXTENTSIZE];
+
+    if (m_pBlockChecksums != NULL)
+        m_pBlockChecksums->clear();
+
+    m_hJournalFile = ::CreateFile(m_JournalPath.c_str(),GENERIC_READ | GENERIC_WRITE,0,NULL,
+                                  OPEN_EXISTING,FILE_ATTRIBUTE_NORMAL,NULL);
+    if (m_hJournalFile != INVALID_HANDLE_VALUE)
+    {
+        m_hImageFile = ::CreateFile(m_ImagePath.c_str(),GENERIC_READ | GENERIC_WRITE,0,NULL,
+                                    OPEN_EXISTING,FILE_ATTRIBUTE_NORMAL,NULL);
+        if (m_hImageFile == INVALID_HANDLE_VALUE || !ReadJournal() || !CheckExtents())
+        {
+            CloseFiles();
+
+            m_Extents.clear();
+            m_uiResumable = 0;
+        }
+    }
+
+    if (m_hJournalFile != INVALID_HANDLE_VALUE)
+    {
+        g_pLogDlg->print_line(_T("  Resuming disc image creation, %u extents of %u bytes are available from the last attempt."),
+                              m_uiResumable,CORE2_CHECKPOINT_EXTENTSIZE);
+        return true;
+    }
+
+    m_hImageFile = ::CreateFile(m_ImagePath.c_str(),GENERIC_READ | GENERIC_WRITE,0,NULL,
+                                CREATE_ALWAYS,FILE_ATTRIBUTE_NORMAL,NULL);
+    if (m_hImageFile == INVALID_HANDLE_VALUE)
+    {
+        g_pLogDlg->print_line(_T("  Error: Unable to obtain file handle to \"%s\"."),m_ImagePath.c_str());
+        return false;
+    }
+
+    m_hJournalFile = ::CreateFile(m_JournalPath.c_str(),GENERIC_READ | GENERIC_WRITE,0,NULL,
+                                  CREATE_ALWAYS,FILE_ATTRIBUTE_NORMAL,NULL);
+    if (m_hJournalFile == INVALID_HANDLE_VALUE)
+    {
+        g_pLogDlg->print_line(_T("  Error: Unable to obtain file handle to \"%s\"."),m_JournalPath.c_str());
+        CloseFiles();
+        return false;
+    }
+
+    ckcore::tuint32 uiHeader[4] =
+    {
+        CORE2_CHECKPOINT_MAGIC,CORE2_CHECKPOINT_VERSION,CORE2_CHECKPOINT_EXTENTSIZE,m_uiFingerprint
+    };
+
+    unsigned long ulWritten = 0;
+    if (!::WriteFile(m_hJournalFile,uiHeader,sizeof(uiHeader),&ulWritten,NULL) ||
+        ulWritten != sizeof(uiHeader))
+    {
+        CloseFiles();
+        return false;
+    }
+
+    return true;
+}
+
+/**
+    Writes the remaining data, truncates the image and removes the journal.
+    @return true if the complete image was written, false otherwise.
+*/
+bool CCore2Checkpoint::Finish()
+{
+    if (m_hImageFile == INVALID_HANDLE_VALUE)
+        return false;
+
+    bool bResult = !m_bFailed;
+    if (bResult && m_ulBuffered > 0)
+        bResult = WriteExtent();
+
+    // Remove any data left from an earlier, larger, image.
+    if (bResult)
+    {
+        LARGE_INTEGER liSize;
+        liSize.QuadPart = m_uiWritten;
+
+        bResult = ::SetFilePointerEx(m_hImageFile,liSize,NULL,FILE_BEGIN) &&
+                  ::SetEndOfFile(m_hImageFile);
+    }
+
+    if (m_uiResumable > 0)
+    {
+        g_pLogDlg->print_line(_T("  Reused %u extents from the last attempt, %u extents were written again."),
+                              m_uiReused,m_uiExtent - m_uiReused);
+    }
+
+    CloseFiles();
+
+    // The image is complete and no longer temporary.
+    if (bResult)
+    {
+        ::DeleteFile(m_JournalPath.c_str());
+
+        g_TempManager.RemoveObject(m_ImagePath.c_str());
+        g_TempManager.RemoveObject(m_JournalPath.c_str());
+    }
+
+    return bResult;
+}
+
+/**
+    Stops writing and keeps the partial image and the journal so that the
+    image can be resumed later.
+*/
+void CCore2Checkpoint::Suspend()
+{
+    if (m_hImageFile == INVALID_HANDLE_VALUE)
+        return;
+
+    // Data that has not been checkpointed is written again on resume.
+    if (!m_bFailed)
+        Checkpoint();
+
+    unsigned int uiValid = 0;
+    std::vector<CExtent>::const_iterator itExtent;
+    for (itExtent = m_Extents.begin(); itExtent != m_Extents.end(); itExtent++)
+    {
+        if (itExtent->m_bValid)
+            uiValid++;
+    }
+
+    g_pLogDlg->print_line(_T("  Kept partial disc image \"%s\", %u extents can be resumed."),
+                          m_ImagePath.c_str(),uiValid);
+
+    CloseFiles();
+
+    // The image is kept when the application closes so that it can be
+    // resumed later, RemoveStale takes care of it if it never is.
+    g_TempManager.RemoveObject(m_ImagePath.c_str());
+    g_TempManager.RemoveObject(m_JournalPath.c_str());
+}
+
+/**
+    Calculates a fingerprint identifying a file set from the paths of its
+    files.
+*/
+ckcore::tuint32 CCore2Checkpoint::GetFingerprint(const ckfilesystem::FileSet &Files)
+{
+    ckcore::tuint32 uiFingerprint = 0;
+
+    ckfilesystem::FileSet::const_iterator itFile;
+    for (itFile = Files.begin(); itFile != Files.end(); itFile++)
+    {
+        const ckfilesystem::FileDescriptor *pFile = *itFile;
+
+        uiFingerprint = ChecksumCrc32c(pFile->internal_path_.c_str(),
+            pFile->internal_path_.size() * sizeof(ckcore::tchar),uiFingerprint);
+        uiFingerprint = ChecksumCrc32c(pFile->external_path_.c_str(),
+            pFile->external_path_.size() * sizeof(ckcore::tchar),uiFingerprint);
+    }
+
+    return uiFingerprint;
+}
+
+/**
+    Returns the path of a temporary image for the file set. The same file set
+    gives the same path so that a failed image can be resumed.
+*/
+ckcore::tstring CCore2Checkpoint::GetTempImagePath(const TCHAR *szTempPath,
+                                                   const ckfilesystem::FileSet &Files)
+{
+    TCHAR szFileName[32];
+    lsprintf(szFileName,_T("InfraRecorder-%08X.tmp"),GetFingerprint(Files));
+
+    ckcore::tstring ImagePath = szTempPath;
+    ImagePath.append(szFileName);
+    return ImagePath;
+}
+
+/**
+    Removes an image and its journal.
+*/
+void CCore2Checkpoint::Remove(const TCHAR *szImagePath)
+{
+    ckcore::tstring JournalPath = szImagePath;
+    JournalPath.append(_T(".resume"));
+
+    ::DeleteFile(szImagePath);
+    ::DeleteFile(JournalPath.c_str());
+
+    g_TempManager.RemoveObject(szImagePath);
+    g_TempManager.RemoveObject(JournalPath.c_str());
+}
+
+/**
+    Removes the kept images in the temporary directory that can no longer be
+    resumed: images whose journal is older than CORE2_CHECKPOINT_MAXAGE days
+    and images whose journal doesn't match the fingerprint in the file name.
+    Journals that are in use are left alone.
+    @param szTempPath the temporary directory, including a trailing
+    backslash.
+*/
+void CCore2Checkpoint::RemoveStale(const TCHAR *szTempPath)
+{
+    ckcore::tstring Pattern = szTempPath;
+    Pattern.append(_T("InfraRecorder-*.tmp.resume"));
+
+    WIN32_FIND_DATA FindData;
+    HANDLE hFind = ::FindFirstFile(Pattern.c_str(),&FindData);
+    if (hFind == INVALID_HANDLE_VALUE)
+        return;
+
+    FILETIME ftNow;
+    ::GetSystemTimeAsFileTime(&ftNow);
+
+    ULARGE_INTEGER uiNow;
+    uiNow.LowPart = ftNow.dwLowDateTime;
+    uiNow.HighPart = ftNow.dwHighDateTime;
+
+    // File times are measured in 100 nanosecond intervals.
+    const unsigned __int64 uiMaxAge = (unsigned __int64)CORE2_CHECKPOINT_MAXAGE * 24 * 60 * 60 * 10000000;
+
+    do
+    {
+        ckcore::tstring JournalPath = szTempPath;
+        JournalPath.append(FindData.cFileName);
+
+        ckcore::tstring ImagePath = JournalPath;
+        ImagePath.resize(ImagePath.size() - 7);	// ".resume"
+
+        ULARGE_INTEGER uiWriteTime;
+        uiWriteTime.LowPart = FindData.ftLastWriteTime.dwLowDateTime;
+        uiWriteTime.HighPart = FindData.ftLastWriteTime.dwHighDateTime;
+
+        bool bStale = uiNow.QuadPart > uiWriteTime.QuadPart &&
+            uiNow.QuadPart - uiWriteTime.QuadPart > uiMaxAge;
+
+        if (!bStale)
+        {
+            HANDLE hJournalFile = ::CreateFile(JournalPath.c_str(),GENERIC_READ,0,NULL,
+                                               OPEN_EXISTING,FILE_ATTRIBUTE_NORMAL,NULL);
+            if (hJournalFile == INVALID_HANDLE_VALUE)
+                continue;
+
+            // The file name is "InfraRecorder-XXXXXXXX.tmp.resume".
+            ckcore::tuint32 uiFingerprint = _tcstoul(FindData.cFileName + 14,NULL,16);
+
+            ckcore::tuint32 uiHeader[4];
+            unsigned long ulRead = 0;
+            bStale = !::ReadFile(hJournalFile,uiHeader,sizeof(uiHeader),&ulRead,NULL) ||
+                ulRead != sizeof(uiHeader) ||
+                uiHeader[0] != CORE2_CHECKPOINT_MAGIC || uiHeader[1] != CORE2_CHECKPOINT_VERSION ||
+                uiHeader[2] != CORE2_CHECKPOINT_EXTENTSIZE || uiHeader[3] != uiFingerprint;
+
+            ::CloseHandle(hJournalFile);
+        }
+
+        if (bStale)
+        {
+            g_pLogDlg->print_line(_T("  Removing stale partial disc image \"%s\"."),ImagePath.c_str());
+            Remove(ImagePath.c_str());
+        }
+    }
+    while (::FindNextFile(hFind,&FindData));
+
+    ::FindClose(hFind);
+}
+
+ckcore::tint64 CCore2Checkpoint::write(const void *pBuffer,ckcore::tuint32 uiCount)
+{
+    if (m_bFailed)
+        return -1;
+
+    const unsigned char *pData = (const unsigned char *)pBuffer;
+    ckcore::tuint32 uiRemaining = uiCount;
+
+    while (uiRemaining > 0)
+    {
+        unsigned long ulChunk = CORE2_CHECKPOINT_EXTENTSIZE - m_ulBuffered;
+        if (ulChunk > uiRemaining)
+            ulChunk = uiRemaining;
+
+        memcpy(m_pBuffer + m_ulBuffered,pData,ulChunk);
+        m_ulBuffered += ulChunk;
+
+        pData += ulChunk;
+        uiRemaining -= ulChunk;
+
+        if (m_ulBuffered == CORE2_CHECKPOINT_EXTENTSIZE && !WriteExtent())
+        {
+            g_pLogDlg->print_line(_T("  Error: Unable to write to \"%s\"."),m_ImagePath.c_str());
+
+            m_bFailed = true;
+            return -1;
+        }
+    }
+
+    return uiCount;
+}
@@ -0,0 +1,109 @@
+/*
+ * InfraRecorder - CD/DVD burning software
+ * Copyright (C) 2006-2012 Christian Kindahl
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#include <vector>
+#include <ckcore/types.hh>
+#include <ckcore/stream.hh>
+#include <ckfilesystem/fileset.hh>
+
+#define CORE2_CHECKPOINT_EXTENTSIZE			(8 * 1024 * 1024)
+#define CORE2_CHECKPOINT_BLOCKSIZE			(64 * 1024)			// Bytes in each checksummed block of an extent.
+#define CORE2_CHECKPOINT_INTERVAL			8					// Extents between checkpoints.
+#define CORE2_CHECKPOINT_MAGIC				0x4B435249			// "IRCK".
+#define CORE2_CHECKPOINT_VERSION			2
+#define CORE2_CHECKPOINT_SAMPLES			8					// Extents checked before resuming.
+#define CORE2_CHECKPOINT_MAXAGE				7					// Days a kept image can be resumed.
+
+// Writes a disc image and keeps a journal of the checksums of the extents
+// that have been written, next to the image. If the image creation fails or
+// is cancelled the partial image and the journal are kept. When the same
+// file set is written to the same image again, extents that are regenerated
+// with the checksum recorded in the journal are not written again. An
+// extent is only recorded in the journal once its data has been flushed to
+// disk, and its record is invalidated before the extent is rewritten. A
+// sample of the recorded extents is read back before an image is resumed. A
+// kept image survives restarts of the application, it's removed by
+// RemoveStale once it's too old to be resumed or its journal is invalid.
+// The checksum of an extent is calculated from the checksums of its blocks,
+// which can be passed on to the caller so that the image can be verified
+// without reading it back.
+class CCore2Checkpoint : public ckcore::OutStream
+{
+private:
+    class CExtent
+    {
+    public:
+        ckcore::tuint32 m_uiChecksum;
+        bool m_bValid;
+
+        CExtent(ckcore::tuint32 uiChecksum,bool bValid) : m_uiChecksum(uiChecksum),
+            m_bValid(bValid)
+        {
+        }
+    };
+
+    ckcore::tstring m_ImagePath;
+    ckcore::tstring m_JournalPath;
+    ckcore::tuint32 m_uiFingerprint;
+
+    HANDLE m_hImageFile;
+    HANDLE m_hJournalFile;
+
+    // All extents of the image, only the valid extents are recorded in the
+    // journal. Extents written since the last checkpoint are pending.
+    std::vector<CExtent> m_Extents;
+    std::vector<unsigned int> m_Pending;
+
+    std::vector<ckcore::tuint32> *m_pBlockChecksums;
+
+    unsigned char *m_pBuffer;
+    unsigned long m_ulBuffered;
+    unsigned int m_uiExtent;
+
+    unsigned int m_uiResumable;
+    unsigned int m_uiReused;
+    unsigned __int64 m_uiWritten;
+    bool m_bFailed;
+
+    ckcore::tuint32 ChecksumExtent(unsigned long ulSize,ckcore::tuint32 *pBlockChecksums);
+    bool ReadJournal();
+    bool CheckExtents();
+    bool WriteJournalEntry(unsigned int uiExtent,ckcore::tuint32 uiChecksum,bool bValid);
+    bool WriteExtent();
+    bool Checkpoint();
+    void CloseFiles();
+
+public:
+    CCore2Checkpoint(const TCHAR *szImagePath,const ckfilesystem::FileSet &Files,
+        std::vector<ckcore::tuint32> *pBlockChecksums = NULL);
+    ~CCore2Checkpoint();
+
+    bool Open();
+    bool Finish();
+    void Suspend();
+
+    static ckcore::tuint32 GetFingerprint(const ckfilesystem::FileSet &Files);
+    static ckcore::tstring GetTempImagePath(const TCHAR *szTempPath,
+        const ckfilesystem::FileSet &Files);
+    static void Remove(const TCHAR *szImagePath);
+    static void RemoveStale(const TCHAR *szTempPath);
+
+    // ckcore::OutStream.
+    ckcore::tint64 write(const void *pBuffer,ckcore::tuint32 uiCount);
+};
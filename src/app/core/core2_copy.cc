@@ -0,0 +1,726 @@
+/*
+ * InfraRecorder - CD/DVD burning software
+ * Copyright (C) 2006-2012 Christian Kindahl
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "stdafx.hh"
+#include <vector>
+#include <ckmmc/util.hh>
+#include "core2.hh"
+#include "core2_copy.hh"
+#include "core2_info.hh"
+#include "core2_stream.hh"
+#include "core2_util.hh"
+#include "pipe_buffer.hh"
+#include "log_dlg.hh"
+#include "settings.hh"
+#include "string_table.hh"
+#include "lang_util.hh"
+
+CCore2Copy::CWriteStream::CWriteStream(ckmmc::Device &Device,CAdvancedProgress *pProgress,
+                                       unsigned long ulStartAddr,unsigned long ulTotal) :
+    m_Device(Device),m_pProgress(pProgress),m_ulBuffered(0),m_ulNextAddr(ulStartAddr),
+    m_ulWritten(0),m_ulTotal(ulTotal)
+{
+    m_pBuffer = new unsigned char[CORE2_COPY_WRITEBLOCKS * 2048];
+}
+
+CCore2Copy::CWriteStream::~CWriteStream()
+{
+    delete [] m_pBuffer;
+}
+
+/*
+    CCore2Copy::CWriteStream::WriteBlocks
+    -------------------------------------
+    Writes the specified number of buffered sectors to the next writable
+    address. The command is repeated for as long as the recorder reports that
+    its buffer is full.
+*/
+bool CCore2Copy::CWriteStream::WriteBlocks(unsigned long ulNumBlocks)
+{
+    unsigned char ucCdb[16];
+    memset(ucCdb,0,sizeof(ucCdb));
+
+    unsigned char ucSense[24];
+    memset(ucSense,0,sizeof(ucSense));
+
+    ucCdb[0] = SCSI_WRITE10;
+    ucCdb[2] = static_cast<unsigned char>(m_ulNextAddr >> 24);
+    ucCdb[3] = static_cast<unsigned char>(m_ulNextAddr >> 16);
+    ucCdb[4] = static_cast<unsigned char>(m_ulNextAddr >> 8);
+    ucCdb[5] = static_cast<unsigned char>(m_ulNextAddr & 0xFF);
+    ucCdb[7] = static_cast<unsigned char>(ulNumBlocks >> 8);
+    ucCdb[8] = static_cast<unsigned char>(ulNumBlocks & 0xFF);
+    ucCdb[9] = 0x00;
+
+    while (true)
+    {
+        unsigned char ucResult = 0;
+        if (!m_Device.transport_with_sense(ucCdb,10,m_pBuffer,ulNumBlocks * 2048,
+                                           ckmmc::Device::ckTM_WRITE,ucSense,ucResult))
+        {
+            return false;
+        }
+
+        if (ucResult == SCSISTAT_GOOD)
+            break;
+
+        if (CheckSense(ucSense) != SENSE_LONGWRITEINPROGRESS)
+        {
+            g_pLogDlg->print_line(_T("  Error: Unable to write %u sectors at %u (sense %.2X/%.2X/%.2X)."),
+                ulNumBlocks,m_ulNextAddr,ucSense[2] & 0x0F,ucSense[12],ucSense[13]);
+            return false;
+        }
+
+        Sleep(CORE2_COPY_RETRYWAIT);
+    }
+
+    m_ulNextAddr += ulNumBlocks;
+    m_ulWritten += ulNumBlocks;
+
+    if (m_pProgress != NULL && m_ulTotal > 0)
+        m_pProgress->set_progress((unsigned char)(((unsigned __int64)m_ulWritten * 100) / m_ulTotal));
+
+    return true;
+}
+
+/*
+    CCore2Copy::CWriteStream::Flush
+    -------------------------------
+    Writes any buffered data to the disc, a partial sector is padded with
+    zeros.
+*/
+bool CCore2Copy::CWriteStream::Flush()
+{
+    if (m_ulBuffered == 0)
+        return true;
+
+    unsigned long ulNumBlocks = (m_ulBuffered + 2047) / 2048;
+    memset(m_pBuffer + m_ulBuffered,0,ulNumBlocks * 2048 - m_ulBuffered);
+
+    m_ulBuffered = 0;
+    return WriteBlocks(ulNumBlocks);
+}
+
+unsigned long CCore2Copy::CWriteStream::GetWritten()
+{
+    return m_ulWritten;
+}
+
+ckcore::tint64 CCore2Copy::CWriteStream::write(const void *pBuffer,ckcore::tuint32 uiCount)
+{
+    const unsigned char *pData = (const unsigned char *)pBuffer;
+    ckcore::tuint32 uiRemaining = uiCount;
+
+    while (uiRemaining > 0)
+    {
+        if (m_pProgress != NULL && m_pProgress->cancelled())
+            return -1;
+
+        unsigned long ulCopy = min(CORE2_COPY_WRITEBLOCKS * 2048 - m_ulBuffered,uiRemaining);
+        memcpy(m_pBuffer + m_ulBuffered,pData,ulCopy);
+
+        m_ulBuffered += ulCopy;
+        pData += ulCopy;
+        uiRemaining -= ulCopy;
+
+        if (m_ulBuffered == CORE2_COPY_WRITEBLOCKS * 2048)
+        {
+            m_ulBuffered = 0;
+            if (!WriteBlocks(CORE2_COPY_WRITEBLOCKS))
+                return -1;
+        }
+    }
+
+    return uiCount;
+}
+
+CCore2Copy::CCore2Copy() : m_usProfile(PROFILE_NONE),m_usTrackNumber(0),
+    m_ulNextWritableAddr(0),m_ulPadBlocks(0)
+{
+}
+
+CCore2Copy::~CCore2Copy()
+{
+}
+
+/*
+    CCore2Copy::GetSourceTrack
+    --------------------------
+    Locates the data track on the source disc. Returns false if the disc
+    contains anything but a single session with a single mode 1 data track.
+*/
+bool CCore2Copy::GetSourceTrack(ckmmc::Device &Device,unsigned long &ulTrackAddr,
+                                unsigned long &ulTrackSize)
+{
+    CCore2Info Info(g_pLogDlg);
+
+    CCore2DiscInfo DiscInfo;
+    if (!Info.ReadDiscInformation(Device,&DiscInfo))
+    {
+        g_pLogDlg->print_line(_T("  Unable to read source disc information."));
+        return false;
+    }
+
+    if (DiscInfo.m_usNumSessions != 1)
+    {
+        g_pLogDlg->print_line(_T("  The source disc contains %u sessions."),DiscInfo.m_usNumSessions);
+        return false;
+    }
+
+    unsigned char ucFirstTrackNumber = 0,ucLastTrackNumber = 0;
+    std::vector<CCore2TOCTrackDesc> Tracks;
+
+    if (!Info.ReadTOC(Device,ucFirstTrackNumber,ucLastTrackNumber,Tracks) || Tracks.empty())
+    {
+        g_pLogDlg->print_line(_T("  Unable to read the source disc TOC."));
+        return false;
+    }
+
+    if (ucFirstTrackNumber != ucLastTrackNumber)
+    {
+        g_pLogDlg->print_line(_T("  The source disc contains %d tracks."),
+            ucLastTrackNumber - ucFirstTrackNumber + 1);
+        return false;
+    }
+
+    CCore2TrackInfo TrackInfo;
+    if (!Info.ReadTrackInformation(Device,CCore2Info::TIT_LBA,Tracks[0].m_ulTrackAddr,&TrackInfo))
+    {
+        g_pLogDlg->print_line(_T("  Unable to read source track information."));
+        return false;
+    }
+
+    // Only data tracks with 2048 byte sectors can be written using WRITE commands.
+    if (!(TrackInfo.m_ucTrackMode & 0x04) || TrackInfo.m_ucDataMode != CCore2TrackInfo::DM_MODE1)
+    {
+        g_pLogDlg->print_line(_T("  The source track is not a mode 1 data track (%d, %d)."),
+            TrackInfo.m_ucTrackMode,TrackInfo.m_ucDataMode);
+        return false;
+    }
+
+    ulTrackAddr = TrackInfo.m_ulTrackAddr;
+    ulTrackSize = TrackInfo.m_ulTrackSize;
+
+    // The track size may include run-out sectors that can't be read.
+    unsigned long ulLastAddr = 0,ulBlockLength = 0;
+    if (Info.ReadCapacity(Device,ulLastAddr,ulBlockLength) &&
+        ulLastAddr + 1 - ulTrackAddr < ulTrackSize)
+    {
+        ulTrackSize = ulLastAddr + 1 - ulTrackAddr;
+    }
+
+    g_pLogDlg->print_line(_T("  Source track span: %u-%u."),ulTrackAddr,ulTrackAddr + ulTrackSize);
+    return true;
+}
+
+unsigned short CCore2Copy::GetProfile(ckmmc::Device &Device)
+{
+    unsigned char ucBuffer[8];
+    memset(ucBuffer,0,sizeof(ucBuffer));
+
+    unsigned char ucCdb[16];
+    memset(ucCdb,0,sizeof(ucCdb));
+
+    ucCdb[0] = SCSI_GET_CONFIGURATION;
+    ucCdb[8] = sizeof(ucBuffer);
+
+    if (!Device.transport(ucCdb,9,ucBuffer,sizeof(ucBuffer),ckmmc::Device::ckTM_READ))
+        return PROFILE_NONE;
+
+    return ucBuffer[6] << 8 | ucBuffer[7];
+}
+
+/*
+    CCore2Copy::PrepareTarget
+    -------------------------
+    Makes sure that the target disc can be written to sequentially and that
+    it has room for the source track. Returns false if the disc is not
+    supported.
+*/
+bool CCore2Copy::PrepareTarget(ckmmc::Device &Device,unsigned long ulTrackSize,bool bSimulate)
+{
+    m_usProfile = GetProfile(Device);
+    g_pLogDlg->print_line(_T("  Target profile: 0x%.4X."),m_usProfile);
+
+    bool bWriteOnce = false;
+    switch (m_usProfile)
+    {
+        case PROFILE_CDR:
+        case PROFILE_CDRW:
+        case PROFILE_DVDMINUSR_SEQ:
+        case PROFILE_DVDMINUSRW_SEQ:
+        case PROFILE_DVDMINUSR_DL_SEQ:
+            // The track is written track-at-once, or incremental on DVD-R.
+            if (g_BurnImageSettings.m_iWriteMethod != WRITEMETHOD_TAO)
+            {
+                g_pLogDlg->print_line(_T("  Write method %d is not supported."),
+                    g_BurnImageSettings.m_iWriteMethod);
+                return false;
+            }
+
+            bWriteOnce = true;
+            break;
+
+        case PROFILE_DVDPLUSR:
+        case PROFILE_DVDPLUSR_DL:
+        case PROFILE_BDR_SRM:
+            // Test writing is only supported through mode page 5.
+            if (bSimulate)
+                return false;
+
+            bWriteOnce = true;
+            break;
+
+        case PROFILE_DVDPLUSRW:
+        case PROFILE_DVDPLUSRW_DL:
+        case PROFILE_DVDRAM:
+        case PROFILE_BDRE:
+            if (bSimulate)
+                return false;
+            break;
+
+        default:
+            return false;
+    }
+
+    CCore2Info Info(g_pLogDlg);
+    if (bWriteOnce)
+    {
+        CCore2DiscInfo DiscInfo;
+        if (!Info.ReadDiscInformation(Device,&DiscInfo))
+            return false;
+
+        if (DiscInfo.m_ucDiscStatus != CCore2DiscInfo::DS_EMTPY)
+        {
+            g_pLogDlg->print_line(_T("  The target disc is not blank."));
+            return false;
+        }
+
+        // The invisible track.
+        CCore2TrackInfo TrackInfo;
+        if (!Info.ReadTrackInformation(Device,CCore2Info::TIT_TRACK,0xFF,&TrackInfo) ||
+            !(TrackInfo.m_ucFlags & CCore2TrackInfo::FLAG_NWAV))
+        {
+            g_pLogDlg->print_line(_T("  Unable to obtain the next writable address of the target disc."));
+            return false;
+        }
+
+        m_usTrackNumber = TrackInfo.m_usTrackNumber;
+        m_ulNextWritableAddr = TrackInfo.m_ulNextWritableAddr;
+
+        if (TrackInfo.m_ulFreeBlocks < ulTrackSize)
+        {
+            g_pLogDlg->print_line(_T("  The target disc is too small (%u free sectors)."),
+                TrackInfo.m_ulFreeBlocks);
+            return false;
+        }
+    }
+    else
+    {
+        // A DVD+RW disc must be formatted before it can be written to.
+        if (m_usProfile == PROFILE_DVDPLUSRW || m_usProfile == PROFILE_DVDPLUSRW_DL)
+        {
+            CCore2DiscInfo DiscInfo;
+            if (!Info.ReadDiscInformation(Device,&DiscInfo))
+                return false;
+
+            if (DiscInfo.m_ucBgFormatStatus == CCore2DiscInfo::BGFS_NONE)
+            {
+                g_pLogDlg->print_line(_T("  The target disc has not been formatted."));
+                return false;
+            }
+        }
+
+        unsigned long ulLastAddr = 0,ulBlockLength = 0;
+        if (!Info.ReadCapacity(Device,ulLastAddr,ulBlockLength) || ulLastAddr + 1 < ulTrackSize)
+        {
+            g_pLogDlg->print_line(_T("  The target disc is too small."));
+            return false;
+        }
+
+        m_usTrackNumber = 1;
+        m_ulNextWritableAddr = 0;
+    }
+
+    g_pLogDlg->print_line(_T("  Target track %u starts at %u."),m_usTrackNumber,m_ulNextWritableAddr);
+
+    switch (m_usProfile)
+    {
+        case PROFILE_CDR:
+        case PROFILE_CDRW:
+        case PROFILE_DVDMINUSR_SEQ:
+        case PROFILE_DVDMINUSRW_SEQ:
+        case PROFILE_DVDMINUSR_DL_SEQ:
+            if (!SetWriteParameters(Device,bSimulate))
+            {
+                g_pLogDlg->print_line(_T("  Unable to set the write parameters."));
+                return false;
+            }
+            break;
+    }
+
+    return true;
+}
+
+/*
+    CCore2Copy::SetWriteParameters
+    ------------------------------
+    Updates mode page 5 for writing a single data track, track-at-once on
+    CDs and incremental on DVD-R media. The disc is not left open for more
+    sessions.
+*/
+bool CCore2Copy::SetWriteParameters(ckmmc::Device &Device,bool bSimulate)
+{
+    unsigned char ucBuffer[128];
+    memset(ucBuffer,0,sizeof(ucBuffer));
+
+    unsigned char ucCdb[16];
+    memset(ucCdb,0,sizeof(ucCdb));
+
+    ucCdb[0] = SCSI_MODE_SENSE10;
+    ucCdb[2] = 0x05;					// Current values and code page.
+    ucCdb[7] = sizeof(ucBuffer) >> 8;	// Allocation length (MSB).
+    ucCdb[8] = sizeof(ucBuffer) & 0xFF;	// Allocation length (LSB).
+    ucCdb[9] = 0x00;
+
+    if (!Device.transport(ucCdb,10,ucBuffer,sizeof(ucBuffer),
+                          ckmmc::Device::ckTM_READ))
+    {
+        return false;
+    }
+
+    if ((ucBuffer[8] & 0x3F) != 0x05)
+        return false;
+
+    bool bCD = m_usProfile == PROFILE_CDR || m_usProfile == PROFILE_CDRW;
+
+    // Write type, test write and buffer underrun protection.
+    ucBuffer[8 + 2] = bCD ? 0x01 : 0x00;
+    if (bSimulate)
+        ucBuffer[8 + 2] |= 0x10;
+    if (g_BurnImageSettings.m_bBUP)
+        ucBuffer[8 + 2] |= 0x40;
+
+    ucBuffer[8 + 3] = bCD ? 0x04 : 0x05;	// No multi-session, data track.
+    ucBuffer[8 + 4] = 0x08;					// Mode 1, 2048 bytes.
+    ucBuffer[8 + 8] = 0x00;					// CD-ROM session format.
+
+    unsigned short usFileListSize = (ucBuffer[0] << 8 | ucBuffer[1]) + 2;
+
+    memset(ucCdb,0,sizeof(ucCdb));
+    ucCdb[0] = SCSI_MODE_SELECT10;
+    ucCdb[1] = 0x10;	// PF (not using vendor specified mode page).
+    ucCdb[7] = static_cast<unsigned char>(usFileListSize >> 8);
+    ucCdb[8] = static_cast<unsigned char>(usFileListSize & 0xFF);
+    ucCdb[9] = 0x00;
+
+    // The mode data length is reserved in mode select.
+    ucBuffer[0] = ucBuffer[1] = 0;
+
+    return Device.transport(ucCdb,10,ucBuffer,usFileListSize,
+                            ckmmc::Device::ckTM_WRITE);
+}
+
+bool CCore2Copy::SynchronizeCache(ckmmc::Device &Device)
+{
+    unsigned char ucCdb[16];
+    memset(ucCdb,0,sizeof(ucCdb));
+
+    ucCdb[0] = SCSI_SYNCHRONIZE_CACHE;
+    ucCdb[1] = 0x02;	// Immed.
+    ucCdb[9] = 0x00;
+
+    if (!Device.transport(ucCdb,10,NULL,0,ckmmc::Device::ckTM_READ))
+        return false;
+
+    return g_Core2.WaitForUnit(Device,NULL);
+}
+
+/*
+    CCore2Copy::CloseTarget
+    -----------------------
+    Flushes the recorder cache and closes the track and the session on write
+    once media. The DVD+R session is closed by finalizing the disc.
+*/
+bool CCore2Copy::CloseTarget(ckmmc::Device &Device,CAdvancedProgress *pProgress)
+{
+    if (!SynchronizeCache(Device))
+    {
+        g_pLogDlg->print_line(_T("  Error: Unable to synchronize the recorder cache."));
+        return false;
+    }
+
+    unsigned char ucCloseSession = 0x02;
+    switch (m_usProfile)
+    {
+        case PROFILE_DVDPLUSRW:
+        case PROFILE_DVDPLUSRW_DL:
+            // Stop the background format.
+            if (!g_Core2.CloseTrackSession(Device,0x00,0x00,true))
+                g_pLogDlg->print_line(_T("  Warning: Unable to stop the background format."));
+            return g_Core2.WaitForUnit(Device,pProgress);
+
+        case PROFILE_DVDRAM:
+        case PROFILE_BDRE:
+            return true;
+
+        case PROFILE_DVDPLUSR:
+        case PROFILE_DVDPLUSR_DL:
+            ucCloseSession = 0x05;
+            break;
+    }
+
+    pProgress->set_status(lngGetString(STATUS_CLOSETRACK));
+
+    if (!g_Core2.CloseTrackSession(Device,0x01,m_usTrackNumber,true) ||
+        !g_Core2.WaitForUnit(Device,pProgress))
+    {
+        g_pLogDlg->print_line(_T("  Error: Unable to close the track."));
+        return false;
+    }
+
+    pProgress->set_status(lngGetString(STATUS_FIXATE));
+
+    if (!g_Core2.CloseTrackSession(Device,ucCloseSession,0,true) ||
+        !g_Core2.WaitForUnit(Device,pProgress))
+    {
+        g_pLogDlg->print_line(_T("  Error: Unable to close the session."));
+        return false;
+    }
+
+    return true;
+}
+
+/*
+    CCore2Copy::GetReadSpeed
+    ------------------------
+    Translates a read speed selected in the user interface, as a CD speed
+    multiple, into the speed in kB/s reported by the device.
+*/
+unsigned short CCore2Copy::GetReadSpeed(ckmmc::Device &Device,int iReadSpeed)
+{
+    if (iReadSpeed == -1)
+        return 0xFFFF;
+
+    const std::vector<ckcore::tuint32> &ReadSpeeds = Device.read_speeds();
+    std::vector<ckcore::tuint32>::const_iterator it;
+    for (it = ReadSpeeds.begin(); it != ReadSpeeds.end(); it++)
+    {
+        if (ckmmc::util::kb_to_human_speed(*it,ckmmc::Device::ckPROFILE_CDR) == iReadSpeed)
+            return static_cast<unsigned short>(*it);
+    }
+
+    return 0xFFFF;
+}
+
+/*
+    CCore2Copy::GetWriteSpeed
+    -------------------------
+    Translates a write speed selected in the user interface into the speed in
+    kB/s reported by the device.
+*/
+unsigned short CCore2Copy::GetWriteSpeed(ckmmc::Device &Device,int iWriteSpeed)
+{
+    if (iWriteSpeed == -1)
+        return 0xFFFF;
+
+    ckmmc::Device::Profile Profile = Device.profile();
+
+    const std::vector<ckcore::tuint32> &WriteSpeeds = Device.write_speeds();
+    std::vector<ckcore::tuint32>::const_iterator it;
+    for (it = WriteSpeeds.begin(); it != WriteSpeeds.end(); it++)
+    {
+        if (ckmmc::util::kb_to_human_speed(*it,Profile) == iWriteSpeed)
+            return static_cast<unsigned short>(*it);
+    }
+
+    return 0xFFFF;
+}
+
+/*
+    CCore2Copy::CopyDisc
+    --------------------
+    Copies the data track of the disc in SrcDevice to the disc in DstDevice.
+    Returns RESULT_UNSUPPORTED before anything has been written if the discs
+    can't be copied natively.
+*/
+CCore2Copy::eResult CCore2Copy::CopyDisc(ckmmc::Device &SrcDevice,ckmmc::Device &DstDevice,
+                                         CAdvancedProgress *pProgress,bool bSimulate,
+                                         int iReadSpeed,int iWriteSpeed)
+{
+    if (g_GlobalSettings.m_bLog)
+    {
+        g_pLogDlg->print_line(_T("CCore2Copy::CopyDisc"));
+        g_pLogDlg->print_line(_T("  Simulate = %d, ReadSpeed = %d, WriteSpeed = %d."),
+            (int)bSimulate,iReadSpeed,iWriteSpeed);
+    }
+
+    if (&SrcDevice == &DstDevice)
+        return RESULT_UNSUPPORTED;
+
+    unsigned long ulTrackAddr = 0,ulTrackSize = 0;
+    if (!GetSourceTrack(SrcDevice,ulTrackAddr,ulTrackSize) || ulTrackSize == 0)
+        return RESULT_UNSUPPORTED;
+
+    m_ulPadBlocks = g_BurnImageSettings.m_bPadTracks ? CORE2_COPY_PADBLOCKS : 0;
+
+    if (!PrepareTarget(DstDevice,ulTrackSize + m_ulPadBlocks,bSimulate))
+        return RESULT_UNSUPPORTED;
+
+    CCore2::CWaitStatistics SrcWaitStatistics = g_Core2.GetWaitStatistics(SrcDevice);
+    CCore2::CWaitStatistics DstWaitStatistics = g_Core2.GetWaitStatistics(DstDevice);
+
+    // Reading data from the source is handled by the buffer from here on.
+    pProgress->SetRealMode(!bSimulate);
+    pProgress->AllowCancel(true);
+    pProgress->notify(ckcore::Progress::ckINFORMATION,lngGetString(PROGRESS_BEGINWRITE),
+        lngGetString(bSimulate ? WRITEMODE_SIMULATION : WRITEMODE_REAL));
+    pProgress->set_status(lngGetString(STATUS_COPYDISC));
+
+    // The read speed is only lowered below the selected speed.
+    unsigned short usMaxReadSpeed = GetReadSpeed(SrcDevice,iReadSpeed);
+    unsigned short usReadSpeed = usMaxReadSpeed;
+    if (!g_Core2.SetDiscSpeeds(SrcDevice,usReadSpeed,0xFFFF))
+        g_pLogDlg->print_line(_T("  Warning: Unable to set the source read speed."));
+    if (!g_Core2.SetDiscSpeeds(DstDevice,0xFFFF,GetWriteSpeed(DstDevice,iWriteSpeed)))
+        g_pLogDlg->print_line(_T("  Warning: Unable to set the target write speed."));
+
+    g_Core2.LockMedia(DstDevice,true);
+
+    CCore2InStream InStream(g_pLogDlg,SrcDevice,ulTrackAddr,ulTrackAddr + ulTrackSize);
+    CWriteStream WriteStream(DstDevice,pProgress,m_ulNextWritableAddr,ulTrackSize + m_ulPadBlocks);
+
+    // The buffer can't be larger than the track. If the buffer is disabled or
+    // can't be allocated the data is written as it's read.
+    unsigned long ulBufferSize = (unsigned long)g_GlobalSettings.m_iPipeBufferSize << 20;
+    if (ulBufferSize > ulTrackSize * 2048)
+        ulBufferSize = ulTrackSize * 2048;
+
+    CPipeBuffer Buffer(WriteStream,pProgress,ulBufferSize);
+    bool bBuffered = ulBufferSize > 0 && Buffer.Start();
+    if (!bBuffered)
+        g_pLogDlg->print_line(_T("  Copying without a recording buffer."));
+
+    ckcore::OutStream &OutStream = bBuffered ? static_cast<ckcore::OutStream &>(Buffer) : WriteStream;
+
+    std::vector<unsigned char> ReadBuffer(CORE2_COPY_READSIZE);
+
+    unsigned __int64 uiRemaining = (unsigned __int64)ulTrackSize * 2048;
+    unsigned __int64 uiBuffered = 0;
+    unsigned __int64 uiLastWritten = 0;
+    unsigned long ulLastAdjust = ::GetTickCount();
+    unsigned long ulSpeedChanges = 0;
+    bool bResult = true;
+
+    while (uiRemaining > 0)
+    {
+        if (pProgress->cancelled())
+        {
+            bResult = false;
+            break;
+        }
+
+        ckcore::tuint32 uiRead = (ckcore::tuint32)min(uiRemaining,(unsigned __int64)ReadBuffer.size());
+        if (InStream.read(&ReadBuffer[0],uiRead) != uiRead)
+        {
+            g_pLogDlg->print_line(_T("  Error: Unable to read from the source disc."));
+            bResult = false;
+            break;
+        }
+
+        if (OutStream.write(&ReadBuffer[0],uiRead) != uiRead)
+        {
+            bResult = false;
+            break;
+        }
+
+        uiRemaining -= uiRead;
+        uiBuffered += uiRead;
+
+        // Keep the buffer full without making the source drive stop and
+        // start: read at roughly the rate the recorder is consuming the data
+        // while the buffer is full, and at full speed when it's draining.
+        unsigned long ulElapsed = ::GetTickCount() - ulLastAdjust;
+        if (bBuffered && ulElapsed >= CORE2_COPY_SPEEDINTERVAL)
+        {
+            unsigned __int64 uiWritten = (unsigned __int64)WriteStream.GetWritten() * 2048;
+            unsigned long ulWriteRate = (unsigned long)((uiWritten - uiLastWritten) / ulElapsed);	// kB/s.
+
+            unsigned short usNewSpeed = usReadSpeed;
+            int iFillLevel = Buffer.GetFillLevel();
+            if (iFillLevel >= CORE2_COPY_HIGHFILLLEVEL && ulWriteRate > 0)
+                usNewSpeed = (unsigned short)min(ulWriteRate + ulWriteRate / 4,usMaxReadSpeed);
+            else if (iFillLevel < CORE2_COPY_LOWFILLLEVEL)
+                usNewSpeed = usMaxReadSpeed;
+
+            if (usNewSpeed != usReadSpeed && g_Core2.SetDiscSpeeds(SrcDevice,usNewSpeed,0xFFFF))
+            {
+                usReadSpeed = usNewSpeed;
+                ulSpeedChanges++;
+            }
+
+            uiLastWritten = uiWritten;
+            ulLastAdjust = ::GetTickCount();
+        }
+    }
+
+    // Pad the track with empty sectors.
+    if (bResult && m_ulPadBlocks > 0)
+    {
+        memset(&ReadBuffer[0],0,ReadBuffer.size());
+
+        unsigned __int64 uiPadRemaining = (unsigned __int64)m_ulPadBlocks * 2048;
+        while (uiPadRemaining > 0)
+        {
+            ckcore::tuint32 uiPad = (ckcore::tuint32)min(uiPadRemaining,(unsigned __int64)ReadBuffer.size());
+            if (OutStream.write(&ReadBuffer[0],uiPad) != uiPad)
+            {
+                bResult = false;
+                break;
+            }
+
+            uiPadRemaining -= uiPad;
+        }
+    }
+
+    if ((bBuffered && !Buffer.Close()) || !WriteStream.Flush())
+        bResult = false;
+
+    g_pLogDlg->print_line(_T("  Read %u sectors in %u commands, changed the read speed %u times."),
+        InStream.GetBlocksRead(),InStream.GetReadCount(),ulSpeedChanges);
+
+    if (bResult)
+        bResult = CloseTarget(DstDevice,pProgress);
+
+    g_Core2.LogWaitStatistics(SrcDevice,SrcWaitStatistics);
+    g_Core2.LogWaitStatistics(DstDevice,DstWaitStatistics);
+
+    g_Core2.SetDiscSpeeds(SrcDevice,0xFFFF,0xFFFF);
+    g_Core2.LockMedia(DstDevice,false);
+
+    if (!bResult)
+    {
+        if (!pProgress->cancelled())
+            pProgress->notify(ckcore::Progress::ckERROR,lngGetString(FAILURE_COPYDISC));
+        return RESULT_FAIL;
+    }
+
+    pProgress->set_progress(100);
+    pProgress->notify(ckcore::Progress::ckINFORMATION,lngGetString(SUCCESS_COPYDISC));
+    return RESULT_OK;
+}
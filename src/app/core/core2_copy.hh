@@ -0,0 +1,103 @@
+/*
+ * InfraRecorder - CD/DVD burning software
+ * Copyright (C) 2006-2012 Christian Kindahl
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#include <ckcore/stream.hh>
+#include <ckmmc/device.hh>
+#include "advanced_progress.hh"
+
+#define CORE2_COPY_WRITEBLOCKS				32		// Sectors in each write command.
+#define CORE2_COPY_READSIZE					(64 * 1024)
+#define CORE2_COPY_RETRYWAIT				10		// Milliseconds to wait when the recorder buffer is full.
+#define CORE2_COPY_SPEEDINTERVAL			2000	// Milliseconds between read speed adjustments.
+#define CORE2_COPY_HIGHFILLLEVEL			90		// Percent.
+#define CORE2_COPY_LOWFILLLEVEL				50		// Percent.
+#define CORE2_COPY_PADBLOCKS				15		// Sectors of padding, the same as cdrecord.
+
+// Copies a single session data disc from one drive to another without an
+// intermediate image. The source track is read using CCore2InStream into a
+// CPipeBuffer ring buffer which is emptied into the recorder using WRITE
+// commands. The read speed of the source drive is lowered to roughly the
+// write speed when the buffer is kept full, and raised to the selected read
+// speed again when the fill level drops. Without a buffer the data is written
+// as it's read. Discs that can't be copied this way, audio,
+// mixed mode and multi-session discs, are reported as unsupported so that
+// the caller can fall back on cdrtools. So are write methods other than
+// track-at-once on media where the write method applies, and DVD+RW discs
+// that have never been formatted.
+class CCore2Copy
+{
+public:
+    enum eResult
+    {
+        RESULT_OK,
+        RESULT_FAIL,
+        RESULT_UNSUPPORTED
+    };
+
+private:
+    // Writes the data passed to it sequentially to the recorder.
+    class CWriteStream : public ckcore::OutStream
+    {
+    private:
+        ckmmc::Device &m_Device;
+        CAdvancedProgress *m_pProgress;
+
+        unsigned char *m_pBuffer;
+        unsigned long m_ulBuffered;
+
+        unsigned long m_ulNextAddr;
+        unsigned long m_ulWritten;
+        const unsigned long m_ulTotal;
+
+        bool WriteBlocks(unsigned long ulNumBlocks);
+
+    public:
+        CWriteStream(ckmmc::Device &Device,CAdvancedProgress *pProgress,
+            unsigned long ulStartAddr,unsigned long ulTotal);
+        ~CWriteStream();
+
+        bool Flush();
+        unsigned long GetWritten();
+
+        // ckcore::OutStream.
+        ckcore::tint64 write(const void *pBuffer,ckcore::tuint32 uiCount);
+    };
+
+    unsigned short m_usProfile;
+    unsigned short m_usTrackNumber;
+    unsigned long m_ulNextWritableAddr;
+    unsigned long m_ulPadBlocks;
+
+    bool GetSourceTrack(ckmmc::Device &Device,unsigned long &ulTrackAddr,
+        unsigned long &ulTrackSize);
+    unsigned short GetProfile(ckmmc::Device &Device);
+    bool PrepareTarget(ckmmc::Device &Device,unsigned long ulTrackSize,bool bSimulate);
+    bool SetWriteParameters(ckmmc::Device &Device,bool bSimulate);
+    bool SynchronizeCache(ckmmc::Device &Device);
+    bool CloseTarget(ckmmc::Device &Device,CAdvancedProgress *pProgress);
+    unsigned short GetReadSpeed(ckmmc::Device &Device,int iReadSpeed);
+    unsigned short GetWriteSpeed(ckmmc::Device &Device,int iWriteSpeed);
+
+public:
+    CCore2Copy();
+    ~CCore2Copy();
+
+    eResult CopyDisc(ckmmc::Device &SrcDevice,ckmmc::Device &DstDevice,
+        CAdvancedProgress *pProgress,bool bSimulate,int iReadSpeed,int iWriteSpeed);
+};
@@ -0,0 +1,472 @@
+/*
+ * InfraRecorder - CD/DVD burning software
+ * Copyright (C) 2006-2012 Christian Kindahl
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "stdafx.hh"
+#include <memory>
+#include <set>
+#include <base/checksum_util.hh>
+#include "core2_dedup.hh"
+#include "log_dlg.hh"
+
+// Numerical values of directory records, ISO9660 7.3.1 and 7.3.3.
+static unsigned long Read731(const unsigned char *pBuffer)
+{
+    return (unsigned long)pBuffer[0] | ((unsigned long)pBuffer[1] << 8) |
+        ((unsigned long)pBuffer[2] << 16) | ((unsigned long)pBuffer[3] << 24);
+}
+
+static void Write733(unsigned char *pBuffer,unsigned long ulValue)
+{
+    for (int i = 0; i < 4; i++)
+    {
+        pBuffer[i] = (unsigned char)(ulValue >> (i * 8));
+        pBuffer[7 - i] = (unsigned char)(ulValue >> (i * 8));
+    }
+}
+
+CCore2Dedup::CCore2Dedup()
+{
+}
+
+CCore2Dedup::~CCore2Dedup()
+{
+    for (unsigned int i = 0; i < m_ImportData.size(); i++)
+        delete m_ImportData[i];
+
+    m_ImportData.clear();
+}
+
+/*
+    CCore2Dedup::AddFiles
+    ---------------------
+    Adds the files of the file set that occupy data in the image. Files that
+    don't fit in a single extent are skipped.
+*/
+void CCore2Dedup::AddFiles(const ckfilesystem::FileSet &Files)
+{
+    ckfilesystem::FileSet::const_iterator itFile;
+    for (itFile = Files.begin(); itFile != Files.end(); itFile++)
+    {
+        const ckfilesystem::FileDescriptor *pFile = *itFile;
+        if (pFile->flags_ & (ckfilesystem::FileDescriptor::FLAG_DIRECTORY |
+            ckfilesystem::FileDescriptor::FLAG_IMPORTED))
+        {
+            continue;
+        }
+
+        WIN32_FILE_ATTRIBUTE_DATA FileData;
+        if (!GetFileAttributesEx(pFile->external_path_.c_str(),GetFileExInfoStandard,&FileData) ||
+            FileData.nFileSizeHigh != 0)
+        {
+            continue;
+        }
+
+        m_Dedup.AddFile(pFile->external_path_.c_str(),FileData.nFileSizeLow);
+        m_Files.push_back(pFile);
+    }
+}
+
+/*
+    CCore2Dedup::Prepare
+    --------------------
+    Finds the duplicate files of the file set and creates a copy of the file
+    set in DedupFiles where the duplicates are replaced by placeholders. The
+    copy refers to data owned by this object and must be destroyed before it.
+    Returns false if there are no duplicates, in which case DedupFiles is
+    left untouched.
+*/
+bool CCore2Dedup::Prepare(const ckfilesystem::FileSet &Files,ckfilesystem::FileSet &DedupFiles)
+{
+    AddFiles(Files);
+    m_Dedup.Run();
+
+    if (m_Dedup.GetDuplicateCount() == 0)
+        return false;
+
+    // Assign a placeholder to the contents of each file that has duplicates.
+    std::map<unsigned int,unsigned int> GroupMap;
+    std::map<const ckfilesystem::FileDescriptor *,unsigned int> Duplicates;
+    for (unsigned int i = 0; i < m_Files.size(); i++)
+    {
+        int iOriginal = m_Dedup.GetOriginal(i);
+        if (iOriginal == -1)
+            continue;
+
+        std::map<unsigned int,unsigned int>::const_iterator itGroup = GroupMap.find(iOriginal);
+        if (itGroup == GroupMap.end())
+        {
+            itGroup = GroupMap.insert(std::make_pair((unsigned int)iOriginal,
+                (unsigned int)m_Groups.size())).first;
+            m_Groups.push_back(m_Dedup.GetKey(iOriginal));
+            m_GroupFiles.push_back(iOriginal);
+        }
+
+        Duplicates[m_Files[i]] = itGroup->second;
+    }
+
+    ckfilesystem::FileSet::const_iterator itFile;
+    for (itFile = Files.begin(); itFile != Files.end(); itFile++)
+    {
+        const ckfilesystem::FileDescriptor *pFile = *itFile;
+
+        unsigned char ucFlags = pFile->flags_;
+        void *pData = pFile->data_ptr_;
+
+        std::map<const ckfilesystem::FileDescriptor *,unsigned int>::const_iterator itDuplicate =
+            Duplicates.find(pFile);
+        if (itDuplicate != Duplicates.end())
+        {
+            ckfilesystem::IsoImportData *pImportData = new ckfilesystem::IsoImportData();
+            pImportData->file_flags_ = 0;
+            pImportData->file_unit_size_ = 0;
+            pImportData->interleave_gap_size_ = 0;
+            pImportData->volseq_num_ = 1;
+            pImportData->extent_loc_ = CORE2_DEDUP_PLACEHOLDER + itDuplicate->second;
+            pImportData->extent_len_ = (unsigned long)m_Groups[itDuplicate->second].m_uiSize;
+
+            // Keep the modification time of the duplicate.
+            unsigned short usFileDate = 0,usFileTime = 0;
+
+            WIN32_FILE_ATTRIBUTE_DATA FileData;
+            FILETIME LocalFileTime;
+            if (GetFileAttributesEx(pFile->external_path_.c_str(),GetFileExInfoStandard,&FileData) &&
+                FileTimeToLocalFileTime(&FileData.ftLastWriteTime,&LocalFileTime))
+            {
+                FileTimeToDosDateTime(&LocalFileTime,&usFileDate,&usFileTime);
+            }
+
+            ckfilesystem::iso_make_datetime(usFileDate,usFileTime,pImportData->rec_timestamp_);
+
+            m_ImportData.push_back(pImportData);
+
+            ucFlags |= ckfilesystem::FileDescriptor::FLAG_IMPORTED;
+            pData = pImportData;
+        }
+
+        // If the insertion fails, the auto_ptr will automatically release the memory.
+        std::auto_ptr< ckfilesystem::FileDescriptor > fd(
+            new ckfilesystem::FileDescriptor(
+                    pFile->internal_path_,
+                    pFile->external_path_,
+                    ucFlags,
+                    pData ) );
+        DedupFiles.insert( fd.get() );
+        fd.release();
+    }
+
+    return true;
+}
+
+/*
+    CCore2Dedup::ReadDirectories
+    ----------------------------
+    Walks all directory trees of the image, the ISO9660 tree and any
+    supplementary tree such as Joliet. The position of each directory record
+    that refers to a placeholder is added to Links, and the location of each
+    file extent with the size of a group is added to Extents.
+*/
+bool CCore2Dedup::ReadDirectories(ckcore::File &File,unsigned long ulSectorOffset,
+                                  std::vector<CLink> &Links,
+                                  std::multimap<ckcore::tuint64,unsigned long> &Extents)
+{
+    std::set<ckcore::tuint64> GroupSizes;
+    for (unsigned int i = 0; i < m_Groups.size(); i++)
+        GroupSizes.insert(m_Groups[i].m_uiSize);
+
+    // Locate the root directories.
+    std::vector<std::pair<unsigned long,unsigned long> > DirStack;
+
+    unsigned char ucSector[CORE2_DEDUP_SECTORSIZE];
+    for (unsigned int i = 0; i < CORE2_DEDUP_MAXVOLDESC; i++)
+    {
+        if (File.seek((ckcore::tint64)(16 + i) * CORE2_DEDUP_SECTORSIZE,ckcore::File::ckFILE_BEGIN) == -1 ||
+            File.read(ucSector,CORE2_DEDUP_SECTORSIZE) != CORE2_DEDUP_SECTORSIZE)
+        {
+            return false;
+        }
+
+        if (memcmp(ucSector + 1,"CD001",5))
+            return false;
+
+        // Volume descriptor set terminator.
+        if (ucSector[0] == 255)
+            break;
+
+        // Primary and supplementary volume descriptors.
+        if (ucSector[0] == 1 || ucSector[0] == 2)
+        {
+            unsigned char *pRootRecord = ucSector + 156;
+            DirStack.push_back(std::make_pair(Read731(pRootRecord + 2),Read731(pRootRecord + 10)));
+        }
+    }
+
+    std::set<unsigned long> Visited;
+    std::vector<unsigned char> Buffer;
+
+    while (DirStack.size() > 0)
+    {
+        unsigned long ulDirLoc = DirStack.back().first;
+        unsigned long ulDirLen = DirStack.back().second;
+        DirStack.pop_back();
+
+        // The Joliet tree may share extents with the ISO9660 tree.
+        if (!Visited.insert(ulDirLoc).second)
+            continue;
+
+        if (ulDirLoc < ulSectorOffset || ulDirLen == 0)
+            return false;
+
+        ckcore::tint64 iDirPos = (ckcore::tint64)(ulDirLoc - ulSectorOffset) * CORE2_DEDUP_SECTORSIZE;
+
+        Buffer.resize(ulDirLen);
+        if (File.seek(iDirPos,ckcore::File::ckFILE_BEGIN) == -1 ||
+            File.read(&Buffer[0],ulDirLen) != (ckcore::tint64)ulDirLen)
+        {
+            return false;
+        }
+
+        unsigned long ulPos = 0;
+        while (ulPos + 34 <= ulDirLen)
+        {
+            unsigned char ucRecLen = Buffer[ulPos];
+
+            // Records never cross sector boundaries.
+            if (ucRecLen == 0)
+            {
+                ulPos = (ulPos / CORE2_DEDUP_SECTORSIZE + 1) * CORE2_DEDUP_SECTORSIZE;
+                continue;
+            }
+
+            if (ucRecLen < 34 || ulPos + ucRecLen > ulDirLen)
+                return false;
+
+            unsigned char *pRecord = &Buffer[ulPos];
+            unsigned long ulLoc = Read731(pRecord + 2);
+            unsigned long ulLen = Read731(pRecord + 10);
+            unsigned char ucFlags = pRecord[25];
+            unsigned char ucNameLen = pRecord[32];
+
+            // Skip the current and parent directory records.
+            bool bSpecial = ucNameLen == 1 && (pRecord[33] == 0 || pRecord[33] == 1);
+
+            if (!bSpecial)
+            {
+                if (ucFlags & DIRRECORD_FILEFLAG_DIRECTORY)
+                {
+                    DirStack.push_back(std::make_pair(ulLoc,ulLen));
+                }
+                else if (ulLoc >= CORE2_DEDUP_PLACEHOLDER &&
+                         ulLoc - CORE2_DEDUP_PLACEHOLDER < m_Groups.size())
+                {
+                    Links.push_back(CLink(iDirPos + ulPos,ulLoc - CORE2_DEDUP_PLACEHOLDER));
+                }
+                else if (GroupSizes.count(ulLen) > 0)
+                {
+                    Extents.insert(std::make_pair((ckcore::tuint64)ulLen,ulLoc));
+                }
+            }
+
+            ulPos += ucRecLen;
+        }
+    }
+
+    return true;
+}
+
+/*
+    CCore2Dedup::Link
+    -----------------
+    Links the directory records of the duplicates in the image created from
+    the prepared file set to extents with the same contents. The extents are
+    identified by reading them back from the image, so the placement of the
+    file data by the writer doesn't need to be known. An extent with the
+    checksums of a group is only used once its data has been compared with
+    the original file of the group. If pBlockChecksums isn't NULL it holds
+    the checksums of the CORE2_CHECKPOINT_BLOCKSIZE blocks of the image,
+    the checksums of the blocks with updated directory records are updated,
+    or the checksums are cleared if they can't be. Returns false if the image can't be completed, in which case it's
+    invalid.
+*/
+bool CCore2Dedup::Link(const TCHAR *szImagePath,unsigned long ulSectorOffset,
+                       std::vector<ckcore::tuint32> *pBlockChecksums)
+{
+    ckcore::File File(szImagePath);
+    if (!File.open(ckcore::File::ckOPEN_READWRITE))
+    {
+        g_pLogDlg->print_line(_T("  Error: Unable to open \"%s\" for linking duplicate files."),
+            szImagePath);
+        return false;
+    }
+
+    std::vector<CLink> Links;
+    std::multimap<ckcore::tuint64,unsigned long> Extents;
+    if (!ReadDirectories(File,ulSectorOffset,Links,Extents))
+    {
+        g_pLogDlg->print_line(_T("  Error: Unable to read the directory records of \"%s\"."),
+            szImagePath);
+        File.close();
+        return false;
+    }
+
+    // Find an extent with the contents of each group.
+    std::multimap<CFileDedup::CKey,unsigned int> GroupMap;
+    for (unsigned int i = 0; i < m_Groups.size(); i++)
+        GroupMap.insert(std::make_pair(m_Groups[i],i));
+
+    std::vector<unsigned long> GroupExtents(m_Groups.size(),0);
+    std::vector<bool> GroupFound(m_Groups.size(),false);
+    unsigned int uiFound = 0;
+
+    unsigned char *pBuffer = new unsigned char[FILEDEDUP_BLOCKSIZE];
+    unsigned char *pCompareBuffer = new unsigned char[FILEDEDUP_BLOCKSIZE];
+
+    std::set<unsigned long> Visited;
+    std::multimap<ckcore::tuint64,unsigned long>::const_iterator itExtent;
+    for (itExtent = Extents.begin(); itExtent != Extents.end() && uiFound < m_Groups.size(); itExtent++)
+    {
+        if (!Visited.insert(itExtent->second).second || itExtent->second < ulSectorOffset)
+            continue;
+
+        CFileDedup::CKey Key;
+        ckcore::tint64 iExtentPos = (ckcore::tint64)(itExtent->second - ulSectorOffset) *
+            CORE2_DEDUP_SECTORSIZE;
+        File.seek(iExtentPos,ckcore::File::ckFILE_BEGIN);
+        if (!CFileDedup::ReadKey(File,itExtent->first,pBuffer,Key))
+            continue;
+
+        std::pair<std::multimap<CFileDedup::CKey,unsigned int>::const_iterator,
+            std::multimap<CFileDedup::CKey,unsigned int>::const_iterator> Range =
+            GroupMap.equal_range(Key);
+
+        std::multimap<CFileDedup::CKey,unsigned int>::const_iterator itGroup;
+        for (itGroup = Range.first; itGroup != Range.second; itGroup++)
+        {
+            if (GroupFound[itGroup->second])
+                continue;
+
+            ckcore::File OrigFile(m_Dedup.GetFilePath(m_GroupFiles[itGroup->second]));
+            if (!OrigFile.open(ckcore::File::ckOPEN_READ))
+                continue;
+
+            bool bMatch = File.seek(iExtentPos,ckcore::File::ckFILE_BEGIN) != -1 &&
+                CFileDedup::CompareData(File,OrigFile,itExtent->first,pBuffer,pCompareBuffer);
+            OrigFile.close();
+
+            if (bMatch)
+            {
+                GroupExtents[itGroup->second] = itExtent->second;
+                GroupFound[itGroup->second] = true;
+                uiFound++;
+                break;
+            }
+        }
+    }
+
+    delete [] pBuffer;
+    delete [] pCompareBuffer;
+
+    if (uiFound < m_Groups.size())
+    {
+        g_pLogDlg->print_line(_T("  Error: Unable to locate the data of %u duplicate file groups."),
+            (unsigned int)m_Groups.size() - uiFound);
+        File.close();
+        return false;
+    }
+
+    // Update the location of the duplicates, which is recorded in both byte orders.
+    for (unsigned int i = 0; i < Links.size(); i++)
+    {
+        unsigned char ucLocation[8];
+        Write733(ucLocation,GroupExtents[Links[i].m_uiGroup]);
+
+        if (File.seek(Links[i].m_iRecordPos + 2,ckcore::File::ckFILE_BEGIN) == -1 ||
+            File.write(ucLocation,sizeof(ucLocation)) != sizeof(ucLocation))
+        {
+            g_pLogDlg->print_line(_T("  Error: Unable to update the directory records of \"%s\"."),
+                szImagePath);
+            File.close();
+            return false;
+        }
+    }
+
+    if (pBlockChecksums != NULL)
+    {
+        std::set<ckcore::tint64> Blocks;
+        for (unsigned int i = 0; i < Links.size(); i++)
+            Blocks.insert(Links[i].m_iRecordPos / CORE2_CHECKPOINT_BLOCKSIZE);
+
+        ckcore::tint64 iImageSize = File.size();
+        std::vector<unsigned char> Block(CORE2_CHECKPOINT_BLOCKSIZE);
+
+        std::set<ckcore::tint64>::const_iterator itBlock;
+        for (itBlock = Blocks.begin(); itBlock != Blocks.end(); itBlock++)
+        {
+            ckcore::tint64 iBlockPos = *itBlock * CORE2_CHECKPOINT_BLOCKSIZE;
+            ckcore::tuint32 uiSize = (ckcore::tuint32)min(iImageSize - iBlockPos,
+                (ckcore::tint64)CORE2_CHECKPOINT_BLOCKSIZE);
+
+            if ((size_t)*itBlock >= pBlockChecksums->size() ||
+                File.seek(iBlockPos,ckcore::File::ckFILE_BEGIN) == -1 ||
+                File.read(&Block[0],uiSize) != uiSize)
+            {
+                // The image itself is complete, it just can't be verified
+                // against the checksums.
+                g_pLogDlg->print_line(_T("  Warning: Unable to update the block checksums of \"%s\"."),
+                    szImagePath);
+                pBlockChecksums->clear();
+                break;
+            }
+
+            (*pBlockChecksums)[(size_t)*itBlock] = ChecksumCrc32c(&Block[0],uiSize);
+        }
+    }
+
+    File.close();
+
+    g_pLogDlg->print_line(_T("  Linked %u directory records to %u shared extents, saved %I64u bytes."),
+        (unsigned int)Links.size(),(unsigned int)m_Groups.size(),m_Dedup.GetDuplicateBytes());
+    return true;
+}
+
+unsigned int CCore2Dedup::GetDuplicateCount() const
+{
+    return m_Dedup.GetDuplicateCount();
+}
+
+ckcore::tuint64 CCore2Dedup::GetDuplicateBytes() const
+{
+    return m_Dedup.GetDuplicateBytes();
+}
+
+/*
+    CCore2Dedup::Analyze
+    --------------------
+    Calculates how many files of the file set are duplicates and how many
+    bytes of file data would be saved by storing them only once.
+*/
+void CCore2Dedup::Analyze(const ckfilesystem::FileSet &Files,unsigned int &uiDuplicateCount,
+                          ckcore::tuint64 &uiDuplicateBytes)
+{
+    CCore2Dedup Dedup;
+    Dedup.AddFiles(Files);
+    Dedup.m_Dedup.Run();
+
+    uiDuplicateCount = Dedup.GetDuplicateCount();
+    uiDuplicateBytes = Dedup.GetDuplicateBytes();
+}
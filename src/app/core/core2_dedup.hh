@@ -0,0 +1,81 @@
+/*
+ * InfraRecorder - CD/DVD burning software
+ * Copyright (C) 2006-2012 Christian Kindahl
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+#include <vector>
+#include <map>
+#include <ckcore/types.hh>
+#include <ckcore/file.hh>
+#include <ckfilesystem/fileset.hh>
+#include <ckfilesystem/iso.hh>
+#include <ckfilesystem/isowriter.hh>
+#include <base/file_dedup.hh>
+#include "core2_checkpoint.hh"
+
+#define CORE2_DEDUP_SECTORSIZE				2048
+#define CORE2_DEDUP_PLACEHOLDER				0xF0000000	// Extent location of the first group.
+#define CORE2_DEDUP_MAXVOLDESC				32			// Volume descriptors searched for trees.
+
+// Lets identical files in an ISO9660 disc image share a single extent. Before
+// the image is created each duplicate is replaced by an imported file, which
+// the file system writer doesn't allocate any data for, with a placeholder
+// extent location that identifies its contents. Once the image has been
+// written the directory records of the duplicates, in all directory trees,
+// are linked to the extent of a file with the same contents. The extent is
+// compared byte for byte with the original file before it's linked.
+class CCore2Dedup
+{
+private:
+    CFileDedup m_Dedup;
+    std::vector<const ckfilesystem::FileDescriptor *> m_Files;
+    std::vector<CFileDedup::CKey> m_Groups;
+    std::vector<unsigned int> m_GroupFiles;		// Index of the original file of each group.
+    std::vector<ckfilesystem::IsoImportData *> m_ImportData;
+
+    // A directory record that refers to a placeholder extent.
+    class CLink
+    {
+    public:
+        ckcore::tint64 m_iRecordPos;
+        unsigned int m_uiGroup;
+
+        CLink(ckcore::tint64 iRecordPos,unsigned int uiGroup) :
+            m_iRecordPos(iRecordPos),m_uiGroup(uiGroup)
+        {
+        }
+    };
+
+    void AddFiles(const ckfilesystem::FileSet &Files);
+    bool ReadDirectories(ckcore::File &File,unsigned long ulSectorOffset,
+        std::vector<CLink> &Links,std::multimap<ckcore::tuint64,unsigned long> &Extents);
+
+public:
+    CCore2Dedup();
+    ~CCore2Dedup();
+
+    bool Prepare(const ckfilesystem::FileSet &Files,ckfilesystem::FileSet &DedupFiles);
+    bool Link(const TCHAR *szImagePath,unsigned long ulSectorOffset,
+        std::vector<ckcore::tuint32> *pBlockChecksums = NULL);
+
+    unsigned int GetDuplicateCount() const;
+    ckcore::tuint64 GetDuplicateBytes() const;
+
+    static void Analyze(const ckfilesystem::FileSet &Files,unsigned int &uiDuplicateCount,
+        ckcore::tuint64 &uiDuplicateBytes);
+};
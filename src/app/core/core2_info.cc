@@ -18,10 +18,9 @@
 
 #include "stdafx.hh"
 #include "scsi.hh"
-#include "log_dlg.hh"
 #include "core2_info.hh"
 
-CCore2Info::CCore2Info()
+CCore2Info::CCore2Info(ckcore::Log *pLog) : m_pLog(pLog)
 {
 }
 
@@ -29,7 +28,7 @@ CCore2Info::~CCore2Info()
 {
 }
 
-bool CCore2Info::ReadCapacity(ckmmc::Device &Device,unsigned long &ulBlockAddress,
+bool CCore2Info::ReadCapacity(CCore2Transport Device,unsigned long &ulBlockAddress,
                           unsigned long &ulBlockLength)
 {
     // Initialize buffers.
@@ -53,7 +52,7 @@ bool CCore2Info::ReadCapacity(ckmmc::Device &Device,unsigned long &ulBlockAddres
     return true;
 }
 
-bool CCore2Info::ReadTrackInformation(ckmmc::Device &Device,eTrackInfoType InfoType,
+bool CCore2Info::ReadTrackInformation(CCore2Transport Device,eTrackInfoType InfoType,
                                       unsigned long ulTrackAddr,CCore2TrackInfo *pTrackInfo)
 {
     if (pTrackInfo == NULL)
@@ -86,7 +85,7 @@ bool CCore2Info::ReadTrackInformation(ckmmc::Device &Device,eTrackInfoType InfoT
     // Check if we received to much data.
     unsigned short usDataLength = ((unsigned short)ucBuffer[0] << 8) | ucBuffer[1];
     if (usDataLength > (sizeof(ucBuffer) - 2))
-        g_pLogDlg->print_line(_T("  Warning: CCore2::ReadTrackInformation received more track information than it could handle."));
+        m_pLog->print_line(_T("  Warning: CCore2::ReadTrackInformation received more track information than it could handle."));
 
     pTrackInfo->m_ucFlags = (ucBuffer[6] & 0xF0) | ((ucBuffer[5] >> 2) & 0x0C) | (ucBuffer[7] & 0x03);
     pTrackInfo->m_ucLJRS = (ucBuffer[5] >> 6) & 0x03;
@@ -118,7 +117,7 @@ bool CCore2Info::ReadTrackInformation(ckmmc::Device &Device,eTrackInfoType InfoT
     return true;
 }
 
-bool CCore2Info::ReadDiscInformation(ckmmc::Device &Device,CCore2DiscInfo *pDiscInfo)
+bool CCore2Info::ReadDiscInformation(CCore2Transport Device,CCore2DiscInfo *pDiscInfo)
 {
     if (pDiscInfo == NULL)
         return false;
@@ -146,6 +145,7 @@ bool CCore2Info::ReadDiscInformation(ckmmc::Device &Device,CCore2DiscInfo *pDisc
     pDiscInfo->m_usLastSessFstTrack = ucBuffer[5] | (ucBuffer[10] << 8);
     pDiscInfo->m_usLastSessLstTrack = ucBuffer[6] | (ucBuffer[11] << 8);
     pDiscInfo->m_ucFlags = (ucBuffer[7] & 0xFC) | (((ucBuffer[2] & 0x10) > 0) << 1);
+    pDiscInfo->m_ucBgFormatStatus = ucBuffer[7] & 0x03;
     pDiscInfo->m_ucDiscType = ucBuffer[8];
     pDiscInfo->m_uiDiscID = (ucBuffer[12] << 24) | (ucBuffer[13] << 16) |
         (ucBuffer[14] << 8) | ucBuffer[15];
@@ -162,7 +162,7 @@ bool CCore2Info::ReadDiscInformation(ckmmc::Device &Device,CCore2DiscInfo *pDisc
     return true;
 }
 
-bool CCore2Info::ReadPhysFmtInfo(ckmmc::Device &Device,CCore2PhysFmtInfo *pPhysInfo)
+bool CCore2Info::ReadPhysFmtInfo(CCore2Transport Device,CCore2PhysFmtInfo *pPhysInfo)
 {
     if (pPhysInfo == NULL)
         return false;
@@ -201,7 +201,7 @@ bool CCore2Info::ReadPhysFmtInfo(ckmmc::Device &Device,CCore2PhysFmtInfo *pPhysI
     return true;
 }
 
-bool CCore2Info::ReadTOC(ckmmc::Device &Device,unsigned char &ucFirstTrackNumber,
+bool CCore2Info::ReadTOC(CCore2Transport Device,unsigned char &ucFirstTrackNumber,
                          unsigned char &ucLastTrackNumber,std::vector<CCore2TOCTrackDesc> &Tracks)
 {
     // Initialize buffers.
@@ -251,7 +251,7 @@ bool CCore2Info::ReadTOC(ckmmc::Device &Device,unsigned char &ucFirstTrackNumber
 /*
     Read session information.
 */
-bool CCore2Info::ReadSI(ckmmc::Device &Device,unsigned char &ucFirstSessNumber,
+bool CCore2Info::ReadSI(CCore2Transport Device,unsigned char &ucFirstSessNumber,
                         unsigned char &ucLastSessNumber,
                         unsigned long &ulLastSessFirstTrackPos)
 {
@@ -291,6 +291,31 @@ bool CCore2Info::ReadSI(ckmmc::Device &Device,unsigned char &ucFirstSessNumber,
     return true;
 }
 
+/*
+    CCore2Info::GetProfile
+    ----------------------
+    Obtains the current profile of the device, which identifies the type of
+    the mounted media. Returns false if the profile could not be obtained.
+*/
+bool CCore2Info::GetProfile(CCore2Transport Device,unsigned short &usProfile)
+{
+    // Initialize buffers.
+    unsigned char ucBuffer[8];
+    memset(ucBuffer,0,sizeof(ucBuffer));
+
+    unsigned char ucCdb[16];
+    memset(ucCdb,0,sizeof(ucCdb));
+
+    ucCdb[0] = SCSI_GET_CONFIGURATION;
+    ucCdb[8] = sizeof(ucBuffer);
+
+    if (!Device.transport(ucCdb,9,ucBuffer,sizeof(ucBuffer),ckmmc::Device::ckTM_READ))
+        return false;
+
+    usProfile = ucBuffer[6] << 8 | ucBuffer[7];
+    return true;
+}
+
 /*
     CCore2Info::GetTotalDiscCapacity
     --------------------------------
@@ -298,10 +323,10 @@ bool CCore2Info::ReadSI(ckmmc::Device &Device,unsigned char &ucFirstSessNumber,
     unformatted/blank (free) on the disc mounted on the specified device. The function
     returns true of successfull, false otherwise.
 */
-bool CCore2Info::GetTotalDiscCapacity(ckmmc::Device &Device,unsigned __int64 &uiUsedBytes,
+bool CCore2Info::GetTotalDiscCapacity(CCore2Transport Device,unsigned __int64 &uiUsedBytes,
                                       unsigned __int64 &uiFreeBytes)
 {
-    g_pLogDlg->print_line(_T("CCore2Info::GetTotalDiscCapacity"));
+    m_pLog->print_line(_T("CCore2Info::GetTotalDiscCapacity"));
 
     uiUsedBytes = 0;
     uiFreeBytes = 0;
@@ -322,7 +347,7 @@ bool CCore2Info::GetTotalDiscCapacity(ckmmc::Device &Device,unsigned __int64 &ui
         return false;
 
     unsigned short usProfile = ucBuffer[6] << 8 | ucBuffer[7];
-    g_pLogDlg->print_line(_T("  Current profile: 0x%.4X."),usProfile);
+    m_pLog->print_line(_T("  Current profile: 0x%.4X."),usProfile);
 
     bool bReadOnly = true;
     switch (usProfile)
@@ -358,11 +383,11 @@ bool CCore2Info::GetTotalDiscCapacity(ckmmc::Device &Device,unsigned __int64 &ui
         return false;
 
     unsigned char ucCapListLen = ucBuffer[3];
-    g_pLogDlg->print_line(_T("  Capacity list length: %d bytes."),ucCapListLen);
+    m_pLog->print_line(_T("  Capacity list length: %d bytes."),ucCapListLen);
 
     if (ucCapListLen % 8 != 0 || ucCapListLen == 0)
     {
-        g_pLogDlg->print_line(_T("  Error: Invalid capacity list length."));
+        m_pLog->print_line(_T("  Error: Invalid capacity list length."));
         return false;
     }
 
@@ -381,7 +406,7 @@ bool CCore2Info::GetTotalDiscCapacity(ckmmc::Device &Device,unsigned __int64 &ui
 
     if ((ucBuffer[8] & 0x03) == 0x03)	// No media present or unknown capacity.
     {
-        g_pLogDlg->print_line(_T("  No media present."));
+        m_pLog->print_line(_T("  No media present."));
         return false;
     }
 
@@ -405,7 +430,7 @@ bool CCore2Info::GetTotalDiscCapacity(ckmmc::Device &Device,unsigned __int64 &ui
     return true;
 }
 
-bool CCore2Info::GetDiscDVDRegion(ckmmc::Device &Device,unsigned char &ucRegion)
+bool CCore2Info::GetDiscDVDRegion(CCore2Transport Device,unsigned char &ucRegion)
 {
     // Initialize buffers.
     unsigned char ucBuffer[8];
@@ -18,7 +18,8 @@
 
 #pragma once
 #include <vector>
-#include <ckmmc/device.hh>
+#include <ckcore/log.hh>
+#include "core2_transport.hh"
 
 class CCore2TrackInfo
 {
@@ -63,7 +64,11 @@ public:
     enum { FLAG_ERASABLE = 0x02,FLAG_D = 0x04,FLAG_RESERVED = 0x08,FLAG_DACV = 0x10,
         FLAG_URU = 0x20,FLAG_DBCV = 0x40,FLAG_DIDV = 0x80 };
 
+    // Background format status.
+    enum { BGFS_NONE,BGFS_INCOMPLETE,BGFS_INPROGRESS,BGFS_COMPLETE };
+
     unsigned char m_ucFlags;
+    unsigned char m_ucBgFormatStatus;
     unsigned char m_ucLastSessStatus;
     unsigned char m_ucDiscStatus;
     unsigned char m_ucDiscType;
@@ -122,6 +127,9 @@ public:
 
 class CCore2Info
 {
+private:
+    ckcore::Log *m_pLog;
+
 public:
     enum eTrackInfoType
     {
@@ -130,22 +138,23 @@ public:
         TIT_SESSION = 2
     };
 
-    CCore2Info();
+    CCore2Info(ckcore::Log *pLog);
     ~CCore2Info();
 
     // Closely related to SCSI MMC functions.
-    bool ReadCapacity(ckmmc::Device &Device,unsigned long &ulBlockAddress,
+    bool ReadCapacity(CCore2Transport Device,unsigned long &ulBlockAddress,
         unsigned long &ulBlockLength);
-    bool ReadTrackInformation(ckmmc::Device &Device,eTrackInfoType InfoType,
+    bool ReadTrackInformation(CCore2Transport Device,eTrackInfoType InfoType,
         unsigned long ulTrackAddr,CCore2TrackInfo *pTrackInfo);
-    bool ReadDiscInformation(ckmmc::Device &Device,CCore2DiscInfo *pDiscInfo);
-    bool ReadPhysFmtInfo(ckmmc::Device &Device,CCore2PhysFmtInfo *pPhysInfo);
-    bool ReadTOC(ckmmc::Device &Device,unsigned char &ucFirstTrackNumber,
+    bool ReadDiscInformation(CCore2Transport Device,CCore2DiscInfo *pDiscInfo);
+    bool ReadPhysFmtInfo(CCore2Transport Device,CCore2PhysFmtInfo *pPhysInfo);
+    bool ReadTOC(CCore2Transport Device,unsigned char &ucFirstTrackNumber,
         unsigned char &ucLastTrackNumber,std::vector<CCore2TOCTrackDesc> &Tracks);
-    bool ReadSI(ckmmc::Device &Device,unsigned char &ucFirstSessNumber,
+    bool ReadSI(CCore2Transport Device,unsigned char &ucFirstSessNumber,
         unsigned char &ucLastSessNumber,unsigned long &ulLastSessFirstTrackPos);
+    bool GetProfile(CCore2Transport Device,unsigned short &usProfile);
 
-    bool GetTotalDiscCapacity(ckmmc::Device &Device,unsigned __int64 &uiUsedBytes,
+    bool GetTotalDiscCapacity(CCore2Transport Device,unsigned __int64 &uiUsedBytes,
         unsigned __int64 &uiFreeBytes);
-    bool GetDiscDVDRegion(ckmmc::Device &Device,unsigned char &ucRegion);
+    bool GetDiscDVDRegion(CCore2Transport Device,unsigned char &ucRegion);
 };
@@ -0,0 +1,281 @@
+/*
+ * InfraRecorder - CD/DVD burning software
+ * Copyright (C) 2006-2012 Christian Kindahl
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "stdafx.hh"
+#include "core2_prefetch.hh"
+
+CCore2Prefetcher::CStream::CStream(CCore2Prefetcher &Prefetcher,ckcore::OutStream &OutStream) :
+    m_Prefetcher(Prefetcher),m_OutStream(OutStream)
+{
+}
+
+ckcore::tint64 CCore2Prefetcher::CStream::write(const void *pBuffer,ckcore::tuint32 uiCount)
+{
+    ckcore::tint64 iWritten = m_OutStream.write(pBuffer,uiCount);
+    if (iWritten > 0)
+        m_Prefetcher.Consume((ckcore::tuint32)iWritten);
+
+    return iWritten;
+}
+
+/**
+    @param Files the files that will be written.
+    @param uiDataOffset the estimated position in bytes of the file data in
+    the image, 0 if unknown. If unknown the writer is assumed to be in the
+    file data from the start, which overestimates the risk rather than hiding
+    it.
+*/
+CCore2Prefetcher::CCore2Prefetcher(const ckfilesystem::FileSet &Files,unsigned __int64 uiDataOffset) :
+    m_uiNextItem(0),m_uiCompletedItems(0),m_uiPrefetched(0),m_uiCompleted(0),
+    m_uiDataOffset(uiDataOffset),m_uiWritten(0),m_uiRiskWritten(0),m_bStop(false),m_uiThreadCount(0)
+{
+    ::InitializeCriticalSection(&m_csState);
+    m_hWakeEvent = ::CreateEvent(NULL,FALSE,FALSE,NULL);
+
+    // Imported files are stored on the disc and directories have no data.
+    ckfilesystem::FileSet::const_iterator itFile;
+    for (itFile = Files.begin(); itFile != Files.end(); itFile++)
+    {
+        const ckfilesystem::FileDescriptor *pFile = *itFile;
+        if (pFile->flags_ & (ckfilesystem::FileDescriptor::FLAG_DIRECTORY |
+            ckfilesystem::FileDescriptor::FLAG_IMPORTED))
+        {
+            continue;
+        }
+
+        m_Items.push_back(CItem(pFile->external_path_));
+    }
+}
+
+CCore2Prefetcher::~CCore2Prefetcher()
+{
+    Stop();
+
+    if (m_hWakeEvent != NULL)
+        ::CloseHandle(m_hWakeEvent);
+
+    ::DeleteCriticalSection(&m_csState);
+}
+
+/*
+    CCore2Prefetcher::Claim
+    -----------------------
+    Waits until the next file may be read and claims it for the calling
+    thread. Returns false when there are no more files to read or when the
+    prefetcher has been stopped.
+*/
+bool CCore2Prefetcher::Claim(unsigned int &uiItem)
+{
+    while (true)
+    {
+        ::EnterCriticalSection(&m_csState);
+
+        if (m_bStop || m_uiNextItem >= m_Items.size())
+        {
+            ::LeaveCriticalSection(&m_csState);
+            return false;
+        }
+
+        if (m_uiPrefetched < GetDataWritten() + CORE2_PREFETCH_MAXLEAD)
+        {
+            uiItem = m_uiNextItem++;
+            ::LeaveCriticalSection(&m_csState);
+            return true;
+        }
+
+        ::LeaveCriticalSection(&m_csState);
+
+        // Wait for the writer to catch up.
+        ::WaitForSingleObject(m_hWakeEvent,CORE2_PREFETCH_WAITTIME);
+    }
+}
+
+/*
+    CCore2Prefetcher::Measure
+    -------------------------
+    Records the size of a claimed file as soon as it has been opened so that
+    the other threads don't read too far ahead.
+*/
+void CCore2Prefetcher::Measure(unsigned int uiItem,unsigned __int64 uiSize)
+{
+    uiSize = ((uiSize + CORE2_PREFETCH_SECTORSIZE - 1) /
+        CORE2_PREFETCH_SECTORSIZE) * CORE2_PREFETCH_SECTORSIZE;
+
+    ::EnterCriticalSection(&m_csState);
+
+    m_Items[uiItem].m_uiSize = uiSize;
+    m_uiPrefetched += uiSize;
+
+    ::LeaveCriticalSection(&m_csState);
+}
+
+void CCore2Prefetcher::Complete(unsigned int uiItem)
+{
+    ::EnterCriticalSection(&m_csState);
+
+    m_Items[uiItem].m_bDone = true;
+
+    // Advance over all files that have been read in order.
+    while (m_uiCompletedItems < m_Items.size() && m_Items[m_uiCompletedItems].m_bDone)
+        m_uiCompleted += m_Items[m_uiCompletedItems++].m_uiSize;
+
+    ::LeaveCriticalSection(&m_csState);
+}
+
+/*
+    CCore2Prefetcher::Consume
+    -------------------------
+    Called when the writer has written data. Data written while the files read
+    in order are less than CORE2_PREFETCH_MINLEAD bytes ahead of the writer is
+    considered to be at risk of causing a buffer underrun.
+*/
+void CCore2Prefetcher::Consume(ckcore::tuint32 uiCount)
+{
+    ::EnterCriticalSection(&m_csState);
+
+    if (m_uiCompletedItems < m_Items.size() &&
+        m_uiCompleted < GetDataWritten() + CORE2_PREFETCH_MINLEAD)
+    {
+        m_uiRiskWritten += uiCount;
+    }
+
+    m_uiWritten += uiCount;
+
+    ::LeaveCriticalSection(&m_csState);
+
+    ::SetEvent(m_hWakeEvent);
+}
+
+/*
+    CCore2Prefetcher::GetDataWritten
+    --------------------------------
+    Returns the number of bytes the writer has written to the file data area.
+    Must be called with m_csState held.
+*/
+unsigned __int64 CCore2Prefetcher::GetDataWritten() const
+{
+    return m_uiWritten > m_uiDataOffset ? m_uiWritten - m_uiDataOffset : 0;
+}
+
+DWORD WINAPI CCore2Prefetcher::PrefetchThread(LPVOID lpThreadParameter)
+{
+    CCore2Prefetcher *pPrefetcher = (CCore2Prefetcher *)lpThreadParameter;
+
+    unsigned char *pBuffer = new unsigned char[CORE2_PREFETCH_BLOCKSIZE];
+
+    unsigned int uiItem = 0;
+    while (pPrefetcher->Claim(uiItem))
+    {
+        HANDLE hFile = ::CreateFile(pPrefetcher->m_Items[uiItem].m_FilePath.c_str(),
+                                    GENERIC_READ,FILE_SHARE_READ | FILE_SHARE_WRITE,NULL,
+                                    OPEN_EXISTING,FILE_FLAG_SEQUENTIAL_SCAN,NULL);
+        if (hFile != INVALID_HANDLE_VALUE)
+        {
+            LARGE_INTEGER liSize;
+            if (::GetFileSizeEx(hFile,&liSize))
+                pPrefetcher->Measure(uiItem,(unsigned __int64)liSize.QuadPart);
+
+            // The data is discarded, it's kept in the system file cache.
+            unsigned long ulRead = 0;
+            while (::ReadFile(hFile,pBuffer,CORE2_PREFETCH_BLOCKSIZE,&ulRead,NULL) && ulRead > 0)
+            {
+                if (pPrefetcher->m_bStop)
+                    break;
+            }
+
+            ::CloseHandle(hFile);
+        }
+
+        // Files that can't be read are reported by the writer.
+        pPrefetcher->Complete(uiItem);
+    }
+
+    delete [] pBuffer;
+    return 0;
+}
+
+/*
+    CCore2Prefetcher::Start
+    -----------------------
+    Starts reading the files in the background.
+*/
+void CCore2Prefetcher::Start()
+{
+    unsigned int uiThreadCount = CORE2_PREFETCH_THREADS;
+    if (m_Items.size() < uiThreadCount)
+        uiThreadCount = (unsigned int)m_Items.size();
+
+    for (unsigned int i = 0; i < uiThreadCount; i++)
+    {
+        unsigned long ulThreadID = 0;
+        HANDLE hThread = ::CreateThread(NULL,0,PrefetchThread,this,0,&ulThreadID);
+        if (hThread != NULL)
+            m_hThreads[m_uiThreadCount++] = hThread;
+    }
+}
+
+/*
+    CCore2Prefetcher::Stop
+    ----------------------
+    Stops reading files and waits for the threads to exit.
+*/
+void CCore2Prefetcher::Stop()
+{
+    if (m_uiThreadCount == 0)
+        return;
+
+    ::EnterCriticalSection(&m_csState);
+    m_bStop = true;
+    ::LeaveCriticalSection(&m_csState);
+
+    for (unsigned int i = 0; i < m_uiThreadCount; i++)
+        ::SetEvent(m_hWakeEvent);
+
+    ::WaitForMultipleObjects(m_uiThreadCount,m_hThreads,TRUE,INFINITE);
+
+    for (unsigned int i = 0; i < m_uiThreadCount; i++)
+        ::CloseHandle(m_hThreads[i]);
+
+    m_uiThreadCount = 0;
+}
+
+/**
+    Returns the number of bytes of the files that have been read in order,
+    files still being read are not included.
+*/
+unsigned __int64 CCore2Prefetcher::GetPrefetched()
+{
+    ::EnterCriticalSection(&m_csState);
+    unsigned __int64 uiCompleted = m_uiCompleted;
+    ::LeaveCriticalSection(&m_csState);
+
+    return uiCompleted;
+}
+
+/**
+    Returns the buffer underrun risk, the percentage of the written data that
+    was written while the read-ahead was running low.
+*/
+int CCore2Prefetcher::GetUnderrunRisk()
+{
+    ::EnterCriticalSection(&m_csState);
+    int iRisk = m_uiWritten > 0 ? (int)((m_uiRiskWritten * 100) / m_uiWritten) : 0;
+    ::LeaveCriticalSection(&m_csState);
+
+    return iRisk;
+}
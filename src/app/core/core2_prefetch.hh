@@ -0,0 +1,110 @@
+/*
+ * InfraRecorder - CD/DVD burning software
+ * Copyright (C) 2006-2012 Christian Kindahl
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#include <vector>
+#include <ckcore/types.hh>
+#include <ckcore/stream.hh>
+#include <ckfilesystem/fileset.hh>
+
+#define CORE2_PREFETCH_THREADS				4
+#define CORE2_PREFETCH_BLOCKSIZE			(256 * 1024)
+#define CORE2_PREFETCH_MAXLEAD				(64 * 1024 * 1024)	// Bytes read ahead of the writer.
+#define CORE2_PREFETCH_MINLEAD				(4 * 1024 * 1024)	// The writer is at risk below this.
+#define CORE2_PREFETCH_WAITTIME				100					// Milliseconds.
+#define CORE2_PREFETCH_RISKWARNING			10					// Percent.
+#define CORE2_PREFETCH_SECTORSIZE			2048
+
+// Reads the files of a file set ahead of the file system writer using a small
+// pool of threads. The files are read in file set order into the system file
+// cache, no further ahead of the writer than CORE2_PREFETCH_MAXLEAD bytes, so
+// that the writer can read them from memory. The amount of data written while
+// the read-ahead was running low is measured as a buffer underrun risk.
+// All positions are measured in the file data area of the image: the file
+// sizes are padded to whole sectors, and the data the writer outputs before
+// the first file, the file system structures, is not counted. The file sizes
+// are obtained by the prefetch threads when they open the files.
+class CCore2Prefetcher
+{
+public:
+    // Passes the data on to the output stream and lets the prefetcher know
+    // how far the writer has come.
+    class CStream : public ckcore::OutStream
+    {
+    private:
+        CCore2Prefetcher &m_Prefetcher;
+        ckcore::OutStream &m_OutStream;
+
+    public:
+        CStream(CCore2Prefetcher &Prefetcher,ckcore::OutStream &OutStream);
+
+        ckcore::tint64 write(const void *pBuffer,ckcore::tuint32 uiCount);
+    };
+
+private:
+    class CItem
+    {
+    public:
+        ckcore::tstring m_FilePath;
+        unsigned __int64 m_uiSize;
+        bool m_bDone;
+
+        CItem(const ckcore::tstring &FilePath) :
+            m_FilePath(FilePath),m_uiSize(0),m_bDone(false)
+        {
+        }
+    };
+
+    std::vector<CItem> m_Items;
+    unsigned int m_uiNextItem;
+    unsigned int m_uiCompletedItems;
+
+    // Bytes of all files that have been opened for reading, and the size of
+    // the files up to the first file that has not been read yet.
+    unsigned __int64 m_uiPrefetched;
+    unsigned __int64 m_uiCompleted;
+
+    // Bytes written before the file data area and bytes written in total.
+    unsigned __int64 m_uiDataOffset;
+    unsigned __int64 m_uiWritten;
+    unsigned __int64 m_uiRiskWritten;
+    bool m_bStop;
+
+    CRITICAL_SECTION m_csState;
+    HANDLE m_hWakeEvent;
+    HANDLE m_hThreads[CORE2_PREFETCH_THREADS];
+    unsigned int m_uiThreadCount;
+
+    bool Claim(unsigned int &uiItem);
+    void Measure(unsigned int uiItem,unsigned __int64 uiSize);
+    void Complete(unsigned int uiItem);
+    void Consume(ckcore::tuint32 uiCount);
+    unsigned __int64 GetDataWritten() const;
+
+    static DWORD WINAPI PrefetchThread(LPVOID lpThreadParameter);
+
+public:
+    CCore2Prefetcher(const ckfilesystem::FileSet &Files,unsigned __int64 uiDataOffset);
+    ~CCore2Prefetcher();
+
+    void Start();
+    void Stop();
+
+    unsigned __int64 GetPrefetched();
+    int GetUnderrunRisk();
+};
@@ -28,7 +28,7 @@
 
 namespace Core2ReadFunction
 {
-    CReadFunction::CReadFunction(ckmmc::Device &Device) : m_Device(Device)
+    CReadFunction::CReadFunction(CCore2Transport Device) : m_Device(Device)
     {
     }
 
@@ -77,11 +77,34 @@ namespace Core2ReadFunction
         return true;
     }
 
-    CReadUserData::CReadUserData(ckmmc::Device &Device,ckcore::OutStream *pOutStream) :
-        CReadFunction(Device),m_pOutStream(pOutStream)
+    bool CReadFunction::Read10(unsigned char *pBuffer,unsigned long ulAddress,unsigned long ulBlockCount)
+    {
+        if (pBuffer == NULL)
+            return false;
+
+        unsigned char ucCdb[16];
+        memset(ucCdb,0,sizeof(ucCdb));
+
+        if (ulBlockCount > 0xFFFF)
+            g_pLogDlg->print_line(_T("  Warning: Requested block count to large, trunkated the number of block requested to read."));
+
+        ucCdb[0] = SCSI_READ10;
+        ucCdb[2] = static_cast<unsigned char>(ulAddress >> 24);
+        ucCdb[3] = static_cast<unsigned char>(ulAddress >> 16);
+        ucCdb[4] = static_cast<unsigned char>(ulAddress >>  8);
+        ucCdb[5] = static_cast<unsigned char>(ulAddress & 0xFF);
+        ucCdb[7] = static_cast<unsigned char>(ulBlockCount >>  8);
+        ucCdb[8] = static_cast<unsigned char>(ulBlockCount & 0xFF);
+
+        return m_Device.transport(ucCdb,10,pBuffer,ulBlockCount * GetFrameSize(),
+                                  ckmmc::Device::ckTM_READ);
+    }
+
+    CReadUserData::CReadUserData(CCore2Transport Device,ckcore::OutStream *pOutStream) :
+        CReadFunction(Device),m_pOutStream(pOutStream),m_bReadCD(true)
     {
         // Get the block size in bytes (the frame only contains the user data in this case).
-        CCore2Info Core2Info;
+        CCore2Info Core2Info(g_pLogDlg);
         unsigned long ulBlockAddress = 0;
 
         if (!Core2Info.ReadCapacity(Device,ulBlockAddress,m_ulFrameSize))
@@ -91,6 +114,16 @@ namespace Core2ReadFunction
         }
 
         g_pLogDlg->print_line(_T("  Block address: %u, block length: %u."),ulBlockAddress,m_ulFrameSize);
+
+        // DVD and BD drives may reject READ CD for other media. READ CD is
+        // still used if the profile is unknown since older CD drives don't
+        // support GET CONFIGURATION.
+        unsigned short usProfile = PROFILE_NONE;
+        if (Core2Info.GetProfile(Device,usProfile))
+        {
+            m_bReadCD = usProfile == PROFILE_CDROM || usProfile == PROFILE_CDR ||
+                        usProfile == PROFILE_CDRW || usProfile == PROFILE_NONE;
+        }
     }
 
     CReadUserData::~CReadUserData()
@@ -100,6 +133,9 @@ namespace Core2ReadFunction
     bool CReadUserData::Read(unsigned char *pBuffer,unsigned long ulAddress,
                              unsigned long ulBlockCount)
     {
+        if (!m_bReadCD)
+            return Read10(pBuffer,ulAddress,ulBlockCount);
+
         return ReadCD(pBuffer,ulAddress,ulBlockCount,MCD_USERDATA,SCD_NONE,C2EI_NONE);
     }
 
@@ -113,7 +149,7 @@ namespace Core2ReadFunction
         return m_ulFrameSize;
     }
 
-    CReadC2::CReadC2(ckmmc::Device &Device) :
+    CReadC2::CReadC2(CCore2Transport Device) :
         CReadFunction(Device)
     {
         m_ulErrSecCount = 0;
@@ -19,6 +19,7 @@
 #pragma once
 #include <ckcore/stream.hh>
 #include <ckmmc/device.hh>
+#include "core2_transport.hh"
 #include "advanced_progress.hh"
 
 #define CORE2_READ_RETRYCOUNT			1
@@ -30,7 +31,7 @@ namespace Core2ReadFunction
     class CReadFunction
     {
     private:
-        ckmmc::Device &m_Device;
+        CCore2Transport m_Device;
 
     protected:
         enum eMainChannelData
@@ -55,9 +56,10 @@ namespace Core2ReadFunction
 
         bool ReadCD(unsigned char *pBuffer,unsigned long ulAddress,unsigned long ulBlockCount,
             eMainChannelData MCD,eSubChannelData SCD,eC2ErrorInfo ErrorInfo);
+        bool Read10(unsigned char *pBuffer,unsigned long ulAddress,unsigned long ulBlockCount);
 
     public:
-        CReadFunction(ckmmc::Device &Device);
+        CReadFunction(CCore2Transport Device);
 
         virtual bool Read(unsigned char *pBuffer,unsigned long ulAddress,
             unsigned long ulBlockCount) = 0;
@@ -70,9 +72,10 @@ namespace Core2ReadFunction
     private:
         ckcore::OutStream *m_pOutStream;
         unsigned long m_ulFrameSize;
+        bool m_bReadCD;		// READ CD is only supported by CD media.
 
     public:
-        CReadUserData(ckmmc::Device &Device,ckcore::OutStream *pOutStream);
+        CReadUserData(CCore2Transport Device,ckcore::OutStream *pOutStream);
         ~CReadUserData();
 
         bool Read(unsigned char *pBuffer,unsigned long ulAddress,
@@ -95,7 +98,7 @@ namespace Core2ReadFunction
         unsigned char NumBits(unsigned char ucData);
 
     public:
-        CReadC2(ckmmc::Device &Device);
+        CReadC2(CCore2Transport Device);
         ~CReadC2();
 
         bool Read(unsigned char *pBuffer,unsigned long ulAddress,
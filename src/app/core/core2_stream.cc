@@ -19,130 +19,200 @@
 #include "stdafx.hh"
 #include "core2_read.hh"
 #include "core2_stream.hh"
+#include "string_table.hh"
+#include "lang_util.hh"
 
 CCore2InStream::CCore2InStream(ckcore::Log *pLog,ckmmc::Device &Device,
-                               unsigned long ulStartBlock,unsigned long ulEndBlock) :
-    m_pLog(pLog),m_Device(Device),m_ReadFunc(Device,&m_Stream),m_ulStartBlock(ulStartBlock),
-    m_ulEndBlock(ulEndBlock),m_ulCurBlock(ulStartBlock)
+                               unsigned long ulStartBlock,unsigned long ulEndBlock,
+                               CAdvancedProgress *pProgress) :
+    m_pLog(pLog),m_pProgress(pProgress),m_Device(Device),m_ReadFunc(Device,&m_Stream),
+    m_ulStartBlock(ulStartBlock),m_ulEndBlock(ulEndBlock),m_uiPos(0),m_ulReadAhead(0),
+    m_ulNextChunk(0),m_ulBlocksRead(0),m_ulReadCount(0),m_ulCacheHits(0),m_ulLastUpdate(0)
 {
-    m_ulBufferData = 0;
-    m_ulBufferPos = 0;
-    m_ulBufferSize = m_ReadFunc.GetFrameSize() * CORE2_INSTREAM_FRAMEFACTOR;
-    m_pBuffer = new unsigned char[m_ulBufferSize];
-
-    m_Stream.SetBuffer(m_pBuffer,m_ulBufferSize);
+    m_ulChunkSize = m_ReadFunc.GetFrameSize() * CORE2_INSTREAM_CHUNKFRAMES;
+    m_pReadBuffer = new unsigned char[m_ulChunkSize * (CORE2_INSTREAM_MAXREADAHEAD + 1)];
 }
 
 CCore2InStream::~CCore2InStream()
 {
-    if (m_pBuffer != NULL)
-    {
-        delete [] m_pBuffer;
-        m_pBuffer = NULL;
+    std::list<CChunk *>::iterator itChunk;
+    for (itChunk = m_Chunks.begin(); itChunk != m_Chunks.end(); itChunk++)
+        delete *itChunk;
+
+    m_Chunks.clear();
+    m_ChunkMap.clear();
 
-        m_ulBufferSize = 0;
+    if (m_pReadBuffer != NULL)
+    {
+        delete [] m_pReadBuffer;
+        m_pReadBuffer = NULL;
     }
 }
 
-unsigned long CCore2InStream::GetSafeFrameReadCount()
+unsigned long CCore2InStream::GetChunkCount()
 {
-    if (m_ulEndBlock - m_ulCurBlock < CORE2_INSTREAM_FRAMEFACTOR)
-        return m_ulEndBlock - m_ulCurBlock;
-    else
-        return CORE2_INSTREAM_FRAMEFACTOR;
+    unsigned long ulNumBlocks = m_ulEndBlock - m_ulStartBlock;
+    return (ulNumBlocks + CORE2_INSTREAM_CHUNKFRAMES - 1) / CORE2_INSTREAM_CHUNKFRAMES;
+}
+
+unsigned __int64 CCore2InStream::GetStreamSize()
+{
+    return (unsigned __int64)(m_ulEndBlock - m_ulStartBlock) * m_ReadFunc.GetFrameSize();
 }
 
 /*
-    Not to be confused with other BytesToSector functions that calculates
-    The number of sectors to store the specified number of bytes. This function
-    calculates in which frame the last byte is stored.
+    CCore2InStream::GetChunk
+    ------------------------
+    Returns the chunk with the specified index, the chunk is read from the
+    disc if it's not in the cache. Returns NULL if the chunk could not be
+    read.
 */
-unsigned long CCore2InStream::BytesToFrame(unsigned __int64 uiBytes)
+CCore2InStream::CChunk *CCore2InStream::GetChunk(unsigned long ulIndex)
 {
-    if (uiBytes == 0)
-        return 0;
+    std::map<unsigned long,std::list<CChunk *>::iterator>::iterator itChunk =
+        m_ChunkMap.find(ulIndex);
 
-    unsigned long ulSectors = 0;
-
-    while (uiBytes > m_ReadFunc.GetFrameSize())
+    if (itChunk != m_ChunkMap.end())
     {
-        uiBytes -= m_ReadFunc.GetFrameSize();
-        ulSectors++;
+        m_ulCacheHits++;
+
+        // Move the chunk first in the list since it's now the most recently used.
+        m_Chunks.splice(m_Chunks.begin(),m_Chunks,itChunk->second);
+        return m_Chunks.front();
     }
 
-    return ulSectors;
+    return ReadChunks(ulIndex);
 }
 
-bool CCore2InStream::FillBuffer()
+/*
+    CCore2InStream::ReadChunks
+    --------------------------
+    Reads the chunk with the specified index together with the chunks to read
+    ahead using a single read operation. The read-ahead is doubled every time
+    the chunk following the previously read chunks is requested and is reset
+    when the stream is accessed out of sequence.
+*/
+CCore2InStream::CChunk *CCore2InStream::ReadChunks(unsigned long ulIndex)
 {
-    unsigned long ulNumFrames = GetSafeFrameReadCount();
-    if (!m_Read.ReadData(m_Device,NULL,&m_ReadFunc,m_ulCurBlock,ulNumFrames,false))
+    if (m_ulReadCount > 0 && ulIndex == m_ulNextChunk)
     {
-        m_pLog->print_line(_T("  Error: Unable to read user data from disc (%u, %u)."),
-            m_ulCurBlock,ulNumFrames);
-        return false;
+        m_ulReadAhead = m_ulReadAhead == 0 ? 1 : m_ulReadAhead * 2;
+        if (m_ulReadAhead > CORE2_INSTREAM_MAXREADAHEAD)
+            m_ulReadAhead = CORE2_INSTREAM_MAXREADAHEAD;
+    }
+    else
+    {
+        m_ulReadAhead = 0;
     }
 
-    m_ulBufferData = m_Stream.GetBufferDataSize();
-    m_ulBufferPos = 0;
+    // Stop reading ahead at the first chunk that's already cached.
+    unsigned long ulChunkCount = GetChunkCount();
+    unsigned long ulNumChunks = 1;
+    while (ulNumChunks <= m_ulReadAhead && ulIndex + ulNumChunks < ulChunkCount &&
+           m_ChunkMap.find(ulIndex + ulNumChunks) == m_ChunkMap.end())
+    {
+        ulNumChunks++;
+    }
 
-    m_ulCurBlock += ulNumFrames;
+    unsigned long ulFirstBlock = m_ulStartBlock + ulIndex * CORE2_INSTREAM_CHUNKFRAMES;
+    unsigned long ulNumBlocks = ulNumChunks * CORE2_INSTREAM_CHUNKFRAMES;
+    if (ulFirstBlock + ulNumBlocks > m_ulEndBlock)
+        ulNumBlocks = m_ulEndBlock - ulFirstBlock;
 
-    return true;
-}
+    m_Stream.SetBuffer(m_pReadBuffer,m_ulChunkSize * ulNumChunks);
+    if (!m_Read.ReadData(m_Device,NULL,&m_ReadFunc,ulFirstBlock,ulNumBlocks,false))
+    {
+        m_pLog->print_line(_T("  Error: Unable to read user data from disc (%u, %u)."),
+            ulFirstBlock,ulNumBlocks);
+        return NULL;
+    }
 
-ckcore::tint64 CCore2InStream::read(void *pBuffer,ckcore::tuint32 uiCount)
-{
-    if (end())
-        return -1;	// W00t? This was discovered when switching to ckcore.
+    m_ulBlocksRead += ulNumBlocks;
+    m_ulReadCount++;
+    m_ulNextChunk = ulIndex + ulNumChunks;
 
-    ckcore::tint64 iResult = 0;
+    // Split the data into chunks, the requested chunk is inserted last so that
+    // it becomes the most recently used chunk. When the cache is full the least
+    // recently used chunks are reused.
+    unsigned long ulDataSize = m_Stream.GetBufferDataSize();
 
-    // Check if the requested data can be found in the buffer.
-    if (uiCount <= m_ulBufferData - m_ulBufferPos)
+    for (unsigned long i = ulNumChunks; i-- > 0;)
     {
-        memcpy(pBuffer,m_pBuffer + m_ulBufferPos,uiCount);
-        m_ulBufferPos += uiCount;
+        CChunk *pChunk = NULL;
+        if (m_Chunks.size() < CORE2_INSTREAM_CACHECHUNKS)
+        {
+            pChunk = new CChunk(ulIndex + i,m_ulChunkSize);
+        }
+        else
+        {
+            pChunk = m_Chunks.back();
+            m_Chunks.pop_back();
+            m_ChunkMap.erase(pChunk->m_ulIndex);
 
-        iResult = uiCount;
+            pChunk->m_ulIndex = ulIndex + i;
+        }
+
+        unsigned long ulOffset = i * m_ulChunkSize;
+        pChunk->m_ulDataSize = ulDataSize > ulOffset ? min(ulDataSize - ulOffset,m_ulChunkSize) : 0;
+        memcpy(pChunk->m_pData,m_pReadBuffer + ulOffset,pChunk->m_ulDataSize);
+
+        m_Chunks.push_front(pChunk);
+        m_ChunkMap[pChunk->m_ulIndex] = m_Chunks.begin();
     }
-    else
+
+    if (m_pProgress != NULL && GetTickCount() > m_ulLastUpdate + CORE2_INSTREAM_UPDATEINTERVAL)
     {
-        // First copy everything we have in the buffer.
-        unsigned long ulInBuffer = m_ulBufferData - m_ulBufferPos;
+        m_pProgress->set_status(lngGetString(STATUS_IMPORTSESSION),m_ulBlocksRead);
+        m_ulLastUpdate = GetTickCount();
+    }
 
-        memcpy(pBuffer,m_pBuffer + m_ulBufferPos,ulInBuffer);
-        m_ulBufferPos += ulInBuffer;
+    return m_Chunks.front();
+}
 
-        unsigned long ulRemain = uiCount - ulInBuffer;
+unsigned long CCore2InStream::GetBlocksRead()
+{
+    return m_ulBlocksRead;
+}
 
-        if (end())
-            return ulInBuffer;
+unsigned long CCore2InStream::GetReadCount()
+{
+    return m_ulReadCount;
+}
 
-        // Check if we can read more from the CD.
-        if (!FillBuffer())
-            return -1;
+unsigned long CCore2InStream::GetCacheHits()
+{
+    return m_ulCacheHits;
+}
 
-        if (ulRemain > m_ulBufferData - m_ulBufferPos)
-        {
-            // FIXME: Is execution of this block possible?
-            unsigned long ulCanRead = m_ulBufferData - m_ulBufferPos;
+ckcore::tint64 CCore2InStream::read(void *pBuffer,ckcore::tuint32 uiCount)
+{
+    if (end())
+        return -1;	// W00t? This was discovered when switching to ckcore.
 
-            memcpy((unsigned char *)pBuffer + ulInBuffer,m_pBuffer + m_ulBufferPos,ulCanRead);
-            m_ulBufferPos += ulCanRead;
+    if (m_pProgress != NULL && m_pProgress->cancelled())
+        return -1;
 
-            iResult = ulInBuffer + ulCanRead;
-        }
-        else
-        {
-            memcpy((unsigned char *)pBuffer + ulInBuffer,m_pBuffer + m_ulBufferPos,ulRemain);
-            m_ulBufferPos += ulRemain;
+    unsigned char *pTarget = (unsigned char *)pBuffer;
+    ckcore::tuint32 uiRead = 0;
 
-            iResult = uiCount;
-        }
+    while (uiRead < uiCount && !end())
+    {
+        CChunk *pChunk = GetChunk((unsigned long)(m_uiPos / m_ulChunkSize));
+        if (pChunk == NULL)
+            return -1;
+
+        unsigned long ulOffset = (unsigned long)(m_uiPos % m_ulChunkSize);
+        if (ulOffset >= pChunk->m_ulDataSize)
+            break;
+
+        unsigned long ulCopy = min(pChunk->m_ulDataSize - ulOffset,uiCount - uiRead);
+        memcpy(pTarget + uiRead,pChunk->m_pData + ulOffset,ulCopy);
+
+        uiRead += ulCopy;
+        m_uiPos += ulCopy;
     }
 
-    return iResult;
+    return uiRead;
 }
 
 ckcore::tint64 CCore2InStream::size()
@@ -152,52 +222,20 @@ ckcore::tint64 CCore2InStream::size()
 
 bool CCore2InStream::end()
 {
-    return m_ulCurBlock >= m_ulEndBlock && m_ulBufferPos >= m_ulBufferData;
+    return m_uiPos >= GetStreamSize();
 }
 
+/*
+    CCore2InStream::seek
+    --------------------
+    Moves the stream position, no data is read until the stream is read from.
+*/
 bool CCore2InStream::seek(ckcore::tuint32 uiDistance,ckcore::InStream::StreamWhence Whence)
 {
     if (Whence == ckcore::InStream::ckSTREAM_BEGIN)
-    {
-        unsigned long ulFrame = BytesToFrame(uiDistance);
-
-        // Calculate which sector the byte distance corresponds to.
-        m_ulCurBlock = m_ulStartBlock + ulFrame;
-
-        if (!FillBuffer())
-            return false;
-
-        m_ulBufferPos = (unsigned long)(uiDistance - ulFrame * m_ReadFunc.GetFrameSize());
-        return true;
-    }
+        m_uiPos = uiDistance;
     else
-    {
-        // Check if we can just move forward in the internal buffer.
-        if (uiDistance < m_ulBufferData - m_ulBufferPos)
-        {
-            m_ulBufferPos += (unsigned long)uiDistance;
-        }
-        else
-        {
-            // In which internal frame are we?
-            unsigned long ulFrame = BytesToFrame(m_ulBufferPos);
-
-            // Search through the current frame.
-            ulFrame++;
-            __int64 iRemain = uiDistance - (m_ulBufferData - m_ulBufferPos);
-
-            // How many more frames should we move through.
-            ulFrame += BytesToFrame(iRemain);
-
-            m_ulCurBlock = m_ulStartBlock + ulFrame;
-
-            if (!FillBuffer())
-                return false;
-
-            m_ulBufferPos = (unsigned long)(iRemain - ulFrame * m_ReadFunc.GetFrameSize());
-            return true;
-        }
-    }
+        m_uiPos += uiDistance;
 
-    return true;
+    return m_uiPos <= GetStreamSize();
 }
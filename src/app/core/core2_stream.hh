@@ -17,12 +17,24 @@
  */
 
 #pragma once
+#include <list>
+#include <map>
 #include <ckcore/stream.hh>
 #include <ckcore/log.hh>
+#include "advanced_progress.hh"
 #include "core2_read.hh"
 
-#define CORE2_INSTREAM_FRAMEFACTOR			10	// We will cache 10 frames in the memory.
-
+#define CORE2_INSTREAM_CHUNKFRAMES			16		// Number of frames in each cached chunk.
+#define CORE2_INSTREAM_CACHECHUNKS			512		// Maximum number of cached chunks.
+#define CORE2_INSTREAM_MAXREADAHEAD			8		// Maximum number of chunks to read ahead.
+#define CORE2_INSTREAM_UPDATEINTERVAL		250		// Milliseconds.
+
+// Reads user data from a disc. The data is read in fixed size chunks which
+// are kept in a least recently used cache, so seeking back to data that has
+// already been read does not require a new read command. Chunks that are
+// missed in sequence are read with a growing read-ahead, directory extents
+// are usually stored back to back which lets a file system reader walk them
+// with few read commands.
 class CCore2InStream : public ckcore::InStream
 {
 private:
@@ -42,6 +54,7 @@ private:
         {
             m_pBuffer = pBuffer;
             m_ulBufferSize = ulBufferSize;
+            m_ulBufferData = 0;
         }
 
         ckcore::tint64 write(const void *pBuffer,ckcore::tuint32 uiCount)
@@ -49,11 +62,11 @@ private:
             if (m_pBuffer == NULL)
                 return -1;
 
-            if (m_ulBufferSize < uiCount)
+            if (m_ulBufferSize - m_ulBufferData < uiCount)
                 return -1;
 
-            memcpy(m_pBuffer,pBuffer,uiCount);
-            m_ulBufferData = uiCount;
+            memcpy(m_pBuffer + m_ulBufferData,pBuffer,uiCount);
+            m_ulBufferData += uiCount;
 
             return uiCount;
         }
@@ -65,33 +78,69 @@ private:
     };
     CInternalStream m_Stream;
 
-    unsigned char *m_pBuffer;
-    unsigned long m_ulBufferSize;
-    unsigned long m_ulBufferData;		// The amount of data that's stored in the buffer.
-    unsigned long m_ulBufferPos;
+    class CChunk
+    {
+    public:
+        unsigned long m_ulIndex;
+        unsigned long m_ulDataSize;
+        unsigned char *m_pData;
+
+        CChunk(unsigned long ulIndex,unsigned long ulBufferSize) :
+            m_ulIndex(ulIndex),m_ulDataSize(0)
+        {
+            m_pData = new unsigned char[ulBufferSize];
+        }
+
+        ~CChunk()
+        {
+            delete [] m_pData;
+        }
+    };
+
+    // The most recently used chunk is first in the list.
+    std::list<CChunk *> m_Chunks;
+    std::map<unsigned long,std::list<CChunk *>::iterator> m_ChunkMap;
+
+    unsigned char *m_pReadBuffer;
+    unsigned long m_ulChunkSize;
+    unsigned long m_ulReadAhead;
+    unsigned long m_ulNextChunk;		// The chunk following the last chunk that was read.
 
     const unsigned long m_ulStartBlock;	// The start sector to use as beginning of the stream.
     const unsigned long m_ulEndBlock;	// The last sector.
-    unsigned long m_ulCurBlock;
+    unsigned __int64 m_uiPos;			// Position in bytes relative to the start sector.
+
+    // Statistics.
+    unsigned long m_ulBlocksRead;
+    unsigned long m_ulReadCount;
+    unsigned long m_ulCacheHits;
+    unsigned long m_ulLastUpdate;
 
     ckcore::Log *m_pLog;
+    CAdvancedProgress *m_pProgress;
     ckmmc::Device &m_Device;
 
     Core2ReadFunction::CReadUserData m_ReadFunc;
     CCore2Read m_Read;
 
-    unsigned long GetSafeFrameReadCount();
-    unsigned long BytesToFrame(unsigned __int64 uiBytes);
-    bool FillBuffer();
+    unsigned long GetChunkCount();
+    unsigned __int64 GetStreamSize();
+    CChunk *GetChunk(unsigned long ulIndex);
+    CChunk *ReadChunks(unsigned long ulIndex);
 
 public:
     CCore2InStream(ckcore::Log *pLog,ckmmc::Device &Device,
-        unsigned long ulStartBlock,unsigned long ulEndBlock);
+        unsigned long ulStartBlock,unsigned long ulEndBlock,
+        CAdvancedProgress *pProgress = NULL);
     ~CCore2InStream();
 
+    unsigned long GetBlocksRead();
+    unsigned long GetReadCount();
+    unsigned long GetCacheHits();
+
     // ckCore::InStream.
     ckcore::tint64 read(void *pBuffer,ckcore::tuint32 uiCount);
     ckcore::tint64 size();
     bool end();
     bool seek(ckcore::tuint32 uiDistnace,ckcore::InStream::StreamWhence Whence);
-};
\ No newline at end of file
+};
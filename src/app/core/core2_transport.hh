@@ -0,0 +1,67 @@
+/*
+ * InfraRecorder - CD/DVD burning software
+ * Copyright (C) 2006-2012 Christian Kindahl
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#include <ckmmc/device.hh>
+#include <base/simulated_device.hh>
+
+// The target of the commands sent by the core. Commands are sent to a drive
+// through ckmmc::Device, or answered by a CSimulatedDevice so that the core
+// can be tested and profiled without a drive. Devices of both kinds convert
+// implicitly, functions taking a transport can be called with either.
+class CCore2Transport
+{
+private:
+    ckmmc::Device *m_pDevice;
+    CSimulatedDevice *m_pSimDevice;
+
+public:
+    CCore2Transport(ckmmc::Device &Device) : m_pDevice(&Device),m_pSimDevice(NULL)
+    {
+    }
+
+    CCore2Transport(CSimulatedDevice &SimDevice) : m_pDevice(NULL),m_pSimDevice(&SimDevice)
+    {
+    }
+
+    // Same contract as ckmmc::Device::transport and transport_with_sense.
+    bool transport(unsigned char *pCdb,unsigned char ucCdbLen,
+                   unsigned char *pData,unsigned long ulDataLen,
+                   ckmmc::Device::TransportMode Mode)
+    {
+        if (m_pSimDevice != NULL)
+            return m_pSimDevice->Transport(pCdb,ucCdbLen,pData,ulDataLen);
+
+        return m_pDevice->transport(pCdb,ucCdbLen,pData,ulDataLen,Mode);
+    }
+
+    bool transport_with_sense(unsigned char *pCdb,unsigned char ucCdbLen,
+                              unsigned char *pData,unsigned long ulDataLen,
+                              ckmmc::Device::TransportMode Mode,
+                              unsigned char *pSense,unsigned char &ucResult)
+    {
+        if (m_pSimDevice != NULL)
+        {
+            return m_pSimDevice->TransportWithSense(pCdb,ucCdbLen,pData,ulDataLen,
+                                                    pSense,ucResult);
+        }
+
+        return m_pDevice->transport_with_sense(pCdb,ucCdbLen,pData,ulDataLen,Mode,
+                                               pSense,ucResult);
+    }
+};
@@ -0,0 +1,691 @@
+/*
+ * InfraRecorder - CD/DVD burning software
+ * Copyright (C) 2006-2012 Christian Kindahl
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "stdafx.hh"
+#include <ckcore/filestream.hh>
+#include <base/checksum_util.hh>
+#include "core2_info.hh"
+#include "core2_read.hh"
+#include "core2_verify.hh"
+#include "log_dlg.hh"
+#include "string_table.hh"
+#include "lang_util.hh"
+
+/*
+    Returns the path in a form that can be compared between the names read
+    from the file system and the names given by the file system writer: with
+    forward slashes, without file version numbers and in lower case.
+*/
+static ckcore::tstring NormalizePath(const ckcore::tstring &Path)
+{
+    ckcore::tstring Result;
+    for (size_t i = 0; i < Path.size(); i++)
+    {
+        ckcore::tchar c = Path[i];
+        if (c == '\\')
+            c = '/';
+
+        // Skip the version number, up to the next separator.
+        if (c == ';')
+        {
+            while (i + 1 < Path.size() && Path[i + 1] != '/' && Path[i + 1] != '\\')
+                i++;
+            continue;
+        }
+
+        Result.push_back((ckcore::tchar)_totlower(c));
+    }
+
+    return Result;
+}
+
+CCore2Verify::CSessionStream::CSessionStream(ckcore::InStream &InStream,unsigned long ulSessionStart) :
+    m_InStream(InStream),m_uiOffset((unsigned __int64)ulSessionStart * 2048),m_uiPos(0)
+{
+}
+
+ckcore::tint64 CCore2Verify::CSessionStream::read(void *pBuffer,ckcore::tuint32 uiCount)
+{
+    // Nothing before the session is part of the image.
+    if (m_uiPos < m_uiOffset)
+        return -1;
+
+    ckcore::tint64 iRead = m_InStream.read(pBuffer,uiCount);
+    if (iRead > 0)
+        m_uiPos += iRead;
+
+    return iRead;
+}
+
+ckcore::tint64 CCore2Verify::CSessionStream::size()
+{
+    ckcore::tint64 iSize = m_InStream.size();
+    return iSize < 0 ? iSize : iSize + (ckcore::tint64)m_uiOffset;
+}
+
+bool CCore2Verify::CSessionStream::end()
+{
+    return m_uiPos >= m_uiOffset && m_InStream.end();
+}
+
+bool CCore2Verify::CSessionStream::seek(ckcore::tuint32 uiDistance,ckcore::InStream::StreamWhence Whence)
+{
+    if (Whence == ckcore::InStream::ckSTREAM_BEGIN)
+        m_uiPos = uiDistance;
+    else
+        m_uiPos += uiDistance;
+
+    if (m_uiPos < m_uiOffset)
+        return false;
+
+    return m_InStream.seek((ckcore::tuint32)(m_uiPos - m_uiOffset),ckcore::InStream::ckSTREAM_BEGIN);
+}
+
+CCore2Verify::CCore2Verify() : m_uiThreadCount(0),m_ulImageSectors(0),m_ulFailCount(0)
+{
+    ::InitializeCriticalSection(&m_csQueue);
+
+    m_hQueueSemaphore = ::CreateSemaphore(NULL,0,CORE2_VERIFY_CHUNKCOUNT + CORE2_VERIFY_THREADS,NULL);
+    m_hFreeSemaphore = ::CreateSemaphore(NULL,CORE2_VERIFY_CHUNKCOUNT,CORE2_VERIFY_CHUNKCOUNT,NULL);
+
+    for (unsigned int i = 0; i < CORE2_VERIFY_CHUNKCOUNT; i++)
+        m_Free.push_back(&m_Chunks[i]);
+}
+
+CCore2Verify::~CCore2Verify()
+{
+    StopThreads();
+
+    if (m_hQueueSemaphore != NULL)
+        ::CloseHandle(m_hQueueSemaphore);
+    if (m_hFreeSemaphore != NULL)
+        ::CloseHandle(m_hFreeSemaphore);
+
+    ::DeleteCriticalSection(&m_csQueue);
+}
+
+/*
+    CCore2Verify::HashThread
+    ------------------------
+    Hashes the blocks of queued chunks until an empty queue is signalled.
+*/
+DWORD WINAPI CCore2Verify::HashThread(LPVOID lpThreadParameter)
+{
+    CCore2Verify *pVerify = (CCore2Verify *)lpThreadParameter;
+
+    while (true)
+    {
+        ::WaitForSingleObject(pVerify->m_hQueueSemaphore,INFINITE);
+
+        ::EnterCriticalSection(&pVerify->m_csQueue);
+
+        if (pVerify->m_Queue.empty())
+        {
+            ::LeaveCriticalSection(&pVerify->m_csQueue);
+            break;
+        }
+
+        CChunk *pChunk = pVerify->m_Queue.front();
+        pVerify->m_Queue.pop_front();
+
+        ::LeaveCriticalSection(&pVerify->m_csQueue);
+
+        // Each chunk covers its own range of blocks, no locking is needed.
+        std::vector<ckcore::tuint32> &Hashes = *pChunk->m_pHashes;
+        for (unsigned long ulOffset = 0; ulOffset < pChunk->m_ulSize; ulOffset += CORE2_VERIFY_BLOCKSIZE)
+        {
+            unsigned long ulSize = min(pChunk->m_ulSize - ulOffset,CORE2_VERIFY_BLOCKSIZE);
+            Hashes[pChunk->m_ulFirstBlock + ulOffset / CORE2_VERIFY_BLOCKSIZE] =
+                ChecksumCrc32c(pChunk->m_pData + ulOffset,ulSize);
+        }
+
+        ::EnterCriticalSection(&pVerify->m_csQueue);
+        pVerify->m_Free.push_back(pChunk);
+        ::LeaveCriticalSection(&pVerify->m_csQueue);
+
+        ::ReleaseSemaphore(pVerify->m_hFreeSemaphore,1,NULL);
+    }
+
+    return 0;
+}
+
+void CCore2Verify::StartThreads()
+{
+    for (unsigned int i = 0; i < CORE2_VERIFY_THREADS; i++)
+    {
+        unsigned long ulThreadID = 0;
+        HANDLE hThread = ::CreateThread(NULL,0,HashThread,this,0,&ulThreadID);
+        if (hThread != NULL)
+            m_hThreads[m_uiThreadCount++] = hThread;
+    }
+}
+
+void CCore2Verify::StopThreads()
+{
+    if (m_uiThreadCount == 0)
+        return;
+
+    WaitForChunks();
+
+    // An empty queue tells the threads to exit.
+    ::ReleaseSemaphore(m_hQueueSemaphore,m_uiThreadCount,NULL);
+    ::WaitForMultipleObjects(m_uiThreadCount,m_hThreads,TRUE,INFINITE);
+
+    for (unsigned int i = 0; i < m_uiThreadCount; i++)
+        ::CloseHandle(m_hThreads[i]);
+
+    m_uiThreadCount = 0;
+}
+
+CCore2Verify::CChunk *CCore2Verify::GetFreeChunk()
+{
+    ::WaitForSingleObject(m_hFreeSemaphore,INFINITE);
+
+    ::EnterCriticalSection(&m_csQueue);
+    CChunk *pChunk = m_Free.front();
+    m_Free.pop_front();
+    ::LeaveCriticalSection(&m_csQueue);
+
+    return pChunk;
+}
+
+/*
+    CCore2Verify::QueueChunk
+    ------------------------
+    Passes a chunk to the hashing threads. If no threads could be started the
+    chunk is hashed by the calling thread.
+*/
+void CCore2Verify::QueueChunk(CChunk *pChunk)
+{
+    ::EnterCriticalSection(&m_csQueue);
+
+    if (m_uiThreadCount == 0)
+    {
+        std::vector<ckcore::tuint32> &Hashes = *pChunk->m_pHashes;
+        for (unsigned long ulOffset = 0; ulOffset < pChunk->m_ulSize; ulOffset += CORE2_VERIFY_BLOCKSIZE)
+        {
+            unsigned long ulSize = min(pChunk->m_ulSize - ulOffset,CORE2_VERIFY_BLOCKSIZE);
+            Hashes[pChunk->m_ulFirstBlock + ulOffset / CORE2_VERIFY_BLOCKSIZE] =
+                ChecksumCrc32c(pChunk->m_pData + ulOffset,ulSize);
+        }
+
+        m_Free.push_back(pChunk);
+        ::LeaveCriticalSection(&m_csQueue);
+
+        ::ReleaseSemaphore(m_hFreeSemaphore,1,NULL);
+        return;
+    }
+
+    m_Queue.push_back(pChunk);
+    ::LeaveCriticalSection(&m_csQueue);
+
+    ::ReleaseSemaphore(m_hQueueSemaphore,1,NULL);
+}
+
+/*
+    CCore2Verify::WaitForChunks
+    ---------------------------
+    Waits until all queued chunks have been hashed.
+*/
+void CCore2Verify::WaitForChunks()
+{
+    for (unsigned int i = 0; i < CORE2_VERIFY_CHUNKCOUNT; i++)
+        ::WaitForSingleObject(m_hFreeSemaphore,INFINITE);
+
+    ::ReleaseSemaphore(m_hFreeSemaphore,CORE2_VERIFY_CHUNKCOUNT,NULL);
+}
+
+/*
+    CCore2Verify::AddFiles
+    ----------------------
+    Collects the sectors occupied by each file in the file system tree.
+*/
+void CCore2Verify::AddFiles(ckfilesystem::IsoTreeNode *pRootNode)
+{
+    std::vector<std::pair<ckfilesystem::IsoTreeNode *,ckcore::tstring> > FolderStack;
+    FolderStack.push_back(std::make_pair(pRootNode,ckcore::tstring(ckT(""))));
+
+    while (FolderStack.size() > 0)
+    {
+        ckfilesystem::IsoTreeNode *pNode = FolderStack.back().first;
+        ckcore::tstring FolderPath = FolderStack.back().second;
+
+        FolderStack.pop_back();
+
+        std::vector<ckfilesystem::IsoTreeNode *>::const_iterator itNode;
+        for (itNode = pNode->children_.begin(); itNode != pNode->children_.end(); itNode++)
+        {
+            ckcore::tstring FilePath = FolderPath + ckT("/") + (*itNode)->file_name_;
+
+            if ((*itNode)->file_flags_ & DIRRECORD_FILEFLAG_DIRECTORY)
+            {
+                FolderStack.push_back(std::make_pair(*itNode,FilePath));
+            }
+            else if ((*itNode)->extent_len_ > 0)
+            {
+                unsigned long ulSectors = ((*itNode)->extent_len_ + 2047) / 2048;
+                m_Files.push_back(CFileExtent(FilePath,(*itNode)->extent_loc_,
+                    (*itNode)->extent_loc_ + ulSectors - 1));
+            }
+        }
+    }
+}
+
+/*
+    CCore2Verify::ReadFiles
+    -----------------------
+    Collects the extents of the files in the file system of the image, they
+    are only used for the report.
+*/
+void CCore2Verify::ReadFiles(ckcore::InStream &InStream,unsigned long ulSessionStart)
+{
+    if (AddJolietFiles(InStream,ulSessionStart))
+        return;
+
+    CSessionStream SessionStream(InStream,ulSessionStart);
+    SessionStream.seek(ulSessionStart * 2048,ckcore::InStream::ckSTREAM_BEGIN);
+
+    ckfilesystem::IsoReader Reader(*g_pLogDlg);
+    if (Reader.read(SessionStream,ulSessionStart))
+        AddFiles(Reader.get_root());
+    else
+        g_pLogDlg->print_line(_T("  Warning: Unable to read the file system of the disc image."));
+}
+
+/*
+    CCore2Verify::AddJolietFiles
+    ----------------------------
+    Collects the sectors occupied by each file in the Joliet directory tree.
+    InStream is the image itself, the sectors recorded in the file system are
+    relative to the start of the disc. Returns false if the image has no
+    Joliet file system, or if it can't be read.
+*/
+bool CCore2Verify::AddJolietFiles(ckcore::InStream &InStream,unsigned long ulSessionStart)
+{
+    unsigned char ucSector[2048];
+    unsigned long ulRootLoc = 0,ulRootLen = 0;
+
+    // Locate the Joliet supplementary volume descriptor.
+    for (unsigned long ulSector = 16; ulRootLen == 0; ulSector++)
+    {
+        if (!InStream.seek(ulSector * 2048,ckcore::InStream::ckSTREAM_BEGIN) ||
+            InStream.read(ucSector,sizeof(ucSector)) != sizeof(ucSector))
+        {
+            return false;
+        }
+
+        // Volume descriptor set terminator.
+        if (ucSector[0] == 0xFF || memcmp(ucSector + 1,"CD001",5))
+            return false;
+
+        if (ucSector[0] == 0x02 && ucSector[88] == 0x25 && ucSector[89] == 0x2F &&
+            (ucSector[90] == 0x40 || ucSector[90] == 0x43 || ucSector[90] == 0x45))
+        {
+            // Location and size of the root directory record.
+            ulRootLoc = ucSector[158] | (ucSector[159] << 8) | (ucSector[160] << 16) | (ucSector[161] << 24);
+            ulRootLen = ucSector[166] | (ucSector[167] << 8) | (ucSector[168] << 16) | (ucSector[169] << 24);
+        }
+    }
+
+    std::vector<CFileExtent> Files;
+
+    std::vector<CFileExtent> FolderStack;
+    FolderStack.push_back(CFileExtent(ckcore::tstring(ckT("")),ulRootLoc,
+        ulRootLoc + (ulRootLen + 2047) / 2048 - 1));
+
+    while (FolderStack.size() > 0)
+    {
+        CFileExtent Folder = FolderStack.back();
+        FolderStack.pop_back();
+
+        if (Folder.m_ulFirstSector < ulSessionStart)
+            return false;
+
+        for (unsigned long ulSector = Folder.m_ulFirstSector; ulSector <= Folder.m_ulLastSector; ulSector++)
+        {
+            if (!InStream.seek((ulSector - ulSessionStart) * 2048,ckcore::InStream::ckSTREAM_BEGIN) ||
+                InStream.read(ucSector,sizeof(ucSector)) != sizeof(ucSector))
+            {
+                return false;
+            }
+
+            // Directory records don't cross sector boundaries.
+            unsigned long ulPos = 0;
+            while (ulPos + 33 <= sizeof(ucSector) && ucSector[ulPos] != 0)
+            {
+                const unsigned char *pRecord = ucSector + ulPos;
+                unsigned char ucRecordLen = pRecord[0];
+                unsigned char ucNameLen = pRecord[32];
+                if (ulPos + ucRecordLen > sizeof(ucSector) || 33 + ucNameLen > ucRecordLen)
+                    return false;
+
+                ulPos += ucRecordLen;
+
+                // The current and parent directory records.
+                if (ucNameLen == 1 && pRecord[33] <= 1)
+                    continue;
+
+                ckcore::tstring FileName;
+                for (unsigned char j = 0; j + 1 < ucNameLen; j += 2)
+                    FileName.push_back((ckcore::tchar)(pRecord[33 + j] << 8 | pRecord[33 + j + 1]));
+
+                unsigned long ulExtentLoc = pRecord[2] | (pRecord[3] << 8) | (pRecord[4] << 16) | (pRecord[5] << 24);
+                unsigned long ulExtentLen = pRecord[10] | (pRecord[11] << 8) | (pRecord[12] << 16) | (pRecord[13] << 24);
+
+                ckcore::tstring FilePath = Folder.m_FilePath + ckT("/") + FileName;
+
+                if (ulExtentLen == 0)
+                    continue;
+
+                unsigned long ulSectors = (ulExtentLen + 2047) / 2048;
+                if (pRecord[25] & DIRRECORD_FILEFLAG_DIRECTORY)
+                    FolderStack.push_back(CFileExtent(FilePath,ulExtentLoc,ulExtentLoc + ulSectors - 1));
+                else
+                    Files.push_back(CFileExtent(FilePath,ulExtentLoc,ulExtentLoc + ulSectors - 1));
+            }
+        }
+    }
+
+    m_Files.swap(Files);
+    return true;
+}
+
+/*
+    CCore2Verify::HashImage
+    -----------------------
+    Calculates the block hashes of the disc image and reads the extents of
+    the files in its file system. ulSessionStart is the address the image
+    will be recorded at, the file system of a multi-session image refers to
+    sectors relative to the start of the disc.
+*/
+bool CCore2Verify::HashImage(const TCHAR *szImagePath,CAdvancedProgress *pProgress,
+                             unsigned long ulSessionStart)
+{
+    g_pLogDlg->print_line(_T("CCore2Verify::HashImage"));
+
+    ckcore::FileInStream InStream(szImagePath);
+    if (!InStream.open())
+    {
+        g_pLogDlg->print_line(_T("  Error: Unable to open disc image \"%s\"."),szImagePath);
+        return false;
+    }
+
+    unsigned __int64 uiSize = (unsigned __int64)InStream.size();
+    m_ulImageSectors = (unsigned long)(uiSize / 2048);
+
+    m_ImageHashes.assign((unsigned long)((uiSize + CORE2_VERIFY_BLOCKSIZE - 1) / CORE2_VERIFY_BLOCKSIZE),0);
+    m_Files.clear();
+
+    if (pProgress != NULL)
+        pProgress->set_status(lngGetString(STATUS_HASHIMAGE));
+
+    unsigned long ulStartTime = ::GetTickCount();
+    StartThreads();
+
+    unsigned __int64 uiRead = 0;
+    bool bResult = true;
+
+    while (uiRead < uiSize)
+    {
+        if (pProgress != NULL && pProgress->cancelled())
+        {
+            bResult = false;
+            break;
+        }
+
+        CChunk *pChunk = GetFreeChunk();
+        pChunk->m_ulFirstBlock = (unsigned long)(uiRead / CORE2_VERIFY_BLOCKSIZE);
+        pChunk->m_ulSize = (unsigned long)min(uiSize - uiRead,(unsigned __int64)CORE2_VERIFY_CHUNKSIZE);
+        pChunk->m_pHashes = &m_ImageHashes;
+
+        if (InStream.read(pChunk->m_pData,pChunk->m_ulSize) != pChunk->m_ulSize)
+        {
+            g_pLogDlg->print_line(_T("  Error: Unable to read from disc image."));
+
+            ::EnterCriticalSection(&m_csQueue);
+            m_Free.push_back(pChunk);
+            ::LeaveCriticalSection(&m_csQueue);
+            ::ReleaseSemaphore(m_hFreeSemaphore,1,NULL);
+
+            bResult = false;
+            break;
+        }
+
+        QueueChunk(pChunk);
+        uiRead += pChunk->m_ulSize;
+
+        if (pProgress != NULL)
+            pProgress->set_progress((unsigned char)((uiRead * 100) / uiSize));
+    }
+
+    StopThreads();
+
+    if (!bResult)
+        return false;
+
+    g_pLogDlg->print_line(_T("  Hashed %u blocks in %u ms."),m_ImageHashes.size(),
+        ::GetTickCount() - ulStartTime);
+
+    ReadFiles(InStream,ulSessionStart);
+    return true;
+}
+
+/*
+    CCore2Verify::SetImageHashes
+    ----------------------------
+    Uses the block hashes calculated while the disc image was written instead
+    of reading the image again, only the file system of the image is read.
+    The hashes are taken from Hashes. Returns false if the hashes don't cover
+    the image.
+*/
+bool CCore2Verify::SetImageHashes(const TCHAR *szImagePath,std::vector<ckcore::tuint32> &Hashes,
+                                  unsigned long ulSessionStart)
+{
+    g_pLogDlg->print_line(_T("CCore2Verify::SetImageHashes"));
+
+    ckcore::FileInStream InStream(szImagePath);
+    if (!InStream.open())
+    {
+        g_pLogDlg->print_line(_T("  Error: Unable to open disc image \"%s\"."),szImagePath);
+        return false;
+    }
+
+    unsigned __int64 uiSize = (unsigned __int64)InStream.size();
+    if (Hashes.size() != (uiSize + CORE2_VERIFY_BLOCKSIZE - 1) / CORE2_VERIFY_BLOCKSIZE)
+    {
+        g_pLogDlg->print_line(_T("  Error: Got %u block hashes for an image of %I64u bytes."),
+            Hashes.size(),uiSize);
+        return false;
+    }
+
+    m_ulImageSectors = (unsigned long)(uiSize / 2048);
+    m_ImageHashes.swap(Hashes);
+    m_Files.clear();
+
+    ReadFiles(InStream,ulSessionStart);
+    return true;
+}
+
+/*
+    CCore2Verify::Report
+    --------------------
+    Reports the files covered by blocks that differ between the disc and the
+    image, and the sectors not belonging to any file.
+*/
+void CCore2Verify::Report(CAdvancedProgress *pProgress,unsigned long ulStartAddr,
+                          std::map<tstring,tstring> &FilePathMap)
+{
+    const unsigned long ulBlockSectors = CORE2_VERIFY_BLOCKSIZE / 2048;
+
+    // The project path of each file on the disc, as named by the file system
+    // writer.
+    std::map<tstring,tstring> ProjectPathMap;
+    std::map<tstring,tstring>::const_iterator itPath;
+    for (itPath = FilePathMap.begin(); itPath != FilePathMap.end(); itPath++)
+        ProjectPathMap[NormalizePath(itPath->second)] = itPath->first;
+
+    std::vector<bool> ReportedFiles(m_Files.size(),false);
+
+    for (unsigned long ulBlock = 0; ulBlock < m_ImageHashes.size(); ulBlock++)
+    {
+        if (!m_ReadErrors[ulBlock] && m_DiscHashes[ulBlock] == m_ImageHashes[ulBlock])
+            continue;
+
+        unsigned long ulFirstSector = ulStartAddr + ulBlock * ulBlockSectors;
+        unsigned long ulLastSector = min(ulFirstSector + ulBlockSectors,ulStartAddr + m_ulImageSectors) - 1;
+
+        g_pLogDlg->print_line(_T("  Block %u (sectors %u-%u) differs%s."),ulBlock,ulFirstSector,
+            ulLastSector,m_ReadErrors[ulBlock] ? _T(", read error") : _T(""));
+
+        bool bFileFound = false;
+        for (unsigned int i = 0; i < m_Files.size(); i++)
+        {
+            if (m_Files[i].m_ulFirstSector > ulLastSector || m_Files[i].m_ulLastSector < ulFirstSector)
+                continue;
+
+            bFileFound = true;
+            if (ReportedFiles[i])
+                continue;
+
+            ReportedFiles[i] = true;
+            m_ulFailCount++;
+
+            itPath = ProjectPathMap.find(NormalizePath(m_Files[i].m_FilePath));
+            pProgress->notify(ckcore::Progress::ckERROR,lngGetString(FAILURE_VERIFYFILE),
+                itPath != ProjectPathMap.end() ? itPath->second.c_str() : m_Files[i].m_FilePath.c_str());
+        }
+
+        // File system structures or padding.
+        if (!bFileFound)
+        {
+            m_ulFailCount++;
+            pProgress->notify(ckcore::Progress::ckERROR,lngGetString(FAILURE_VERIFYSECTORS),
+                ulFirstSector,ulLastSector);
+        }
+    }
+}
+
+/*
+    CCore2Verify::VerifyDisc
+    ------------------------
+    Reads the last session of the disc and compares it to the disc image
+    hashed by HashImage or SetImageHashes. Returns false if the disc could not be verified, if
+    none of its sectors could be read or if the operation was cancelled.
+*/
+bool CCore2Verify::VerifyDisc(ckmmc::Device &Device,CAdvancedProgress *pProgress,
+                              std::map<tstring,tstring> &FilePathMap)
+{
+    g_pLogDlg->print_line(_T("CCore2Verify::VerifyDisc"));
+
+    m_ulFailCount = 0;
+
+    // The image was recorded as the last session of the disc.
+    CCore2Info Info(g_pLogDlg);
+
+    unsigned char ucFirstSessNumber = 0,ucLastSessNumber = 0;
+    unsigned long ulStartAddr = 0;
+    if (!Info.ReadSI(Device,ucFirstSessNumber,ucLastSessNumber,ulStartAddr))
+    {
+        g_pLogDlg->print_line(_T("  Error: Unable to read session information."));
+        return false;
+    }
+
+    g_pLogDlg->print_line(_T("  Session %d starts at %u, %u sectors."),ucLastSessNumber,
+        ulStartAddr,m_ulImageSectors);
+
+    pProgress->notify(ckcore::Progress::ckINFORMATION,lngGetString(PROGRESS_BEGINVERIFY));
+    pProgress->set_status(lngGetString(STATUS_VERIFYDISC));
+
+    Core2ReadFunction::CReadUserData ReadFunc(Device,NULL);
+
+    m_DiscHashes.assign(m_ImageHashes.size(),0);
+    m_ReadErrors.assign(m_ImageHashes.size(),false);
+
+    unsigned long ulStartTime = ::GetTickCount();
+    StartThreads();
+
+    unsigned long ulSector = 0,ulFailedSectors = 0;
+    bool bResult = true;
+
+    while (ulSector < m_ulImageSectors)
+    {
+        if (pProgress->cancelled())
+        {
+            bResult = false;
+            break;
+        }
+
+        CChunk *pChunk = GetFreeChunk();
+        pChunk->m_ulFirstBlock = ulSector / (CORE2_VERIFY_BLOCKSIZE / 2048);
+        pChunk->m_ulSize = min(m_ulImageSectors - ulSector,CORE2_VERIFY_CHUNKSIZE / 2048) * 2048;
+        pChunk->m_pHashes = &m_DiscHashes;
+
+        for (unsigned long ulOffset = 0; ulOffset < pChunk->m_ulSize; ulOffset += CORE2_VERIFY_READBLOCKS * 2048)
+        {
+            unsigned long ulCount = min((pChunk->m_ulSize - ulOffset) / 2048,CORE2_VERIFY_READBLOCKS);
+            unsigned long ulAddr = ulStartAddr + ulSector + ulOffset / 2048;
+
+            if (!ReadFunc.Read(pChunk->m_pData + ulOffset,ulAddr,ulCount))
+            {
+                g_pLogDlg->print_line(_T("  Warning: Failed to read sector range %u-%u."),
+                    ulAddr,ulAddr + ulCount - 1);
+
+                // The block is reported as different regardless of its hash.
+                ulFailedSectors += ulCount;
+                memset(pChunk->m_pData + ulOffset,0,ulCount * 2048);
+                for (unsigned long i = 0; i < ulCount; i += CORE2_VERIFY_BLOCKSIZE / 2048)
+                    m_ReadErrors[(ulSector + ulOffset / 2048 + i) / (CORE2_VERIFY_BLOCKSIZE / 2048)] = true;
+            }
+        }
+
+        ulSector += pChunk->m_ulSize / 2048;
+        QueueChunk(pChunk);
+
+        pProgress->set_progress((unsigned char)(((unsigned __int64)ulSector * 100) / m_ulImageSectors));
+    }
+
+    StopThreads();
+
+    unsigned long ulElapsed = ::GetTickCount() - ulStartTime;
+    g_pLogDlg->print_line(_T("  Read and hashed %u sectors in %u ms."),ulSector,ulElapsed);
+
+    if (!bResult)
+        return false;
+
+    // The drive doesn't support the read command with the media, let the
+    // caller verify the files instead.
+    if (ulSector > 0 && ulFailedSectors == ulSector)
+    {
+        g_pLogDlg->print_line(_T("  Error: Unable to read any sectors from the disc."));
+        return false;
+    }
+
+    Report(pProgress,ulStartAddr,FilePathMap);
+
+    if (m_ulFailCount == 0)
+        pProgress->notify(ckcore::Progress::ckINFORMATION,lngGetString(SUCCESS_VERIFY));
+    else
+        pProgress->notify(ckcore::Progress::ckINFORMATION,lngGetString(FAILURE_VERIFY),m_ulFailCount);
+
+    return true;
+}
+
+unsigned long CCore2Verify::GetFailCount()
+{
+    return m_ulFailCount;
+}
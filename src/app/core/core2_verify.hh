@@ -0,0 +1,144 @@
+/*
+ * InfraRecorder - CD/DVD burning software
+ * Copyright (C) 2006-2012 Christian Kindahl
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#include <vector>
+#include <deque>
+#include <map>
+#include <ckcore/types.hh>
+#include <ckcore/stream.hh>
+#include <ckfilesystem/isoreader.hh>
+#include <ckmmc/device.hh>
+#include <base/string_util.hh>
+#include "advanced_progress.hh"
+#include "core2_checkpoint.hh"
+
+#define CORE2_VERIFY_THREADS				4
+#define CORE2_VERIFY_BLOCKSIZE				CORE2_CHECKPOINT_BLOCKSIZE	// Bytes in each hashed block.
+#define CORE2_VERIFY_READBLOCKS				32					// Sectors in each read command.
+#define CORE2_VERIFY_CHUNKSIZE				(2 * 1024 * 1024)	// Bytes passed to the hashing threads at a time.
+#define CORE2_VERIFY_CHUNKCOUNT				8					// Chunks being read or hashed at a time.
+
+// Verifies a recorded disc against the disc image it was recorded from. The
+// image is split into fixed size blocks which are hashed using CRC-32C ahead
+// of time, either by reading the image or while it's being written by
+// CCore2Checkpoint, which hashes the same blocks. The disc is then read sequentially in large chunks, and the blocks
+// of each chunk are hashed by a pool of threads while the next chunk is read.
+// Blocks that differ from the image, or that can't be read, are mapped back
+// to the files of the image for the report. The files are located using the
+// Joliet directory tree if there is one, otherwise the ISO9660 tree, which
+// is what the file system writer names the files by.
+class CCore2Verify
+{
+private:
+    // Presents an image of a session as if it was located at the start
+    // address of the session, where its file system expects to be.
+    class CSessionStream : public ckcore::InStream
+    {
+    private:
+        ckcore::InStream &m_InStream;
+        const unsigned __int64 m_uiOffset;
+        unsigned __int64 m_uiPos;
+
+    public:
+        CSessionStream(ckcore::InStream &InStream,unsigned long ulSessionStart);
+
+        // ckcore::InStream.
+        ckcore::tint64 read(void *pBuffer,ckcore::tuint32 uiCount);
+        ckcore::tint64 size();
+        bool end();
+        bool seek(ckcore::tuint32 uiDistance,ckcore::InStream::StreamWhence Whence);
+    };
+
+    class CChunk
+    {
+    public:
+        unsigned char *m_pData;
+        unsigned long m_ulFirstBlock;
+        unsigned long m_ulSize;
+        std::vector<ckcore::tuint32> *m_pHashes;
+
+        CChunk() : m_ulFirstBlock(0),m_ulSize(0),m_pHashes(NULL)
+        {
+            m_pData = new unsigned char[CORE2_VERIFY_CHUNKSIZE];
+        }
+
+        ~CChunk()
+        {
+            delete [] m_pData;
+        }
+    };
+
+    class CFileExtent
+    {
+    public:
+        ckcore::tstring m_FilePath;
+        unsigned long m_ulFirstSector;
+        unsigned long m_ulLastSector;
+
+        CFileExtent(const ckcore::tstring &FilePath,unsigned long ulFirstSector,
+            unsigned long ulLastSector) : m_FilePath(FilePath),
+            m_ulFirstSector(ulFirstSector),m_ulLastSector(ulLastSector)
+        {
+        }
+    };
+
+    CChunk m_Chunks[CORE2_VERIFY_CHUNKCOUNT];
+    std::deque<CChunk *> m_Queue;
+    std::deque<CChunk *> m_Free;
+
+    CRITICAL_SECTION m_csQueue;
+    HANDLE m_hQueueSemaphore;
+    HANDLE m_hFreeSemaphore;
+    HANDLE m_hThreads[CORE2_VERIFY_THREADS];
+    unsigned int m_uiThreadCount;
+
+    std::vector<ckcore::tuint32> m_ImageHashes;
+    std::vector<ckcore::tuint32> m_DiscHashes;
+    std::vector<bool> m_ReadErrors;
+    std::vector<CFileExtent> m_Files;
+    unsigned long m_ulImageSectors;
+    unsigned long m_ulFailCount;
+
+    void StartThreads();
+    void StopThreads();
+    CChunk *GetFreeChunk();
+    void QueueChunk(CChunk *pChunk);
+    void WaitForChunks();
+
+    void AddFiles(ckfilesystem::IsoTreeNode *pRootNode);
+    void ReadFiles(ckcore::InStream &InStream,unsigned long ulSessionStart);
+    bool AddJolietFiles(ckcore::InStream &InStream,unsigned long ulSessionStart);
+    void Report(CAdvancedProgress *pProgress,unsigned long ulStartAddr,
+        std::map<tstring,tstring> &FilePathMap);
+
+    static DWORD WINAPI HashThread(LPVOID lpThreadParameter);
+
+public:
+    CCore2Verify();
+    ~CCore2Verify();
+
+    bool HashImage(const TCHAR *szImagePath,CAdvancedProgress *pProgress,
+        unsigned long ulSessionStart = 0);
+    bool SetImageHashes(const TCHAR *szImagePath,std::vector<ckcore::tuint32> &Hashes,
+        unsigned long ulSessionStart = 0);
+    bool VerifyDisc(ckmmc::Device &Device,CAdvancedProgress *pProgress,
+        std::map<tstring,tstring> &FilePathMap);
+
+    unsigned long GetFailCount();
+};
@@ -0,0 +1,233 @@
+/*
+ * InfraRecorder - CD/DVD burning software
+ * Copyright (C) 2006-2012 Christian Kindahl
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "stdafx.hh"
+#include "log_dlg.hh"
+#include "pipe_buffer.hh"
+
+CPipeBuffer::CPipeBuffer(ckcore::OutStream &OutStream,CAdvancedProgress *pProgress,
+                         unsigned long ulSize) :
+    m_OutStream(OutStream),m_pProgress(pProgress),m_pBuffer(NULL),m_ulSize(ulSize),
+    m_ulWritePos(0),m_ulReadPos(0),m_lFilled(0),m_lClosed(0),m_lFailed(0),
+    m_ulMinFilled(ulSize),m_ulStallCount(0),m_hDataEvent(NULL),m_hSpaceEvent(NULL),
+    m_hPumpThread(NULL)
+{
+}
+
+CPipeBuffer::~CPipeBuffer()
+{
+    if (m_hPumpThread != NULL)
+    {
+        ::InterlockedExchange(&m_lFailed,1);
+        ::SetEvent(m_hDataEvent);
+
+        ::WaitForSingleObject(m_hPumpThread,INFINITE);
+        ::CloseHandle(m_hPumpThread);
+    }
+
+    if (m_hDataEvent != NULL)
+        ::CloseHandle(m_hDataEvent);
+    if (m_hSpaceEvent != NULL)
+        ::CloseHandle(m_hSpaceEvent);
+
+    if (m_pBuffer != NULL)
+        ::VirtualFree(m_pBuffer,0,MEM_RELEASE);
+}
+
+int CPipeBuffer::GetFillLevel(unsigned long ulFilled) const
+{
+    return (int)(((unsigned __int64)ulFilled * 100) / m_ulSize);
+}
+
+/*
+    CPipeBuffer::PumpThread
+    -----------------------
+    Waits for the buffer to be filled and then passes the data on to the
+    output stream until the writer has closed the buffer and the buffer is
+    empty, or until the output stream fails.
+*/
+DWORD WINAPI CPipeBuffer::PumpThread(LPVOID lpThreadParameter)
+{
+    CPipeBuffer *pBuffer = (CPipeBuffer *)lpThreadParameter;
+
+    unsigned long ulStartTime = ::GetTickCount();
+
+    // Fill the buffer before passing anything on.
+    while (!pBuffer->m_lFailed && !pBuffer->m_lClosed &&
+        (unsigned long)pBuffer->m_lFilled < pBuffer->m_ulSize)
+    {
+        ::WaitForSingleObject(pBuffer->m_hDataEvent,PIPEBUFFER_WAITTIME);
+    }
+
+    g_pLogDlg->print_line(_T("  Recording buffer filled with %u bytes in %u ms."),
+                          (unsigned long)pBuffer->m_lFilled,::GetTickCount() - ulStartTime);
+
+    unsigned long ulLastUpdate = 0;
+    bool bStalled = false;
+
+    while (!pBuffer->m_lFailed)
+    {
+        bool bClosed = pBuffer->m_lClosed != 0;
+        unsigned long ulFilled = (unsigned long)pBuffer->m_lFilled;
+
+        if (pBuffer->m_pProgress != NULL &&
+            ::GetTickCount() - ulLastUpdate >= PIPEBUFFER_UPDATEINTERVAL)
+        {
+            pBuffer->m_pProgress->SetSourceBuffer(pBuffer->GetFillLevel(ulFilled));
+            ulLastUpdate = ::GetTickCount();
+        }
+
+        if (ulFilled == 0)
+        {
+            if (bClosed)
+                break;
+
+            // The writer can't keep up.
+            if (!bStalled)
+            {
+                pBuffer->m_ulStallCount++;
+                bStalled = true;
+            }
+
+            ::WaitForSingleObject(pBuffer->m_hDataEvent,PIPEBUFFER_WAITTIME);
+            continue;
+        }
+
+        bStalled = false;
+
+        if (!bClosed && ulFilled < pBuffer->m_ulMinFilled)
+            pBuffer->m_ulMinFilled = ulFilled;
+
+        unsigned long ulChunk = ulFilled;
+        if (ulChunk > pBuffer->m_ulSize - pBuffer->m_ulReadPos)
+            ulChunk = pBuffer->m_ulSize - pBuffer->m_ulReadPos;
+        if (ulChunk > PIPEBUFFER_BLOCKSIZE)
+            ulChunk = PIPEBUFFER_BLOCKSIZE;
+
+        if (pBuffer->m_OutStream.write(pBuffer->m_pBuffer + pBuffer->m_ulReadPos,ulChunk) != ulChunk)
+        {
+            ::InterlockedExchange(&pBuffer->m_lFailed,1);
+            ::SetEvent(pBuffer->m_hSpaceEvent);
+            break;
+        }
+
+        pBuffer->m_ulReadPos = (pBuffer->m_ulReadPos + ulChunk) % pBuffer->m_ulSize;
+
+        ::InterlockedExchangeAdd(&pBuffer->m_lFilled,-(LONG)ulChunk);
+        ::SetEvent(pBuffer->m_hSpaceEvent);
+    }
+
+    if (pBuffer->m_pProgress != NULL)
+        pBuffer->m_pProgress->SetSourceBuffer(0);
+
+    return 0;
+}
+
+/**
+    Allocates the buffer and starts the thread passing the data on to the
+    output stream.
+    @return true if the buffer is ready to be written to, false otherwise.
+*/
+bool CPipeBuffer::Start()
+{
+    if (m_ulSize == 0)
+        return false;
+
+    m_pBuffer = (unsigned char *)::VirtualAlloc(NULL,m_ulSize,MEM_COMMIT,PAGE_READWRITE);
+    if (m_pBuffer == NULL)
+    {
+        g_pLogDlg->print_line(_T("  Warning: Unable to allocate a recording buffer of %u bytes."),
+                              m_ulSize);
+        return false;
+    }
+
+    m_hDataEvent = ::CreateEvent(NULL,FALSE,FALSE,NULL);
+    m_hSpaceEvent = ::CreateEvent(NULL,FALSE,FALSE,NULL);
+    if (m_hDataEvent == NULL || m_hSpaceEvent == NULL)
+        return false;
+
+    unsigned long ulThreadID = 0;
+    m_hPumpThread = ::CreateThread(NULL,0,PumpThread,this,0,&ulThreadID);
+
+    return m_hPumpThread != NULL;
+}
+
+/**
+    Tells the buffer that no more data will be written and waits until all
+    data has been passed on to the output stream.
+    @return true if all data was passed on, false otherwise.
+*/
+bool CPipeBuffer::Close()
+{
+    if (m_hPumpThread == NULL)
+        return false;
+
+    ::InterlockedExchange(&m_lClosed,1);
+    ::SetEvent(m_hDataEvent);
+
+    ::WaitForSingleObject(m_hPumpThread,INFINITE);
+    ::CloseHandle(m_hPumpThread);
+    m_hPumpThread = NULL;
+
+    g_pLogDlg->print_line(_T("  Recording buffer: minimum fill level %d%%, ran empty %u times."),
+                          GetFillLevel(m_ulMinFilled),m_ulStallCount);
+
+    return m_lFailed == 0;
+}
+
+int CPipeBuffer::GetFillLevel() const
+{
+    return GetFillLevel((unsigned long)m_lFilled);
+}
+
+ckcore::tint64 CPipeBuffer::write(const void *pBuffer,ckcore::tuint32 uiCount)
+{
+    const unsigned char *pData = (const unsigned char *)pBuffer;
+    ckcore::tuint32 uiRemaining = uiCount;
+
+    while (uiRemaining > 0)
+    {
+        if (m_lFailed)
+            return -1;
+
+        // Wait for the pump thread to make room.
+        unsigned long ulFree = m_ulSize - (unsigned long)m_lFilled;
+        if (ulFree == 0)
+        {
+            ::WaitForSingleObject(m_hSpaceEvent,PIPEBUFFER_WAITTIME);
+            continue;
+        }
+
+        unsigned long ulChunk = uiRemaining;
+        if (ulChunk > ulFree)
+            ulChunk = ulFree;
+        if (ulChunk > m_ulSize - m_ulWritePos)
+            ulChunk = m_ulSize - m_ulWritePos;
+
+        memcpy(m_pBuffer + m_ulWritePos,pData,ulChunk);
+        m_ulWritePos = (m_ulWritePos + ulChunk) % m_ulSize;
+
+        pData += ulChunk;
+        uiRemaining -= ulChunk;
+
+        ::InterlockedExchangeAdd(&m_lFilled,(LONG)ulChunk);
+        ::SetEvent(m_hDataEvent);
+    }
+
+    return uiCount;
+}
@@ -0,0 +1,72 @@
+/*
+ * InfraRecorder - CD/DVD burning software
+ * Copyright (C) 2006-2012 Christian Kindahl
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#include <ckcore/stream.hh>
+#include "advanced_progress.hh"
+
+#define PIPEBUFFER_BLOCKSIZE				(64 * 1024)
+#define PIPEBUFFER_WAITTIME					100		// Milliseconds.
+#define PIPEBUFFER_UPDATEINTERVAL			250		// Milliseconds.
+
+// A ring buffer between the file system writer and the process recording the
+// data. The writer fills the buffer and a separate thread empties it into the
+// process, so that stalls when reading the source files are absorbed by the
+// buffer. Nothing is passed on to the process until the buffer has been
+// filled. There is exactly one writer and one reader, the fill level is the
+// only shared state and is updated using interlocked operations.
+class CPipeBuffer : public ckcore::OutStream
+{
+private:
+    ckcore::OutStream &m_OutStream;
+    CAdvancedProgress *m_pProgress;
+
+    unsigned char *m_pBuffer;
+    unsigned long m_ulSize;
+    unsigned long m_ulWritePos;		// Only accessed by the writer.
+    unsigned long m_ulReadPos;		// Only accessed by the pump thread.
+
+    volatile LONG m_lFilled;
+    volatile LONG m_lClosed;
+    volatile LONG m_lFailed;
+
+    // Statistics, only accessed by the pump thread until it has exited.
+    unsigned long m_ulMinFilled;
+    unsigned long m_ulStallCount;
+
+    HANDLE m_hDataEvent;
+    HANDLE m_hSpaceEvent;
+    HANDLE m_hPumpThread;
+
+    int GetFillLevel(unsigned long ulFilled) const;
+
+    static DWORD WINAPI PumpThread(LPVOID lpThreadParameter);
+
+public:
+    CPipeBuffer(ckcore::OutStream &OutStream,CAdvancedProgress *pProgress,
+        unsigned long ulSize);
+    ~CPipeBuffer();
+
+    bool Start();
+    bool Close();
+
+    int GetFillLevel() const;
+
+    // ckcore::OutStream.
+    ckcore::tint64 write(const void *pBuffer,ckcore::tuint32 uiCount);
+};
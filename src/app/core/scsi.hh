@@ -51,6 +51,9 @@
 #define SCSI_REQUEST_SENSE						0x03
 #define SCSI_READ_CD							0xBE
 #define SCSI_READ_TRACK_INFORMATION				0x52
+#define SCSI_READ10								0x28
+#define SCSI_WRITE10							0x2A
+#define SCSI_SYNCHRONIZE_CACHE					0x35
 
 // Profiles.
 #define PROFILE_NONE							0x0000
@@ -113,4 +113,37 @@
 #define WM_SETFILESYSTEM				WM_APP + 20
 
 // Used by class CSpaceMeter.
-#define WMU_SPACE_METER_DELAYED_UPDATE	WM_APP + 21
\ No newline at end of file
+#define WMU_SPACE_METER_DELAYED_UPDATE	WM_APP + 21
+
+/*
+    WM_DEVICESCAN_DONE
+    ------------------
+    Posted to the main window when a background device scan has completed.
+*/
+#define WM_DEVICESCAN_DONE				WM_APP + 22
+
+/*
+    WM_IMPORTSESSION_DONE
+    ---------------------
+    Posted to the main window when a session has been read in the background.
+    wParam is true if the file system was read successfully and lParam is a
+    pointer to the CImportSessionParam object which is owned by the receiver.
+*/
+#define WM_IMPORTSESSION_DONE			WM_APP + 23
+
+/*
+    WM_LOG_APPEND
+    -------------
+    Posted to the log dialog by its writer thread when there is new text to
+    display in the log window.
+*/
+#define WM_LOG_APPEND					WM_APP + 24
+
+/*
+    WM_DUPLICATESCAN_DONE
+    ---------------------
+    Posted to the general project properties page when the project files have
+    been compared in the background. lParam is a pointer to the
+    CDuplicateScanParam object which is owned by the receiver.
+*/
+#define WM_DUPLICATESCAN_DONE			WM_APP + 25
\ No newline at end of file
@@ -0,0 +1,339 @@
+/*
+ * InfraRecorder - CD/DVD burning software
+ * Copyright (C) 2006-2012 Christian Kindahl
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "stdafx.hh"
+#include <base/xml_processor.hh>
+#include "infrarecorder.hh"
+#include "settings.hh"
+#include "settings_manager.hh"
+#include "log_dlg.hh"
+#include "ctrl_messages.hh"
+#include "device_util.hh"
+#include "device_inventory.hh"
+
+CDeviceInventory g_DeviceInventory;
+
+CDeviceInventory::CDeviceInventory() :
+    m_hScanThread(NULL),m_hWndNotify(NULL),m_bScanning(false),m_ulScanTime(0)
+{
+    ::InitializeCriticalSection(&m_csScan);
+}
+
+CDeviceInventory::~CDeviceInventory()
+{
+    WaitForScan();
+
+    ::DeleteCriticalSection(&m_csScan);
+}
+
+bool CDeviceInventory::GetFilePath(TCHAR *szFilePath)
+{
+    if (!g_SettingsManager.GetConfigDir(szFilePath))
+        return false;
+
+    lstrcat(szFilePath,_T("devices.xml"));
+    return true;
+}
+
+/*
+    CDeviceInventory::Update
+    ------------------------
+    Replaces the inventory with the devices of the device manager. Devices that
+    have been added or removed since the previous scan are written to the log.
+*/
+void CDeviceInventory::Update()
+{
+    std::vector<CEntry> Entries;
+
+    std::vector<ckmmc::Device *>::const_iterator itDevice;
+    for (itDevice = g_DeviceManager.devices().begin(); itDevice !=
+        g_DeviceManager.devices().end(); itDevice++)
+    {
+        ckmmc::Device *pDevice = *itDevice;
+
+        CEntry Entry;
+        Entry.m_Address = NDeviceUtil::GetDeviceAddr(*pDevice);
+        Entry.m_Name = NDeviceUtil::GetDeviceName(*pDevice);
+        Entry.m_Vendor = pDevice->vendor();
+        Entry.m_Identifier = pDevice->identifier();
+        Entry.m_Revision = pDevice->revision();
+        Entry.m_bRecorder = pDevice->recorder();
+        Entry.m_iProfile = (int)pDevice->profile();
+        Entry.m_bEject = pDevice->support(ckmmc::Device::ckDEVICE_EJECT);
+        Entry.m_bTestWrite = pDevice->support(ckmmc::Device::ckDEVICE_TEST_WRITE);
+        Entry.m_bBUP = pDevice->support(ckmmc::Device::ckDEVICE_BUP);
+
+        Entries.push_back(Entry);
+    }
+
+    if (g_GlobalSettings.m_bLog)
+    {
+        std::vector<CEntry>::const_iterator itOld,itNew;
+        for (itNew = Entries.begin(); itNew != Entries.end(); itNew++)
+        {
+            for (itOld = m_Entries.begin(); itOld != m_Entries.end(); itOld++)
+            {
+                if (itOld->m_Name == itNew->m_Name)
+                    break;
+            }
+
+            if (itOld == m_Entries.end())
+                g_pLogDlg->print_line(_T("  Device added: %s."),itNew->m_Name.c_str());
+        }
+
+        for (itOld = m_Entries.begin(); itOld != m_Entries.end(); itOld++)
+        {
+            for (itNew = Entries.begin(); itNew != Entries.end(); itNew++)
+            {
+                if (itOld->m_Name == itNew->m_Name)
+                    break;
+            }
+
+            if (itNew == Entries.end())
+                g_pLogDlg->print_line(_T("  Device removed: %s."),itOld->m_Name.c_str());
+        }
+    }
+
+    ::EnterCriticalSection(&m_csScan);
+    m_Entries = Entries;
+    ::LeaveCriticalSection(&m_csScan);
+}
+
+/*
+    CDeviceInventory::ScanThread
+    ----------------------------
+    Scans the devices and notifies the main window when done. The notification
+    window is read under the lock so that a window registered before the scan
+    completes is always notified.
+*/
+DWORD WINAPI CDeviceInventory::ScanThread(LPVOID lpThreadParameter)
+{
+    CDeviceInventory *pInventory = (CDeviceInventory *)lpThreadParameter;
+
+    unsigned long ulStartTime = ::GetTickCount();
+
+    g_DeviceManager.scan(NULL);
+    pInventory->Update();
+    pInventory->Save();
+
+    ::EnterCriticalSection(&pInventory->m_csScan);
+    pInventory->m_ulScanTime = ::GetTickCount() - ulStartTime;
+    pInventory->m_bScanning = false;
+    HWND hWndNotify = pInventory->m_hWndNotify;
+    ::LeaveCriticalSection(&pInventory->m_csScan);
+
+    if (hWndNotify != NULL)
+        ::PostMessage(hWndNotify,WM_DEVICESCAN_DONE,0,0);
+
+    return 0;
+}
+
+bool CDeviceInventory::Load()
+{
+    CXmlProcessor Xml;
+
+    TCHAR szFilePath[MAX_PATH];
+    if (!GetFilePath(szFilePath))
+        return false;
+
+    if (Xml.Load(szFilePath) != XMLRES_OK)
+        return false;
+
+    if (!Xml.EnterElement(_T("InfraRecorder")))
+        return false;
+
+    if (!Xml.EnterElement(_T("Devices")))
+        return false;
+
+    m_Entries.clear();
+
+    TCHAR szBuffer[MAX_PATH];
+    for (unsigned int i = 0; i < Xml.GetElementChildCount(); i++)
+    {
+        if (!Xml.EnterElement(i))
+            continue;
+
+        CEntry Entry;
+
+        Xml.GetSafeElementData(_T("Address"),szBuffer,MAX_PATH - 1);
+        Entry.m_Address = szBuffer;
+        Xml.GetSafeElementData(_T("Name"),szBuffer,MAX_PATH - 1);
+        Entry.m_Name = szBuffer;
+        Xml.GetSafeElementData(_T("Vendor"),szBuffer,MAX_PATH - 1);
+        Entry.m_Vendor = szBuffer;
+        Xml.GetSafeElementData(_T("Identifier"),szBuffer,MAX_PATH - 1);
+        Entry.m_Identifier = szBuffer;
+        Xml.GetSafeElementData(_T("Revision"),szBuffer,MAX_PATH - 1);
+        Entry.m_Revision = szBuffer;
+        Xml.GetSafeElementData(_T("Recorder"),&Entry.m_bRecorder);
+        Xml.GetSafeElementData(_T("Profile"),&Entry.m_iProfile);
+        Xml.GetSafeElementData(_T("Eject"),&Entry.m_bEject);
+        Xml.GetSafeElementData(_T("TestWrite"),&Entry.m_bTestWrite);
+        Xml.GetSafeElementData(_T("BUP"),&Entry.m_bBUP);
+
+        m_Entries.push_back(Entry);
+
+        Xml.LeaveElement();
+    }
+
+    Xml.LeaveElement();
+    Xml.LeaveElement();
+
+    return true;
+}
+
+bool CDeviceInventory::Save()
+{
+    CXmlProcessor Xml;
+
+    Xml.AddElement(_T("InfraRecorder"),_T(""),true);
+        Xml.AddElement(_T("Devices"),_T(""),true);
+            TCHAR szName[32];
+
+            for (unsigned int i = 0; i < m_Entries.size(); i++)
+            {
+                const CEntry &Entry = m_Entries[i];
+
+                lsprintf(szName,_T("Device%d"),i);
+                Xml.AddElement(szName,_T(""),true);
+                    Xml.AddElement(_T("Address"),Entry.m_Address.c_str());
+                    Xml.AddElement(_T("Name"),Entry.m_Name.c_str());
+                    Xml.AddElement(_T("Vendor"),Entry.m_Vendor.c_str());
+                    Xml.AddElement(_T("Identifier"),Entry.m_Identifier.c_str());
+                    Xml.AddElement(_T("Revision"),Entry.m_Revision.c_str());
+                    Xml.AddElement(_T("Recorder"),Entry.m_bRecorder);
+                    Xml.AddElement(_T("Profile"),Entry.m_iProfile);
+                    Xml.AddElement(_T("Eject"),Entry.m_bEject);
+                    Xml.AddElement(_T("TestWrite"),Entry.m_bTestWrite);
+                    Xml.AddElement(_T("BUP"),Entry.m_bBUP);
+                Xml.LeaveElement();
+            }
+        Xml.LeaveElement();
+    Xml.LeaveElement();
+
+    TCHAR szFilePath[MAX_PATH];
+    if (!GetFilePath(szFilePath))
+        return false;
+
+    return Xml.Save(szFilePath) == XMLRES_OK;
+}
+
+/**
+    Scans the devices in the calling thread and updates the inventory.
+    @param pCallback callback object receiving the scan status, may be NULL.
+*/
+void CDeviceInventory::Scan(ckmmc::DeviceManager::ScanCallback *pCallback)
+{
+    WaitForScan();
+
+    unsigned long ulStartTime = ::GetTickCount();
+
+    g_DeviceManager.scan(pCallback);
+    Update();
+    Save();
+
+    m_ulScanTime = ::GetTickCount() - ulStartTime;
+}
+
+/**
+    Starts scanning the devices in a separate thread. The device manager must
+    not be accessed until IsScanning returns false or WaitForScan returns. The
+    notification window receives a WM_DEVICESCAN_DONE message when the scan
+    has completed.
+    @return true if the scan was started, false otherwise.
+*/
+bool CDeviceInventory::StartScan()
+{
+    WaitForScan();
+
+    ::EnterCriticalSection(&m_csScan);
+    m_bScanning = true;
+    ::LeaveCriticalSection(&m_csScan);
+
+    unsigned long ulThreadID = 0;
+    m_hScanThread = ::CreateThread(NULL,0,ScanThread,this,0,&ulThreadID);
+    if (m_hScanThread == NULL)
+    {
+        ::EnterCriticalSection(&m_csScan);
+        m_bScanning = false;
+        ::LeaveCriticalSection(&m_csScan);
+        return false;
+    }
+
+    return true;
+}
+
+/**
+    Waits for a background scan to complete. Returns immediately if no scan is
+    in progress.
+*/
+void CDeviceInventory::WaitForScan()
+{
+    if (m_hScanThread == NULL)
+        return;
+
+    ::WaitForSingleObject(m_hScanThread,INFINITE);
+    ::CloseHandle(m_hScanThread);
+    m_hScanThread = NULL;
+}
+
+bool CDeviceInventory::IsScanning()
+{
+    ::EnterCriticalSection(&m_csScan);
+    bool bScanning = m_bScanning;
+    ::LeaveCriticalSection(&m_csScan);
+
+    return bScanning;
+}
+
+/**
+    Sets the window that should be notified when a background scan completes.
+    If a background scan completed before the window was set, the window is
+    notified immediately.
+    @param hWndNotify the window to notify, may be NULL.
+*/
+void CDeviceInventory::SetNotifyWindow(HWND hWndNotify)
+{
+    ::EnterCriticalSection(&m_csScan);
+    m_hWndNotify = hWndNotify;
+    bool bCompleted = m_hScanThread != NULL && !m_bScanning;
+    ::LeaveCriticalSection(&m_csScan);
+
+    if (hWndNotify != NULL && bCompleted)
+        ::PostMessage(hWndNotify,WM_DEVICESCAN_DONE,0,0);
+}
+
+/**
+    Returns the devices found by the last scan. While a background scan is in
+    progress these are the devices found when the application was last run.
+    @param Entries receives a copy of the inventory.
+*/
+void CDeviceInventory::GetEntries(std::vector<CEntry> &Entries)
+{
+    ::EnterCriticalSection(&m_csScan);
+    Entries = m_Entries;
+    ::LeaveCriticalSection(&m_csScan);
+}
+
+/**
+    Returns the time in milliseconds spent on the last device scan.
+*/
+unsigned long CDeviceInventory::GetScanTime() const
+{
+    return m_ulScanTime;
+}
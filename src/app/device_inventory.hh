@@ -0,0 +1,85 @@
+/*
+ * InfraRecorder - CD/DVD burning software
+ * Copyright (C) 2006-2012 Christian Kindahl
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#include <vector>
+#include <ckcore/types.hh>
+#include <ckmmc/devicemanager.hh>
+
+// Remembers the devices found by the last device scan so that they can be
+// presented at startup while the devices are being scanned in the
+// background. The inventory is stored next to the configuration file.
+class CDeviceInventory
+{
+public:
+    class CEntry
+    {
+    public:
+        ckcore::tstring m_Address;
+        ckcore::tstring m_Name;
+        ckcore::tstring m_Vendor;
+        ckcore::tstring m_Identifier;
+        ckcore::tstring m_Revision;
+        bool m_bRecorder;
+        int m_iProfile;
+
+        // Capabilities.
+        bool m_bEject;
+        bool m_bTestWrite;
+        bool m_bBUP;
+
+        CEntry() : m_bRecorder(false),m_iProfile(0),m_bEject(false),
+            m_bTestWrite(false),m_bBUP(false)
+        {
+        }
+    };
+
+private:
+    std::vector<CEntry> m_Entries;
+
+    // Background scan state and the entries, protected by the critical
+    // section since the entries are replaced by the scanning thread.
+    CRITICAL_SECTION m_csScan;
+    HANDLE m_hScanThread;
+    HWND m_hWndNotify;
+    bool m_bScanning;
+    unsigned long m_ulScanTime;
+
+    bool GetFilePath(TCHAR *szFilePath);
+    void Update();
+
+    static DWORD WINAPI ScanThread(LPVOID lpThreadParameter);
+
+public:
+    CDeviceInventory();
+    ~CDeviceInventory();
+
+    bool Load();
+    bool Save();
+
+    void Scan(ckmmc::DeviceManager::ScanCallback *pCallback);
+    bool StartScan();
+    void WaitForScan();
+    bool IsScanning();
+    void SetNotifyWindow(HWND hWndNotify);
+
+    void GetEntries(std::vector<CEntry> &Entries);
+    unsigned long GetScanTime() const;
+};
+
+extern CDeviceInventory g_DeviceInventory;
@@ -65,6 +65,10 @@ bool CConfigAdvancedPage::Translate()
         SetDlgItemText(IDC_FIFOGROUPSTATIC,szStrValue);
     if (pLng->GetValuePtr(IDC_FIFOINFOSTATIC,szStrValue))
         SetDlgItemText(IDC_FIFOINFOSTATIC,szStrValue);
+    if (pLng->GetValuePtr(IDC_PIPEBUFFERGROUPSTATIC,szStrValue))
+        SetDlgItemText(IDC_PIPEBUFFERGROUPSTATIC,szStrValue);
+    if (pLng->GetValuePtr(IDC_PIPEBUFFERINFOSTATIC,szStrValue))
+        SetDlgItemText(IDC_PIPEBUFFERINFOSTATIC,szStrValue);
 
     return true;
 }
@@ -83,10 +87,23 @@ bool CConfigAdvancedPage::OnApply()
         return false;
     }
 
+    TCHAR szPipeBuffer[4];
+    GetDlgItemText(IDC_PIPEBUFFEREDIT,szPipeBuffer,4);
+    int iPipeBufferSize = _wtoi(szPipeBuffer);
+
+    if (iPipeBufferSize < PIPEBUFFER_MIN || iPipeBufferSize > PIPEBUFFER_MAX)
+    {
+        TCHAR szMessage[128];
+        lsnprintf_s(szMessage,128,lngGetString(ERROR_PIPEBUFFERSIZE),PIPEBUFFER_MIN,PIPEBUFFER_MAX);
+        MessageBox(szMessage,lngGetString(GENERAL_ERROR),MB_OK | MB_ICONERROR);
+        return false;
+    }
+
     // Remember the configuration.
     g_GlobalSettings.m_bLog = IsDlgButtonChecked(IDC_LOGCHECK) == TRUE;
     g_GlobalSettings.m_bSmoke = IsDlgButtonChecked(IDC_SMOKECHECK) == TRUE;
     g_GlobalSettings.m_iFIFOSize = iFIFOSize;
+    g_GlobalSettings.m_iPipeBufferSize = iPipeBufferSize;
 
     return true;
 }
@@ -114,6 +131,11 @@ LRESULT CConfigAdvancedPage::OnInitDialog(UINT uMsg,WPARAM wParam,LPARAM lParam,
     _itow(g_GlobalSettings.m_iFIFOSize,szFIFO,10);
     SetDlgItemText(IDC_FIFOEDIT,szFIFO);
 
+    ::SendMessage(GetDlgItem(IDC_PIPEBUFFEREDIT),EM_SETLIMITTEXT,3,0);
+    TCHAR szPipeBuffer[4];
+    _itow(g_GlobalSettings.m_iPipeBufferSize,szPipeBuffer,10);
+    SetDlgItemText(IDC_PIPEBUFFEREDIT,szPipeBuffer);
+
     // Translate the window.
     Translate();
 
@@ -24,6 +24,7 @@
 #include "settings.hh"
 #include "lang_util.hh"
 #include "device_util.hh"
+#include "device_inventory.hh"
 #include "devices_dlg.hh"
 
 void CDevicesDlg::ScanCallback::event_status(ckmmc::DeviceManager::ScanCallback::Status Status)
@@ -209,7 +210,7 @@ LRESULT CDevicesDlg::OnRescan(WORD wNotifyCode,WORD wID,HWND hWndCtl,BOOL &bHand
     WaitDlg.Create(m_hWnd);
     WaitDlg.ShowWindow(SW_SHOW);
         ScanCallback Callback(WaitDlg);
-        g_DeviceManager.scan(&Callback);
+        g_DeviceInventory.Scan(&Callback);
     WaitDlg.DestroyWindow();
 
     // Fill the list view.
@@ -23,6 +23,7 @@
 #include "settings.hh"
 #include "trans_util.hh"
 #include "core2.hh"
+#include "log_dlg.hh"
 
 CDiscGeneralPage::CDiscGeneralPage(const TCHAR *szDiscLabel,ckmmc::Device &Device) :
     m_Device(Device)
@@ -303,7 +304,7 @@ LRESULT CDiscGeneralPage::OnInitDialog(UINT uMsg,WPARAM wParam,LPARAM lParam,BOO
     // Display the information.
     SetDlgItemText(IDC_NAMESTATIC,m_szDiscLabel);
 
-    CCore2Info Info;
+    CCore2Info Info(g_pLogDlg);
 
     ckmmc::Device::Profile Profile = m_Device.profile();
     DisplayDiscType(Profile);
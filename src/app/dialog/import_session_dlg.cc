@@ -75,7 +75,7 @@ bool CImportSessionDlg::UpdateDiscInfo(ckmmc::Device &Device)
     unsigned char ucFirstTrackNumber = 0,ucLastTrackNumber = 0;
     std::vector<CCore2TOCTrackDesc> Tracks;
 
-    CCore2Info Info;
+    CCore2Info Info(g_pLogDlg);
     if (Info.ReadTOC(Device,ucFirstTrackNumber,ucLastTrackNumber,Tracks))
     {
         g_pLogDlg->print_line(_T("  First and last disc track number: %d, %d."),
@@ -176,7 +176,7 @@ LRESULT CImportSessionDlg::OnDeviceChange(WORD wNotifyCode,WORD wID,HWND hWndCtl
         // Initialize device.
         WaitDlg.SetMessage(lngGetString(INIT_DEVICECD));
 
-        CCore2Info Info;
+        CCore2Info Info(g_pLogDlg);
         CCore2DiscInfo DiscInfo;
 
         if (Info.ReadDiscInformation(*pDevice,&DiscInfo))
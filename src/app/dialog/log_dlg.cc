@@ -27,12 +27,29 @@
 
 // FIXME: No arrow is used, not enough space.
 CLogDlg::CLogDlg() : m_DiagButton(IDR_DIAGNOSTICSMENU,false),
-    m_LogFile(GetLogFullPath())
+    m_LogFile(GetLogFullPath()),m_lEnqueuePos(0),m_lDequeuePos(0),m_lDropped(0),
+    m_hWriterThread(NULL)
 {
+    m_pQueue = new CQueueEntry[LOG_QUEUE_SIZE];
+    for (LONG i = 0; i < LOG_QUEUE_SIZE; i++)
+        m_pQueue[i].m_lSequence = i;
+
+    m_hWakeEvent = ::CreateEvent(NULL,FALSE,FALSE,NULL);
+    m_hStopEvent = ::CreateEvent(NULL,TRUE,FALSE,NULL);
+
+    InitializeCriticalSection(&m_csFlush);
+    InitializeCriticalSection(&m_csPending);
 }
 
 CLogDlg::~CLogDlg()
 {
+    DeleteCriticalSection(&m_csPending);
+    DeleteCriticalSection(&m_csFlush);
+
+    ::CloseHandle(m_hStopEvent);
+    ::CloseHandle(m_hWakeEvent);
+
+    delete [] m_pQueue;
 }
 
 ckcore::Path CLogDlg::GetLogFullPath()
@@ -145,10 +162,164 @@ bool CLogDlg::Translate()
 */
 void CLogDlg::Show()
 {
+    Flush();
+    AppendPendingText();
+
     g_pLogDlg->ShowWindow(SW_SHOW);
     m_LogEdit.LineScroll(m_LogEdit.GetLineCount());
 }
 
+/*
+    CLogDlg::Enqueue
+    ----------------
+    Formats a message into the next free entry of the ring buffer. This
+    function may be called by any number of threads at the same time, it does
+    not block. If the buffer is full the message is dropped and counted.
+*/
+void CLogDlg::Enqueue(bool bNewLine,const TCHAR *szFormat,va_list Args)
+{
+    LONG lPos = m_lEnqueuePos;
+
+    for (;;)
+    {
+        CQueueEntry *pEntry = &m_pQueue[lPos & (LOG_QUEUE_SIZE - 1)];
+        LONG lDiff = pEntry->m_lSequence - lPos;
+
+        if (lDiff == 0)
+        {
+            // Try to claim the entry.
+            LONG lPrevPos = InterlockedCompareExchange(&m_lEnqueuePos,lPos + 1,lPos);
+            if (lPrevPos == lPos)
+            {
+                _vsnwprintf(pEntry->m_szText,LOG_LINEBUFFER_SIZE - 1,szFormat,Args);
+                pEntry->m_szText[LOG_LINEBUFFER_SIZE - 1] = '\0';
+                pEntry->m_bNewLine = bNewLine;
+
+                // Publish the entry to the consumer.
+                InterlockedExchange(&pEntry->m_lSequence,lPos + 1);
+
+                // Wake the writer early when the buffer is filling up.
+                if ((lPos & (LOG_QUEUE_SIZE / 2 - 1)) == 0)
+                    ::SetEvent(m_hWakeEvent);
+                return;
+            }
+
+            lPos = lPrevPos;
+        }
+        else if (lDiff < 0)
+        {
+            // The consumer has not caught up, the buffer is full.
+            InterlockedIncrement(&m_lDropped);
+            return;
+        }
+        else
+        {
+            lPos = m_lEnqueuePos;
+        }
+    }
+}
+
+/*
+    CLogDlg::Flush
+    --------------
+    Moves all queued messages to the log file and to the text waiting to be
+    displayed in the edit control. This is done by the writer thread, but may
+    be called by any thread that needs the log to be up to date.
+*/
+void CLogDlg::Flush()
+{
+    ckcore::tstring Batch;
+
+    EnterCriticalSection(&m_csFlush);
+
+    for (;;)
+    {
+        CQueueEntry *pEntry = &m_pQueue[m_lDequeuePos & (LOG_QUEUE_SIZE - 1)];
+        if (pEntry->m_lSequence - (m_lDequeuePos + 1) < 0)
+            break;
+
+        Batch.append(pEntry->m_szText);
+        if (pEntry->m_bNewLine)
+            Batch.append(_T("\r\n"));
+
+        // Hand the entry back to the producers.
+        InterlockedExchange(&pEntry->m_lSequence,m_lDequeuePos + LOG_QUEUE_SIZE);
+        m_lDequeuePos++;
+    }
+
+    // Report messages that did not fit in the buffer.
+    LONG lDropped = InterlockedExchange(&m_lDropped,0);
+    if (lDropped > 0)
+    {
+        TCHAR szMessage[64];
+        lsnprintf_s(szMessage,64,_T("   * %d log messages dropped.\r\n"),lDropped);
+        Batch.append(szMessage);
+    }
+
+    // Write to the log file.
+    if (!Batch.empty() && m_LogFile.test())
+        m_LogFile.write(Batch.c_str(),static_cast<ckcore::tuint32>(Batch.size() * sizeof(TCHAR)));
+
+    if (Batch.empty())
+    {
+        LeaveCriticalSection(&m_csFlush);
+        return;
+    }
+
+    // Hand the text to the dialog thread. Only the most recent text is kept
+    // if the dialog thread does not run a message loop. This is done before
+    // m_csFlush is released to keep the batches of different threads in
+    // order.
+    EnterCriticalSection(&m_csPending);
+
+    bool bNotify = m_PendingText.empty();
+    m_PendingText.append(Batch);
+
+    if (m_PendingText.size() > LOG_MAXPENDING_SIZE)
+        m_PendingText.erase(0,m_PendingText.size() - LOG_MAXPENDING_SIZE);
+
+    LeaveCriticalSection(&m_csPending);
+    LeaveCriticalSection(&m_csFlush);
+
+    if (bNotify && IsWindow())
+        PostMessage(WM_LOG_APPEND);
+}
+
+/*
+    CLogDlg::AppendPendingText
+    --------------------------
+    Appends the text written by the writer thread to the edit control. Must
+    only be called from the thread owning the dialog.
+*/
+void CLogDlg::AppendPendingText()
+{
+    ckcore::tstring Text;
+
+    EnterCriticalSection(&m_csPending);
+    Text.swap(m_PendingText);
+    LeaveCriticalSection(&m_csPending);
+
+    if (!Text.empty() && IsWindow())
+        m_LogEdit.AppendText(Text.c_str());
+}
+
+/*
+    CLogDlg::WriterThread
+    ---------------------
+    Empties the message queue at regular intervals, or earlier when the queue
+    is filling up, until the dialog is destroyed.
+*/
+DWORD WINAPI CLogDlg::WriterThread(LPVOID lpThreadParameter)
+{
+    CLogDlg *pLogDlg = (CLogDlg *)lpThreadParameter;
+
+    HANDLE hEvents[2] = { pLogDlg->m_hStopEvent,pLogDlg->m_hWakeEvent };
+    while (::WaitForMultipleObjects(2,hEvents,FALSE,LOG_WRITE_INTERVAL) != WAIT_OBJECT_0)
+        pLogDlg->Flush();
+
+    return 0;
+}
+
 void CLogDlg::print(const TCHAR *szString,...)
 {
     if (g_GlobalSettings.m_bLog && IsWindow())
@@ -156,13 +327,9 @@ void CLogDlg::print(const TCHAR *szString,...)
         va_list args;
         va_start(args,szString);
 
-        _vsnwprintf(m_szLineBuffer,LOG_LINEBUFFER_SIZE - 1,szString,args);
-
-        m_LogEdit.AppendText(m_szLineBuffer);
+        Enqueue(false,szString,args);
 
-        // Write to the log file.
-        if (m_LogFile.test())
-            m_LogFile.write(m_szLineBuffer,lstrlen(m_szLineBuffer) * sizeof(TCHAR));
+        va_end(args);
     }
 }
 
@@ -173,22 +340,17 @@ void CLogDlg::print_line(const TCHAR *szLine,...)
         va_list args;
         va_start(args,szLine);
 
-        _vsnwprintf(m_szLineBuffer,LOG_LINEBUFFER_SIZE - 1,szLine,args);
-
-        m_LogEdit.AppendText(m_szLineBuffer);
-        m_LogEdit.AppendText(_T("\r\n"));
+        Enqueue(true,szLine,args);
 
-        // Write to the log file.
-        if (m_LogFile.test())
-        {
-            m_LogFile.write(m_szLineBuffer,lstrlen(m_szLineBuffer) * sizeof(TCHAR));
-            m_LogFile.write(ckT("\r\n"),2 * sizeof(ckcore::tchar));
-        }
+        va_end(args);
     }
 }
 
 bool CLogDlg::SaveLog(const TCHAR *szFileName)
 {
+    Flush();
+    AppendPendingText();
+
     ckcore::File File(szFileName);
     if (!File.open(ckcore::File::ckOPEN_WRITE))
         return false;
@@ -331,9 +493,38 @@ LRESULT CLogDlg::OnInitDialog(UINT uMsg,WPARAM wParam,LPARAM lParam,BOOL &bHandl
     // Translate the window.
     Translate();
 
+    // Start writing queued messages.
+    ::ResetEvent(m_hStopEvent);
+
+    unsigned long ulThreadID = 0;
+    m_hWriterThread = ::CreateThread(NULL,0,WriterThread,this,0,&ulThreadID);
+
     return TRUE;
 }
 
+LRESULT CLogDlg::OnDestroy(UINT uMsg,WPARAM wParam,LPARAM lParam,BOOL &bHandled)
+{
+    if (m_hWriterThread != NULL)
+    {
+        ::SetEvent(m_hStopEvent);
+        ::WaitForSingleObject(m_hWriterThread,INFINITE);
+        ::CloseHandle(m_hWriterThread);
+        m_hWriterThread = NULL;
+    }
+
+    // Write any remaining messages.
+    Flush();
+
+    bHandled = false;
+    return 0;
+}
+
+LRESULT CLogDlg::OnLogAppend(UINT uMsg,WPARAM wParam,LPARAM lParam,BOOL &bHandled)
+{
+    AppendPendingText();
+    return 0;
+}
+
 LRESULT CLogDlg::OnOK(WORD wNotifyCode,WORD wID,HWND hWndCtl,BOOL &bHandled)
 {
     ShowWindow(SW_HIDE);
@@ -21,6 +21,7 @@
 #include <ckcore/file.hh>
 #include <ckcore/log.hh>
 #include "drop_down_button.hh"
+#include "ctrl_messages.hh"
 
 #define BOM_UTF8					0xEFBBBF
 #define BOM_UTF32BE					0x0000FEFF
@@ -30,6 +31,9 @@
 #define LOG_SAVE_BOM
 #define LOG_WRITEBUFFER_SIZE		1024
 #define LOG_LINEBUFFER_SIZE			512
+#define LOG_QUEUE_SIZE				1024		// Must be a power of two.
+#define LOG_WRITE_INTERVAL			100			// Milliseconds.
+#define LOG_MAXPENDING_SIZE			(1024 * 1024)	// Characters, the limit of the edit control.
 
 class CLogDlg : public CDialogImpl<CLogDlg>,public CDialogResize<CLogDlg>,
                 public ckcore::Log
@@ -38,9 +42,34 @@ private:
     CEdit m_LogEdit;
     CDropDownButton m_DiagButton;
 
-    // This buffer will be used when creating the log line by the variable
-    // argument list.
-    TCHAR m_szLineBuffer[LOG_LINEBUFFER_SIZE];
+    // Messages are formatted directly into a ring buffer by the calling
+    // thread. A dedicated writer thread empties the buffer and writes the
+    // messages to the log file in batches, so messages are written even when
+    // no thread runs a message loop. The text is handed to the dialog thread
+    // for display in the edit control.
+    class CQueueEntry
+    {
+    public:
+        volatile LONG m_lSequence;
+        bool m_bNewLine;
+        TCHAR m_szText[LOG_LINEBUFFER_SIZE];
+    };
+
+    CQueueEntry *m_pQueue;
+    volatile LONG m_lEnqueuePos;
+    LONG m_lDequeuePos;
+    volatile LONG m_lDropped;
+
+    HANDLE m_hWriterThread;
+    HANDLE m_hWakeEvent;
+    HANDLE m_hStopEvent;
+
+    // Protects the consumer side of the ring buffer and the log file.
+    CRITICAL_SECTION m_csFlush;
+
+    // Text waiting to be appended to the edit control.
+    ckcore::tstring m_PendingText;
+    CRITICAL_SECTION m_csPending;
 
     ckcore::File m_LogFile;
 
@@ -49,6 +78,12 @@ private:
 
     void InitializeLogFile();
 
+    void Enqueue(bool bNewLine,const TCHAR *szFormat,va_list Args);
+    void Flush();
+    void AppendPendingText();
+
+    static DWORD WINAPI WriterThread(LPVOID lpThreadParameter);
+
     bool Translate();
     bool SaveLog(const TCHAR *szFileName);
 
@@ -74,6 +109,8 @@ public:
     // Events.
     BEGIN_MSG_MAP(CLogDlg)
         MESSAGE_HANDLER(WM_INITDIALOG,OnInitDialog)
+        MESSAGE_HANDLER(WM_DESTROY,OnDestroy)
+        MESSAGE_HANDLER(WM_LOG_APPEND,OnLogAppend)
 
         COMMAND_ID_HANDLER(IDOK,OnOK)
         COMMAND_ID_HANDLER(IDCANCEL,OnOK)
@@ -86,6 +123,8 @@ public:
     END_MSG_MAP()
 
     LRESULT OnInitDialog(UINT uMsg,WPARAM wParam,LPARAM lParam,BOOL &bHandled);
+    LRESULT OnDestroy(UINT uMsg,WPARAM wParam,LPARAM lParam,BOOL &bHandled);
+    LRESULT OnLogAppend(UINT uMsg,WPARAM wParam,LPARAM lParam,BOOL &bHandled);
     LRESULT OnOK(WORD wNotifyCode,WORD wID,HWND hWndCtl,BOOL &bHandled);
     LRESULT OnSaveAs(WORD wNotifyCode,WORD wID,HWND hWndCtl,BOOL &bHandled);
     LRESULT OnDiagDeviceScan(WORD wNotifyCode,WORD wID,HWND hWndCtl,BOOL &bHandled);
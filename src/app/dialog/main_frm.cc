@@ -45,9 +45,13 @@
 #include "files_data_object.hh"
 #include "device_util.hh"
 #include "about_window.hh"
+#include "info_dlg.hh"
+#include "device_inventory.hh"
+#include "progress_dlg.hh"
 #include "main_frm.hh"
 
-CMainFrame::CMainFrame() : m_pShellListView(NULL),m_bWelcomePane(false)
+CMainFrame::CMainFrame() : m_pShellListView(NULL),m_bWelcomePane(false),
+    m_bDeviceRescanPending(false),m_ulOpticalDriveMask(GetOpticalDriveMask())
 {
     m_iDefaultProjType = PROJECTTYPE_DATA;
     m_iDefaultMedia = -1;			// Use default for each project type.
@@ -146,6 +150,10 @@ int CMainFrame::GetDefaultMedia()
     if (m_iDefaultMedia != -1)
         return m_iDefaultMedia;
 
+    // The devices can't be accessed while they're being scanned.
+    if (g_DeviceInventory.IsScanning())
+        return -1;
+
     // Find which recorder that the media was changed for.
     std::vector<ckmmc::Device *>::const_iterator it;
     for (it = g_DeviceManager.devices().begin(); it !=
@@ -156,7 +164,7 @@ int CMainFrame::GetDefaultMedia()
         // Check if the current device was affected.
         if (pDevice->recorder())
         {
-            CCore2Info Info;
+            CCore2Info Info(g_pLogDlg);
             CCore2DiscInfo DiscInfo;
 
             // Fetch media information.
@@ -477,7 +485,7 @@ void CMainFrame::InitializeProjectView(unsigned int uiSplitterPos)
     // Create the list view.
     m_ProjectListView.Create(m_ProjectListViewContainer,rcDefault,NULL,
         WS_CHILD | WS_VISIBLE | WS_CLIPSIBLINGS | WS_CLIPCHILDREN | WS_TABSTOP | 
-        LVS_REPORT | LVS_AUTOARRANGE | LVS_SHOWSELALWAYS | LVS_SHAREIMAGELISTS/* | LVS_EDITLABELS*/,
+        LVS_REPORT | LVS_AUTOARRANGE | LVS_SHOWSELALWAYS | LVS_SHAREIMAGELISTS | LVS_OWNERDATA/* | LVS_EDITLABELS*/,
         WS_EX_CLIENTEDGE,IDC_PROJECTLISTVIEW);
     m_ProjectListViewHeader.SubclassWindow(m_ProjectListView.GetHeader());
 
@@ -921,7 +929,22 @@ void CMainFrame::FillDriveMenus()
         RemoveMenu(hEjectMenu,i,MF_BYPOSITION);
     }
 
-    if (g_DeviceManager.devices().size() > 0)
+    // While the devices are being scanned, list the devices found the last
+    // time the application was run. The items are disabled until the scan
+    // has completed and the menus are filled again.
+    if (g_DeviceInventory.IsScanning())
+    {
+        std::vector<CDeviceInventory::CEntry> Entries;
+        g_DeviceInventory.GetEntries(Entries);
+
+        std::vector<CDeviceInventory::CEntry>::const_iterator it;
+        for (it = Entries.begin(); it != Entries.end(); it++)
+        {
+            AppendMenu(hDiscMenu,MF_STRING | MF_GRAYED,0,it->m_Name.c_str());
+            AppendMenu(hEjectMenu,MF_STRING | MF_GRAYED,0,it->m_Name.c_str());
+        }
+    }
+    else if (g_DeviceManager.devices().size() > 0)
     {
         std::vector<ckmmc::Device *>::const_iterator it;
         for (it = g_DeviceManager.devices().begin(); it !=
@@ -1119,6 +1142,7 @@ LRESULT CMainFrame::OnCreate(UINT uMsg,WPARAM wParam,LPARAM lParam,BOOL &bHandle
     m_bEnableAutoRun = EnableAutoRun(false);
 
     // Fill drive menus.
+    g_DeviceInventory.SetNotifyWindow(m_hWnd);
     FillDriveMenus();
 
     // Apply the settings.
@@ -1229,6 +1253,8 @@ HIMAGELIST CMainFrame::GetToolBarLarge()
 
 LRESULT CMainFrame::OnDestroy(UINT uMsg,WPARAM wParam,LPARAM lParam,BOOL &bHandled)
 {
+    g_DeviceInventory.SetNotifyWindow(NULL);
+
     // If auto run was enabled before InfraRecorder was started, re-enable it.
     if (m_bEnableAutoRun)
         EnableAutoRun(true);
@@ -1418,6 +1444,40 @@ LRESULT CMainFrame::OnDeviceChange(UINT uMsg,WPARAM wParam,LPARAM lParam,
 {
     PDEV_BROADCAST_HDR lpdb = (PDEV_BROADCAST_HDR)lParam;
 
+    // A drive has been connected or disconnected, scan the devices again.
+    if ((wParam == DBT_DEVICEARRIVAL || wParam == DBT_DEVICEREMOVECOMPLETE) &&
+        lpdb->dbch_devicetype == DBT_DEVTYP_VOLUME &&
+        !(((PDEV_BROADCAST_VOLUME)lpdb)->dbcv_flags & DBTF_MEDIA))
+    {
+        PDEV_BROADCAST_VOLUME lpdbv = (PDEV_BROADCAST_VOLUME)lpdb;
+
+        // Only optical drives are of interest. The type of a removed drive
+        // can't be queried so it's looked up among the known optical drives.
+        bool bOptical = false;
+        if (wParam == DBT_DEVICEARRIVAL)
+        {
+            m_ulOpticalDriveMask = GetOpticalDriveMask();
+            bOptical = (lpdbv->dbcv_unitmask & m_ulOpticalDriveMask) != 0;
+        }
+        else
+        {
+            bOptical = (lpdbv->dbcv_unitmask & m_ulOpticalDriveMask) != 0;
+            m_ulOpticalDriveMask &= ~lpdbv->dbcv_unitmask;
+        }
+
+        if (bOptical)
+        {
+            bHandled = TRUE;
+            RescanDevices();
+        }
+
+        return 0;
+    }
+
+    // The devices can't be accessed while they're being scanned.
+    if (g_DeviceInventory.IsScanning())
+        return 0;
+
     if (wParam == DBT_DEVICEARRIVAL &&
         lpdb->dbch_devicetype == DBT_DEVTYP_VOLUME)
     {
@@ -1439,7 +1499,7 @@ LRESULT CMainFrame::OnDeviceChange(UINT uMsg,WPARAM wParam,LPARAM lParam,
                 // Check if the current device was affected.
                 if (pDevice->recorder() && bDevHadMediaChange)
                 {
-                    CCore2Info Info;
+                    CCore2Info Info(g_pLogDlg);
                     CCore2DiscInfo DiscInfo;
 
                     // Fetch media information.
@@ -1490,6 +1550,92 @@ LRESULT CMainFrame::OnDeviceChange(UINT uMsg,WPARAM wParam,LPARAM lParam,
     return 0;
 }
 
+/*
+    CMainFrame::GetOpticalDriveMask
+    -------------------------------
+    Returns a bit mask of the drive letters belonging to optical drives, bit 0
+    represents drive A.
+*/
+unsigned long CMainFrame::GetOpticalDriveMask()
+{
+    unsigned long ulDrives = ::GetLogicalDrives();
+    unsigned long ulMask = 0;
+
+    for (int i = 0; i < 26; i++)
+    {
+        TCHAR szRoot[4] = { (TCHAR)('A' + i),':','\\','\0' };
+        if ((ulDrives & (1 << i)) && ::GetDriveType(szRoot) == DRIVE_CDROM)
+            ulMask |= 1 << i;
+    }
+
+    return ulMask;
+}
+
+/*
+    CMainFrame::RescanDevices
+    -------------------------
+    Starts scanning the devices in the background. The device objects are
+    replaced by the scan so it's postponed while a modal operation, which may
+    be using the devices, is in progress.
+*/
+void CMainFrame::RescanDevices()
+{
+    if (!IsWindowEnabled())
+    {
+        m_bDeviceRescanPending = true;
+        return;
+    }
+
+    m_bDeviceRescanPending = false;
+
+    if (g_DeviceInventory.StartScan())
+        FillDriveMenus();
+}
+
+LRESULT CMainFrame::OnDeviceScanDone(UINT uMsg,WPARAM wParam,LPARAM lParam,
+                                     BOOL &bHandled)
+{
+    g_DeviceInventory.WaitForScan();
+
+    if (g_GlobalSettings.m_bLog)
+    {
+        g_pLogDlg->print_line(_T("  Device scan completed in %u ms."),
+                              g_DeviceInventory.GetScanTime());
+    }
+
+    FillDriveMenus();
+
+    if (g_DeviceManager.devices().size() == 0 && g_GlobalSettings.m_bNoDevWarning)
+    {
+        CInfoDlg InfoDlg(&g_GlobalSettings.m_bNoDevWarning,
+                         lngGetString(WARNING_NODEVICES),
+                         INFODLG_NOCANCEL | INFODLG_ICONWARNING);
+        InfoDlg.DoModal();
+    }
+
+    return 0;
+}
+
+/*
+    CMainFrame::OnCommandWaitForScan
+    --------------------------------
+    Commands are not executed until the devices have been scanned since most
+    of them access the device manager. The command is passed on to the
+    regular command handlers.
+*/
+LRESULT CMainFrame::OnCommandWaitForScan(UINT uMsg,WPARAM wParam,LPARAM lParam,
+                                         BOOL &bHandled)
+{
+    if (g_DeviceInventory.IsScanning())
+    {
+        CWaitCursor WaitCursor;		// This displays the hourglass cursor.
+        g_DeviceInventory.WaitForScan();
+    }
+
+    bHandled = FALSE;
+    return 0;
+}
+
 void CMainFrame::DisplayContextMenuOnShellTree(POINT ptPos,bool bWasWithKeyboard)
 {
     const HTREEITEM hSelectedItem = m_ShellTreeView.GetSelectedItem();
@@ -2395,7 +2541,7 @@ LRESULT CMainFrame::OnPTVEndLabelEdit(int iCtrlID,LPNMHDR pNMH,BOOL &bHandled)
     if (pNode != g_TreeManager.GetRootNode())
     {
         // Update the file name.
-        pNode->pItemData->SetFileName(lpDispInfo->item.pszText);
+        g_ProjectManager.RenameItem(pNode->pItemData,lpDispInfo->item.pszText);
 
         TCHAR szFullName[MAX_PATH];
         lstrcpy(szFullName,pNode->pItemData->GetFilePath());
@@ -2475,7 +2621,9 @@ LRESULT CMainFrame::OnPTVRClick(int iCtrlID,LPNMHDR pNMH,BOOL &bHandled)
 LRESULT CMainFrame::OnPLVGetDispInfo(int iCtrlID,LPNMHDR pNMH,BOOL &bHandled)
 {
     NMLVDISPINFO *pDispInfo = (NMLVDISPINFO *)pNMH;
-    CItemData *pItemData = (CItemData *)pDispInfo->item.lParam;
+    CItemData *pItemData = g_TreeManager.GetListItem(pDispInfo->item.iItem);
+    if (pItemData == NULL)
+        return 0;
 
     LVCOLUMN lvColumn = { 0 };
     lvColumn.mask = LVCF_SUBITEM;
@@ -2575,10 +2723,10 @@ LRESULT CMainFrame::OnPLVGetDispInfo(int iCtrlID,LPNMHDR pNMH,BOOL &bHandled)
 LRESULT CMainFrame::OnPLVBeginLabelEdit(int iCtrlID,LPNMHDR pNMH,BOOL &bHandled)
 {
     NMLVDISPINFO *pDispInfo = (NMLVDISPINFO *)pNMH;
-    CItemData *pItemData = (CItemData *)pDispInfo->item.lParam;
+    CItemData *pItemData = g_TreeManager.GetListItem(pDispInfo->item.iItem);
 
     // We can't rename locked items.
-    if (pItemData->ucFlags & PROJECTITEM_FLAG_ISLOCKED)
+    if (pItemData == NULL || (pItemData->ucFlags & PROJECTITEM_FLAG_ISLOCKED))
     {
         bHandled = true;
         return TRUE;
@@ -2624,8 +2772,11 @@ LRESULT CMainFrame::OnPLVEndLabelEdit(int iCtrlID,LPNMHDR pNMH,BOOL &bHandled)
     //        The file name might contain illegal characters.
 
     // Update the file name.
-    CItemData *pItemData = (CItemData *)pDispInfo->item.lParam;
-    pItemData->SetFileName(pDispInfo->item.pszText);
+    CItemData *pItemData = g_TreeManager.GetListItem(pDispInfo->item.iItem);
+    if (pItemData == NULL)
+        return TRUE;
+
+    g_ProjectManager.RenameItem(pItemData,pDispInfo->item.pszText);
 
     // Update the file type (if it's not a folder).
     if (!(pItemData->ucFlags & PROJECTITEM_FLAG_ISFOLDER))
@@ -2670,7 +2821,7 @@ LRESULT CMainFrame::OnPLVDblClk(int iCtrlID,LPNMHDR pNMH,BOOL &bHandled)
     if (iSelItem == -1)
         return 0;
 
-    CItemData *pItemData = (CItemData *)m_ProjectListView.GetItemData(iSelItem);
+    CItemData *pItemData = g_TreeManager.GetListItem(iSelItem);
 
     if (pItemData != NULL)
     {
@@ -2737,6 +2888,23 @@ LRESULT CMainFrame::OnPLVDeleteItem(int iCtrlID,LPNMHDR pNMH,BOOL &bHandled)
     return 0;
 }
 
+LRESULT CMainFrame::OnPLVODFindItem(int iCtrlID,LPNMHDR pNMH,BOOL &bHandled)
+{
+    LPNMLVFINDITEM lpFindItem = (LPNMLVFINDITEM)pNMH;
+
+    // Only file names can be searched for, which are displayed in the first
+    // column of data projects.
+    if (g_ProjectManager.GetViewType() != PROJECTVIEWTYPE_DATA ||
+        !(lpFindItem->lvfi.flags & (LVFI_STRING | LVFI_PARTIAL)) ||
+        lpFindItem->lvfi.psz == NULL)
+    {
+        return -1;
+    }
+
+    return g_TreeManager.FindListItem(lpFindItem->lvfi.psz,lpFindItem->iStart,
+        (lpFindItem->lvfi.flags & LVFI_PARTIAL) != 0);
+}
+
 LRESULT CMainFrame::OnPLVBeginDrag(int iCtrlID,LPNMHDR pNMH,BOOL &bHandled)
 {
     m_ProjectListView.BeginDrag((LPNMLISTVIEW)pNMH);
@@ -3055,6 +3223,9 @@ LRESULT CMainFrame::OnFileProjectproperties(WORD wNotifyCode,WORD wID,
         // Update the label.
         g_ProjectManager.SetDiscLabel(g_ProjectSettings.m_szLabel);
         g_ProjectManager.SetModified(true);
+
+        // The file system settings affect the space occupied by the project.
+        m_SpaceMeter.UpdateFileSystem();
     }
 
     return 0;
@@ -3126,13 +3297,13 @@ LRESULT CMainFrame::OnSelectAll(WORD wNotifyCode,WORD wID,HWND hWndCtl,BOOL &bHa
     else
         hWndListView = m_ProjectListView;
 
-    // Select all items in the list view.
+    // Select all items in the list view, an index of -1 applies the state to
+    // all items at once.
     LVITEM lvItem = { 0 };
     lvItem.state = LVIS_SELECTED;
     lvItem.stateMask = LVIS_SELECTED;
 
-    for (int i = 0; i < (int)::SendMessage(hWndListView,LVM_GETITEMCOUNT,0,0L); i++)
-        ::SendMessage(hWndListView,LVM_SETITEMSTATE,i,(LPARAM)&lvItem);
+    ::SendMessage(hWndListView,LVM_SETITEMSTATE,(WPARAM)-1,(LPARAM)&lvItem);
 
     return 0;
 }
@@ -3272,6 +3443,121 @@ LRESULT CMainFrame::OnActionsDiscInfo(UINT uNotifyCode,int nID,CWindow wnd)
     return 0;
 }
 
+// Describes a session that's being imported in the background.
+class CImportSessionParam
+{
+public:
+    HWND m_hWndHost;
+    ckmmc::Device *m_pDevice;
+    CProjectNode *m_pDataRootNode;
+
+    unsigned long m_ulTrackAddr;
+    unsigned long m_ulTrackLen;
+    unsigned long m_ulNextWritableAddr;
+    unsigned __int64 m_uiAllocatedSize;
+
+    ckfilesystem::IsoReader m_Reader;
+    std::map<ckfilesystem::IsoTreeNode *,ckcore::tstring> m_JolietNames;
+
+    CImportSessionParam(HWND hWndHost,ckmmc::Device *pDevice,CProjectNode *pDataRootNode) :
+        m_hWndHost(hWndHost),m_pDevice(pDevice),m_pDataRootNode(pDataRootNode),
+        m_ulTrackAddr(0),m_ulTrackLen(0),m_ulNextWritableAddr(0),m_uiAllocatedSize(0),
+        m_Reader(*g_pLogDlg)
+    {
+    }
+};
+
+/*
+    CMainFrame::ImportSessionThread
+    -------------------------------
+    Reads the file system of the session described by the CImportSessionParam
+    object. The sectors are read through a cached stream since the ISO reader
+    seeks back and forth between the path table and the directory extents.
+    The original names of the files are read from the Joliet tree.
+*/
+DWORD WINAPI CMainFrame::ImportSessionThread(LPVOID lpThreadParameter)
+{
+    CImportSessionParam *pParam = (CImportSessionParam *)lpThreadParameter;
+
+    unsigned long ulStartTime = GetTickCount();
+
+    CCore2InStream InStream(g_pLogDlg,*pParam->m_pDevice,0,
+        pParam->m_ulTrackAddr + pParam->m_ulTrackLen,g_pProgressDlg);
+
+    bool bResult = pParam->m_Reader.read(InStream,pParam->m_ulTrackAddr);
+    //pParam->m_Reader.PrintTree();
+
+    if (bResult && !CTreeManager::ReadJolietNames(InStream,pParam->m_ulTrackAddr,
+        pParam->m_Reader.get_root(),pParam->m_JolietNames))
+    {
+        g_pLogDlg->print_line(_T("  No Joliet file names, using the ISO9660 file names."));
+    }
+
+    g_pLogDlg->print_line(_T("  Read %u sectors using %u read operations (%u cache hits) in %u ms."),
+        InStream.GetBlocksRead(),InStream.GetReadCount(),InStream.GetCacheHits(),
+        GetTickCount() - ulStartTime);
+
+    ::PostMessage(pParam->m_hWndHost,WM_IMPORTSESSION_DONE,bResult,(LPARAM)pParam);
+    return 0;
+}
+
+/*
+    CMainFrame::OnImportSessionDone
+    -------------------------------
+    Imports the file tree read by ImportSessionThread into the project. This
+    is done on the UI thread since it updates the project views.
+*/
+LRESULT CMainFrame::OnImportSessionDone(UINT uMsg,WPARAM wParam,LPARAM lParam,
+                                        BOOL &bHandled)
+{
+    CImportSessionParam *pParam = (CImportSessionParam *)lParam;
+
+    g_pProgressDlg->set_marquee(false);
+
+    if (!wParam || g_pProgressDlg->cancelled())
+    {
+        if (!g_pProgressDlg->cancelled())
+        {
+            g_pLogDlg->print_line(_T("  Error: Failed to read the file system of the session."));
+            g_pProgressDlg->notify(ckcore::Progress::ckERROR,lngGetString(ERROR_IMPORTSESSION));
+        }
+
+        g_pProgressDlg->set_progress(100);
+        g_pProgressDlg->NotifyCompleted();
+
+        delete pParam;
+        return 0;
+    }
+
+    g_TreeManager.ImportIsoTree(pParam->m_Reader.get_root(),pParam->m_pDataRootNode,
+                                pParam->m_JolietNames);
+    g_TreeManager.Refresh();
+
+    // Update the space meter. The imported items are added to the tree
+    // directly so the layout is rebuilt to include their directory records.
+    g_ProjectManager.RebuildSpaceMeter(pParam->m_uiAllocatedSize);
+
+    // Update the (internal) project settings.
+    g_ProjectSettings.m_bMultiSession = true;
+    g_ProjectSettings.m_uiImportTrackAddr = pParam->m_ulTrackAddr;
+    g_ProjectSettings.m_uiImportTrackLen = pParam->m_ulTrackLen;
+    g_ProjectSettings.m_uiNextWritableAddr = pParam->m_ulNextWritableAddr;
+    g_ProjectSettings.m_pDevice = pParam->m_pDevice;
+    g_ProjectSettings.m_iIsoFormat = 1;	// Mode 2 (multi-session)
+
+    g_pLogDlg->print_line(_T("  Imported session: %I64d-%I64d, %I64d."),
+        g_ProjectSettings.m_uiImportTrackAddr,
+        g_ProjectSettings.m_uiImportTrackAddr + g_ProjectSettings.m_uiImportTrackLen,
+        g_ProjectSettings.m_uiNextWritableAddr);
+
+    delete pParam;
+
+    // Close the progress window and re-enable the main window.
+    g_pProgressDlg->DestroyWindow();
+    EnableWindow(true);
+    return 0;
+}
+
 LRESULT CMainFrame::OnActionsImportsession(WORD wNotifyCode,WORD wID,HWND hWndCtl,BOOL &bHandled)
 {
     g_pLogDlg->print_line(_T("CMainFrame::OnActionsImportsession"));
@@ -3318,7 +3604,7 @@ LRESULT CMainFrame::OnActionsImportsession(WORD wNotifyCode,WORD wID,HWND hWndCt
         ckmmc::Device *pDevice = ImportSessionDlg.m_pSelDevice;
         ATLASSERT(pDevice != NULL);
         
-        CCore2Info Info;
+        CCore2Info Info(g_pLogDlg);
         CCore2TrackInfo TrackInfo;
         if (!Info.ReadTrackInformation(*pDevice,CCore2Info::TIT_TRACK,0xFF,&TrackInfo))
         {
@@ -3326,32 +3612,36 @@ LRESULT CMainFrame::OnActionsImportsession(WORD wNotifyCode,WORD wID,HWND hWndCt
             return 0;
         }
 
-        // Import file tree.
-        CCore2InStream InStream(g_pLogDlg,*pDevice,0,
-            ImportSessionDlg.m_pSelTrackData->m_ulTrackAddr + ImportSessionDlg.m_pSelTrackData->m_ulTrackLen);
+        CImportSessionParam *pParam = new CImportSessionParam(m_hWnd,pDevice,pDataRootNode);
+        pParam->m_ulTrackAddr = ImportSessionDlg.m_pSelTrackData->m_ulTrackAddr;
+        pParam->m_ulTrackLen = ImportSessionDlg.m_pSelTrackData->m_ulTrackLen;
+        pParam->m_ulNextWritableAddr = TrackInfo.m_ulNextWritableAddr;
+        pParam->m_uiAllocatedSize = ImportSessionDlg.m_uiAllocatedSize;
 
-        ckfilesystem::IsoReader Reader(*g_pLogDlg);
-        Reader.read(InStream,ImportSessionDlg.m_pSelTrackData->m_ulTrackAddr);
-        //Reader.PrintTree();
+        // Disable the main frame.
+        EnableWindow(false);
 
-        g_TreeManager.ImportIsoTree(Reader.get_root(),pDataRootNode);
-        g_TreeManager.Refresh();
+        // Create and display the progress dialog.
+        if (!g_pProgressDlg->IsWindow())
+            g_pProgressDlg->Create(m_hWnd);
 
-        // Update the space meter.
-        m_SpaceMeter.SetAllocatedSize(ImportSessionDlg.m_uiAllocatedSize);
-        
-        // Update the (internal) project settings.
-        g_ProjectSettings.m_bMultiSession = true;
-        g_ProjectSettings.m_uiImportTrackAddr = ImportSessionDlg.m_pSelTrackData->m_ulTrackAddr;
-        g_ProjectSettings.m_uiImportTrackLen = ImportSessionDlg.m_pSelTrackData->m_ulTrackLen;
-        g_ProjectSettings.m_uiNextWritableAddr = TrackInfo.m_ulNextWritableAddr;
-        g_ProjectSettings.m_pDevice = ImportSessionDlg.m_pSelDevice;
-        g_ProjectSettings.m_iIsoFormat = 1;	// Mode 2 (multi-session)
+        g_pProgressDlg->ShowWindow(true);
+        g_pProgressDlg->SetWindowText(lngGetString(STITLE_IMPORTSESSION));
+        g_pProgressDlg->Reset();
+        g_pProgressDlg->AttachProcess(NULL);
+        g_pProgressDlg->AttachHost(m_hWnd);
+        ProcessMessages();
 
-        g_pLogDlg->print_line(_T("  Imported session: %I64d-%I64d, %I64d."),
-            g_ProjectSettings.m_uiImportTrackAddr,
-            g_ProjectSettings.m_uiImportTrackAddr + g_ProjectSettings.m_uiImportTrackLen,
-            g_ProjectSettings.m_uiNextWritableAddr);
+        // Set the device information.
+        g_pProgressDlg->SetDevice(*pDevice);
+        g_pProgressDlg->set_status(lngGetString(PROGRESS_INIT));
+        g_pProgressDlg->set_marquee(true);
+
+        // Read the file tree in the background, the tree is imported into the
+        // project when the thread posts WM_IMPORTSESSION_DONE.
+        unsigned long ulThreadID = 0;
+        HANDLE hThread = ::CreateThread(NULL,0,ImportSessionThread,pParam,0,&ulThreadID);
+        ::CloseHandle(hThread);
     }
 
     return 0;
@@ -3457,6 +3747,9 @@ LRESULT CMainFrame::OnOptionsDevices(WORD wNotifyCode,WORD wID,HWND hWndCtl,BOOL
     CDevicesDlg DevicesDlg;
     DevicesDlg.DoModal();
 
+    // The devices may have been rescanned.
+    FillDriveMenus();
+
     return 0;
 }
 
@@ -134,6 +134,16 @@ private:
     // Set to true if the welcome pane is currently active.
     bool m_bWelcomePane;
 
+    // Set to true if a drive has been connected or disconnected while the
+    // devices could not be scanned.
+    bool m_bDeviceRescanPending;
+    void RescanDevices();
+
+    // Drive letters of the optical drives, used for telling if a removed
+    // volume belonged to an optical drive since it can no longer be queried.
+    unsigned long m_ulOpticalDriveMask;
+    static unsigned long GetOpticalDriveMask();
+
     HWND CreateToolBarCtrl();
 
     int GetDefaultMedia();
@@ -170,6 +180,8 @@ private:
 
     void DisplayContextMenuOnShellTree(POINT ptPos,bool bWasWithKeyboard);
 
+    static DWORD WINAPI ImportSessionThread(LPVOID lpThreadParameter);
+
 public:
     DECLARE_FRAME_WND_CLASS(NULL,IDR_MAINFRAME)
 
@@ -223,6 +235,9 @@ private:
 
     virtual BOOL OnIdle()
     {
+        if (m_bDeviceRescanPending && IsWindowEnabled())
+            RescanDevices();
+
         UIUpdateToolBar();
         return FALSE;
     }
@@ -305,6 +320,7 @@ private:
 #else
     BEGIN_MSG_MAP(CMainFrame)
 #endif
+        MESSAGE_HANDLER(WM_COMMAND,OnCommandWaitForScan)
         MESSAGE_HANDLER(WM_CREATE,OnCreate)
         MESSAGE_HANDLER(WM_DESTROY,OnDestroy)
         MESSAGE_HANDLER(WM_CLOSE,OnClose)
@@ -312,6 +328,8 @@ private:
         MESSAGE_HANDLER(WM_GETISHELLBROWSER,OnGetIShellBrowser)
         MESSAGE_HANDLER(WM_CONTEXTMENU,OnContextMenu)
         MESSAGE_HANDLER(WM_DEVICECHANGE,OnDeviceChange)
+        MESSAGE_HANDLER(WM_DEVICESCAN_DONE,OnDeviceScanDone)
+        MESSAGE_HANDLER(WM_IMPORTSESSION_DONE,OnImportSessionDone)
 
         // Shell list view.
         MESSAGE_HANDLER(WM_SLVC_BROWSEOBJECT,OnSLVBrowseObject)
@@ -343,7 +361,10 @@ private:
         NOTIFY_HANDLER(IDC_PROJECTLISTVIEW,NM_DBLCLK,OnPLVDblClk)
         NOTIFY_HANDLER(IDC_PROJECTLISTVIEW,NM_RCLICK,OnPLVRClick)
         NOTIFY_HANDLER(IDC_PROJECTLISTVIEW,LVN_ITEMCHANGED,OnPLVItemChanged)
+        NOTIFY_HANDLER(IDC_PROJECTLISTVIEW,LVN_ODSTATECHANGED,OnPLVItemChanged)
         NOTIFY_HANDLER(IDC_PROJECTLISTVIEW,LVN_DELETEITEM,OnPLVDeleteItem)
+        NOTIFY_HANDLER(IDC_PROJECTLISTVIEW,LVN_DELETEALLITEMS,OnPLVDeleteItem)
+        NOTIFY_HANDLER(IDC_PROJECTLISTVIEW,LVN_ODFINDITEM,OnPLVODFindItem)
         NOTIFY_HANDLER(IDC_PROJECTLISTVIEW,LVN_BEGINDRAG,OnPLVBeginDrag)
         NOTIFY_HANDLER(IDC_PROJECTLISTVIEW,LVN_COLUMNCLICK,OnPLVColumnClick)
 
@@ -438,6 +459,9 @@ private:
     LRESULT OnGetIShellBrowser(UINT uMsg,WPARAM wParam,LPARAM lParam,BOOL &bHandled);
     LRESULT OnContextMenu(UINT uMsg,WPARAM wParam,LPARAM lParam,BOOL &bHandled);
     LRESULT OnDeviceChange(UINT uMsg,WPARAM wParam,LPARAM lParam,BOOL &bHandled);
+    LRESULT OnDeviceScanDone(UINT uMsg,WPARAM wParam,LPARAM lParam,BOOL &bHandled);
+    LRESULT OnImportSessionDone(UINT uMsg,WPARAM wParam,LPARAM lParam,BOOL &bHandled);
+    LRESULT OnCommandWaitForScan(UINT uMsg,WPARAM wParam,LPARAM lParam,BOOL &bHandled);
 
     // Shell list view.
     LRESULT OnSLVBrowseObject(UINT uMsg,WPARAM wParam,LPARAM lParam,BOOL &bHandled);
@@ -467,6 +491,7 @@ private:
     LRESULT OnPLVRClick(int iCtrlID,LPNMHDR pNMH,BOOL &bHandled);
     LRESULT OnPLVItemChanged(int iCtrlID,LPNMHDR pNMH,BOOL &bHandled);
     LRESULT OnPLVDeleteItem(int iCtrlID,LPNMHDR pNMH,BOOL &bHandled);
+    LRESULT OnPLVODFindItem(int iCtrlID,LPNMHDR pNMH,BOOL &bHandled);
     LRESULT OnPLVBeginDrag(int iCtrlID,LPNMHDR pNMH,BOOL &bHandled);
     LRESULT OnPLVColumnClick(int iCtrlID,LPNMHDR pNMH,BOOL &bHandled);
 
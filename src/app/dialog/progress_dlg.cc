@@ -95,6 +95,8 @@ bool CProgressDlg::Translate()
         SetDlgItemText(IDC_RELOADBUTTON,szStrValue);
     if (pLng->GetValuePtr(IDC_BUFFERSTATIC,szStrValue))
         SetDlgItemText(IDC_BUFFERSTATIC,szStrValue);
+    if (pLng->GetValuePtr(IDC_SOURCEBUFFERSTATIC,szStrValue))
+        SetDlgItemText(IDC_SOURCEBUFFERSTATIC,szStrValue);
 
     return true;
 }
@@ -399,6 +401,11 @@ void CProgressDlg::SetBuffer(int iPercent)
     SendDlgItemMessage(IDC_BUFFERPROGRESS,PBM_SETPOS,(WPARAM)iPercent,0);
 }
 
+void CProgressDlg::SetSourceBuffer(int iPercent)
+{
+    SendDlgItemMessage(IDC_SOURCEBUFFERPROGRESS,PBM_SETPOS,(WPARAM)iPercent,0);
+}
+
 void CProgressDlg::AllowReload()
 {
     ::ShowWindow(GetDlgItem(IDC_RELOADBUTTON),SW_SHOW);
@@ -438,6 +445,7 @@ LRESULT CProgressDlg::OnInitDialog(UINT uMsg,WPARAM wParam,LPARAM lParam,BOOL &b
 
     SendDlgItemMessage(IDC_TOTALPROGRESS,PBM_SETRANGE32,0,100);
     SendDlgItemMessage(IDC_BUFFERPROGRESS,PBM_SETRANGE32,0,100);
+    SendDlgItemMessage(IDC_SOURCEBUFFERPROGRESS,PBM_SETRANGE32,0,100);
 
     // Make the static controls double buffered.
     m_TotalStatic.SubclassWindow(GetDlgItem(IDC_TOTALSTATIC));
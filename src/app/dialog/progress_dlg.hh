@@ -97,6 +97,7 @@ public:
     void NotifyCompleted();
 
     void SetBuffer(int iPercent);
+    void SetSourceBuffer(int iPercent);
     void AllowReload();
     void AllowCancel(bool bAllow);
 
@@ -132,6 +133,8 @@ private:
         DLGRESIZE_CONTROL(IDC_DEVICESTATIC,DLSZ_SIZE_X | DLSZ_MOVE_Y)
         DLGRESIZE_CONTROL(IDC_BUFFERSTATIC,DLSZ_MOVE_Y)
         DLGRESIZE_CONTROL(IDC_BUFFERPROGRESS,DLSZ_SIZE_X | DLSZ_MOVE_Y)
+        DLGRESIZE_CONTROL(IDC_SOURCEBUFFERSTATIC,DLSZ_MOVE_Y)
+        DLGRESIZE_CONTROL(IDC_SOURCEBUFFERPROGRESS,DLSZ_SIZE_X | DLSZ_MOVE_Y)
         DLGRESIZE_CONTROL(IDOK,DLSZ_MOVE_X | DLSZ_MOVE_Y)
         DLGRESIZE_CONTROL(IDCANCEL,DLSZ_MOVE_X | DLSZ_MOVE_Y)
         DLGRESIZE_CONTROL(IDC_RELOADBUTTON,DLSZ_MOVE_X | DLSZ_MOVE_Y)
@@ -60,6 +60,12 @@ bool CProjectPropFileSysPage::Translate()
     TCHAR *szStrValue;
     if (pLng->GetValuePtr(IDC_FILESYSSTATIC,szStrValue))
         SetDlgItemText(IDC_FILESYSSTATIC,szStrValue);
+    if (pLng->GetValuePtr(IDC_DIFFERENTIALCHECK,szStrValue))
+        SetDlgItemText(IDC_DIFFERENTIALCHECK,szStrValue);
+    if (pLng->GetValuePtr(IDC_DIFFERENTIALHASHCHECK,szStrValue))
+        SetDlgItemText(IDC_DIFFERENTIALHASHCHECK,szStrValue);
+    if (pLng->GetValuePtr(IDC_DEDUPCHECK,szStrValue))
+        SetDlgItemText(IDC_DEDUPCHECK,szStrValue);
 
     return true;
 }
@@ -67,6 +73,9 @@ bool CProjectPropFileSysPage::Translate()
 bool CProjectPropFileSysPage::OnApply()
 {
     g_ProjectSettings.m_iFileSystem = (int)m_FileSysCombo.GetItemData(m_FileSysCombo.GetCurSel());
+    g_ProjectSettings.m_bDifferential = IsDlgButtonChecked(IDC_DIFFERENTIALCHECK) == TRUE;
+    g_ProjectSettings.m_bDifferentialHash = IsDlgButtonChecked(IDC_DIFFERENTIALHASHCHECK) == TRUE;
+    g_ProjectSettings.m_bDeduplicate = IsDlgButtonChecked(IDC_DEDUPCHECK) == TRUE;
 
     return true;
 }
@@ -117,6 +126,13 @@ LRESULT CProjectPropFileSysPage::OnInitDialog(UINT uMsg,WPARAM wParam,LPARAM lPa
     if (g_ProjectSettings.m_bMultiSession)
         m_FileSysCombo.EnableWindow(FALSE);
 
+    // Differential multi-session.
+    CheckDlgButton(IDC_DIFFERENTIALCHECK,g_ProjectSettings.m_bDifferential);
+    CheckDlgButton(IDC_DIFFERENTIALHASHCHECK,g_ProjectSettings.m_bDifferentialHash);
+    ::EnableWindow(GetDlgItem(IDC_DIFFERENTIALHASHCHECK),g_ProjectSettings.m_bDifferential);
+
+    CheckDlgButton(IDC_DEDUPCHECK,g_ProjectSettings.m_bDeduplicate);
+
     // Translate the window.
     Translate();
 
@@ -132,3 +148,12 @@ LRESULT CProjectPropFileSysPage::OnFileSysChange(WORD wNotifyCode,WORD wID,HWND
     bHandled = false;
     return 0;
 }
+
+LRESULT CProjectPropFileSysPage::OnDifferentialCheck(WORD wNotifyCode,WORD wID,HWND hWndCtl,BOOL &bHandled)
+{
+    bool bDifferential = IsDlgButtonChecked(IDC_DIFFERENTIALCHECK) == TRUE;
+    ::EnableWindow(GetDlgItem(IDC_DIFFERENTIALHASHCHECK),bDifferential);
+
+    bHandled = false;
+    return 0;
+}
@@ -39,10 +39,12 @@ public:
     BEGIN_MSG_MAP(CProjectPropFileSysPage)
         MESSAGE_HANDLER(WM_INITDIALOG,OnInitDialog)
         COMMAND_HANDLER(IDC_FILESYSCOMBO,CBN_SELCHANGE,OnFileSysChange)
+        COMMAND_HANDLER(IDC_DIFFERENTIALCHECK,BN_CLICKED,OnDifferentialCheck)
 
         CHAIN_MSG_MAP(CPropertyPageImpl<CProjectPropFileSysPage>)
     END_MSG_MAP()
 
     LRESULT OnInitDialog(UINT uMsg,WPARAM wParam,LPARAM lParam,BOOL &bHandled);
     LRESULT OnFileSysChange(WORD wNotifyCode,WORD wID,HWND hWndCtl,BOOL &bHandled);
+    LRESULT OnDifferentialCheck(WORD wNotifyCode,WORD wID,HWND hWndCtl,BOOL &bHandled);
 };
@@ -23,6 +23,7 @@
 #include "string_table.hh"
 #include "settings.hh"
 #include "lang_util.hh"
+#include "core2_dedup.hh"
 
 CProjectPropGeneralPage::CProjectPropGeneralPage()
 {
@@ -69,6 +70,8 @@ bool CProjectPropGeneralPage::Translate()
         SetDlgItemText(IDC_SIZELABELSTATIC,szStrValue);
     if (pLng->GetValuePtr(IDC_CONTAINSLABELSTATIC,szStrValue))
         SetDlgItemText(IDC_CONTAINSLABELSTATIC,szStrValue);
+    if (pLng->GetValuePtr(IDC_DUPLICATESLABELSTATIC,szStrValue))
+        SetDlgItemText(IDC_DUPLICATESLABELSTATIC,szStrValue);
 
     return true;
 }
@@ -92,6 +95,89 @@ void CProjectPropGeneralPage::OnHelp()
     HtmlHelp(m_hWnd,szFileName,HH_DISPLAY_TOC,NULL);
 }
 
+class CDuplicateScanParam
+{
+public:
+    HWND m_hWndHost;
+    ckfilesystem::FileSet m_Files;
+
+    unsigned int m_uiFileCount;
+    unsigned __int64 m_uiSize;
+
+    CDuplicateScanParam(HWND hWndHost) : m_hWndHost(hWndHost),m_uiFileCount(0),m_uiSize(0)
+    {
+    }
+
+    ~CDuplicateScanParam()
+    {
+        ckfilesystem::destroy_file_set(m_Files);
+    }
+};
+
+/*
+    CProjectPropGeneralPage::DuplicateScanThread
+    --------------------------------------------
+    Compares the project files of the CDuplicateScanParam object. The result
+    is discarded if the page has been closed before the files were compared.
+*/
+DWORD WINAPI CProjectPropGeneralPage::DuplicateScanThread(LPVOID lpThreadParameter)
+{
+    CDuplicateScanParam *pParam = (CDuplicateScanParam *)lpThreadParameter;
+
+    CCore2Dedup::Analyze(pParam->m_Files,pParam->m_uiFileCount,pParam->m_uiSize);
+
+    if (!::PostMessage(pParam->m_hWndHost,WM_DUPLICATESCAN_DONE,0,(LPARAM)pParam))
+        delete pParam;
+
+    return 0;
+}
+
+/*
+    CProjectPropGeneralPage::SetupDuplicates
+    ----------------------------------------
+    Starts comparing the project files to find the duplicate files that are
+    stored only once. The files are compared in the background, the result
+    is displayed and the space meter updated when the thread posts
+    WM_DUPLICATESCAN_DONE.
+*/
+void CProjectPropGeneralPage::SetupDuplicates()
+{
+    CDuplicateScanParam *pParam = new CDuplicateScanParam(m_hWnd);
+    if (!g_ProjectManager.GetProjectDuplicateFiles(pParam->m_Files))
+    {
+        delete pParam;
+
+        SetDlgItemText(IDC_DUPLICATESSTATIC,lngGetString(MISC_NOTAVAILABLE));
+        return;
+    }
+
+    unsigned long ulThreadID = 0;
+    HANDLE hThread = ::CreateThread(NULL,0,DuplicateScanThread,pParam,0,&ulThreadID);
+    if (hThread == NULL)
+    {
+        delete pParam;
+
+        SetDlgItemText(IDC_DUPLICATESSTATIC,lngGetString(MISC_NOTAVAILABLE));
+        return;
+    }
+
+    ::CloseHandle(hThread);
+
+    SetDlgItemText(IDC_DUPLICATESSTATIC,lngGetString(PROJECT_DUPLICATESSCAN));
+}
+
+void CProjectPropGeneralPage::SetupSize()
+{
+    TCHAR szBuffer[64];
+
+    unsigned __int64 uiSize = g_ProjectManager.GetProjectSize();
+    TCHAR szSizeText[32];
+    FormatBytes(szBuffer,uiSize);
+    lsprintf(szSizeText,_T(" (%I64d Bytes)"),uiSize);
+    lstrcat(szBuffer,szSizeText);
+    SetDlgItemText(IDC_SIZESTATIC,szBuffer);
+}
+
 void CProjectPropGeneralPage::SetupDataProject()
 {
     TCHAR szBuffer[64];
@@ -107,13 +193,11 @@ void CProjectPropGeneralPage::SetupDataProject()
     // Type.
     SetDlgItemText(IDC_TYPESTATIC,lngGetString(PROJECT_DATA));
 
-    // Size.
-    unsigned __int64 uiSize = g_ProjectManager.GetProjectSize();
-    TCHAR szSizeText[32];
-    FormatBytes(szBuffer,uiSize);
-    lsprintf(szSizeText,_T(" (%I64d Bytes)"),uiSize);
-    lstrcat(szBuffer,szSizeText);
-    SetDlgItemText(IDC_SIZESTATIC,szBuffer);
+    // Size, updated when the duplicates have been found.
+    SetupSize();
+
+    // Duplicates.
+    SetupDuplicates();
 
     // Contents.
     unsigned __int64 uiFileCount,uiFolderCount,uiTrackCount;
@@ -142,6 +226,9 @@ void CProjectPropGeneralPage::SetupAudioProject()
     lsnprintf_s(szBuffer,64,lngGetString(MISC_MINUTES),g_ProjectManager.GetProjectSize()/(1000 * 60));
     SetDlgItemText(IDC_SIZESTATIC,szBuffer);
 
+    // Duplicates.
+    SetDlgItemText(IDC_DUPLICATESSTATIC,lngGetString(MISC_NOTAVAILABLE));
+
     // Contents.
     unsigned __int64 uiFileCount,uiFolderCount,uiTrackCount;
     g_ProjectManager.GetProjectContents(uiFileCount,uiFolderCount,uiTrackCount);
@@ -164,13 +251,11 @@ void CProjectPropGeneralPage::SetupMixedProject()
     // Type.
     SetDlgItemText(IDC_TYPESTATIC,lngGetString(PROJECT_MIXED));
 
-    // Size.
-    unsigned __int64 uiSize = g_ProjectManager.GetProjectSize();
-    TCHAR szSizeText[32];
-    FormatBytes(szBuffer,uiSize);
-    lsprintf(szSizeText,_T(" (%I64d Bytes)"),uiSize);
-    lstrcat(szBuffer,szSizeText);
-    SetDlgItemText(IDC_SIZESTATIC,szBuffer);
+    // Size, updated when the duplicates have been found.
+    SetupSize();
+
+    // Duplicates.
+    SetupDuplicates();
 
     // Contents.
     unsigned __int64 uiFileCount,uiFolderCount,uiTrackCount;
@@ -204,3 +289,23 @@ LRESULT CProjectPropGeneralPage::OnInitDialog(UINT uMsg,WPARAM wParam,LPARAM lPa
 
     return TRUE;
 }
+
+LRESULT CProjectPropGeneralPage::OnDuplicateScanDone(UINT uMsg,WPARAM wParam,LPARAM lParam,
+                                                     BOOL &bHandled)
+{
+    CDuplicateScanParam *pParam = (CDuplicateScanParam *)lParam;
+
+    TCHAR szBuffer[64];
+    TCHAR szSize[32];
+    FormatBytes(szSize,pParam->m_uiSize);
+
+    lsnprintf_s(szBuffer,64,lngGetString(PROJECT_DUPLICATES),pParam->m_uiFileCount,szSize);
+    SetDlgItemText(IDC_DUPLICATESSTATIC,szBuffer);
+
+    // The project size depends on the duplicates.
+    g_ProjectManager.SetProjectDuplicateSize(pParam->m_uiSize);
+    SetupSize();
+
+    delete pParam;
+    return 0;
+}
@@ -18,6 +18,7 @@
 
 #pragma once
 #include "resource.h"
+#include "ctrl_messages.hh"
 
 class CProjectPropGeneralPage : public CPropertyPageImpl<CProjectPropGeneralPage>
 {
@@ -27,6 +28,10 @@ private:
     void SetupDataProject();
     void SetupAudioProject();
     void SetupMixedProject();
+    void SetupDuplicates();
+    void SetupSize();
+
+    static DWORD WINAPI DuplicateScanThread(LPVOID lpThreadParameter);
 
     bool Translate();
 
@@ -41,9 +46,11 @@ public:
 
     BEGIN_MSG_MAP(CProjectPropGeneralPage)
         MESSAGE_HANDLER(WM_INITDIALOG,OnInitDialog)
+        MESSAGE_HANDLER(WM_DUPLICATESCAN_DONE,OnDuplicateScanDone)
 
         CHAIN_MSG_MAP(CPropertyPageImpl<CProjectPropGeneralPage>)
     END_MSG_MAP()
 
     LRESULT OnInitDialog(UINT uMsg,WPARAM wParam,LPARAM lParam,BOOL &bHandled);
+    LRESULT OnDuplicateScanDone(UINT uMsg,WPARAM wParam,LPARAM lParam,BOOL &bHandled);
 };
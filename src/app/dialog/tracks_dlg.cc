@@ -26,6 +26,7 @@
 #include "progress_dlg.hh"
 #include "infrarecorder.hh"
 #include "device_util.hh"
+#include "audio_util.hh"
 #include "core.hh"
 #include "core2.hh"
 #include "lang_util.hh"
@@ -429,100 +430,7 @@ unsigned long CTracksDlg::GetTrackAddress(int iTrackIndex)
 
 bool CTracksDlg::EncodeTrack(const TCHAR *szFileName,CCodec *pEncoder)
 {
-    // Find which codec that can be uses for decoding the source file.
-    CCodec *pDecoder = NULL;
-
-    // Source file information.
-    int iNumChannels = -1;
-    int iSampleRate = -1;
-    int iBitRate = -1;
-    unsigned __int64 uiDuration = 0;
-
-    for (unsigned int i = 0; i < g_CodecManager.m_Codecs.size(); i++)
-    {
-        // We're only interested in decoders.
-        if ((g_CodecManager.m_Codecs[i]->irc_capabilities() & IRC_HAS_DECODER) == 0)
-            continue;
-
-        if (g_CodecManager.m_Codecs[i]->irc_decode_init(szFileName,iNumChannels,
-            iSampleRate,iBitRate,uiDuration))
-        {
-            pDecoder = g_CodecManager.m_Codecs[i];
-            break;
-        }
-    }
-
-    if (pDecoder == NULL)
-    {
-        TCHAR szNameBuffer[MAX_PATH];
-        lstrcpy(szNameBuffer,szFileName);
-        ExtractFileName(szNameBuffer);
-
-        g_pProgressDlg->notify(ckcore::Progress::ckERROR,
-            lngGetString(ERROR_NODECODER),szNameBuffer);
-        return false;
-    }
-
-    // Setup the encoder.
-    TCHAR szTargetFile[MAX_PATH];
-    lstrcpy(szTargetFile,szFileName);
-    ChangeFileExt(szTargetFile,pEncoder->irc_string(IRC_STR_FILEEXT));
-
-    // Initialize the encoder.
-    if (!pEncoder->irc_encode_init(szTargetFile,iNumChannels,iSampleRate,iBitRate))
-    {
-        g_pProgressDlg->notify(ckcore::Progress::ckERROR,lngGetString(ERROR_CODECINIT),
-            pEncoder->irc_string(IRC_STR_ENCODER),
-            iNumChannels,iSampleRate,iBitRate,uiDuration);
-
-        pDecoder->irc_decode_exit();
-        return false;
-    }
-
-    // Encode/decode-process.
-    __int64 iBytesRead = 0;
-    unsigned __int64 uiCurrentTime = 0;
-
-#define ENCODE_BUFFER_FACTOR		1024
-
-    // Allocate buffer memory.
-    unsigned int uiBufferSize = iNumChannels * ((iBitRate / iSampleRate) >> 3) * ENCODE_BUFFER_FACTOR;
-    unsigned char *pBuffer = new unsigned char[uiBufferSize];
-
-    while (true)
-    {
-        iBytesRead = pDecoder->irc_decode_process(pBuffer,uiBufferSize,uiCurrentTime);
-        if (iBytesRead <= 0)
-            break;
-
-        if (pEncoder->irc_encode_process(pBuffer,iBytesRead) < 0)
-        {
-            g_pProgressDlg->notify(ckcore::Progress::ckERROR,lngGetString(ERROR_ENCODEDATA));
-            break;
-        }
-
-        // Update the progres bar.
-        unsigned char ucPercent = (unsigned char)(((double)uiCurrentTime/uiDuration) * 100);
-        g_pProgressDlg->set_progress(ucPercent);
-    }
-
-    // Free buffer memory.
-    delete [] pBuffer;
-
-    // Flush.
-    pEncoder->irc_encode_flush();
-    g_pProgressDlg->set_progress(100);
-
-    // Destroy the codecs.
-    pEncoder->irc_encode_exit();
-    pDecoder->irc_decode_exit();
-
-    ExtractFileName(szTargetFile);
-
-    g_pProgressDlg->notify(ckcore::Progress::ckINFORMATION,
-        lngGetString(SUCCESS_ENCODETRACK),szTargetFile);
-
-    return true;
+    return EncodeAudioFile(szFileName,pEncoder,*g_pProgressDlg);
 }
 
 unsigned long WINAPI CTracksDlg::ReadTrackThread(LPVOID lpThreadParameter)
@@ -31,8 +31,13 @@
 #include "lang_util.hh"
 #include "action_manager.hh"
 #include "temp_manager.hh"
+#include "core2_checkpoint.hh"
 #include "info_dlg.hh"
 #include "about_window.hh"
+#include "device_util.hh"
+#include "console_progress.hh"
+#include "job.hh"
+#include "device_inventory.hh"
 #include "infrarecorder.hh"
 
 CAppModule _Module;
@@ -43,6 +48,8 @@ CCodecManager g_CodecManager;
 // Global device manager object.
 ckmmc::DeviceManager g_DeviceManager;
 
+bool g_bJobMode = false;
+
 // Global pointers to GUI objects owned by this file.
 CLogDlg *g_pLogDlg = NULL;
 CMainFrame *g_pMainFrame = NULL;
@@ -101,17 +108,247 @@ static int SaveEnglishStrings(const TCHAR * const szFileName)
 }
 #endif
 
-void PerformDeviceScan()
+// Exit codes returned when running unattended jobs.
+#define JOB_EXITCODE_OK				0
+#define JOB_EXITCODE_FAILED			1
+#define JOB_EXITCODE_USAGE			2
+#define JOB_EXITCODE_CANCELLED		3
+
+static ckmmc::Device *FindDevice(const TCHAR *szAddress)
+{
+    std::vector<ckmmc::Device *>::const_iterator it;
+    for (it = g_DeviceManager.devices().begin(); it !=
+        g_DeviceManager.devices().end(); it++)
+    {
+        if (NDeviceUtil::GetDeviceAddr(**it) == szAddress)
+            return *it;
+    }
+
+    return NULL;
+}
+
+/*
+    FindEncoder
+    -----------
+    Returns the encoder writing files with the specified extension. The
+    extension may be given with or without the leading dot.
+*/
+static CCodec *FindEncoder(const TCHAR *szFileExt)
 {
+    if (szFileExt[0] == '.')
+        szFileExt++;
+
+    for (unsigned int i = 0; i < g_CodecManager.m_Codecs.size(); i++)
+    {
+        CCodec *pCodec = g_CodecManager.m_Codecs[i];
+        if ((pCodec->irc_capabilities() & IRC_HAS_ENCODER) == 0)
+            continue;
+
+        const TCHAR *szCodecExt = pCodec->irc_string(IRC_STR_FILEEXT);
+        if (szCodecExt == NULL)
+            continue;
+
+        if (szCodecExt[0] == '.')
+            szCodecExt++;
+
+        if (!lstrcmpi(szCodecExt,szFileExt))
+            return pCodec;
+    }
+
+    return NULL;
+}
+
+/*
+    RunJob
+    ------
+    Runs an operation without displaying any windows. The syntax is:
+      -job devices
+      -job burnimage -recorder=<address> [-recorder=<address> ...] <image file>
+      -job burnproject -recorder=<address> [-recorder=<address> ...] <project file>
+      -job copydisc -source=<address> -recorder=<address>
+      -job rip [-reader=<address> ...] [-encoder=<file extension>] <target folder>
+    Progress is written to the standard output, see CConsoleProgress. When
+    several recorders are specified the same disc is recorded to all of them
+    at the same time. Discs are ripped in all specified readers, or all
+    devices if none are specified, at the same time.
+*/
+static int RunJob(const TCHAR *szCmdLine)
+{
+    int iNumArgs = 0;
+    LPWSTR *pArgs = CommandLineToArgvW(szCmdLine,&iNumArgs);
+    if (pArgs == NULL)
+        return JOB_EXITCODE_USAGE;
+
+    const TCHAR *szJob = iNumArgs > 0 ? pArgs[0] : _T("");
+    const TCHAR *szFilePath = NULL;
+    ckmmc::Device *pRecorder = NULL;
+    ckmmc::Device *pSource = NULL;
+    std::vector<ckmmc::Device *> Recorders;
+    std::vector<ckmmc::Device *> Readers;
+    bool bUnknownRecorder = false;
+    bool bUnknownReader = false;
+    CCodec *pEncoder = NULL;
+    bool bUnknownEncoder = false;
+
+    CConsoleProgress Progress;
+
+    for (int i = 1; i < iNumArgs; i++)
+    {
+        if (!lstrncmp(pArgs[i],_T("-recorder="),10))
+        {
+            ckmmc::Device *pDevice = FindDevice(pArgs[i] + 10);
+            if (pDevice != NULL)
+                Recorders.push_back(pDevice);
+            else
+                bUnknownRecorder = true;
+        }
+        else if (!lstrncmp(pArgs[i],_T("-source="),8))
+            pSource = FindDevice(pArgs[i] + 8);
+        else if (!lstrncmp(pArgs[i],_T("-reader="),8))
+        {
+            ckmmc::Device *pDevice = FindDevice(pArgs[i] + 8);
+            if (pDevice != NULL)
+                Readers.push_back(pDevice);
+            else
+                bUnknownReader = true;
+        }
+        else if (!lstrncmp(pArgs[i],_T("-encoder="),9))
+        {
+            pEncoder = FindEncoder(pArgs[i] + 9);
+            bUnknownEncoder = pEncoder == NULL;
+        }
+        else
+            szFilePath = pArgs[i];
+    }
+
+    if (Recorders.size() > 0 && !bUnknownRecorder)
+        pRecorder = Recorders[0];
+
+    CJob Job;
+    Progress.AttachProcess(&Job.GetProcess());
+
+    int iResult = JOB_EXITCODE_USAGE;
+    eBurnResult BurnResult = BURNRESULT_INTERNALERROR;
+
+    if (!lstrcmp(szJob,_T("devices")))
+    {
+        std::vector<ckmmc::Device *>::const_iterator it;
+        for (it = g_DeviceManager.devices().begin(); it !=
+            g_DeviceManager.devices().end(); it++)
+        {
+            Progress.Print(_T("device\t%s\t%s\t%s"),
+                NDeviceUtil::GetDeviceAddr(**it).c_str(),
+                NDeviceUtil::GetDeviceName(**it).c_str(),
+                (*it)->recorder() ? _T("recorder") : _T("reader"));
+        }
+
+        iResult = JOB_EXITCODE_OK;
+    }
+    else if (!lstrcmp(szJob,_T("burnimage")) && pRecorder != NULL && szFilePath != NULL)
+    {
+        g_BurnImageSettings.m_pRecorder = pRecorder;
+        BurnResult = Job.BurnImage(Recorders,szFilePath,Progress);
+        iResult = JOB_EXITCODE_FAILED;
+    }
+    else if (!lstrcmp(szJob,_T("burnproject")) && pRecorder != NULL && szFilePath != NULL)
+    {
+        iResult = JOB_EXITCODE_FAILED;
+
+        if (g_ProjectManager.LoadProject(szFilePath))
+        {
+            g_BurnImageSettings.m_pRecorder = pRecorder;
+            BurnResult = Job.BurnProject(Recorders,Progress);
+        }
+    }
+    else if (!lstrcmp(szJob,_T("copydisc")) && pRecorder != NULL && pSource != NULL)
+    {
+        g_CopyDiscSettings.m_pSource = pSource;
+        g_CopyDiscSettings.m_pTarget = pRecorder;
+        BurnResult = Job.CopyDisc(*pSource,*pRecorder,Progress);
+        iResult = JOB_EXITCODE_FAILED;
+    }
+    else if (!lstrcmp(szJob,_T("rip")) && szFilePath != NULL && !bUnknownReader && !bUnknownEncoder)
+    {
+        if (Readers.empty())
+            Readers = g_DeviceManager.devices();
+
+        BurnResult = Job.RipDiscs(Readers,szFilePath,pEncoder,Progress);
+        iResult = JOB_EXITCODE_FAILED;
+    }
+
+    if (iResult == JOB_EXITCODE_FAILED)
+    {
+        if (Progress.cancelled())
+            iResult = JOB_EXITCODE_CANCELLED;
+        else if (BurnResult == BURNRESULT_OK)
+            iResult = JOB_EXITCODE_OK;
+    }
+
+    switch (iResult)
+    {
+        case JOB_EXITCODE_OK:
+            Progress.Print(_T("result\tok"));
+            break;
+
+        case JOB_EXITCODE_FAILED:
+            Progress.Print(_T("result\tfailed"));
+            break;
+
+        case JOB_EXITCODE_USAGE:
+            Progress.Print(_T("result\tusage"));
+            break;
+
+        case JOB_EXITCODE_CANCELLED:
+            Progress.Print(_T("result\tcancelled"));
+            break;
+    }
+
+    LocalFree(pArgs);
+    return iResult;
+}
+
+// Time when the application was started, used for measuring the time until
+// the main window is displayed.
+unsigned long g_ulStartTime = 0;
+
+/*
+    PerformDeviceScan
+    -----------------
+    Scans the devices. If devices were found the last time the application was
+    run, these are presented while the devices are scanned in the background.
+    Otherwise the devices are scanned behind the splash window.
+*/
+void PerformDeviceScan(bool bJobMode)
+{
+    // Don't display anything when running unattended.
+    if (bJobMode)
+    {
+        g_DeviceInventory.Scan(NULL);
+        return;
+    }
+
+    std::vector<CDeviceInventory::CEntry> Entries;
+    if (g_DeviceInventory.Load())
+        g_DeviceInventory.GetEntries(Entries);
+
+    if (Entries.size() > 0 && g_DeviceInventory.StartScan())
+        return;
+
     // Launch the splash window by the safe function because splash screens
     // are not supported on systems older than Windows 2000.
     CSplashWindow SplashWindow;
     SplashWindow.SafeCreate();
 
-    g_DeviceManager.scan(&SplashWindow);
+    g_DeviceInventory.Scan(&SplashWindow);
 
     SplashWindow.SafeDestroy();
 
+    if (g_GlobalSettings.m_bLog)
+    {
+        g_pLogDlg->print_line(_T("  Device scan completed in %u ms."),
+                              g_DeviceInventory.GetScanTime());
+    }
+
     if (g_DeviceManager.devices().size() == 0)
     {
         if (g_GlobalSettings.m_bNoDevWarning)
@@ -170,6 +407,12 @@ int Run(LPTSTR lpstrCmdLine = NULL,int nCmdShow = SW_SHOWDEFAULT)
 
     g_pMainFrame->ShowWindow(g_DynamicSettings.m_bWinMaximized ? SW_SHOWMAXIMIZED : nCmdShow);
 
+    if (g_GlobalSettings.m_bLog)
+    {
+        g_pLogDlg->print_line(_T("  Main window displayed after %u ms."),
+                              ::GetTickCount() - g_ulStartTime);
+    }
+
     int nRet = MainLoop.Run();
         _Module.RemoveMessageLoop();
     return nRet;
@@ -220,6 +463,10 @@ INT_PTR ParseAndRun(LPTSTR lpstrCmdLine,int nCmdShow = SW_SHOWDEFAULT)
             lpstrCmdLine++;
     }
 
+    // All operations except for opening the main window require the devices.
+    if (lpstrCmdLine[0] == '-' && lstrncmp(lpstrCmdLine,_T("-media="),7))
+        g_DeviceInventory.WaitForScan();
+
     // Default media selection.
     if (!lstrncmp(lpstrCmdLine,_T("-media="),7))
     {
@@ -260,6 +507,11 @@ INT_PTR ParseAndRun(LPTSTR lpstrCmdLine,int nCmdShow = SW_SHOWDEFAULT)
     {
         return g_ActionManager.BurnImageEx(NULL,true,lpstrCmdLine + 11);
     }
+    // Unattended operation.
+    else if (!lstrncmp(lpstrCmdLine,_T("-job "),5))
+    {
+        return RunJob(lpstrCmdLine + 5);
+    }
     else if (!lstrncmp(lpstrCmdLine,_T("-burnproject "),13))
     {
         CWaitCursor WaitCursor;		// This displays the hourglass cursor.
@@ -301,7 +553,10 @@ INT_PTR ParseAndRun(LPTSTR lpstrCmdLine,int nCmdShow = SW_SHOWDEFAULT)
                 !lstrcmpi(szFullPath + iDelim,_T(".cue")) ||
                 !lstrcmpi(szFullPath + iDelim,_T(".bin")) ||
                 !lstrcmpi(szFullPath + iDelim,_T(".raw")))
+            {
+                g_DeviceInventory.WaitForScan();
                 return g_ActionManager.BurnImageEx(NULL,true,szFullPath);
+            }
         }
 
         g_pMainFrame->m_bDefaultWizard = false;
@@ -315,6 +570,8 @@ INT_PTR ParseAndRun(LPTSTR lpstrCmdLine,int nCmdShow = SW_SHOWDEFAULT)
 
 int WINAPI _tWinMain(HINSTANCE hInstance,HINSTANCE hPrevInstance,LPTSTR lpstrCmdLine,int nCmdShow)
 {
+    g_ulStartTime = ::GetTickCount();
+
     try
     {
 #ifdef _DEBUG
@@ -363,11 +620,16 @@ int WINAPI _tWinMain(HINSTANCE hInstance,HINSTANCE hPrevInstance,LPTSTR lpstrCmd
             // Create the log dialog.
             LogDlg.Create(HWND_DESKTOP);
 
+            // Remove partial disc images that can no longer be resumed.
+            CCore2Checkpoint::RemoveStale(g_GlobalSettings.m_szTempPath);
+
             // Translate some of the string tables.
             lngTranslateTables();
 
+            g_bJobMode = !lstrncmp(lpstrCmdLine,_T("-job "),5);
+
             // Initialize, SCSI buses etc.
-            PerformDeviceScan();
+            PerformDeviceScan(g_bJobMode);
 
             // Load the codecs.
             TCHAR szCodecPath[MAX_PATH];
@@ -376,9 +638,22 @@ int WINAPI _tWinMain(HINSTANCE hInstance,HINSTANCE hPrevInstance,LPTSTR lpstrCmd
             ExtractFilePath(szCodecPath);
             lstrcat(szCodecPath,_T("codecs\\"));
 
-            if (!g_CodecManager.LoadCodecs(szCodecPath))
+            // The codec manifest allows the plug-ins to be loaded on first use.
+            TCHAR szManifestPath[MAX_PATH];
+            bool bCodecsLoaded = false;
+            if (g_SettingsManager.GetConfigDir(szManifestPath))
+            {
+                lstrcat(szManifestPath,_T("codecs.xml"));
+                bCodecsLoaded = g_CodecManager.LoadCodecs(szCodecPath,szManifestPath);
+            }
+            else
+            {
+                bCodecsLoaded = g_CodecManager.LoadCodecs(szCodecPath);
+            }
+
+            if (!bCodecsLoaded)
             {
-                if (g_GlobalSettings.m_bCodecWarning)
+                if (g_GlobalSettings.m_bCodecWarning && !g_bJobMode)
                 {
                     CInfoDlg InfoDlg(&g_GlobalSettings.m_bCodecWarning,lngGetString(ERROR_LOADCODECS),INFODLG_NOCANCEL | INFODLG_ICONWARNING);
                     InfoDlg.DoModal();
@@ -23,3 +23,6 @@ void ProcessMessages();
 
 extern CCodecManager g_CodecManager;
 extern ckmmc::DeviceManager g_DeviceManager;
+
+// Set when running an unattended job, no windows may then be displayed.
+extern bool g_bJobMode;
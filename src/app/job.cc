@@ -0,0 +1,374 @@
+/*
+ * InfraRecorder - CD/DVD burning software
+ * Copyright (C) 2006-2012 Christian Kindahl
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "stdafx.hh"
+#include <ckcore/file.hh>
+#include <ckfilesystem/fileset.hh>
+#include "settings.hh"
+#include "core2.hh"
+#include "string_table.hh"
+#include "lang_util.hh"
+#include "project_manager.hh"
+#include "tree_manager.hh"
+#include "multi_burn.hh"
+#include "batch_rip.hh"
+#include "job.hh"
+
+CJob::CJob()
+{
+}
+
+CJob::~CJob()
+{
+    RemoveTempTracks();
+}
+
+void CJob::RemoveTempTracks()
+{
+    for (unsigned int i = 0; i < m_TempTracks.size(); i++)
+    {
+        ckcore::File::remove(m_TempTracks[i]);
+        delete [] m_TempTracks[i];
+    }
+
+    m_TempTracks.clear();
+}
+
+/**
+    Verifies the files of a recorded disc against the project files. The
+    media is reloaded first so that the file system is read from the disc.
+    @param Device the recorder containing the disc.
+    @param FilePathMap the file path map returned when creating the disc image.
+    @param bEject if true the disc will be ejected after being verified.
+    @param Progress progress object receiving the status.
+    @return the result of the operation.
+*/
+eBurnResult CJob::VerifyDisc(ckmmc::Device &Device,std::map<tstring,tstring> &FilePathMap,
+                             bool bEject,CAdvancedProgress &Progress)
+{
+    Progress.set_progress(0);
+    Progress.set_status(lngGetString(PROGRESS_RELOADMEDIA));
+
+    g_Core2.StartStopUnit(Device,CCore2::LOADMEDIA_EJECT,false);
+    if (!g_Core2.StartStopUnit(Device,CCore2::LOADMEDIA_LOAD,false))
+        Progress.notify(ckcore::Progress::ckWARNING,lngGetString(FAILURE_NOMEDIA));
+
+    TCHAR szDriveLetter[3];
+    szDriveLetter[0] = Device.address().device_[0];
+    szDriveLetter[1] = ':';
+    szDriveLetter[2] = '\0';
+
+    unsigned __int64 uiFailCount = 0;
+    bool bResult = g_ProjectManager.VerifyCompilation(&Progress,szDriveLetter,FilePathMap,
+                                                      &uiFailCount);
+
+    Progress.set_progress(100);
+
+    if (bEject)
+        g_Core2.StartStopUnit(Device,CCore2::LOADMEDIA_EJECT,false);
+
+    return bResult && uiFailCount == 0 ? BURNRESULT_OK : BURNRESULT_EXTERNALERROR;
+}
+
+/**
+    Returns the process used for running cdrtools. Killing this process
+    cancels the current operation.
+*/
+ckcore::Process &CJob::GetProcess()
+{
+    return m_Core;
+}
+
+/**
+    Records a disc image. If a TOC file with the same name as the image
+    exists (plus the .toc extension) the image is recorded in clone mode.
+    @param Device the recorder to use.
+    @param szFilePath full path to the disc image.
+    @param Progress progress object receiving the status.
+    @return the result of the operation.
+*/
+eBurnResult CJob::BurnImage(ckmmc::Device &Device,const TCHAR *szFilePath,
+                            CAdvancedProgress &Progress)
+{
+    ckcore::tstring TocPath = szFilePath;
+    TocPath += ckT(".toc");
+
+    bool bImageHasTOC = ckcore::File::exist(TocPath.c_str());
+
+    Progress.set_status(lngGetString(PROGRESS_INIT));
+
+    if (!m_Core.BurnImageEx(Device,&Progress,szFilePath,bImageHasTOC))
+        return BURNRESULT_INTERNALERROR;
+
+    ckcore::tuint32 uiExitCode = 0;
+    m_Core.exit_code(uiExitCode);
+
+    return uiExitCode == 0 ? BURNRESULT_OK : BURNRESULT_EXTERNALERROR;
+}
+
+/**
+    Records a disc image to several recorders at the same time. The image is
+    only read once. Clone images can only be recorded to one recorder.
+    @param Devices the recorders to use.
+    @param szFilePath full path to the disc image.
+    @param Progress progress object receiving the status.
+    @return the result of the operation.
+*/
+eBurnResult CJob::BurnImage(const std::vector<ckmmc::Device *> &Devices,
+                            const TCHAR *szFilePath,CAdvancedProgress &Progress)
+{
+    if (Devices.size() == 1)
+        return BurnImage(*Devices[0],szFilePath,Progress);
+
+    ckcore::tstring TocPath = szFilePath;
+    TocPath += ckT(".toc");
+
+    if (ckcore::File::exist(TocPath.c_str()))
+    {
+        Progress.notify(ckcore::Progress::ckERROR,lngGetString(ERROR_MULTIBURNCLONE));
+        return BURNRESULT_INTERNALERROR;
+    }
+
+    Progress.set_status(lngGetString(PROGRESS_INIT));
+
+    std::vector<TCHAR *> AudioTracks;
+
+    CMultiBurn MultiBurn(Devices,Progress);
+    return MultiBurn.BurnTracks(szFilePath,AudioTracks,NULL,0);
+}
+
+/**
+    Records the currently loaded project. Data is written through a temporary
+    disc image, unless several recorders are specified and on-the-fly
+    recording is enabled. In that case the file system is created once and
+    written directly to all recorders. Otherwise, when several recorders are
+    specified the image is read once and written to all of them at the same
+    time. The discs are then verified, in parallel when there are several, if
+    verification is enabled.
+    @param Devices the recorders to use.
+    @param Progress progress object receiving the status.
+    @return the result of the operation.
+*/
+eBurnResult CJob::BurnProject(const std::vector<ckmmc::Device *> &Devices,
+                              CAdvancedProgress &Progress)
+{
+    bool bMultiBurn = Devices.size() > 1;
+    bool bVerify = g_BurnImageSettings.m_bVerify;
+
+    int iProjectType = g_ProjectManager.GetProjectType();
+    bool bDataTrack = iProjectType == PROJECTTYPE_DATA || iProjectType == PROJECTTYPE_MIXED;
+    bool bOnFly = bMultiBurn && bDataTrack && g_BurnImageSettings.m_bOnFly;
+
+    ckfilesystem::FileSet Files(g_ProjectSettings.m_iFileSystem == FILESYSTEM_DVDVIDEO);
+    switch (iProjectType)
+    {
+        case PROJECTTYPE_DATA:
+            g_TreeManager.GetPathList(Files,g_TreeManager.GetRootNode());
+            break;
+
+        case PROJECTTYPE_MIXED:
+            g_TreeManager.GetPathList(Files,g_ProjectManager.GetMixDataRootNode(),
+                lstrlen(g_ProjectManager.GetMixDataRootNode()->pItemData->GetFileName()) + 1);
+            break;
+    }
+
+    ckcore::File ImageFile = ckcore::File::temp(g_GlobalSettings.m_szTempPath,
+                                                ckT("InfraRecorder"));
+    const TCHAR *szDataTrack = NULL;
+
+    // Used for locating the files on the disc when verifying.
+    std::map<tstring,tstring> FilePathMap;
+
+    // Size of the file system when recording on the fly.
+    unsigned __int64 uiDataBytes = 0;
+
+    eBurnResult Result = BURNRESULT_OK;
+    if (bOnFly)
+    {
+        Progress.set_status(lngGetString(PROGRESS_ESTIMAGESIZE));
+
+        if (g_Core2.EstimateImageSize(Files,Progress,uiDataBytes) != RESULT_OK)
+        {
+            Progress.notify(ckcore::Progress::ckERROR,lngGetString(ERROR_ESTIMAGESIZE));
+            Result = BURNRESULT_INTERNALERROR;
+        }
+    }
+    else if (bDataTrack)
+    {
+        Progress.set_status(lngGetString(STATUS_WRITEIMAGE));
+        Progress.notify(ckcore::Progress::ckINFORMATION,lngGetString(PROGRESS_BEGINDISCIMAGE));
+
+        switch (g_Core2.CreateImage(ImageFile.name().c_str(),Files,Progress,true,
+                                    bVerify ? &FilePathMap : NULL))
+        {
+            case RESULT_OK:
+                Progress.notify(ckcore::Progress::ckINFORMATION,lngGetString(SUCCESS_CREATEIMAGE));
+                szDataTrack = ImageFile.name().c_str();
+                break;
+
+            default:
+                Progress.notify(ckcore::Progress::ckERROR,lngGetString(FAILURE_CREATEIMAGE));
+                Result = BURNRESULT_INTERNALERROR;
+                break;
+        }
+    }
+
+    // Decode the audio tracks and save the CD-Text information.
+    std::vector<TCHAR *> AudioTracks;
+    ckcore::File AudioTextFile = ckcore::File::temp(g_GlobalSettings.m_szTempPath,
+                                                    ckT("InfraRecorder"));
+    const TCHAR *szAudioText = NULL;
+
+    if (Result == BURNRESULT_OK &&
+        (iProjectType == PROJECTTYPE_AUDIO || iProjectType == PROJECTTYPE_MIXED))
+    {
+        g_ProjectManager.GetAudioTracks(AudioTracks);
+
+        Progress.set_status(lngGetString(PROGRESS_DECODETRACKS));
+        if (!g_ProjectManager.DecodeAudioTracks(AudioTracks,m_TempTracks,&Progress))
+            Result = BURNRESULT_INTERNALERROR;
+
+        CProjectNode *pAudioNode = iProjectType == PROJECTTYPE_AUDIO ?
+            g_TreeManager.GetRootNode() : g_ProjectManager.GetMixAudioRootNode();
+
+        if (Result == BURNRESULT_OK && AudioTracks.size() > 0 &&
+            g_TreeManager.HasExtraAudioData(pAudioNode))
+        {
+            if (g_ProjectManager.SaveCDText(AudioTextFile.name().c_str()))
+                szAudioText = AudioTextFile.name().c_str();
+            else
+                Progress.notify(ckcore::Progress::ckWARNING,lngGetString(FAILURE_CREATECDTEXT));
+        }
+    }
+
+    if (Result == BURNRESULT_OK && !bMultiBurn)
+    {
+        Progress.set_progress(0);
+        Progress.set_status(lngGetString(PROGRESS_INIT));
+
+        // Make sure that the disc will not be ejected before being verified.
+        bool bEject = g_BurnImageSettings.m_bEject;
+        if (bVerify)
+            g_BurnImageSettings.m_bEject = false;
+
+        Result = m_Core.BurnTracksEx(*Devices[0],&Progress,szDataTrack,AudioTracks,szAudioText,
+            szDataTrack != NULL ? g_ProjectSettings.m_iIsoFormat : 0);
+
+        g_BurnImageSettings.m_bEject = bEject;
+
+        if (bVerify && szDataTrack != NULL && Result == BURNRESULT_OK)
+            Result = VerifyDisc(*Devices[0],FilePathMap,bEject,Progress);
+    }
+    else if (Result == BURNRESULT_OK)
+    {
+        Progress.set_progress(0);
+        Progress.set_status(lngGetString(PROGRESS_INIT));
+
+        // Make sure that the discs will not be ejected before being verified.
+        bool bEject = g_BurnImageSettings.m_bEject;
+        if (bVerify)
+            g_BurnImageSettings.m_bEject = false;
+
+        CMultiBurn MultiBurn(Devices,Progress);
+        if (bOnFly)
+        {
+            Result = MultiBurn.BurnCompilation(Files,uiDataBytes,AudioTracks,szAudioText,
+                g_ProjectSettings.m_iIsoFormat,bVerify ? &FilePathMap : NULL);
+        }
+        else
+        {
+            Result = MultiBurn.BurnTracks(szDataTrack,AudioTracks,szAudioText,
+                szDataTrack != NULL ? g_ProjectSettings.m_iIsoFormat : 0);
+        }
+
+        g_BurnImageSettings.m_bEject = bEject;
+
+        if (bVerify && (szDataTrack != NULL || bOnFly) && Result != BURNRESULT_INTERNALERROR)
+            Result = MultiBurn.Verify(FilePathMap,bEject);
+    }
+
+    ckfilesystem::destroy_file_set(Files);
+
+    // Remove temporary files.
+    ImageFile.remove();
+    AudioTextFile.remove();
+    RemoveTempTracks();
+
+    return Result;
+}
+
+/**
+    Copies a disc through a temporary disc image. The source and target
+    devices must differ since nobody is around to switch the discs.
+    @param SrcDevice the device containing the disc to copy.
+    @param DstDevice the recorder to write the copy with.
+    @param Progress progress object receiving the status.
+    @return the result of the operation.
+*/
+eBurnResult CJob::CopyDisc(ckmmc::Device &SrcDevice,ckmmc::Device &DstDevice,
+                           CAdvancedProgress &Progress)
+{
+    if (&SrcDevice == &DstDevice)
+    {
+        Progress.notify(ckcore::Progress::ckERROR,lngGetString(ERROR_COPYSAMEDEVICE));
+        return BURNRESULT_INTERNALERROR;
+    }
+
+    ckcore::File ImageFile = ckcore::File::temp(g_GlobalSettings.m_szTempPath,
+                                                ckT("InfraRecorder"));
+    ckcore::tstring TocPath = ImageFile.name();
+    TocPath += ckT(".toc");
+
+    g_ReadSettings.m_bClone = g_CopyDiscSettings.m_bClone;
+
+    Progress.set_status(lngGetString(PROGRESS_INIT));
+
+    eBurnResult Result = m_Core.ReadDiscEx(SrcDevice,&Progress,ImageFile.name().c_str());
+    if (Result == BURNRESULT_OK)
+    {
+        Progress.set_progress(0);
+        Progress.set_status(lngGetString(PROGRESS_INIT));
+
+        Result = BurnImage(DstDevice,ImageFile.name().c_str(),Progress);
+    }
+
+    // Remove any temporary files.
+    ImageFile.remove();
+    ckcore::File::remove(TocPath.c_str());
+
+    return Result;
+}
+
+/**
+    Rips audio discs to a library folder using several readers at the same
+    time. Each reader rips one disc after the other until no new disc is
+    inserted, an interrupted batch continues where it stopped.
+    @param Devices the readers to use.
+    @param szTargetPath full path to the library folder.
+    @param pEncoder encoder used for the ripped tracks, may be NULL.
+    @param Progress progress object receiving the status.
+    @return the result of the operation.
+*/
+eBurnResult CJob::RipDiscs(const std::vector<ckmmc::Device *> &Devices,const TCHAR *szTargetPath,
+                           CCodec *pEncoder,CAdvancedProgress &Progress)
+{
+    Progress.set_status(lngGetString(PROGRESS_INIT));
+
+    CBatchRip BatchRip(Devices,szTargetPath,pEncoder,Progress);
+    return BatchRip.Run();
+}
@@ -0,0 +1,59 @@
+/*
+ * InfraRecorder - CD/DVD burning software
+ * Copyright (C) 2006-2012 Christian Kindahl
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#include <vector>
+#include <map>
+#include <ckmmc/device.hh>
+#include <base/codec_manager.hh>
+#include "core.hh"
+#include "advanced_progress.hh"
+
+// Runs recording operations without any user interface. All results are
+// reported through the progress object, no message boxes are displayed.
+// Each job owns its own cdrtools process so jobs targeting different
+// recorders can run at the same time. Jobs given several recorders write the
+// same disc to all of them at once, jobs given several readers rip discs in
+// all of them at once.
+class CJob
+{
+private:
+    CCore m_Core;
+    std::vector<TCHAR *> m_TempTracks;
+
+    void RemoveTempTracks();
+    eBurnResult VerifyDisc(ckmmc::Device &Device,std::map<tstring,tstring> &FilePathMap,
+        bool bEject,CAdvancedProgress &Progress);
+
+public:
+    CJob();
+    ~CJob();
+
+    ckcore::Process &GetProcess();
+
+    eBurnResult BurnImage(ckmmc::Device &Device,const TCHAR *szFilePath,
+        CAdvancedProgress &Progress);
+    eBurnResult BurnImage(const std::vector<ckmmc::Device *> &Devices,
+        const TCHAR *szFilePath,CAdvancedProgress &Progress);
+    eBurnResult BurnProject(const std::vector<ckmmc::Device *> &Devices,
+        CAdvancedProgress &Progress);
+    eBurnResult CopyDisc(ckmmc::Device &SrcDevice,ckmmc::Device &DstDevice,
+        CAdvancedProgress &Progress);
+    eBurnResult RipDiscs(const std::vector<ckmmc::Device *> &Devices,const TCHAR *szTargetPath,
+        CCodec *pEncoder,CAdvancedProgress &Progress);
+};
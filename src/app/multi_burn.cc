@@ -0,0 +1,852 @@
+/*
+ * InfraRecorder - CD/DVD burning software
+ * Copyright (C) 2006-2012 Christian Kindahl
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "stdafx.hh"
+#include <ckcore/filestream.hh>
+#include "settings.hh"
+#include "core2.hh"
+#include "pipe_buffer.hh"
+#include "string_table.hh"
+#include "lang_util.hh"
+#include "device_util.hh"
+#include "project_manager.hh"
+#include "multi_burn.hh"
+
+CMultiBurn::CBlock::CBlock(const void *pData,ckcore::tuint32 uiSize) :
+    m_lRefCount(1),m_uiSize(uiSize)
+{
+    m_pData = new unsigned char[uiSize];
+    memcpy(m_pData,pData,uiSize);
+}
+
+CMultiBurn::CBlock::~CBlock()
+{
+    delete [] m_pData;
+}
+
+void CMultiBurn::CBlock::AddRef()
+{
+    ::InterlockedIncrement(&m_lRefCount);
+}
+
+void CMultiBurn::CBlock::Release()
+{
+    if (::InterlockedDecrement(&m_lRefCount) == 0)
+        delete this;
+}
+
+CMultiBurn::CTarget::CTarget(CMultiBurn &Owner,ckmmc::Device &Device) :
+    m_Owner(Owner),m_Device(Device),m_DeviceName(NDeviceUtil::GetDeviceName(Device)),
+    m_ucPercent(0),m_iBuffer(100),m_uiErrorCount(0),m_bLaunched(false),
+    m_bDropped(false),m_Result(BURNRESULT_INTERNALERROR),m_hWriterThread(NULL),
+    m_bClosed(false),m_bStopped(false),m_ulLastWrite(0)
+{
+    ::InitializeCriticalSection(&m_csQueue);
+
+    m_hDataEvent = ::CreateEvent(NULL,FALSE,FALSE,NULL);
+    m_hSpaceEvent = ::CreateEvent(NULL,FALSE,FALSE,NULL);
+}
+
+CMultiBurn::CTarget::~CTarget()
+{
+    CloseWriter();
+
+    ::CloseHandle(m_hSpaceEvent);
+    ::CloseHandle(m_hDataEvent);
+
+    ::DeleteCriticalSection(&m_csQueue);
+}
+
+/*
+    CMultiBurn::CTarget::WriterThread
+    ---------------------------------
+    Writes the queued blocks to the process until the queue has been closed
+    and is empty. Once a write has failed the remaining blocks are discarded.
+*/
+DWORD WINAPI CMultiBurn::CTarget::WriterThread(LPVOID lpThreadParameter)
+{
+    CTarget *pTarget = (CTarget *)lpThreadParameter;
+
+    for (;;)
+    {
+        CBlock *pBlock = NULL;
+
+        ::EnterCriticalSection(&pTarget->m_csQueue);
+        bool bClosed = pTarget->m_bClosed;
+        if (!pTarget->m_Queue.empty())
+        {
+            pBlock = pTarget->m_Queue.front();
+            pTarget->m_Queue.pop_front();
+        }
+        ::LeaveCriticalSection(&pTarget->m_csQueue);
+
+        if (pBlock == NULL)
+        {
+            if (bClosed)
+                break;
+
+            ::WaitForSingleObject(pTarget->m_hDataEvent,MULTIBURN_POLL_INTERVAL);
+            continue;
+        }
+
+        ::SetEvent(pTarget->m_hSpaceEvent);
+
+        if (!pTarget->m_bStopped && !pTarget->m_bDropped)
+        {
+            if (pTarget->m_Core.write(pBlock->m_pData,pBlock->m_uiSize) != (ckcore::tint64)pBlock->m_uiSize)
+            {
+                pTarget->m_bStopped = true;
+
+                // All processes are killed when cancelled.
+                if (!pTarget->m_Owner.m_Progress.cancelled())
+                    pTarget->m_Owner.Drop(pTarget);
+            }
+            else
+            {
+                pTarget->m_ulLastWrite = ::GetTickCount();
+            }
+        }
+
+        pBlock->Release();
+    }
+
+    return 0;
+}
+
+bool CMultiBurn::CTarget::StartWriter()
+{
+    m_bClosed = false;
+    m_bStopped = false;
+    m_ulLastWrite = ::GetTickCount();
+
+    unsigned long ulThreadID = 0;
+    m_hWriterThread = ::CreateThread(NULL,0,WriterThread,this,0,&ulThreadID);
+
+    return m_hWriterThread != NULL;
+}
+
+/*
+    CMultiBurn::CTarget::CloseWriter
+    --------------------------------
+    Tells the writer thread that no more blocks will be queued and waits for
+    it to write the remaining blocks. The recorder is dropped if it stops
+    accepting data while doing so.
+*/
+void CMultiBurn::CTarget::CloseWriter()
+{
+    if (m_hWriterThread == NULL)
+        return;
+
+    ::EnterCriticalSection(&m_csQueue);
+    m_bClosed = true;
+    ::LeaveCriticalSection(&m_csQueue);
+
+    ::SetEvent(m_hDataEvent);
+
+    while (::WaitForSingleObject(m_hWriterThread,MULTIBURN_POLL_INTERVAL) == WAIT_TIMEOUT)
+    {
+        if (m_Owner.m_Progress.cancelled())
+            m_Owner.Cancel();
+        else if (IsStalled())
+            m_Owner.DropStalled(this);
+    }
+
+    ::CloseHandle(m_hWriterThread);
+    m_hWriterThread = NULL;
+}
+
+void CMultiBurn::CTarget::Enqueue(CBlock *pBlock)
+{
+    pBlock->AddRef();
+
+    ::EnterCriticalSection(&m_csQueue);
+    m_Queue.push_back(pBlock);
+    ::LeaveCriticalSection(&m_csQueue);
+
+    ::SetEvent(m_hDataEvent);
+}
+
+unsigned int CMultiBurn::CTarget::GetQueueSize()
+{
+    ::EnterCriticalSection(&m_csQueue);
+    unsigned int uiSize = (unsigned int)m_Queue.size();
+    ::LeaveCriticalSection(&m_csQueue);
+
+    return uiSize;
+}
+
+/*
+    CMultiBurn::CTarget::IsStalled
+    ------------------------------
+    Returns true if the process has not accepted any data for too long while
+    there is data waiting to be written.
+*/
+bool CMultiBurn::CTarget::IsStalled()
+{
+    if (m_bDropped || m_bStopped)
+        return false;
+
+    return ::GetTickCount() - m_ulLastWrite > MULTIBURN_STALL_TIMEOUT;
+}
+
+void CMultiBurn::CTarget::set_progress(unsigned char ucPercent)
+{
+    m_ucPercent = ucPercent > 100 ? 100 : ucPercent;
+    m_Owner.UpdateProgress();
+}
+
+void CMultiBurn::CTarget::set_marquee(bool bMarquee)
+{
+    m_Owner.m_Progress.set_marquee(bMarquee);
+}
+
+void CMultiBurn::CTarget::set_status(const TCHAR *szStatus,...)
+{
+    TCHAR szStringBuffer[PROGRESS_STRINGBUFFER_SIZE];
+
+    va_list args;
+    va_start(args,szStatus);
+
+    _vsnwprintf(szStringBuffer,PROGRESS_STRINGBUFFER_SIZE - 1,szStatus,args);
+    szStringBuffer[PROGRESS_STRINGBUFFER_SIZE - 1] = '\0';
+
+    va_end(args);
+
+    m_Owner.m_Progress.set_status(_T("%s: %s"),m_DeviceName.c_str(),szStringBuffer);
+}
+
+void CMultiBurn::CTarget::notify(ckcore::Progress::MessageType Type,const TCHAR *szMessage,...)
+{
+    TCHAR szStringBuffer[PROGRESS_STRINGBUFFER_SIZE];
+
+    va_list args;
+    va_start(args,szMessage);
+
+    _vsnwprintf(szStringBuffer,PROGRESS_STRINGBUFFER_SIZE - 1,szMessage,args);
+    szStringBuffer[PROGRESS_STRINGBUFFER_SIZE - 1] = '\0';
+
+    va_end(args);
+
+    if (Type == ckcore::Progress::ckERROR)
+        m_uiErrorCount++;
+
+    m_Owner.m_Progress.notify(Type,_T("%s: %s"),m_DeviceName.c_str(),szStringBuffer);
+}
+
+bool CMultiBurn::CTarget::cancelled()
+{
+    return m_Owner.m_Progress.cancelled();
+}
+
+/*
+    CMultiBurn::CTarget::NotifyCompleted
+    ------------------------------------
+    The operation is completed when all recorders are done, this is reported
+    by the owner.
+*/
+void CMultiBurn::CTarget::NotifyCompleted()
+{
+}
+
+void CMultiBurn::CTarget::SetRealMode(bool bRealMode)
+{
+    m_Owner.m_Progress.SetRealMode(bRealMode);
+}
+
+void CMultiBurn::CTarget::SetBuffer(int iPercent)
+{
+    m_iBuffer = iPercent;
+    m_Owner.UpdateBuffer();
+}
+
+void CMultiBurn::CTarget::AllowReload()
+{
+    m_Owner.m_Progress.AllowReload();
+}
+
+void CMultiBurn::CTarget::AllowCancel(bool bAllow)
+{
+    m_Owner.m_Progress.AllowCancel(bAllow);
+}
+
+/*
+    CMultiBurn::CTarget::RequestNextDisc
+    ------------------------------------
+    Copies are made by adding recorders to the operation, never by relaunching
+    the process of one recorder.
+*/
+bool CMultiBurn::CTarget::RequestNextDisc()
+{
+    return false;
+}
+
+void CMultiBurn::CTarget::StartSmoke()
+{
+    m_Owner.m_Progress.StartSmoke();
+}
+
+/*
+    CMultiBurn::CFanOutStream::CFanOutStream
+    ----------------------------------------
+    Starts the writer threads of all launched recorders.
+*/
+CMultiBurn::CFanOutStream::CFanOutStream(CMultiBurn &Owner) :
+    m_Owner(Owner),m_bClosed(false)
+{
+    std::vector<CTarget *>::iterator it;
+    for (it = m_Owner.m_Targets.begin(); it != m_Owner.m_Targets.end(); it++)
+    {
+        CTarget *pTarget = *it;
+        if (pTarget->m_bLaunched && !pTarget->m_bDropped && !pTarget->StartWriter())
+            m_Owner.Drop(pTarget);
+    }
+}
+
+CMultiBurn::CFanOutStream::~CFanOutStream()
+{
+    Close();
+}
+
+/*
+    CMultiBurn::CFanOutStream::Close
+    --------------------------------
+    Waits until all queued blocks have been written to the recorders.
+*/
+void CMultiBurn::CFanOutStream::Close()
+{
+    if (m_bClosed)
+        return;
+
+    m_bClosed = true;
+
+    std::vector<CTarget *>::iterator it;
+    for (it = m_Owner.m_Targets.begin(); it != m_Owner.m_Targets.end(); it++)
+        (*it)->CloseWriter();
+}
+
+/*
+    CMultiBurn::CFanOutStream::write
+    --------------------------------
+    Queues the block for all recorders still taking part in the operation.
+    When the queue of a recorder is full the function waits for it to make
+    room, a recorder which does not accept any data for too long is dropped.
+    The write fails when the operation has been cancelled or no recorders are
+    left.
+*/
+ckcore::tint64 CMultiBurn::CFanOutStream::write(const void *pBuffer,ckcore::tuint32 uiCount)
+{
+    std::vector<CTarget *>::iterator it;
+    for (it = m_Owner.m_Targets.begin(); it != m_Owner.m_Targets.end(); it++)
+    {
+        CTarget *pTarget = *it;
+        if (pTarget->m_hWriterThread == NULL)
+            continue;
+
+        while (!pTarget->m_bDropped && !pTarget->m_bStopped &&
+            pTarget->GetQueueSize() >= MULTIBURN_QUEUE_SIZE)
+        {
+            if (m_Owner.m_Progress.cancelled())
+            {
+                m_Owner.Cancel();
+                return -1;
+            }
+
+            if (pTarget->IsStalled())
+            {
+                m_Owner.DropStalled(pTarget);
+                break;
+            }
+
+            ::WaitForSingleObject(pTarget->m_hSpaceEvent,MULTIBURN_POLL_INTERVAL);
+        }
+    }
+
+    if (m_Owner.m_Progress.cancelled())
+    {
+        m_Owner.Cancel();
+        return -1;
+    }
+
+    bool bQueued = false;
+
+    CBlock *pBlock = new CBlock(pBuffer,uiCount);
+
+    for (it = m_Owner.m_Targets.begin(); it != m_Owner.m_Targets.end(); it++)
+    {
+        CTarget *pTarget = *it;
+        if (pTarget->m_hWriterThread == NULL || pTarget->m_bDropped || pTarget->m_bStopped)
+            continue;
+
+        pTarget->Enqueue(pBlock);
+        bQueued = true;
+    }
+
+    pBlock->Release();
+
+    return bQueued ? (ckcore::tint64)uiCount : -1;
+}
+
+CMultiBurn::CSourceProgress::CSourceProgress(CAdvancedProgress &Progress) :
+    m_Progress(Progress)
+{
+}
+
+void CMultiBurn::CSourceProgress::set_progress(unsigned char ucPercent)
+{
+}
+
+void CMultiBurn::CSourceProgress::set_marquee(bool bMarquee)
+{
+}
+
+void CMultiBurn::CSourceProgress::set_status(const TCHAR *szStatus,...)
+{
+}
+
+void CMultiBurn::CSourceProgress::notify(ckcore::Progress::MessageType Type,const TCHAR *szMessage,...)
+{
+    TCHAR szStringBuffer[PROGRESS_STRINGBUFFER_SIZE];
+
+    va_list args;
+    va_start(args,szMessage);
+
+    _vsnwprintf(szStringBuffer,PROGRESS_STRINGBUFFER_SIZE - 1,szMessage,args);
+    szStringBuffer[PROGRESS_STRINGBUFFER_SIZE - 1] = '\0';
+
+    va_end(args);
+
+    m_Progress.notify(Type,_T("%s"),szStringBuffer);
+}
+
+bool CMultiBurn::CSourceProgress::cancelled()
+{
+    return m_Progress.cancelled();
+}
+
+/**
+    @param Devices the recorders to write to.
+    @param Progress progress object receiving the status of all recorders.
+*/
+CMultiBurn::CMultiBurn(const std::vector<ckmmc::Device *> &Devices,CAdvancedProgress &Progress) :
+    m_Progress(Progress),m_pFilePathMap(NULL),m_bEject(false)
+{
+    ::InitializeCriticalSection(&m_csProgress);
+
+    std::vector<ckmmc::Device *>::const_iterator it;
+    for (it = Devices.begin(); it != Devices.end(); it++)
+        m_Targets.push_back(new CTarget(*this,**it));
+}
+
+CMultiBurn::~CMultiBurn()
+{
+    std::vector<CTarget *>::iterator it;
+    for (it = m_Targets.begin(); it != m_Targets.end(); it++)
+        delete *it;
+
+    m_Targets.clear();
+
+    ::DeleteCriticalSection(&m_csProgress);
+}
+
+/*
+    CMultiBurn::Drop
+    ----------------
+    Excludes a recorder from the rest of the operation. The other recorders
+    are not affected.
+*/
+void CMultiBurn::Drop(CTarget *pTarget)
+{
+    // Recorders are dropped by the writer threads as well as by the thread
+    // producing the data.
+    ::EnterCriticalSection(&m_csProgress);
+    if (pTarget->m_bDropped)
+    {
+        ::LeaveCriticalSection(&m_csProgress);
+        return;
+    }
+
+    pTarget->m_bDropped = true;
+    pTarget->m_Result = BURNRESULT_EXTERNALERROR;
+    ::LeaveCriticalSection(&m_csProgress);
+
+    pTarget->notify(ckcore::Progress::ckERROR,lngGetString(ERROR_TARGETDROPPED));
+    pTarget->m_Core.kill();
+
+    UpdateProgress();
+    UpdateBuffer();
+}
+
+/*
+    CMultiBurn::DropStalled
+    -----------------------
+    Drops a recorder which has stopped accepting data. Killing its process
+    also releases its writer thread if it's blocked writing to the process.
+*/
+void CMultiBurn::DropStalled(CTarget *pTarget)
+{
+    pTarget->notify(ckcore::Progress::ckWARNING,lngGetString(WARNING_TARGETSTALLED),
+        MULTIBURN_STALL_TIMEOUT / 1000);
+
+    Drop(pTarget);
+}
+
+/*
+    CMultiBurn::UpdateProgress
+    --------------------------
+    Reports the average progress of the recorders still taking part in the
+    operation.
+*/
+void CMultiBurn::UpdateProgress()
+{
+    ::EnterCriticalSection(&m_csProgress);
+
+    unsigned int uiTotal = 0,uiCount = 0;
+
+    std::vector<CTarget *>::const_iterator it;
+    for (it = m_Targets.begin(); it != m_Targets.end(); it++)
+    {
+        if ((*it)->m_bDropped)
+            continue;
+
+        uiTotal += (*it)->m_ucPercent;
+        uiCount++;
+    }
+
+    if (uiCount > 0)
+        m_Progress.set_progress((unsigned char)(uiTotal / uiCount));
+
+    ::LeaveCriticalSection(&m_csProgress);
+}
+
+/*
+    CMultiBurn::UpdateBuffer
+    ------------------------
+    Reports the lowest buffer level of the recorders still taking part in the
+    operation since that recorder is the one closest to a buffer underrun.
+*/
+void CMultiBurn::UpdateBuffer()
+{
+    ::EnterCriticalSection(&m_csProgress);
+
+    int iBuffer = 100;
+
+    std::vector<CTarget *>::const_iterator it;
+    for (it = m_Targets.begin(); it != m_Targets.end(); it++)
+    {
+        if (!(*it)->m_bDropped && (*it)->m_iBuffer < iBuffer)
+            iBuffer = (*it)->m_iBuffer;
+    }
+
+    m_Progress.SetBuffer(iBuffer);
+
+    ::LeaveCriticalSection(&m_csProgress);
+}
+
+unsigned int CMultiBurn::GetSucceededCount() const
+{
+    unsigned int uiSucceeded = 0;
+
+    std::vector<CTarget *>::const_iterator it;
+    for (it = m_Targets.begin(); it != m_Targets.end(); it++)
+    {
+        if ((*it)->m_Result == BURNRESULT_OK)
+            uiSucceeded++;
+    }
+
+    return uiSucceeded;
+}
+
+/*
+    CMultiBurn::GetOverallResult
+    ----------------------------
+    The operation succeeds if all recorders succeeded. If only some of them
+    succeeded an external error is reported.
+*/
+eBurnResult CMultiBurn::GetOverallResult() const
+{
+    unsigned int uiSucceeded = GetSucceededCount();
+    if (uiSucceeded == m_Targets.size())
+        return BURNRESULT_OK;
+
+    return uiSucceeded > 0 ? BURNRESULT_EXTERNALERROR : BURNRESULT_INTERNALERROR;
+}
+
+/*
+    CMultiBurn::Launch
+    ------------------
+    Launches one cdrtools process for each recorder. Returns true if at least
+    one of the processes could be launched.
+*/
+bool CMultiBurn::Launch(std::vector<TCHAR *> &AudioTracks,const TCHAR *szAudioText,
+                        int iDataMode,unsigned __int64 uiDataBytes)
+{
+    bool bLaunched = false;
+
+    std::vector<CTarget *>::iterator it;
+    for (it = m_Targets.begin(); it != m_Targets.end(); it++)
+    {
+        CTarget *pTarget = *it;
+        pTarget->m_ucPercent = 0;
+        pTarget->m_uiErrorCount = 0;
+        pTarget->m_bDropped = false;
+
+        pTarget->m_bLaunched = pTarget->m_Core.BurnCompilationStream(pTarget->m_Device,
+            pTarget,AudioTracks,szAudioText,iDataMode,uiDataBytes);
+
+        if (pTarget->m_bLaunched)
+        {
+            bLaunched = true;
+        }
+        else
+        {
+            pTarget->m_bDropped = true;
+            pTarget->m_Result = BURNRESULT_INTERNALERROR;
+        }
+    }
+
+    return bLaunched;
+}
+
+/*
+    CMultiBurn::Finish
+    ------------------
+    Waits for all processes to exit and collects the result of each recorder.
+*/
+eBurnResult CMultiBurn::Finish()
+{
+    std::vector<CTarget *>::iterator it;
+    for (it = m_Targets.begin(); it != m_Targets.end(); it++)
+    {
+        CTarget *pTarget = *it;
+        if (!pTarget->m_bLaunched)
+            continue;
+
+        while (pTarget->m_Core.running())
+        {
+            if (m_Progress.cancelled())
+                Cancel();
+
+            ::Sleep(MULTIBURN_POLL_INTERVAL);
+        }
+
+        pTarget->m_Core.wait();
+
+        if (pTarget->m_bDropped)
+            continue;
+
+        ckcore::tuint32 uiExitCode = 0;
+        pTarget->m_Core.exit_code(uiExitCode);
+
+        pTarget->m_Result = uiExitCode == 0 && !m_Progress.cancelled() ?
+            BURNRESULT_OK : BURNRESULT_EXTERNALERROR;
+
+        // The process resets the progress when done.
+        pTarget->m_ucPercent = 100;
+    }
+
+    UpdateProgress();
+    m_Progress.notify(ckcore::Progress::ckINFORMATION,lngGetString(INFO_TARGETSRECORDED),
+        GetSucceededCount(),GetTargetCount());
+
+    return GetOverallResult();
+}
+
+/*
+    CMultiBurn::Cancel
+    ------------------
+    Stops all recorders.
+*/
+void CMultiBurn::Cancel()
+{
+    std::vector<CTarget *>::iterator it;
+    for (it = m_Targets.begin(); it != m_Targets.end(); it++)
+    {
+        if ((*it)->m_bLaunched)
+            (*it)->m_Core.kill();
+    }
+}
+
+/**
+    Records a data track and/or audio tracks to all recorders. The data track
+    file is read once and written to all recorders at the same time.
+    @param szDataTrack full path to the data track, may be NULL.
+    @param AudioTracks the audio tracks to record after the data track.
+    @param szAudioText full path to the CD-Text file, may be NULL.
+    @param iDataMode the data mode of the data track.
+    @return the result of the operation.
+*/
+eBurnResult CMultiBurn::BurnTracks(const TCHAR *szDataTrack,std::vector<TCHAR *> &AudioTracks,
+                                   const TCHAR *szAudioText,int iDataMode)
+{
+    if (szDataTrack == NULL)
+    {
+        if (!Launch(AudioTracks,szAudioText,iDataMode,0))
+            return BURNRESULT_INTERNALERROR;
+
+        return Finish();
+    }
+
+    ckcore::FileInStream InStream(szDataTrack);
+    if (!InStream.open())
+    {
+        m_Progress.notify(ckcore::Progress::ckERROR,_T("%s %s"),
+            lngGetString(FAILURE_FILENOTFOUND),szDataTrack);
+        return BURNRESULT_INTERNALERROR;
+    }
+
+    if (!Launch(AudioTracks,szAudioText,iDataMode,InStream.size()))
+        return BURNRESULT_INTERNALERROR;
+
+    CFanOutStream OutStream(*this);
+    if (!ckcore::stream::copy(InStream,OutStream))
+        Cancel();
+
+    OutStream.Close();
+
+    return Finish();
+}
+
+/**
+    Creates the file system on the fly and records it to all recorders. The
+    file system is only created once.
+    @param Files the files to include in the file system.
+    @param uiDataBytes the size of the file system as estimated by
+                       CCore2::EstimateImageSize.
+    @param AudioTracks the audio tracks to record after the data track.
+    @param szAudioText full path to the CD-Text file, may be NULL.
+    @param iDataMode the data mode of the data track.
+    @param pFilePathMap if not NULL, receives the file path map used for
+                        verifying the discs.
+    @return the result of the operation.
+*/
+eBurnResult CMultiBurn::BurnCompilation(const ckfilesystem::FileSet &Files,unsigned __int64 uiDataBytes,
+                                        std::vector<TCHAR *> &AudioTracks,const TCHAR *szAudioText,
+                                        int iDataMode,std::map<tstring,tstring> *pFilePathMap)
+{
+    if (!Launch(AudioTracks,szAudioText,iDataMode,uiDataBytes))
+        return BURNRESULT_INTERNALERROR;
+
+    CFanOutStream OutStream(*this);
+    CSourceProgress SourceProgress(m_Progress);
+
+    // All recorders share one recording buffer.
+    CPipeBuffer Buffer(OutStream,&m_Progress,
+                       (unsigned long)g_GlobalSettings.m_iPipeBufferSize << 20);
+    if (Buffer.Start())
+    {
+        if (g_Core2.CreateImage(Buffer,Files,SourceProgress,false,pFilePathMap) != RESULT_OK)
+            Cancel();
+
+        Buffer.Close();
+    }
+    else if (g_Core2.CreateImage(OutStream,Files,SourceProgress,false,pFilePathMap) != RESULT_OK)
+    {
+        Cancel();
+    }
+
+    OutStream.Close();
+
+    return Finish();
+}
+
+DWORD WINAPI CMultiBurn::VerifyThread(LPVOID lpThreadParameter)
+{
+    CTarget *pTarget = (CTarget *)lpThreadParameter;
+    CMultiBurn &Owner = pTarget->m_Owner;
+
+    // We need to reload the drive media.
+    pTarget->set_status(lngGetString(PROGRESS_RELOADMEDIA));
+
+    g_Core2.StartStopUnit(pTarget->m_Device,CCore2::LOADMEDIA_EJECT,false);
+    if (!g_Core2.StartStopUnit(pTarget->m_Device,CCore2::LOADMEDIA_LOAD,false))
+        pTarget->notify(ckcore::Progress::ckWARNING,lngGetString(FAILURE_NOMEDIA));
+
+    TCHAR szDriveLetter[3];
+    szDriveLetter[0] = pTarget->m_Device.address().device_[0];
+    szDriveLetter[1] = ':';
+    szDriveLetter[2] = '\0';
+
+    pTarget->m_uiErrorCount = 0;
+    pTarget->set_progress(0);
+
+    if (!g_ProjectManager.VerifyCompilation(pTarget,szDriveLetter,*Owner.m_pFilePathMap) ||
+        pTarget->m_uiErrorCount > 0)
+    {
+        pTarget->m_Result = BURNRESULT_EXTERNALERROR;
+    }
+
+    pTarget->set_progress(100);
+
+    if (Owner.m_bEject)
+        g_Core2.StartStopUnit(pTarget->m_Device,CCore2::LOADMEDIA_EJECT,false);
+
+    return 0;
+}
+
+/**
+    Verifies the discs of all recorders that succeeded in recording them. The
+    discs are verified in parallel.
+    @param FilePathMap the file path map returned when creating the disc image.
+    @param bEject if true the discs will be ejected after being verified.
+    @return the result of the operation.
+*/
+eBurnResult CMultiBurn::Verify(std::map<tstring,tstring> &FilePathMap,bool bEject)
+{
+    m_pFilePathMap = &FilePathMap;
+    m_bEject = bEject;
+
+    std::vector<HANDLE> Threads;
+
+    std::vector<CTarget *>::iterator it;
+    for (it = m_Targets.begin(); it != m_Targets.end(); it++)
+    {
+        if ((*it)->m_Result != BURNRESULT_OK)
+            continue;
+
+        unsigned long ulThreadID = 0;
+        HANDLE hThread = ::CreateThread(NULL,0,VerifyThread,*it,0,&ulThreadID);
+        if (hThread != NULL)
+            Threads.push_back(hThread);
+        else
+            VerifyThread(*it);
+    }
+
+    // WaitForMultipleObjects is limited to MAXIMUM_WAIT_OBJECTS handles.
+    for (unsigned int i = 0; i < Threads.size(); i++)
+    {
+        ::WaitForSingleObject(Threads[i],INFINITE);
+        ::CloseHandle(Threads[i]);
+    }
+
+    return GetOverallResult();
+}
+
+unsigned int CMultiBurn::GetTargetCount() const
+{
+    return (unsigned int)m_Targets.size();
+}
+
+ckmmc::Device &CMultiBurn::GetDevice(unsigned int uiIndex) const
+{
+    return m_Targets[uiIndex]->m_Device;
+}
+
+eBurnResult CMultiBurn::GetResult(unsigned int uiIndex) const
+{
+    return m_Targets[uiIndex]->m_Result;
+}
@@ -0,0 +1,189 @@
+/*
+ * InfraRecorder - CD/DVD burning software
+ * Copyright (C) 2006-2012 Christian Kindahl
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#include <map>
+#include <vector>
+#include <deque>
+#include <ckcore/progress.hh>
+#include <ckcore/stream.hh>
+#include <ckfilesystem/fileset.hh>
+#include <ckmmc/device.hh>
+#include "core.hh"
+#include "advanced_progress.hh"
+
+#define MULTIBURN_POLL_INTERVAL			100		// Milliseconds.
+#define MULTIBURN_QUEUE_SIZE			256		// Blocks queued for each recorder.
+#define MULTIBURN_STALL_TIMEOUT			(120 * 1000)	// Milliseconds.
+
+// Records the same compilation to several recorders at the same time. Every
+// recorder is driven by its own cdrtools process while the data track is read
+// or created only once and written to all of the processes. Each recorder
+// has its own queue and writer thread so that a slow recorder does not hold
+// up the others. A recorder that fails, or stops accepting data, is excluded
+// from the rest of the operation without affecting the other recorders.
+class CMultiBurn
+{
+private:
+    // A block of data shared by the queues of all recorders, it's deleted
+    // when the last recorder has released it.
+    class CBlock
+    {
+    private:
+        volatile LONG m_lRefCount;
+
+    public:
+        unsigned char *m_pData;
+        ckcore::tuint32 m_uiSize;
+
+        CBlock(const void *pData,ckcore::tuint32 uiSize);
+        ~CBlock();
+
+        void AddRef();
+        void Release();
+    };
+
+    // Collects the progress of one recorder and forwards it to the progress
+    // object of the operation, messages are prefixed with the recorder name.
+    class CTarget : public CAdvancedProgress
+    {
+    public:
+        CMultiBurn &m_Owner;
+        ckmmc::Device &m_Device;
+        ckcore::tstring m_DeviceName;
+        CCore m_Core;
+
+        unsigned char m_ucPercent;
+        int m_iBuffer;
+        unsigned int m_uiErrorCount;
+        bool m_bLaunched;
+        bool m_bDropped;
+        eBurnResult m_Result;
+
+        // Blocks waiting to be written to the process.
+        std::deque<CBlock *> m_Queue;
+        CRITICAL_SECTION m_csQueue;
+        HANDLE m_hDataEvent;
+        HANDLE m_hSpaceEvent;
+        HANDLE m_hWriterThread;
+        volatile bool m_bClosed;
+        volatile bool m_bStopped;
+        volatile unsigned long m_ulLastWrite;
+
+        CTarget(CMultiBurn &Owner,ckmmc::Device &Device);
+        ~CTarget();
+
+        bool StartWriter();
+        void CloseWriter();
+        void Enqueue(CBlock *pBlock);
+        unsigned int GetQueueSize();
+        bool IsStalled();
+
+        static DWORD WINAPI WriterThread(LPVOID lpThreadParameter);
+
+        // ckcore::Progress.
+        void set_progress(unsigned char ucPercent);
+        void set_marquee(bool bMarquee);
+        void set_status(const TCHAR *szStatus,...);
+        void notify(ckcore::Progress::MessageType Type,const TCHAR *szMessage,...);
+        bool cancelled();
+
+        // CAdvancedProgress.
+        void NotifyCompleted();
+        void SetRealMode(bool bRealMode);
+        void SetBuffer(int iPercent);
+        void AllowReload();
+        void AllowCancel(bool bAllow);
+        bool RequestNextDisc();
+        void StartSmoke();
+    };
+
+    // Queues every block for the processes of the recorders still taking
+    // part in the operation.
+    class CFanOutStream : public ckcore::OutStream
+    {
+    private:
+        CMultiBurn &m_Owner;
+        bool m_bClosed;
+
+    public:
+        CFanOutStream(CMultiBurn &Owner);
+        ~CFanOutStream();
+
+        void Close();
+
+        // ckcore::OutStream.
+        ckcore::tint64 write(const void *pBuffer,ckcore::tuint32 uiCount);
+    };
+
+    // Used while creating the file system on the fly. The progress is reported
+    // by the recorders so only messages and cancellation are passed on.
+    class CSourceProgress : public ckcore::Progress
+    {
+    private:
+        CAdvancedProgress &m_Progress;
+
+    public:
+        CSourceProgress(CAdvancedProgress &Progress);
+
+        void set_progress(unsigned char ucPercent);
+        void set_marquee(bool bMarquee);
+        void set_status(const TCHAR *szStatus,...);
+        void notify(ckcore::Progress::MessageType Type,const TCHAR *szMessage,...);
+        bool cancelled();
+    };
+
+    CAdvancedProgress &m_Progress;
+    std::vector<CTarget *> m_Targets;
+    std::map<tstring,tstring> *m_pFilePathMap;
+    bool m_bEject;
+
+    // Protects the progress state of the targets.
+    CRITICAL_SECTION m_csProgress;
+
+    void Drop(CTarget *pTarget);
+    void DropStalled(CTarget *pTarget);
+    void UpdateProgress();
+    void UpdateBuffer();
+
+    unsigned int GetSucceededCount() const;
+    eBurnResult GetOverallResult() const;
+
+    bool Launch(std::vector<TCHAR *> &AudioTracks,const TCHAR *szAudioText,
+        int iDataMode,unsigned __int64 uiDataBytes);
+    eBurnResult Finish();
+
+    static DWORD WINAPI VerifyThread(LPVOID lpThreadParameter);
+
+public:
+    CMultiBurn(const std::vector<ckmmc::Device *> &Devices,CAdvancedProgress &Progress);
+    ~CMultiBurn();
+
+    void Cancel();
+
+    eBurnResult BurnTracks(const TCHAR *szDataTrack,std::vector<TCHAR *> &AudioTracks,
+        const TCHAR *szAudioText,int iDataMode);
+    eBurnResult BurnCompilation(const ckfilesystem::FileSet &Files,unsigned __int64 uiDataBytes,
+        std::vector<TCHAR *> &AudioTracks,const TCHAR *szAudioText,int iDataMode,
+        std::map<tstring,tstring> *pFilePathMap = NULL);
+    eBurnResult Verify(std::map<tstring,tstring> &FilePathMap,bool bEject);
+
+    unsigned int GetTargetCount() const;
+    ckmmc::Device &GetDevice(unsigned int uiIndex) const;
+    eBurnResult GetResult(unsigned int uiIndex) const;
+};
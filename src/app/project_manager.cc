@@ -23,6 +23,7 @@
 #include <ckcore/convert.hh>
 #include <ckcore/linereader.hh>
 #include <base/string_util.hh>
+#include <base/checksum_util.hh>
 #include "string_table.hh"
 #include "main_frm.hh"
 #include "audio_util.hh"
@@ -84,8 +85,9 @@ bool CProjectManager::CFileTransaction::AddDataFile(CProjectNode *pParentNode,co
 
     pParentNode->m_Files.push_back(pItemData);
 
-    // Increase the total length counter.
-    g_ProjectManager.m_pSpaceMeter->IncreaseAllocatedSize(pItemData->uiSize);
+    // Update the space meter.
+    g_ProjectManager.m_pSpaceMeter->AddFile(pItemData->GetFileName(),pItemData->uiSize,
+        (pItemData->ucFlags & PROJECTITEM_FLAG_ISIMPORTED) != 0);
 
     return true;
 }
@@ -141,8 +143,9 @@ CItemData *CProjectManager::CFileTransaction::
 
     pParentNode->m_Files.push_back(pItemData);
 
-    // Increase the total length counter.
-    g_ProjectManager.m_pSpaceMeter->IncreaseAllocatedSize(pItemData->uiSize);
+    // Update the space meter.
+    g_ProjectManager.m_pSpaceMeter->AddFile(pItemData->GetFileName(),pItemData->uiSize,
+        (pItemData->ucFlags & PROJECTITEM_FLAG_ISIMPORTED) != 0);
 
     return pItemData;
 }
@@ -186,6 +189,9 @@ CProjectNode *CProjectManager::CFileTransaction::
 
     pParentNode->m_Children.push_back(pNode);
 
+    // Update the space meter.
+    g_ProjectManager.m_pSpaceMeter->AddFolder(pNode->pItemData->GetFileName());
+
     g_TreeManager.AddTreeNode(pParentNode->m_hTreeItem,pNode);
     return pNode;
 }
@@ -238,6 +244,9 @@ CProjectNode *CProjectManager::CFileTransaction::
 
     pParentNode->m_Children.push_back(pNode);
 
+    // Update the space meter.
+    g_ProjectManager.m_pSpaceMeter->AddFolder(pNode->pItemData->GetFileName());
+
     g_TreeManager.AddTreeNode(pParentNode->m_hTreeItem,pNode);
     return pNode;
 }
@@ -596,9 +605,9 @@ LRESULT CProjectManager::OnRename(WORD wNotifyCode,WORD wID,HWND hWndCtl,BOOL &b
             if (iItemIndex == -1)
                 break;
 
-            CItemData *pItemData = (CItemData *)m_pListView->GetItemData(iItemIndex);
+            CItemData *pItemData = g_TreeManager.GetListItem(iItemIndex);
 
-            if (!(pItemData->ucFlags & PROJECTITEM_FLAG_ISLOCKED))
+            if (pItemData != NULL && !(pItemData->ucFlags & PROJECTITEM_FLAG_ISLOCKED))
                 m_pListView->EditLabel(iItemIndex);
             break;
     };
@@ -971,6 +980,7 @@ bool CProjectManager::ListAddNewFolder()
 
     // Add the new node as a child to the current.
     pCurNode->m_Children.push_back(pNode);
+    m_pSpaceMeter->AddFolder(szFolderName);
 
     g_TreeManager.AddTreeNode(pCurNode->m_hTreeItem,pNode);
     g_TreeManager.Refresh();
@@ -1023,6 +1033,7 @@ bool CProjectManager::TreeAddNewFolder(CProjectNode *pParentNode)
     FileTimeToDosDateTime(&FileTime,&pNode->pItemData->usFileDate,&pNode->pItemData->usFileTime);
 
     pParentNode->m_Children.push_back(pNode);
+    m_pSpaceMeter->AddFolder(szFolderName);
 
     g_TreeManager.AddTreeNode(pParentNode->m_hTreeItem,pNode);
     g_TreeManager.Refresh();
@@ -1031,6 +1042,105 @@ bool CProjectManager::TreeAddNewFolder(CProjectNode *pParentNode)
     return true;
 }
 
+/**
+    Adds or removes a single file to or from the space meter.
+    @param pItemData the file item.
+    @param bRemove set to true if the file is being removed from the project.
+*/
+void CProjectManager::UpdateSpaceMeter(CItemData *pItemData,bool bRemove)
+{
+    // Audio tracks are not part of the file system.
+    if (pItemData->HasAudioData())
+    {
+        if (bRemove)
+            m_pSpaceMeter->DecreaseAllocatedSize(pItemData->uiSize);
+        else
+            m_pSpaceMeter->IncreaseAllocatedSize(pItemData->uiSize);
+
+        return;
+    }
+
+    bool bImported = (pItemData->ucFlags & PROJECTITEM_FLAG_ISIMPORTED) != 0;
+
+    if (bRemove)
+        m_pSpaceMeter->RemoveFile(pItemData->GetFileName(),pItemData->uiSize,bImported);
+    else
+        m_pSpaceMeter->AddFile(pItemData->GetFileName(),pItemData->uiSize,bImported);
+}
+
+/**
+    Adds or removes all files and folders below the specified node to or from
+    the space meter. The node itself is included unless it's a project root.
+    @param pNode the node to update.
+    @param bRemove set to true if the node is being removed from the project.
+*/
+void CProjectManager::UpdateSpaceMeter(CProjectNode *pNode,bool bRemove)
+{
+    std::vector<CProjectNode *> FolderStack;
+    FolderStack.push_back(pNode);
+
+    while (FolderStack.size() > 0)
+    {
+        CProjectNode *pCurNode = FolderStack[FolderStack.size() - 1];
+        FolderStack.pop_back();
+
+        if (!(pCurNode->pItemData->ucFlags & PROJECTITEM_FLAG_ISPROJECTROOT))
+        {
+            if (bRemove)
+                m_pSpaceMeter->RemoveFolder(pCurNode->pItemData->GetFileName());
+            else
+                m_pSpaceMeter->AddFolder(pCurNode->pItemData->GetFileName());
+        }
+
+        std::list<CItemData *>::iterator itFileObject;
+        for (itFileObject = pCurNode->m_Files.begin(); itFileObject != pCurNode->m_Files.end(); itFileObject++)
+            UpdateSpaceMeter(*itFileObject,bRemove);
+
+        std::list<CProjectNode *>::iterator itNodeObject;
+        for (itNodeObject = pCurNode->m_Children.begin(); itNodeObject != pCurNode->m_Children.end(); itNodeObject++)
+            FolderStack.push_back(*itNodeObject);
+    }
+}
+
+/**
+    Renames the specified file or folder and updates the space meter
+    accordingly.
+    @param pItemData the item to rename.
+    @param szFileName the new name of the item.
+*/
+void CProjectManager::RenameItem(CItemData *pItemData,const TCHAR *szFileName)
+{
+    if (pItemData->ucFlags & PROJECTITEM_FLAG_ISFOLDER)
+    {
+        m_pSpaceMeter->RemoveFolder(pItemData->GetFileName());
+        pItemData->SetFileName(szFileName);
+        m_pSpaceMeter->AddFolder(pItemData->GetFileName());
+    }
+    else
+    {
+        UpdateSpaceMeter(pItemData,true);
+        pItemData->SetFileName(szFileName);
+        UpdateSpaceMeter(pItemData,false);
+    }
+}
+
+/**
+    Rebuilds the file system layout of the space meter from the project tree.
+    This must be done whenever items are added to or removed from the tree
+    without passing through the space meter, the layout may otherwise be
+    asked to remove entries it never held.
+    @param uiExtraSize the size of any data not part of the project tree,
+    such as an imported session.
+*/
+void CProjectManager::RebuildSpaceMeter(unsigned __int64 uiExtraSize)
+{
+    if (m_pSpaceMeter == NULL)
+        return;
+
+    m_pSpaceMeter->SetAllocatedSize(uiExtraSize);
+    UpdateSpaceMeter(g_TreeManager.GetRootNode(),false);
+}
+
 /**
     Removes the specified file from the specified parent folder (node).
     @param pParentNode parent of the folder file to be removed from the project.
@@ -1039,7 +1149,7 @@ bool CProjectManager::TreeAddNewFolder(CProjectNode *pParentNode)
 void CProjectManager::RemoveFile(CProjectNode *pParentNode,CItemData *pItemData)
 {
     // Update the space meter.
-    m_pSpaceMeter->DecreaseAllocatedSize(pItemData->uiSize);
+    UpdateSpaceMeter(pItemData,true);
 
     // Remove the items.
     g_TreeManager.RemoveEntry(pParentNode,pItemData);
@@ -1055,10 +1165,10 @@ void CProjectManager::ListRemoveSel()
 
     while (iItemIndex != -1)
     {
-        CItemData *pItemData = (CItemData *)m_pListView->GetItemData(iItemIndex);
+        CItemData *pItemData = g_TreeManager.GetListItem(iItemIndex);
 
         // If the item is locked, skip it.
-        if (pItemData->ucFlags & PROJECTITEM_FLAG_ISLOCKED)
+        if (pItemData == NULL || (pItemData->ucFlags & PROJECTITEM_FLAG_ISLOCKED))
         {
             iItemIndex = m_pListView->GetNextItem(iItemIndex,LVNI_SELECTED);
             continue;
@@ -1066,9 +1176,16 @@ void CProjectManager::ListRemoveSel()
 
         // Update the space meter.
         if (pItemData->ucFlags & PROJECTITEM_FLAG_ISFOLDER)
-            m_pSpaceMeter->DecreaseAllocatedSize(g_TreeManager.GetNodeSize(g_TreeManager.GetCurrentNode(),pItemData));
+        {
+            CProjectNode *pNode = g_TreeManager.GetChildNode(g_TreeManager.GetCurrentNode(),
+                                                             pItemData->GetFileName());
+            if (pNode != NULL)
+                UpdateSpaceMeter(pNode,true);
+        }
         else
-            m_pSpaceMeter->DecreaseAllocatedSize(pItemData->uiSize);
+        {
+            UpdateSpaceMeter(pItemData,true);
+        }
 
         // Remove the items.
         g_TreeManager.RemoveEntry(g_TreeManager.GetCurrentNode(),pItemData);
@@ -1089,7 +1206,7 @@ void CProjectManager::TreeRemoveNode(CProjectNode *pNode)
         return;
 
     // Update the space meter.
-    m_pSpaceMeter->DecreaseAllocatedSize(g_TreeManager.GetNodeSize(pNode));
+    UpdateSpaceMeter(pNode,true);
 
     // Remove the node.
     g_TreeManager.RemoveEntry(pNode);
@@ -1202,6 +1319,9 @@ void CProjectManager::DeleteImportedItems()
             break;
     };
 
+    // The imported items are removed without updating the space meter.
+    RebuildSpaceMeter(0);
+
     g_TreeManager.Refresh();
 }
 
@@ -1333,6 +1453,10 @@ void CProjectManager::SaveProjectFileSys(CXmlProcessor *pXml)
 {
     pXml->AddElement(_T("FileSystem"),_T(""),true);
         pXml->AddElement(_T("Identifier"),g_ProjectSettings.m_iFileSystem);
+        pXml->AddElement(_T("Differential"),g_ProjectSettings.m_bDifferential,true);
+            pXml->AddElementAttr(_T("hash"),g_ProjectSettings.m_bDifferentialHash);
+        pXml->LeaveElement();
+        pXml->AddElement(_T("Deduplicate"),g_ProjectSettings.m_bDeduplicate);
     pXml->LeaveElement();
 }
 
@@ -1342,6 +1466,17 @@ bool CProjectManager::LoadProjectFileSys(CXmlProcessor *pXml)
         return false;
 
     pXml->GetSafeElementData(_T("Identifier"),&g_ProjectSettings.m_iFileSystem);
+
+    if (pXml->EnterElement(_T("Differential")))
+    {
+        pXml->GetSafeElementData(&g_ProjectSettings.m_bDifferential);
+        pXml->GetSafeElementAttrValue(_T("hash"),&g_ProjectSettings.m_bDifferentialHash);
+
+        pXml->LeaveElement();
+    }
+
+    pXml->GetSafeElementData(_T("Deduplicate"),&g_ProjectSettings.m_bDeduplicate);
+
     pXml->LeaveElement();
     return true;
 }
@@ -1661,8 +1796,7 @@ bool CProjectManager::LoadProject(const TCHAR *szFullPath)
         m_pTreeView->Expand(g_TreeManager.GetRootNode()->m_hTreeItem);
 
     // Update the space meter.
-    if (m_pSpaceMeter != NULL)
-        m_pSpaceMeter->SetAllocatedSize(g_TreeManager.GetNodeSize(g_TreeManager.GetRootNode()));
+    RebuildSpaceMeter(0);
 
     Xml.LeaveElement();
     Xml.LeaveElement();
@@ -1708,6 +1842,51 @@ unsigned __int64 CProjectManager::GetProjectSize()
     return m_pSpaceMeter->GetAllocatedSize();
 }
 
+/**
+    Collects the files of the project that are compared to find the files
+    that would be stored only once since their contents are identical to
+    other files. The files can be compared on any thread using
+    CCore2Dedup::Analyze. Local files are not compared with the imported
+    session, that would read both the files and the disc on the calling
+    thread, so files that would be linked to the imported session are
+    included as local files.
+    @param Files the file set to fill with the project files, the caller is
+           responsible for destroying it.
+    @return true if the project contents can be deduplicated, false otherwise.
+*/
+bool CProjectManager::GetProjectDuplicateFiles(ckfilesystem::FileSet &Files)
+{
+    if (!g_ProjectSettings.m_bDeduplicate || g_ProjectSettings.m_iFileSystem != FILESYSTEM_ISO)
+        return false;
+
+    switch (m_iProjectType)
+    {
+        case PROJECTTYPE_DATA:
+            g_TreeManager.GetPathList(Files,g_TreeManager.GetRootNode(),0,false);
+            break;
+
+        case PROJECTTYPE_MIXED:
+            g_TreeManager.GetPathList(Files,m_pMixDataNode,
+                lstrlen(m_pMixDataNode->pItemData->GetFileName()) + 1,false);
+            break;
+
+        default:
+            return false;
+    }
+
+    return true;
+}
+
+/**
+    Updates the space meter with the number of bytes that are saved by
+    storing the duplicate files of the project only once.
+    @param uiSize number of bytes saved by storing the duplicates only once.
+*/
+void CProjectManager::SetProjectDuplicateSize(unsigned __int64 uiSize)
+{
+    m_pSpaceMeter->SetDuplicateSize(uiSize);
+}
+
 /*
     CProjectManager::GetProjectAudioSize
     ------------------------------------
@@ -2002,7 +2181,7 @@ bool CProjectManager::VerifyLocalFiles(CProjectNode *pNode,std::vector<CProjectN
                                        ckcore::Progresser &FileProgresser,unsigned __int64 &uiFailCount,
                                        std::map<tstring,tstring> &FilePathMap)
 {
-    ckcore::CrcStream FileCrcStream(ckcore::CrcStream::ckCRC_32);
+    CChecksumStream FileCrcStream(CHECKSUM_CRC32);
 
     TCHAR szStatus[MAX_PATH + 32];
     tstring FileName;
@@ -2086,11 +2265,14 @@ bool CProjectManager::VerifyLocalFiles(CProjectNode *pNode,std::vector<CProjectN
      @param pProgress progress feedback object.
      @param szDriveLetter drive letter of the device containg the CD to be
      verified.
+     @param pFailCount if not NULL, receives the number of files that failed
+     verification.
      @return true of the operation completed successfully (with or without
      errors), and false if the operation was cancelled.
 */
 bool CProjectManager::VerifyCompilation(CAdvancedProgress *pProgress,const TCHAR *szDriveLetter,
-                                        std::map<tstring,tstring> &FilePathMap)
+                                        std::map<tstring,tstring> &FilePathMap,
+                                        unsigned __int64 *pFailCount)
 {
     int iPathStripLen = 0;
 
@@ -2131,6 +2313,9 @@ bool CProjectManager::VerifyCompilation(CAdvancedProgress *pProgress,const TCHAR
             return false;
     }
     
+    if (pFailCount != NULL)
+        *pFailCount = uiFailCount;
+
     // Display the final message.
     if (uiFailCount == 0)
     {
@@ -150,6 +150,9 @@ private:
     bool ImportFile(ckcore::Path &BasePath,ckcore::tstring &FilePath,
         CFileTransaction &Transaction);
 
+    void UpdateSpaceMeter(CItemData *pItemData,bool bRemove);
+    void UpdateSpaceMeter(CProjectNode *pNode,bool bRemove);
+
 public:
     CProjectManager();
     ~CProjectManager();
@@ -173,6 +176,8 @@ public:
     bool ListAddNewFolder();
     bool TreeAddNewFolder(CProjectNode *pParentNode);
 
+    void RenameItem(CItemData *pItemData,const TCHAR *szFileName);
+    void RebuildSpaceMeter(unsigned __int64 uiExtraSize);
     void RemoveFile(CProjectNode *pParentNode,CItemData *pItemData);
 
     void ListRemoveSel();
@@ -191,6 +196,8 @@ public:
     void GetProjectContents(unsigned __int64 &uiFileCount,unsigned __int64 &uiFolderCount,
         unsigned __int64 &uiTrackCount);
     unsigned __int64 GetProjectSize();
+    bool GetProjectDuplicateFiles(ckfilesystem::FileSet &Files);
+    void SetProjectDuplicateSize(unsigned __int64 uiSize);
     //unsigned __int64 GetProjectAudioSize();
     CProjectNode *GetMixDataRootNode();
     CProjectNode *GetMixAudioRootNode();
@@ -202,7 +209,7 @@ public:
     bool SaveCDText(const TCHAR *szFullPath);
 
     bool VerifyCompilation(CAdvancedProgress *pProgress,const TCHAR *szDriveLetter,
-        std::map<tstring,tstring> &FilePathMap);
+        std::map<tstring,tstring> &FilePathMap,unsigned __int64 *pFailCount = NULL);
 
     void SetDiscLabel(TCHAR *szLabelName);
 
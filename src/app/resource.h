@@ -328,6 +328,17 @@
 #define IDC_BUTTON3                     1225
 #define IDC_NUMCOPIESSTATIC             1226
 #define IDC_NUMCOPIESCOMBO              1228
+#define IDC_SOURCEBUFFERSTATIC          1229
+#define IDC_SOURCEBUFFERPROGRESS        1230
+#define IDC_PIPEBUFFERGROUPSTATIC       1231
+#define IDC_PIPEBUFFERINFOSTATIC        1232
+#define IDC_PIPEBUFFEREDIT              1233
+#define IDC_PIPEBUFFERMBSTATIC          1234
+#define IDC_DIFFERENTIALCHECK           1235
+#define IDC_DIFFERENTIALHASHCHECK       1236
+#define IDC_DEDUPCHECK                  1237
+#define IDC_DUPLICATESLABELSTATIC       1238
+#define IDC_DUPLICATESSTATIC            1239
 #define IDC_PROJECTTREEVIEW             10001
 #define IDC_PROJECTLISTVIEW             10002
 #define IDC_SHELLTREEVIEW               10003
@@ -399,7 +410,7 @@
 #ifndef APSTUDIO_READONLY_SYMBOLS
 #define _APS_NEXT_RESOURCE_VALUE        298
 #define _APS_NEXT_COMMAND_VALUE         32845
-#define _APS_NEXT_CONTROL_VALUE         1229
+#define _APS_NEXT_CONTROL_VALUE         1240
 #define _APS_NEXT_SYMED_VALUE           101
 #endif
 #endif
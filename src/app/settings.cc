@@ -97,6 +97,7 @@ bool CGlobalSettings::Save(CXmlProcessor *pXml)
             m_iFIFOSize = FIFO_MAX;
         else if (m_iFIFOSize < FIFO_MIN)
             m_iFIFOSize = FIFO_MIN;
+        pXml->AddElement(_T("PipeBuffer"),m_iPipeBufferSize);
 
         // Temporary folder.
         pXml->AddElement(_T("TempPath"),m_szTempPath);
@@ -143,6 +144,11 @@ bool CGlobalSettings::Load(CXmlProcessor *pXml)
     pXml->GetSafeElementData(_T("Wizard"),&m_bShowWizard);
     pXml->GetSafeElementData(_T("GraceTime"),&m_iGraceTime);
     pXml->GetSafeElementData(_T("FIFO"),&m_iFIFOSize);
+    pXml->GetSafeElementData(_T("PipeBuffer"),&m_iPipeBufferSize);
+    if (m_iPipeBufferSize > PIPEBUFFER_MAX)
+        m_iPipeBufferSize = PIPEBUFFER_MAX;
+    else if (m_iPipeBufferSize < PIPEBUFFER_MIN)
+        m_iPipeBufferSize = PIPEBUFFER_MIN;
 
     // Temporary folder.
     pXml->GetSafeElementData(_T("TempPath"),m_szTempPath,MAX_PATH - 1);
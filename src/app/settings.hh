@@ -61,6 +61,11 @@
 #define FIFO_MAX						800  // In MiB.
 #define FIFO_MIN						4
 
+// The recording buffer is allocated in the address space of InfraRecorder,
+// which limits its size on 32-bit systems. A size of zero disables the buffer.
+#define PIPEBUFFER_MAX					512  // In MiB.
+#define PIPEBUFFER_MIN					0
+
 #define FILESYSTEM_ISO                  0
 #define FILESYSTEM_ISO_UDF              1
 #define FILESYSTEM_DVDVIDEO				2
@@ -115,6 +120,7 @@ public:
     bool m_bShowWizard;
     int m_iGraceTime;
     int m_iFIFOSize;
+    int m_iPipeBufferSize;		// Recording buffer used when recording on the fly.
 
     TCHAR m_szTempPath[MAX_PATH];
 
@@ -144,6 +150,7 @@ public:
         m_bShowWizard = true;
         m_iGraceTime = 5;			// Five seconds by default.
         m_iFIFOSize = 4;			// 4 MiB by default.
+        m_iPipeBufferSize = 256;	// 256 MiB by default.
 
         // Path to system temporary directory.
         m_szTempPath[0] = '\0';
@@ -377,6 +384,14 @@ public:
     unsigned __int64 m_uiNextWritableAddr;
     ckmmc::Device *m_pDevice;
 
+    // Differential multi-session, only files that are new or have changed
+    // since the imported session are written.
+    bool m_bDifferential;
+    bool m_bDifferentialHash;	// Compare the file contents with the imported files.
+
+    // Store identical files only once in ISO9660 disc images.
+    bool m_bDeduplicate;
+
     CProjectSettings()
     {
         // We don't want to display an error message if the code page is not
@@ -448,6 +463,11 @@ public:
         m_uiImportTrackLen = 0;
         m_uiNextWritableAddr = 0;
         m_pDevice = NULL;
+
+        m_bDifferential = false;
+        m_bDifferentialHash = false;
+
+        m_bDeduplicate = false;
     }
 
     bool Save(CXmlProcessor *pXml);
@@ -51,23 +51,37 @@ void CSettingsManager::RegisterObject(ISettings *pSettings)
 }
 
 bool CSettingsManager::GetConfigPath(TCHAR *szConfigPath)
+{
+    if (!GetConfigDir(szConfigPath))
+        return false;
+
+    lstrcat(szConfigPath,_T("settings.xml"));
+    return true;
+}
+
+/*
+    CSettingsManager::GetConfigDir
+    ------------------------------
+    Returns the directory where the configuration files are stored, including
+    a trailing backslash. The directory is created if it does not exist.
+*/
+bool CSettingsManager::GetConfigDir(TCHAR *szConfigDir)
 {
 #ifdef PORTABLE
-    GetModuleFileName(NULL,szConfigPath,MAX_PATH - 1);
-    ExtractFilePath(szConfigPath);
+    GetModuleFileName(NULL,szConfigDir,MAX_PATH - 1);
+    ExtractFilePath(szConfigDir);
 #else
     if (!SUCCEEDED(SHGetFolderPath(HWND_DESKTOP,CSIDL_APPDATA | CSIDL_FLAG_CREATE,NULL,
-        SHGFP_TYPE_CURRENT,szConfigPath)))
+        SHGFP_TYPE_CURRENT,szConfigDir)))
         return false;
 
-    IncludeTrailingBackslash(szConfigPath);
-    lstrcat(szConfigPath,_T("InfraRecorder\\"));
+    IncludeTrailingBackslash(szConfigDir);
+    lstrcat(szConfigDir,_T("InfraRecorder\\"));
 
     // Create the file path if it doesn't exist.
-    ckcore::Directory::create(szConfigPath);
+    ckcore::Directory::create(szConfigDir);
 #endif
 
-    lstrcat(szConfigPath,_T("settings.xml"));
     return true;
 }
 
@@ -33,6 +33,8 @@ public:
     CSettingsManager();
     ~CSettingsManager();
 
+    bool GetConfigDir(TCHAR *szConfigDir);
+
     bool Save();
     bool Load();
 };
@@ -44,6 +44,24 @@ void CTempManager::AddObject(const TCHAR *szFileName)
     m_szFileNames.push_back(szFileName);
 }
 
+/*
+    CTempManager::RemoveObject
+    --------------------------
+    Removes a file or folder from the list of objects to be removed when the
+    application closes. The object itself is left untouched.
+*/
+void CTempManager::RemoveObject(const TCHAR *szFileName)
+{
+    std::vector<std::wstring>::iterator itFileName = m_szFileNames.begin();
+    while (itFileName != m_szFileNames.end())
+    {
+        if (!lstrcmpi(itFileName->c_str(),szFileName))
+            itFileName = m_szFileNames.erase(itFileName);
+        else
+            itFileName++;
+    }
+}
+
 void CTempManager::CleanUp()
 {
     // Remove the empty directory (if created).
@@ -32,6 +32,7 @@ public:
     ~CTempManager();
 
     void AddObject(const TCHAR *szFileName);
+    void RemoveObject(const TCHAR *szFileName);
     void CleanUp();
 
     const TCHAR *GetEmtpyDirectory();
@@ -394,4 +394,36 @@
 	TRSTR(STATUS_GATHER_FILE_INFO /* 0x0145 */, _T("Gathering project file information."))
     TRSTR(PROJECTPROP_ISO_CHARSET_ISO /* 0x0146 */, _T("ISO9660 (standard)"))
     TRSTR(WARNING_BAD_DVDVIDEO /* 0x00147 */, _T("InfraRecorder video projects requires the content to be in DVD-Video format. This does not appear to be the case. InfraRecorder could not find the required file: VIDEO_TS/VIDEO_TS.IFO.\n\nPlease convert any video files into DVD-Video format before burning them as video projects in InfraRecorder.\n\nDo you want to continue anyways?"))
-    TRSTR(WARNING_EMPTY_PROJECT /* 0x00148 */, _T("You have no added any files to the current project. Do you want to continue, creating an empty file system?"))
\ No newline at end of file
+    TRSTR(WARNING_EMPTY_PROJECT /* 0x00148 */, _T("You have no added any files to the current project. Do you want to continue, creating an empty file system?"))
+    TRSTR(WARNING_MISSPROJFILES /* 0x00149 */, _T("The following project files could not be found on your computer. They will be removed from the project."))
+    TRSTR(ERROR_TARGETDROPPED /* 0x0014a */, _T("The recorder stopped accepting data and has been excluded from the operation."))
+    TRSTR(INFO_TARGETSRECORDED /* 0x0014b */, _T("%d of %d discs were recorded successfully."))
+    TRSTR(WARNING_UNDERRUNRISK /* 0x0014c */, _T("The source files could not be read ahead of the recorder for %d%% of the recording. The recording may have been slowed down by buffer underruns."))
+    TRSTR(ERROR_PIPEBUFFERSIZE /* 0x0014d */, _T("Invalid recording buffer size. The size must be at least %i MiB and at most %i MiB."))
+    TRSTR(INFO_IMAGEKEPT /* 0x0014e */, _T("The partially created disc image has been kept. Creating the same disc image again will resume where it stopped."))
+    TRSTR(STATUS_IMPORTSESSION /* 0x0014f */, _T("Reading the file system of the session (%u sectors read)."))
+    TRSTR(STITLE_IMPORTSESSION /* 0x00150 */, _T("Importing Session"))
+    TRSTR(ERROR_IMPORTSESSION /* 0x00151 */, _T("Unable to read the file system of the selected session."))
+    TRSTR(STATUS_COPYDISC /* 0x00152 */, _T("Copying disc."))
+    TRSTR(FAILURE_COPYDISC /* 0x00153 */, _T("Unable to copy the disc. Please see program log for more details."))
+    TRSTR(SUCCESS_COPYDISC /* 0x00154 */, _T("The disc was successfully copied."))
+    TRSTR(STATUS_HASHIMAGE /* 0x00155 */, _T("Calculating the checksums of the disc image."))
+    TRSTR(STATUS_VERIFYDISC /* 0x00156 */, _T("Comparing the disc with the disc image."))
+    TRSTR(FAILURE_VERIFYFILE /* 0x00157 */, _T("The file '%s' on the disc differs from the disc image."))
+    TRSTR(FAILURE_VERIFYSECTORS /* 0x00158 */, _T("Sectors %u-%u on the disc differ from the disc image."))
+    TRSTR(PROJECT_DUPLICATES /* 0x00159 */, _T("%u Files, %s"))
+    TRSTR(SPACEMETER_DUPLICATES /* 0x0015A */, _T("Duplicates: "))
+    TRSTR(INFO_RIPDISC /* 0x0015B */, _T("Ripping disc %s, %u of %u audio tracks remaining."))
+    TRSTR(INFO_RIPDISCDONE /* 0x0015C */, _T("Disc %s is done. Please insert the next disc."))
+    TRSTR(INFO_RIPRESUME /* 0x0015D */, _T("%u tracks ripped by a previous batch will be encoded."))
+    TRSTR(INFO_RIPPEDDISCS /* 0x0015E */, _T("%u discs were ripped, %d tracks could not be ripped or encoded."))
+    TRSTR(WARNING_RIPNOAUDIO /* 0x0015F */, _T("The disc does not contain any audio tracks."))
+    TRSTR(WARNING_RIPDISCBUSY /* 0x00160 */, _T("Disc %s is already being ripped in another drive."))
+    TRSTR(ERROR_RIPSTATE /* 0x00161 */, _T("Unable to save the rip state of disc %s."))
+    TRSTR(FAILURE_RIPTRACK /* 0x00162 */, _T("Unable to rip track %d of disc %s."))
+    TRSTR(STATUS_WAITDISC /* 0x00163 */, _T("Waiting for a disc."))
+    TRSTR(WARNING_TARGETSTALLED /* 0x00164 */, _T("The recorder has not accepted any data for %u seconds."))
+    TRSTR(ERROR_MULTIBURNCLONE /* 0x00165 */, _T("Disc images with a TOC file can only be recorded to one recorder at a time."))
+    TRSTR(WARNING_HASHIMAGE /* 0x00166 */, _T("The checksums of the disc image could not be calculated. The disc will not be verified after it has been recorded."))
+    TRSTR(PROJECT_DUPLICATESSCAN /* 0x00167 */, _T("Comparing files..."))
+    TRSTR(ERROR_COPYSAMEDEVICE /* 0x00168 */, _T("The source and target drives must be different when copying a disc without user interaction."))
\ No newline at end of file
@@ -18,7 +18,9 @@
 
 #include "stdafx.hh"
 #include <queue>
+#include <map>
 #include <base/string_util.hh>
+#include <base/checksum_util.hh>
 #include "main_frm.hh"
 #include "string_table.hh"
 #include "temp_manager.hh"
@@ -28,6 +30,8 @@
 #include "audio_util.hh"
 #include "infrarecorder.hh"
 #include "tree_manager.hh"
+#include "log_dlg.hh"
+#include "core2_stream.hh"
 
 CTreeManager g_TreeManager;
 
@@ -173,6 +177,26 @@ void CProjectNode::Sort(unsigned int uiSortColumn,bool bSortUp,bool bSortAudio)
 
     m_Children.sort(ChildComparator);
     m_Files.sort(FileComparator);
+
+    UpdateListIndex();
+}
+
+/*
+    CProjectNode::UpdateListIndex
+    -----------------------------
+    Rebuilds the list index from the child and file lists. This is a linear
+    pointer copy, the lists are already kept in sort order.
+*/
+void CProjectNode::UpdateListIndex()
+{
+    m_ListIndex.clear();
+    m_ListIndex.reserve(m_Children.size() + m_Files.size());
+
+    std::list <CProjectNode *>::iterator itNodeObject;
+    for (itNodeObject = m_Children.begin(); itNodeObject != m_Children.end(); itNodeObject++)
+        m_ListIndex.push_back((*itNodeObject)->pItemData);
+
+    m_ListIndex.insert(m_ListIndex.end(),m_Files.begin(),m_Files.end());
 }
 
 /*
@@ -304,12 +328,23 @@ CTreeManager::CTreeManager()
 {
     m_pTreeView = NULL;
     m_pListView = NULL;
+
+    m_pRootNode = NULL;
+    m_pCurrentNode = NULL;
+    m_pListNode = NULL;
+
+    m_uiLinkedFiles = 0;
+    m_uiLinkedBytes = 0;
+
+    ::InitializeCriticalSection(&m_csChecksums);
 }
 
 CTreeManager::~CTreeManager()
 {
     // Destroy the tree if it hasn't been destroyed.
     DestroyTree();
+
+    ::DeleteCriticalSection(&m_csChecksums);
 }
 
 void CTreeManager::AssignControls(CTreeViewCtrlEx *pTreeView,CListViewCtrl *pListView)
@@ -514,43 +549,92 @@ CProjectNode *CTreeManager::NodalizePath(const TCHAR *szPath)
     return pParentNode;
 }
 
+/*
+    CTreeManager::ListNode
+    ----------------------
+    Displays the contents of the specified node in the list view. The list
+    view is a virtual (owner data) list view so only the item count is set
+    here, the items are requested on demand through GetListItem.
+*/
 void CTreeManager::ListNode(CProjectNode *pNode)
 {
-    unsigned int uiItemCount = 0;
+    pNode->UpdateListIndex();
+    m_pListNode = pNode;
 
-    std::list <CProjectNode *>::iterator itNodeObject;
-    for (itNodeObject = pNode->m_Children.begin(); itNodeObject != pNode->m_Children.end(); itNodeObject++)
+    m_pListView->SetItemCountEx((int)pNode->m_ListIndex.size(),LVSICF_NOSCROLL);
+}
+
+/*
+    CTreeManager::UnlistNode
+    ------------------------
+    Must be called before deleting a node. If the node, or any of its sub
+    nodes, is displayed in the list view the list view is cleared.
+*/
+void CTreeManager::UnlistNode(CProjectNode *pNode)
+{
+    if (m_pListNode != NULL && IsSubNode(pNode,m_pListNode))
     {
-        // Add the item to the listview.
-        LVITEM lvi = { 0 };
-        lvi.mask = LVIF_TEXT | LVIF_IMAGE | LVIF_PARAM;
+        m_pListNode = NULL;
+        m_pListView->SetItemCount(0);
+    }
+}
 
-        lvi.iItem = uiItemCount++;
-        lvi.iSubItem = 0;
-        lvi.pszText = LPSTR_TEXTCALLBACK;
-        lvi.cchTextMax = MAX_PATH - 1;
-        lvi.iImage = I_IMAGECALLBACK;
-        lvi.lParam = (LPARAM)((CProjectNode *)*itNodeObject)->pItemData;
+/*
+    CTreeManager::GetListItem
+    -------------------------
+    Returns the item displayed at the specified index in the list view, or
+    NULL if there is no such item.
+*/
+CItemData *CTreeManager::GetListItem(int iIndex)
+{
+    if (m_pListNode == NULL || iIndex < 0 || iIndex >= (int)m_pListNode->m_ListIndex.size())
+        return NULL;
 
-        m_pListView->InsertItem(&lvi);
-    }
+    return m_pListNode->m_ListIndex[iIndex];
+}
 
-    std::list <CItemData *>::iterator itFileObject;
-    for (itFileObject = pNode->m_Files.begin(); itFileObject != pNode->m_Files.end(); itFileObject++)
+/*
+    CTreeManager::FindListItem
+    --------------------------
+    Searches the list view items for a file name, starting at iStart and
+    wrapping around at the end of the list. Returns the item index or -1 if
+    no item was found.
+*/
+int CTreeManager::FindListItem(const TCHAR *szName,int iStart,bool bPartial)
+{
+    if (m_pListNode == NULL || m_pListNode->m_ListIndex.size() == 0)
+        return -1;
+
+    int iCount = (int)m_pListNode->m_ListIndex.size();
+    int iNameLen = lstrlen(szName);
+
+    if (iStart < 0 || iStart >= iCount)
+        iStart = 0;
+
+    for (int i = 0; i < iCount; i++)
     {
-        // Add the item to the listview.
-        LVITEM lvi = { 0 };
-        lvi.mask = LVIF_TEXT | LVIF_IMAGE | LVIF_PARAM;
+        int iIndex = (iStart + i) % iCount;
+        const TCHAR *szFileName = m_pListNode->m_ListIndex[iIndex]->GetFileName();
 
-        lvi.iItem = uiItemCount++;
-        lvi.iSubItem = 0;
-        lvi.pszText = LPSTR_TEXTCALLBACK;
-        lvi.cchTextMax = MAX_PATH - 1;
-        lvi.iImage = I_IMAGECALLBACK;
-        lvi.lParam = (LPARAM)*itFileObject;
+        if (bPartial)
+        {
+            int iFileNameLen = lstrlen(szFileName);
+            if (iFileNameLen > iNameLen)
+                iFileNameLen = iNameLen;
 
-        m_pListView->InsertItem(&lvi);
+            if (CompareString(LOCALE_USER_DEFAULT,NORM_IGNORECASE,szFileName,
+                iFileNameLen,szName,iNameLen) == CSTR_EQUAL)
+            {
+                return iIndex;
+            }
+        }
+        else if (!lstrcmpi(szFileName,szName))
+        {
+            return iIndex;
+        }
     }
+
+    return -1;
 }
 
 void CTreeManager::SelectPath(const TCHAR *szPath)
@@ -679,6 +763,8 @@ void CTreeManager::DestroyTree()
     // If the root node hasn't yet been free we free it.
     if (m_pRootNode)
     {
+        m_pListNode = NULL;
+
         delete m_pRootNode;
         m_pRootNode = NULL;
     }
@@ -738,6 +824,7 @@ bool CTreeManager::RemoveEntry(CProjectNode *pNode)
 
     // Delete the node.
     m_pTreeView->DeleteItem(pNode->m_hTreeItem);
+    UnlistNode(pNode);
 
     CProjectNode *pParent = (CProjectNode *)m_pTreeView->GetItemData(hParentItem);
     pParent->m_Children.remove(pNode);
@@ -776,6 +863,7 @@ bool CTreeManager::RemoveEntry(CProjectNode *pNode,CItemData *pItemData)
     {
         // Delete the node.
         m_pTreeView->DeleteItem(pFoundNode->m_hTreeItem);
+        UnlistNode(pFoundNode);
 
         delete pFoundNode;
         pNode->m_Children.remove(pFoundNode);
@@ -1200,6 +1288,11 @@ void CTreeManager::RecursiveSetFlags(CProjectNode *pRootNode,unsigned char ucFla
 
 void CTreeManager::DeleteImportedItems(CProjectNode *pRootNode)
 {
+    // The cached checksums belong to the imported session.
+    ::EnterCriticalSection(&m_csChecksums);
+    m_ImportedChecksums.clear();
+    ::LeaveCriticalSection(&m_csChecksums);
+
     // Select the root.
     m_pTreeView->SelectItem(pRootNode->m_hTreeItem);
 
@@ -1432,11 +1525,144 @@ void CTreeManager::SaveNodeAudioData(CXmlProcessor *pXml,CProjectNode *pRootNode
     }
 }
 
+/*
+    CTreeManager::ValidateFiles
+    ---------------------------
+    Checks that the files in the specified range exist and refreshes their
+    sizes and modified times. This function is safe to call from any thread
+    as long as the ranges do not overlap.
+*/
+void CTreeManager::ValidateFiles(std::vector<CPendingFile> &Files,unsigned int uiBegin,
+                                 unsigned int uiEnd)
+{
+    for (unsigned int i = uiBegin; i < uiEnd; i++)
+    {
+        CItemData *pItemData = Files[i].m_pItemData;
+
+        WIN32_FILE_ATTRIBUTE_DATA FileData;
+        if (!GetFileAttributesEx(pItemData->szFullPath,GetFileExInfoStandard,&FileData) ||
+            (FileData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+        {
+            Files[i].m_bExist = false;
+            continue;
+        }
+
+        Files[i].m_bExist = true;
+
+        // Size.
+        pItemData->uiSize = ((unsigned __int64)FileData.nFileSizeHigh << 32) |
+            FileData.nFileSizeLow;
+
+        // Modified time.
+        FILETIME LocalFileTime;
+        if (FileTimeToLocalFileTime(&FileData.ftLastWriteTime,&LocalFileTime) == TRUE)
+            FileTimeToDosDateTime(&LocalFileTime,&pItemData->usFileDate,&pItemData->usFileTime);
+    }
+}
+
+DWORD WINAPI CTreeManager::ValidateFilesThread(LPVOID lpParameter)
+{
+    CValidateBatch *pBatch = (CValidateBatch *)lpParameter;
+    ValidateFiles(*pBatch->m_pFiles,pBatch->m_uiBegin,pBatch->m_uiEnd);
+
+    return 0;
+}
+
+/*
+    CTreeManager::ValidateFiles
+    ---------------------------
+    Validates all pending files. The files are split into batches which are
+    validated in parallel since the time is dominated by file system round
+    trips, which can be slow on network shares.
+*/
+void CTreeManager::ValidateFiles(std::vector<CPendingFile> &Files)
+{
+    unsigned int uiFileCount = (unsigned int)Files.size();
+    unsigned int uiThreadCount = (uiFileCount + TREEMANAGER_VALIDATE_BATCHSIZE - 1) /
+        TREEMANAGER_VALIDATE_BATCHSIZE;
+    if (uiThreadCount > TREEMANAGER_VALIDATE_MAXTHREADS)
+        uiThreadCount = TREEMANAGER_VALIDATE_MAXTHREADS;
+
+    if (uiThreadCount <= 1)
+    {
+        ValidateFiles(Files,0,uiFileCount);
+        return;
+    }
+
+    CValidateBatch Batches[TREEMANAGER_VALIDATE_MAXTHREADS];
+    HANDLE hThreads[TREEMANAGER_VALIDATE_MAXTHREADS];
+    unsigned int uiStartedCount = 0;
+
+    unsigned int uiBatchSize = (uiFileCount + uiThreadCount - 1) / uiThreadCount;
+    for (unsigned int i = 0; i < uiThreadCount; i++)
+    {
+        Batches[i].m_pFiles = &Files;
+        Batches[i].m_uiBegin = i * uiBatchSize;
+        Batches[i].m_uiEnd = Batches[i].m_uiBegin + uiBatchSize;
+        if (Batches[i].m_uiEnd > uiFileCount)
+            Batches[i].m_uiEnd = uiFileCount;
+
+        unsigned long ulThreadID = 0;
+        HANDLE hThread = ::CreateThread(NULL,0,ValidateFilesThread,&Batches[i],0,&ulThreadID);
+
+        // Validate the batch in this thread if we're out of resources.
+        if (hThread == NULL)
+            ValidateFiles(Files,Batches[i].m_uiBegin,Batches[i].m_uiEnd);
+        else
+            hThreads[uiStartedCount++] = hThread;
+    }
+
+    WaitForMultipleObjects(uiStartedCount,hThreads,TRUE,INFINITE);
+
+    for (unsigned int i = 0; i < uiStartedCount; i++)
+        ::CloseHandle(hThreads[i]);
+}
+
+/*
+    CTreeManager::ReportMissingFiles
+    --------------------------------
+    Displays a single warning listing the project files that could not be
+    found.
+*/
+void CTreeManager::ReportMissingFiles(const std::vector<ckcore::tstring> &MissingFiles)
+{
+    if (MissingFiles.size() == 0)
+        return;
+
+    if (MissingFiles.size() == 1)
+    {
+        MessageBox(*g_pMainFrame,ckcore::string::formatstr(lngGetString(WARNING_MISSPROJFILE),
+                   MissingFiles[0].c_str()).c_str(),lngGetString(GENERAL_WARNING),MB_OK | MB_ICONWARNING);
+        return;
+    }
+
+    ckcore::tstring Message = lngGetString(WARNING_MISSPROJFILES);
+    Message += _T("\n");
+
+    for (unsigned int i = 0; i < MissingFiles.size(); i++)
+    {
+        if (i == TREEMANAGER_VALIDATE_MAXREPORT)
+        {
+            Message += _T("\n...");
+            break;
+        }
+
+        Message += _T("\n");
+        Message += MissingFiles[i];
+    }
+
+    MessageBox(*g_pMainFrame,Message.c_str(),lngGetString(GENERAL_WARNING),MB_OK | MB_ICONWARNING);
+}
+
 bool CTreeManager::LoadNodeFileData(CXmlProcessor *pXml,CProjectNode *pRootNode)
 {
     TCHAR szInternalName[MAX_PATH];
     TCHAR szFullName[MAX_PATH];
 
+    // The file system is not accessed until the complete structure has been
+    // loaded, at which point all files are validated in parallel.
+    std::vector<CPendingFile> PendingFiles;
+
     for (unsigned int i = 0; i < pXml->GetElementChildCount(); i++)
     {
         if (!pXml->EnterElement(i))
@@ -1453,16 +1679,6 @@ bool CTreeManager::LoadNodeFileData(CXmlProcessor *pXml,CProjectNode *pRootNode)
 
         pXml->GetSafeElementData(_T("FullPath"),szFullName,MAX_PATH - 1);
 
-        // Check that the file exist.
-        if (!(iFlags & PROJECTITEM_FLAG_ISFOLDER) && !ckcore::File::exist(szFullName))
-        {
-            MessageBox(*g_pMainFrame,ckcore::string::formatstr(lngGetString(WARNING_MISSPROJFILE),szFullName).c_str(),
-                       lngGetString(GENERAL_WARNING),MB_OK | MB_ICONWARNING);
-
-            pXml->LeaveElement();
-            continue;
-        }
-
         // File time.
         ULARGE_INTEGER iLocalFileTime;
         __int64 iTemp = 0;
@@ -1528,15 +1744,33 @@ bool CTreeManager::LoadNodeFileData(CXmlProcessor *pXml,CProjectNode *pRootNode)
             // Modified time.
             FileTimeToDosDateTime(&LocalFileTime,&pItemData->usFileDate,&pItemData->usFileTime);
 
-            // Size.
-            pItemData->uiSize = ckcore::File::size(szFullName);
-
-            pCurrentNode->m_Files.push_back(pItemData);
+            PendingFiles.push_back(CPendingFile(pCurrentNode,pItemData));
         }
 
         pXml->LeaveElement();
     }
 
+    // Validate the files, refresh their sizes and modified times and add the
+    // ones that still exist to the tree.
+    ValidateFiles(PendingFiles);
+
+    std::vector<ckcore::tstring> MissingFiles;
+
+    std::vector<CPendingFile>::iterator itPendingFile;
+    for (itPendingFile = PendingFiles.begin(); itPendingFile != PendingFiles.end(); itPendingFile++)
+    {
+        if (itPendingFile->m_bExist)
+        {
+            itPendingFile->m_pParentNode->m_Files.push_back(itPendingFile->m_pItemData);
+        }
+        else
+        {
+            MissingFiles.push_back(itPendingFile->m_pItemData->szFullPath);
+            delete itPendingFile->m_pItemData;
+        }
+    }
+
+    ReportMissingFiles(MissingFiles);
     return true;
 }
 
@@ -1547,6 +1781,8 @@ bool CTreeManager::LoadNodeAudioData(CXmlProcessor *pXml,CProjectNode *pRootNode
     TCHAR szInternalName[MAX_PATH];
     TCHAR szFullName[MAX_PATH];
 
+    std::vector<ckcore::tstring> MissingFiles;
+
     for (unsigned int i = 0; i < pXml->GetElementChildCount(); i++)
     {
         if (!pXml->EnterElement(i))
@@ -1574,8 +1810,8 @@ bool CTreeManager::LoadNodeAudioData(CXmlProcessor *pXml,CProjectNode *pRootNode
         // Check that the file exist.
         if (!ckcore::File::exist(szFullName))
         {
-            MessageBox(*g_pMainFrame,ckcore::string::formatstr(lngGetString(WARNING_MISSPROJFILE),szFullName).c_str(),
-                       lngGetString(GENERAL_WARNING),MB_OK | MB_ICONWARNING);
+            MissingFiles.push_back(szFullName);
+            delete pItemData;
 
             pXml->LeaveElement();
             continue;
@@ -1648,11 +1884,218 @@ bool CTreeManager::LoadNodeAudioData(CXmlProcessor *pXml,CProjectNode *pRootNode
         pXml->LeaveElement();
     }
 
+    ReportMissingFiles(MissingFiles);
     return true;
 }
 
+/*
+    CTreeManager::GetImportedChecksum
+    ---------------------------------
+    Calculates the CRC-32C checksum of the contents of an imported file by
+    reading its extent from the disc that the session was imported from. The
+    checksum is only read once for each imported file.
+*/
+bool CTreeManager::GetImportedChecksum(CItemData *pImportedData,ckcore::tuint32 &uiChecksum)
+{
+    if (g_ProjectSettings.m_pDevice == NULL)
+        return false;
+
+    CItemData::CIsoData *pIsoData = pImportedData->GetIsoData();
+
+    unsigned __int64 uiExtent = ((unsigned __int64)pIsoData->extent_loc_ << 32) |
+        pIsoData->extent_len_;
+
+    ::EnterCriticalSection(&m_csChecksums);
+    std::map<unsigned __int64,ckcore::tuint32>::const_iterator itChecksum =
+        m_ImportedChecksums.find(uiExtent);
+    bool bCached = itChecksum != m_ImportedChecksums.end();
+    if (bCached)
+        uiChecksum = itChecksum->second;
+    ::LeaveCriticalSection(&m_csChecksums);
+
+    if (bCached)
+        return true;
+
+    unsigned long ulStartBlock = pIsoData->extent_loc_;
+    unsigned long ulEndBlock = ulStartBlock + (pIsoData->extent_len_ + 2047) / 2048;
+
+    CCore2InStream InStream(g_pLogDlg,*g_ProjectSettings.m_pDevice,ulStartBlock,ulEndBlock);
+    CChecksumStream ChecksumStream(CHECKSUM_CRC32C);
+
+    unsigned char *pBuffer = new unsigned char[64 * 1024];
+    unsigned long ulRemaining = pIsoData->extent_len_;
+
+    while (ulRemaining > 0)
+    {
+        ckcore::tuint32 uiRead = ulRemaining < 64 * 1024 ? ulRemaining : 64 * 1024;
+        ckcore::tint64 iRead = InStream.read(pBuffer,uiRead);
+        if (iRead <= 0)
+            break;
+
+        ChecksumStream.write(pBuffer,(ckcore::tuint32)iRead);
+        ulRemaining -= (unsigned long)iRead;
+    }
+
+    delete [] pBuffer;
+
+    if (ulRemaining > 0)
+        return false;
+
+    uiChecksum = ChecksumStream.checksum();
+
+    ::EnterCriticalSection(&m_csChecksums);
+    m_ImportedChecksums[uiExtent] = uiChecksum;
+    ::LeaveCriticalSection(&m_csChecksums);
+
+    return true;
+}
+
+/*
+    CTreeManager::GetLocalChecksum
+    ------------------------------
+    Calculates the CRC-32C checksum of the contents of a local file. The
+    checksum is only calculated again if the size or the modification time
+    of the file has changed since it was last calculated.
+*/
+bool CTreeManager::GetLocalChecksum(const TCHAR *szFullPath,const WIN32_FILE_ATTRIBUTE_DATA &FileData,
+                                    ckcore::tuint32 &uiChecksum)
+{
+    unsigned __int64 uiSize = ((unsigned __int64)FileData.nFileSizeHigh << 32) |
+        FileData.nFileSizeLow;
+    unsigned __int64 uiModified = ((unsigned __int64)FileData.ftLastWriteTime.dwHighDateTime << 32) |
+        FileData.ftLastWriteTime.dwLowDateTime;
+
+    ::EnterCriticalSection(&m_csChecksums);
+    std::map<ckcore::tstring,CLocalChecksum>::const_iterator itChecksum =
+        m_LocalChecksums.find(szFullPath);
+    bool bCached = itChecksum != m_LocalChecksums.end() &&
+        itChecksum->second.m_uiSize == uiSize && itChecksum->second.m_uiModified == uiModified;
+    if (bCached)
+        uiChecksum = itChecksum->second.m_uiChecksum;
+    ::LeaveCriticalSection(&m_csChecksums);
+
+    if (bCached)
+        return true;
+
+    if (!ChecksumFile(szFullPath,CHECKSUM_CRC32C,uiChecksum))
+        return false;
+
+    ::EnterCriticalSection(&m_csChecksums);
+    m_LocalChecksums.erase(szFullPath);
+    m_LocalChecksums.insert(std::make_pair(ckcore::tstring(szFullPath),
+        CLocalChecksum(uiSize,uiModified,uiChecksum)));
+    ::LeaveCriticalSection(&m_csChecksums);
+
+    return true;
+}
+
+/*
+    CTreeManager::IsUnchangedFile
+    -----------------------------
+    Returns true if the local file is unchanged since it was written to the
+    imported session. The size and the modification time of the file on the
+    hard drive must match the imported directory record and, if enabled in
+    the project settings, the contents must have the same checksum.
+*/
+bool CTreeManager::IsUnchangedFile(CItemData *pItemData,CItemData *pImportedData)
+{
+    // Use the current file information, the project may be older than the file.
+    WIN32_FILE_ATTRIBUTE_DATA FileData;
+    if (!GetFileAttributesEx(pItemData->szFullPath,GetFileExInfoStandard,&FileData))
+        return false;
+
+    unsigned __int64 uiSize = ((unsigned __int64)FileData.nFileSizeHigh << 32) |
+        FileData.nFileSizeLow;
+    if (uiSize != pImportedData->GetIsoData()->extent_len_)
+        return false;
+
+    FILETIME LocalFileTime;
+    unsigned short usFileDate = 0,usFileTime = 0;
+    if (FileTimeToLocalFileTime(&FileData.ftLastWriteTime,&LocalFileTime) == FALSE ||
+        FileTimeToDosDateTime(&LocalFileTime,&usFileDate,&usFileTime) == FALSE)
+    {
+        return false;
+    }
+
+    if (usFileDate != pImportedData->usFileDate || usFileTime != pImportedData->usFileTime)
+        return false;
+
+    if (!g_ProjectSettings.m_bDifferentialHash)
+        return true;
+
+    ckcore::tuint32 uiLocalChecksum = 0,uiImportedChecksum = 0;
+    if (!GetLocalChecksum(pItemData->szFullPath,FileData,uiLocalChecksum) ||
+        !GetImportedChecksum(pImportedData,uiImportedChecksum))
+    {
+        return false;
+    }
+
+    return uiLocalChecksum == uiImportedChecksum;
+}
+
+/*
+    CTreeManager::GetReplacedFiles
+    ------------------------------
+    Pairs the local files of the node with the imported files of the same
+    name. The imported files are named by the Joliet tree of the session when
+    it has one, which keeps the original names. If a local file is unchanged
+    it's linked to the extent of the imported file in LinkedFiles, otherwise
+    the local file replaces the imported one. The imported files are never
+    included in the file set in either case, they're added to ReplacedFiles.
+    If bLinkUnchanged is false the files are not compared and no files are
+    linked, the files are then not read.
+*/
+void CTreeManager::GetReplacedFiles(CProjectNode *pNode,std::set<CItemData *> &ReplacedFiles,
+                                    std::map<CItemData *,CItemData *> &LinkedFiles,
+                                    bool bLinkUnchanged)
+{
+    TCHAR szFileName[MAX_PATH];
+
+    std::map<ckcore::tstring,CItemData *> ImportedFiles;
+    std::list <CItemData *>::iterator itFileObject;
+    for (itFileObject = pNode->m_Files.begin(); itFileObject != pNode->m_Files.end(); itFileObject++)
+    {
+        if ((*itFileObject)->ucFlags & PROJECTITEM_FLAG_ISIMPORTED)
+        {
+            lstrcpy(szFileName,(*itFileObject)->GetFileName());
+            CharLowerBuff(szFileName,lstrlen(szFileName));
+
+            ImportedFiles[szFileName] = *itFileObject;
+        }
+    }
+
+    if (ImportedFiles.empty())
+        return;
+
+    for (itFileObject = pNode->m_Files.begin(); itFileObject != pNode->m_Files.end(); itFileObject++)
+    {
+        CItemData *pItemData = *itFileObject;
+        if (pItemData->ucFlags & PROJECTITEM_FLAG_ISIMPORTED)
+            continue;
+
+        lstrcpy(szFileName,pItemData->GetFileName());
+        CharLowerBuff(szFileName,lstrlen(szFileName));
+
+        std::map<ckcore::tstring,CItemData *>::iterator itImported = ImportedFiles.find(szFileName);
+        if (itImported == ImportedFiles.end())
+            continue;
+
+        // The local file keeps its name in either case.
+        ReplacedFiles.insert(itImported->second);
+
+        if (bLinkUnchanged && IsUnchangedFile(pItemData,itImported->second))
+        {
+            LinkedFiles[pItemData] = itImported->second;
+
+            m_uiLinkedFiles++;
+            m_uiLinkedBytes += itImported->second->GetIsoData()->extent_len_;
+        }
+    }
+}
+
 void CTreeManager::GetLocalPathList(ckfilesystem::FileSet &Files,CProjectNode *pNode,
-                                    std::vector<CProjectNode *> &FolderStack,int iPathStripLen)
+                                    std::vector<CProjectNode *> &FolderStack,int iPathStripLen,
+                                    bool bLinkUnchanged)
 {
     TCHAR szInternalFilePath[MAX_PATH];
     bool bHasChildren = false;
@@ -1700,6 +2143,13 @@ void CTreeManager::GetLocalPathList(ckfilesystem::FileSet &Files,CProjectNode *p
         fd.release();
     }
 
+    // In differential multi-session projects only one file of each pair of
+    // local and imported files with the same name is included.
+    std::set<CItemData *> ReplacedFiles;
+    std::map<CItemData *,CItemData *> LinkedFiles;
+    if (g_ProjectSettings.m_bMultiSession && g_ProjectSettings.m_bDifferential)
+        GetReplacedFiles(pNode,ReplacedFiles,LinkedFiles,bLinkUnchanged);
+
     std::list <CItemData *>::iterator itFileObject;
     for (itFileObject = pNode->m_Files.begin(); itFileObject != pNode->m_Files.end(); itFileObject++)
     {
@@ -1711,6 +2161,9 @@ void CTreeManager::GetLocalPathList(ckfilesystem::FileSet &Files,CProjectNode *p
 
         bHasChildren = true;
 
+        if (ReplacedFiles.find(pItemData) != ReplacedFiles.end())
+            continue;
+
         // Force slash delimiters (no backslash delimiters allowed).
         TCHAR *szFilePathBuffer = pItemData->BeginEditFilePath();
             ForceSlashDelimiters(szFilePathBuffer + iPathStripLen);
@@ -1721,10 +2174,17 @@ void CTreeManager::GetLocalPathList(ckfilesystem::FileSet &Files,CProjectNode *p
         lstrcpy(szInternalFilePath,pItemData->GetFilePath() + iPathStripLen);
         lstrcat(szInternalFilePath,pItemData->GetFileName());
 
-        // Handle import data.
+        // Handle import data. Linked local files refer to the extent of the
+        // imported file.
         unsigned char ucFlags = 0;
         void *pData = NULL;
-        if (pItemData->ucFlags & PROJECTITEM_FLAG_ISIMPORTED)
+        std::map<CItemData *,CItemData *>::iterator itLinked = LinkedFiles.find(pItemData);
+        if (itLinked != LinkedFiles.end())
+        {
+            ucFlags |= ckfilesystem::FileDescriptor::FLAG_IMPORTED;
+            pData = itLinked->second->GetIsoData();
+        }
+        else if (pItemData->ucFlags & PROJECTITEM_FLAG_ISIMPORTED)
         {
             ucFlags |= ckfilesystem::FileDescriptor::FLAG_IMPORTED;
             pData = pItemData->GetIsoData();
@@ -1780,27 +2240,284 @@ void CTreeManager::GetLocalPathList(ckfilesystem::FileSet &Files,CProjectNode *p
     }
 }
 
-void CTreeManager::GetPathList(ckfilesystem::FileSet &Files,CProjectNode *pRootNode,int iPathStripLen)
+/*
+    CTreeManager::GetPathList
+    -------------------------
+    Collects the files and folders of the project in Files. In differential
+    multi-session projects unchanged local files are linked to the imported
+    session, which requires the files to be compared with the disc unless
+    bLinkUnchanged is false. The file set is then only suitable for
+    examining the local files.
+*/
+void CTreeManager::GetPathList(ckfilesystem::FileSet &Files,CProjectNode *pRootNode,int iPathStripLen,
+                               bool bLinkUnchanged)
 {
     CProjectNode *pCurNode = pRootNode;
 
+    m_uiLinkedFiles = 0;
+    m_uiLinkedBytes = 0;
+
     // Save the information.
     std::vector<CProjectNode *> FolderStack;
-    GetLocalPathList(Files,pCurNode,FolderStack,iPathStripLen);
+    GetLocalPathList(Files,pCurNode,FolderStack,iPathStripLen,bLinkUnchanged);
 
     while (FolderStack.size() > 0)
     { 
         pCurNode = FolderStack[FolderStack.size() - 1];
         FolderStack.pop_back();
 
-        GetLocalPathList(Files,pCurNode,FolderStack,iPathStripLen);
+        GetLocalPathList(Files,pCurNode,FolderStack,iPathStripLen,bLinkUnchanged);
+    }
+
+    if (g_ProjectSettings.m_bMultiSession && g_ProjectSettings.m_bDifferential && bLinkUnchanged)
+    {
+        g_pLogDlg->print_line(_T("  Differential session: %u unchanged files (%I64u bytes) linked to the imported session."),
+            m_uiLinkedFiles,m_uiLinkedBytes);
+    }
+}
+
+/*
+    A directory record of the Joliet tree of an imported session.
+*/
+class CJolietRecord
+{
+public:
+    ckcore::tstring m_FileName;
+    unsigned long m_ulExtentLoc;
+    unsigned long m_ulExtentLen;
+    bool m_bDirectory;
+    bool m_bPaired;
+
+    CJolietRecord(const ckcore::tstring &FileName,unsigned long ulExtentLoc,
+        unsigned long ulExtentLen,bool bDirectory) : m_FileName(FileName),
+        m_ulExtentLoc(ulExtentLoc),m_ulExtentLen(ulExtentLen),m_bDirectory(bDirectory),
+        m_bPaired(false)
+    {
+    }
+};
+
+static bool ReadSector(ckcore::InStream &InStream,unsigned long ulSector,unsigned char *pBuffer)
+{
+    // The stream can only seek 32-bit distances at a time.
+    if (!InStream.seek(0,ckcore::InStream::ckSTREAM_BEGIN))
+        return false;
+
+    for (unsigned long ulRemaining = ulSector; ulRemaining > 0;)
+    {
+        unsigned long ulSectors = min(ulRemaining,(unsigned long)0x100000);
+        if (!InStream.seek(ulSectors * 2048,ckcore::InStream::ckSTREAM_CURRENT))
+            return false;
+
+        ulRemaining -= ulSectors;
+    }
+
+    return InStream.read(pBuffer,2048) == 2048;
+}
+
+/*
+    Reads the records of a Joliet directory, the current and the parent
+    directory records are excluded. Returns false if the directory can't be
+    read.
+*/
+static bool ReadJolietDirectory(ckcore::InStream &InStream,unsigned long ulExtentLoc,
+                                unsigned long ulExtentLen,std::vector<CJolietRecord> &Records)
+{
+    unsigned char ucSector[2048];
+
+    unsigned long ulEndSector = ulExtentLoc + (ulExtentLen + 2047) / 2048;
+    for (unsigned long ulSector = ulExtentLoc; ulSector < ulEndSector; ulSector++)
+    {
+        if (!ReadSector(InStream,ulSector,ucSector))
+            return false;
+
+        // Directory records don't cross sector boundaries.
+        unsigned long ulPos = 0;
+        while (ulPos + 33 <= sizeof(ucSector) && ucSector[ulPos] != 0)
+        {
+            const unsigned char *pRecord = ucSector + ulPos;
+            unsigned char ucRecordLen = pRecord[0];
+            unsigned char ucNameLen = pRecord[32];
+            if (ulPos + ucRecordLen > sizeof(ucSector) || 33 + ucNameLen > ucRecordLen)
+                return false;
+
+            ulPos += ucRecordLen;
+
+            // The current and parent directory records.
+            if (ucNameLen == 1 && pRecord[33] <= 1)
+                continue;
+
+            // The names are stored in UCS-2 big-endian, without the version.
+            ckcore::tstring FileName;
+            for (unsigned char j = 0; j + 1 < ucNameLen; j += 2)
+            {
+                ckcore::tchar c = (ckcore::tchar)(pRecord[33 + j] << 8 | pRecord[33 + j + 1]);
+                if (c == ';')
+                    break;
+
+                FileName.push_back(c);
+            }
+
+            Records.push_back(CJolietRecord(FileName,
+                pRecord[2] | (pRecord[3] << 8) | (pRecord[4] << 16) | (pRecord[5] << 24),
+                pRecord[10] | (pRecord[11] << 8) | (pRecord[12] << 16) | (pRecord[13] << 24),
+                (pRecord[25] & DIRRECORD_FILEFLAG_DIRECTORY) != 0));
+        }
+    }
+
+    return true;
+}
+
+/*
+    CTreeManager::ReadJolietNames
+    -----------------------------
+    Reads the Joliet tree of the session that the ISO9660 tree was read from
+    and collects the Joliet name of each of its entries, which is the
+    original name of the file. Files are paired by their extent, which is
+    shared by both trees. Directories are paired by the extent of their
+    first file, or by name if they don't have any files. Entries that can't
+    be paired are left out. Returns false if the session has no Joliet tree
+    or if it can't be read.
+*/
+bool CTreeManager::ReadJolietNames(ckcore::InStream &InStream,unsigned long ulSessionStart,
+                                   ckfilesystem::IsoTreeNode *pIsoRootNode,
+                                   std::map<ckfilesystem::IsoTreeNode *,ckcore::tstring> &JolietNames)
+{
+    unsigned char ucSector[2048];
+    unsigned long ulRootLoc = 0,ulRootLen = 0;
+
+    // Locate the Joliet supplementary volume descriptor.
+    for (unsigned long ulSector = ulSessionStart + 16; ulRootLen == 0; ulSector++)
+    {
+        if (!ReadSector(InStream,ulSector,ucSector))
+            return false;
+
+        // Volume descriptor set terminator.
+        if (ucSector[0] == 0xFF || memcmp(ucSector + 1,"CD001",5))
+            return false;
+
+        if (ucSector[0] == 0x02 && ucSector[88] == 0x25 && ucSector[89] == 0x2F &&
+            (ucSector[90] == 0x40 || ucSector[90] == 0x43 || ucSector[90] == 0x45))
+        {
+            ulRootLoc = ucSector[158] | (ucSector[159] << 8) | (ucSector[160] << 16) | (ucSector[161] << 24);
+            ulRootLen = ucSector[166] | (ucSector[167] << 8) | (ucSector[168] << 16) | (ucSector[169] << 24);
+        }
+    }
+
+    std::vector<std::pair<ckfilesystem::IsoTreeNode *,std::vector<CJolietRecord> > > FolderStack;
+    FolderStack.push_back(std::make_pair(pIsoRootNode,std::vector<CJolietRecord>()));
+    if (!ReadJolietDirectory(InStream,ulRootLoc,ulRootLen,FolderStack.back().second))
+        return false;
+
+    while (FolderStack.size() > 0)
+    {
+        ckfilesystem::IsoTreeNode *pIsoNode = FolderStack.back().first;
+
+        std::vector<CJolietRecord> Records;
+        Records.swap(FolderStack.back().second);
+        FolderStack.pop_back();
+
+        std::vector<ckfilesystem::IsoTreeNode *>::const_iterator itIsoNode;
+        for (itIsoNode = pIsoNode->children_.begin(); itIsoNode != pIsoNode->children_.end(); itIsoNode++)
+        {
+            if ((*itIsoNode)->file_flags_ & DIRRECORD_FILEFLAG_DIRECTORY)
+                continue;
+
+            // Identical files may share an extent, prefer the record with the
+            // same name in that case.
+            CJolietRecord *pRecord = NULL;
+            for (unsigned int i = 0; i < Records.size(); i++)
+            {
+                if (Records[i].m_bDirectory || Records[i].m_bPaired ||
+                    Records[i].m_ulExtentLoc != (*itIsoNode)->extent_loc_ ||
+                    Records[i].m_ulExtentLen != (*itIsoNode)->extent_len_)
+                {
+                    continue;
+                }
+
+                if (pRecord == NULL ||
+                    !lstrcmpi(Records[i].m_FileName.c_str(),(*itIsoNode)->file_name_.c_str()))
+                {
+                    pRecord = &Records[i];
+                }
+            }
+
+            if (pRecord != NULL)
+            {
+                pRecord->m_bPaired = true;
+                JolietNames[*itIsoNode] = pRecord->m_FileName;
+            }
+        }
+
+        for (itIsoNode = pIsoNode->children_.begin(); itIsoNode != pIsoNode->children_.end(); itIsoNode++)
+        {
+            if (!((*itIsoNode)->file_flags_ & DIRRECORD_FILEFLAG_DIRECTORY))
+                continue;
+
+            ckfilesystem::IsoTreeNode *pFirstFile = NULL;
+            std::vector<ckfilesystem::IsoTreeNode *>::const_iterator itChild;
+            for (itChild = (*itIsoNode)->children_.begin(); itChild != (*itIsoNode)->children_.end(); itChild++)
+            {
+                if (!((*itChild)->file_flags_ & DIRRECORD_FILEFLAG_DIRECTORY) && (*itChild)->extent_len_ > 0)
+                {
+                    pFirstFile = *itChild;
+                    break;
+                }
+            }
+
+            for (unsigned int i = 0; i < Records.size(); i++)
+            {
+                if (!Records[i].m_bDirectory || Records[i].m_bPaired)
+                    continue;
+
+                if (pFirstFile == NULL && lstrcmpi(Records[i].m_FileName.c_str(),(*itIsoNode)->file_name_.c_str()))
+                    continue;
+
+                std::vector<CJolietRecord> SubRecords;
+                if (!ReadJolietDirectory(InStream,Records[i].m_ulExtentLoc,Records[i].m_ulExtentLen,SubRecords))
+                    continue;
+
+                bool bMatch = pFirstFile == NULL;
+                for (unsigned int j = 0; j < SubRecords.size() && !bMatch; j++)
+                {
+                    bMatch = !SubRecords[j].m_bDirectory &&
+                        SubRecords[j].m_ulExtentLoc == pFirstFile->extent_loc_ &&
+                        SubRecords[j].m_ulExtentLen == pFirstFile->extent_len_;
+                }
+
+                if (bMatch)
+                {
+                    Records[i].m_bPaired = true;
+                    JolietNames[*itIsoNode] = Records[i].m_FileName;
+
+                    FolderStack.push_back(std::make_pair(*itIsoNode,std::vector<CJolietRecord>()));
+                    FolderStack.back().second.swap(SubRecords);
+                    break;
+                }
+            }
+        }
     }
+
+    return true;
+}
+
+/*
+    Returns the name of an imported entry, the Joliet name if it's known and
+    the ISO9660 name otherwise.
+*/
+static const TCHAR *GetImportedName(ckfilesystem::IsoTreeNode *pIsoNode,
+                                    const std::map<ckfilesystem::IsoTreeNode *,ckcore::tstring> &JolietNames)
+{
+    std::map<ckfilesystem::IsoTreeNode *,ckcore::tstring>::const_iterator itName =
+        JolietNames.find(pIsoNode);
+
+    return itName != JolietNames.end() ? itName->second.c_str() : pIsoNode->file_name_.c_str();
 }
 
 void CTreeManager::ImportLocalIsoTree(ckfilesystem::IsoTreeNode *pLocalIsoNode,
                                       CProjectNode *pLocalNode,
                                       std::vector<std::pair<ckfilesystem::IsoTreeNode *,
-                                      CProjectNode *> > &FolderStack)
+                                      CProjectNode *> > &FolderStack,
+                                      const std::map<ckfilesystem::IsoTreeNode *,ckcore::tstring> &JolietNames)
 {
     std::vector<ckfilesystem::IsoTreeNode *>::const_iterator itIsoNode;
     for (itIsoNode = pLocalIsoNode->children_.begin(); itIsoNode !=
@@ -1814,7 +2531,7 @@ void CTreeManager::ImportLocalIsoTree(ckfilesystem::IsoTreeNode *pLocalIsoNode,
             std::list<CProjectNode *>::const_iterator itNode;
             for (itNode = pLocalNode->m_Children.begin(); itNode != pLocalNode->m_Children.end(); itNode++)
             {
-                if (!lstrcmpi((*itNode)->pItemData->GetFileName(),(*itIsoNode)->file_name_.c_str()))
+                if (!lstrcmpi((*itNode)->pItemData->GetFileName(),GetImportedName(*itIsoNode,JolietNames)))
                 {
                     pCurNode = *itNode;
                     break;
@@ -1826,7 +2543,7 @@ void CTreeManager::ImportLocalIsoTree(ckfilesystem::IsoTreeNode *pLocalIsoNode,
             {
                 pCurNode = new CProjectNode(pLocalNode);
                 pCurNode->pItemData->ucFlags |= PROJECTITEM_FLAG_ISIMPORTED;
-                pCurNode->pItemData->SetFileName((*itIsoNode)->file_name_.c_str());
+                pCurNode->pItemData->SetFileName(GetImportedName(*itIsoNode,JolietNames));
 
                 TCHAR *szFilePath = pCurNode->pItemData->BeginEditFilePath();
                 lstrcpy(szFilePath,pLocalNode->pItemData->GetFilePath());
@@ -1873,7 +2590,7 @@ void CTreeManager::ImportLocalIsoTree(ckfilesystem::IsoTreeNode *pLocalIsoNode,
             CItemData *pItemData = new CItemData();
             pItemData->ucFlags |= PROJECTITEM_FLAG_ISIMPORTED;
             pItemData->uiSize = (*itIsoNode)->extent_len_;
-            pItemData->SetFileName((*itIsoNode)->file_name_.c_str());
+            pItemData->SetFileName(GetImportedName(*itIsoNode,JolietNames));
 
             TCHAR *szFilePath = pItemData->BeginEditFilePath();
             lstrcpy(szFilePath,pLocalNode->pItemData->GetFilePath());
@@ -1903,11 +2620,24 @@ void CTreeManager::ImportLocalIsoTree(ckfilesystem::IsoTreeNode *pLocalIsoNode,
     }
 }
 
-void CTreeManager::ImportIsoTree(ckfilesystem::IsoTreeNode *pIsoRootNode,CProjectNode *pRootNode)
+/*
+    CTreeManager::ImportIsoTree
+    ---------------------------
+    Adds the entries of an imported ISO9660 tree to the project. The entries
+    are named by JolietNames when the session has a Joliet tree, see
+    ReadJolietNames.
+*/
+void CTreeManager::ImportIsoTree(ckfilesystem::IsoTreeNode *pIsoRootNode,CProjectNode *pRootNode,
+                                 const std::map<ckfilesystem::IsoTreeNode *,ckcore::tstring> &JolietNames)
 {
+    // The session may have been imported from another disc.
+    ::EnterCriticalSection(&m_csChecksums);
+    m_ImportedChecksums.clear();
+    ::LeaveCriticalSection(&m_csChecksums);
+
     // Save the information.
     std::vector<std::pair<ckfilesystem::IsoTreeNode *,CProjectNode *> > FolderStack;
-    ImportLocalIsoTree(pIsoRootNode,pRootNode,FolderStack);
+    ImportLocalIsoTree(pIsoRootNode,pRootNode,FolderStack,JolietNames);
 
     while (FolderStack.size() > 0)
     { 
@@ -1916,6 +2646,6 @@ void CTreeManager::ImportIsoTree(ckfilesystem::IsoTreeNode *pIsoRootNode,CProjec
 
         FolderStack.pop_back();
 
-        ImportLocalIsoTree(pIsoNode,pNode,FolderStack);
+        ImportLocalIsoTree(pIsoNode,pNode,FolderStack,JolietNames);
     }
 }
\ No newline at end of file
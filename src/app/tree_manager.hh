@@ -18,6 +18,8 @@
 
 #pragma once
 #include <list>
+#include <map>
+#include <set>
 #include <vector>
 #include <ckfilesystem/fileset.hh>
 #include <ckfilesystem/isoreader.hh>
@@ -31,6 +33,10 @@
 #define PROJECTITEM_FLAG_ISDVDVIDEO					8
 #define PROJECTITEM_FLAG_ISPROJECTROOT				16
 
+#define TREEMANAGER_VALIDATE_BATCHSIZE				256
+#define TREEMANAGER_VALIDATE_MAXTHREADS				32
+#define TREEMANAGER_VALIDATE_MAXREPORT				20
+
 class CProjectNode;
 
 // This structure represents a file (or folder) inside the project view.
@@ -115,6 +121,10 @@ public:
     int iIconIndex;
     HTREEITEM m_hTreeItem;
 
+    // Contiguous index of the children followed by the files, in sort order.
+    // The project list view is a virtual list view reading from this index.
+    std::vector<CItemData *> m_ListIndex;
+
     CProjectNode(CProjectNode *pParent)
     {
         m_pParent = pParent;
@@ -145,6 +155,7 @@ public:
     }
 
     void Sort(unsigned int uiSortColumn,bool bSortUp,bool bSortAudio);
+    void UpdateListIndex();
 };
 
 class CChildComparator
@@ -186,14 +197,65 @@ public:
 class CTreeManager
 {
 private:
+    // A file loaded from a project that has not yet been validated.
+    class CPendingFile
+    {
+    public:
+        CProjectNode *m_pParentNode;
+        CItemData *m_pItemData;
+        bool m_bExist;
+
+        CPendingFile(CProjectNode *pParentNode,CItemData *pItemData) :
+            m_pParentNode(pParentNode),m_pItemData(pItemData),m_bExist(false)
+        {
+        }
+    };
+
+    // A range of pending files validated by a single thread.
+    class CValidateBatch
+    {
+    public:
+        std::vector<CPendingFile> *m_pFiles;
+        unsigned int m_uiBegin;
+        unsigned int m_uiEnd;
+    };
+
     CTreeViewCtrlEx *m_pTreeView;
     CListViewCtrl *m_pListView;
 
     CProjectNode *m_pRootNode;
     CProjectNode *m_pCurrentNode;
+    CProjectNode *m_pListNode;		// The node displayed in the list view.
 
     TCHAR m_szCurrentPath[MAX_PATH];
 
+    // Files linked to the imported session by the last call to GetPathList.
+    unsigned int m_uiLinkedFiles;
+    unsigned __int64 m_uiLinkedBytes;
+
+    // Checksum of a local file, valid as long as the file keeps the same
+    // size and modification time.
+    class CLocalChecksum
+    {
+    public:
+        unsigned __int64 m_uiSize;
+        unsigned __int64 m_uiModified;
+        ckcore::tuint32 m_uiChecksum;
+
+        CLocalChecksum(unsigned __int64 uiSize,unsigned __int64 uiModified,
+            ckcore::tuint32 uiChecksum) : m_uiSize(uiSize),m_uiModified(uiModified),
+            m_uiChecksum(uiChecksum)
+        {
+        }
+    };
+
+    // Checksums of the imported files that have been read from the disc,
+    // indexed by the extent location and length of the file, and of the
+    // local files they have been compared with, indexed by the full path.
+    std::map<unsigned __int64,ckcore::tuint32> m_ImportedChecksums;
+    std::map<ckcore::tstring,CLocalChecksum> m_LocalChecksums;
+    CRITICAL_SECTION m_csChecksums;
+
     HTREEITEM GetTreeChildFromParent(HTREEITEM hParentItem,TCHAR *szText);
     bool HasChildren(HTREEITEM hItem,bool bHasChildren);
 
@@ -202,6 +264,7 @@ private:
     CProjectNode *GetChildFromParent(CProjectNode *pParentNode,const TCHAR *szText);
 
     void ListNode(CProjectNode *pNode);
+    void UnlistNode(CProjectNode *pNode);
 
     void RebuildLocalPaths(CProjectNode *pNode,std::vector<CProjectNode *> &FolderStack);
     unsigned __int64 GetLocalSizeFromNode(CProjectNode *pNode,std::vector<CProjectNode *> &FolderStack);
@@ -211,13 +274,25 @@ private:
         unsigned int uiRootLength);
 
     void GetLocalPathList(ckfilesystem::FileSet &Files,CProjectNode *pNode,
-        std::vector<CProjectNode *> &FolderStack,int iPathStripLen);
+        std::vector<CProjectNode *> &FolderStack,int iPathStripLen,bool bLinkUnchanged);
+    bool GetImportedChecksum(CItemData *pImportedData,ckcore::tuint32 &uiChecksum);
+    bool GetLocalChecksum(const TCHAR *szFullPath,const WIN32_FILE_ATTRIBUTE_DATA &FileData,
+        ckcore::tuint32 &uiChecksum);
+    bool IsUnchangedFile(CItemData *pItemData,CItemData *pImportedData);
+    void GetReplacedFiles(CProjectNode *pNode,std::set<CItemData *> &ReplacedFiles,
+        std::map<CItemData *,CItemData *> &LinkedFiles,bool bLinkUnchanged);
 
     void GetLocalNodeContents(CProjectNode *pNode,std::vector<CProjectNode *> &FolderStack,
         unsigned __int64 &uiFileCount,unsigned __int64 &uiNodeCount);
     void RecursiveLocalSetFlags(CProjectNode *pNode,std::vector<CProjectNode *> &FolderStack,
         unsigned char ucFlags);
 
+    static void ValidateFiles(std::vector<CPendingFile> &Files,unsigned int uiBegin,
+        unsigned int uiEnd);
+    static DWORD WINAPI ValidateFilesThread(LPVOID lpParameter);
+    void ValidateFiles(std::vector<CPendingFile> &Files);
+    void ReportMissingFiles(const std::vector<ckcore::tstring> &MissingFiles);
+
 public:
     CTreeManager();
     ~CTreeManager();
@@ -250,6 +325,8 @@ public:
     CProjectNode *GetRootNode();
     CProjectNode *GetDirFromParent(CProjectNode *pParent,TCHAR *szText);
     CProjectNode *GetNodeFromPath(const TCHAR *szPath);
+    CItemData *GetListItem(int iIndex);
+    int FindListItem(const TCHAR *szName,int iStart,bool bPartial);
 
     unsigned __int64 GetNodeSize(CProjectNode *pNode);
     unsigned __int64 GetNodeSize(CProjectNode *pParentNode,CItemData *pItemData);
@@ -269,11 +346,18 @@ public:
     bool LoadNodeFileData(CXmlProcessor *pXml,CProjectNode *pRootNode);
     bool LoadNodeAudioData(CXmlProcessor *pXml,CProjectNode *pRootNode,int iProjectType);
 
-    void GetPathList(ckfilesystem::FileSet &Files,CProjectNode *pRootNode,int iPathStripLen = 0);
+    void GetPathList(ckfilesystem::FileSet &Files,CProjectNode *pRootNode,int iPathStripLen = 0,
+        bool bLinkUnchanged = true);
 
     void ImportLocalIsoTree(ckfilesystem::IsoTreeNode *pLocalIsoNode,CProjectNode *pLocalNode,
-        std::vector<std::pair<ckfilesystem::IsoTreeNode *,CProjectNode *> > &FolderStack);
-    void ImportIsoTree(ckfilesystem::IsoTreeNode *pIsoRootNode,CProjectNode *pRootNode);
+        std::vector<std::pair<ckfilesystem::IsoTreeNode *,CProjectNode *> > &FolderStack,
+        const std::map<ckfilesystem::IsoTreeNode *,ckcore::tstring> &JolietNames);
+    void ImportIsoTree(ckfilesystem::IsoTreeNode *pIsoRootNode,CProjectNode *pRootNode,
+        const std::map<ckfilesystem::IsoTreeNode *,ckcore::tstring> &JolietNames);
+
+    static bool ReadJolietNames(ckcore::InStream &InStream,unsigned long ulSessionStart,
+        ckfilesystem::IsoTreeNode *pIsoRootNode,
+        std::map<ckfilesystem::IsoTreeNode *,ckcore::tstring> &JolietNames);
 };
 
 extern CTreeManager g_TreeManager;
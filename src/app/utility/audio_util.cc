@@ -19,6 +19,9 @@
 #include "stdafx.hh"
 #include <ckcore/file.hh>
 #include <base/string_util.hh>
+#include "infrarecorder.hh"
+#include "string_table.hh"
+#include "lang_util.hh"
 #include "audio_util.hh"
 
 bool IsWave(const TCHAR *szFileName)
@@ -69,6 +72,125 @@ int GetAudioLength(const TCHAR *szFileName)
     return _wtoi(szLength);
 }
 
+/*
+    EncodeAudioFile
+    ---------------
+    Encodes an audio file using the specified encoder. The encoded file is
+    written next to the source file, with the file extension of the encoder.
+    Returns false if the file could not be encoded or if the operation was
+    cancelled, the incomplete encoded file is then removed.
+*/
+bool EncodeAudioFile(const TCHAR *szFileName,CCodec *pEncoder,ckcore::Progress &Progress)
+{
+    // Find which codec that can be uses for decoding the source file.
+    CCodec *pDecoder = NULL;
+
+    // Source file information.
+    int iNumChannels = -1;
+    int iSampleRate = -1;
+    int iBitRate = -1;
+    unsigned __int64 uiDuration = 0;
+
+    for (unsigned int i = 0; i < g_CodecManager.m_Codecs.size(); i++)
+    {
+        // We're only interested in decoders.
+        if ((g_CodecManager.m_Codecs[i]->irc_capabilities() & IRC_HAS_DECODER) == 0)
+            continue;
+
+        if (g_CodecManager.m_Codecs[i]->irc_decode_init(szFileName,iNumChannels,
+            iSampleRate,iBitRate,uiDuration))
+        {
+            pDecoder = g_CodecManager.m_Codecs[i];
+            break;
+        }
+    }
+
+    if (pDecoder == NULL)
+    {
+        TCHAR szNameBuffer[MAX_PATH];
+        lstrcpy(szNameBuffer,szFileName);
+        ExtractFileName(szNameBuffer);
+
+        Progress.notify(ckcore::Progress::ckERROR,lngGetString(ERROR_NODECODER),szNameBuffer);
+        return false;
+    }
+
+    // Setup the encoder.
+    TCHAR szTargetFile[MAX_PATH];
+    lstrcpy(szTargetFile,szFileName);
+    ChangeFileExt(szTargetFile,pEncoder->irc_string(IRC_STR_FILEEXT));
+
+    // Initialize the encoder.
+    if (!pEncoder->irc_encode_init(szTargetFile,iNumChannels,iSampleRate,iBitRate))
+    {
+        Progress.notify(ckcore::Progress::ckERROR,lngGetString(ERROR_CODECINIT),
+            pEncoder->irc_string(IRC_STR_ENCODER),
+            iNumChannels,iSampleRate,iBitRate,uiDuration);
+
+        pDecoder->irc_decode_exit();
+        return false;
+    }
+
+    // Encode/decode-process.
+    __int64 iBytesRead = 0;
+    unsigned __int64 uiCurrentTime = 0;
+    bool bResult = true;
+
+#define ENCODE_BUFFER_FACTOR		1024
+
+    // Allocate buffer memory.
+    unsigned int uiBufferSize = iNumChannels * ((iBitRate / iSampleRate) >> 3) * ENCODE_BUFFER_FACTOR;
+    unsigned char *pBuffer = new unsigned char[uiBufferSize];
+
+    while (true)
+    {
+        if (Progress.cancelled())
+        {
+            bResult = false;
+            break;
+        }
+
+        iBytesRead = pDecoder->irc_decode_process(pBuffer,uiBufferSize,uiCurrentTime);
+        if (iBytesRead <= 0)
+            break;
+
+        if (pEncoder->irc_encode_process(pBuffer,iBytesRead) < 0)
+        {
+            Progress.notify(ckcore::Progress::ckERROR,lngGetString(ERROR_ENCODEDATA));
+            bResult = false;
+            break;
+        }
+
+        // Update the progres bar.
+        unsigned char ucPercent = (unsigned char)(((double)uiCurrentTime/uiDuration) * 100);
+        Progress.set_progress(ucPercent);
+    }
+
+    // Free buffer memory.
+    delete [] pBuffer;
+
+    // Flush.
+    pEncoder->irc_encode_flush();
+    Progress.set_progress(100);
+
+    // Destroy the codecs.
+    pEncoder->irc_encode_exit();
+    pDecoder->irc_decode_exit();
+
+    if (!bResult)
+    {
+        ckcore::File::remove(szTargetFile);
+        return false;
+    }
+
+    ExtractFileName(szTargetFile);
+
+    Progress.notify(ckcore::Progress::ckINFORMATION,
+        lngGetString(SUCCESS_ENCODETRACK),szTargetFile);
+
+    return true;
+}
+
 /*int GetAudioInfo(const TCHAR *szFileName)
 {
     HANDLE hFile = fs_open(szFileName,_T("rb"));
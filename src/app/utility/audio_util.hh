@@ -17,6 +17,8 @@
  */
 
 #pragma once
+#include <ckcore/progress.hh>
+#include <base/codec_manager.hh>
 
 #define AUDIOFORMAT_UNKNOWN			0
 #define AUDIOFORMAT_WAVE			1
@@ -25,4 +27,5 @@
 
 int GetAudioFormat(const TCHAR *szFileName);
 int GetAudioLength(const TCHAR *szFileName);
+bool EncodeAudioFile(const TCHAR *szFileName,CCodec *pEncoder,ckcore::Progress &Progress);
 //int GetAudioInfo(const TCHAR *szFileName);
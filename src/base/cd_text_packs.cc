@@ -0,0 +1,380 @@
+/*
+ * InfraRecorder - CD/DVD burning software
+ * Copyright (C) 2006-2012 Christian Kindahl
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include <ckcore/file.hh>
+#include "checksum_util.hh"
+#include "cd_text_packs.hh"
+
+CCdTextPacks::CCdTextPacks() : m_uiTrackCount(0)
+{
+}
+
+void CCdTextPacks::Reset()
+{
+    m_Blocks.clear();
+    m_uiTrackCount = 0;
+}
+
+/*
+    CCdTextPacks::FinishPack
+    ------------------------
+    Stores the inverted CRC-16 of the first 16 bytes of the pack in its last
+    two bytes, most significant byte first.
+*/
+void CCdTextPacks::FinishPack(unsigned char *pPack)
+{
+    unsigned short usCrc = ChecksumCrc16(pPack,16) ^ 0xFFFF;
+    pPack[16] = static_cast<unsigned char>(usCrc >> 8);
+    pPack[17] = static_cast<unsigned char>(usCrc & 0xFF);
+}
+
+/*
+    CCdTextPacks::BuildBlock
+    ------------------------
+    Appends the text packs of a block to the pack buffer. Each pack type that
+    has any text holds one null terminated string for the album and each
+    track, the strings run on from one pack to the next. Returns false if the
+    block does not fit in 256 packs (three of which are reserved for the size
+    information).
+*/
+bool CCdTextPacks::BuildBlock(const CBlock &Block,unsigned int uiBlock,unsigned int uiTrackCount,
+                              std::vector<unsigned char> &Packs)
+{
+    unsigned int uiPackCount = 0;
+
+    for (unsigned int uiType = 0; uiType < CDTEXT_TEXTTYPES; uiType++)
+    {
+        const std::vector<std::string> &Fields = Block.m_Fields[uiType];
+
+        bool bEmpty = true;
+        for (unsigned int i = 0; i < Fields.size() && i <= uiTrackCount; i++)
+        {
+            if (!Fields[i].empty())
+            {
+                bEmpty = false;
+                break;
+            }
+        }
+
+        if (bEmpty)
+            continue;
+
+        // The strings of all fields follow each other, each field starts
+        // where the previous one ended.
+        std::string Text;
+        std::vector<size_t> FieldStart;
+        for (unsigned int i = 0; i <= uiTrackCount; i++)
+        {
+            FieldStart.push_back(Text.size());
+            if (i < Fields.size())
+                Text.append(Fields[i]);
+            Text.push_back('\0');
+        }
+
+        unsigned int uiField = 0;
+        for (size_t uiPos = 0; uiPos < Text.size(); uiPos += CDTEXT_PACKDATASIZE)
+        {
+            if (++uiPackCount > CDTEXT_MAXBLOCKPACKS - 3)
+                return false;
+
+            while (uiField + 1 < FieldStart.size() && FieldStart[uiField + 1] <= uiPos)
+                uiField++;
+
+            size_t uiCharPos = uiPos - FieldStart[uiField];
+
+            size_t uiOffset = Packs.size();
+            Packs.resize(uiOffset + CDTEXT_PACKSIZE,0);
+            unsigned char *pPack = &Packs[uiOffset];
+
+            pPack[0] = static_cast<unsigned char>(PT_TITLE + uiType);
+            pPack[1] = static_cast<unsigned char>(uiField);
+            pPack[2] = static_cast<unsigned char>(uiPackCount - 1);
+            pPack[3] = static_cast<unsigned char>((uiBlock << 4) | (uiCharPos > 15 ? 15 : uiCharPos));
+
+            size_t uiCount = Text.size() - uiPos;
+            if (uiCount > CDTEXT_PACKDATASIZE)
+                uiCount = CDTEXT_PACKDATASIZE;
+            memcpy(pPack + 4,Text.data() + uiPos,uiCount);
+
+            FinishPack(pPack);
+        }
+    }
+
+    return true;
+}
+
+CCdTextPacks::CBlock *CCdTextPacks::AddBlock(unsigned char ucLanguage)
+{
+    if (m_Blocks.size() >= CDTEXT_MAXBLOCKS)
+        return NULL;
+
+    m_Blocks.push_back(CBlock(ucLanguage));
+    return &m_Blocks.back();
+}
+
+CCdTextPacks::CBlock *CCdTextPacks::GetBlock(unsigned int uiBlock)
+{
+    if (uiBlock >= m_Blocks.size())
+        return NULL;
+
+    return &m_Blocks[uiBlock];
+}
+
+unsigned int CCdTextPacks::GetBlockCount() const
+{
+    return (unsigned int)m_Blocks.size();
+}
+
+void CCdTextPacks::SetTrackCount(unsigned int uiTrackCount)
+{
+    m_uiTrackCount = uiTrackCount > CDTEXT_MAXTRACKS ? CDTEXT_MAXTRACKS : uiTrackCount;
+}
+
+unsigned int CCdTextPacks::GetTrackCount() const
+{
+    return m_uiTrackCount;
+}
+
+void CCdTextPacks::SetText(unsigned int uiBlock,ePackType Type,unsigned int uiTrack,
+                           const char *szText)
+{
+    if (uiBlock >= m_Blocks.size() || Type < PT_TITLE || Type >= PT_TITLE + CDTEXT_TEXTTYPES ||
+        uiTrack > CDTEXT_MAXTRACKS)
+    {
+        return;
+    }
+
+    std::vector<std::string> &Fields = m_Blocks[uiBlock].m_Fields[Type - PT_TITLE];
+    if (Fields.size() <= uiTrack)
+        Fields.resize(uiTrack + 1);
+
+    Fields[uiTrack] = szText;
+}
+
+const char *CCdTextPacks::GetText(unsigned int uiBlock,ePackType Type,unsigned int uiTrack) const
+{
+    if (uiBlock >= m_Blocks.size() || Type < PT_TITLE || Type >= PT_TITLE + CDTEXT_TEXTTYPES)
+        return "";
+
+    const std::vector<std::string> &Fields = m_Blocks[uiBlock].m_Fields[Type - PT_TITLE];
+    if (uiTrack >= Fields.size())
+        return "";
+
+    return Fields[uiTrack].c_str();
+}
+
+/*
+    CCdTextPacks::Build
+    -------------------
+    Lays out the packs of all blocks in the pack buffer. Each block ends with
+    three size information packs, which hold the last sequence number and the
+    language of every block, so they are filled in once all blocks are laid
+    out.
+*/
+bool CCdTextPacks::Build(std::vector<unsigned char> &Packs) const
+{
+    Packs.clear();
+    if (m_Blocks.empty())
+        return false;
+
+    size_t uiSizeInfo[CDTEXT_MAXBLOCKS];
+    unsigned char ucLastSeq[CDTEXT_MAXBLOCKS];
+    unsigned char ucLanguage[CDTEXT_MAXBLOCKS];
+    memset(ucLastSeq,0,sizeof(ucLastSeq));
+    memset(ucLanguage,0,sizeof(ucLanguage));
+
+    for (unsigned int i = 0; i < m_Blocks.size(); i++)
+    {
+        size_t uiStart = Packs.size();
+        if (!BuildBlock(m_Blocks[i],i,m_uiTrackCount,Packs))
+            return false;
+
+        uiSizeInfo[i] = Packs.size();
+        Packs.resize(Packs.size() + 3 * CDTEXT_PACKSIZE,0);
+
+        ucLastSeq[i] = static_cast<unsigned char>((Packs.size() - uiStart) / CDTEXT_PACKSIZE - 1);
+        ucLanguage[i] = m_Blocks[i].m_ucLanguage;
+    }
+
+    for (unsigned int i = 0; i < m_Blocks.size(); i++)
+    {
+        unsigned char ucInfo[3 * CDTEXT_PACKDATASIZE];
+        memset(ucInfo,0,sizeof(ucInfo));
+
+        ucInfo[0] = m_Blocks[i].m_ucCharCode;
+        ucInfo[1] = 1;
+        ucInfo[2] = static_cast<unsigned char>(m_uiTrackCount);
+
+        // Number of packs of each type in the block.
+        size_t uiStart = uiSizeInfo[i] - (ucLastSeq[i] - 2) * CDTEXT_PACKSIZE;
+        for (size_t uiPack = uiStart; uiPack < uiSizeInfo[i]; uiPack += CDTEXT_PACKSIZE)
+            ucInfo[4 + (Packs[uiPack] & 0x0F)]++;
+        ucInfo[4 + (PT_SIZEINFO & 0x0F)] = 3;
+
+        memcpy(ucInfo + 20,ucLastSeq,sizeof(ucLastSeq));
+        memcpy(ucInfo + 28,ucLanguage,sizeof(ucLanguage));
+
+        for (unsigned int j = 0; j < 3; j++)
+        {
+            unsigned char *pPack = &Packs[uiSizeInfo[i] + j * CDTEXT_PACKSIZE];
+            pPack[0] = PT_SIZEINFO;
+            pPack[1] = static_cast<unsigned char>(j);
+            pPack[2] = static_cast<unsigned char>(ucLastSeq[i] - 2 + j);
+            pPack[3] = static_cast<unsigned char>(i << 4);
+            memcpy(pPack + 4,ucInfo + j * CDTEXT_PACKDATASIZE,CDTEXT_PACKDATASIZE);
+
+            FinishPack(pPack);
+        }
+    }
+
+    return true;
+}
+
+/*
+    CCdTextPacks::Parse
+    -------------------
+    Extracts the text fields of all blocks from raw packs. Packs with an
+    invalid CRC and packs using double byte characters are ignored. A field
+    consisting of a single tab character repeats the previous field.
+*/
+bool CCdTextPacks::Parse(const unsigned char *pPacks,size_t uiSize)
+{
+    Reset();
+
+    if (uiSize % CDTEXT_PACKSIZE != 0)
+        return false;
+
+    std::string Text[CDTEXT_MAXBLOCKS][CDTEXT_TEXTTYPES];
+    unsigned int uiFirstTrack[CDTEXT_MAXBLOCKS][CDTEXT_TEXTTYPES];
+    unsigned char ucSizeInfo[CDTEXT_MAXBLOCKS][3 * CDTEXT_PACKDATASIZE];
+    bool bSizeInfo[CDTEXT_MAXBLOCKS];
+    bool bPresent[CDTEXT_MAXBLOCKS];
+    memset(ucSizeInfo,0,sizeof(ucSizeInfo));
+    memset(bSizeInfo,0,sizeof(bSizeInfo));
+    memset(bPresent,0,sizeof(bPresent));
+
+    for (size_t uiPos = 0; uiPos < uiSize; uiPos += CDTEXT_PACKSIZE)
+    {
+        const unsigned char *pPack = pPacks + uiPos;
+
+        unsigned short usCrc = ChecksumCrc16(pPack,16) ^ 0xFFFF;
+        if (pPack[16] != (usCrc >> 8) || pPack[17] != (usCrc & 0xFF))
+            continue;
+
+        if (pPack[3] & 0x80)
+            continue;
+
+        unsigned int uiBlock = (pPack[3] >> 4) & 0x07;
+        bPresent[uiBlock] = true;
+
+        if (pPack[0] >= PT_TITLE && pPack[0] < PT_TITLE + CDTEXT_TEXTTYPES)
+        {
+            unsigned int uiType = pPack[0] - PT_TITLE;
+            if (Text[uiBlock][uiType].empty())
+                uiFirstTrack[uiBlock][uiType] = pPack[1] & 0x7F;
+
+            Text[uiBlock][uiType].append((const char *)pPack + 4,CDTEXT_PACKDATASIZE);
+        }
+        else if (pPack[0] == PT_SIZEINFO && pPack[1] < 3)
+        {
+            memcpy(ucSizeInfo[uiBlock] + pPack[1] * CDTEXT_PACKDATASIZE,pPack + 4,
+                   CDTEXT_PACKDATASIZE);
+            bSizeInfo[uiBlock] = true;
+        }
+    }
+
+    for (unsigned int i = 0; i < CDTEXT_MAXBLOCKS; i++)
+    {
+        if (!bPresent[i])
+            continue;
+
+        CBlock *pBlock = AddBlock(bSizeInfo[i] ? ucSizeInfo[i][28 + i] : 0);
+        pBlock->m_ucCharCode = ucSizeInfo[i][0];
+
+        if (bSizeInfo[i] && ucSizeInfo[i][2] > m_uiTrackCount)
+            SetTrackCount(ucSizeInfo[i][2]);
+
+        for (unsigned int uiType = 0; uiType < CDTEXT_TEXTTYPES; uiType++)
+        {
+            const std::string &TypeText = Text[i][uiType];
+
+            unsigned int uiTrack = uiFirstTrack[i][uiType];
+            std::string PrevField;
+
+            size_t uiStart = 0;
+            while (uiStart < TypeText.size() && uiTrack <= CDTEXT_MAXTRACKS)
+            {
+                size_t uiEnd = TypeText.find('\0',uiStart);
+                if (uiEnd == std::string::npos)
+                    uiEnd = TypeText.size();
+
+                std::string Field = TypeText.substr(uiStart,uiEnd - uiStart);
+                if (Field == "\t")
+                    Field = PrevField;
+
+                if (!Field.empty())
+                {
+                    SetText(GetBlockCount() - 1,(ePackType)(PT_TITLE + uiType),uiTrack,Field.c_str());
+                    if (uiTrack > m_uiTrackCount)
+                        SetTrackCount(uiTrack);
+                }
+
+                PrevField = Field;
+                uiStart = uiEnd + 1;
+                uiTrack++;
+            }
+        }
+    }
+
+    return !m_Blocks.empty();
+}
+
+bool CCdTextPacks::ReadFile(const ckcore::tchar *szFileName)
+{
+    Reset();
+
+    ckcore::File File(szFileName);
+    if (!File.open(ckcore::File::ckOPEN_READ))
+        return false;
+
+    // Files written by other applications may start with a 4 byte header.
+    ckcore::tint64 iFileSize = File.size();
+    if (iFileSize <= 0 || iFileSize > CDTEXT_MAXBLOCKS * CDTEXT_MAXBLOCKPACKS * CDTEXT_PACKSIZE + 4)
+        return false;
+
+    std::vector<unsigned char> Packs((size_t)iFileSize);
+    if (File.read(&Packs[0],(ckcore::tuint32)iFileSize) != iFileSize)
+        return false;
+
+    size_t uiHeaderSize = Packs.size() % CDTEXT_PACKSIZE == 4 ? 4 : 0;
+    return Parse(&Packs[0] + uiHeaderSize,Packs.size() - uiHeaderSize);
+}
+
+bool CCdTextPacks::WriteFile(const ckcore::tchar *szFileName) const
+{
+    std::vector<unsigned char> Packs;
+    if (!Build(Packs))
+        return false;
+
+    ckcore::File File(szFileName);
+    if (!File.open(ckcore::File::ckOPEN_WRITE))
+        return false;
+
+    return File.write(&Packs[0],(ckcore::tuint32)Packs.size()) == (ckcore::tint64)Packs.size();
+}
@@ -0,0 +1,100 @@
+/*
+ * InfraRecorder - CD/DVD burning software
+ * Copyright (C) 2006-2012 Christian Kindahl
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#include <vector>
+#include <string>
+#include <ckcore/types.hh>
+
+#define CDTEXT_SIGNATURE			0x2201
+#define CDTEXT_PACKSIZE				18
+#define CDTEXT_PACKDATASIZE			12
+#define CDTEXT_MAXBLOCKS			8
+#define CDTEXT_MAXTRACKS			99
+#define CDTEXT_MAXBLOCKPACKS		256					// The sequence number is a single byte.
+#define CDTEXT_TEXTTYPES			6					// Title to message.
+#define CDTEXT_LANGUAGE_ENGLISH		0x09
+
+// Builds and parses the CD-Text packs of the lead-in, in the raw format read
+// by cdrecord (18 byte packs without any header). A disc holds up to eight
+// blocks, one per language, each block holding the text fields of the album
+// (track 0) and of up to 99 tracks followed by the size information packs.
+// All packs are laid out in a single contiguous buffer so that they can be
+// written with one call. Only single byte character sets are supported.
+class CCdTextPacks
+{
+public:
+    enum ePackType
+    {
+        PT_TITLE = 0x80,
+        PT_PERFORMER = 0x81,
+        PT_SONGWRITER = 0x82,
+        PT_COMPOSER = 0x83,
+        PT_ARRANGER = 0x84,
+        PT_MESSAGE = 0x85,
+        PT_DISCID = 0x86,
+        PT_GENREID = 0x87,
+        PT_TOCINFO = 0x88,
+        PT_TOCINFO2 = 0x89,
+        PT_UPCEAN = 0x8E,
+        PT_SIZEINFO = 0x8F
+    };
+
+    class CBlock
+    {
+    public:
+        unsigned char m_ucLanguage;
+        unsigned char m_ucCharCode;		// 0x00 is ISO 8859-1, 0x01 is ASCII.
+
+        // Field 0 is the album, the following fields the tracks.
+        std::vector<std::string> m_Fields[CDTEXT_TEXTTYPES];
+
+        CBlock(unsigned char ucLanguage) : m_ucLanguage(ucLanguage),m_ucCharCode(0x00)
+        {
+        }
+    };
+
+private:
+    std::vector<CBlock> m_Blocks;
+    unsigned int m_uiTrackCount;
+
+    static void FinishPack(unsigned char *pPack);
+    static bool BuildBlock(const CBlock &Block,unsigned int uiBlock,unsigned int uiTrackCount,
+        std::vector<unsigned char> &Packs);
+
+public:
+    CCdTextPacks();
+
+    void Reset();
+
+    CBlock *AddBlock(unsigned char ucLanguage);
+    CBlock *GetBlock(unsigned int uiBlock);
+    unsigned int GetBlockCount() const;
+
+    void SetTrackCount(unsigned int uiTrackCount);
+    unsigned int GetTrackCount() const;
+
+    void SetText(unsigned int uiBlock,ePackType Type,unsigned int uiTrack,const char *szText);
+    const char *GetText(unsigned int uiBlock,ePackType Type,unsigned int uiTrack) const;
+
+    bool Build(std::vector<unsigned char> &Packs) const;
+    bool Parse(const unsigned char *pPacks,size_t uiSize);
+
+    bool ReadFile(const ckcore::tchar *szFileName);
+    bool WriteFile(const ckcore::tchar *szFileName) const;
+};
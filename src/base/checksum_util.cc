@@ -0,0 +1,308 @@
+/*
+ * InfraRecorder - CD/DVD burning software
+ * Copyright (C) 2006-2012 Christian Kindahl
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include <ckcore/types.hh>
+#include <ckcore/filestream.hh>
+#include "checksum_util.hh"
+
+#if defined(_M_IX86) || defined(_M_X64)
+#include <intrin.h>
+#include <nmmintrin.h>
+#define CHECKSUM_HAVE_SSE42
+#endif
+
+#define CHECKSUM_CRC16_POLYNOMIAL			0x1021
+#define CHECKSUM_CRC32_POLYNOMIAL			0xEDB88320		// Reflected 0x04C11DB7.
+#define CHECKSUM_CRC32C_POLYNOMIAL			0x82F63B78		// Reflected 0x1EDC6F41.
+
+/*
+    The slicing-by-8 tables. Table k holds the CRC contribution of a byte
+    followed by k zero bytes, which allows eight bytes to be folded into the
+    CRC per iteration. The tables are built once when the module is loaded.
+*/
+class CChecksumTables
+{
+public:
+    unsigned short m_usCrc16[8][256];
+    ckcore::tuint32 m_uiCrc32[8][256];
+    ckcore::tuint32 m_uiCrc32c[8][256];
+    bool m_bHardwareCrc32c;
+
+    CChecksumTables()
+    {
+        for (unsigned int i = 0; i < 256; i++)
+        {
+            // MSB first CRC-16.
+            unsigned short usCrc = (unsigned short)(i << 8);
+            for (int j = 0; j < 8; j++)
+                usCrc = (unsigned short)(usCrc & 0x8000 ? (usCrc << 1) ^ CHECKSUM_CRC16_POLYNOMIAL : usCrc << 1);
+
+            m_usCrc16[0][i] = usCrc;
+
+            // Reflected CRC-32 and CRC-32C.
+            ckcore::tuint32 uiCrc32 = i,uiCrc32c = i;
+            for (int j = 0; j < 8; j++)
+            {
+                uiCrc32 = uiCrc32 & 1 ? (uiCrc32 >> 1) ^ CHECKSUM_CRC32_POLYNOMIAL : uiCrc32 >> 1;
+                uiCrc32c = uiCrc32c & 1 ? (uiCrc32c >> 1) ^ CHECKSUM_CRC32C_POLYNOMIAL : uiCrc32c >> 1;
+            }
+
+            m_uiCrc32[0][i] = uiCrc32;
+            m_uiCrc32c[0][i] = uiCrc32c;
+        }
+
+        for (unsigned int k = 1; k < 8; k++)
+        {
+            for (unsigned int i = 0; i < 256; i++)
+            {
+                unsigned short usPrev = m_usCrc16[k - 1][i];
+                m_usCrc16[k][i] = (unsigned short)(usPrev << 8) ^ m_usCrc16[0][usPrev >> 8];
+
+                ckcore::tuint32 uiPrev = m_uiCrc32[k - 1][i];
+                m_uiCrc32[k][i] = (uiPrev >> 8) ^ m_uiCrc32[0][uiPrev & 0xFF];
+
+                uiPrev = m_uiCrc32c[k - 1][i];
+                m_uiCrc32c[k][i] = (uiPrev >> 8) ^ m_uiCrc32c[0][uiPrev & 0xFF];
+            }
+        }
+
+        // SSE 4.2 provides the CRC32 instruction (which uses the Castagnoli polynomial).
+        m_bHardwareCrc32c = false;
+#ifdef CHECKSUM_HAVE_SSE42
+        int iCpuInfo[4];
+        __cpuid(iCpuInfo,1);
+        m_bHardwareCrc32c = (iCpuInfo[2] & (1 << 20)) != 0;
+#endif
+    }
+};
+
+static const CChecksumTables g_ChecksumTables;
+
+static ckcore::tuint32 ReadLE32(const unsigned char *pBuffer)
+{
+    return (ckcore::tuint32)pBuffer[0] | ((ckcore::tuint32)pBuffer[1] << 8) |
+        ((ckcore::tuint32)pBuffer[2] << 16) | ((ckcore::tuint32)pBuffer[3] << 24);
+}
+
+static ckcore::tuint32 SliceReflected(const ckcore::tuint32 uiTable[8][256],
+                                      const unsigned char *pBuffer,size_t uiSize,
+                                      ckcore::tuint32 uiCrc)
+{
+    while (uiSize >= 8)
+    {
+        ckcore::tuint32 uiOne = ReadLE32(pBuffer) ^ uiCrc;
+        ckcore::tuint32 uiTwo = ReadLE32(pBuffer + 4);
+
+        uiCrc = uiTable[7][ uiOne        & 0xFF] ^
+                uiTable[6][(uiOne >>  8) & 0xFF] ^
+                uiTable[5][(uiOne >> 16) & 0xFF] ^
+                uiTable[4][ uiOne >> 24        ] ^
+                uiTable[3][ uiTwo        & 0xFF] ^
+                uiTable[2][(uiTwo >>  8) & 0xFF] ^
+                uiTable[1][(uiTwo >> 16) & 0xFF] ^
+                uiTable[0][ uiTwo >> 24        ];
+
+        pBuffer += 8;
+        uiSize -= 8;
+    }
+
+    while (uiSize-- > 0)
+        uiCrc = uiTable[0][(uiCrc ^ *pBuffer++) & 0xFF] ^ (uiCrc >> 8);
+
+    return uiCrc;
+}
+
+/**
+    Calculates the MSB first CRC-16 (polynomial 0x1021) of the specified
+    buffer. No final XOR is performed.
+    @param pBuffer pointer to the data.
+    @param uiSize number of bytes in the buffer.
+    @param usCrc initial CRC value.
+    @return the CRC-16 checksum.
+*/
+unsigned short ChecksumCrc16(const void *pBuffer,size_t uiSize,unsigned short usCrc)
+{
+    const unsigned short (*usTable)[256] = g_ChecksumTables.m_usCrc16;
+    const unsigned char *pData = static_cast<const unsigned char *>(pBuffer);
+
+    while (uiSize >= 8)
+    {
+        usCrc = usTable[7][(usCrc >> 8) ^ pData[0]] ^
+                usTable[6][(usCrc & 0xFF) ^ pData[1]] ^
+                usTable[5][pData[2]] ^
+                usTable[4][pData[3]] ^
+                usTable[3][pData[4]] ^
+                usTable[2][pData[5]] ^
+                usTable[1][pData[6]] ^
+                usTable[0][pData[7]];
+
+        pData += 8;
+        uiSize -= 8;
+    }
+
+    while (uiSize-- > 0)
+        usCrc = (unsigned short)(usCrc << 8) ^ usTable[0][(usCrc >> 8) ^ *pData++];
+
+    return usCrc;
+}
+
+/**
+    Calculates the CRC-32 checksum of the specified buffer. The result is
+    identical to the one of ckcore::CrcStream::ckCRC_32.
+    @param pBuffer pointer to the data.
+    @param uiSize number of bytes in the buffer.
+    @param uiCrc checksum returned by a previous call, or 0.
+    @return the CRC-32 checksum.
+*/
+ckcore::tuint32 ChecksumCrc32(const void *pBuffer,size_t uiSize,ckcore::tuint32 uiCrc)
+{
+    return ~SliceReflected(g_ChecksumTables.m_uiCrc32,
+        static_cast<const unsigned char *>(pBuffer),uiSize,~uiCrc);
+}
+
+/**
+    Calculates the CRC-32C checksum of the specified buffer. The SSE 4.2
+    CRC32 instruction is used if the processor supports it.
+    @param pBuffer pointer to the data.
+    @param uiSize number of bytes in the buffer.
+    @param uiCrc checksum returned by a previous call, or 0.
+    @return the CRC-32C checksum.
+*/
+ckcore::tuint32 ChecksumCrc32c(const void *pBuffer,size_t uiSize,ckcore::tuint32 uiCrc)
+{
+    const unsigned char *pData = static_cast<const unsigned char *>(pBuffer);
+    uiCrc = ~uiCrc;
+
+#ifdef CHECKSUM_HAVE_SSE42
+    if (g_ChecksumTables.m_bHardwareCrc32c)
+    {
+#ifdef _M_X64
+        unsigned __int64 uiCrc64 = uiCrc;
+        while (uiSize >= 8)
+        {
+            unsigned __int64 uiValue;
+            memcpy(&uiValue,pData,8);
+
+            uiCrc64 = _mm_crc32_u64(uiCrc64,uiValue);
+            pData += 8;
+            uiSize -= 8;
+        }
+
+        uiCrc = (ckcore::tuint32)uiCrc64;
+#else
+        while (uiSize >= 4)
+        {
+            unsigned int uiValue;
+            memcpy(&uiValue,pData,4);
+
+            uiCrc = _mm_crc32_u32(uiCrc,uiValue);
+            pData += 4;
+            uiSize -= 4;
+        }
+#endif
+        while (uiSize-- > 0)
+            uiCrc = _mm_crc32_u8(uiCrc,*pData++);
+
+        return ~uiCrc;
+    }
+#endif
+
+    return ~SliceReflected(g_ChecksumTables.m_uiCrc32c,pData,uiSize,uiCrc);
+}
+
+bool ChecksumHasHardwareCrc32c()
+{
+    return g_ChecksumTables.m_bHardwareCrc32c;
+}
+
+CChecksumStream::CChecksumStream(eChecksumType Type) : m_Type(Type),m_uiChecksum(0)
+{
+}
+
+void CChecksumStream::reset()
+{
+    m_uiChecksum = 0;
+}
+
+ckcore::tuint32 CChecksumStream::checksum() const
+{
+    return m_uiChecksum;
+}
+
+ckcore::tint64 CChecksumStream::write(const void *pBuffer,ckcore::tuint32 uiCount)
+{
+    switch (m_Type)
+    {
+        case CHECKSUM_CRC16:
+            m_uiChecksum = ChecksumCrc16(pBuffer,uiCount,(unsigned short)m_uiChecksum);
+            break;
+
+        case CHECKSUM_CRC32:
+            m_uiChecksum = ChecksumCrc32(pBuffer,uiCount,m_uiChecksum);
+            break;
+
+        case CHECKSUM_CRC32C:
+            m_uiChecksum = ChecksumCrc32c(pBuffer,uiCount,m_uiChecksum);
+            break;
+
+        default:
+            return -1;
+    }
+
+    return uiCount;
+}
+
+/**
+    Calculates the checksum of a complete file.
+    @param szFileName path to the file.
+    @param Type the checksum algorithm to use.
+    @param uiChecksum reference to the variable receiving the checksum.
+    @param Progresser progresser that should be updated as the file is read.
+    @return true if the checksum was calculated, false if the file could not
+    be read or the operation was cancelled.
+*/
+bool ChecksumFile(const ckcore::tchar *szFileName,eChecksumType Type,
+                  ckcore::tuint32 &uiChecksum,ckcore::Progresser &Progresser)
+{
+    ckcore::FileInStream FileStream(szFileName);
+    if (!FileStream.open())
+        return false;
+
+    CChecksumStream ChecksumStream(Type);
+    if (!ckcore::stream::copy(FileStream,ChecksumStream,Progresser))
+        return false;
+
+    uiChecksum = ChecksumStream.checksum();
+    return true;
+}
+
+bool ChecksumFile(const ckcore::tchar *szFileName,eChecksumType Type,
+                  ckcore::tuint32 &uiChecksum)
+{
+    ckcore::FileInStream FileStream(szFileName);
+    if (!FileStream.open())
+        return false;
+
+    CChecksumStream ChecksumStream(Type);
+    if (!ckcore::stream::copy(FileStream,ChecksumStream))
+        return false;
+
+    uiChecksum = ChecksumStream.checksum();
+    return true;
+}
@@ -0,0 +1,57 @@
+/*
+ * InfraRecorder - CD/DVD burning software
+ * Copyright (C) 2006-2012 Christian Kindahl
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#include <ckcore/types.hh>
+#include <ckcore/stream.hh>
+#include <ckcore/progresser.hh>
+
+enum eChecksumType
+{
+    CHECKSUM_CRC16,		// CRC-16/CCITT (polynomial 0x1021, MSB first) as used by CD-Text.
+    CHECKSUM_CRC32,		// CRC-32 (polynomial 0x04C11DB7, reflected), same as ckcore::CrcStream.
+    CHECKSUM_CRC32C		// CRC-32C (Castagnoli), hardware accelerated when supported.
+};
+
+// Raw checksum kernels. The CRC value of a previous call can be passed as the
+// initial value to continue a running checksum.
+unsigned short ChecksumCrc16(const void *pBuffer,size_t uiSize,unsigned short usCrc = 0);
+ckcore::tuint32 ChecksumCrc32(const void *pBuffer,size_t uiSize,ckcore::tuint32 uiCrc = 0);
+ckcore::tuint32 ChecksumCrc32c(const void *pBuffer,size_t uiSize,ckcore::tuint32 uiCrc = 0);
+bool ChecksumHasHardwareCrc32c();
+
+class CChecksumStream : public ckcore::OutStream
+{
+private:
+    eChecksumType m_Type;
+    ckcore::tuint32 m_uiChecksum;
+
+public:
+    CChecksumStream(eChecksumType Type);
+
+    void reset();
+    ckcore::tuint32 checksum() const;
+
+    // ckcore::OutStream.
+    ckcore::tint64 write(const void *pBuffer,ckcore::tuint32 uiCount);
+};
+
+bool ChecksumFile(const ckcore::tchar *szFileName,eChecksumType Type,
+                  ckcore::tuint32 &uiChecksum);
+bool ChecksumFile(const ckcore::tchar *szFileName,eChecksumType Type,
+                  ckcore::tuint32 &uiChecksum,ckcore::Progresser &Progresser);
@@ -16,77 +16,210 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <time.h>
 #include <ckcore/directory.hh>
+#include <ckcore/file.hh>
 #include <ckcore/path.hh>
+#include "string_util.hh"
+#include "xml_processor.hh"
 #include "codec_manager.hh"
 
-CCodec::CCodec()
+CCodec::CCodec() : m_hInstance(NULL),m_bLoadFailed(false),m_iCapabilities(0),
+    m_pCapabilities(NULL),m_pString(NULL),m_pSetCallback(NULL),
+    m_pDecodeInit(NULL),m_pDecodeProcess(NULL),m_pDecodeExit(NULL),
+    m_pEncodeInit(NULL),m_pEncodeProcess(NULL),m_pEncodeFlush(NULL),
+    m_pEncodeExit(NULL),m_pEncodeConfig(NULL)
 {
-    m_hInstance = NULL;
+    ::InitializeCriticalSection(&m_csLoad);
 }
 
 CCodec::~CCodec()
 {
     if (m_hInstance)
         FreeLibrary(m_hInstance);
+
+    ::DeleteCriticalSection(&m_csLoad);
 }
 
 bool CCodec::Load(const TCHAR *szFileName)
 {
+    m_FileName = szFileName;
+
     m_hInstance = LoadLibrary(szFileName);
     if (m_hInstance == NULL)
         return false;
 
-    irc_capabilities = (tirc_capabilities)GetProcAddress(m_hInstance,"irc_capabilities");
-    if (!irc_capabilities)
+    m_pCapabilities = (tirc_capabilities)GetProcAddress(m_hInstance,"irc_capabilities");
+    if (!m_pCapabilities)
         return false;
 
-    irc_string = (tirc_string)GetProcAddress(m_hInstance,"irc_string");
-    if (!irc_string)
+    m_pString = (tirc_string)GetProcAddress(m_hInstance,"irc_string");
+    if (!m_pString)
         return false;
 
-    irc_set_callback = (tirc_set_callback)GetProcAddress(m_hInstance,"irc_set_callback");
-    if (!irc_set_callback)
+    m_pSetCallback = (tirc_set_callback)GetProcAddress(m_hInstance,"irc_set_callback");
+    if (!m_pSetCallback)
         return false;
 
-    irc_decode_init = (tirc_decode_init)GetProcAddress(m_hInstance,"irc_decode_init");
-    if (!irc_decode_init)
+    m_pDecodeInit = (tirc_decode_init)GetProcAddress(m_hInstance,"irc_decode_init");
+    if (!m_pDecodeInit)
         return false;
 
-    irc_decode_process = (tirc_decode_process)GetProcAddress(m_hInstance,"irc_decode_process");
-    if (!irc_decode_process)
+    m_pDecodeProcess = (tirc_decode_process)GetProcAddress(m_hInstance,"irc_decode_process");
+    if (!m_pDecodeProcess)
         return false;
 
-    irc_decode_exit = (tirc_decode_exit)GetProcAddress(m_hInstance,"irc_decode_exit");
-    if (!irc_decode_exit)
+    m_pDecodeExit = (tirc_decode_exit)GetProcAddress(m_hInstance,"irc_decode_exit");
+    if (!m_pDecodeExit)
         return false;
 
-    irc_encode_init = (tirc_encode_init)GetProcAddress(m_hInstance,"irc_encode_init");
-    if (!irc_encode_init)
+    m_pEncodeInit = (tirc_encode_init)GetProcAddress(m_hInstance,"irc_encode_init");
+    if (!m_pEncodeInit)
         return false;
 
-    irc_encode_process = (tirc_encode_process)GetProcAddress(m_hInstance,"irc_encode_process");
-    if (!irc_encode_process)
+    m_pEncodeProcess = (tirc_encode_process)GetProcAddress(m_hInstance,"irc_encode_process");
+    if (!m_pEncodeProcess)
         return false;
 
-    irc_encode_flush = (tirc_encode_flush)GetProcAddress(m_hInstance,"irc_encode_flush");
-    if (!irc_encode_flush)
+    m_pEncodeFlush = (tirc_encode_flush)GetProcAddress(m_hInstance,"irc_encode_flush");
+    if (!m_pEncodeFlush)
         return false;
 
-    irc_encode_exit = (tirc_encode_exit)GetProcAddress(m_hInstance,"irc_encode_exit");
-    if (!irc_encode_exit)
+    m_pEncodeExit = (tirc_encode_exit)GetProcAddress(m_hInstance,"irc_encode_exit");
+    if (!m_pEncodeExit)
         return false;
 
-    irc_encode_config = (tirc_encode_config)GetProcAddress(m_hInstance,"irc_encode_config");
-    if (!irc_encode_config)
+    m_pEncodeConfig = (tirc_encode_config)GetProcAddress(m_hInstance,"irc_encode_config");
+    if (!m_pEncodeConfig)
         return false;
 
+    // Cache the information needed for presenting the codec.
+    m_iCapabilities = m_pCapabilities();
+    m_Version = m_pString(IRC_STR_VERSION);
+    m_Encoder = m_pString(IRC_STR_ENCODER);
+    m_FileExt = m_pString(IRC_STR_FILEEXT);
+
     return true;
 }
 
+/*
+    CCodec::Defer
+    -------------
+    Prepares the codec for being loaded the first time it's used. The
+    capabilities and strings, usually read from the codec manifest, are
+    returned without loading the plug-in.
+*/
+void CCodec::Defer(const TCHAR *szFileName,int iCapabilities,const TCHAR *szVersion,
+                   const TCHAR *szEncoder,const TCHAR *szFileExt)
+{
+    m_FileName = szFileName;
+    m_iCapabilities = iCapabilities;
+    m_Version = szVersion;
+    m_Encoder = szEncoder;
+    m_FileExt = szFileExt;
+}
+
+/*
+    CCodec::Require
+    ---------------
+    Makes sure that the plug-in has been loaded. Returns false if the plug-in
+    could not be loaded.
+*/
+bool CCodec::Require()
+{
+    ::EnterCriticalSection(&m_csLoad);
+
+    if (m_hInstance == NULL && !m_bLoadFailed)
+    {
+        ckcore::tstring FileName = m_FileName;
+        if (!Load(FileName.c_str()))
+            m_bLoadFailed = true;
+    }
+
+    bool bResult = m_hInstance != NULL && !m_bLoadFailed;
+
+    ::LeaveCriticalSection(&m_csLoad);
+    return bResult;
+}
+
+bool CCodec::IsLoaded() const
+{
+    return m_hInstance != NULL;
+}
+
 bool CCodec::GetFileName(TCHAR *szFileName,unsigned long ulBufSize)
 {
-    return ::GetModuleFileName(m_hInstance,szFileName,ulBufSize) != 0;
+    if (m_FileName.size() >= ulBufSize)
+        return false;
+
+    lstrcpy(szFileName,m_FileName.c_str());
+    return true;
+}
+
+int CCodec::irc_capabilities()
+{
+    return m_iCapabilities;
+}
+
+const TCHAR *CCodec::irc_string(unsigned int uiID)
+{
+    switch (uiID)
+    {
+        case IRC_STR_VERSION:
+            return m_Version.c_str();
+        case IRC_STR_ENCODER:
+            return m_Encoder.c_str();
+        case IRC_STR_FILEEXT:
+            return m_FileExt.c_str();
+    }
+
+    return Require() ? m_pString(uiID) : _T("");
+}
+
+bool CCodec::irc_set_callback(tirc_send_message *pSendMessage)
+{
+    return Require() && m_pSetCallback(pSendMessage);
+}
+
+bool CCodec::irc_decode_init(const TCHAR *szFileName,int &iNumChannels,int &iSampleRate,
+                             int &iBitRate,unsigned __int64 &uiDuration)
+{
+    return Require() && m_pDecodeInit(szFileName,iNumChannels,iSampleRate,iBitRate,uiDuration);
+}
+
+__int64 CCodec::irc_decode_process(unsigned char *pBuffer,__int64 iBufferSize,unsigned __int64 &uiTime)
+{
+    return Require() ? m_pDecodeProcess(pBuffer,iBufferSize,uiTime) : -1;
+}
+
+bool CCodec::irc_decode_exit()
+{
+    return Require() && m_pDecodeExit();
+}
+
+bool CCodec::irc_encode_init(const TCHAR *szFileName,int iNumChannels,int iSampleRate,int iBitRate)
+{
+    return Require() && m_pEncodeInit(szFileName,iNumChannels,iSampleRate,iBitRate);
+}
+
+__int64 CCodec::irc_encode_process(unsigned char *pBuffer,__int64 iDataSize)
+{
+    return Require() ? m_pEncodeProcess(pBuffer,iDataSize) : -1;
+}
+
+__int64 CCodec::irc_encode_flush()
+{
+    return Require() ? m_pEncodeFlush() : -1;
+}
+
+bool CCodec::irc_encode_exit()
+{
+    return Require() && m_pEncodeExit();
+}
+
+bool CCodec::irc_encode_config()
+{
+    return Require() && m_pEncodeConfig();
 }
 
 CCodecManager::CCodecManager()
@@ -141,6 +274,128 @@ bool CCodecManager::LoadCodecs(const TCHAR *szCodecPath)
     return true;
 }
 
+/**
+    Loads the codecs in the specified directory. Plug-ins that are described
+    by the manifest, and that have not been modified since the manifest was
+    written, are not loaded until they're used. The manifest is updated if
+    any plug-in had to be loaded.
+    @param szCodecPath the directory containing the codecs.
+    @param szManifestPath full path to the codec manifest file.
+    @return true if all codecs were successfully loaded, false otherwise.
+*/
+bool CCodecManager::LoadCodecs(const TCHAR *szCodecPath,const TCHAR *szManifestPath)
+{
+    CXmlProcessor Manifest;
+    bool bManifest = Manifest.Load(szManifestPath) == XMLRES_OK &&
+        Manifest.EnterElement(_T("InfraRecorder")) &&
+        Manifest.EnterElement(_T("Codecs"));
+
+    CXmlProcessor NewManifest;
+    NewManifest.AddElement(_T("InfraRecorder"),_T(""),true);
+    NewManifest.AddElement(_T("Codecs"),_T(""),true);
+
+    bool bModified = !bManifest;
+    unsigned int uiCodecCount = 0;
+
+    ckcore::Path CodecPath = szCodecPath;
+
+    ckcore::Directory CodecDir(CodecPath);
+    ckcore::Directory::Iterator itDir;
+    for (itDir = CodecDir.begin(); itDir != CodecDir.end(); itDir++)
+    {
+        ckcore::Path PluginPath = CodecPath + (*itDir).c_str();
+
+        if (lstrcmpi(PluginPath.ext_name().c_str(),ckT("irc")))
+            continue;
+
+        ckcore::tstring PluginName = PluginPath.name();
+        const TCHAR *szPluginPath = PluginName.c_str();
+
+        // The plug-in is identified by its path, size and modification time.
+        struct tm AccessTime,ModifyTime,CreateTime;
+        ckcore::File::time(szPluginPath,AccessTime,ModifyTime,CreateTime);
+
+        __int64 iSize = ckcore::File::size(szPluginPath);
+        __int64 iModifyTime = (__int64)mktime(&ModifyTime);
+
+        TCHAR szPath[MAX_PATH];
+        TCHAR szVersion[MAX_PATH];
+        TCHAR szEncoder[MAX_PATH];
+        TCHAR szFileExt[MAX_PATH];
+        int iCapabilities = 0;
+
+        // Search the manifest for the plug-in.
+        bool bFound = false;
+        for (unsigned int i = 0; bManifest && i < Manifest.GetElementChildCount(); i++)
+        {
+            if (!Manifest.EnterElement(i))
+                continue;
+
+            __int64 iEntrySize = -1,iEntryModifyTime = -1;
+
+            Manifest.GetSafeElementData(_T("Path"),szPath,MAX_PATH - 1);
+            Manifest.GetSafeElementData(_T("Size"),&iEntrySize);
+            Manifest.GetSafeElementData(_T("Modified"),&iEntryModifyTime);
+
+            if (!lstrcmpi(szPath,szPluginPath) && iEntrySize == iSize &&
+                iEntryModifyTime == iModifyTime)
+            {
+                Manifest.GetSafeElementData(_T("Capabilities"),&iCapabilities);
+                Manifest.GetSafeElementData(_T("Version"),szVersion,MAX_PATH - 1);
+                Manifest.GetSafeElementData(_T("Encoder"),szEncoder,MAX_PATH - 1);
+                Manifest.GetSafeElementData(_T("FileExt"),szFileExt,MAX_PATH - 1);
+                bFound = true;
+            }
+
+            Manifest.LeaveElement();
+
+            if (bFound)
+                break;
+        }
+
+        CCodec *pCodec = NULL;
+        if (bFound)
+        {
+            pCodec = new CCodec();
+            pCodec->Defer(szPluginPath,iCapabilities,szVersion,szEncoder,szFileExt);
+            m_Codecs.push_back(pCodec);
+        }
+        else
+        {
+            if (!LoadCodec(szPluginPath))
+                return false;
+
+            pCodec = m_Codecs.back();
+            bModified = true;
+        }
+
+        TCHAR szName[32];
+        lsprintf(szName,_T("Codec%d"),uiCodecCount++);
+        NewManifest.AddElement(szName,_T(""),true);
+            NewManifest.AddElement(_T("Path"),szPluginPath);
+            NewManifest.AddElement(_T("Size"),iSize);
+            NewManifest.AddElement(_T("Modified"),iModifyTime);
+            NewManifest.AddElement(_T("Capabilities"),pCodec->irc_capabilities());
+            NewManifest.AddElement(_T("Version"),pCodec->irc_string(IRC_STR_VERSION));
+            NewManifest.AddElement(_T("Encoder"),pCodec->irc_string(IRC_STR_ENCODER));
+            NewManifest.AddElement(_T("FileExt"),pCodec->irc_string(IRC_STR_FILEEXT));
+        NewManifest.LeaveElement();
+    }
+
+    // Plug-ins may also have been removed.
+    if (bManifest && Manifest.GetElementChildCount() != uiCodecCount)
+        bModified = true;
+
+    NewManifest.LeaveElement();
+    NewManifest.LeaveElement();
+
+    if (bModified)
+        NewManifest.Save(szManifestPath);
+
+    m_bIsLoaded = true;
+    return true;
+}
+
 bool CCodecManager::IsLoaded()
 {
     return m_bIsLoaded;
@@ -18,6 +18,7 @@
 
 #pragma once
 #include <vector>
+#include <ckcore/types.hh>
 #include "codec_const.hh"
 
 // Local structures.
@@ -25,25 +26,56 @@ class CCodec
 {
 private:
     HINSTANCE m_hInstance;
+    ckcore::tstring m_FileName;
+
+    // Set if the plug-in could not be loaded when first used.
+    bool m_bLoadFailed;
+
+    // Protects the plug-in from being loaded by several threads at once.
+    CRITICAL_SECTION m_csLoad;
+
+    // Information that is available without loading the plug-in.
+    int m_iCapabilities;
+    ckcore::tstring m_Version;
+    ckcore::tstring m_Encoder;
+    ckcore::tstring m_FileExt;
+
+    tirc_capabilities m_pCapabilities;
+    tirc_string m_pString;
+    tirc_set_callback m_pSetCallback;
+    tirc_decode_init m_pDecodeInit;
+    tirc_decode_process m_pDecodeProcess;
+    tirc_decode_exit m_pDecodeExit;
+    tirc_encode_init m_pEncodeInit;
+    tirc_encode_process m_pEncodeProcess;
+    tirc_encode_flush m_pEncodeFlush;
+    tirc_encode_exit m_pEncodeExit;
+    tirc_encode_config m_pEncodeConfig;
+
+    bool Require();
 
 public:
     CCodec();
     ~CCodec();
 
     bool Load(const TCHAR *szFileName);
+    void Defer(const TCHAR *szFileName,int iCapabilities,const TCHAR *szVersion,
+        const TCHAR *szEncoder,const TCHAR *szFileExt);
+    bool IsLoaded() const;
     bool GetFileName(TCHAR *szFileName,unsigned long ulBufSize);
 
-    tirc_capabilities irc_capabilities;
-    tirc_string irc_string;
-    tirc_set_callback irc_set_callback;
-    tirc_decode_init irc_decode_init;
-    tirc_decode_process irc_decode_process;
-    tirc_decode_exit irc_decode_exit;
-    tirc_encode_init irc_encode_init;
-    tirc_encode_process irc_encode_process;
-    tirc_encode_flush irc_encode_flush;
-    tirc_encode_exit irc_encode_exit;
-    tirc_encode_config irc_encode_config;
+    int irc_capabilities();
+    const TCHAR *irc_string(unsigned int uiID);
+    bool irc_set_callback(tirc_send_message *pSendMessage);
+    bool irc_decode_init(const TCHAR *szFileName,int &iNumChannels,int &iSampleRate,
+        int &iBitRate,unsigned __int64 &uiDuration);
+    __int64 irc_decode_process(unsigned char *pBuffer,__int64 iBufferSize,unsigned __int64 &uiTime);
+    bool irc_decode_exit();
+    bool irc_encode_init(const TCHAR *szFileName,int iNumChannels,int iSampleRate,int iBitRate);
+    __int64 irc_encode_process(unsigned char *pBuffer,__int64 iDataSize);
+    __int64 irc_encode_flush();
+    bool irc_encode_exit();
+    bool irc_encode_config();
 };
 
 class CCodecManager
@@ -60,5 +92,6 @@ public:
     std::vector<CCodec *> m_Codecs;
 
     bool LoadCodecs(const TCHAR *szCodecPath);
+    bool LoadCodecs(const TCHAR *szCodecPath,const TCHAR *szManifestPath);
     bool IsLoaded();
 };
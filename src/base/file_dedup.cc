@@ -0,0 +1,300 @@
+/*
+ * InfraRecorder - CD/DVD burning software
+ * Copyright (C) 2006-2012 Christian Kindahl
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <algorithm>
+#include <map>
+#include "checksum_util.hh"
+#include "file_dedup.hh"
+
+bool CFileDedup::CKey::operator<(const CKey &Key) const
+{
+    if (m_uiSize != Key.m_uiSize)
+        return m_uiSize < Key.m_uiSize;
+    if (m_uiCrc32 != Key.m_uiCrc32)
+        return m_uiCrc32 < Key.m_uiCrc32;
+
+    return m_uiCrc32c < Key.m_uiCrc32c;
+}
+
+bool CFileDedup::CKey::operator==(const CKey &Key) const
+{
+    return m_uiSize == Key.m_uiSize && m_uiCrc32 == Key.m_uiCrc32 &&
+        m_uiCrc32c == Key.m_uiCrc32c;
+}
+
+CFileDedup::CFileDedup() : m_lNextPending(0),m_uiDuplicateCount(0),m_uiDuplicateBytes(0)
+{
+}
+
+/*
+    CFileDedup::ReadThread
+    ----------------------
+    Reads pending files until there are no more files to read. Each file is
+    only claimed by a single thread.
+*/
+DWORD WINAPI CFileDedup::ReadThread(LPVOID lpParameter)
+{
+    CFileDedup *pDedup = (CFileDedup *)lpParameter;
+    unsigned char *pBuffer = new unsigned char[FILEDEDUP_BLOCKSIZE];
+
+    while (true)
+    {
+        LONG lPending = ::InterlockedIncrement(&pDedup->m_lNextPending) - 1;
+        if (lPending >= (LONG)pDedup->m_Pending.size())
+            break;
+
+        CFile &File = pDedup->m_Files[pDedup->m_Pending[lPending]];
+
+        ckcore::File InFile(File.m_FilePath);
+        if (!InFile.open(ckcore::File::ckOPEN_READ))
+            continue;
+
+        // Files that can't be read, or have changed size, are never duplicates.
+        CKey Key;
+        if (ReadKey(InFile,File.m_Key.m_uiSize,pBuffer,Key))
+        {
+            File.m_Key = Key;
+            File.m_bRead = true;
+        }
+
+        InFile.close();
+    }
+
+    delete [] pBuffer;
+    return 0;
+}
+
+/*
+    CFileDedup::ReadKey
+    -------------------
+    Reads uiSize bytes from the current position of the file and calculates
+    the key of the data. pBuffer must hold FILEDEDUP_BLOCKSIZE bytes.
+*/
+bool CFileDedup::ReadKey(ckcore::File &File,ckcore::tuint64 uiSize,unsigned char *pBuffer,
+                         CKey &Key)
+{
+    Key.m_uiSize = uiSize;
+    Key.m_uiCrc32 = 0;
+    Key.m_uiCrc32c = 0;
+
+    ckcore::tuint64 uiRemaining = uiSize;
+    while (uiRemaining > 0)
+    {
+        ckcore::tuint32 uiRead = uiRemaining < FILEDEDUP_BLOCKSIZE ?
+            (ckcore::tuint32)uiRemaining : FILEDEDUP_BLOCKSIZE;
+
+        ckcore::tint64 iRead = File.read(pBuffer,uiRead);
+        if (iRead <= 0)
+            return false;
+
+        Key.m_uiCrc32 = ChecksumCrc32(pBuffer,(size_t)iRead,Key.m_uiCrc32);
+        Key.m_uiCrc32c = ChecksumCrc32c(pBuffer,(size_t)iRead,Key.m_uiCrc32c);
+
+        uiRemaining -= iRead;
+    }
+
+    return true;
+}
+
+/*
+    CFileDedup::CompareData
+    -----------------------
+    Compares uiSize bytes from the current positions of the two files. pBuffer1
+    and pBuffer2 must each hold FILEDEDUP_BLOCKSIZE bytes. Returns false if the
+    data differs or if any of the files can't be read.
+*/
+bool CFileDedup::CompareData(ckcore::File &File1,ckcore::File &File2,ckcore::tuint64 uiSize,
+                             unsigned char *pBuffer1,unsigned char *pBuffer2)
+{
+    ckcore::tuint64 uiRemaining = uiSize;
+    while (uiRemaining > 0)
+    {
+        ckcore::tuint32 uiRead = uiRemaining < FILEDEDUP_BLOCKSIZE ?
+            (ckcore::tuint32)uiRemaining : FILEDEDUP_BLOCKSIZE;
+
+        if (File1.read(pBuffer1,uiRead) != (ckcore::tint64)uiRead ||
+            File2.read(pBuffer2,uiRead) != (ckcore::tint64)uiRead)
+        {
+            return false;
+        }
+
+        if (memcmp(pBuffer1,pBuffer2,uiRead))
+            return false;
+
+        uiRemaining -= uiRead;
+    }
+
+    return true;
+}
+
+/*
+    CFileDedup::CompareFiles
+    ------------------------
+    Returns true if the two files, which are assumed to have the same size,
+    have identical contents.
+*/
+bool CFileDedup::CompareFiles(unsigned int uiIndex1,unsigned int uiIndex2,
+                              unsigned char *pBuffer1,unsigned char *pBuffer2) const
+{
+    ckcore::File File1(m_Files[uiIndex1].m_FilePath);
+    ckcore::File File2(m_Files[uiIndex2].m_FilePath);
+    if (!File1.open(ckcore::File::ckOPEN_READ) || !File2.open(ckcore::File::ckOPEN_READ))
+        return false;
+
+    bool bResult = CompareData(File1,File2,m_Files[uiIndex1].m_Key.m_uiSize,pBuffer1,pBuffer2);
+
+    File1.close();
+    File2.close();
+    return bResult;
+}
+
+unsigned int CFileDedup::AddFile(const ckcore::tchar *szFilePath,ckcore::tuint64 uiSize)
+{
+    m_Files.push_back(CFile(szFilePath,uiSize));
+    return (unsigned int)m_Files.size() - 1;
+}
+
+/*
+    CFileDedup::Run
+    ---------------
+    Reads all files that share their size with another file and pairs each
+    duplicate with the first file that was added with the same contents.
+    Files with matching keys are compared byte for byte before they are
+    paired, so a checksum collision never pairs two different files. Empty
+    files are not considered duplicates since they don't occupy any data.
+*/
+void CFileDedup::Run(unsigned int uiThreadCount)
+{
+    m_Pending.clear();
+    m_lNextPending = 0;
+    m_uiDuplicateCount = 0;
+    m_uiDuplicateBytes = 0;
+
+    // Only files of the same size can be identical.
+    std::map<ckcore::tuint64,unsigned int> SizeCount;
+    for (unsigned int i = 0; i < m_Files.size(); i++)
+    {
+        m_Files[i].m_iOriginal = -1;
+        m_Files[i].m_bRead = false;
+
+        if (m_Files[i].m_Key.m_uiSize > 0)
+            SizeCount[m_Files[i].m_Key.m_uiSize]++;
+    }
+
+    for (unsigned int i = 0; i < m_Files.size(); i++)
+    {
+        if (m_Files[i].m_Key.m_uiSize > 0 && SizeCount[m_Files[i].m_Key.m_uiSize] > 1)
+            m_Pending.push_back(i);
+    }
+
+    if (m_Pending.empty())
+        return;
+
+    // Read the files.
+    unsigned int uiThreads = std::min<unsigned int>(std::max<unsigned int>(uiThreadCount,1),
+        (unsigned int)m_Pending.size());
+
+    std::vector<HANDLE> Threads;
+    for (unsigned int i = 0; i < uiThreads; i++)
+    {
+        unsigned long ulThreadId = 0;
+        HANDLE hThread = ::CreateThread(NULL,0,ReadThread,this,0,&ulThreadId);
+        if (hThread != NULL)
+            Threads.push_back(hThread);
+    }
+
+    // Read the remaining files on this thread if no thread could be created.
+    if (Threads.empty())
+        ReadThread(this);
+
+    for (unsigned int i = 0; i < Threads.size(); i++)
+    {
+        ::WaitForSingleObject(Threads[i],INFINITE);
+        ::CloseHandle(Threads[i]);
+    }
+
+    // Pair the duplicates with the first file of the same contents. Different
+    // contents with the same key each get an original of their own.
+    unsigned char *pBuffer1 = new unsigned char[FILEDEDUP_BLOCKSIZE];
+    unsigned char *pBuffer2 = new unsigned char[FILEDEDUP_BLOCKSIZE];
+
+    std::multimap<CKey,unsigned int> Originals;
+    for (unsigned int i = 0; i < m_Pending.size(); i++)
+    {
+        CFile &File = m_Files[m_Pending[i]];
+        if (!File.m_bRead)
+            continue;
+
+        std::pair<std::multimap<CKey,unsigned int>::const_iterator,
+            std::multimap<CKey,unsigned int>::const_iterator> Range =
+            Originals.equal_range(File.m_Key);
+
+        std::multimap<CKey,unsigned int>::const_iterator itOriginal;
+        for (itOriginal = Range.first; itOriginal != Range.second; itOriginal++)
+        {
+            if (CompareFiles(itOriginal->second,m_Pending[i],pBuffer1,pBuffer2))
+                break;
+        }
+
+        if (itOriginal != Range.second)
+        {
+            File.m_iOriginal = itOriginal->second;
+
+            m_uiDuplicateCount++;
+            m_uiDuplicateBytes += File.m_Key.m_uiSize;
+        }
+        else
+        {
+            Originals.insert(std::make_pair(File.m_Key,m_Pending[i]));
+        }
+    }
+
+    delete [] pBuffer1;
+    delete [] pBuffer2;
+}
+
+unsigned int CFileDedup::GetFileCount() const
+{
+    return (unsigned int)m_Files.size();
+}
+
+int CFileDedup::GetOriginal(unsigned int uiIndex) const
+{
+    return m_Files[uiIndex].m_iOriginal;
+}
+
+const ckcore::tchar *CFileDedup::GetFilePath(unsigned int uiIndex) const
+{
+    return m_Files[uiIndex].m_FilePath.c_str();
+}
+
+const CFileDedup::CKey &CFileDedup::GetKey(unsigned int uiIndex) const
+{
+    return m_Files[uiIndex].m_Key;
+}
+
+unsigned int CFileDedup::GetDuplicateCount() const
+{
+    return m_uiDuplicateCount;
+}
+
+ckcore::tuint64 CFileDedup::GetDuplicateBytes() const
+{
+    return m_uiDuplicateBytes;
+}
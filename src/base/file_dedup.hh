@@ -0,0 +1,101 @@
+/*
+ * InfraRecorder - CD/DVD burning software
+ * Copyright (C) 2006-2012 Christian Kindahl
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+#include <windows.h>
+#include <vector>
+#include <ckcore/types.hh>
+#include <ckcore/file.hh>
+
+#define FILEDEDUP_THREADS					4
+#define FILEDEDUP_BLOCKSIZE					(256 * 1024)
+
+// Finds files with identical contents. The files are first grouped by size
+// and only files that share their size with another file are read. The
+// contents of a file are identified by its size and the CRC-32 and CRC-32C
+// checksums of its data, which are calculated in a single pass by a small
+// pool of threads. Files with the same key are compared byte for byte before
+// they are considered duplicates.
+class CFileDedup
+{
+public:
+    class CKey
+    {
+    public:
+        ckcore::tuint64 m_uiSize;
+        ckcore::tuint32 m_uiCrc32;
+        ckcore::tuint32 m_uiCrc32c;
+
+        CKey() : m_uiSize(0),m_uiCrc32(0),m_uiCrc32c(0)
+        {
+        }
+
+        bool operator<(const CKey &Key) const;
+        bool operator==(const CKey &Key) const;
+    };
+
+private:
+    class CFile
+    {
+    public:
+        ckcore::tstring m_FilePath;
+        CKey m_Key;
+        int m_iOriginal;		// Index of the first file with the same contents, -1 if none.
+        bool m_bRead;
+
+        CFile(const ckcore::tchar *szFilePath,ckcore::tuint64 uiSize) :
+            m_FilePath(szFilePath),m_iOriginal(-1),m_bRead(false)
+        {
+            m_Key.m_uiSize = uiSize;
+        }
+    };
+
+    std::vector<CFile> m_Files;
+
+    // The files that are read by the threads.
+    std::vector<unsigned int> m_Pending;
+    volatile LONG m_lNextPending;
+
+    unsigned int m_uiDuplicateCount;
+    ckcore::tuint64 m_uiDuplicateBytes;
+
+    static DWORD WINAPI ReadThread(LPVOID lpParameter);
+
+    bool CompareFiles(unsigned int uiIndex1,unsigned int uiIndex2,unsigned char *pBuffer1,
+        unsigned char *pBuffer2) const;
+
+public:
+    CFileDedup();
+
+    unsigned int AddFile(const ckcore::tchar *szFilePath,ckcore::tuint64 uiSize);
+    void Run(unsigned int uiThreadCount = FILEDEDUP_THREADS);
+
+    unsigned int GetFileCount() const;
+    int GetOriginal(unsigned int uiIndex) const;
+    const ckcore::tchar *GetFilePath(unsigned int uiIndex) const;
+    const CKey &GetKey(unsigned int uiIndex) const;
+
+    unsigned int GetDuplicateCount() const;
+    ckcore::tuint64 GetDuplicateBytes() const;
+
+    static bool ReadKey(ckcore::File &File,ckcore::tuint64 uiSize,unsigned char *pBuffer,
+        CKey &Key);
+    static bool CompareData(ckcore::File &File1,ckcore::File &File2,ckcore::tuint64 uiSize,
+        unsigned char *pBuffer1,unsigned char *pBuffer2);
+};
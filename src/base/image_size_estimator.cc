@@ -0,0 +1,832 @@
+/*
+ * InfraRecorder - CD/DVD burning software
+ * Copyright (C) 2006-2012 Christian Kindahl
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <windows.h>
+#include <set>
+#include <ckcore/file.hh>
+#include "image_size_estimator.hh"
+
+#define IMAGESIZE_SYSTEM_SECTORS			16
+
+#define IMAGESIZE_ISO_MAX_DIRLEVEL			8
+#define IMAGESIZE_ISO_MAX_EXTENT			0xFFFFF800		// Largest sector aligned 32-bit extent.
+#define IMAGESIZE_ISO_MAX_DIRCOUNT			0xFFFF			// Parent numbers in the path table are 16-bit.
+#define IMAGESIZE_ISO_DIRRECORD_SIZE		33				// Directory record without identifier.
+#define IMAGESIZE_ISO_PATHTABLE_SIZE		8				// Path table record without identifier.
+
+#define IMAGESIZE_JOLIET_MAX_NAMELEN		64
+#define IMAGESIZE_JOLIET_MAX_NAMELEN_LONG	101
+
+#define IMAGESIZE_UDF_VRS_SECTORS			3				// BEA01, NSR02 and TEA01.
+#define IMAGESIZE_UDF_VDS_SECTORS			16				// Main and reserve volume descriptor sequences.
+#define IMAGESIZE_UDF_LVIS_SECTORS			2				// Logical volume integrity descriptor and terminator.
+#define IMAGESIZE_UDF_ANCHOR_SECTOR			256
+#define IMAGESIZE_UDF_FILESET_SECTORS		2				// File set descriptor and terminator.
+#define IMAGESIZE_UDF_FID_SIZE				38				// File identifier descriptor without identifier.
+#define IMAGESIZE_UDF_MAX_NAMELEN			254
+
+#define IMAGESIZE_CODEPAGE_DOS				437
+
+static ckcore::tstring MakeSuffix(unsigned int uiIndex)
+{
+    ckcore::tstring Suffix;
+    do
+    {
+        Suffix.insert(Suffix.begin(),static_cast<ckcore::tchar>('0' + uiIndex % 10));
+        uiIndex /= 10;
+    }
+    while (uiIndex > 0);
+
+    return ckT("~") + Suffix;
+}
+
+/*
+    Returns true if the character can be represented in the ISO9660
+    character set.
+*/
+static bool IsCharInCharSet(ckcore::tchar c,ckfilesystem::CharacterSet CharSet)
+{
+    unsigned int uiChar = static_cast<unsigned int>(c);
+    if (uiChar < 0x80)
+        return true;
+
+    switch (CharSet)
+    {
+        case ckfilesystem::CHARSET_ISO:
+            return uiChar <= 0xFF;
+
+        case ckfilesystem::CHARSET_DOS:
+        {
+#ifdef _UNICODE
+            char cMapped = 0;
+            BOOL bUsedDefault = FALSE;
+            return ::WideCharToMultiByte(IMAGESIZE_CODEPAGE_DOS,WC_NO_BEST_FIT_CHARS,&c,1,
+                                         &cMapped,1,NULL,&bUsedDefault) == 1 && !bUsedDefault;
+#else
+            return true;
+#endif
+        }
+
+        default:
+            return false;
+    }
+}
+
+/*
+    Splits a file name into its name and extension parts, the separating dot
+    is not included in any of them.
+*/
+static void SplitFileName(const ckcore::tstring &FileName,bool bDirectory,
+                          ckcore::tstring &Base,ckcore::tstring &Ext)
+{
+    ckcore::tstring::size_type uiDelim = bDirectory ? ckcore::tstring::npos :
+        FileName.rfind('.');
+
+    if (uiDelim == ckcore::tstring::npos)
+    {
+        Base = FileName;
+        Ext.clear();
+    }
+    else
+    {
+        Base = FileName.substr(0,uiDelim);
+        Ext = FileName.substr(uiDelim + 1);
+    }
+}
+
+/*
+    Truncates the name part of a file name so that the name and extension fits
+    within uiMaxLen characters. The extension is only truncated if it alone
+    is too long.
+*/
+static void TruncateFileName(ckcore::tstring &Base,ckcore::tstring &Ext,
+                             size_t uiMaxBaseLen,size_t uiMaxExtLen,size_t uiMaxLen)
+{
+    if (Ext.size() > uiMaxExtLen)
+        Ext.resize(uiMaxExtLen);
+    if (Base.size() > uiMaxBaseLen)
+        Base.resize(uiMaxBaseLen);
+
+    if (Base.size() + Ext.size() > uiMaxLen)
+    {
+        if (Ext.size() >= uiMaxLen)
+            Ext.resize(uiMaxLen - 1);
+
+        Base.resize(uiMaxLen - Ext.size());
+    }
+}
+
+/*
+    Returns the maximum identifier lengths in characters, excluding the
+    version suffix, of the ISO9660 or Joliet directory records.
+*/
+static void GetNameLimits(bool bJoliet,ckfilesystem::Iso::InterchangeLevel InterchangeLevel,
+                          bool bLongJolietNames,size_t &uiMaxLen,size_t &uiMaxDirLen,
+                          size_t &uiMaxExtLen)
+{
+    if (bJoliet)
+    {
+        uiMaxLen = bLongJolietNames ? IMAGESIZE_JOLIET_MAX_NAMELEN_LONG : IMAGESIZE_JOLIET_MAX_NAMELEN;
+        uiMaxDirLen = uiMaxLen;
+        uiMaxExtLen = uiMaxLen;
+        return;
+    }
+
+    switch (InterchangeLevel)
+    {
+        case ckfilesystem::Iso::LEVEL_1:
+            uiMaxLen = 8 + 3;
+            uiMaxDirLen = 8;
+            uiMaxExtLen = 3;
+            break;
+
+        case ckfilesystem::Iso::ISO9660_1999:
+            uiMaxLen = 206;
+            uiMaxDirLen = 207;
+            uiMaxExtLen = 206;
+            break;
+
+        default:
+            uiMaxLen = 30;
+            uiMaxDirLen = 31;
+            uiMaxExtLen = 30;
+            break;
+    }
+}
+
+/*
+    Splits a file name into the name and extension parts of its ISO9660 or
+    Joliet identifier, truncated to the limits of the tree. Returns the
+    maximum length of the name part.
+*/
+static size_t MakeIdentifier(const ckcore::tstring &Name,bool bDirectory,bool bJoliet,
+                             ckfilesystem::Iso::InterchangeLevel InterchangeLevel,
+                             bool bLongJolietNames,ckcore::tstring &Base,ckcore::tstring &Ext)
+{
+    size_t uiMaxLen,uiMaxDirLen,uiMaxExtLen;
+    GetNameLimits(bJoliet,InterchangeLevel,bLongJolietNames,uiMaxLen,uiMaxDirLen,uiMaxExtLen);
+
+    SplitFileName(Name,bDirectory,Base,Ext);
+
+    size_t uiMaxBaseLen = bDirectory ? uiMaxDirLen :
+        (InterchangeLevel == ckfilesystem::Iso::LEVEL_1 && !bJoliet ? 8 : uiMaxLen);
+    TruncateFileName(Base,Ext,uiMaxBaseLen,uiMaxExtLen,bDirectory ? uiMaxDirLen : uiMaxLen);
+
+    return uiMaxBaseLen;
+}
+
+/*
+    Returns true if the ";1" version suffix is appended to file identifiers.
+*/
+static bool HasFileVersion(bool bJoliet,ckfilesystem::Iso::InterchangeLevel InterchangeLevel,
+                           bool bIncludeFileVerInfo)
+{
+    return bIncludeFileVerInfo && (bJoliet || InterchangeLevel != ckfilesystem::Iso::ISO9660_1999);
+}
+
+CImageSizeEstimator::CImageSizeEstimator(ckfilesystem::FileSystem::Type FileSysType,
+                                         ckfilesystem::Iso::InterchangeLevel InterchangeLevel) :
+    m_FileSysType(FileSysType),m_InterchangeLevel(InterchangeLevel),
+    m_CharSet(ckfilesystem::CHARSET_ISO),m_bLongJolietNames(false),m_bIncludeFileVerInfo(true),
+    m_bRelaxMaxDirLevel(false)
+{
+}
+
+bool CImageSizeEstimator::UseIso() const
+{
+    return m_FileSysType != ckfilesystem::FileSystem::TYPE_UDF;
+}
+
+bool CImageSizeEstimator::UseJoliet() const
+{
+    return m_FileSysType == ckfilesystem::FileSystem::TYPE_ISO_JOLIET ||
+        m_FileSysType == ckfilesystem::FileSystem::TYPE_ISO_UDF_JOLIET;
+}
+
+bool CImageSizeEstimator::UseUdf() const
+{
+    return m_FileSysType == ckfilesystem::FileSystem::TYPE_ISO_UDF ||
+        m_FileSysType == ckfilesystem::FileSystem::TYPE_ISO_UDF_JOLIET ||
+        m_FileSysType == ckfilesystem::FileSystem::TYPE_UDF ||
+        m_FileSysType == ckfilesystem::FileSystem::TYPE_DVDVIDEO;
+}
+
+/*
+    Returns the index of the directory node with the specified internal path,
+    missing parent directories are created.
+*/
+int CImageSizeEstimator::GetNode(const ckcore::tstring &Path)
+{
+    std::map<ckcore::tstring,int>::const_iterator itNode = m_PathMap.find(Path);
+    if (itNode != m_PathMap.end())
+        return itNode->second;
+
+    ckcore::tstring::size_type uiDelim = Path.rfind('/');
+    int iParent = GetNode(Path.substr(0,uiDelim));
+
+    int iNode = static_cast<int>(m_Nodes.size());
+    m_Nodes.push_back(CNode(Path.substr(uiDelim + 1),true,m_Nodes[iParent].m_uiLevel + 1));
+    m_Nodes[iParent].m_Children.push_back(iNode);
+
+    m_PathMap[Path] = iNode;
+    return iNode;
+}
+
+bool CImageSizeEstimator::BuildTree(const ckfilesystem::FileSet &Files)
+{
+    m_Nodes.clear();
+    m_PathMap.clear();
+
+    // The root node is located at level one.
+    m_Nodes.push_back(CNode(ckT(""),true,1));
+    m_PathMap[ckT("")] = 0;
+
+    ckfilesystem::FileSet::const_iterator itFile;
+    for (itFile = Files.begin(); itFile != Files.end(); itFile++)
+    {
+        const ckfilesystem::FileDescriptor *pFile = *itFile;
+
+        ckcore::tstring Path = pFile->internal_path_;
+        if (Path.empty() || Path[0] != '/')
+            Path.insert(0,ckT("/"));
+        while (Path.size() > 1 && Path[Path.size() - 1] == '/')
+            Path.erase(Path.size() - 1);
+
+        if (Path.size() <= 1)
+            continue;
+
+        bool bDirectory = (pFile->flags_ & ckfilesystem::FileDescriptor::FLAG_DIRECTORY) != 0;
+        bool bImported = (pFile->flags_ & ckfilesystem::FileDescriptor::FLAG_IMPORTED) != 0;
+
+        int iNode;
+        if (bDirectory)
+        {
+            iNode = GetNode(Path);
+        }
+        else
+        {
+            ckcore::tstring::size_type uiDelim = Path.rfind('/');
+            int iParent = GetNode(Path.substr(0,uiDelim));
+
+            iNode = static_cast<int>(m_Nodes.size());
+            m_Nodes.push_back(CNode(Path.substr(uiDelim + 1),false,m_Nodes[iParent].m_uiLevel + 1));
+            m_Nodes[iParent].m_Children.push_back(iNode);
+
+            // Imported files are stored in a previous session, they only
+            // occupy space in the directory structures.
+            if (!bImported)
+            {
+                ckcore::tint64 iSize = ckcore::File::size(pFile->external_path_.c_str());
+                if (iSize < 0)
+                    return false;
+
+                m_Nodes[iNode].m_uiSize = static_cast<ckcore::tuint64>(iSize);
+            }
+        }
+
+        m_Nodes[iNode].m_bImported = bImported;
+    }
+
+    return true;
+}
+
+/*
+    Maps a name to the characters that the writer stores in the ISO9660 or
+    Joliet directory records. ISO9660 names are converted to the selected
+    character set and, below ISO9660:1999, restricted to upper case
+    d-characters. Joliet names may not contain the characters reserved by the
+    Joliet specification. Invalid characters are replaced by '_', which never
+    changes the length of the name but may make two names equal.
+*/
+void CImageSizeEstimator::MapName(ckcore::tstring &Name,bool bJoliet) const
+{
+    bool bDChars = !bJoliet && m_InterchangeLevel != ckfilesystem::Iso::ISO9660_1999;
+
+    for (size_t i = 0; i < Name.size(); i++)
+    {
+        ckcore::tchar c = Name[i];
+        if (bJoliet)
+        {
+            if (c == '*' || c == '/' || c == ':' || c == ';' || c == '?' || c == '\\')
+                Name[i] = '_';
+        }
+        else if (!IsCharInCharSet(c,m_CharSet))
+        {
+            Name[i] = '_';
+        }
+        else if (bDChars)
+        {
+            if (c >= 'a' && c <= 'z')
+                Name[i] = c - 'a' + 'A';
+            else if (!((c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_'))
+                Name[i] = '_';
+        }
+    }
+}
+
+/*
+    Calculates the identifier lengths in bytes of all children of the
+    specified directory, the way they will be stored in the ISO9660 or Joliet
+    directory records. Names that become equal after being converted are made
+    unique by replacing the end of the name with a sequence number.
+*/
+void CImageSizeEstimator::GetIdentifierLengths(const CNode &Dir,bool bJoliet,
+                                               std::vector<unsigned int> &Lengths) const
+{
+    size_t uiMaxLen,uiMaxDirLen,uiMaxExtLen;
+    GetNameLimits(bJoliet,m_InterchangeLevel,m_bLongJolietNames,uiMaxLen,uiMaxDirLen,uiMaxExtLen);
+
+    bool bVersion = HasFileVersion(bJoliet,m_InterchangeLevel,m_bIncludeFileVerInfo);
+
+    std::set<ckcore::tstring> UsedNames;
+
+    Lengths.clear();
+    Lengths.reserve(Dir.m_Children.size());
+
+    std::vector<int>::const_iterator itChild;
+    for (itChild = Dir.m_Children.begin(); itChild != Dir.m_Children.end(); itChild++)
+    {
+        const CNode &Child = m_Nodes[*itChild];
+
+        // Mapping never changes the length of a name so it may be done after
+        // the name has been truncated.
+        ckcore::tstring Base,Ext;
+        size_t uiMaxBaseLen = MakeIdentifier(Child.m_Name,Child.m_bDirectory,bJoliet,
+            m_InterchangeLevel,m_bLongJolietNames,Base,Ext);
+
+        MapName(Base,bJoliet);
+        MapName(Ext,bJoliet);
+
+        ckcore::tstring Name = Ext.empty() ? Base : Base + ckT(".") + Ext;
+        for (unsigned int uiIndex = 1; UsedNames.count(Name) > 0; uiIndex++)
+        {
+            ckcore::tstring Suffix = MakeSuffix(uiIndex);
+
+            ckcore::tstring UniqueBase = Base;
+            size_t uiLimit = Child.m_bDirectory ? uiMaxDirLen : uiMaxBaseLen;
+            if (!Child.m_bDirectory && Base.size() + Ext.size() + Suffix.size() > uiMaxLen)
+                uiLimit = uiMaxLen - Ext.size();
+            if (UniqueBase.size() + Suffix.size() > uiLimit)
+                UniqueBase.resize(uiLimit > Suffix.size() ? uiLimit - Suffix.size() : 0);
+
+            UniqueBase += Suffix;
+            Name = Ext.empty() ? UniqueBase : UniqueBase + ckT(".") + Ext;
+        }
+
+        UsedNames.insert(Name);
+
+        unsigned int uiLen = static_cast<unsigned int>(Name.size());
+        if (!Child.m_bDirectory && bVersion)
+            uiLen += 2;		// ";1"
+
+        Lengths.push_back(bJoliet ? uiLen * 2 : uiLen);
+    }
+}
+
+/*
+    Calculates the size in bytes of one of the two (L and M type) path tables,
+    excluding the record of the root directory.
+*/
+ckcore::tuint64 CImageSizeEstimator::CalcPathTableSize(bool bJoliet) const
+{
+    ckcore::tuint64 uiSize = 0;
+
+    std::vector<unsigned int> Lengths;
+    std::vector<CNode>::const_iterator itNode;
+    for (itNode = m_Nodes.begin(); itNode != m_Nodes.end(); itNode++)
+    {
+        if (!itNode->m_bDirectory)
+            continue;
+
+        GetIdentifierLengths(*itNode,bJoliet,Lengths);
+        for (size_t i = 0; i < itNode->m_Children.size(); i++)
+        {
+            const CNode &Child = m_Nodes[itNode->m_Children[i]];
+            if (!Child.m_bDirectory)
+                continue;
+
+            // ISO9660 directories below the maximum level are not written.
+            if (!bJoliet && !m_bRelaxMaxDirLevel && Child.m_uiLevel > IMAGESIZE_ISO_MAX_DIRLEVEL)
+                continue;
+
+            uiSize += GetPathTableRecordSize(Lengths[i]);
+        }
+    }
+
+    return uiSize;
+}
+
+/*
+    Calculates the number of sectors occupied by the ISO9660 or Joliet
+    directory records. Each directory is stored in its own extent and a
+    record may not cross a sector boundary.
+*/
+ckcore::tuint64 CImageSizeEstimator::CalcDirRecordSectors(bool bJoliet) const
+{
+    ckcore::tuint64 uiSectors = 0;
+
+    std::vector<unsigned int> Lengths;
+    std::vector<CNode>::const_iterator itNode;
+    for (itNode = m_Nodes.begin(); itNode != m_Nodes.end(); itNode++)
+    {
+        if (!itNode->m_bDirectory)
+            continue;
+
+        if (!bJoliet && !m_bRelaxMaxDirLevel && itNode->m_uiLevel > IMAGESIZE_ISO_MAX_DIRLEVEL)
+            continue;
+
+        GetIdentifierLengths(*itNode,bJoliet,Lengths);
+
+        // The "." and ".." records.
+        unsigned int uiSectorUsed = 2 * GetDirRecordSize(1);
+        ckcore::tuint64 uiDirSectors = 1;
+
+        for (size_t i = 0; i < itNode->m_Children.size(); i++)
+        {
+            const CNode &Child = m_Nodes[itNode->m_Children[i]];
+            if (!bJoliet && !m_bRelaxMaxDirLevel && Child.m_bDirectory &&
+                Child.m_uiLevel > IMAGESIZE_ISO_MAX_DIRLEVEL)
+            {
+                continue;
+            }
+
+            unsigned int uiRecordSize = GetDirRecordSize(Lengths[i]);
+
+            // Files larger than a single extent are stored using multiple
+            // directory records.
+            ckcore::tuint64 uiRecords = 1;
+            if (!Child.m_bDirectory && Child.m_uiSize > IMAGESIZE_ISO_MAX_EXTENT)
+                uiRecords = (Child.m_uiSize + IMAGESIZE_ISO_MAX_EXTENT - 1) / IMAGESIZE_ISO_MAX_EXTENT;
+
+            for (ckcore::tuint64 j = 0; j < uiRecords; j++)
+            {
+                if (uiSectorUsed + uiRecordSize > IMAGESIZE_SECTOR_SIZE)
+                {
+                    uiDirSectors++;
+                    uiSectorUsed = 0;
+                }
+
+                uiSectorUsed += uiRecordSize;
+            }
+        }
+
+        uiSectors += uiDirSectors;
+    }
+
+    return uiSectors;
+}
+
+/*
+    Calculates the number of sectors occupied by the extents holding the UDF
+    file identifier descriptors of the directories.
+*/
+ckcore::tuint64 CImageSizeEstimator::CalcUdfDirSectors() const
+{
+    ckcore::tuint64 uiSectors = 0;
+
+    std::vector<CNode>::const_iterator itNode;
+    for (itNode = m_Nodes.begin(); itNode != m_Nodes.end(); itNode++)
+    {
+        if (!itNode->m_bDirectory)
+            continue;
+
+        // The parent entry has an empty identifier.
+        ckcore::tuint64 uiDirSize = GetUdfIdentDescSize(ckT(""));
+
+        std::vector<int>::const_iterator itChild;
+        for (itChild = itNode->m_Children.begin(); itChild != itNode->m_Children.end(); itChild++)
+            uiDirSize += GetUdfIdentDescSize(m_Nodes[*itChild].m_Name);
+
+        uiSectors += BytesToSectors(uiDirSize);
+    }
+
+    return uiSectors;
+}
+
+ckcore::tuint64 CImageSizeEstimator::CalcFileDataSectors() const
+{
+    ckcore::tuint64 uiSectors = 0;
+
+    std::vector<CNode>::const_iterator itNode;
+    for (itNode = m_Nodes.begin(); itNode != m_Nodes.end(); itNode++)
+    {
+        if (!itNode->m_bDirectory && !itNode->m_bImported)
+            uiSectors += BytesToSectors(itNode->m_uiSize);
+    }
+
+    return uiSectors;
+}
+
+/**
+    Selects the character set of the ISO9660 file names.
+    @param CharSet the character set.
+*/
+void CImageSizeEstimator::SetCharSet(ckfilesystem::CharacterSet CharSet)
+{
+    m_CharSet = CharSet;
+}
+
+/**
+    Enables or disables long Joliet file names (up to 101 characters).
+    @param bEnable true to enable long file names.
+*/
+void CImageSizeEstimator::SetLongJolietNames(bool bEnable)
+{
+    m_bLongJolietNames = bEnable;
+}
+
+/**
+    Selects if the ";1" file version suffix will be part of the ISO9660 and
+    Joliet file identifiers.
+    @param bInclude true if the suffix should be included.
+*/
+void CImageSizeEstimator::SetIncludeFileVerInfo(bool bInclude)
+{
+    m_bIncludeFileVerInfo = bInclude;
+}
+
+/**
+    Selects if ISO9660 directories may be nested deeper than eight levels.
+    @param bRelax true to allow deep directory structures.
+*/
+void CImageSizeEstimator::SetRelaxMaxDirLevel(bool bRelax)
+{
+    m_bRelaxMaxDirLevel = bRelax;
+}
+
+/**
+    Adds an El Torito boot image to the estimation.
+    @param szFullPath path to the boot image file.
+    @return true if the boot image was added, false if its size could not be
+    determined.
+*/
+bool CImageSizeEstimator::AddBootImage(const ckcore::tchar *szFullPath)
+{
+    ckcore::tint64 iSize = ckcore::File::size(szFullPath);
+    if (iSize < 0)
+        return false;
+
+    m_BootImageSizes.push_back(static_cast<ckcore::tuint64>(iSize));
+    return true;
+}
+
+/**
+    Returns the ISO9660 interchange level of the file names.
+*/
+ckfilesystem::Iso::InterchangeLevel CImageSizeEstimator::GetInterchangeLevel() const
+{
+    return m_InterchangeLevel;
+}
+
+bool CImageSizeEstimator::GetLongJolietNames() const
+{
+    return m_bLongJolietNames;
+}
+
+bool CImageSizeEstimator::GetIncludeFileVerInfo() const
+{
+    return m_bIncludeFileVerInfo;
+}
+
+/**
+    Calculates the size of a disc image from the sizes of its file set
+    dependent parts. The layout mirrors the allocation order of the writer.
+    @param Layout the sizes of the parts depending on the file set.
+    @param uiImageSize reference to the variable receiving the image size in
+    bytes.
+    @return true if the size could be calculated, false if the volume
+    structures do not fit in front of the UDF anchor.
+*/
+bool CImageSizeEstimator::CalcImageSize(const CImageLayout &Layout,ckcore::tuint64 &uiImageSize) const
+{
+    ckcore::tuint64 uiSectors = IMAGESIZE_SYSTEM_SECTORS;
+
+    // Volume descriptors.
+    if (UseIso())
+    {
+        uiSectors++;						// Primary volume descriptor.
+        if (!m_BootImageSizes.empty())
+            uiSectors++;					// Boot record.
+        if (UseJoliet())
+            uiSectors++;					// Supplementary volume descriptor.
+        if (m_InterchangeLevel == ckfilesystem::Iso::ISO9660_1999)
+            uiSectors++;					// Enhanced volume descriptor.
+        uiSectors++;						// Set terminator.
+    }
+
+    if (UseUdf())
+        uiSectors += IMAGESIZE_UDF_VRS_SECTORS;
+
+    // El Torito boot catalog and images.
+    if (UseIso() && !m_BootImageSizes.empty())
+    {
+        uiSectors++;
+
+        std::vector<ckcore::tuint64>::const_iterator itBootImage;
+        for (itBootImage = m_BootImageSizes.begin(); itBootImage != m_BootImageSizes.end(); itBootImage++)
+            uiSectors += BytesToSectors(*itBootImage);
+    }
+
+    // Path tables and directory records. The root directory has a one byte
+    // identifier.
+    if (UseIso())
+    {
+        uiSectors += 2 * BytesToSectors(GetPathTableRecordSize(1) + Layout.m_uiIsoPathTableSize);
+        if (UseJoliet())
+            uiSectors += 2 * BytesToSectors(GetPathTableRecordSize(1) + Layout.m_uiJolietPathTableSize);
+
+        uiSectors += Layout.m_uiIsoDirSectors;
+        if (UseJoliet())
+            uiSectors += Layout.m_uiJolietDirSectors;
+    }
+
+    // UDF volume structures, the anchor must be located at sector 256.
+    if (UseUdf())
+    {
+        uiSectors += 2 * IMAGESIZE_UDF_VDS_SECTORS + IMAGESIZE_UDF_LVIS_SECTORS;
+        if (uiSectors > IMAGESIZE_UDF_ANCHOR_SECTOR)
+            return false;
+
+        // Every file and directory is described by a file entry occupying
+        // one sector.
+        uiSectors = IMAGESIZE_UDF_ANCHOR_SECTOR + 1;
+        uiSectors += IMAGESIZE_UDF_FILESET_SECTORS + Layout.m_uiFileCount + Layout.m_uiDirCount;
+        uiSectors += Layout.m_uiUdfDirSectors;
+    }
+
+    uiSectors += Layout.m_uiFileDataSectors;
+
+    // Closing anchor volume descriptor pointer.
+    if (UseUdf())
+        uiSectors++;
+
+    uiImageSize = uiSectors * IMAGESIZE_SECTOR_SIZE;
+    return true;
+}
+
+/**
+    Calculates the size of the disc image.
+    @param Files the files to include in the image.
+    @param uiImageSize reference to the variable receiving the image size in
+    bytes.
+    @param pDataOffset optional pointer to the variable receiving the position
+    in bytes of the file data in the image.
+    @return true if the size could be calculated, false if the file set uses
+    a layout that can not be calculated without building the image (for
+    example DVD-Video padding) or if the file meta data could not be read.
+*/
+bool CImageSizeEstimator::Estimate(const ckfilesystem::FileSet &Files,ckcore::tuint64 &uiImageSize,
+                                   ckcore::tuint64 *pDataOffset)
+{
+    // DVD-Video file padding depends on the contents of the IFO files.
+    if (m_FileSysType == ckfilesystem::FileSystem::TYPE_DVDVIDEO)
+        return false;
+
+    if (!BuildTree(Files))
+        return false;
+
+    CImageLayout Layout;
+    Layout.m_uiDirCount = 0;
+
+    std::vector<CNode>::const_iterator itNode;
+    for (itNode = m_Nodes.begin(); itNode != m_Nodes.end(); itNode++)
+    {
+        if (itNode->m_bDirectory)
+        {
+            Layout.m_uiDirCount++;
+            continue;
+        }
+
+        Layout.m_uiFileCount++;
+
+        // Only interchange level 3 and above support multi-extent files.
+        if (UseIso() && itNode->m_uiSize > IMAGESIZE_ISO_MAX_EXTENT &&
+            (m_InterchangeLevel == ckfilesystem::Iso::LEVEL_1 ||
+             m_InterchangeLevel == ckfilesystem::Iso::LEVEL_2))
+        {
+            return false;
+        }
+    }
+
+    if (UseIso())
+    {
+        if (Layout.m_uiDirCount > IMAGESIZE_ISO_MAX_DIRCOUNT)
+            return false;
+
+        Layout.m_uiIsoPathTableSize = CalcPathTableSize(false);
+        Layout.m_uiIsoDirSectors = CalcDirRecordSectors(false);
+
+        if (UseJoliet())
+        {
+            Layout.m_uiJolietPathTableSize = CalcPathTableSize(true);
+            Layout.m_uiJolietDirSectors = CalcDirRecordSectors(true);
+        }
+    }
+
+    if (UseUdf())
+        Layout.m_uiUdfDirSectors = CalcUdfDirSectors();
+
+    Layout.m_uiFileDataSectors = CalcFileDataSectors();
+
+    if (!CalcImageSize(Layout,uiImageSize))
+        return false;
+
+    // The file data is followed by the closing UDF anchor.
+    if (pDataOffset != NULL)
+    {
+        *pDataOffset = uiImageSize - Layout.m_uiFileDataSectors * IMAGESIZE_SECTOR_SIZE;
+        if (UseUdf())
+            *pDataOffset -= IMAGESIZE_SECTOR_SIZE;
+    }
+
+    return true;
+}
+
+ckcore::tuint64 CImageSizeEstimator::BytesToSectors(ckcore::tuint64 uiBytes)
+{
+    return (uiBytes + IMAGESIZE_SECTOR_SIZE - 1) / IMAGESIZE_SECTOR_SIZE;
+}
+
+/**
+    Calculates the length in bytes of the ISO9660 or Joliet identifier of a
+    name, the way it will be stored in a directory record. Making names
+    unique within their directory is not accounted for, neither is the
+    character set since mapping never changes the length of a name.
+    @param Name the file or directory name.
+    @param bDirectory true if the name belongs to a directory.
+    @param bJoliet true to calculate the Joliet identifier length.
+    @param InterchangeLevel the ISO9660 interchange level.
+    @param bLongJolietNames true if long Joliet names are allowed.
+    @param bIncludeFileVerInfo true if file identifiers include the ";1"
+    version suffix.
+    @return the identifier length in bytes.
+*/
+unsigned int CImageSizeEstimator::GetIdentifierLength(const ckcore::tstring &Name,bool bDirectory,
+                                                      bool bJoliet,ckfilesystem::Iso::InterchangeLevel InterchangeLevel,
+                                                      bool bLongJolietNames,bool bIncludeFileVerInfo)
+{
+    ckcore::tstring Base,Ext;
+    MakeIdentifier(Name,bDirectory,bJoliet,InterchangeLevel,bLongJolietNames,Base,Ext);
+
+    size_t uiLen = Ext.empty() ? Base.size() : Base.size() + 1 + Ext.size();
+    if (!bDirectory && HasFileVersion(bJoliet,InterchangeLevel,bIncludeFileVerInfo))
+        uiLen += 2;		// ";1"
+
+    return static_cast<unsigned int>(bJoliet ? uiLen * 2 : uiLen);
+}
+
+/**
+    Returns the size of an ISO9660 directory record, records are padded to
+    an even number of bytes.
+    @param uiIdentLen the identifier length in bytes.
+*/
+unsigned int CImageSizeEstimator::GetDirRecordSize(unsigned int uiIdentLen)
+{
+    unsigned int uiRecordSize = IMAGESIZE_ISO_DIRRECORD_SIZE + uiIdentLen;
+    return uiRecordSize + (uiRecordSize & 1);
+}
+
+/**
+    Returns the size of an ISO9660 path table record.
+    @param uiIdentLen the identifier length in bytes.
+*/
+unsigned int CImageSizeEstimator::GetPathTableRecordSize(unsigned int uiIdentLen)
+{
+    return IMAGESIZE_ISO_PATHTABLE_SIZE + uiIdentLen + (uiIdentLen & 1);
+}
+
+/**
+    Returns the size of a UDF file identifier descriptor. Names are stored as
+    OSTA compressed unicode, using 8 bits per character when possible.
+    @param Name the file or directory name, empty for the parent entry.
+*/
+unsigned int CImageSizeEstimator::GetUdfIdentDescSize(const ckcore::tstring &Name)
+{
+    if (Name.empty())
+        return (IMAGESIZE_UDF_FID_SIZE + 3) & ~3;
+
+    bool bWide = false;
+    for (size_t i = 0; i < Name.size() && !bWide; i++)
+        bWide = static_cast<unsigned int>(Name[i]) > 0xFF;
+
+    size_t uiMaxLen = IMAGESIZE_UDF_MAX_NAMELEN / (bWide ? 2 : 1);
+    size_t uiNameLen = Name.size() < uiMaxLen ? Name.size() : uiMaxLen;
+    size_t uiIdentLen = 1 + uiNameLen * (bWide ? 2 : 1);
+
+    return static_cast<unsigned int>((IMAGESIZE_UDF_FID_SIZE + uiIdentLen + 3) & ~3);
+}
@@ -0,0 +1,128 @@
+/*
+ * InfraRecorder - CD/DVD burning software
+ * Copyright (C) 2006-2012 Christian Kindahl
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#include <vector>
+#include <map>
+#include <ckcore/types.hh>
+#include <ckfilesystem/fileset.hh>
+#include <ckfilesystem/filesystem.hh>
+#include <ckfilesystem/iso.hh>
+
+#define IMAGESIZE_SECTOR_SIZE				2048
+
+// Sizes of the parts of a disc image that depend on the files and folders in
+// it. The sizes of the remaining structures are given by the file system.
+class CImageLayout
+{
+public:
+    ckcore::tuint64 m_uiFileCount;
+    ckcore::tuint64 m_uiDirCount;				// Including the root directory.
+    ckcore::tuint64 m_uiIsoPathTableSize;		// One path table in bytes, excluding the root.
+    ckcore::tuint64 m_uiIsoDirSectors;
+    ckcore::tuint64 m_uiJolietPathTableSize;
+    ckcore::tuint64 m_uiJolietDirSectors;
+    ckcore::tuint64 m_uiUdfDirSectors;			// File identifier descriptors.
+    ckcore::tuint64 m_uiFileDataSectors;
+
+    CImageLayout() :
+        m_uiFileCount(0),m_uiDirCount(1),m_uiIsoPathTableSize(0),m_uiIsoDirSectors(0),
+        m_uiJolietPathTableSize(0),m_uiJolietDirSectors(0),m_uiUdfDirSectors(0),
+        m_uiFileDataSectors(0)
+    {
+    }
+};
+
+// Calculates the size of the disc image that ckfilesystem::FileSystemWriter
+// would produce for a file set, using the file set meta data only. The layout
+// mirrors the allocation order of the writer: volume descriptors, boot data,
+// path tables and directory records of the ISO9660 and Joliet trees, the UDF
+// descriptors and partition followed by the file data. File names are mapped
+// to the character set of each tree, with invalid characters replaced by '_',
+// before duplicate names are made unique, like the writer does.
+class CImageSizeEstimator
+{
+private:
+    class CNode
+    {
+    public:
+        ckcore::tstring m_Name;
+        bool m_bDirectory;
+        bool m_bImported;
+        ckcore::tuint64 m_uiSize;
+        unsigned int m_uiLevel;
+        std::vector<int> m_Children;
+
+        CNode(const ckcore::tstring &Name,bool bDirectory,unsigned int uiLevel) :
+            m_Name(Name),m_bDirectory(bDirectory),m_bImported(false),m_uiSize(0),
+            m_uiLevel(uiLevel)
+        {
+        }
+    };
+
+    ckfilesystem::FileSystem::Type m_FileSysType;
+    ckfilesystem::Iso::InterchangeLevel m_InterchangeLevel;
+    ckfilesystem::CharacterSet m_CharSet;
+    bool m_bLongJolietNames;
+    bool m_bIncludeFileVerInfo;
+    bool m_bRelaxMaxDirLevel;
+    std::vector<ckcore::tuint64> m_BootImageSizes;
+
+    std::vector<CNode> m_Nodes;
+    std::map<ckcore::tstring,int> m_PathMap;
+
+    int GetNode(const ckcore::tstring &Path);
+    bool BuildTree(const ckfilesystem::FileSet &Files);
+
+    void MapName(ckcore::tstring &Name,bool bJoliet) const;
+    void GetIdentifierLengths(const CNode &Dir,bool bJoliet,
+        std::vector<unsigned int> &Lengths) const;
+    ckcore::tuint64 CalcPathTableSize(bool bJoliet) const;
+    ckcore::tuint64 CalcDirRecordSectors(bool bJoliet) const;
+    ckcore::tuint64 CalcUdfDirSectors() const;
+    ckcore::tuint64 CalcFileDataSectors() const;
+
+public:
+    CImageSizeEstimator(ckfilesystem::FileSystem::Type FileSysType,
+        ckfilesystem::Iso::InterchangeLevel InterchangeLevel);
+
+    void SetCharSet(ckfilesystem::CharacterSet CharSet);
+    void SetLongJolietNames(bool bEnable);
+    void SetIncludeFileVerInfo(bool bInclude);
+    void SetRelaxMaxDirLevel(bool bRelax);
+    bool AddBootImage(const ckcore::tchar *szFullPath);
+
+    ckfilesystem::Iso::InterchangeLevel GetInterchangeLevel() const;
+    bool GetLongJolietNames() const;
+    bool GetIncludeFileVerInfo() const;
+    bool UseIso() const;
+    bool UseJoliet() const;
+    bool UseUdf() const;
+
+    bool CalcImageSize(const CImageLayout &Layout,ckcore::tuint64 &uiImageSize) const;
+    bool Estimate(const ckfilesystem::FileSet &Files,ckcore::tuint64 &uiImageSize,
+                  ckcore::tuint64 *pDataOffset = NULL);
+
+    static ckcore::tuint64 BytesToSectors(ckcore::tuint64 uiBytes);
+    static unsigned int GetIdentifierLength(const ckcore::tstring &Name,bool bDirectory,
+        bool bJoliet,ckfilesystem::Iso::InterchangeLevel InterchangeLevel,
+        bool bLongJolietNames,bool bIncludeFileVerInfo);
+    static unsigned int GetDirRecordSize(unsigned int uiIdentLen);
+    static unsigned int GetPathTableRecordSize(unsigned int uiIdentLen);
+    static unsigned int GetUdfIdentDescSize(const ckcore::tstring &Name);
+};
@@ -0,0 +1,107 @@
+/*
+ * InfraRecorder - CD/DVD burning software
+ * Copyright (C) 2006-2012 Christian Kindahl
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "prefix_matcher.hh"
+
+CPrefixMatcher::CPrefixMatcher()
+{
+    for (int i = 0; i < 256; i++)
+        m_iRoot[i] = -1;
+}
+
+int CPrefixMatcher::FindChild(int iNode,char cChar) const
+{
+    for (int i = m_Nodes[iNode].m_iChild; i != -1; i = m_Nodes[i].m_iSibling)
+    {
+        if (m_Nodes[i].m_cChar == cChar)
+            return i;
+    }
+
+    return -1;
+}
+
+/**
+    Adds a prefix to the matcher.
+    @param szPrefix the prefix, must contain at least one character.
+    @param iToken the value that Match should return when a string begins
+    with the prefix, must not be PREFIXMATCHER_NOMATCH.
+*/
+void CPrefixMatcher::Add(const char *szPrefix,int iToken)
+{
+    if (szPrefix[0] == '\0' || iToken == PREFIXMATCHER_NOMATCH)
+        return;
+
+    unsigned char ucFirst = static_cast<unsigned char>(szPrefix[0]);
+    if (m_iRoot[ucFirst] == -1)
+    {
+        m_iRoot[ucFirst] = static_cast<int>(m_Nodes.size());
+        m_Nodes.push_back(CNode(szPrefix[0]));
+    }
+
+    int iNode = m_iRoot[ucFirst];
+    for (const char *pChar = szPrefix + 1; *pChar != '\0'; pChar++)
+    {
+        int iChild = FindChild(iNode,*pChar);
+        if (iChild == -1)
+        {
+            iChild = static_cast<int>(m_Nodes.size());
+            m_Nodes.push_back(CNode(*pChar));
+
+            m_Nodes[iChild].m_iSibling = m_Nodes[iNode].m_iChild;
+            m_Nodes[iNode].m_iChild = iChild;
+        }
+
+        iNode = iChild;
+    }
+
+    m_Nodes[iNode].m_iToken = iToken;
+}
+
+/**
+    Finds the longest registered prefix of the specified string.
+    @param szString the string to examine.
+    @param pMatchLen optional pointer to a variable that will receive the
+    length of the matched prefix.
+    @return the token of the matching prefix, or PREFIXMATCHER_NOMATCH if no
+    prefix matches.
+*/
+int CPrefixMatcher::Match(const char *szString,unsigned int *pMatchLen) const
+{
+    int iToken = PREFIXMATCHER_NOMATCH;
+    unsigned int uiMatchLen = 0;
+
+    int iNode = m_iRoot[static_cast<unsigned char>(szString[0])];
+    for (unsigned int uiLen = 1; iNode != -1; uiLen++)
+    {
+        if (m_Nodes[iNode].m_iToken != PREFIXMATCHER_NOMATCH)
+        {
+            iToken = m_Nodes[iNode].m_iToken;
+            uiMatchLen = uiLen;
+        }
+
+        if (szString[uiLen] == '\0')
+            break;
+
+        iNode = FindChild(iNode,szString[uiLen]);
+    }
+
+    if (pMatchLen != NULL)
+        *pMatchLen = uiMatchLen;
+
+    return iToken;
+}
@@ -0,0 +1,54 @@
+/*
+ * InfraRecorder - CD/DVD burning software
+ * Copyright (C) 2006-2012 Christian Kindahl
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#include <vector>
+
+#define PREFIXMATCHER_NOMATCH			0
+
+// Matches the beginning of strings against a fixed set of prefixes using a
+// trie. The first character is dispatched through a table, remaining levels
+// are stored as sibling lists.
+class CPrefixMatcher
+{
+private:
+    class CNode
+    {
+    public:
+        char m_cChar;
+        int m_iToken;
+        int m_iChild;
+        int m_iSibling;
+
+        CNode(char cChar) : m_cChar(cChar),m_iToken(PREFIXMATCHER_NOMATCH),
+            m_iChild(-1),m_iSibling(-1)
+        {
+        }
+    };
+
+    std::vector<CNode> m_Nodes;
+    int m_iRoot[256];
+
+    int FindChild(int iNode,char cChar) const;
+
+public:
+    CPrefixMatcher();
+
+    void Add(const char *szPrefix,int iToken);
+    int Match(const char *szString,unsigned int *pMatchLen = NULL) const;
+};
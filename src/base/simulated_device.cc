@@ -0,0 +1,730 @@
+/*
+ * InfraRecorder - CD/DVD burning software
+ * Copyright (C) 2006-2012 Christian Kindahl
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <windows.h>
+#include <string.h>
+#include "simulated_device.hh"
+
+// The commands understood by the simulated device, see app/core/scsi.hh.
+#define SIMDEVICE_TEST_UNIT_READY			0x00
+#define SIMDEVICE_REQUEST_SENSE				0x03
+#define SIMDEVICE_FORMAT_UNIT				0x04
+#define SIMDEVICE_START_STOP_UNIT			0x1B
+#define SIMDEVICE_PREVENTALLOW_REMOVAL		0x1E
+#define SIMDEVICE_READ_CAPACITY				0x25
+#define SIMDEVICE_READ10					0x28
+#define SIMDEVICE_SYNCHRONIZE_CACHE			0x35
+#define SIMDEVICE_READ_TOC_PMA_ATIP			0x43
+#define SIMDEVICE_GET_CONFIGURATION			0x46
+#define SIMDEVICE_GET_EVENT_STATUS			0x4A
+#define SIMDEVICE_READ_DISC_INFORMATION		0x51
+#define SIMDEVICE_READ_TRACK_INFORMATION	0x52
+#define SIMDEVICE_MODE_SELECT10				0x55
+#define SIMDEVICE_CLOSE_TRACK_SESSION		0x5B
+#define SIMDEVICE_BLANK						0xA1
+#define SIMDEVICE_SET_CD_SPEED				0xBB
+#define SIMDEVICE_READ_CD					0xBE
+
+#define SIMDEVICE_STAT_GOOD					0x00
+#define SIMDEVICE_STAT_CHECK_CONDITION		0x02
+
+#define SIMDEVICE_SENSEKEY_MEDIUM_ERROR		0x03
+#define SIMDEVICE_SENSEKEY_ILLEGAL_REQUEST	0x05
+
+#define SIMDEVICE_RAW_BLOCKSIZE				2352
+#define SIMDEVICE_DATA_BLOCKSIZE			2048
+#define SIMDEVICE_C2_BITS					294
+#define SIMDEVICE_C2_BLOCKANDBITS			296
+#define SIMDEVICE_LEADOUT_TRACK				0xAA
+
+static void WriteBigEndian32(unsigned char *pBuffer,unsigned long ulValue)
+{
+    pBuffer[0] = static_cast<unsigned char>(ulValue >> 24);
+    pBuffer[1] = static_cast<unsigned char>(ulValue >> 16);
+    pBuffer[2] = static_cast<unsigned char>(ulValue >>  8);
+    pBuffer[3] = static_cast<unsigned char>(ulValue & 0xFF);
+}
+
+static unsigned long ReadBigEndian32(const unsigned char *pBuffer)
+{
+    return ((unsigned long)pBuffer[0] << 24) | ((unsigned long)pBuffer[1] << 16) |
+        ((unsigned long)pBuffer[2] << 8) | pBuffer[3];
+}
+
+static void CopyResponse(unsigned char *pData,unsigned long ulDataLen,
+                         const unsigned char *pResponse,unsigned long ulResponseLen)
+{
+    if (pData == NULL)
+        return;
+
+    memset(pData,0,ulDataLen);
+    memcpy(pData,pResponse,ulResponseLen < ulDataLen ? ulResponseLen : ulDataLen);
+}
+
+CSimulatedDevice::CSimulatedDevice(const ckcore::tchar *szImagePath,
+                                   unsigned long ulImageBlockSize) :
+    m_ImageFile(szImagePath),m_ulImageBlockSize(ulImageBlockSize),m_ulBlockCount(0),
+    m_usProfile(SIMDEVICE_PROFILE_CDROM),m_bBlank(false),m_ulCommandLatency(0),
+    m_ulBlockLatency(0),m_ulBadBlockLatency(0),m_ulMaxTransferLength(0),m_bRealTime(false),
+    m_ulCommandCount(0),m_ulBlocksRead(0),m_uiElapsed(0),m_uiSleepDebt(0)
+{
+    memset(m_ucSense,0,sizeof(m_ucSense));
+}
+
+CSimulatedDevice::~CSimulatedDevice()
+{
+    Close();
+}
+
+/**
+    Opens the disc image.
+    @return true if the image could be opened, false otherwise.
+*/
+bool CSimulatedDevice::Open()
+{
+    if (m_ulImageBlockSize != SIMDEVICE_DATA_BLOCKSIZE &&
+        m_ulImageBlockSize != SIMDEVICE_RAW_BLOCKSIZE)
+    {
+        return false;
+    }
+
+    if (!m_ImageFile.open(ckcore::File::ckOPEN_READ))
+        return false;
+
+    ckcore::tint64 iSize = m_ImageFile.size();
+    if (iSize < 0)
+    {
+        m_ImageFile.close();
+        return false;
+    }
+
+    m_ulBlockCount = (unsigned long)(iSize / m_ulImageBlockSize);
+
+    if (m_Tracks.empty())
+        m_Tracks.push_back(CTrack(1,0,false));
+
+    return true;
+}
+
+void CSimulatedDevice::Close()
+{
+    m_ImageFile.close();
+}
+
+/**
+    Adds a track to the TOC description. Tracks must be added in order, each
+    track ends where the next track starts.
+*/
+void CSimulatedDevice::AddTrack(unsigned char ucNumber,unsigned long ulStartBlock,bool bAudio)
+{
+    m_Tracks.push_back(CTrack(ucNumber,ulStartBlock,bAudio));
+}
+
+void CSimulatedDevice::SetProfile(unsigned short usProfile)
+{
+    m_usProfile = usProfile;
+}
+
+/**
+    Sets the simulated latency.
+    @param ulCommandLatency the time each command takes in microseconds.
+    @param ulBlockLatency the time it takes to transfer a block in
+    microseconds.
+    @param ulBadBlockLatency the additional time spent on each unreadable
+    block in microseconds.
+*/
+void CSimulatedDevice::SetLatency(unsigned long ulCommandLatency,unsigned long ulBlockLatency,
+                                  unsigned long ulBadBlockLatency)
+{
+    m_ulCommandLatency = ulCommandLatency;
+    m_ulBlockLatency = ulBlockLatency;
+    m_ulBadBlockLatency = ulBadBlockLatency;
+}
+
+/**
+    Sets the largest number of bytes that can be transferred by one command,
+    larger transfers fail the same way as they do on the real transport. A
+    length of 0 means unlimited.
+*/
+void CSimulatedDevice::SetMaxTransferLength(unsigned long ulMaxTransferLength)
+{
+    m_ulMaxTransferLength = ulMaxTransferLength;
+}
+
+/**
+    Selects if the latency should only be accounted for or also slept.
+*/
+void CSimulatedDevice::SetRealTime(bool bRealTime)
+{
+    m_bRealTime = bRealTime;
+}
+
+void CSimulatedDevice::AddBadBlock(unsigned long ulBlock)
+{
+    m_BadBlocks.insert(ulBlock);
+}
+
+unsigned long CSimulatedDevice::GetBlockCount() const
+{
+    return m_ulBlockCount;
+}
+
+unsigned long CSimulatedDevice::GetCommandCount() const
+{
+    return m_ulCommandCount;
+}
+
+unsigned long CSimulatedDevice::GetBlocksRead() const
+{
+    return m_ulBlocksRead;
+}
+
+/**
+    Returns the simulated time spent by the device in microseconds.
+*/
+unsigned __int64 CSimulatedDevice::GetElapsedTime() const
+{
+    return m_uiElapsed;
+}
+
+void CSimulatedDevice::ResetStatistics()
+{
+    m_ulCommandCount = 0;
+    m_ulBlocksRead = 0;
+    m_uiElapsed = 0;
+    m_uiSleepDebt = 0;
+}
+
+const CSimulatedDevice::CTrack *CSimulatedDevice::GetTrack(unsigned long ulBlock) const
+{
+    const CTrack *pTrack = NULL;
+
+    std::vector<CTrack>::const_iterator itTrack;
+    for (itTrack = m_Tracks.begin(); itTrack != m_Tracks.end(); itTrack++)
+    {
+        if (itTrack->m_ulStartBlock > ulBlock)
+            break;
+
+        pTrack = &*itTrack;
+    }
+
+    return pTrack;
+}
+
+unsigned long CSimulatedDevice::GetTrackEnd(const CTrack &Track) const
+{
+    std::vector<CTrack>::const_iterator itTrack;
+    for (itTrack = m_Tracks.begin(); itTrack != m_Tracks.end(); itTrack++)
+    {
+        if (itTrack->m_ulStartBlock > Track.m_ulStartBlock)
+            return itTrack->m_ulStartBlock;
+    }
+
+    return m_ulBlockCount;
+}
+
+unsigned char CSimulatedDevice::CheckCondition(unsigned char ucKey,unsigned char ucAsc,
+                                               unsigned char ucAscq,unsigned long ulInformation,
+                                               bool bInformation)
+{
+    // Fixed format sense data.
+    memset(m_ucSense,0,sizeof(m_ucSense));
+    m_ucSense[ 0] = bInformation ? 0xF0 : 0x70;
+    m_ucSense[ 2] = ucKey;
+    WriteBigEndian32(m_ucSense + 3,ulInformation);
+    m_ucSense[ 7] = 10;
+    m_ucSense[12] = ucAsc;
+    m_ucSense[13] = ucAscq;
+
+    return SIMDEVICE_STAT_CHECK_CONDITION;
+}
+
+void CSimulatedDevice::Elapse(unsigned long ulMicroSeconds)
+{
+    m_uiElapsed += ulMicroSeconds;
+
+    if (m_bRealTime)
+    {
+        m_uiSleepDebt += ulMicroSeconds;
+        if (m_uiSleepDebt >= 1000)
+        {
+            ::Sleep((DWORD)(m_uiSleepDebt / 1000));
+            m_uiSleepDebt %= 1000;
+        }
+    }
+}
+
+/*
+    CSimulatedDevice::ReadBlock
+    ---------------------------
+    Reads a raw block from the image. Cooked images are completed with a sync
+    pattern and a mode 1 header, the EDC/ECC fields are left empty.
+*/
+bool CSimulatedDevice::ReadBlock(unsigned long ulBlock,unsigned char *pBuffer)
+{
+    memset(pBuffer,0,SIMDEVICE_RAW_BLOCKSIZE);
+
+    unsigned char *pTarget = pBuffer;
+    if (m_ulImageBlockSize == SIMDEVICE_DATA_BLOCKSIZE)
+    {
+        const CTrack *pTrack = GetTrack(ulBlock);
+        if (pTrack == NULL || !pTrack->m_bAudio)
+        {
+            memset(pBuffer + 1,0xFF,10);
+
+            unsigned long ulAddress = ulBlock + 150;
+            pBuffer[12] = static_cast<unsigned char>(ulAddress / (60 * 75));
+            pBuffer[13] = static_cast<unsigned char>((ulAddress / 75) % 60);
+            pBuffer[14] = static_cast<unsigned char>(ulAddress % 75);
+            pBuffer[15] = 0x01;
+
+            pTarget = pBuffer + 16;
+        }
+    }
+
+    if (m_ImageFile.seek((ckcore::tint64)ulBlock * m_ulImageBlockSize,
+                         ckcore::File::ckFILE_BEGIN) == -1)
+    {
+        return false;
+    }
+
+    return m_ImageFile.read(pTarget,m_ulImageBlockSize) == (ckcore::tint64)m_ulImageBlockSize;
+}
+
+unsigned char CSimulatedDevice::ReadCapacity(unsigned char *pData,unsigned long ulDataLen)
+{
+    unsigned char ucResponse[8];
+    WriteBigEndian32(ucResponse,m_bBlank || m_ulBlockCount == 0 ? 0 : m_ulBlockCount - 1);
+    WriteBigEndian32(ucResponse + 4,SIMDEVICE_DATA_BLOCKSIZE);
+
+    CopyResponse(pData,ulDataLen,ucResponse,sizeof(ucResponse));
+    return SIMDEVICE_STAT_GOOD;
+}
+
+unsigned char CSimulatedDevice::ReadToc(unsigned char *pCdb,unsigned char *pData,
+                                        unsigned long ulDataLen)
+{
+    if (m_bBlank)
+        return CheckCondition(SIMDEVICE_SENSEKEY_ILLEGAL_REQUEST,0x24,0x00);
+
+    std::vector<unsigned char> Response(4);
+
+    switch (pCdb[2] & 0x0F)
+    {
+        case 0x00:	// TOC.
+            {
+                Response[2] = m_Tracks.front().m_ucNumber;
+                Response[3] = m_Tracks.back().m_ucNumber;
+
+                for (size_t i = 0; i <= m_Tracks.size(); i++)
+                {
+                    bool bLeadOut = i == m_Tracks.size();
+
+                    unsigned char ucDesc[8];
+                    memset(ucDesc,0,sizeof(ucDesc));
+                    ucDesc[1] = bLeadOut || !m_Tracks[i].m_bAudio ? 0x14 : 0x10;
+                    ucDesc[2] = bLeadOut ? SIMDEVICE_LEADOUT_TRACK : m_Tracks[i].m_ucNumber;
+                    WriteBigEndian32(ucDesc + 4,bLeadOut ? m_ulBlockCount : m_Tracks[i].m_ulStartBlock);
+
+                    Response.insert(Response.end(),ucDesc,ucDesc + sizeof(ucDesc));
+                }
+            }
+            break;
+
+        case 0x01:	// Session information.
+            {
+                Response[2] = 1;
+                Response[3] = 1;
+
+                unsigned char ucDesc[8];
+                memset(ucDesc,0,sizeof(ucDesc));
+                ucDesc[1] = m_Tracks.front().m_bAudio ? 0x10 : 0x14;
+                ucDesc[2] = m_Tracks.front().m_ucNumber;
+                WriteBigEndian32(ucDesc + 4,m_Tracks.front().m_ulStartBlock);
+
+                Response.insert(Response.end(),ucDesc,ucDesc + sizeof(ucDesc));
+            }
+            break;
+
+        default:
+            return CheckCondition(SIMDEVICE_SENSEKEY_ILLEGAL_REQUEST,0x24,0x00);
+    }
+
+    unsigned short usDataLen = static_cast<unsigned short>(Response.size() - 2);
+    Response[0] = static_cast<unsigned char>(usDataLen >> 8);
+    Response[1] = static_cast<unsigned char>(usDataLen & 0xFF);
+
+    CopyResponse(pData,ulDataLen,&Response[0],(unsigned long)Response.size());
+    return SIMDEVICE_STAT_GOOD;
+}
+
+unsigned char CSimulatedDevice::ReadDiscInformation(unsigned char *pData,unsigned long ulDataLen)
+{
+    unsigned char ucResponse[34];
+    memset(ucResponse,0,sizeof(ucResponse));
+
+    ucResponse[1] = sizeof(ucResponse) - 2;
+    ucResponse[2] = m_bBlank ? 0x00 : 0x0E;		// Empty or complete disc and session.
+    ucResponse[3] = m_Tracks.front().m_ucNumber;
+    ucResponse[4] = 1;
+    ucResponse[5] = m_Tracks.front().m_ucNumber;
+    ucResponse[6] = m_Tracks.back().m_ucNumber;
+    WriteBigEndian32(ucResponse + 16,0xFFFFFFFF);
+    WriteBigEndian32(ucResponse + 20,0xFFFFFFFF);
+
+    CopyResponse(pData,ulDataLen,ucResponse,sizeof(ucResponse));
+    return SIMDEVICE_STAT_GOOD;
+}
+
+unsigned char CSimulatedDevice::ReadTrackInformation(unsigned char *pCdb,unsigned char *pData,
+                                                     unsigned long ulDataLen)
+{
+    unsigned long ulAddress = ReadBigEndian32(pCdb + 2);
+
+    const CTrack *pTrack = NULL;
+    switch (pCdb[1] & 0x03)
+    {
+        case 0x00:	// Logical block address.
+            if (ulAddress < m_ulBlockCount)
+                pTrack = GetTrack(ulAddress);
+            break;
+
+        case 0x01:	// Track number.
+            {
+                std::vector<CTrack>::const_iterator itTrack;
+                for (itTrack = m_Tracks.begin(); itTrack != m_Tracks.end(); itTrack++)
+                {
+                    if (itTrack->m_ucNumber == ulAddress)
+                        pTrack = &*itTrack;
+                }
+            }
+            break;
+
+        case 0x02:	// Session number.
+            if (ulAddress == 1)
+                pTrack = &m_Tracks.front();
+            break;
+    }
+
+    if (pTrack == NULL)
+        return CheckCondition(SIMDEVICE_SENSEKEY_ILLEGAL_REQUEST,0x24,0x00);
+
+    unsigned char ucResponse[48];
+    memset(ucResponse,0,sizeof(ucResponse));
+
+    ucResponse[1] = sizeof(ucResponse) - 2;
+    ucResponse[2] = pTrack->m_ucNumber;
+    ucResponse[3] = 1;
+    ucResponse[5] = pTrack->m_bAudio ? 0x00 : 0x04;
+    ucResponse[6] = pTrack->m_bAudio ? 0x0F : 0x01;
+    WriteBigEndian32(ucResponse +  8,pTrack->m_ulStartBlock);
+    WriteBigEndian32(ucResponse + 24,GetTrackEnd(*pTrack) - pTrack->m_ulStartBlock);
+    WriteBigEndian32(ucResponse + 28,GetTrackEnd(*pTrack) - 1);
+
+    CopyResponse(pData,ulDataLen,ucResponse,sizeof(ucResponse));
+    return SIMDEVICE_STAT_GOOD;
+}
+
+unsigned char CSimulatedDevice::GetConfiguration(unsigned char *pData,unsigned long ulDataLen)
+{
+    // Feature header only.
+    unsigned char ucResponse[8];
+    memset(ucResponse,0,sizeof(ucResponse));
+
+    ucResponse[3] = sizeof(ucResponse) - 4;
+    ucResponse[6] = static_cast<unsigned char>(m_usProfile >> 8);
+    ucResponse[7] = static_cast<unsigned char>(m_usProfile & 0xFF);
+
+    CopyResponse(pData,ulDataLen,ucResponse,sizeof(ucResponse));
+    return SIMDEVICE_STAT_GOOD;
+}
+
+/*
+    CSimulatedDevice::ReadCd
+    ------------------------
+    Returns the selected parts of the main channel followed by the C2 error
+    information and the sub-channel data of each block. Unreadable blocks
+    abort the command unless C2 error information is requested, in which
+    case they are returned as empty blocks with all C2 error bits set.
+*/
+unsigned char CSimulatedDevice::ReadCd(unsigned char *pCdb,unsigned char *pData,
+                                       unsigned long ulDataLen)
+{
+    if (m_bBlank)
+        return CheckCondition(SIMDEVICE_SENSEKEY_ILLEGAL_REQUEST,0x21,0x00);
+
+    unsigned long ulAddress = ReadBigEndian32(pCdb + 2);
+    unsigned long ulBlockCount = ((unsigned long)pCdb[6] << 16) | ((unsigned long)pCdb[7] << 8) | pCdb[8];
+
+    if (ulAddress + ulBlockCount > m_ulBlockCount)
+        return CheckCondition(SIMDEVICE_SENSEKEY_ILLEGAL_REQUEST,0x21,0x00);
+
+    unsigned char ucSectorType = (pCdb[1] >> 2) & 0x07;
+    unsigned char ucMainFlags = pCdb[9] & 0xF8;
+    unsigned char ucErrorFlags = pCdb[9] & 0x06;
+    unsigned char ucSubFlags = pCdb[10] & 0x07;
+
+    unsigned long ulC2Size = ucErrorFlags == 0x02 ? SIMDEVICE_C2_BITS :
+        ucErrorFlags == 0x04 ? SIMDEVICE_C2_BLOCKANDBITS : 0;
+    unsigned long ulSubSize = ucSubFlags == 0x02 ? 16 : ucSubFlags != 0 ? 96 : 0;
+
+    unsigned char ucRaw[SIMDEVICE_RAW_BLOCKSIZE];
+    unsigned char *pTarget = pData;
+
+    for (unsigned long i = 0; i < ulBlockCount; i++)
+    {
+        unsigned long ulBlock = ulAddress + i;
+        const CTrack *pTrack = GetTrack(ulBlock);
+        bool bAudio = pTrack != NULL && pTrack->m_bAudio;
+
+        // Only CD-DA and mode 1 sectors are simulated.
+        if ((ucSectorType == 1 && !bAudio) || (ucSectorType > 1 && bAudio))
+            return CheckCondition(SIMDEVICE_SENSEKEY_ILLEGAL_REQUEST,0x64,0x00,ulBlock,true);
+
+        // Select the requested parts of the main channel.
+        unsigned long ulMainOffset = 0,ulMainSize = 0;
+        if (bAudio)
+        {
+            ulMainSize = ucMainFlags != 0 ? SIMDEVICE_RAW_BLOCKSIZE : 0;
+        }
+        else
+        {
+            ulMainOffset = ucMainFlags & 0x80 ? 0 : ucMainFlags & 0x60 ? 12 : 16;
+            unsigned long ulMainEnd = ucMainFlags & 0x08 ? SIMDEVICE_RAW_BLOCKSIZE :
+                ucMainFlags & 0x10 ? 16 + SIMDEVICE_DATA_BLOCKSIZE :
+                ucMainFlags & 0x60 ? 16 : ucMainFlags & 0x80 ? 12 : ulMainOffset;
+            ulMainSize = ulMainEnd - ulMainOffset;
+        }
+
+        unsigned long ulFrameSize = ulMainSize + ulC2Size + ulSubSize;
+        if (pTarget == NULL || (unsigned long)(pTarget - pData) + ulFrameSize > ulDataLen)
+            return CheckCondition(SIMDEVICE_SENSEKEY_ILLEGAL_REQUEST,0x24,0x00);
+
+        bool bBadBlock = m_BadBlocks.find(ulBlock) != m_BadBlocks.end();
+        if (bBadBlock)
+        {
+            Elapse(m_ulBadBlockLatency);
+
+            if (ulC2Size == 0)
+                return CheckCondition(SIMDEVICE_SENSEKEY_MEDIUM_ERROR,0x11,0x00,ulBlock,true);
+
+            memset(ucRaw,0,sizeof(ucRaw));
+        }
+        else if (!ReadBlock(ulBlock,ucRaw))
+        {
+            return CheckCondition(SIMDEVICE_SENSEKEY_MEDIUM_ERROR,0x11,0x00,ulBlock,true);
+        }
+
+        memcpy(pTarget,ucRaw + ulMainOffset,ulMainSize);
+        pTarget += ulMainSize;
+
+        if (ulC2Size > 0)
+        {
+            memset(pTarget,bBadBlock ? 0xFF : 0x00,ulC2Size);
+            if (ulC2Size == SIMDEVICE_C2_BLOCKANDBITS)
+                pTarget[1] = 0;		// Padding after the block error byte.
+
+            pTarget += ulC2Size;
+        }
+
+        if (ulSubSize > 0)
+        {
+            memset(pTarget,0,ulSubSize);
+            if (ulSubSize == 16 && pTrack != NULL)
+            {
+                // Formatted Q sub-channel, mode 1 position.
+                unsigned long ulRelative = ulBlock - pTrack->m_ulStartBlock;
+                unsigned long ulAbsolute = ulBlock + 150;
+
+                pTarget[0] = bAudio ? 0x01 : 0x41;
+                pTarget[1] = pTrack->m_ucNumber;
+                pTarget[2] = 1;
+                pTarget[3] = static_cast<unsigned char>(ulRelative / (60 * 75));
+                pTarget[4] = static_cast<unsigned char>((ulRelative / 75) % 60);
+                pTarget[5] = static_cast<unsigned char>(ulRelative % 75);
+                pTarget[7] = static_cast<unsigned char>(ulAbsolute / (60 * 75));
+                pTarget[8] = static_cast<unsigned char>((ulAbsolute / 75) % 60);
+                pTarget[9] = static_cast<unsigned char>(ulAbsolute % 75);
+            }
+
+            pTarget += ulSubSize;
+        }
+
+        m_ulBlocksRead++;
+        Elapse(m_ulBlockLatency);
+    }
+
+    return SIMDEVICE_STAT_GOOD;
+}
+
+unsigned char CSimulatedDevice::Read10(unsigned char *pCdb,unsigned char *pData,
+                                       unsigned long ulDataLen)
+{
+    if (m_bBlank)
+        return CheckCondition(SIMDEVICE_SENSEKEY_ILLEGAL_REQUEST,0x21,0x00);
+
+    unsigned long ulAddress = ReadBigEndian32(pCdb + 2);
+    unsigned long ulBlockCount = ((unsigned long)pCdb[7] << 8) | pCdb[8];
+
+    if (ulAddress + ulBlockCount > m_ulBlockCount)
+        return CheckCondition(SIMDEVICE_SENSEKEY_ILLEGAL_REQUEST,0x21,0x00);
+
+    if (pData == NULL || ulBlockCount * SIMDEVICE_DATA_BLOCKSIZE > ulDataLen)
+        return CheckCondition(SIMDEVICE_SENSEKEY_ILLEGAL_REQUEST,0x24,0x00);
+
+    unsigned char ucRaw[SIMDEVICE_RAW_BLOCKSIZE];
+    for (unsigned long i = 0; i < ulBlockCount; i++)
+    {
+        unsigned long ulBlock = ulAddress + i;
+
+        const CTrack *pTrack = GetTrack(ulBlock);
+        if (pTrack != NULL && pTrack->m_bAudio)
+            return CheckCondition(SIMDEVICE_SENSEKEY_ILLEGAL_REQUEST,0x64,0x00,ulBlock,true);
+
+        if (m_BadBlocks.find(ulBlock) != m_BadBlocks.end())
+        {
+            Elapse(m_ulBadBlockLatency);
+            return CheckCondition(SIMDEVICE_SENSEKEY_MEDIUM_ERROR,0x11,0x00,ulBlock,true);
+        }
+
+        if (!ReadBlock(ulBlock,ucRaw))
+            return CheckCondition(SIMDEVICE_SENSEKEY_MEDIUM_ERROR,0x11,0x00,ulBlock,true);
+
+        memcpy(pData + i * SIMDEVICE_DATA_BLOCKSIZE,ucRaw + 16,SIMDEVICE_DATA_BLOCKSIZE);
+
+        m_ulBlocksRead++;
+        Elapse(m_ulBlockLatency);
+    }
+
+    return SIMDEVICE_STAT_GOOD;
+}
+
+/**
+    Executes a command.
+    @return true if the command completed with a good status, false otherwise.
+*/
+bool CSimulatedDevice::Transport(unsigned char *pCdb,unsigned char ucCdbLen,
+                                 unsigned char *pData,unsigned long ulDataLen)
+{
+    unsigned char ucSense[SIMDEVICE_SENSESIZE];
+    unsigned char ucResult = SIMDEVICE_STAT_GOOD;
+
+    if (!TransportWithSense(pCdb,ucCdbLen,pData,ulDataLen,ucSense,ucResult))
+        return false;
+
+    return ucResult == SIMDEVICE_STAT_GOOD;
+}
+
+/**
+    Executes a command and returns the status and sense data.
+    @param pSense buffer receiving the sense data, it must be at least
+    SIMDEVICE_SENSESIZE bytes long.
+    @return false if the command could not be delivered, true otherwise.
+*/
+bool CSimulatedDevice::TransportWithSense(unsigned char *pCdb,unsigned char ucCdbLen,
+                                          unsigned char *pData,unsigned long ulDataLen,
+                                          unsigned char *pSense,unsigned char &ucResult)
+{
+    if (pCdb == NULL || ucCdbLen == 0)
+        return false;
+
+    // Transfers larger than the transport allows fail before reaching the
+    // device.
+    if (m_ulMaxTransferLength != 0 && ulDataLen > m_ulMaxTransferLength)
+        return false;
+
+    m_ulCommandCount++;
+    Elapse(m_ulCommandLatency);
+
+    // Returns the sense data of the previous command.
+    if (pCdb[0] == SIMDEVICE_REQUEST_SENSE)
+    {
+        CopyResponse(pData,ulDataLen,m_ucSense,18);
+
+        memset(m_ucSense,0,sizeof(m_ucSense));
+        memset(pSense,0,SIMDEVICE_SENSESIZE);
+
+        ucResult = SIMDEVICE_STAT_GOOD;
+        return true;
+    }
+
+    memset(m_ucSense,0,sizeof(m_ucSense));
+
+    switch (pCdb[0])
+    {
+        case SIMDEVICE_TEST_UNIT_READY:
+        case SIMDEVICE_START_STOP_UNIT:
+        case SIMDEVICE_PREVENTALLOW_REMOVAL:
+        case SIMDEVICE_SYNCHRONIZE_CACHE:
+        case SIMDEVICE_MODE_SELECT10:
+        case SIMDEVICE_CLOSE_TRACK_SESSION:
+        case SIMDEVICE_SET_CD_SPEED:
+            ucResult = SIMDEVICE_STAT_GOOD;
+            break;
+
+        case SIMDEVICE_BLANK:
+        case SIMDEVICE_FORMAT_UNIT:
+            m_bBlank = true;
+            ucResult = SIMDEVICE_STAT_GOOD;
+            break;
+
+        case SIMDEVICE_READ_CAPACITY:
+            ucResult = ReadCapacity(pData,ulDataLen);
+            break;
+
+        case SIMDEVICE_READ10:
+            ucResult = Read10(pCdb,pData,ulDataLen);
+            break;
+
+        case SIMDEVICE_READ_TOC_PMA_ATIP:
+            ucResult = ReadToc(pCdb,pData,ulDataLen);
+            break;
+
+        case SIMDEVICE_GET_CONFIGURATION:
+            ucResult = GetConfiguration(pData,ulDataLen);
+            break;
+
+        case SIMDEVICE_GET_EVENT_STATUS:
+            {
+                // No event available.
+                unsigned char ucResponse[4] = { 0x00,0x02,0x80,0x00 };
+                CopyResponse(pData,ulDataLen,ucResponse,sizeof(ucResponse));
+                ucResult = SIMDEVICE_STAT_GOOD;
+            }
+            break;
+
+        case SIMDEVICE_READ_DISC_INFORMATION:
+            ucResult = ReadDiscInformation(pData,ulDataLen);
+            break;
+
+        case SIMDEVICE_READ_TRACK_INFORMATION:
+            ucResult = ReadTrackInformation(pCdb,pData,ulDataLen);
+            break;
+
+        case SIMDEVICE_READ_CD:
+            ucResult = ReadCd(pCdb,pData,ulDataLen);
+            break;
+
+        default:
+            ucResult = CheckCondition(SIMDEVICE_SENSEKEY_ILLEGAL_REQUEST,0x20,0x00);
+            break;
+    }
+
+    memcpy(pSense,m_ucSense,SIMDEVICE_SENSESIZE);
+    return true;
+}
@@ -0,0 +1,123 @@
+/*
+ * InfraRecorder - CD/DVD burning software
+ * Copyright (C) 2006-2012 Christian Kindahl
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#include <vector>
+#include <set>
+#include <ckcore/types.hh>
+#include <ckcore/file.hh>
+
+#define SIMDEVICE_SENSESIZE					24
+#define SIMDEVICE_PROFILE_CDROM				0x0008
+
+// An MMC device simulated on top of a disc image file and a TOC description.
+// The device answers MMC commands through the same transport contract as
+// ckmmc::Device, the core reaches it through CCore2Transport so that reading,
+// scanning and recovery can be tested and profiled without a physical drive.
+// Command latency, the maximum transfer length and unreadable sectors can be
+// configured. Only a single session is supported and the image is never
+// written to, BLANK and FORMAT UNIT only mark the disc as blank.
+class CSimulatedDevice
+{
+private:
+    class CTrack
+    {
+    public:
+        unsigned char m_ucNumber;
+        unsigned long m_ulStartBlock;
+        bool m_bAudio;
+
+        CTrack(unsigned char ucNumber,unsigned long ulStartBlock,bool bAudio) :
+            m_ucNumber(ucNumber),m_ulStartBlock(ulStartBlock),m_bAudio(bAudio)
+        {
+        }
+    };
+
+    ckcore::File m_ImageFile;
+    unsigned long m_ulImageBlockSize;
+    unsigned long m_ulBlockCount;
+    unsigned short m_usProfile;
+    bool m_bBlank;
+
+    std::vector<CTrack> m_Tracks;
+    std::set<unsigned long> m_BadBlocks;
+
+    // Latency in microseconds.
+    unsigned long m_ulCommandLatency;
+    unsigned long m_ulBlockLatency;
+    unsigned long m_ulBadBlockLatency;
+    unsigned long m_ulMaxTransferLength;
+    bool m_bRealTime;
+
+    // Statistics.
+    unsigned long m_ulCommandCount;
+    unsigned long m_ulBlocksRead;
+    unsigned __int64 m_uiElapsed;
+    unsigned __int64 m_uiSleepDebt;
+
+    unsigned char m_ucSense[SIMDEVICE_SENSESIZE];
+
+    const CTrack *GetTrack(unsigned long ulBlock) const;
+    unsigned long GetTrackEnd(const CTrack &Track) const;
+
+    unsigned char CheckCondition(unsigned char ucKey,unsigned char ucAsc,unsigned char ucAscq,
+        unsigned long ulInformation = 0,bool bInformation = false);
+    void Elapse(unsigned long ulMicroSeconds);
+
+    bool ReadBlock(unsigned long ulBlock,unsigned char *pBuffer);
+
+    unsigned char ReadCapacity(unsigned char *pData,unsigned long ulDataLen);
+    unsigned char ReadToc(unsigned char *pCdb,unsigned char *pData,unsigned long ulDataLen);
+    unsigned char ReadDiscInformation(unsigned char *pData,unsigned long ulDataLen);
+    unsigned char ReadTrackInformation(unsigned char *pCdb,unsigned char *pData,
+        unsigned long ulDataLen);
+    unsigned char GetConfiguration(unsigned char *pData,unsigned long ulDataLen);
+    unsigned char ReadCd(unsigned char *pCdb,unsigned char *pData,unsigned long ulDataLen);
+    unsigned char Read10(unsigned char *pCdb,unsigned char *pData,unsigned long ulDataLen);
+
+public:
+    CSimulatedDevice(const ckcore::tchar *szImagePath,unsigned long ulImageBlockSize = 2048);
+    ~CSimulatedDevice();
+
+    bool Open();
+    void Close();
+
+    // TOC description, the first track covers the whole image if no tracks
+    // are added.
+    void AddTrack(unsigned char ucNumber,unsigned long ulStartBlock,bool bAudio);
+    void SetProfile(unsigned short usProfile);
+
+    void SetLatency(unsigned long ulCommandLatency,unsigned long ulBlockLatency,
+        unsigned long ulBadBlockLatency);
+    void SetMaxTransferLength(unsigned long ulMaxTransferLength);
+    void SetRealTime(bool bRealTime);
+    void AddBadBlock(unsigned long ulBlock);
+
+    unsigned long GetBlockCount() const;
+    unsigned long GetCommandCount() const;
+    unsigned long GetBlocksRead() const;
+    unsigned __int64 GetElapsedTime() const;
+    void ResetStatistics();
+
+    // Same contract as ckmmc::Device::transport and transport_with_sense.
+    bool Transport(unsigned char *pCdb,unsigned char ucCdbLen,
+        unsigned char *pData,unsigned long ulDataLen);
+    bool TransportWithSense(unsigned char *pCdb,unsigned char ucCdbLen,
+        unsigned char *pData,unsigned long ulDataLen,
+        unsigned char *pSense,unsigned char &ucResult);
+};
@@ -0,0 +1,252 @@
+/*
+ * InfraRecorder - CD/DVD burning software
+ * Copyright (C) 2006-2012 Christian Kindahl
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "space_layout.hh"
+
+static const ckfilesystem::Iso::InterchangeLevel g_InterchangeLevels[SPACELAYOUT_ISOLEVEL_COUNT] =
+{
+    ckfilesystem::Iso::LEVEL_1,
+    ckfilesystem::Iso::LEVEL_2,
+    ckfilesystem::Iso::LEVEL_3,
+    ckfilesystem::Iso::ISO9660_1999
+};
+
+/*
+    Returns the number of sectors occupied by the ISO9660 or Joliet directory
+    extents of uiDirCount directories holding uiRecordCount records of uiBytes
+    bytes in total. Each directory starts in a new sector and since records
+    may not cross sector boundaries each sector is assumed to leave room for
+    an average record unused.
+*/
+static ckcore::tuint64 GetDirSectors(ckcore::tuint64 uiDirCount,ckcore::tuint64 uiRecordCount,
+                                     ckcore::tuint64 uiBytes)
+{
+    ckcore::tuint64 uiAvgRecordSize = uiBytes / uiRecordCount;
+    return uiDirCount + uiBytes / (IMAGESIZE_SECTOR_SIZE - uiAvgRecordSize);
+}
+
+CSpaceLayout::CSpaceLayout()
+{
+    Reset();
+}
+
+void CSpaceLayout::Update(const ckcore::tstring &Name,bool bDirectory,bool bRemove)
+{
+    // ISO9660, names are truncated to the limits of the interchange level.
+    for (unsigned int i = 0; i < SPACELAYOUT_ISOLEVEL_COUNT; i++)
+    {
+        for (unsigned int j = 0; j < SPACELAYOUT_VERSION_COUNT; j++)
+        {
+            unsigned int uiLen = CImageSizeEstimator::GetIdentifierLength(Name,bDirectory,false,
+                g_InterchangeLevels[i],false,j == 1);
+            unsigned int uiRecord = CImageSizeEstimator::GetDirRecordSize(uiLen);
+
+            if (bRemove)
+                m_uiIsoRecordBytes[i][j] -= uiRecord;
+            else
+                m_uiIsoRecordBytes[i][j] += uiRecord;
+        }
+
+        if (bDirectory)
+        {
+            unsigned int uiLen = CImageSizeEstimator::GetIdentifierLength(Name,true,false,
+                g_InterchangeLevels[i],false,false);
+            unsigned int uiPath = CImageSizeEstimator::GetPathTableRecordSize(uiLen);
+
+            if (bRemove)
+                m_uiIsoPathBytes[i] -= uiPath;
+            else
+                m_uiIsoPathBytes[i] += uiPath;
+        }
+    }
+
+    // Joliet, names are stored in UCS-2.
+    for (unsigned int i = 0; i < SPACELAYOUT_JOLIET_COUNT; i++)
+    {
+        for (unsigned int j = 0; j < SPACELAYOUT_VERSION_COUNT; j++)
+        {
+            unsigned int uiLen = CImageSizeEstimator::GetIdentifierLength(Name,bDirectory,true,
+                ckfilesystem::Iso::LEVEL_1,i == 1,j == 1);
+            unsigned int uiRecord = CImageSizeEstimator::GetDirRecordSize(uiLen);
+
+            if (bRemove)
+                m_uiJolietRecordBytes[i][j] -= uiRecord;
+            else
+                m_uiJolietRecordBytes[i][j] += uiRecord;
+        }
+
+        if (bDirectory)
+        {
+            unsigned int uiLen = CImageSizeEstimator::GetIdentifierLength(Name,true,true,
+                ckfilesystem::Iso::LEVEL_1,i == 1,false);
+            unsigned int uiPath = CImageSizeEstimator::GetPathTableRecordSize(uiLen);
+
+            if (bRemove)
+                m_uiJolietPathBytes[i] -= uiPath;
+            else
+                m_uiJolietPathBytes[i] += uiPath;
+        }
+    }
+
+    // UDF.
+    unsigned int uiIdent = CImageSizeEstimator::GetUdfIdentDescSize(Name);
+    if (bRemove)
+        m_uiUdfIdentBytes -= uiIdent;
+    else
+        m_uiUdfIdentBytes += uiIdent;
+}
+
+/**
+    Removes all files and folders from the layout.
+*/
+void CSpaceLayout::Reset()
+{
+    m_uiFileCount = 0;
+    m_uiDirCount = 0;
+    m_uiDataSectors = 0;
+
+    for (unsigned int i = 0; i < SPACELAYOUT_ISOLEVEL_COUNT; i++)
+    {
+        for (unsigned int j = 0; j < SPACELAYOUT_VERSION_COUNT; j++)
+            m_uiIsoRecordBytes[i][j] = 0;
+
+        m_uiIsoPathBytes[i] = 0;
+    }
+
+    for (unsigned int i = 0; i < SPACELAYOUT_JOLIET_COUNT; i++)
+    {
+        for (unsigned int j = 0; j < SPACELAYOUT_VERSION_COUNT; j++)
+            m_uiJolietRecordBytes[i][j] = 0;
+
+        m_uiJolietPathBytes[i] = 0;
+    }
+
+    m_uiUdfIdentBytes = 0;
+}
+
+/**
+    Adds a file to the layout.
+    @param szFileName the file name in the disc image.
+    @param uiSize the file size in bytes.
+    @param bImported true if the file has been imported from a previous
+    session, its data is then not part of the new image.
+*/
+void CSpaceLayout::AddFile(const ckcore::tchar *szFileName,ckcore::tuint64 uiSize,bool bImported)
+{
+    m_uiFileCount++;
+    if (!bImported)
+        m_uiDataSectors += CImageSizeEstimator::BytesToSectors(uiSize);
+
+    Update(szFileName,false,false);
+}
+
+/**
+    Removes a file previously added using AddFile from the layout.
+*/
+void CSpaceLayout::RemoveFile(const ckcore::tchar *szFileName,ckcore::tuint64 uiSize,bool bImported)
+{
+    m_uiFileCount--;
+    if (!bImported)
+        m_uiDataSectors -= CImageSizeEstimator::BytesToSectors(uiSize);
+
+    Update(szFileName,false,true);
+}
+
+/**
+    Adds a folder (not including its contents) to the layout.
+    @param szFolderName the folder name in the disc image.
+*/
+void CSpaceLayout::AddFolder(const ckcore::tchar *szFolderName)
+{
+    m_uiDirCount++;
+
+    Update(szFolderName,true,false);
+}
+
+/**
+    Removes a folder previously added using AddFolder from the layout.
+*/
+void CSpaceLayout::RemoveFolder(const ckcore::tchar *szFolderName)
+{
+    m_uiDirCount--;
+
+    Update(szFolderName,true,true);
+}
+
+bool CSpaceLayout::IsEmpty() const
+{
+    return m_uiFileCount == 0 && m_uiDirCount == 0;
+}
+
+/**
+    Returns the size in bytes of the file data, excluding imported files.
+*/
+ckcore::tuint64 CSpaceLayout::GetDataSize() const
+{
+    return m_uiDataSectors * IMAGESIZE_SECTOR_SIZE;
+}
+
+/**
+    Calculates the size of the disc image.
+    @param Estimator the estimator configured with the file system settings
+    of the project, it provides the size of the volume structures.
+    @param uiImageSize reference to the variable receiving the image size in
+    bytes.
+    @return true if the size could be calculated, false otherwise.
+*/
+bool CSpaceLayout::GetImageSize(const CImageSizeEstimator &Estimator,
+                                ckcore::tuint64 &uiImageSize) const
+{
+    if (IsEmpty())
+    {
+        uiImageSize = 0;
+        return true;
+    }
+
+    unsigned int uiLevel = 0;
+    while (uiLevel < SPACELAYOUT_ISOLEVEL_COUNT - 1 &&
+           g_InterchangeLevels[uiLevel] != Estimator.GetInterchangeLevel())
+    {
+        uiLevel++;
+    }
+
+    unsigned int uiJoliet = Estimator.GetLongJolietNames() ? 1 : 0;
+    unsigned int uiVersion = Estimator.GetIncludeFileVerInfo() ? 1 : 0;
+
+    // The "." and ".." records of all directories including the root.
+    ckcore::tuint64 uiDirCount = m_uiDirCount + 1;
+    ckcore::tuint64 uiDotBytes = uiDirCount * 2 * CImageSizeEstimator::GetDirRecordSize(1);
+    ckcore::tuint64 uiRecordCount = m_uiFileCount + m_uiDirCount + uiDirCount * 2;
+
+    CImageLayout Layout;
+    Layout.m_uiFileCount = m_uiFileCount;
+    Layout.m_uiDirCount = uiDirCount;
+    Layout.m_uiIsoPathTableSize = m_uiIsoPathBytes[uiLevel];
+    Layout.m_uiIsoDirSectors = GetDirSectors(uiDirCount,uiRecordCount,
+        m_uiIsoRecordBytes[uiLevel][uiVersion] + uiDotBytes);
+    Layout.m_uiJolietPathTableSize = m_uiJolietPathBytes[uiJoliet];
+    Layout.m_uiJolietDirSectors = GetDirSectors(uiDirCount,uiRecordCount,
+        m_uiJolietRecordBytes[uiJoliet][uiVersion] + uiDotBytes);
+
+    // UDF file identifier descriptors may cross sector boundaries.
+    Layout.m_uiUdfDirSectors = uiDirCount + (m_uiUdfIdentBytes +
+        uiDirCount * CImageSizeEstimator::GetUdfIdentDescSize(ckT(""))) / IMAGESIZE_SECTOR_SIZE;
+    Layout.m_uiFileDataSectors = m_uiDataSectors;
+
+    return Estimator.CalcImageSize(Layout,uiImageSize);
+}
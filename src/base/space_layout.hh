@@ -0,0 +1,65 @@
+/*
+ * InfraRecorder - CD/DVD burning software
+ * Copyright (C) 2006-2012 Christian Kindahl
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#include <ckcore/types.hh>
+#include "image_size_estimator.hh"
+
+#define SPACELAYOUT_ISOLEVEL_COUNT			4		// Level 1, 2, 3 and ISO9660:1999.
+#define SPACELAYOUT_JOLIET_COUNT			2		// Normal and long file names.
+#define SPACELAYOUT_VERSION_COUNT			2		// With and without file version suffixes.
+
+// Keeps running totals of the space occupied by the files and folders of a
+// data project in the disc image. The totals are kept for all file system
+// variants so that adding or removing an item, as well as changing the
+// file system settings, never requires the project tree to be traversed.
+// Record and identifier sizes as well as the volume structures are given by
+// CImageSizeEstimator. Since the items are not grouped by directory the
+// number of sectors occupied by the directory extents is approximated.
+class CSpaceLayout
+{
+private:
+    ckcore::tuint64 m_uiFileCount;
+    ckcore::tuint64 m_uiDirCount;
+    ckcore::tuint64 m_uiDataSectors;
+
+    // Directory record and path table bytes, excluding the "." and ".."
+    // records and the root directory.
+    ckcore::tuint64 m_uiIsoRecordBytes[SPACELAYOUT_ISOLEVEL_COUNT][SPACELAYOUT_VERSION_COUNT];
+    ckcore::tuint64 m_uiIsoPathBytes[SPACELAYOUT_ISOLEVEL_COUNT];
+    ckcore::tuint64 m_uiJolietRecordBytes[SPACELAYOUT_JOLIET_COUNT][SPACELAYOUT_VERSION_COUNT];
+    ckcore::tuint64 m_uiJolietPathBytes[SPACELAYOUT_JOLIET_COUNT];
+
+    // UDF file identifier descriptor bytes, excluding the parent entries.
+    ckcore::tuint64 m_uiUdfIdentBytes;
+
+    void Update(const ckcore::tstring &Name,bool bDirectory,bool bRemove);
+
+public:
+    CSpaceLayout();
+
+    void Reset();
+    void AddFile(const ckcore::tchar *szFileName,ckcore::tuint64 uiSize,bool bImported);
+    void RemoveFile(const ckcore::tchar *szFileName,ckcore::tuint64 uiSize,bool bImported);
+    void AddFolder(const ckcore::tchar *szFolderName);
+    void RemoveFolder(const ckcore::tchar *szFolderName);
+
+    bool IsEmpty() const;
+    ckcore::tuint64 GetDataSize() const;
+    bool GetImageSize(const CImageSizeEstimator &Estimator,ckcore::tuint64 &uiImageSize) const;
+};
@@ -19,6 +19,7 @@
 #include "stdafx.hh"
 #include <vfw.h>
 #include <base/codec_const.hh>
+#include "wave_reader.hh"
 #include "wave_writer.hh"
 
 #pragma comment(lib,"vfw32.lib")
@@ -38,6 +39,7 @@ TCHAR *g_szFileExt = _T(".wav");
 PAVIFILE g_pAVIFile = NULL;
 PAVISTREAM g_pAVIStream = NULL;
 long g_lCurSample = 0;
+CWaveReader g_WaveReader;
 CWaveWriter g_WaveWriter;
 
 BOOL APIENTRY DllMain(HANDLE hModule,DWORD ul_reason_for_call,LPVOID lpReserved)
@@ -101,6 +103,16 @@ bool WINAPI irc_set_callback(tirc_send_message *pSendMessage)
 bool WINAPI irc_decode_init(const TCHAR *szFileName,int &iNumChannels,
                             int &iSampleRate,int &iBitRate,unsigned __int64 &uiDuration)
 {
+    // Plain PCM files are read directly from a memory mapping of the file.
+    if (g_WaveReader.Open(szFileName))
+    {
+        iNumChannels = g_WaveReader.GetNumChannels();
+        iSampleRate = g_WaveReader.GetSampleRate();
+        iBitRate = iSampleRate * g_WaveReader.GetBitsPerSample();
+        uiDuration = g_WaveReader.GetDuration();
+        return true;
+    }
+
     // Open the file.
     HRESULT hResult = AVIFileOpen(&g_pAVIFile,szFileName,OF_SHARE_DENY_NONE,NULL);
     if (FAILED(hResult))
@@ -151,6 +163,13 @@ bool WINAPI irc_decode_init(const TCHAR *szFileName,int &iNumChannels,
 __int64 WINAPI irc_decode_process(unsigned char *pBuffer,__int64 iBufferSize,
                                   unsigned __int64 &uiTime)
 {
+    if (g_WaveReader.IsOpen())
+    {
+        __int64 iProcessed = g_WaveReader.Read(pBuffer,iBufferSize);
+        uiTime = g_WaveReader.GetTime();
+        return iProcessed;
+    }
+
     if (iBufferSize > 0x7FFFFFFF)
         return -1;
 
@@ -169,6 +188,9 @@ __int64 WINAPI irc_decode_process(unsigned char *pBuffer,__int64 iBufferSize,
 
 bool WINAPI irc_decode_exit()
 {
+    if (g_WaveReader.IsOpen())
+        return g_WaveReader.Close();
+
     HRESULT hResult = AVIStreamRelease(g_pAVIStream);
     if (FAILED(hResult))
         return false;
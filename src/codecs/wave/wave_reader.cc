@@ -0,0 +1,360 @@
+/*
+ * InfraRecorder - CD/DVD burning software
+ * Copyright (C) 2006-2012 Christian Kindahl
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "stdafx.hh"
+#include <mmreg.h>
+#include "wave_reader.hh"
+
+#define WAVEREADER_FOURCC(a,b,c,d)			((unsigned long)(a) | ((unsigned long)(b) << 8) |\
+                                             ((unsigned long)(c) << 16) | ((unsigned long)(d) << 24))
+
+#define WAVEREADER_ID_RIFF					WAVEREADER_FOURCC('R','I','F','F')
+#define WAVEREADER_ID_RF64					WAVEREADER_FOURCC('R','F','6','4')
+#define WAVEREADER_ID_WAVE					WAVEREADER_FOURCC('W','A','V','E')
+#define WAVEREADER_ID_DS64					WAVEREADER_FOURCC('d','s','6','4')
+#define WAVEREADER_ID_FMT					WAVEREADER_FOURCC('f','m','t',' ')
+#define WAVEREADER_ID_DATA					WAVEREADER_FOURCC('d','a','t','a')
+
+static unsigned short ReadLE16(const unsigned char *pBuffer)
+{
+    return (unsigned short)pBuffer[0] | ((unsigned short)pBuffer[1] << 8);
+}
+
+static unsigned long ReadLE32(const unsigned char *pBuffer)
+{
+    return (unsigned long)pBuffer[0] | ((unsigned long)pBuffer[1] << 8) |
+        ((unsigned long)pBuffer[2] << 16) | ((unsigned long)pBuffer[3] << 24);
+}
+
+static unsigned __int64 ReadLE64(const unsigned char *pBuffer)
+{
+    return (unsigned __int64)ReadLE32(pBuffer) |
+        ((unsigned __int64)ReadLE32(pBuffer + 4) << 32);
+}
+
+CWaveReader::CWaveReader() : m_hFile(INVALID_HANDLE_VALUE),m_hMapping(NULL),
+    m_pView(NULL)
+{
+    m_uiViewOffset = 0;
+    m_ulViewSize = 0;
+
+    m_uiFileSize = 0;
+    m_uiDataOffset = 0;
+    m_uiDataSize = 0;
+    m_uiDataPos = 0;
+
+    m_iNumChannels = 0;
+    m_iSampleRate = 0;
+    m_iBitsPerSample = 0;
+    m_iBlockAlign = 0;
+}
+
+CWaveReader::~CWaveReader()
+{
+    if (IsOpen())
+        Close();
+}
+
+bool CWaveReader::ReadAt(unsigned __int64 uiOffset,void *pBuffer,unsigned long ulSize)
+{
+    LARGE_INTEGER liOffset;
+    liOffset.QuadPart = uiOffset;
+
+    if (!SetFilePointerEx(m_hFile,liOffset,NULL,FILE_BEGIN))
+        return false;
+
+    unsigned long ulRead = 0;
+    if (!ReadFile(m_hFile,pBuffer,ulSize,&ulRead,NULL))
+        return false;
+
+    return ulRead == ulSize;
+}
+
+bool CWaveReader::ParseFormat(unsigned __int64 uiOffset,unsigned long ulSize)
+{
+    // We need at least the 16 byte PCMWAVEFORMAT structure.
+    unsigned char ucFormat[40];
+    if (ulSize < 16)
+        return false;
+
+    unsigned long ulReadSize = ulSize < sizeof(ucFormat) ? ulSize : sizeof(ucFormat);
+    if (!ReadAt(uiOffset,ucFormat,ulReadSize))
+        return false;
+
+    unsigned short usFormatTag = ReadLE16(ucFormat + 0);
+    if (usFormatTag == WAVE_FORMAT_EXTENSIBLE)
+    {
+        // The sub-format GUID starts at offset 24, only PCM is accepted.
+        if (ulReadSize < 40)
+            return false;
+
+        usFormatTag = ReadLE16(ucFormat + 24);
+    }
+
+    if (usFormatTag != WAVE_FORMAT_PCM)
+        return false;
+
+    m_iNumChannels = ReadLE16(ucFormat + 2);
+    m_iSampleRate = (int)ReadLE32(ucFormat + 4);
+    m_iBlockAlign = ReadLE16(ucFormat + 12);
+    m_iBitsPerSample = ReadLE16(ucFormat + 14);
+
+    return m_iNumChannels > 0 && m_iSampleRate > 0 && m_iBlockAlign > 0 &&
+        m_iBitsPerSample > 0;
+}
+
+bool CWaveReader::ParseHeader()
+{
+    unsigned char ucHeader[12];
+    if (!ReadAt(0,ucHeader,sizeof(ucHeader)))
+        return false;
+
+    unsigned long ulRiffId = ReadLE32(ucHeader);
+    if (ulRiffId != WAVEREADER_ID_RIFF && ulRiffId != WAVEREADER_ID_RF64)
+        return false;
+
+    if (ReadLE32(ucHeader + 8) != WAVEREADER_ID_WAVE)
+        return false;
+
+    bool bRF64 = ulRiffId == WAVEREADER_ID_RF64;
+    bool bHasFormat = false;
+    unsigned __int64 uiDs64DataSize = 0;
+
+    // Walk the chunk list until the data chunk has been found.
+    unsigned __int64 uiPos = sizeof(ucHeader);
+    while (uiPos + 8 <= m_uiFileSize)
+    {
+        unsigned char ucChunk[8];
+        if (!ReadAt(uiPos,ucChunk,sizeof(ucChunk)))
+            return false;
+
+        unsigned long ulChunkId = ReadLE32(ucChunk);
+        unsigned long ulChunkSize = ReadLE32(ucChunk + 4);
+
+        switch (ulChunkId)
+        {
+            case WAVEREADER_ID_DS64:
+                {
+                    // RIFF size (8 bytes) followed by the data size (8 bytes).
+                    unsigned char ucDs64[16];
+                    if (!bRF64 || ulChunkSize < sizeof(ucDs64) ||
+                        !ReadAt(uiPos + 8,ucDs64,sizeof(ucDs64)))
+                    {
+                        return false;
+                    }
+
+                    uiDs64DataSize = ReadLE64(ucDs64 + 8);
+                }
+                break;
+
+            case WAVEREADER_ID_FMT:
+                if (!ParseFormat(uiPos + 8,ulChunkSize))
+                    return false;
+
+                bHasFormat = true;
+                break;
+
+            case WAVEREADER_ID_DATA:
+                if (!bHasFormat)
+                    return false;
+
+                m_uiDataOffset = uiPos + 8;
+                m_uiDataSize = bRF64 && ulChunkSize == 0xFFFFFFFF ?
+                    uiDs64DataSize : ulChunkSize;
+
+                // Be forgiving to truncated files.
+                if (m_uiDataOffset + m_uiDataSize > m_uiFileSize)
+                    m_uiDataSize = m_uiFileSize - m_uiDataOffset;
+
+                m_uiDataSize -= m_uiDataSize % m_iBlockAlign;
+                return true;
+        }
+
+        // Chunks are padded to an even number of bytes.
+        uiPos += 8 + (unsigned __int64)ulChunkSize + (ulChunkSize & 1);
+    }
+
+    return false;
+}
+
+bool CWaveReader::MapView(unsigned __int64 uiOffset)
+{
+    UnmapView();
+
+    SYSTEM_INFO SystemInfo;
+    GetSystemInfo(&SystemInfo);
+
+    unsigned __int64 uiViewOffset = uiOffset - uiOffset % SystemInfo.dwAllocationGranularity;
+    unsigned __int64 uiViewSize = m_uiFileSize - uiViewOffset;
+    if (uiViewSize > WAVEREADER_VIEWSIZE)
+        uiViewSize = WAVEREADER_VIEWSIZE;
+
+    m_pView = (unsigned char *)MapViewOfFile(m_hMapping,FILE_MAP_READ,
+        (unsigned long)(uiViewOffset >> 32),(unsigned long)uiViewOffset,
+        (SIZE_T)uiViewSize);
+    if (m_pView == NULL)
+        return false;
+
+    m_uiViewOffset = uiViewOffset;
+    m_ulViewSize = (unsigned long)uiViewSize;
+    return true;
+}
+
+void CWaveReader::UnmapView()
+{
+    if (m_pView != NULL)
+    {
+        UnmapViewOfFile(m_pView);
+        m_pView = NULL;
+    }
+
+    m_uiViewOffset = 0;
+    m_ulViewSize = 0;
+}
+
+bool CWaveReader::Open(const TCHAR *szFileName)
+{
+    if (IsOpen())
+        return false;
+
+    m_hFile = CreateFile(szFileName,GENERIC_READ,FILE_SHARE_READ | FILE_SHARE_WRITE,
+        NULL,OPEN_EXISTING,FILE_FLAG_SEQUENTIAL_SCAN,NULL);
+    if (m_hFile == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER liFileSize;
+    if (!GetFileSizeEx(m_hFile,&liFileSize))
+    {
+        Close();
+        return false;
+    }
+
+    m_uiFileSize = liFileSize.QuadPart;
+
+    // Only plain PCM files are handled, everything else is left to AVIFile.
+    if (!ParseHeader() || m_uiDataSize == 0)
+    {
+        Close();
+        return false;
+    }
+
+    m_hMapping = CreateFileMapping(m_hFile,NULL,PAGE_READONLY,0,0,NULL);
+    if (m_hMapping == NULL)
+    {
+        Close();
+        return false;
+    }
+
+    m_uiDataPos = 0;
+    return true;
+}
+
+bool CWaveReader::Close()
+{
+    UnmapView();
+
+    if (m_hMapping != NULL)
+    {
+        CloseHandle(m_hMapping);
+        m_hMapping = NULL;
+    }
+
+    if (m_hFile == INVALID_HANDLE_VALUE)
+        return false;
+
+    CloseHandle(m_hFile);
+    m_hFile = INVALID_HANDLE_VALUE;
+
+    m_uiFileSize = 0;
+    m_uiDataOffset = 0;
+    m_uiDataSize = 0;
+    m_uiDataPos = 0;
+    return true;
+}
+
+bool CWaveReader::IsOpen() const
+{
+    return m_hFile != INVALID_HANDLE_VALUE;
+}
+
+__int64 CWaveReader::Read(unsigned char *pBuffer,__int64 iBufferSize)
+{
+    if (m_hMapping == NULL || iBufferSize < 0)
+        return -1;
+
+    // Only return complete sample frames.
+    unsigned __int64 uiRemain = m_uiDataSize - m_uiDataPos;
+    unsigned __int64 uiRequest = (unsigned __int64)iBufferSize;
+    uiRequest -= uiRequest % m_iBlockAlign;
+    if (uiRequest > uiRemain)
+        uiRequest = uiRemain;
+
+    unsigned __int64 uiCopied = 0;
+    while (uiCopied < uiRequest)
+    {
+        unsigned __int64 uiFilePos = m_uiDataOffset + m_uiDataPos;
+        if (m_pView == NULL || uiFilePos < m_uiViewOffset ||
+            uiFilePos >= m_uiViewOffset + m_ulViewSize)
+        {
+            if (!MapView(uiFilePos))
+                return -1;
+        }
+
+        unsigned __int64 uiAvail = m_uiViewOffset + m_ulViewSize - uiFilePos;
+        unsigned long ulCopy = (unsigned long)(uiRequest - uiCopied < uiAvail ?
+            uiRequest - uiCopied : uiAvail);
+
+        memcpy(pBuffer + uiCopied,m_pView + (uiFilePos - m_uiViewOffset),ulCopy);
+
+        uiCopied += ulCopy;
+        m_uiDataPos += ulCopy;
+    }
+
+    return (__int64)uiCopied;
+}
+
+int CWaveReader::GetNumChannels() const
+{
+    return m_iNumChannels;
+}
+
+int CWaveReader::GetSampleRate() const
+{
+    return m_iSampleRate;
+}
+
+int CWaveReader::GetBitsPerSample() const
+{
+    return m_iBitsPerSample;
+}
+
+unsigned __int64 CWaveReader::GetDuration() const
+{
+    if (m_iBlockAlign == 0 || m_iSampleRate == 0)
+        return 0;
+
+    return (m_uiDataSize / m_iBlockAlign) * 1000 / m_iSampleRate;
+}
+
+unsigned __int64 CWaveReader::GetTime() const
+{
+    if (m_iBlockAlign == 0 || m_iSampleRate == 0)
+        return 0;
+
+    return (m_uiDataPos / m_iBlockAlign) * 1000 / m_iSampleRate;
+}
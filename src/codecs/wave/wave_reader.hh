@@ -0,0 +1,69 @@
+/*
+ * InfraRecorder - CD/DVD burning software
+ * Copyright (C) 2006-2012 Christian Kindahl
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+// Size of the file view that is mapped into memory at a time. Must be a
+// multiple of the system allocation granularity (64 KiB).
+#define WAVEREADER_VIEWSIZE					(32 * 1024 * 1024)
+
+// Reads uncompressed PCM data from RIFF and RF64 files by mapping the data
+// chunk into memory instead of going through the AVIFile API.
+class CWaveReader
+{
+private:
+    HANDLE m_hFile;
+    HANDLE m_hMapping;
+
+    // Currently mapped view of the file.
+    unsigned char *m_pView;
+    unsigned __int64 m_uiViewOffset;
+    unsigned long m_ulViewSize;
+
+    unsigned __int64 m_uiFileSize;
+    unsigned __int64 m_uiDataOffset;
+    unsigned __int64 m_uiDataSize;
+    unsigned __int64 m_uiDataPos;
+
+    int m_iNumChannels;
+    int m_iSampleRate;
+    int m_iBitsPerSample;
+    int m_iBlockAlign;
+
+    bool ReadAt(unsigned __int64 uiOffset,void *pBuffer,unsigned long ulSize);
+    bool ParseHeader();
+    bool ParseFormat(unsigned __int64 uiOffset,unsigned long ulSize);
+    bool MapView(unsigned __int64 uiOffset);
+    void UnmapView();
+
+public:
+    CWaveReader();
+    ~CWaveReader();
+
+    bool Open(const TCHAR *szFileName);
+    bool Close();
+    bool IsOpen() const;
+
+    __int64 Read(unsigned char *pBuffer,__int64 iBufferSize);
+
+    int GetNumChannels() const;
+    int GetSampleRate() const;
+    int GetBitsPerSample() const;
+    unsigned __int64 GetDuration() const;
+    unsigned __int64 GetTime() const;
+};
@@ -0,0 +1,140 @@
+/*
+ * InfraRecorder - CD/DVD burning software
+ * Copyright (C) 2006-2012 Christian Kindahl
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <windows.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include <cxxtest/TestSuite.h>
+#include <ckcore/file.hh>
+#include <ckcore/types.hh>
+#include <base/checksum_util.hh>
+#include <base/cd_text_packs.hh>
+
+class CdTextTestSuite : public CxxTest::TestSuite
+{
+private:
+    ckcore::File *file_;
+
+public:
+    void setUp()
+    {
+        file_ = new ckcore::File(ckcore::File::temp(ckT("ir_test")));
+    }
+
+    void tearDown()
+    {
+        file_->remove();
+        delete file_;
+    }
+
+    void test_packs()
+    {
+        CCdTextPacks packs;
+        packs.AddBlock(CDTEXT_LANGUAGE_ENGLISH);
+        packs.SetTrackCount(2);
+        packs.SetText(0,CCdTextPacks::PT_TITLE,0,"Album");
+        packs.SetText(0,CCdTextPacks::PT_TITLE,1,"First track");
+        packs.SetText(0,CCdTextPacks::PT_TITLE,2,"Second");
+
+        // "Album\0First track\0Second\0" takes three packs, followed by the
+        // three size information packs.
+        std::vector<unsigned char> buffer;
+        TS_ASSERT(packs.Build(buffer));
+        TS_ASSERT_EQUALS(buffer.size(),6 * CDTEXT_PACKSIZE);
+
+        const unsigned char *pack = &buffer[CDTEXT_PACKSIZE];
+        TS_ASSERT_EQUALS(pack[0],0x80);
+        TS_ASSERT_EQUALS(pack[1],1);
+        TS_ASSERT_EQUALS(pack[2],1);
+        TS_ASSERT_EQUALS(pack[3],6);
+        TS_ASSERT_EQUALS(pack[4],'t');
+
+        unsigned short crc = ChecksumCrc16(pack,16) ^ 0xffff;
+        TS_ASSERT_EQUALS(pack[16],crc >> 8);
+        TS_ASSERT_EQUALS(pack[17],crc & 0xff);
+
+        pack = &buffer[3 * CDTEXT_PACKSIZE];
+        TS_ASSERT_EQUALS(pack[0],0x8f);
+        TS_ASSERT_EQUALS(pack[2],3);
+        TS_ASSERT_EQUALS(pack[6],2);		// Last track.
+        TS_ASSERT_EQUALS(pack[8],3);		// Title packs.
+    }
+
+    void test_round_trip()
+    {
+        CCdTextPacks packs;
+        for (unsigned int i = 0; i < CDTEXT_MAXBLOCKS; i++)
+            TS_ASSERT(packs.AddBlock((unsigned char)(CDTEXT_LANGUAGE_ENGLISH + i)) != NULL);
+        TS_ASSERT(packs.AddBlock(CDTEXT_LANGUAGE_ENGLISH) == NULL);
+
+        packs.SetTrackCount(CDTEXT_MAXTRACKS);
+
+        char text[32];
+        for (unsigned int i = 0; i < CDTEXT_MAXBLOCKS; i++)
+        {
+            sprintf(text,"Album %u",i);
+            packs.SetText(i,CCdTextPacks::PT_TITLE,0,text);
+            packs.SetText(i,CCdTextPacks::PT_PERFORMER,0,"Artist");
+
+            for (unsigned int j = 1; j <= CDTEXT_MAXTRACKS; j++)
+            {
+                sprintf(text,"T%u.%u",i,j);
+                packs.SetText(i,CCdTextPacks::PT_TITLE,j,text);
+            }
+        }
+
+        TS_ASSERT(packs.WriteFile(file_->name().c_str()));
+
+        CCdTextPacks read;
+        TS_ASSERT(read.ReadFile(file_->name().c_str()));
+        TS_ASSERT_EQUALS(read.GetBlockCount(),CDTEXT_MAXBLOCKS);
+        TS_ASSERT_EQUALS(read.GetTrackCount(),CDTEXT_MAXTRACKS);
+
+        for (unsigned int i = 0; i < CDTEXT_MAXBLOCKS; i++)
+        {
+            TS_ASSERT_EQUALS(read.GetBlock(i)->m_ucLanguage,CDTEXT_LANGUAGE_ENGLISH + i);
+
+            sprintf(text,"Album %u",i);
+            TS_ASSERT_SAME_DATA(read.GetText(i,CCdTextPacks::PT_TITLE,0),text,strlen(text) + 1);
+            TS_ASSERT_SAME_DATA(read.GetText(i,CCdTextPacks::PT_PERFORMER,0),"Artist",7);
+            TS_ASSERT_SAME_DATA(read.GetText(i,CCdTextPacks::PT_PERFORMER,1),"",1);
+
+            for (unsigned int j = 1; j <= CDTEXT_MAXTRACKS; j++)
+            {
+                sprintf(text,"T%u.%u",i,j);
+                TS_ASSERT_SAME_DATA(read.GetText(i,CCdTextPacks::PT_TITLE,j),text,strlen(text) + 1);
+            }
+        }
+    }
+
+    void test_overflow()
+    {
+        // A block can't hold more than 256 packs.
+        CCdTextPacks packs;
+        packs.AddBlock(CDTEXT_LANGUAGE_ENGLISH);
+        packs.SetTrackCount(CDTEXT_MAXTRACKS);
+
+        std::string text(40,'x');
+        for (unsigned int i = 0; i <= CDTEXT_MAXTRACKS; i++)
+            packs.SetText(0,CCdTextPacks::PT_TITLE,i,text.c_str());
+
+        std::vector<unsigned char> buffer;
+        TS_ASSERT(!packs.Build(buffer));
+    }
+};
@@ -0,0 +1,166 @@
+/*
+ * InfraRecorder - CD/DVD burning software
+ * Copyright (C) 2006-2012 Christian Kindahl
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <windows.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <cxxtest/TestSuite.h>
+#include <ckcore/file.hh>
+#include <ckcore/types.hh>
+#include <app/core/cdrtools_parser.hh>
+
+#define CDRTOOLS_REF(name)          { CDRTOOLS_##name,CDRTOOLS_##name##_LENGTH,CCdrtoolsParser::TOKEN_##name }
+
+// Reference implementation of the strncmp cascades previously used by
+// CCore::event_output and its handlers.
+struct cdrtools_ref_entry
+{
+    const char *prefix;
+    size_t length;
+    int token;
+};
+
+const cdrtools_ref_entry cdrtools_ref_table[] =
+{
+    CDRTOOLS_REF(COPYRIGHT),
+    CDRTOOLS_REF(ERROR),
+    CDRTOOLS_REF(ERROR3),
+    CDRTOOLS_REF(ERROR4),
+    CDRTOOLS_REF(GRACEBEGIN),
+    CDRTOOLS_REF(NOMEDIA),
+    CDRTOOLS_REF(CYGWINPATH),
+    CDRTOOLS_REF(NOSUPPORT),
+    CDRTOOLS_REF(BLANK),
+    CDRTOOLS_REF(STARTCDWRITE),
+    CDRTOOLS_REF(BLANKTIME),
+    CDRTOOLS_REF(NODISC),
+    CDRTOOLS_REF(BLANKERROR),
+    CDRTOOLS_REF(BLANKUNSUP),
+    CDRTOOLS_REF(BLANKRETRY),
+    CDRTOOLS_REF(UNSUPPORTED),
+    CDRTOOLS_REF(SECTOR),
+    CDRTOOLS_REF(VERSIONINFO),
+    CDRTOOLS_REF(DVDINFO),
+    CDRTOOLS_REF(DVDGETINFO),
+    CDRTOOLS_REF(STARTTRACK),
+    CDRTOOLS_REF(WRITEPREGAP),
+    CDRTOOLS_REF(FILLFIFO),
+    CDRTOOLS_REF(WRITETIME),
+    CDRTOOLS_REF(FIXATE),
+    CDRTOOLS_REF(FIXATETIME),
+    CDRTOOLS_REF(WARNINGCAP),
+    CDRTOOLS_REF(WRITEERROR),
+    CDRTOOLS_REF(BADAUDIOCODING),
+    CDRTOOLS_REF(RELOADDRIVE),
+    CDRTOOLS_REF(TOTALTIME),
+    CDRTOOLS_REF(END),
+    CDRTOOLS_REF(ADDRESS),
+    CDRTOOLS_REF(IOERROR),
+    CDRTOOLS_REF(SECTORERROR),
+    CDRTOOLS_REF(RETRYSECTOR),
+    CDRTOOLS_REF(C2ERRORS),
+    CDRTOOLS_REF(PERCENTDONE),
+    CDRTOOLS_REF(FOUNDDVDMEDIA),
+    CDRTOOLS_REF(OPENSESSION),
+    CDRTOOLS_REF(DISCSPACEWARNING),
+    CDRTOOLS_REF(TURNINGBFON),
+    CDRTOOLS_REF(ERRORLEADIN),
+    CDRTOOLS_REF(ERRORINITDRIVE),
+    CDRTOOLS_REF(DVDRWDUMMY),
+    CDRTOOLS_REF(FIFO),
+};
+
+int ref_match(const char *line)
+{
+    for (size_t i = 0; i < sizeof(cdrtools_ref_table) / sizeof(cdrtools_ref_entry); i++)
+    {
+        if (!strncmp(line,cdrtools_ref_table[i].prefix,cdrtools_ref_table[i].length))
+            return cdrtools_ref_table[i].token;
+    }
+
+    return CCdrtoolsParser::TOKEN_NONE;
+}
+
+// Splits a transcript into blocks the same way as ckcore::Process does with
+// the default delimiters.
+bool load_transcript(const ckcore::tchar *file_path,std::vector<std::string> &lines)
+{
+    ckcore::File file(file_path);
+    if (!file.open(ckcore::File::ckOPEN_READ))
+        return false;
+
+    std::string data((size_t)file.size(),'\0');
+    if (file.read(&data[0],(ckcore::tuint32)data.size()) != (ckcore::tint64)data.size())
+        return false;
+
+    size_t start = 0;
+    for (size_t i = 0; i <= data.size(); i++)
+    {
+        if (i == data.size() || data[i] == '\r' || data[i] == '\n')
+        {
+            if (i > start)
+                lines.push_back(data.substr(start,i - start));
+
+            start = i + 1;
+        }
+    }
+
+    return true;
+}
+
+class CdrtoolsTestSuite : public CxxTest::TestSuite
+{
+private:
+    std::vector<std::string> lines_;
+
+public:
+    void setUp()
+    {
+        lines_.clear();
+        TS_ASSERT(load_transcript(ckT("..\\..\\..\\src\\tests\\data\\cdrtools\\cdrecord_burn.txt"),lines_));
+        TS_ASSERT(load_transcript(ckT("..\\..\\..\\src\\tests\\data\\cdrtools\\readcd_disc.txt"),lines_));
+    }
+
+    void test_equivalence()
+    {
+        CCdrtoolsParser parser;
+
+        // Every prefix must be recognized by itself.
+        for (size_t i = 0; i < sizeof(cdrtools_ref_table) / sizeof(cdrtools_ref_entry); i++)
+        {
+            unsigned int len = 0;
+            TS_ASSERT_EQUALS(parser.Match(cdrtools_ref_table[i].prefix,&len),cdrtools_ref_table[i].token);
+            TS_ASSERT_EQUALS(len,cdrtools_ref_table[i].length);
+        }
+
+        TS_ASSERT_EQUALS(parser.Match(""),CCdrtoolsParser::TOKEN_NONE);
+        TS_ASSERT_EQUALS(parser.Match("Fixating"),CCdrtoolsParser::TOKEN_NONE);
+
+        // The transcripts, including the part following the error prefixes.
+        for (size_t i = 0; i < lines_.size(); i++)
+        {
+            const char *line = lines_[i].c_str();
+            TS_ASSERT_EQUALS(parser.Match(line),ref_match(line));
+
+            unsigned int len = 0;
+            if (parser.Match(line,&len) != CCdrtoolsParser::TOKEN_NONE)
+                TS_ASSERT_EQUALS(parser.Match(line + len),ref_match(line + len));
+        }
+    }
+};
@@ -0,0 +1,95 @@
+/*
+ * InfraRecorder - CD/DVD burning software
+ * Copyright (C) 2006-2012 Christian Kindahl
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <windows.h>
+#include <cxxtest/TestSuite.h>
+#include <ckcore/buffer.hh>
+#include <ckcore/crcstream.hh>
+#include <ckcore/types.hh>
+#include <base/checksum_util.hh>
+
+#define CHECKSUM_TEST_SIZE          (4 * 1024 * 1024)
+
+// Reference implementation of the byte-at-a-time CRC-16 previously used by
+// CCdText.
+unsigned short ref_crc16(const unsigned char *buffer,size_t size)
+{
+    unsigned short crc = 0;
+    for (size_t i = 0; i < size; i++)
+    {
+        crc ^= buffer[i] << 8;
+        for (int j = 0; j < 8; j++)
+            crc = crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1;
+    }
+
+    return crc;
+}
+
+class ChecksumTestSuite : public CxxTest::TestSuite
+{
+public:
+    void test_check_values()
+    {
+        const char *check = "123456789";
+
+        TS_ASSERT_EQUALS(ChecksumCrc16(check,9),0x31C3);
+        TS_ASSERT_EQUALS(ChecksumCrc32(check,9),0xCBF43926);
+        TS_ASSERT_EQUALS(ChecksumCrc32c(check,9),0xE3069283);
+    }
+
+    void test_running_checksum()
+    {
+        unsigned char buffer[1021];
+        for (size_t i = 0; i < sizeof(buffer); i++)
+            buffer[i] = (unsigned char)(i * 31 + 7);
+
+        // Unaligned split points must not change the result.
+        TS_ASSERT_EQUALS(ChecksumCrc16(buffer + 13,sizeof(buffer) - 13,ChecksumCrc16(buffer,13)),
+                         ref_crc16(buffer,sizeof(buffer)));
+        TS_ASSERT_EQUALS(ChecksumCrc32(buffer + 5,sizeof(buffer) - 5,ChecksumCrc32(buffer,5)),
+                         ChecksumCrc32(buffer,sizeof(buffer)));
+        TS_ASSERT_EQUALS(ChecksumCrc32c(buffer + 3,sizeof(buffer) - 3,ChecksumCrc32c(buffer,3)),
+                         ChecksumCrc32c(buffer,sizeof(buffer)));
+
+        ckcore::CrcStream cs(ckcore::CrcStream::ckCRC_32);
+        cs.write(buffer,sizeof(buffer));
+        TS_ASSERT_EQUALS(ChecksumCrc32(buffer,sizeof(buffer)),cs.checksum());
+    }
+
+    void test_large_buffer()
+    {
+        ckcore::Buffer<unsigned char> buffer(CHECKSUM_TEST_SIZE);
+        for (size_t i = 0; i < buffer.size(); i++)
+            buffer[i] = (unsigned char)(i * 2654435761U >> 24);
+
+        // CD-Text packs are 16 bytes, check CRC-16 on pack sized blocks.
+        unsigned short crc16_ref = 0,crc16_new = 0;
+        for (size_t i = 0; i < buffer.size(); i += 16)
+        {
+            crc16_ref ^= ref_crc16(buffer + i,16);
+            crc16_new ^= ChecksumCrc16(buffer + i,16);
+        }
+
+        TS_ASSERT_EQUALS(crc16_ref,crc16_new);
+
+        // CRC-32 compared to ckcore::CrcStream.
+        ckcore::CrcStream cs(ckcore::CrcStream::ckCRC_32);
+        cs.write(buffer,(ckcore::tuint32)buffer.size());
+        TS_ASSERT_EQUALS(cs.checksum(),ChecksumCrc32(buffer,buffer.size()));
+    }
+};
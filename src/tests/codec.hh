@@ -24,6 +24,7 @@
 #include <ckcore/filestream.hh>
 #include <ckcore/stream.hh>
 #include <ckcore/types.hh>
+#include <base/checksum_util.hh>
 #include <base/codec_manager.hh>
 
 #define TEST_CODE(decoder,encoder)                                      \
@@ -80,6 +81,29 @@ ckcore::tuint32 get_file_crc(const ckcore::tchar * file_path)
     return cs.checksum();
 }
 
+ckcore::tuint32 get_decoded_crc(CCodec &decoder,const ckcore::tchar * file_path)
+{
+    int num_channels = -1,sample_rate = -1,bit_rate = -1;
+    unsigned __int64 duration = 0;
+    TS_ASSERT(decoder.irc_decode_init(file_path,num_channels,sample_rate,bit_rate,duration));
+
+    ckcore::Buffer<unsigned char> buffer(num_channels * ((bit_rate / sample_rate) >> 3) * 1024);
+
+    ckcore::tuint32 crc = 0;
+    unsigned __int64 time = 0;
+    while (true)
+    {
+        __int64 read = decoder.irc_decode_process(buffer,buffer.size(),time);
+        if (read <= 0)
+            break;
+
+        crc = ChecksumCrc32(buffer,(size_t)read,crc);
+    }
+
+    TS_ASSERT(decoder.irc_decode_exit());
+    return crc;
+}
+
 class CodecTestSuite : public CxxTest::TestSuite
 {
 public:
@@ -201,4 +225,59 @@ public:
         //std::cout << num_channels << std::endl << sample_rate << std::endl << bit_rate << std::endl << duration << std::endl;
 #endif
     }
+
+    void test_wave_decoder()
+    {
+        CCodec wave_codec;
+        TS_ASSERT(wave_codec.Load(ckT("codecs\\wave.irc")));
+        TS_ASSERT_EQUALS(wave_codec.irc_capabilities() & IRC_HAS_DECODER,IRC_HAS_DECODER);
+
+        // PCM files are read through the memory mapped reader.
+        int num_channels = -1,sample_rate = -1,bit_rate = -1;
+        unsigned __int64 duration = 0;
+        TS_ASSERT(wave_codec.irc_decode_init(ckT("..\\..\\..\\src\\tests\\data\\audio\\audio_test_1.wav"),
+                                             num_channels,sample_rate,bit_rate,duration));
+        TS_ASSERT_EQUALS(num_channels,2);
+        TS_ASSERT_EQUALS(sample_rate,44100);
+        TS_ASSERT_EQUALS(bit_rate,705600);
+        TS_ASSERT_EQUALS(duration,12000);
+        TS_ASSERT(wave_codec.irc_decode_exit());
+
+        // The samples must match the samples decoded by libsndfile.
+        CCodec sndfile_codec;
+        TS_ASSERT(sndfile_codec.Load(ckT("codecs\\sndfile.irc")));
+
+        ckcore::tuint32 crc_ref = get_decoded_crc(sndfile_codec,ckT("..\\..\\..\\src\\tests\\data\\audio\\audio_test_1.wav"));
+        ckcore::tuint32 crc_tst = get_decoded_crc(wave_codec,ckT("..\\..\\..\\src\\tests\\data\\audio\\audio_test_1.wav"));
+
+        TS_ASSERT_EQUALS(crc_ref,crc_tst);
+    }
+
+    void test_deferred_load()
+    {
+        CCodec sndfile_codec;
+        sndfile_codec.Defer(ckT("codecs\\sndfile.irc"),IRC_HAS_DECODER | IRC_HAS_ENCODER,
+                            ckT("1.0"),ckT("Wave"),ckT(".wav"));
+
+        // The manifest information must not load the plug-in.
+        TS_ASSERT_EQUALS(sndfile_codec.irc_capabilities(),IRC_HAS_DECODER | IRC_HAS_ENCODER);
+        TS_ASSERT_EQUALS(ckcore::tstring(sndfile_codec.irc_string(IRC_STR_FILEEXT)),ckT(".wav"));
+        TS_ASSERT(!sndfile_codec.IsLoaded());
+
+        // The plug-in is loaded on first use.
+        int num_channels = -1,sample_rate = -1,bit_rate = -1;
+        unsigned __int64 duration = 0;
+        TS_ASSERT(sndfile_codec.irc_decode_init(ckT("..\\..\\..\\src\\tests\\data\\audio\\audio_test_1.wav"),
+                                                num_channels,sample_rate,bit_rate,duration));
+        TS_ASSERT(sndfile_codec.IsLoaded());
+        TS_ASSERT_EQUALS(duration,12000);
+        TS_ASSERT(sndfile_codec.irc_decode_exit());
+
+        // A plug-in that can't be loaded fails gracefully.
+        CCodec missing_codec;
+        missing_codec.Defer(ckT("codecs\\missing.irc"),IRC_HAS_DECODER,ckT(""),ckT(""),ckT(""));
+        TS_ASSERT(!missing_codec.irc_decode_init(ckT("..\\..\\..\\src\\tests\\data\\audio\\audio_test_1.wav"),
+                                                 num_channels,sample_rate,bit_rate,duration));
+        TS_ASSERT(!missing_codec.IsLoaded());
+    }
 };
@@ -0,0 +1,531 @@
+/*
+ * InfraRecorder - CD/DVD burning software
+ * Copyright (C) 2006-2012 Christian Kindahl
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+    Measures the throughput of the decoders and encoders of all codecs in
+    the codec directory. Every decoder is run over the audio test data and
+    two synthetic inputs, a long stereo recording and a multichannel
+    recording. Every encoder is fed with the decoded Wave inputs. Each run is
+    repeated for a number of buffer sizes.
+
+    The results are printed as a table and can be written as comma separated
+    values so that the results of different builds can be compared:
+
+        benchmark.exe [-c <codec dir>] [-d <data dir>] [-o <csv file>]
+*/
+
+#include <windows.h>
+#include <psapi.h>
+#include <stdio.h>
+#include <tchar.h>
+#include <math.h>
+#include <vector>
+#include <ckcore/file.hh>
+#include <ckcore/path.hh>
+#include <ckcore/types.hh>
+#include <base/codec_manager.hh>
+
+#define BENCHMARK_CODEC_DIR				ckT("codecs\\")
+#define BENCHMARK_DATA_DIR				ckT("..\\..\\..\\src\\tests\\data\\audio\\")
+
+#define BENCHMARK_LONG_DURATION			300		// Seconds.
+#define BENCHMARK_MULTICHANNEL_DURATION	60		// Seconds.
+#define BENCHMARK_MULTICHANNEL_CHANNELS	6
+
+static const unsigned long buffer_sizes[] =
+{
+    4 * 1024,
+    64 * 1024,
+    1024 * 1024
+};
+
+class benchmark_input
+{
+public:
+    ckcore::tstring name_;
+    ckcore::tstring path_;
+    bool synthetic_;
+
+    benchmark_input(const ckcore::tstring &name,const ckcore::tstring &path,bool synthetic) :
+        name_(name),path_(path),synthetic_(synthetic)
+    {
+    }
+};
+
+class benchmark_result
+{
+public:
+    ckcore::tstring codec_;
+    const ckcore::tchar *operation_;
+    ckcore::tstring input_;
+    unsigned long buffer_size_;
+
+    bool supported_;
+    ckcore::tuint64 bytes_;			// Number of PCM bytes processed.
+    ckcore::tuint64 duration_;		// Duration of the audio in milliseconds.
+    ckcore::tuint64 peak_memory_;	// Peak growth of the private bytes.
+    double seconds_;
+
+    benchmark_result(const ckcore::tstring &codec,const ckcore::tchar *operation,
+                     const ckcore::tstring &input,unsigned long buffer_size) :
+        codec_(codec),operation_(operation),input_(input),buffer_size_(buffer_size),
+        supported_(false),bytes_(0),duration_(0),peak_memory_(0),seconds_(0.0)
+    {
+    }
+
+    double mb_per_second() const
+    {
+        return seconds_ > 0.0 ? bytes_ / 1000000.0 / seconds_ : 0.0;
+    }
+
+    double realtime_factor() const
+    {
+        return seconds_ > 0.0 ? duration_ / 1000.0 / seconds_ : 0.0;
+    }
+};
+
+class benchmark_timer
+{
+private:
+    LARGE_INTEGER freq_;
+    LARGE_INTEGER start_;
+
+public:
+    benchmark_timer()
+    {
+        QueryPerformanceFrequency(&freq_);
+        QueryPerformanceCounter(&start_);
+    }
+
+    double elapsed() const
+    {
+        LARGE_INTEGER now;
+        QueryPerformanceCounter(&now);
+
+        return (double)(now.QuadPart - start_.QuadPart) / freq_.QuadPart;
+    }
+};
+
+/*
+    The codecs are linked with their own run-time library, so individual
+    allocations can't be observed from here. The memory use is measured as
+    the growth of the private bytes of the process instead.
+*/
+class memory_monitor
+{
+private:
+    ckcore::tuint64 base_;
+    ckcore::tuint64 peak_;
+
+    static ckcore::tuint64 private_bytes()
+    {
+        PROCESS_MEMORY_COUNTERS counters;
+        if (!GetProcessMemoryInfo(GetCurrentProcess(),&counters,sizeof(counters)))
+            return 0;
+
+        return counters.PagefileUsage;
+    }
+
+public:
+    memory_monitor() : base_(private_bytes()),peak_(base_)
+    {
+    }
+
+    void sample()
+    {
+        ckcore::tuint64 bytes = private_bytes();
+        if (bytes > peak_)
+            peak_ = bytes;
+    }
+
+    ckcore::tuint64 peak() const
+    {
+        return peak_ - base_;
+    }
+};
+
+static ckcore::tstring codec_name(CCodec *codec)
+{
+    ckcore::tchar file_name[MAX_PATH];
+    if (!codec->GetFileName(file_name,MAX_PATH))
+        return ckT("unknown");
+
+    ckcore::Path path(file_name);
+    return path.base_name();
+}
+
+static unsigned long align_buffer_size(unsigned long buffer_size,int block_align)
+{
+    if (block_align <= 0)
+        return buffer_size;
+
+    return buffer_size - buffer_size % block_align;
+}
+
+/*
+    Writes a 16-bit PCM Wave file containing a tone mixed with noise, the
+    noise keeps the lossy encoders from finding trivial input.
+*/
+static bool write_wave(const ckcore::tstring &path,int num_channels,int sample_rate,
+                       unsigned long seconds)
+{
+    ckcore::File file(path.c_str());
+    if (!file.open(ckcore::File::ckOPEN_WRITE))
+        return false;
+
+    unsigned long block_align = num_channels * 2;
+    unsigned long data_size = seconds * sample_rate * block_align;
+
+    unsigned char header[44];
+    memset(header,0,sizeof(header));
+    memcpy(header,"RIFF",4);
+    *(ckcore::tuint32 *)(header + 4) = 36 + data_size;
+    memcpy(header + 8,"WAVEfmt ",8);
+    *(ckcore::tuint32 *)(header + 16) = 16;
+    *(ckcore::tuint16 *)(header + 20) = 1;		// PCM.
+    *(ckcore::tuint16 *)(header + 22) = (ckcore::tuint16)num_channels;
+    *(ckcore::tuint32 *)(header + 24) = sample_rate;
+    *(ckcore::tuint32 *)(header + 28) = sample_rate * block_align;
+    *(ckcore::tuint16 *)(header + 32) = (ckcore::tuint16)block_align;
+    *(ckcore::tuint16 *)(header + 34) = 16;
+    memcpy(header + 36,"data",4);
+    *(ckcore::tuint32 *)(header + 40) = data_size;
+
+    if (file.write(header,sizeof(header)) != (ckcore::tint64)sizeof(header))
+        return false;
+
+    std::vector<short> samples(sample_rate * num_channels);
+    ckcore::tuint32 seed = 1;
+
+    for (unsigned long s = 0; s < seconds; s++)
+    {
+        for (int i = 0; i < sample_rate; i++)
+        {
+            for (int c = 0; c < num_channels; c++)
+            {
+                seed = seed * 1664525 + 1013904223;
+                double tone = sin(2.0 * 3.14159265358979 * (220.0 * (c + 1)) * i / sample_rate);
+                int noise = (int)(seed >> 20) - 2048;
+
+                samples[i * num_channels + c] = (short)(tone * 12000.0 + noise);
+            }
+        }
+
+        ckcore::tuint32 size = (ckcore::tuint32)(samples.size() * sizeof(short));
+        if (file.write(&samples[0],size) != (ckcore::tint64)size)
+            return false;
+    }
+
+    return true;
+}
+
+static benchmark_result benchmark_decoder(CCodec *codec,const benchmark_input &input,
+                                          unsigned long buffer_size)
+{
+    benchmark_result result(codec_name(codec),ckT("decode"),input.name_,buffer_size);
+
+    memory_monitor memory;
+    benchmark_timer timer;
+
+    int num_channels = -1,sample_rate = -1,bit_rate = -1;
+    unsigned __int64 duration = 0;
+    if (!codec->irc_decode_init(input.path_.c_str(),num_channels,sample_rate,bit_rate,duration))
+        return result;
+
+    result.buffer_size_ = align_buffer_size(buffer_size,num_channels * 2);
+    std::vector<unsigned char> buffer(result.buffer_size_);
+
+    unsigned __int64 time = 0;
+    while (true)
+    {
+        __int64 read = codec->irc_decode_process(&buffer[0],buffer.size(),time);
+        if (read <= 0)
+            break;
+
+        result.bytes_ += read;
+        memory.sample();
+    }
+
+    codec->irc_decode_exit();
+
+    result.seconds_ = timer.elapsed();
+    result.supported_ = true;
+    result.duration_ = duration;
+    result.peak_memory_ = memory.peak();
+    return result;
+}
+
+/*
+    Decoded Wave input that is kept in memory so that only the time spent
+    encoding is measured.
+*/
+class pcm_input
+{
+public:
+    ckcore::tstring name_;
+    int num_channels_;
+    int sample_rate_;
+    int bit_rate_;
+    unsigned __int64 duration_;
+    std::vector<unsigned char> data_;
+
+    pcm_input() : num_channels_(-1),sample_rate_(-1),bit_rate_(-1),duration_(0)
+    {
+    }
+
+    bool load(CCodecManager &codec_manager,const benchmark_input &input)
+    {
+        name_ = input.name_;
+
+        std::vector<CCodec *>::iterator it;
+        for (it = codec_manager.m_Codecs.begin(); it != codec_manager.m_Codecs.end(); it++)
+        {
+            CCodec *codec = *it;
+            if (!(codec->irc_capabilities() & IRC_HAS_DECODER))
+                continue;
+
+            if (lstrcmpi(codec->irc_string(IRC_STR_FILEEXT),ckT(".wav")))
+                continue;
+
+            if (!codec->irc_decode_init(input.path_.c_str(),num_channels_,sample_rate_,
+                                        bit_rate_,duration_))
+            {
+                continue;
+            }
+
+            unsigned char buffer[64 * 1024];
+            unsigned __int64 time = 0;
+            while (true)
+            {
+                __int64 read = codec->irc_decode_process(buffer,sizeof(buffer),time);
+                if (read <= 0)
+                    break;
+
+                data_.insert(data_.end(),buffer,buffer + read);
+            }
+
+            codec->irc_decode_exit();
+            return !data_.empty();
+        }
+
+        return false;
+    }
+};
+
+static benchmark_result benchmark_encoder(CCodec *codec,const pcm_input &input,
+                                          unsigned long buffer_size)
+{
+    benchmark_result result(codec_name(codec),ckT("encode"),input.name_,buffer_size);
+    result.buffer_size_ = align_buffer_size(buffer_size,input.num_channels_ * 2);
+
+    ckcore::File tmp = ckcore::File::temp(ckT("ir_bench"));
+
+    memory_monitor memory;
+    benchmark_timer timer;
+
+    if (!codec->irc_encode_init(tmp.name().c_str(),input.num_channels_,
+                                input.sample_rate_,input.bit_rate_))
+    {
+        tmp.remove();
+        return result;
+    }
+
+    bool failed = false;
+
+    size_t pos = 0;
+    while (pos < input.data_.size())
+    {
+        size_t count = input.data_.size() - pos;
+        if (count > result.buffer_size_)
+            count = result.buffer_size_;
+
+        if (codec->irc_encode_process(const_cast<unsigned char *>(&input.data_[pos]),count) < 0)
+        {
+            failed = true;
+            break;
+        }
+
+        pos += count;
+        result.bytes_ += count;
+        memory.sample();
+    }
+
+    if (codec->irc_encode_flush() == -1)
+        failed = true;
+
+    codec->irc_encode_exit();
+
+    result.seconds_ = timer.elapsed();
+    result.supported_ = !failed;
+    result.duration_ = input.duration_;
+    result.peak_memory_ = memory.peak();
+
+    tmp.remove();
+    return result;
+}
+
+static void print_result(const benchmark_result &result,FILE *csv_file)
+{
+    if (!result.supported_)
+    {
+        _tprintf(ckT("%-14s %-6s %-48s %8lu  not supported\n"),result.codec_.c_str(),
+                 result.operation_,result.input_.c_str(),result.buffer_size_);
+    }
+    else
+    {
+        _tprintf(ckT("%-14s %-6s %-48s %8lu %9.2f MB/s %8.1fx %8I64u KiB\n"),
+                 result.codec_.c_str(),result.operation_,result.input_.c_str(),
+                 result.buffer_size_,result.mb_per_second(),result.realtime_factor(),
+                 result.peak_memory_ / 1024);
+    }
+
+    if (csv_file != NULL)
+    {
+        _ftprintf(csv_file,ckT("%s,%s,%s,%lu,%d,%I64u,%I64u,%.6f,%.3f,%.3f,%I64u\n"),
+                  result.codec_.c_str(),result.operation_,result.input_.c_str(),
+                  result.buffer_size_,result.supported_ ? 1 : 0,result.bytes_,result.duration_,
+                  result.seconds_,result.mb_per_second(),result.realtime_factor(),
+                  result.peak_memory_);
+    }
+}
+
+int _tmain(int argc,ckcore::tchar *argv[])
+{
+    ckcore::tstring codec_dir = BENCHMARK_CODEC_DIR;
+    ckcore::tstring data_dir = BENCHMARK_DATA_DIR;
+    const ckcore::tchar *csv_path = NULL;
+
+    for (int i = 1; i < argc - 1; i += 2)
+    {
+        if (!lstrcmp(argv[i],ckT("-c")))
+            codec_dir = argv[i + 1];
+        else if (!lstrcmp(argv[i],ckT("-d")))
+            data_dir = argv[i + 1];
+        else if (!lstrcmp(argv[i],ckT("-o")))
+            csv_path = argv[i + 1];
+    }
+
+    CCodecManager codec_manager;
+    if (!codec_manager.LoadCodecs(codec_dir.c_str()))
+    {
+        _ftprintf(stderr,ckT("error: could not load the codecs in \"%s\".\n"),codec_dir.c_str());
+        return 1;
+    }
+
+    // Collect the inputs.
+    std::vector<benchmark_input> inputs;
+
+    WIN32_FIND_DATA find_data;
+    HANDLE find = FindFirstFile((data_dir + ckT("*.*")).c_str(),&find_data);
+    if (find != INVALID_HANDLE_VALUE)
+    {
+        do
+        {
+            if (!(find_data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+                inputs.push_back(benchmark_input(find_data.cFileName,data_dir + find_data.cFileName,false));
+        }
+        while (FindNextFile(find,&find_data));
+
+        FindClose(find);
+    }
+
+    ckcore::File long_file = ckcore::File::temp(ckT("ir_bench"));
+    ckcore::File multi_file = ckcore::File::temp(ckT("ir_bench"));
+
+    if (!write_wave(long_file.name(),2,44100,BENCHMARK_LONG_DURATION) ||
+        !write_wave(multi_file.name(),BENCHMARK_MULTICHANNEL_CHANNELS,48000,
+                    BENCHMARK_MULTICHANNEL_DURATION))
+    {
+        _ftprintf(stderr,ckT("error: could not create the synthetic input.\n"));
+        long_file.remove();
+        multi_file.remove();
+        return 1;
+    }
+
+    inputs.push_back(benchmark_input(ckT("synthetic_long_stereo.wav"),long_file.name(),true));
+    inputs.push_back(benchmark_input(ckT("synthetic_multichannel.wav"),multi_file.name(),true));
+
+    FILE *csv_file = NULL;
+    if (csv_path != NULL)
+    {
+        csv_file = _tfopen(csv_path,ckT("w"));
+        if (csv_file == NULL)
+        {
+            _ftprintf(stderr,ckT("error: could not create \"%s\".\n"),csv_path);
+            long_file.remove();
+            multi_file.remove();
+            return 1;
+        }
+
+        _ftprintf(csv_file,ckT("codec,operation,input,buffer_size,supported,bytes,duration_ms,")
+                           ckT("seconds,mb_per_second,realtime_factor,peak_memory\n"));
+    }
+
+    std::vector<CCodec *>::iterator it_codec;
+    std::vector<benchmark_input>::const_iterator it_input;
+
+    // Decoders, inputs that a decoder doesn't support are silently skipped.
+    for (it_codec = codec_manager.m_Codecs.begin(); it_codec != codec_manager.m_Codecs.end(); it_codec++)
+    {
+        if (!((*it_codec)->irc_capabilities() & IRC_HAS_DECODER))
+            continue;
+
+        for (it_input = inputs.begin(); it_input != inputs.end(); it_input++)
+        {
+            for (size_t i = 0; i < sizeof(buffer_sizes) / sizeof(buffer_sizes[0]); i++)
+            {
+                benchmark_result result = benchmark_decoder(*it_codec,*it_input,buffer_sizes[i]);
+                if (!result.supported_)
+                    break;
+
+                print_result(result,csv_file);
+            }
+        }
+    }
+
+    // Encoders, all Wave inputs are decoded to memory first.
+    for (it_input = inputs.begin(); it_input != inputs.end(); it_input++)
+    {
+        ckcore::Path path(it_input->path_.c_str());
+        if (!it_input->synthetic_ && lstrcmpi(path.ext_name().c_str(),ckT("wav")))
+            continue;
+
+        pcm_input pcm;
+        if (!pcm.load(codec_manager,*it_input))
+        {
+            _ftprintf(stderr,ckT("warning: could not decode \"%s\".\n"),it_input->name_.c_str());
+            continue;
+        }
+
+        for (it_codec = codec_manager.m_Codecs.begin(); it_codec != codec_manager.m_Codecs.end(); it_codec++)
+        {
+            if (!((*it_codec)->irc_capabilities() & IRC_HAS_ENCODER))
+                continue;
+
+            for (size_t i = 0; i < sizeof(buffer_sizes) / sizeof(buffer_sizes[0]); i++)
+                print_result(benchmark_encoder(*it_codec,pcm,buffer_sizes[i]),csv_file);
+        }
+    }
+
+    if (csv_file != NULL)
+        fclose(csv_file);
+
+    long_file.remove();
+    multi_file.remove();
+    return 0;
+}
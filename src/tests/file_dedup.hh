@@ -0,0 +1,175 @@
+/*
+ * InfraRecorder - CD/DVD burning software
+ * Copyright (C) 2006-2012 Christian Kindahl
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <windows.h>
+#include <vector>
+#include <cxxtest/TestSuite.h>
+#include <ckcore/file.hh>
+#include <ckcore/types.hh>
+#include <base/checksum_util.hh>
+#include <base/file_dedup.hh>
+
+class FileDedupTestSuite : public CxxTest::TestSuite
+{
+private:
+    std::vector<ckcore::File *> files_;
+
+    ckcore::tstring make_file(unsigned char value,size_t size)
+    {
+        ckcore::File *file = new ckcore::File(ckcore::File::temp(ckT("ir_test")));
+        TS_ASSERT(file->open(ckcore::File::ckOPEN_WRITE));
+
+        std::vector<unsigned char> buffer(size,value);
+        if (size > 0)
+            TS_ASSERT_EQUALS(file->write(&buffer[0],(ckcore::tuint32)size),(ckcore::tint64)size);
+
+        file->close();
+        files_.push_back(file);
+
+        return file->name();
+    }
+
+public:
+    void tearDown()
+    {
+        for (size_t i = 0; i < files_.size(); i++)
+        {
+            files_[i]->remove();
+            delete files_[i];
+        }
+
+        files_.clear();
+    }
+
+    void test_duplicates()
+    {
+        CFileDedup dedup;
+
+        // Larger than the block size to cover running checksums.
+        const size_t size = FILEDEDUP_BLOCKSIZE + 1000;
+
+        unsigned int a = dedup.AddFile(make_file(1,size).c_str(),size);
+        unsigned int b = dedup.AddFile(make_file(2,size).c_str(),size);
+        unsigned int c = dedup.AddFile(make_file(1,size).c_str(),size);
+        unsigned int d = dedup.AddFile(make_file(1,100).c_str(),100);
+        unsigned int e = dedup.AddFile(make_file(2,size).c_str(),size);
+        unsigned int f = dedup.AddFile(make_file(1,size).c_str(),size);
+
+        dedup.Run(3);
+
+        TS_ASSERT_EQUALS(dedup.GetOriginal(a),-1);
+        TS_ASSERT_EQUALS(dedup.GetOriginal(b),-1);
+        TS_ASSERT_EQUALS(dedup.GetOriginal(c),(int)a);
+        TS_ASSERT_EQUALS(dedup.GetOriginal(d),-1);
+        TS_ASSERT_EQUALS(dedup.GetOriginal(e),(int)b);
+        TS_ASSERT_EQUALS(dedup.GetOriginal(f),(int)a);
+
+        TS_ASSERT_EQUALS(dedup.GetDuplicateCount(),3);
+        TS_ASSERT_EQUALS(dedup.GetDuplicateBytes(),(ckcore::tuint64)size * 3);
+        TS_ASSERT(dedup.GetKey(a) == dedup.GetKey(c));
+        TS_ASSERT(!(dedup.GetKey(a) == dedup.GetKey(b)));
+    }
+
+    void test_unreadable_and_empty()
+    {
+        CFileDedup dedup;
+
+        // Empty files and files that don't match their expected size are
+        // never duplicates.
+        unsigned int a = dedup.AddFile(make_file(1,0).c_str(),0);
+        unsigned int b = dedup.AddFile(make_file(1,0).c_str(),0);
+        unsigned int c = dedup.AddFile(make_file(3,500).c_str(),500);
+        unsigned int d = dedup.AddFile(make_file(3,400).c_str(),500);
+        unsigned int e = dedup.AddFile(ckT("ir_test_missing_file"),500);
+
+        dedup.Run();
+
+        TS_ASSERT_EQUALS(dedup.GetOriginal(a),-1);
+        TS_ASSERT_EQUALS(dedup.GetOriginal(b),-1);
+        TS_ASSERT_EQUALS(dedup.GetOriginal(c),-1);
+        TS_ASSERT_EQUALS(dedup.GetOriginal(d),-1);
+        TS_ASSERT_EQUALS(dedup.GetOriginal(e),-1);
+        TS_ASSERT_EQUALS(dedup.GetDuplicateCount(),0);
+    }
+
+    void test_read_key()
+    {
+        unsigned char data[3000];
+        for (size_t i = 0; i < sizeof(data); i++)
+            data[i] = (unsigned char)(i * 7);
+
+        ckcore::File file(ckcore::File::temp(ckT("ir_test")));
+        TS_ASSERT(file.open(ckcore::File::ckOPEN_WRITE));
+        TS_ASSERT_EQUALS(file.write(data,sizeof(data)),(ckcore::tint64)sizeof(data));
+        file.close();
+
+        // A key read from an offset matches the checksums of the data.
+        std::vector<unsigned char> buffer(FILEDEDUP_BLOCKSIZE);
+        CFileDedup::CKey key;
+
+        TS_ASSERT(file.open(ckcore::File::ckOPEN_READ));
+        file.seek(1000,ckcore::File::ckFILE_BEGIN);
+        TS_ASSERT(CFileDedup::ReadKey(file,2000,&buffer[0],key));
+        TS_ASSERT_EQUALS(key.m_uiSize,2000);
+        TS_ASSERT_EQUALS(key.m_uiCrc32,ChecksumCrc32(data + 1000,2000));
+        TS_ASSERT_EQUALS(key.m_uiCrc32c,ChecksumCrc32c(data + 1000,2000));
+
+        // Reading past the end fails.
+        file.seek(1000,ckcore::File::ckFILE_BEGIN);
+        TS_ASSERT(!CFileDedup::ReadKey(file,2001,&buffer[0],key));
+        file.close();
+
+        file.remove();
+    }
+
+    void test_compare_data()
+    {
+        const size_t size = FILEDEDUP_BLOCKSIZE + 1000;
+
+        ckcore::File a(make_file(1,size));
+        ckcore::File b(make_file(1,size));
+        ckcore::File c(make_file(1,size));
+
+        // Make the last byte of c differ, in the second block.
+        TS_ASSERT(c.open(ckcore::File::ckOPEN_READWRITE));
+        unsigned char value = 2;
+        c.seek(size - 1,ckcore::File::ckFILE_BEGIN);
+        TS_ASSERT_EQUALS(c.write(&value,1),1);
+        c.close();
+
+        std::vector<unsigned char> buffer1(FILEDEDUP_BLOCKSIZE);
+        std::vector<unsigned char> buffer2(FILEDEDUP_BLOCKSIZE);
+
+        TS_ASSERT(a.open(ckcore::File::ckOPEN_READ));
+        TS_ASSERT(b.open(ckcore::File::ckOPEN_READ));
+        TS_ASSERT(CFileDedup::CompareData(a,b,size,&buffer1[0],&buffer2[0]));
+        b.close();
+
+        a.seek(0,ckcore::File::ckFILE_BEGIN);
+        TS_ASSERT(c.open(ckcore::File::ckOPEN_READ));
+        TS_ASSERT(!CFileDedup::CompareData(a,c,size,&buffer1[0],&buffer2[0]));
+
+        // Comparing past the end fails.
+        a.seek(0,ckcore::File::ckFILE_BEGIN);
+        c.seek(0,ckcore::File::ckFILE_BEGIN);
+        TS_ASSERT(!CFileDedup::CompareData(a,c,size + 1,&buffer1[0],&buffer2[0]));
+        a.close();
+        c.close();
+    }
+};
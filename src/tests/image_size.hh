@@ -0,0 +1,319 @@
+/*
+ * InfraRecorder - CD/DVD burning software
+ * Copyright (C) 2006-2012 Christian Kindahl
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <windows.h>
+#include <vector>
+#include <cxxtest/TestSuite.h>
+#include <ckcore/file.hh>
+#include <ckcore/log.hh>
+#include <ckcore/nullstream.hh>
+#include <ckcore/progress.hh>
+#include <ckcore/types.hh>
+#include <ckfilesystem/fileset.hh>
+#include <ckfilesystem/filesystem.hh>
+#include <ckfilesystem/filesystemwriter.hh>
+#include <ckfilesystem/iso.hh>
+#include <ckfilesystem/isowriter.hh>
+#include <base/image_size_estimator.hh>
+
+class image_size_log : public ckcore::Log
+{
+public:
+    void print(const ckcore::tchar *format,...) {}
+    void print_line(const ckcore::tchar *format,...) {}
+};
+
+class image_size_progress : public ckcore::Progress
+{
+public:
+    void set_progress(unsigned char percent) {}
+    void set_marquee(bool marquee) {}
+    void set_status(const ckcore::tchar *status,...) {}
+    void notify(ckcore::Progress::MessageType type,const ckcore::tchar *msg,...) {}
+    bool cancelled() { return false; }
+};
+
+class ImageSizeTestSuite : public CxxTest::TestSuite
+{
+private:
+    std::vector<ckcore::File *> temp_files_;
+    std::vector<ckfilesystem::IsoImportData *> import_data_;
+    ckcore::tstring temp_dir_;
+
+    ckcore::tstring make_file(ckcore::tuint64 size)
+    {
+        ckcore::File *file = new ckcore::File(ckcore::File::temp(ckT("ir_test")));
+        temp_files_.push_back(file);
+
+        TS_ASSERT(file->open(ckcore::File::ckOPEN_WRITE));
+
+        char buffer[4096];
+        memset(buffer,0x55,sizeof(buffer));
+        while (size > 0)
+        {
+            ckcore::tuint32 count = size < sizeof(buffer) ? (ckcore::tuint32)size : sizeof(buffer);
+            TS_ASSERT_EQUALS(file->write(buffer,count),(ckcore::tint64)count);
+            size -= count;
+        }
+
+        file->close();
+        return file->name();
+    }
+
+    void add(ckfilesystem::FileSet &files,const ckcore::tchar *internal_path,
+             ckcore::tuint64 size)
+    {
+        files.insert(new ckfilesystem::FileDescriptor(internal_path,make_file(size).c_str()));
+    }
+
+    void add_dir(ckfilesystem::FileSet &files,const ckcore::tchar *internal_path)
+    {
+        files.insert(new ckfilesystem::FileDescriptor(internal_path,temp_dir_.c_str(),
+            ckfilesystem::FileDescriptor::FLAG_DIRECTORY));
+    }
+
+    // Builds a file set with names that require truncation and renaming,
+    // directories that span several sectors and a deep directory structure.
+    void make_file_set(ckfilesystem::FileSet &files)
+    {
+        add(files,ckT("/readme.txt"),1234);
+        add(files,ckT("/empty.dat"),0);
+        add(files,ckT("/sector.bin"),2048);
+        add(files,ckT("/sector_plus_one.bin"),2049);
+        add(files,ckT("/noextension"),100);
+        add(files,ckT("/multiple.dots.in.name.txt"),10);
+
+        add_dir(files,ckT("/documents"));
+        add(files,ckT("/documents/a very long file name that exceeds the iso9660 and joliet limits.document"),5000);
+        add(files,ckT("/documents/a very long file name that exceeds the iso9660 and joliet limits, again.document"),6000);
+        add(files,ckT("/documents/Report.txt"),300);
+        add(files,ckT("/documents/report.TXT"),301);
+
+        add_dir(files,ckT("/many"));
+        for (int i = 0; i < 200; i++)
+        {
+            ckcore::tstringstream path;
+            path << ckT("/many/file number ") << i << ckT(" with a long name.dat");
+            add(files,path.str().c_str(),i * 97);
+        }
+
+        add_dir(files,ckT("/empty folder"));
+        add_dir(files,ckT("/1/2/3/4/5/6/7"));
+        add(files,ckT("/1/2/3/4/5/6/7/deep.txt"),42);
+    }
+
+    // Adds a file that is stored in a previous session.
+    void add_imported(ckfilesystem::FileSet &files,const ckcore::tchar *internal_path,
+                      unsigned long extent_loc,unsigned long extent_len)
+    {
+        ckfilesystem::IsoImportData *import_data = new ckfilesystem::IsoImportData();
+        import_data->file_flags_ = 0;
+        import_data->file_unit_size_ = 0;
+        import_data->interleave_gap_size_ = 0;
+        import_data->volseq_num_ = 1;
+        import_data->extent_loc_ = extent_loc;
+        import_data->extent_len_ = extent_len;
+        ckfilesystem::iso_make_datetime(0,0,import_data->rec_timestamp_);
+        import_data_.push_back(import_data);
+
+        files.insert(new ckfilesystem::FileDescriptor(internal_path,ckT(""),
+            ckfilesystem::FileDescriptor::FLAG_IMPORTED,import_data));
+    }
+
+    // Compares the estimate with the size of the image created by the writer.
+    void check_files(const ckfilesystem::FileSet &files,ckfilesystem::FileSystem::Type type,
+                     ckfilesystem::Iso::InterchangeLevel level,bool long_joliet_names,
+                     bool include_file_ver_info,
+                     ckfilesystem::CharacterSet char_set = ckfilesystem::CHARSET_ISO,
+                     const ckcore::tchar *boot_image = NULL)
+    {
+        // Reference size by writing the complete image.
+        ckfilesystem::FileSystem file_sys(type,files);
+        file_sys.set_interchange_level(level);
+        file_sys.set_char_set(char_set);
+        file_sys.set_long_joliet_names(long_joliet_names);
+        file_sys.set_include_file_ver_info(include_file_ver_info);
+        if (boot_image != NULL)
+            file_sys.add_boot_image_no_emu(boot_image,true,0,4);
+
+        image_size_log log;
+        image_size_progress progress;
+        ckcore::NullStream out_stream;
+
+        ckfilesystem::FileSystemWriter file_sys_writer(log,file_sys,true);
+        TS_ASSERT_EQUALS(file_sys_writer.write(out_stream,progress,0),RESULT_OK);
+
+        CImageSizeEstimator estimator(type,level);
+        estimator.SetCharSet(char_set);
+        estimator.SetLongJolietNames(long_joliet_names);
+        estimator.SetIncludeFileVerInfo(include_file_ver_info);
+        if (boot_image != NULL)
+            TS_ASSERT(estimator.AddBootImage(boot_image));
+
+        ckcore::tuint64 size = 0;
+        TS_ASSERT(estimator.Estimate(files,size));
+        TS_ASSERT_EQUALS(size,out_stream.written());
+    }
+
+    void check(ckfilesystem::FileSystem::Type type,ckfilesystem::Iso::InterchangeLevel level,
+               bool long_joliet_names,bool include_file_ver_info)
+    {
+        ckfilesystem::FileSet files;
+        make_file_set(files);
+
+        check_files(files,type,level,long_joliet_names,include_file_ver_info);
+
+        ckfilesystem::destroy_file_set(files);
+    }
+
+public:
+    void setUp()
+    {
+        ckcore::tchar temp_path[MAX_PATH];
+        GetTempPath(MAX_PATH,temp_path);
+        temp_dir_ = temp_path;
+    }
+
+    void tearDown()
+    {
+        std::vector<ckcore::File *>::iterator it;
+        for (it = temp_files_.begin(); it != temp_files_.end(); it++)
+        {
+            (*it)->remove();
+            delete *it;
+        }
+
+        temp_files_.clear();
+
+        std::vector<ckfilesystem::IsoImportData *>::iterator it_data;
+        for (it_data = import_data_.begin(); it_data != import_data_.end(); it_data++)
+            delete *it_data;
+
+        import_data_.clear();
+    }
+
+    void test_iso()
+    {
+        check(ckfilesystem::FileSystem::TYPE_ISO,ckfilesystem::Iso::LEVEL_1,false,true);
+        check(ckfilesystem::FileSystem::TYPE_ISO,ckfilesystem::Iso::LEVEL_2,false,true);
+        check(ckfilesystem::FileSystem::TYPE_ISO,ckfilesystem::Iso::LEVEL_3,false,false);
+        check(ckfilesystem::FileSystem::TYPE_ISO,ckfilesystem::Iso::ISO9660_1999,false,true);
+    }
+
+    void test_iso_joliet()
+    {
+        check(ckfilesystem::FileSystem::TYPE_ISO_JOLIET,ckfilesystem::Iso::LEVEL_1,false,true);
+        check(ckfilesystem::FileSystem::TYPE_ISO_JOLIET,ckfilesystem::Iso::LEVEL_2,true,true);
+        check(ckfilesystem::FileSystem::TYPE_ISO_JOLIET,ckfilesystem::Iso::LEVEL_3,true,false);
+    }
+
+    void test_udf()
+    {
+        check(ckfilesystem::FileSystem::TYPE_ISO_UDF,ckfilesystem::Iso::LEVEL_2,false,true);
+        check(ckfilesystem::FileSystem::TYPE_ISO_UDF_JOLIET,ckfilesystem::Iso::LEVEL_2,false,true);
+        check(ckfilesystem::FileSystem::TYPE_ISO_UDF_JOLIET,ckfilesystem::Iso::ISO9660_1999,true,false);
+        check(ckfilesystem::FileSystem::TYPE_UDF,ckfilesystem::Iso::LEVEL_1,false,true);
+    }
+
+    void test_char_set_collisions()
+    {
+        // Names that are only equal once invalid characters have been
+        // replaced, some of them only in some character sets.
+        ckfilesystem::FileSet files;
+        add(files,ckT("/a+b.txt"),10);
+        add(files,ckT("/a_b.txt"),20);
+        add(files,ckT("/a b.txt"),30);
+        add(files,ckT("/a;b.txt"),40);
+        add(files,ckT("/caf\x00e9.txt"),50);
+        add(files,ckT("/caf\x0113.txt"),60);
+        add(files,ckT("/caf_.txt"),70);
+        add(files,ckT("/caf\x00e9.t+t"),80);
+        add(files,ckT("/caf\x00e9.t_t"),90);
+
+        add_dir(files,ckT("/dir+1"));
+        add_dir(files,ckT("/dir_1"));
+        add(files,ckT("/dir+1/file.txt"),100);
+        add(files,ckT("/dir_1/file.txt"),110);
+
+        const ckfilesystem::CharacterSet char_sets[] =
+        {
+            ckfilesystem::CHARSET_ISO,
+            ckfilesystem::CHARSET_DOS,
+            ckfilesystem::CHARSET_ASCII
+        };
+
+        for (size_t i = 0; i < sizeof(char_sets) / sizeof(char_sets[0]); i++)
+        {
+            check_files(files,ckfilesystem::FileSystem::TYPE_ISO,ckfilesystem::Iso::LEVEL_1,false,true,char_sets[i]);
+            check_files(files,ckfilesystem::FileSystem::TYPE_ISO,ckfilesystem::Iso::LEVEL_2,false,true,char_sets[i]);
+            check_files(files,ckfilesystem::FileSystem::TYPE_ISO_JOLIET,ckfilesystem::Iso::LEVEL_3,false,false,char_sets[i]);
+            check_files(files,ckfilesystem::FileSystem::TYPE_ISO,ckfilesystem::Iso::ISO9660_1999,false,true,char_sets[i]);
+        }
+
+        ckfilesystem::destroy_file_set(files);
+    }
+
+    void test_boot_image()
+    {
+        ckfilesystem::FileSet files;
+        make_file_set(files);
+
+        ckcore::tstring boot_image = make_file(2048 * 3 + 100);
+
+        check_files(files,ckfilesystem::FileSystem::TYPE_ISO,ckfilesystem::Iso::LEVEL_2,false,true,
+                    ckfilesystem::CHARSET_ISO,boot_image.c_str());
+        check_files(files,ckfilesystem::FileSystem::TYPE_ISO_UDF_JOLIET,ckfilesystem::Iso::LEVEL_2,false,true,
+                    ckfilesystem::CHARSET_ISO,boot_image.c_str());
+
+        ckfilesystem::destroy_file_set(files);
+    }
+
+    void test_imported()
+    {
+        // Imported files only occupy space in the directory records, both
+        // on their own and next to local files with the same name.
+        ckfilesystem::FileSet files;
+        make_file_set(files);
+
+        add_dir(files,ckT("/previous session"));
+        add_imported(files,ckT("/previous session/old file.txt"),10000,123456);
+        add_imported(files,ckT("/previous session/old+file.txt"),20000,5000);
+        add_imported(files,ckT("/documents/imported report.txt"),30000,42);
+
+        check_files(files,ckfilesystem::FileSystem::TYPE_ISO,ckfilesystem::Iso::LEVEL_2,false,true);
+        check_files(files,ckfilesystem::FileSystem::TYPE_ISO_JOLIET,ckfilesystem::Iso::LEVEL_2,true,true);
+
+        ckfilesystem::destroy_file_set(files);
+    }
+
+    void test_dvdvideo()
+    {
+        // The DVD-Video layout depends on the IFO files and must not be
+        // estimated from the meta data.
+        ckfilesystem::FileSet files;
+        add(files,ckT("/readme.txt"),1234);
+
+        CImageSizeEstimator estimator(ckfilesystem::FileSystem::TYPE_DVDVIDEO,
+                                      ckfilesystem::Iso::LEVEL_1);
+
+        ckcore::tuint64 size = 0;
+        TS_ASSERT(!estimator.Estimate(files,size));
+
+        ckfilesystem::destroy_file_set(files);
+    }
+};
@@ -0,0 +1,248 @@
+/*
+ * InfraRecorder - CD/DVD burning software
+ * Copyright (C) 2006-2012 Christian Kindahl
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <windows.h>
+#include <vector>
+#include <cxxtest/TestSuite.h>
+#include <ckcore/file.hh>
+#include <ckcore/types.hh>
+#include <base/simulated_device.hh>
+#include <app/core/core2_info.hh>
+
+class simulated_device_log : public ckcore::Log
+{
+public:
+    void print(const ckcore::tchar *format,...) {}
+    void print_line(const ckcore::tchar *format,...) {}
+};
+
+class SimulatedDeviceTestSuite : public CxxTest::TestSuite
+{
+private:
+    ckcore::File *image_;
+
+    static unsigned long read32(const unsigned char *buffer)
+    {
+        return ((unsigned long)buffer[0] << 24) | ((unsigned long)buffer[1] << 16) |
+               ((unsigned long)buffer[2] << 8) | buffer[3];
+    }
+
+    void make_read_cd(unsigned char *cdb,unsigned long block,unsigned long count,
+                      unsigned char flags)
+    {
+        memset(cdb,0,16);
+        cdb[0] = 0xbe;
+        cdb[2] = (unsigned char)(block >> 24);
+        cdb[3] = (unsigned char)(block >> 16);
+        cdb[4] = (unsigned char)(block >> 8);
+        cdb[5] = (unsigned char)block;
+        cdb[6] = (unsigned char)(count >> 16);
+        cdb[7] = (unsigned char)(count >> 8);
+        cdb[8] = (unsigned char)count;
+        cdb[9] = flags;
+    }
+
+public:
+    void setUp()
+    {
+        // 100 blocks where each byte holds the block number.
+        image_ = new ckcore::File(ckcore::File::temp(ckT("ir_test")));
+        TS_ASSERT(image_->open(ckcore::File::ckOPEN_WRITE));
+
+        unsigned char block[2048];
+        for (int i = 0; i < 100; i++)
+        {
+            memset(block,i,sizeof(block));
+            TS_ASSERT_EQUALS(image_->write(block,sizeof(block)),(ckcore::tint64)sizeof(block));
+        }
+
+        image_->close();
+    }
+
+    void tearDown()
+    {
+        image_->remove();
+        delete image_;
+    }
+
+    void test_capacity_toc()
+    {
+        CSimulatedDevice device(image_->name().c_str());
+        TS_ASSERT(device.Open());
+        TS_ASSERT_EQUALS(device.GetBlockCount(),100);
+
+        unsigned char cdb[16];
+        unsigned char buffer[256];
+
+        // READ CAPACITY returns the last block and the block size.
+        memset(cdb,0,sizeof(cdb));
+        cdb[0] = 0x25;
+        TS_ASSERT(device.Transport(cdb,10,buffer,8));
+        TS_ASSERT_EQUALS(read32(buffer),99);
+        TS_ASSERT_EQUALS(read32(buffer + 4),2048);
+
+        // A single data track followed by the lead-out.
+        memset(cdb,0,sizeof(cdb));
+        cdb[0] = 0x43;
+        cdb[8] = sizeof(buffer);
+        TS_ASSERT(device.Transport(cdb,10,buffer,sizeof(buffer)));
+        TS_ASSERT_EQUALS(buffer[2],1);
+        TS_ASSERT_EQUALS(buffer[3],1);
+        TS_ASSERT_EQUALS(buffer[6],1);
+        TS_ASSERT_EQUALS(buffer[5] & 0x04,0x04);
+        TS_ASSERT_EQUALS(read32(buffer + 8),0);
+        TS_ASSERT_EQUALS(buffer[14],0xaa);
+        TS_ASSERT_EQUALS(read32(buffer + 16),100);
+
+        device.Close();
+    }
+
+    void test_read_cd()
+    {
+        CSimulatedDevice device(image_->name().c_str());
+        TS_ASSERT(device.Open());
+
+        unsigned char cdb[16];
+        std::vector<unsigned char> buffer(4 * 2352);
+
+        make_read_cd(cdb,10,2,0x10);
+        TS_ASSERT(device.Transport(cdb,12,&buffer[0],2 * 2048));
+        TS_ASSERT_EQUALS(buffer[0],10);
+        TS_ASSERT_EQUALS(buffer[2048],11);
+        TS_ASSERT_EQUALS(device.GetBlocksRead(),2);
+
+        // Raw sectors start with the sync pattern and the header.
+        make_read_cd(cdb,20,1,0xf8);
+        TS_ASSERT(device.Transport(cdb,12,&buffer[0],2352));
+        TS_ASSERT_EQUALS(buffer[0],0x00);
+        TS_ASSERT_EQUALS(buffer[1],0xff);
+        TS_ASSERT_EQUALS(buffer[15],1);
+        TS_ASSERT_EQUALS(buffer[16],20);
+
+        device.Close();
+    }
+
+    void test_bad_block()
+    {
+        CSimulatedDevice device(image_->name().c_str());
+        TS_ASSERT(device.Open());
+        device.AddBadBlock(50);
+
+        unsigned char cdb[16];
+        unsigned char sense[SIMDEVICE_SENSESIZE];
+        unsigned char result = 0;
+        std::vector<unsigned char> buffer(4 * 2352);
+
+        // Without C2 information the read fails with a medium error that
+        // points at the bad block.
+        make_read_cd(cdb,49,2,0x10);
+        TS_ASSERT(device.TransportWithSense(cdb,12,&buffer[0],2 * 2048,sense,result));
+        TS_ASSERT_EQUALS(result,0x02);
+        TS_ASSERT_EQUALS(sense[2] & 0x0f,0x03);
+        TS_ASSERT_EQUALS(sense[12],0x11);
+        TS_ASSERT_EQUALS(read32(sense + 3),50);
+
+        // With C2 information the read succeeds and the bad block is flagged.
+        make_read_cd(cdb,49,2,0x12);
+        TS_ASSERT(device.TransportWithSense(cdb,12,&buffer[0],2 * (2048 + 294),sense,result));
+        TS_ASSERT_EQUALS(result,0x00);
+        TS_ASSERT_EQUALS(buffer[2048],0x00);
+        TS_ASSERT_EQUALS(buffer[2048 + 294 + 2048],0xff);
+
+        device.Close();
+    }
+
+    void test_limits()
+    {
+        CSimulatedDevice device(image_->name().c_str());
+        TS_ASSERT(device.Open());
+        device.SetLatency(100,10,0);
+        device.SetMaxTransferLength(16 * 2048);
+
+        unsigned char cdb[16];
+        std::vector<unsigned char> buffer(32 * 2048);
+
+        make_read_cd(cdb,0,32,0x10);
+        TS_ASSERT(!device.Transport(cdb,12,&buffer[0],32 * 2048));
+
+        device.ResetStatistics();
+        make_read_cd(cdb,0,16,0x10);
+        TS_ASSERT(device.Transport(cdb,12,&buffer[0],16 * 2048));
+        TS_ASSERT_EQUALS(device.GetCommandCount(),1);
+        TS_ASSERT_EQUALS(device.GetBlocksRead(),16);
+        TS_ASSERT_EQUALS(device.GetElapsedTime(),100 + 16 * 10);
+
+        device.Close();
+    }
+
+    void test_core2_info()
+    {
+        CSimulatedDevice device(image_->name().c_str());
+        device.AddTrack(1,0,false);
+        device.AddTrack(2,60,true);
+        TS_ASSERT(device.Open());
+
+        simulated_device_log log;
+        CCore2Info info(&log);
+
+        unsigned long block_addr = 0,block_len = 0;
+        TS_ASSERT(info.ReadCapacity(device,block_addr,block_len));
+        TS_ASSERT_EQUALS(block_addr,99);
+        TS_ASSERT_EQUALS(block_len,2048);
+
+        unsigned char first_track = 0,last_track = 0;
+        std::vector<CCore2TOCTrackDesc> tracks;
+        TS_ASSERT(info.ReadTOC(device,first_track,last_track,tracks));
+        TS_ASSERT_EQUALS(first_track,1);
+        TS_ASSERT_EQUALS(last_track,2);
+        TS_ASSERT_EQUALS(tracks.size(),2);
+        TS_ASSERT_EQUALS(tracks[0].m_ulTrackAddr,0);
+        TS_ASSERT_EQUALS(tracks[1].m_ucTrackNumber,2);
+        TS_ASSERT_EQUALS(tracks[1].m_ulTrackAddr,60);
+
+        CCore2TrackInfo track_info;
+        TS_ASSERT(info.ReadTrackInformation(device,CCore2Info::TIT_LBA,70,&track_info));
+        TS_ASSERT_EQUALS(track_info.m_usTrackNumber,2);
+        TS_ASSERT_EQUALS(track_info.m_ulTrackAddr,60);
+        TS_ASSERT_EQUALS(track_info.m_ulTrackSize,40);
+        TS_ASSERT(!info.ReadTrackInformation(device,CCore2Info::TIT_TRACK,3,&track_info));
+
+        CCore2DiscInfo disc_info;
+        TS_ASSERT(info.ReadDiscInformation(device,&disc_info));
+        TS_ASSERT_EQUALS(disc_info.m_ucDiscStatus,CCore2DiscInfo::DS_FINALIZED);
+        TS_ASSERT_EQUALS(disc_info.m_ucLastSessStatus,CCore2DiscInfo::LSS_COMPLETE);
+        TS_ASSERT_EQUALS(disc_info.m_usNumSessions,1);
+        TS_ASSERT_EQUALS(disc_info.m_usLastSessLstTrack,2);
+
+        unsigned char first_sess = 0,last_sess = 0;
+        unsigned long last_sess_addr = 1;
+        TS_ASSERT(info.ReadSI(device,first_sess,last_sess,last_sess_addr));
+        TS_ASSERT_EQUALS(last_sess,1);
+        TS_ASSERT_EQUALS(last_sess_addr,0);
+
+        unsigned short profile = 0;
+        device.SetProfile(0x0010);
+        TS_ASSERT(info.GetProfile(device,profile));
+        TS_ASSERT_EQUALS(profile,0x0010);
+
+        // Every query is a single command.
+        TS_ASSERT_EQUALS(device.GetCommandCount(),7);
+
+        device.Close();
+    }
+};
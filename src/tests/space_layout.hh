@@ -0,0 +1,224 @@
+/*
+ * InfraRecorder - CD/DVD burning software
+ * Copyright (C) 2006-2012 Christian Kindahl
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <windows.h>
+#include <vector>
+#include <cxxtest/TestSuite.h>
+#include <ckcore/file.hh>
+#include <ckcore/types.hh>
+#include <ckfilesystem/fileset.hh>
+#include <ckfilesystem/filesystem.hh>
+#include <ckfilesystem/iso.hh>
+#include <base/image_size_estimator.hh>
+#include <base/space_layout.hh>
+
+class SpaceLayoutTestSuite : public CxxTest::TestSuite
+{
+private:
+    std::vector<ckcore::File *> temp_files_;
+    ckcore::tstring temp_dir_;
+
+    ckcore::tstring make_file(ckcore::tuint64 size)
+    {
+        ckcore::File *file = new ckcore::File(ckcore::File::temp(ckT("ir_test")));
+        temp_files_.push_back(file);
+
+        TS_ASSERT(file->open(ckcore::File::ckOPEN_WRITE));
+
+        char buffer[4096];
+        memset(buffer,0x55,sizeof(buffer));
+        while (size > 0)
+        {
+            ckcore::tuint32 count = size < sizeof(buffer) ? (ckcore::tuint32)size : sizeof(buffer);
+            TS_ASSERT_EQUALS(file->write(buffer,count),(ckcore::tint64)count);
+            size -= count;
+        }
+
+        file->close();
+        return file->name();
+    }
+
+    static const ckcore::tchar *file_name(const ckcore::tchar *internal_path)
+    {
+        const ckcore::tchar *name = internal_path;
+        for (const ckcore::tchar *c = internal_path; *c != '\0'; c++)
+        {
+            if (*c == '/')
+                name = c + 1;
+        }
+
+        return name;
+    }
+
+    // Adds a file to both the file set and the layout.
+    void add(ckfilesystem::FileSet &files,CSpaceLayout &layout,
+             const ckcore::tchar *internal_path,ckcore::tuint64 size)
+    {
+        files.insert(new ckfilesystem::FileDescriptor(internal_path,make_file(size).c_str()));
+        layout.AddFile(file_name(internal_path),size,false);
+    }
+
+    void add_dir(ckfilesystem::FileSet &files,CSpaceLayout &layout,
+                 const ckcore::tchar *internal_path)
+    {
+        files.insert(new ckfilesystem::FileDescriptor(internal_path,temp_dir_.c_str(),
+            ckfilesystem::FileDescriptor::FLAG_DIRECTORY));
+        layout.AddFolder(file_name(internal_path));
+    }
+
+    // Returns the difference in sectors between the layout size and the
+    // size estimated from the complete file set.
+    ckcore::tint64 compare(const ckfilesystem::FileSet &files,const CSpaceLayout &layout,
+                           ckfilesystem::FileSystem::Type type,
+                           ckfilesystem::Iso::InterchangeLevel level,
+                           bool long_joliet_names,bool include_file_ver_info)
+    {
+        CImageSizeEstimator estimator(type,level);
+        estimator.SetLongJolietNames(long_joliet_names);
+        estimator.SetIncludeFileVerInfo(include_file_ver_info);
+
+        ckcore::tuint64 estimate_size = 0;
+        TS_ASSERT(estimator.Estimate(files,estimate_size));
+
+        ckcore::tuint64 layout_size = 0;
+        TS_ASSERT(layout.GetImageSize(estimator,layout_size));
+
+        return ((ckcore::tint64)layout_size - (ckcore::tint64)estimate_size) / IMAGESIZE_SECTOR_SIZE;
+    }
+
+public:
+    void setUp()
+    {
+        ckcore::tchar temp_path[MAX_PATH];
+        GetTempPath(MAX_PATH,temp_path);
+        temp_dir_ = temp_path;
+    }
+
+    void tearDown()
+    {
+        std::vector<ckcore::File *>::iterator it;
+        for (it = temp_files_.begin(); it != temp_files_.end(); it++)
+        {
+            (*it)->remove();
+            delete *it;
+        }
+
+        temp_files_.clear();
+    }
+
+    void test_empty()
+    {
+        CSpaceLayout layout;
+        TS_ASSERT(layout.IsEmpty());
+
+        CImageSizeEstimator estimator(ckfilesystem::FileSystem::TYPE_ISO_JOLIET,
+                                      ckfilesystem::Iso::LEVEL_2);
+
+        ckcore::tuint64 size = 1;
+        TS_ASSERT(layout.GetImageSize(estimator,size));
+        TS_ASSERT_EQUALS(size,0);
+    }
+
+    void test_small()
+    {
+        // Directories that fit in a single sector are calculated exactly.
+        ckfilesystem::FileSet files;
+        CSpaceLayout layout;
+        add(files,layout,ckT("/readme.txt"),1234);
+        add(files,layout,ckT("/setup.exe"),100000);
+        add(files,layout,ckT("/a long file name with spaces.document"),4097);
+        add_dir(files,layout,ckT("/docs"));
+        add(files,layout,ckT("/docs/Report 2012.txt"),2048);
+        add(files,layout,ckT("/docs/notes.txt"),0);
+
+        TS_ASSERT_EQUALS(compare(files,layout,ckfilesystem::FileSystem::TYPE_ISO,
+            ckfilesystem::Iso::LEVEL_1,false,true),0);
+        TS_ASSERT_EQUALS(compare(files,layout,ckfilesystem::FileSystem::TYPE_ISO_JOLIET,
+            ckfilesystem::Iso::LEVEL_2,false,true),0);
+        TS_ASSERT_EQUALS(compare(files,layout,ckfilesystem::FileSystem::TYPE_ISO_JOLIET,
+            ckfilesystem::Iso::LEVEL_3,true,false),0);
+        TS_ASSERT_EQUALS(compare(files,layout,ckfilesystem::FileSystem::TYPE_ISO,
+            ckfilesystem::Iso::ISO9660_1999,false,true),0);
+        TS_ASSERT_EQUALS(compare(files,layout,ckfilesystem::FileSystem::TYPE_ISO_UDF_JOLIET,
+            ckfilesystem::Iso::LEVEL_2,false,true),0);
+        TS_ASSERT_EQUALS(compare(files,layout,ckfilesystem::FileSystem::TYPE_UDF,
+            ckfilesystem::Iso::LEVEL_1,false,true),0);
+
+        ckfilesystem::destroy_file_set(files);
+    }
+
+    void test_large_directory()
+    {
+        // Directory extents spanning several sectors are approximated, the
+        // error should not exceed one sector per directory and tree.
+        ckfilesystem::FileSet files;
+        CSpaceLayout layout;
+        add(files,layout,ckT("/readme.txt"),1234);
+        add_dir(files,layout,ckT("/many"));
+        for (int i = 0; i < 200; i++)
+        {
+            ckcore::tstringstream path;
+            path << ckT("/many/file number ") << i << ckT(" with a long name.dat");
+            add(files,layout,path.str().c_str(),i * 97);
+        }
+
+        add_dir(files,layout,ckT("/many/sub"));
+        add(files,layout,ckT("/many/sub/file.txt"),10);
+
+        const ckcore::tint64 max_error = 3 * 2;
+
+        ckcore::tint64 error = compare(files,layout,ckfilesystem::FileSystem::TYPE_ISO,
+            ckfilesystem::Iso::LEVEL_2,false,true);
+        TS_ASSERT(error >= -max_error && error <= max_error);
+
+        error = compare(files,layout,ckfilesystem::FileSystem::TYPE_ISO_JOLIET,
+            ckfilesystem::Iso::LEVEL_2,false,true);
+        TS_ASSERT(error >= -max_error && error <= max_error);
+
+        error = compare(files,layout,ckfilesystem::FileSystem::TYPE_ISO_UDF_JOLIET,
+            ckfilesystem::Iso::LEVEL_2,true,true);
+        TS_ASSERT(error >= -max_error && error <= max_error);
+
+        ckfilesystem::destroy_file_set(files);
+    }
+
+    void test_remove()
+    {
+        // Removing items restores the previous totals.
+        CSpaceLayout layout;
+        layout.AddFile(ckT("readme.txt"),1234,false);
+        layout.AddFolder(ckT("docs"));
+
+        CSpaceLayout expected = layout;
+
+        layout.AddFile(ckT("a long file name with spaces.document"),4097,false);
+        layout.AddFolder(ckT("another folder"));
+        layout.AddFile(ckT("imported.txt"),100000,true);
+        layout.RemoveFile(ckT("a long file name with spaces.document"),4097,false);
+        layout.RemoveFolder(ckT("another folder"));
+        layout.RemoveFile(ckT("imported.txt"),100000,true);
+
+        CImageSizeEstimator estimator(ckfilesystem::FileSystem::TYPE_ISO_UDF_JOLIET,
+                                      ckfilesystem::Iso::LEVEL_2);
+
+        ckcore::tuint64 size = 0,expected_size = 0;
+        TS_ASSERT(layout.GetImageSize(estimator,size));
+        TS_ASSERT(expected.GetImageSize(estimator,expected_size));
+        TS_ASSERT_EQUALS(size,expected_size);
+    }
+};
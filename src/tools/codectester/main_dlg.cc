@@ -298,12 +298,25 @@ LRESULT CMainDlg::OnOK(WORD wNotifyCode,WORD wID,HWND hWndCtl,BOOL &bHandled)
     unsigned int uiBufferSize = iNumChannels * ((iBitRate / iSampleRate) >> 3) * ENCODE_BUFFER_FACTOR;
     unsigned char *pBuffer = new unsigned char[uiBufferSize];
 
+    // Measure the time spent in the decoder.
+    LARGE_INTEGER liFrequency,liStart,liStop;
+    QueryPerformanceFrequency(&liFrequency);
+
+    unsigned __int64 uiDecodeTicks = 0;
+    unsigned __int64 uiDecodedBytes = 0;
+
     while (true)
     {
+        QueryPerformanceCounter(&liStart);
         iBytesRead = pDecoder->irc_decode_process(pBuffer,uiBufferSize,uiCurrentTime);
+        QueryPerformanceCounter(&liStop);
+
         if (iBytesRead <= 0)
             break;
 
+        uiDecodeTicks += liStop.QuadPart - liStart.QuadPart;
+        uiDecodedBytes += iBytesRead;
+
         if (pEncoder->irc_encode_process(pBuffer,iBytesRead) < 0)
         {
             MessageBox(_T("Failed to encode data."),_T("Error"),MB_OK | MB_ICONERROR);
@@ -332,6 +345,18 @@ LRESULT CMainDlg::OnOK(WORD wNotifyCode,WORD wID,HWND hWndCtl,BOOL &bHandled)
     // Hide the progress bar.
     EndProcess();
 
+    // Log the decoder throughput.
+    double dSeconds = (double)uiDecodeTicks / liFrequency.QuadPart;
+    if (dSeconds > 0.0)
+    {
+        double dMegaBytes = (double)uiDecodedBytes / (1024 * 1024);
+
+        TCHAR szMessage[256];
+        swprintf(szMessage,_T("Decoded %.1f MiB in %.3f seconds (%.1f MiB/s, %.0fx real-time).\n"),
+            dMegaBytes,dSeconds,dMegaBytes / dSeconds,(uiDuration / 1000.0) / dSeconds);
+        OutputDebugString(szMessage);
+    }
+
     return 0;
 }
 